@@ -102,6 +102,7 @@ const ConfigDefaults::DefaultSetting ConfigDefaults::DefaultSettings[] =
 
 	/** Emulation options. (Options menu) **/
 	{"Options/enableSRam", "true", 0, 0, DefaultSetting::VT_BOOL, 0, 0},
+	{"Options/lateInput", "false", 0, 0, DefaultSetting::VT_BOOL, 0, 0},
 
 	/** End of array. **/
 	{nullptr, nullptr, 0, 0, DefaultSetting::VT_NONE, 0, 0}
@@ -33,9 +33,13 @@ using LibGens::Rom;
 
 #include "libgens/EmuContext/EmuContext.hpp"
 #include "libgens/EmuContext/EmuContextFactory.hpp"
+#include "libgens/EmuContext/SaveStateWorker.hpp"
+#include "libgens/EmuContext/SaveSlotCache.hpp"
 #include "libgens/EmuContext/SysVersion.hpp"
 using LibGens::EmuContext;
 using LibGens::EmuContextFactory;
+using LibGens::SaveStateWorker;
+using LibGens::SaveSlotCache;
 using LibGens::SysVersion;
 
 // LibGens Sound Manager.
@@ -81,13 +85,12 @@ namespace GensQt4 {
 EmuManager::EmuManager(QObject *parent, VBackend *vBackend)
 	: super(parent)
 	, m_keyManager(nullptr)
+	, m_lateInput(false)
 	, m_vBackend(vBackend)
 	, m_romClosedFb(nullptr)
 {
 	// Initialize timing information.
-	m_lastTime = 0;
 	m_lastTime_fps = 0;
-	m_frames = 0;
 
 	// No ROM is loaded at startup.
 	m_rom = nullptr;
@@ -103,6 +106,14 @@ EmuManager::EmuManager(QObject *parent, VBackend *vBackend)
 	// TODO: Move saveSlot validation intn ConfigStore
 	m_saveSlot = gqt4_cfg->getInt(QLatin1String("Savestates/saveSlot")) % 10;
 
+	// Savestate worker.
+	m_saveStateWorker = new SaveStateWorker();
+	m_saveStateTimer = new QTimer(this);
+	m_saveStateTimer->setInterval(50);
+	connect(m_saveStateTimer, SIGNAL(timeout()),
+		this, SLOT(saveStateTimer_timeout()));
+	m_saveSlotCache = new SaveSlotCache();
+
 	// TODO: Load initial VdpPalette settings.
 
 	// Create the Audio Backend.
@@ -154,6 +165,12 @@ EmuManager::~EmuManager()
 	delete m_audio;
 	m_audio = nullptr;
 
+	// Finish writing savestates.
+	delete m_saveStateWorker;
+	m_saveStateWorker = nullptr;
+	delete m_saveSlotCache;
+	m_saveSlotCache = nullptr;
+
 	// Delete the ROM.
 	// TODO
 	
@@ -455,6 +472,9 @@ int EmuManager::loadRom_int(LibGens::Rom *rom)
 	// Save the Rom class pointer as m_rom.
 	m_rom = rom;
 
+	// Load the save slot metadata in the background.
+	updateSaveSlotCache();
+
 	// m_rom isn't deleted, since keeping it around
 	// indicates that a game is running.
 	// TODO: Use gqt4_emuContext instead?
@@ -463,9 +483,16 @@ int EmuManager::loadRom_int(LibGens::Rom *rom)
 	m_audio->open();
 
 	// Initialize timing information.
-	m_lastTime = 0;
-	m_lastTime_fps = m_lastTime;
-	m_frames = 0;
+	m_lastTime_fps = m_timing.getTime();
+
+	// Sub-frame input.
+	// The current key state is pushed so the new
+	// I/O Manager doesn't start with all buttons released.
+	m_lateInput = gqt4_cfg->get(QLatin1String("Options/lateInput")).toBool();
+	if (m_lateInput) {
+		gqt4_emuContext->m_ioManager->setInputQueue(&m_inputQueue);
+		gqt4_cfg->m_keyManager->pushInputEvents(&m_inputQueue, m_timing.getTime(), true);
+	}
 
 	// Initialize controllers.
 	// TODO: Clear key state?
@@ -498,9 +525,9 @@ int EmuManager::loadRom_int(LibGens::Rom *rom)
 
 	// Start the emulation thread.
 	m_paused.data = 0;
-	gqt4_emuThread = new EmuThread();
-	QObject::connect(gqt4_emuThread, SIGNAL(frameDone(bool)),
-			 this, SLOT(emuFrameDone(bool)));
+	gqt4_emuThread = new EmuThread(this);
+	QObject::connect(gqt4_emuThread, SIGNAL(frameDone()),
+			 this, SLOT(emuFrameDone()));
 	gqt4_emuThread->start();
 
 	// Update the Gens title.
@@ -550,6 +577,9 @@ int EmuManager::closeRom(bool emitStateChanged)
 		gqt4_emuThread = nullptr;
 	}
 
+	// Process any requests the emulation thread didn't get to.
+	processQEmuRequest();
+
 	if (gqt4_emuContext) {
 		if (emitStateChanged) {
 			LibGens::MdFb *prevFb = m_romClosedFb;
@@ -570,6 +600,13 @@ int EmuManager::closeRom(bool emitStateChanged)
 		// (SaveData() will call the LibGens OSD handler if necessary.)
 		gqt4_emuContext->saveData();
 
+		// Stop audio capture.
+		if (LibGens::SoundMgr::IsVgmCapturing() || LibGens::SoundMgr::IsWavCapturing()) {
+			LibGens::SoundMgr::StopVgmCapture();
+			LibGens::SoundMgr::StopWavCapture();
+			emit audioCaptureChanged();
+		}
+
 		// Delete the emulation context.
 		// FIXME: Delete gqt4_emuContext after VBackend is finished using it. (MEMORY LEAK)
 		m_vBackend->setEmuContext(nullptr);
@@ -580,6 +617,7 @@ int EmuManager::closeRom(bool emitStateChanged)
 		// TODO: Handle this in gqt4_emuContext.
 		delete m_rom;
 		m_rom = nullptr;
+		updateSaveSlotCache();
 	}
 
 	// Close audio.
@@ -598,6 +636,24 @@ int EmuManager::closeRom(bool emitStateChanged)
 	return 0;
 }
 
+/**
+ * Is VGM capture active?
+ * @return True if VGM capture is active.
+ */
+bool EmuManager::isVgmCapturing(void) const
+{
+	return LibGens::SoundMgr::IsVgmCapturing();
+}
+
+/**
+ * Is WAV capture active?
+ * @return True if WAV capture is active.
+ */
+bool EmuManager::isWavCapturing(void) const
+{
+	return LibGens::SoundMgr::IsWavCapturing();
+}
+
 /**
  * Get the ROM name.
  * @return ROM name, or empty string if no ROM is loaded.
@@ -675,6 +731,17 @@ QString EmuManager::sysAbbrev(void)
  * @return Savestate filename, or empty string if no ROM is loaded.
  */
 QString EmuManager::getSaveStateFilename(void)
+{
+	return getSaveStateFilename(m_saveSlot);
+}
+
+/**
+ * Get the savestate filename for a specific slot.
+ * NOTE: Returned filename uses Qt directory separators. ('/')
+ * @param saveSlot Save slot number. (0-9)
+ * @return Savestate filename, or empty string if no ROM is loaded.
+ */
+QString EmuManager::getSaveStateFilename(int saveSlot)
 {
 	if (!m_rom)
 		return QString();
@@ -682,119 +749,92 @@ QString EmuManager::getSaveStateFilename(void)
 	const QString filename =
 		gqt4_cfg->configPath(PathConfig::GCPATH_SAVESTATES) +
 		QString::fromUtf8(m_rom->filename_baseNoExt().c_str()) +
-		QChar(L'.') + QString::number(m_saveSlot) +
+		QChar(L'.') + QString::number(saveSlot) +
 		QLatin1String(".zomg");
 	return filename;
 }
 
 /**
- * Emulation thread is finished rendering a frame.
- * @param wasFastFrame The frame was rendered "fast", i.e. no VDP updates.
+ * Update the save slot cache for the current ROM.
+ * If no ROM is loaded, the cache is cleared.
  */
-void EmuManager::emuFrameDone(bool wasFastFrame)
+void EmuManager::updateSaveSlotCache(void)
 {
-	// Make sure the emulation thread is still running.
-	if (!gqt4_emuThread || gqt4_emuThread->isStopRequested())
+	if (!m_rom) {
+		m_saveSlotCache->clear();
 		return;
-
-	// FIXME: This code is terrible.
-	if (!wasFastFrame)
-		m_frames++;
-
-	uint64_t timeDiff;
-	uint64_t thisTime = m_timing.getTime();
-	
-	if (m_lastTime < 1000) {
-		// Just started.
-		m_lastTime = thisTime;
-		m_lastTime_fps = m_lastTime;
-		timeDiff = 0;
-	} else {
-		// Get the time difference.
-		timeDiff = (thisTime - m_lastTime);
-
-		// Check the FPS counter.
-		uint64_t timeDiff_fps = (thisTime - m_lastTime_fps);
-		if (timeDiff_fps >= 250000) {
-			// More than 250ms since last FPS update.
-			// Push the current fps.
-			// (Updated four times per second.)
-			double fps = ((double)m_frames / (timeDiff_fps / 1000000.0));
-			emit updateFps(fps);
-
-			// Reset the timer and frame counter.
-			m_lastTime_fps = thisTime;
-			m_frames = 0;
-		}
 	}
 
-	// Check for SRam/EEPRom autosave.
-	// TODO: Frames elapsed.
-	gqt4_emuContext->autoSaveData(1);
-
-	// Check for requests in the emulation queue.
-	if (!m_qEmuRequest.isEmpty())
-		processQEmuRequest();
+	std::vector<std::string> filenames;
+	for (int i = 0; i < SaveSlotCache::MAX_SLOTS; i++) {
+		const QString nativeFilename = QDir::toNativeSeparators(getSaveStateFilename(i));
+		filenames.push_back(nativeFilename.toUtf8().constData());
+	}
+	m_saveSlotCache->setFilenames(filenames);
+}
 
+/**
+ * Run a frame of emulation.
+ * Called by EmuThread. (Emulation thread)
+ * @param doFastFrame If true, don't render the frame.
+ */
+void EmuManager::emuThreadFrame(bool doFastFrame)
+{
 	// Update the I/O Manager.
+	// NOTE: KeyManager is updated by the UI thread.
+	// A key event that arrives mid-update is picked
+	// up on the next frame.
 	if (m_keyManager) {
 		m_keyManager->updateIoManager(gqt4_emuContext->m_ioManager);
 	}
+	if (!m_lateInput) {
+		// Sub-frame input is disabled.
+		// Discard the events pushed by KeyHandlerQt.
+		LibGens::IoManager::InputEvent event;
+		while (m_inputQueue.pop(&event)) { }
+	}
 
-	// Update the Video Backend.
-	if (!wasFastFrame)
-		updateVBackend();
-
-	// If emulation is paused, don't resume the emulation thread.
-	if (m_paused.data)
-		return;
+	// Run a frame of emulation.
+	if (!doFastFrame)
+		gqt4_emuContext->execFrame();
+	else
+		gqt4_emuContext->execFrameFast();
 
-	/** Auto Frame Skip **/
-	// TODO: Figure out how to properly implement the old Gens method of synchronizing to audio.
-#if 0
-	// Check if we should do a fast frame.
-	// TODO: Audio stutters a bit if the video drops below 60.0 fps.
-	m_audio->wpSegWait();	// Wait for the buffer to empty.
-	m_audio->write();	// Write audio.
-	bool doFastFrame = !m_audio->isBufferEmpty();
-#else
+	// Write audio.
 	// TODO: Remove the ring buffer and just use the classic SDL-esque method.
-	m_audio->write();	// Write audio.
-#endif
+	m_audio->write();
+}
 
-	// Check if we're higher or lower than the required framerate.
-	bool doFastFrame = false;
-	const uint64_t frameRate = (1000000 /
-			(gqt4_emuContext->versionRegisterObject()->isPal() ? 50 : 60));
-	const uint64_t threshold = 1000;
-	if (timeDiff > (frameRate + threshold)) {
-		// Lower than the required framerate.
-		// Do a fast frame.
-		//printf("doing fast frame; ");
-		doFastFrame = true;
-	} else if (timeDiff < (frameRate - threshold)) {
-		// Higher than the required framerate.
-		// Wait for the required amount of time.
-		do {
-			thisTime = m_timing.getTime();
-			timeDiff = (thisTime - m_lastTime);
-
-			// NOTE: Putting usleep(0) here reduces CPU usage,
-			// but increases stuttering.
-			// TODO: Fix framedropping entirely.
-			//usleep(0);
-		} while (timeDiff < frameRate);
-		
-		// TODO: This causes some issues...
-		if (timeDiff > (frameRate + threshold))
-			doFastFrame = true;
+/**
+ * EmuThread has published a frame.
+ * Display it and update the FPS counter.
+ */
+void EmuManager::emuFrameDone(void)
+{
+	// Make sure the emulation thread is still running.
+	if (!gqt4_emuThread || gqt4_emuThread->isStopRequested())
+		return;
+
+	// Allow the emulation thread to signal the next frame.
+	// This must be done before consuming the frame, so a
+	// frame published in the meantime isn't missed.
+	gqt4_emuThread->ackFrameDone();
+
+	// Update the FPS counter.
+	const uint64_t thisTime = m_timing.getTime();
+	const uint64_t timeDiff_fps = (thisTime - m_lastTime_fps);
+	if (timeDiff_fps >= 250000) {
+		// More than 250ms since last FPS update.
+		// Push the current fps.
+		// (Updated four times per second.)
+		const int frames = gqt4_emuThread->takeFrameCount();
+		double fps = ((double)frames / (timeDiff_fps / 1000000.0));
+		emit updateFps(fps);
+		m_lastTime_fps = thisTime;
 	}
-	// Update the last time value.
-	m_lastTime = thisTime;
 
-	// Tell the emulation thread that we're ready for another frame.
-	if (gqt4_emuThread)
-		gqt4_emuThread->resume(doFastFrame);
+	// Update the Video Backend.
+	updateVBackend();
 }
 
 /** Video Backend. **/
@@ -842,7 +882,14 @@ void EmuManager::updateVBackend(void)
 	m_vBackend->setMdScreenDirty();
 	m_vBackend->setVbDirty();
 
-	if (gqt4_emuContext) {
+	if (gqt4_emuThread) {
+		// Show the most recently published frame.
+		// The emulation thread keeps rendering into
+		// MD_Screen, so it can't be used directly.
+		LibGens::MdFbTripleBuffer *frameBuffer = gqt4_emuThread->frameBuffer();
+		frameBuffer->consume();
+		m_vBackend->vbUpdate(frameBuffer->frontBuffer());
+	} else if (gqt4_emuContext) {
 		const LibGens::Vdp *vdp = gqt4_emuContext->m_vdp;
 		m_vBackend->vbUpdate(vdp->MD_Screen);
 	} else {
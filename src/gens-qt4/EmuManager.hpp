@@ -26,12 +26,12 @@
 
 // Qt includes.
 #include <QtCore/QObject>
-#include <QtCore/QQueue>
 #include <QtGui/QImage>
 
 // LibGens includes.
 #include "libgens/Rom.hpp"
 #include "libgens/IO/IoManager.hpp"
+#include "libgens/Util/MpscQueue.hpp"
 
 // LibGensKeys: Key Manager
 #include "libgenskeys/KeyManager.hpp"
@@ -42,6 +42,16 @@
 // Video Backend.
 #include "VBackend/VBackend.hpp"
 
+// Configuration paths.
+#include "Config/PathConfig.hpp"
+
+class QTimer;
+
+namespace LibGens {
+	class SaveStateWorker;
+	class SaveSlotCache;
+}
+
 namespace GensQt4 {
 
 // Audio backend.
@@ -78,6 +88,10 @@ class EmuManager : public QObject
 		inline int saveSlot(void) const
 			{ return m_saveSlot; }
 
+		// Audio capture status.
+		bool isVgmCapturing(void) const;
+		bool isWavCapturing(void) const;
+
 		// ROM information.
 		QString romName(void);		// Active ROM name.
 		QString sysName(void);		// System name for the active ROM, based on ROM region.
@@ -122,6 +136,11 @@ class EmuManager : public QObject
 		 */
 		void osdShowPreview(int duration, const QImage& img);
 
+		/**
+		 * VGM or WAV capture was started or stopped.
+		 */
+		void audioCaptureChanged(void);
+
 	protected:
 		// Load ROM.
 		// HACK: Works around the threading issue when opening a new ROM without closing the old one.
@@ -146,11 +165,10 @@ class EmuManager : public QObject
 		 */
 		int closeRom(bool emitStateChanged);
 
-		// Timing management.
+		// FPS counter.
+		// Frame pacing is handled by EmuThread.
 		LibGens::Timing m_timing;
-		uint64_t m_lastTime;		// Last time a frame was updated.
 		uint64_t m_lastTime_fps;	// Last time value used for FPS counter.
-		int m_frames;
 
 		// ROM object.
 		LibGens::Rom *m_rom;
@@ -164,6 +182,16 @@ class EmuManager : public QObject
 		/** Savestates. **/
 		int m_saveSlot;
 
+		// Savestates are compressed and written on a
+		// background thread. m_saveStateTimer polls for
+		// completed savestates while any are pending.
+		LibGens::SaveStateWorker *m_saveStateWorker;
+		QTimer *m_saveStateTimer;
+
+		// Save slot metadata, so switching slots
+		// doesn't have to open the savestates.
+		LibGens::SaveSlotCache *m_saveSlotCache;
+
 		/**
 		 * Get the savestate filename.
 		 * TODO: Move savestate code to another file?
@@ -172,9 +200,50 @@ class EmuManager : public QObject
 		 */
 		QString getSaveStateFilename(void);
 
+		/**
+		 * Get the savestate filename for a specific slot.
+		 * NOTE: Returned filename uses Qt directory separators. ('/')
+		 * @param saveSlot Save slot number. (0-9)
+		 * @return Savestate filename, or empty string if no ROM is loaded.
+		 */
+		QString getSaveStateFilename(int saveSlot);
+
+		/**
+		 * Update the save slot cache for the current ROM.
+		 * If no ROM is loaded, the cache is cleared.
+		 */
+		void updateSaveSlotCache(void);
+
+		/**
+		 * Show OSD messages for savestates that
+		 * have been written by the background thread.
+		 * This may be called on the emulation thread.
+		 */
+		void pollSaveStates(void);
+
+	/** Emulation thread. **/
+	protected:
+		friend class EmuThread;
+
+		/**
+		 * Run a frame of emulation.
+		 * Called by EmuThread. (Emulation thread)
+		 * @param doFastFrame If true, don't render the frame.
+		 */
+		void emuThreadFrame(bool doFastFrame);
+
 	protected slots:
-		// Frame done signal from EmuThread.
-		void emuFrameDone(bool wasFastFrame);
+		/**
+		 * EmuThread has published a frame.
+		 * Display it and update the FPS counter.
+		 */
+		void emuFrameDone(void);
+
+		/**
+		 * Poll for completed savestates.
+		 * Stops the timer once all savestates are written.
+		 */
+		void saveStateTimer_timeout(void);
 
 		// Calls openRom_int() with the stored filename.
 		// HACK: Works around the threading issue when opening a new ROM without closing the old one.
@@ -195,6 +264,18 @@ class EmuManager : public QObject
 		void setKeyManager(LibGensKeys::KeyManager *keyManager)
 			{ m_keyManager = keyManager; }
 
+	/** Sub-frame input. **/
+	protected:
+		// Input events pushed by KeyHandlerQt. (UI thread)
+		// If "Options/lateInput" is enabled when the ROM is
+		// loaded, IoManager applies them when the game reads
+		// the controller; otherwise, they're discarded.
+		LibGens::IoManager::InputQueue m_inputQueue;
+		bool m_lateInput;
+	public:
+		LibGens::IoManager::InputQueue *inputQueue(void)
+			{ return &m_inputQueue; }
+
 	/** Video Backend. **/
 	public:
 		void setVBackend(VBackend *vBackend);
@@ -306,6 +387,8 @@ class EmuManager : public QObject
 				RQT_RESET_CPU,
 				RQT_REGION_CODE,
 				RQT_ENABLE_SRAM,
+				RQT_VGM_CAPTURE,
+				RQT_WAV_CAPTURE,
 			};
 
 			// RQT_PALETTE_SETTING types.
@@ -365,17 +448,36 @@ class EmuManager : public QObject
 				ResetCpuIndex cpu_idx;
 
 				// Region code.
-				LibGens::SysVersion::RegionCode_t region;
+				// regionCodeOrder is read from the configuration
+				// on the UI thread, since requests are usually
+				// processed on the emulation thread.
+				struct
+				{
+					LibGens::SysVersion::RegionCode_t region;
+					uint16_t regionCodeOrder;
+				} regionCode;
 
 				// Enable/disable SRam.
 				bool enableSRam;
+
+				// Start/stop audio capture.
+				bool captureEnable;
 			};
 		};
 
 		/**
 		 * Emulation Request Queue.
+		 * While a ROM is running, requests are processed on the
+		 * emulation thread between frames. Otherwise, they're
+		 * processed immediately by postRequest().
+		 */
+		LibGens::MpscQueue<EmuRequest_t> m_qEmuRequest;
+
+		/**
+		 * Post an emulation request.
+		 * @param rq Emulation request.
 		 */
-		QQueue<EmuRequest_t> m_qEmuRequest;
+		void postRequest(const EmuRequest_t &rq);
 
 	/** Emulation Request Queue: Submission functions. **/
 
@@ -386,6 +488,10 @@ class EmuManager : public QObject
 		void setStereo(bool newStereo);
 		void resetCpu(int cpu_idx);
 
+		/** Audio capture. **/
+		void vgmCapture(bool enable);
+		void wavCapture(bool enable);
+
 		/** Savestates. **/
 		void saveState(void); // Save to current slot.
 		void loadState(void); // Load from current slot.
@@ -461,8 +567,24 @@ class EmuManager : public QObject
 		void processQEmuRequest(void);
 
 		QImage getMDScreen(void) const;
+
+		/**
+		 * Get the next unused numbered filename for the current ROM.
+		 * Format: [path]/[ROM basename]_[number][suffix]
+		 * @param path Configuration path.
+		 * @param suffix Filename suffix, including the extension.
+		 * @param pNumber [out] File number.
+		 * @return Filename.
+		 */
+		QString getNumberedFilename(PathConfig::ConfigPath path,
+					    const QString &suffix, int *pNumber) const;
+
 		void doScreenShot(void);
 
+		/** Audio capture. **/
+		void doVgmCapture(bool enable);
+		void doWavCapture(bool enable);
+
 		void doAudioRate(int newRate);
 		void doAudioStereo(bool newStereo);
 
@@ -477,7 +599,7 @@ class EmuManager : public QObject
 		void doChangePaletteSetting(EmuRequest_t::PaletteSettingType type, int val);
 		void doResetCpu(ResetCpuIndex cpu_idx);
 
-		void doRegionCode(LibGens::SysVersion::RegionCode_t region);
+		void doRegionCode(LibGens::SysVersion::RegionCode_t region, uint16_t regionCodeOrder);
 
 		void doEnableSRam(bool enableSRam);
 };
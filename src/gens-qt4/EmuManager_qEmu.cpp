@@ -27,12 +27,13 @@
 // C includes. (C++ namespace)
 #include <cstring>
 
-// ZOMG savestate handler.
-#include "libzomg/Zomg.hpp"
-
 // LibGens includes.
 #include "libgens/EmuContext/EmuContext.hpp"
+#include "libgens/EmuContext/SaveStateWorker.hpp"
+#include "libgens/EmuContext/SaveSlotCache.hpp"
 using LibGens::EmuContext;
+using LibGens::SaveStateWorker;
+using LibGens::SaveSlotCache;
 
 // LibGens video includes.
 #include "libgens/Vdp/Vdp.hpp"
@@ -49,10 +50,15 @@ using LibGens::Screenshot;
 // Audio backend.
 #include "Audio/GensPortAudio.hpp"
 
+// Audio capture.
+#include "libgens/sound/SoundMgr.hpp"
+using LibGens::SoundMgr;
+
 // Qt includes.
 #include <QtCore/QBuffer>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
+#include <QtCore/QTimer>
 #include <QtCore/QVariant>
 #include <QtCore/QIODevice>
 #include <QtGui/QApplication>
@@ -66,6 +72,26 @@ namespace GensQt4 {
 
 /** Emulation Request Queue: Submission functions. **/
 
+/**
+ * Post an emulation request.
+ * @param rq Emulation request.
+ */
+void EmuManager::postRequest(const EmuRequest_t &rq)
+{
+	m_qEmuRequest.push(rq);
+
+	if (gqt4_emuThread) {
+		// The emulation thread will process the request
+		// before the next frame. Wake it up in case
+		// emulation is paused.
+		gqt4_emuThread->wake();
+	} else {
+		// Emulation isn't running.
+		// Process the request immediately.
+		processQEmuRequest();
+	}
+}
+
 /**
  * Request a screenshot.
  */
@@ -76,10 +102,37 @@ void EmuManager::screenShot(void)
 
 	EmuRequest_t rq;
 	rq.rqType = EmuRequest_t::RQT_SCREENSHOT;
-	m_qEmuRequest.enqueue(rq);
+	postRequest(rq);
+}
 
-	if (m_paused.data)
-		processQEmuRequest();
+/**
+ * Start or stop VGM capture.
+ * @param enable True to start capture; false to stop capture.
+ */
+void EmuManager::vgmCapture(bool enable)
+{
+	if (!m_rom)
+		return;
+
+	EmuRequest_t rq;
+	rq.rqType = EmuRequest_t::RQT_VGM_CAPTURE;
+	rq.captureEnable = enable;
+	postRequest(rq);
+}
+
+/**
+ * Start or stop WAV capture.
+ * @param enable True to start capture; false to stop capture.
+ */
+void EmuManager::wavCapture(bool enable)
+{
+	if (!m_rom)
+		return;
+
+	EmuRequest_t rq;
+	rq.rqType = EmuRequest_t::RQT_WAV_CAPTURE;
+	rq.captureEnable = enable;
+	postRequest(rq);
 }
 
 /**
@@ -94,10 +147,7 @@ void EmuManager::setAudioRate(int newRate)
 	EmuRequest_t rq;
 	rq.rqType = EmuRequest_t::RQT_AUDIO_RATE;
 	rq.audioRate = newRate;
-	m_qEmuRequest.enqueue(rq);
-
-	if (!m_rom || m_paused.data)
-		processQEmuRequest();
+	postRequest(rq);
 }
 
 /**
@@ -109,10 +159,7 @@ void EmuManager::setStereo(bool newStereo)
 	EmuRequest_t rq;
 	rq.rqType = EmuRequest_t::RQT_AUDIO_STEREO;
 	rq.audioStereo = newStereo;
-	m_qEmuRequest.enqueue(rq);
-
-	if (!m_rom || m_paused.data)
-		processQEmuRequest();
+	postRequest(rq);
 }
 
 /**
@@ -128,10 +175,7 @@ void EmuManager::resetCpu(int cpu_idx)
 	EmuRequest_t rq;
 	rq.rqType = EmuRequest_t::RQT_RESET_CPU;
 	rq.cpu_idx = (ResetCpuIndex)cpu_idx;
-	m_qEmuRequest.enqueue(rq);
-
-	if (m_paused.data)
-		processQEmuRequest();
+	postRequest(rq);
 }
 
 /**
@@ -149,10 +193,7 @@ void EmuManager::saveState(void)
 	rq.rqType = EmuRequest_t::RQT_SAVE_STATE;
 	rq.saveState.filename = new QString(filename);
 	rq.saveState.saveSlot = m_saveSlot;
-	m_qEmuRequest.enqueue(rq);
-
-	if (m_paused.data)
-		processQEmuRequest();
+	postRequest(rq);
 }
 
 /**
@@ -170,10 +211,7 @@ void EmuManager::loadState(void)
 	rq.rqType = EmuRequest_t::RQT_LOAD_STATE;
 	rq.saveState.filename = new QString(filename);
 	rq.saveState.saveSlot = m_saveSlot;
-	m_qEmuRequest.enqueue(rq);
-
-	if (m_paused.data)
-		processQEmuRequest();
+	postRequest(rq);
 }
 
 /**
@@ -219,22 +257,19 @@ void EmuManager::pauseRequest(paused_t newPaused)
 		return;
 	}
 
-	// Check if we should pause or unpause the emulator.
-	if (!newPaused.data) {
-		// Unpause the ROM immediately.
-		// TODO: Reset the FPS counter?
-		m_paused = newPaused;
-		m_audio->open();	// TODO: Add a resume() function.
-		if (gqt4_emuThread)
-			gqt4_emuThread->resume(false);
-		emit stateChanged();
-	} else {
-		// Queue the pause request.
-		EmuRequest_t rq;
-		rq.rqType = EmuRequest_t::RQT_PAUSE_EMULATION;
-		rq.newPaused = newPaused;
-		m_qEmuRequest.enqueue(rq);
-	}
+	// Update the UI's paused state immediately.
+	// The emulation thread pauses or resumes
+	// when it processes the request, so pausing
+	// and unpausing are always handled in order.
+	// TODO: Reset the FPS counter?
+	m_paused = newPaused;
+
+	EmuRequest_t rq;
+	rq.rqType = EmuRequest_t::RQT_PAUSE_EMULATION;
+	rq.newPaused = newPaused;
+	postRequest(rq);
+
+	emit stateChanged();
 }
 
 /**
@@ -250,10 +285,7 @@ void EmuManager::saveSlot_changed_slot(const QVariant &saveSlot)
 	EmuRequest_t rq;
 	rq.rqType = EmuRequest_t::RQT_SAVE_SLOT;
 	rq.saveState.saveSlot = saveSlot.toInt();
-	m_qEmuRequest.enqueue(rq);
-
-	if (!m_rom || m_paused.data)
-		processQEmuRequest();
+	postRequest(rq);
 }
 
 /**
@@ -266,10 +298,7 @@ void EmuManager::enableSRam_changed_slot(const QVariant &enableSRam)
 	EmuRequest_t rq;
 	rq.rqType = EmuRequest_t::RQT_ENABLE_SRAM;
 	rq.enableSRam = enableSRam.toBool();
-	m_qEmuRequest.enqueue(rq);
-
-	if (!m_rom || m_paused.data)
-		processQEmuRequest();
+	postRequest(rq);
 }
 
 /**
@@ -282,10 +311,7 @@ void EmuManager::autoFixChecksum_changed_slot(const QVariant &autoFixChecksum)
 	EmuRequest_t rq;
 	rq.rqType = EmuRequest_t::RQT_AUTOFIX_CHANGE;
 	rq.autoFixChecksum = autoFixChecksum.toBool();
-	m_qEmuRequest.enqueue(rq);
-
-	if (!m_rom || m_paused.data)
-		processQEmuRequest();
+	postRequest(rq);
 }
 
 /**
@@ -300,11 +326,10 @@ void EmuManager::regionCode_changed_slot(const QVariant &regionCode)
 	// Queue the region code change.
 	EmuRequest_t rq;
 	rq.rqType = EmuRequest_t::RQT_REGION_CODE;
-	rq.region = (LibGens::SysVersion::RegionCode_t)regionCode.toInt();
-	m_qEmuRequest.enqueue(rq);
-
-	if (!m_rom || m_paused.data)
-		processQEmuRequest();
+	rq.regionCode.region = (LibGens::SysVersion::RegionCode_t)regionCode.toInt();
+	rq.regionCode.regionCodeOrder =
+		(uint16_t)gqt4_cfg->getUInt(QLatin1String("System/regionCodeOrder"));
+	postRequest(rq);
 }
 
 /**
@@ -331,11 +356,10 @@ void EmuManager::regionCodeOrder_changed_slot(const QVariant &regionCodeOrder)
 	// Queue the region code change.
 	EmuRequest_t rq;
 	rq.rqType = EmuRequest_t::RQT_REGION_CODE;
-	rq.region = LibGens::SysVersion::REGION_AUTO;
-	m_qEmuRequest.enqueue(rq);
-
-	if (!m_rom || m_paused.data)
-		processQEmuRequest();
+	rq.regionCode.region = LibGens::SysVersion::REGION_AUTO;
+	rq.regionCode.regionCodeOrder =
+		(uint16_t)gqt4_cfg->getUInt(QLatin1String("System/regionCodeOrder"));
+	postRequest(rq);
 }
 
 /**
@@ -351,10 +375,7 @@ void EmuManager::resetEmulator(bool hardReset)
 	EmuRequest_t rq;
 	rq.rqType = EmuRequest_t::RQT_RESET;
 	rq.hardReset = hardReset;
-	m_qEmuRequest.enqueue(rq);
-
-	if (m_paused.data)
-		processQEmuRequest();
+	postRequest(rq);
 }
 
 /**
@@ -369,10 +390,7 @@ void EmuManager::changePaletteSetting(EmuRequest_t::PaletteSettingType type, int
 	rq.rqType = EmuRequest_t::RQT_PALETTE_SETTING;
 	rq.PaletteSettings.ps_type = type;
 	rq.PaletteSettings.ps_val = val;
-	m_qEmuRequest.enqueue(rq);
-
-	if (!m_rom || m_paused.data)
-		processQEmuRequest();
+	postRequest(rq);
 }
 
 /** Graphics settings. **/
@@ -401,11 +419,13 @@ void EmuManager::enableInterlacedMode_changed_slot(const QVariant &enableInterla
 
 /**
  * Process the Emulation Request queue.
+ * Called on the emulation thread between frames,
+ * or on the UI thread if emulation isn't running.
  */
 void EmuManager::processQEmuRequest(void)
 {
-	while (!m_qEmuRequest.isEmpty()) {
-		EmuRequest_t rq = m_qEmuRequest.dequeue();
+	EmuRequest_t rq;
+	while (m_qEmuRequest.pop(&rq)) {
 
 		switch (rq.rqType) {
 			case EmuRequest_t::RQT_SCREENSHOT:
@@ -441,8 +461,7 @@ void EmuManager::processQEmuRequest(void)
 				break;
 
 			case EmuRequest_t::RQT_PAUSE_EMULATION:
-				// Pause emulation.
-				// Unpausing emulation is handled in EmuManager::pauseRequest().
+				// Pause or unpause emulation.
 				doPauseRequest(rq.newPaused);
 				break;
 
@@ -468,7 +487,7 @@ void EmuManager::processQEmuRequest(void)
 
 			case EmuRequest_t::RQT_REGION_CODE:
 				// Set the region code.
-				doRegionCode(rq.region);
+				doRegionCode(rq.regionCode.region, rq.regionCode.regionCodeOrder);
 				break;
 
 			case EmuRequest_t::RQT_ENABLE_SRAM:
@@ -476,6 +495,16 @@ void EmuManager::processQEmuRequest(void)
 				doEnableSRam(rq.enableSRam);
 				break;
 
+			case EmuRequest_t::RQT_VGM_CAPTURE:
+				// Start/stop VGM capture.
+				doVgmCapture(rq.captureEnable);
+				break;
+
+			case EmuRequest_t::RQT_WAV_CAPTURE:
+				// Start/stop WAV capture.
+				doWavCapture(rq.captureEnable);
+				break;
+
 			case EmuRequest_t::RQT_UNKNOWN:
 			default:
 				// Unknown emulation request.
@@ -485,35 +514,51 @@ void EmuManager::processQEmuRequest(void)
 }
 
 /**
- * Do a screenshot.
- * Called from processQEmuRequest().
+ * Get the next unused numbered filename for the current ROM.
+ * Format: [path]/[ROM basename]_[number][suffix]
+ * @param path Configuration path.
+ * @param suffix Filename suffix, including the extension.
+ * @param pNumber [out] File number.
+ * @return Filename.
  */
-void EmuManager::doScreenShot(void)
+QString EmuManager::getNumberedFilename(PathConfig::ConfigPath path,
+					const QString &suffix, int *pNumber) const
 {
 	// Get the ROM filename (without extension).
 	// TODO: Remove all extensions, not just the base?
 	// Otherwise, S1.bin.gz will save as S1.bin_000.png.
 	const QString romFilename = QString::fromUtf8(m_rom->filename_baseNoExt().c_str());
 
-	// Add the current directory, number, and .png extension.
-	// TODO: Enumerate QImageWriter for supported image formats.
-	const QString scrFilenamePrefix =
-		gqt4_cfg->configPath(PathConfig::GCPATH_SCREENSHOTS) + romFilename;
-	const QString scrFilenameSuffix = QLatin1String(".png");
-	QString scrFilename;
-	int scrNumber = -1;
+	// Add the current directory, number, and suffix.
+	const QString filenamePrefix = gqt4_cfg->configPath(path) + romFilename;
+	QString filename;
+	int number = -1;
 	do {
 		// TODO: Figure out how to optimize this!
-		scrNumber++;
-		scrFilename = scrFilenamePrefix + QChar(L'_') +
-				QString::number(scrNumber).rightJustified(3, QChar(L'0')) +
-				scrFilenameSuffix;
-	} while (QFile::exists(scrFilename));
+		number++;
+		filename = filenamePrefix + QChar(L'_') +
+				QString::number(number).rightJustified(3, QChar(L'0')) +
+				suffix;
+	} while (QFile::exists(filename));
+
+	*pNumber = number;
+	return filename;
+}
+
+/**
+ * Do a screenshot.
+ * Called from processQEmuRequest().
+ */
+void EmuManager::doScreenShot(void)
+{
+	// TODO: Enumerate QImageWriter for supported image formats.
+	int scrNumber;
+	const QString scrFilename = getNumberedFilename(
+		PathConfig::GCPATH_SCREENSHOTS, QLatin1String(".png"), &scrNumber);
 
 	// Take the screenshot.
 	MdFb *fb = gqt4_emuContext->m_vdp->MD_Screen->ref();
 	int ret = Screenshot::toFile(scrFilename.toUtf8().constData(), fb, m_rom);
-	fb->unref();
 
 	// Done using the framebuffer.
 	fb->unref();
@@ -532,6 +577,82 @@ void EmuManager::doScreenShot(void)
 	emit osdPrintMsg(1500, osdMsg);
 }
 
+/**
+ * Start or stop VGM capture.
+ * Called from processQEmuRequest().
+ * @param enable True to start capture; false to stop capture.
+ */
+void EmuManager::doVgmCapture(bool enable)
+{
+	if (enable == SoundMgr::IsVgmCapturing())
+		return;
+
+	QString osdMsg;
+	if (enable) {
+		int vgmNumber;
+		const QString vgmFilename = getNumberedFilename(
+			PathConfig::GCPATH_VGM, QLatin1String(".vgm"), &vgmNumber);
+		int ret = SoundMgr::StartVgmCapture(vgmFilename.toUtf8().constData());
+		if (ret == 0) {
+			//: OSD message indicating VGM capture has started.
+			osdMsg = tr("VGM capture %1 started.", "osd").arg(vgmNumber);
+		} else {
+			//: OSD message indicating an error occurred while starting VGM capture.
+			osdMsg = tr("Error starting VGM capture: %1", "osd").arg(QLatin1String(strerror(-ret)));
+		}
+	} else {
+		int ret = SoundMgr::StopVgmCapture();
+		if (ret == 0) {
+			//: OSD message indicating VGM capture has stopped.
+			osdMsg = tr("VGM capture stopped.", "osd");
+		} else {
+			//: OSD message indicating an error occurred while saving a VGM file.
+			osdMsg = tr("Error saving VGM file: %1", "osd").arg(QLatin1String(strerror(-ret)));
+		}
+	}
+
+	emit osdPrintMsg(1500, osdMsg);
+	emit audioCaptureChanged();
+}
+
+/**
+ * Start or stop WAV capture.
+ * Called from processQEmuRequest().
+ * @param enable True to start capture; false to stop capture.
+ */
+void EmuManager::doWavCapture(bool enable)
+{
+	if (enable == SoundMgr::IsWavCapturing())
+		return;
+
+	QString osdMsg;
+	if (enable) {
+		int wavNumber;
+		const QString wavFilename = getNumberedFilename(
+			PathConfig::GCPATH_WAV, QLatin1String(".wav"), &wavNumber);
+		int ret = SoundMgr::StartWavCapture(wavFilename.toUtf8().constData());
+		if (ret == 0) {
+			//: OSD message indicating WAV capture has started.
+			osdMsg = tr("WAV capture %1 started.", "osd").arg(wavNumber);
+		} else {
+			//: OSD message indicating an error occurred while starting WAV capture.
+			osdMsg = tr("Error starting WAV capture: %1", "osd").arg(QLatin1String(strerror(-ret)));
+		}
+	} else {
+		int ret = SoundMgr::StopWavCapture();
+		if (ret == 0) {
+			//: OSD message indicating WAV capture has stopped.
+			osdMsg = tr("WAV capture stopped.", "osd");
+		} else {
+			//: OSD message indicating an error occurred while saving a WAV file.
+			osdMsg = tr("Error saving WAV file: %1", "osd").arg(QLatin1String(strerror(-ret)));
+		}
+	}
+
+	emit osdPrintMsg(1500, osdMsg);
+	emit audioCaptureChanged();
+}
+
 /**
  * Set the audio sampling rate.
  * @param newRate New audio sampling rate.
@@ -572,6 +693,9 @@ void EmuManager::doAudioStereo(bool newStereo)
 
 /**
  * Save the current emulation state to a file.
+ * The state is copied here; compression and file writes
+ * are done on a background thread. The OSD message is
+ * shown by saveStateTimer_timeout() once it's written.
  * @param filename Filename.
  * @param saveSlot Save slot number. (0-9)
  */
@@ -579,26 +703,68 @@ void EmuManager::doSaveState(QString filename, int saveSlot)
 {
 	// Save the ZOMG file.
 	const QString nativeFilename = QDir::toNativeSeparators(filename);
-	int ret = gqt4_emuContext->zomgSave(nativeFilename.toUtf8().constData());
-
-	QString osdMsg;
-	if (ret == 0) {
-		// Savestate saved.
-		if (saveSlot >= 0) {
-			//: OSD message indicating a savestate has been saved.
-			osdMsg = tr("State %1 saved.", "osd").arg(saveSlot);
-		} else {
-			//: OSD message indicating a savestate has been saved using a specified filename.
-			osdMsg = tr("State saved in %1", "osd").arg(nativeFilename);
-		}
-	} else {
+	int ret = m_saveStateWorker->save(gqt4_emuContext,
+			nativeFilename.toUtf8().constData(), saveSlot);
+	if (ret != 0) {
 		// Error saving savestate.
 		//: OSD message indicating an error occurred while saving the savestate.
-		osdMsg = tr("Error saving state: %1", "osd").arg(ret);
+		QString osdMsg = tr("Error saving state: %1", "osd").arg(ret);
+		emit osdPrintMsg(1500, osdMsg);
+		return;
 	}
 
-	// Print the message to the OSD.
-	emit osdPrintMsg(1500, osdMsg);
+	// Poll for the result.
+	// The timer belongs to the UI thread, so it
+	// can't be started directly from here.
+	QMetaObject::invokeMethod(m_saveStateTimer, "start", Qt::QueuedConnection);
+}
+
+/**
+ * Poll for completed savestates.
+ * Stops the timer once all savestates are written.
+ */
+void EmuManager::saveStateTimer_timeout(void)
+{
+	pollSaveStates();
+	if (!m_saveStateWorker->isBusy()) {
+		// All savestates have been written.
+		m_saveStateTimer->stop();
+	}
+}
+
+/**
+ * Show OSD messages for savestates that
+ * have been written by the background thread.
+ * This may be called on the emulation thread.
+ */
+void EmuManager::pollSaveStates(void)
+{
+	SaveStateWorker::Result result;
+	while (m_saveStateWorker->poll(&result)) {
+		// The slot's cached metadata is out of date.
+		// (Savestates saved using a specified filename
+		// have an ID of -1, so they're ignored.)
+		m_saveSlotCache->invalidate(result.id);
+
+		QString osdMsg;
+		if (result.ret == 0) {
+			// Savestate saved.
+			if (result.id >= 0) {
+				//: OSD message indicating a savestate has been saved.
+				osdMsg = tr("State %1 saved.", "osd").arg(result.id);
+			} else {
+				//: OSD message indicating a savestate has been saved using a specified filename.
+				osdMsg = tr("State saved in %1", "osd").arg(QString::fromUtf8(result.filename.c_str()));
+			}
+		} else {
+			// Error saving savestate.
+			//: OSD message indicating an error occurred while saving the savestate.
+			osdMsg = tr("Error saving state: %1", "osd").arg(result.ret);
+		}
+
+		// Print the message to the OSD.
+		emit osdPrintMsg(1500, osdMsg);
+	}
 }
 
 /**
@@ -610,6 +776,10 @@ void EmuManager::doLoadState(QString filename, int saveSlot)
 {
 	// TODO: Redraw the screen if emulation is paused.
 
+	// Make sure the savestate isn't still being written.
+	m_saveStateWorker->wait();
+	pollSaveStates();
+
 	// Load the ZOMG file.
 	const QString nativeFilename = QDir::toNativeSeparators(filename);
 	int ret = gqt4_emuContext->zomgLoad(nativeFilename.toUtf8().constData());
@@ -663,33 +833,26 @@ void EmuManager::doSaveSlot(int newSaveSlot)
 	//: OSD message indicating a save slot is selected while a ROM is loaded.
 	QString osdMsg = tr("Save Slot %1 [%2]", "osd").arg(m_saveSlot);
 
-	// Check if the file exists.
-	QString filename = getSaveStateFilename();
-	if (QFile::exists(filename)) {
+	// Make sure the savestate isn't still being written.
+	// pollSaveStates() invalidates the slot if it was.
+	m_saveStateWorker->wait();
+	pollSaveStates();
+
+	// Get the slot metadata.
+	// This usually doesn't have to access the savestate.
+	SaveSlotCache::SlotInfo info;
+	int ret = m_saveSlotCache->slotInfo(m_saveSlot, &info);
+	if (ret == 0 && info.status != SaveSlotCache::SLOT_EMPTY) {
 		// Savestate exists.
 		//: OSD message indicating a savestate exists in the selected slot.
 		osdMsg = osdMsg.arg(tr("OCCUPIED", "osd"));
 
-		// Attempt to load a preview image from the savestate.
-		QString nativeFilename = QDir::toNativeSeparators(filename);
-		LibZomg::Zomg zomg(nativeFilename.toUtf8().constData(), LibZomg::Zomg::ZOMG_LOAD);
-
-		Zomg_Img_Data_t img_data;
-		int ret = zomg.loadPreview(&img_data);
-		if (ret == 0) {
+		if (info.img.data) {
 			// Preview image loaded from the ZOMG file.
-			// TODO: If we construct a QImage using the raw data directly,
-			// a copy won't be needed, but it won't be deleted.
-			// Figure out a more efficient way to handle this.
-			// (Store imgPreview locally?)
 			// TODO: Add LOAD parameters to img_data for e.g. not swapping BGR.
-			imgPreview = QImage(img_data.w, img_data.h, QImage::Format_RGB32);
-			memcpy(imgPreview.bits(), img_data.data, img_data.pitch * img_data.h);
-			free(img_data.data);
+			imgPreview = QImage(info.img.w, info.img.h, QImage::Format_RGB32);
+			memcpy(imgPreview.bits(), info.img.data, info.img.pitch * info.img.h);
 		}
-
-		// Close the savestate.
-		zomg.close();
 	} else {
 		// Savestate doesn't exist.
 		//: OSD message indicating there is no savestate in the selected slot.
@@ -702,29 +865,22 @@ void EmuManager::doSaveSlot(int newSaveSlot)
 }
 
 /**
- * Pause emulation.
- * Unpausing emulation is handled in EmuManager::pauseRequest().
+ * Pause or unpause emulation.
+ * The UI's paused state is updated by EmuManager::pauseRequest().
  * @param newPaused New paused state.
  */
 void EmuManager::doPauseRequest(paused_t newPaused)
 {
-	if (m_paused.data) {
-		// Emulator is already paused.
-		// Simply update the paused state.
-		m_paused = newPaused;
-		emit stateChanged();
-		return;
+	if (newPaused.data) {
+		// Turn off audio and autosave SRam/EEPRom.
+		m_audio->close();	// TODO: Add a pause() function.
+		gqt4_emuContext->autoSaveData();
+	} else {
+		m_audio->open();	// TODO: Add a resume() function.
 	}
 
-	// Pause the emulator.
-	m_paused = newPaused;
-
-	// Turn off audio and autosave SRam/EEPRom.
-	m_audio->close();	// TODO: Add a pause() function.
-	gqt4_emuContext->autoSaveData(-1);
-
-	// Emulation state has changed.
-	emit stateChanged();
+	if (gqt4_emuThread)
+		gqt4_emuThread->setPaused(!!newPaused.data);
 }
 
 /**
@@ -864,8 +1020,9 @@ void EmuManager::doResetCpu(EmuManager::ResetCpuIndex cpu_idx)
 /**
  * Set the region code.
  * @param region New region code setting.
+ * @param regionCodeOrder Region code order for auto-detection.
  */
-void EmuManager::doRegionCode(LibGens::SysVersion::RegionCode_t region)
+void EmuManager::doRegionCode(LibGens::SysVersion::RegionCode_t region, uint16_t regionCodeOrder)
 {
 	// TODO: Verify if this is an actual change.
 	// If it isn't, don't do anything.
@@ -882,8 +1039,7 @@ void EmuManager::doRegionCode(LibGens::SysVersion::RegionCode_t region)
 		// Emulation is running. Change the region.
 		// GetLgRegionCode() is needed for region auto-detection.
 		LibGens::SysVersion::RegionCode_t lg_region = GetLgRegionCode(
-					region, m_rom->regionCode(),
-					(uint16_t)gqt4_cfg->getUInt(QLatin1String("System/regionCodeOrder")));
+					region, m_rom->regionCode(), regionCodeOrder);
 		gqt4_emuContext->setRegion(lg_region);
 
 		if (region == LibGens::SysVersion::REGION_AUTO) {
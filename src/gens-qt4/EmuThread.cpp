@@ -22,16 +22,27 @@
  ***************************************************************************/
 
 #include "EmuThread.hpp"
+#include "EmuManager.hpp"
 #include "gqt4_main.hpp"
 
+// LibGens includes.
+#include "libgens/EmuContext/EmuContext.hpp"
+#include "libgens/EmuContext/SysVersion.hpp"
+#include "libgens/Util/MdFb.hpp"
+#include "libgens/Util/Timing.hpp"
+#include "libgens/Vdp/Vdp.hpp"
+
 namespace GensQt4 {
 
-EmuThread::EmuThread(QObject *parent)
+EmuThread::EmuThread(EmuManager *emuManager, QObject *parent)
 	: super(parent)
-{
-	m_stop = false;
-	m_doFastFrame = false;
-}
+	, m_emuManager(emuManager)
+	, m_stop(false)
+	, m_wakePending(false)
+	, m_paused(false)
+	, m_frameCount(0)
+	, m_frameDonePending(0)
+{ }
 
 EmuThread::~EmuThread()
 {
@@ -43,10 +54,25 @@ EmuThread::~EmuThread()
 #endif
 }
 
-void EmuThread::resume(bool doFastFrame)
+/**
+ * Set the paused state.
+ * Must be called on the emulation thread,
+ * i.e. while processing an emulation request.
+ * @param paused True to pause; false to resume.
+ */
+void EmuThread::setPaused(bool paused)
+{
+	m_paused = paused;
+}
+
+/**
+ * Wake the emulation thread so it processes
+ * new emulation requests, even if it's paused.
+ */
+void EmuThread::wake(void)
 {
 	m_mutex.lock();
-	m_doFastFrame = doFastFrame;
+	m_wakePending = true;
 	m_wait.wakeAll();
 	m_mutex.unlock();
 }
@@ -59,30 +85,91 @@ void EmuThread::stop(void)
 	m_mutex.unlock();
 }
 
+/**
+ * Wait until the specified time.
+ * @param target Target time, in microseconds.
+ */
+void EmuThread::waitUntil(uint64_t target)
+{
+	LibGens::Timing timing;
+	uint64_t now = timing.getTime();
+	while (now < target) {
+		const uint64_t remaining = (target - now);
+		if (remaining > 2000) {
+			// Sleep for most of the remaining time.
+			// The last millisecond is spun, since
+			// sleep granularity is usually ~1 ms.
+			usleep((unsigned long)(remaining - 1000));
+		} else {
+			yieldCurrentThread();
+		}
+		now = timing.getTime();
+	}
+}
+
 void EmuThread::run(void)
 {
 	// NOTE: LibGens initialization is done elsewhere.
 	// The emulation thread doesn't initialize anything;
 	// it merely runs what's already been initialized.
-	
-	// Default to full frames.
-	m_doFastFrame = false;
-	
-	// Run the emulation thread.
+	LibGens::Timing timing;
+	uint64_t nextFrame = 0;	// Time the next frame is due.
+
 	m_mutex.lock();
-	while (!m_stop)
-	{
+	while (!m_stop) {
+		// Process emulation requests.
+		m_wakePending = false;
+		m_mutex.unlock();
+		m_emuManager->processQEmuRequest();
+		m_mutex.lock();
+		if (m_stop)
+			break;
+
+		if (m_paused) {
+			// Wait for a request. (Unpausing is a request.)
+			if (!m_wakePending)
+				m_wait.wait(&m_mutex);
+			nextFrame = 0;
+			continue;
+		}
+		m_mutex.unlock();
+
+		// Frame pacing.
+		const uint64_t frameTime = (1000000 /
+			(gqt4_emuContext->versionRegisterObject()->isPal() ? 50 : 60));
+		uint64_t now = timing.getTime();
+		if (nextFrame == 0 || now > nextFrame + (frameTime * MAX_FRAMESKIP)) {
+			// Just started, or we're too far behind to catch up.
+			nextFrame = now;
+		}
+
+		bool doFastFrame = false;
+		if (now < nextFrame) {
+			// Ahead of schedule.
+			waitUntil(nextFrame);
+		} else if (now >= nextFrame + frameTime) {
+			// More than a frame behind.
+			// Skip rendering to catch up.
+			doFastFrame = true;
+		}
+		nextFrame += frameTime;
+
 		// Run a frame of emulation.
-		if (!m_doFastFrame)
-			gqt4_emuContext->execFrame();
-		else
-			gqt4_emuContext->execFrameFast();
-		
-		// Signal that the frame has been drawn.
-		emit frameDone(m_doFastFrame);
-		
-		// Wait for a resume command.
-		m_wait.wait(&m_mutex);
+		m_emuManager->emuThreadFrame(doFastFrame);
+
+		if (!doFastFrame) {
+			// Publish the frame.
+			m_frameBuffer.backBuffer()->copyFrom(gqt4_emuContext->m_vdp->MD_Screen);
+			m_frameBuffer.publish();
+			m_frameCount.fetchAndAddOrdered(1);
+
+			// Notify the UI thread if it isn't already
+			// processing a frameDone() signal.
+			if (m_frameDonePending.testAndSetOrdered(0, 1))
+				emit frameDone();
+		}
+
+		m_mutex.lock();
 	}
 	m_mutex.unlock();
 }
@@ -27,15 +27,35 @@
 #include <QtCore/QThread>
 #include <QtCore/QWaitCondition>
 #include <QtCore/QMutex>
+#include <QtCore/QAtomicInt>
+
+// C includes.
+#include <stdint.h>
+
+// LibGens includes.
+#include "libgens/Util/MdFbTripleBuffer.hpp"
 
 namespace GensQt4 {
 
+class EmuManager;
+
+/**
+ * Emulation thread.
+ *
+ * Runs frames at the emulated system's frame rate without
+ * waiting for the UI thread. Completed frames are published
+ * to a triple buffer, and frameDone() is emitted so the UI
+ * thread can display the most recent one.
+ *
+ * Emulation requests are processed by EmuManager on this
+ * thread between frames.
+ */
 class EmuThread : public QThread
 {
 	Q_OBJECT
 
 	public:
-		EmuThread(QObject *parent = 0);
+		EmuThread(EmuManager *emuManager, QObject *parent = 0);
 		~EmuThread();
 
 	private:
@@ -46,20 +66,78 @@ class EmuThread : public QThread
 	public:
 		inline bool isStopRequested(void);
 
+		/**
+		 * Get the frame triple buffer.
+		 * The UI thread is the consumer.
+		 * @return Frame triple buffer.
+		 */
+		inline LibGens::MdFbTripleBuffer *frameBuffer(void);
+
+		/**
+		 * Get and reset the number of frames rendered.
+		 * Used for the FPS counter.
+		 * @return Number of frames rendered since the last call.
+		 */
+		inline int takeFrameCount(void);
+
+		/**
+		 * Acknowledge the frameDone() signal.
+		 * frameDone() isn't emitted again until this is
+		 * called, so slow UI updates don't flood the
+		 * event queue.
+		 */
+		inline void ackFrameDone(void);
+
+		/**
+		 * Set the paused state.
+		 * Must be called on the emulation thread,
+		 * i.e. while processing an emulation request.
+		 * @param paused True to pause; false to resume.
+		 */
+		void setPaused(bool paused);
+
 	signals:
-		void frameDone(bool wasFastFrame);
+		/**
+		 * A frame has been published to the triple buffer.
+		 */
+		void frameDone(void);
 
 	public slots:
-		void resume(bool doFastFrame = false);
+		/**
+		 * Wake the emulation thread so it processes
+		 * new emulation requests, even if it's paused.
+		 */
+		void wake(void);
+
 		void stop(void);
 
 	protected:
 		void run(void);
+
+		/**
+		 * Wait until the specified time.
+		 * @param target Target time, in microseconds.
+		 */
+		void waitUntil(uint64_t target);
+
+		EmuManager *const m_emuManager;
+		LibGens::MdFbTripleBuffer m_frameBuffer;
+
 		QWaitCondition m_wait;
 		QMutex m_mutex;
 
 		bool m_stop;
-		bool m_doFastFrame;
+		bool m_wakePending;
+		bool m_paused;		// Emulation thread only.
+
+		QAtomicInt m_frameCount;
+		QAtomicInt m_frameDonePending;
+
+		/**
+		 * Maximum number of frames to skip before
+		 * resynchronizing with the clock.
+		 */
+		static const int MAX_FRAMESKIP = 8;
 };
 
 /**
@@ -74,6 +152,31 @@ inline bool EmuThread::isStopRequested(void)
 	return ret;
 }
 
+/**
+ * Get the frame triple buffer.
+ * The UI thread is the consumer.
+ * @return Frame triple buffer.
+ */
+inline LibGens::MdFbTripleBuffer *EmuThread::frameBuffer(void)
+	{ return &m_frameBuffer; }
+
+/**
+ * Get and reset the number of frames rendered.
+ * Used for the FPS counter.
+ * @return Number of frames rendered since the last call.
+ */
+inline int EmuThread::takeFrameCount(void)
+	{ return m_frameCount.fetchAndStoreOrdered(0); }
+
+/**
+ * Acknowledge the frameDone() signal.
+ * frameDone() isn't emitted again until this is
+ * called, so slow UI updates don't flood the
+ * event queue.
+ */
+inline void EmuThread::ackFrameDone(void)
+	{ m_frameDonePending.fetchAndStoreOrdered(0); }
+
 }
 
 #endif /* __GENS_QT4_EMUTHREAD_HPP__ */
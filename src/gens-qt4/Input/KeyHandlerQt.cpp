@@ -56,6 +56,7 @@ namespace GensQt4 {
 KeyHandlerQt::KeyHandlerQt(QObject *parent, LibGensKeys::KeyManager *keyManager)
 	: super(parent)
 	, m_keyManager(keyManager)
+	, m_inputQueue(nullptr)
 { }
 
 /**
@@ -64,6 +65,27 @@ KeyHandlerQt::KeyHandlerQt(QObject *parent, LibGensKeys::KeyManager *keyManager)
 KeyHandlerQt::~KeyHandlerQt(void)
 { }
 
+/**
+ * Set the input event queue for sub-frame input.
+ * Key state changes are pushed to this queue
+ * as soon as they're received.
+ * @param inputQueue Input event queue, or nullptr to disable.
+ */
+void KeyHandlerQt::setInputQueue(LibGens::IoManager::InputQueue *inputQueue)
+{
+	m_inputQueue = inputQueue;
+}
+
+/**
+ * Push changed key states to the input event queue.
+ */
+void KeyHandlerQt::pushInputEvents(void)
+{
+	if (m_keyManager && m_inputQueue) {
+		m_keyManager->pushInputEvents(m_inputQueue, m_timing.getTime());
+	}
+}
+
 /**
  * Key press handler.
  * @param event Key event.
@@ -95,6 +117,7 @@ void KeyHandlerQt::keyPressEvent(QKeyEvent *event)
 	// Not an event key. Mark it as pressed.
 	if (m_keyManager) {
 		m_keyManager->keyDown(gensKey);
+		pushInputEvents();
 	}
 }
 
@@ -111,6 +134,7 @@ void KeyHandlerQt::keyReleaseEvent(QKeyEvent *event)
 	int gensKey = QKeyEventToKeyVal(event);
 	if (m_keyManager) {
 		m_keyManager->keyUp(gensKey);
+		pushInputEvents();
 	}
 }
 
@@ -166,6 +190,7 @@ void KeyHandlerQt::mousePressEvent(QMouseEvent *event)
 	// Mark the key as pressed.
 	if (m_keyManager) {
 		m_keyManager->keyDown(KEYV_MOUSE_UNKNOWN + gensButton);
+		pushInputEvents();
 	}
 }
 
@@ -191,6 +216,7 @@ void KeyHandlerQt::mouseReleaseEvent(QMouseEvent *event)
 	// Mark the key as pressed.
 	if (m_keyManager) {
 		m_keyManager->keyUp(KEYV_MOUSE_UNKNOWN + gensButton);
+		pushInputEvents();
 	}
 }
 
@@ -29,6 +29,10 @@
 class QKeyEvent;
 class QMouseEvent;
 
+// LibGens
+#include "libgens/IO/IoManager.hpp"
+#include "libgens/Util/Timing.hpp"
+
 // LibGensKeys
 #include "libgenskeys/GensKey_t.h"
 namespace LibGensKeys {
@@ -54,6 +58,14 @@ class KeyHandlerQt : public QObject
 		LibGensKeys::KeyManager *keyManager(void) const;
 		void setKeyManager(LibGensKeys::KeyManager *keyManager);
 
+		/**
+		 * Set the input event queue for sub-frame input.
+		 * Key state changes are pushed to this queue
+		 * as soon as they're received.
+		 * @param inputQueue Input event queue, or nullptr to disable.
+		 */
+		void setInputQueue(LibGens::IoManager::InputQueue *inputQueue);
+
 		// QKeyEvent to LibGens Key Value.
 		static GensKey_t QKeyEventToKeyVal(QKeyEvent *event);
 		static GensKey_t NativeModifierToKeyVal(QKeyEvent *event);
@@ -80,6 +92,15 @@ class KeyHandlerQt : public QObject
 		// Key Manager.
 		LibGensKeys::KeyManager *m_keyManager;
 
+		// Input event queue.
+		LibGens::IoManager::InputQueue *m_inputQueue;
+		LibGens::Timing m_timing;
+
+		/**
+		 * Push changed key states to the input event queue.
+		 */
+		void pushInputEvents(void);
+
 #if 0
 		// TODO
 		// Last mouse position.
@@ -530,6 +530,9 @@ void GLBackend::glb_paintGL(void)
 			reallocTexture();
 		}
 
+		// Convert indexed lines to RGB, if necessary.
+		m_srcFb->resolve();
+
 		// Screen buffer used for output.
 		const LibGens::MdFb *src_fb = m_intScreen;
 
@@ -47,6 +47,8 @@ const GensMenuShortcutsPrivate::KeyBinding_t GensMenuShortcutsPrivate::KeyBindin
 	{"file/close",			"actionFileCloseROM"},
 	{"file/saveState",		"actionFileSaveState"},
 	{"file/loadState",		"actionFileLoadState"},
+	{"file/captureVgm",		"actionFileCaptureVGM"},
+	{"file/captureWav",		"actionFileCaptureWAV"},
 	{"file/genConfig",		"actionFileGeneralConfiguration"},
 	{"file/mcdControl",		"actionFileSegaCDControlPanel"},
 	{"file/quit",			"actionFileQuit"},
@@ -151,6 +153,8 @@ const GensKey_t GensMenuShortcutsPrivate::DefKeyBindings_gens[KeyBinding_count+1
 	KEYM_CTRL | KEYV_w,		// actionFileCloseROM
 	KEYV_F5,			// actionFileSaveState
 	KEYV_F8,			// actionFileLoadState
+	KEYV_F10,			// actionFileCaptureVGM
+	KEYV_F11,			// actionFileCaptureWAV
 #ifdef Q_WS_MAC
 	KEYM_CTRL | KEYV_COMMA,		// actionFileGeneralConfiguration
 #else
@@ -264,6 +268,8 @@ const GensKey_t GensMenuShortcutsPrivate::DefKeyBindings_kega[KeyBinding_count+1
 	KEYM_SHIFT | KEYV_TAB,		// actionFileCloseROM
 	KEYV_F5,			// actionFileSaveState
 	KEYV_F8,			// actionFileLoadState
+	0,				// actionFileCaptureVGM
+	0,				// actionFileCaptureWAV
 #ifdef Q_WS_MAC
 	KEYM_CTRL | KEYV_COMMA,		// actionFileGeneralConfiguration
 #else
@@ -379,6 +385,8 @@ const GensKey_t GensMenuShortcutsPrivate::DefKeyBindings_regen[KeyBinding_count+
 	KEYM_SHIFT | KEYV_p,		// actionFileCloseROM
 	KEYV_F9,			// actionFileSaveState
 	KEYV_F10,			// actionFileLoadState
+	0,				// actionFileCaptureVGM
+	0,				// actionFileCaptureWAV
 #ifdef Q_WS_MAC
 	KEYM_CTRL | KEYV_COMMA,		// actionFileGeneralConfiguration
 #else
@@ -61,7 +61,7 @@ class GensMenuShortcutsPrivate
 
 		/** Active QAction maps. **/
 
-		static const int KeyBinding_count = 65;
+		static const int KeyBinding_count = 67;
 		struct KeyBinding_t {
 			const char *setting;	// QSettings name.
 			const char *qAction;	// QAction object name.
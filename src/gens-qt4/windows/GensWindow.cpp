@@ -205,6 +205,7 @@ GensWindow::GensWindow(QWidget *parent, Qt::WindowFlags flags)
 	// Initialize the Key Manager and KeyHandlerQt.
 	d->emuManager->setKeyManager(gqt4_cfg->m_keyManager);
 	d->keyHandler = new KeyHandlerQt(this, gqt4_cfg->m_keyManager);
+	d->keyHandler->setInputQueue(d->emuManager->inputQueue());
 
 	// Create the Video Backend.
 	// TODO: Allow selection of all available VBackend classes.
@@ -226,6 +227,8 @@ GensWindow::GensWindow(QWidget *parent, Qt::WindowFlags flags)
 		this, SLOT(osdPrintMsg(int,QString)));
 	QObject::connect(d->emuManager, SIGNAL(osdShowPreview(int,QImage)),
 		this, SLOT(osdShowPreview(int,QImage)));
+	QObject::connect(d->emuManager, SIGNAL(audioCaptureChanged()),
+		this, SLOT(audioCapture_changed_slot()));
 
        // Auto Pause: Application Focus Changed signal, and setting change signal.
        QObject::connect(gqt4_app, SIGNAL(focusChanged(QWidget*,QWidget*)),
@@ -168,6 +168,8 @@ class GensWindow : public QMainWindow
 		void on_actionFileCloseROM_triggered(void);
 		void on_actionFileSaveState_triggered(void);
 		void on_actionFileLoadState_triggered(void);
+		void on_actionFileCaptureVGM_triggered(bool checked);
+		void on_actionFileCaptureWAV_triggered(bool checked);
 		void on_actionFileGeneralConfiguration_triggered(void);
 		void on_actionFileSegaCDControlPanel_triggered(void);
 		void on_actionFileQuit_triggered(void);
@@ -224,6 +226,7 @@ class GensWindow : public QMainWindow
 		void regionCode_changed_slot(const QVariant &regionCode);	// LibGens::SysVersion::RegionCode_t
 		void enableSRam_changed_slot(const QVariant &enableSRam);	// bool
 		void showMenuBar_changed_slot(const QVariant &showMenuBar);	// bool
+		void audioCapture_changed_slot(void);
 };
 
 }
@@ -67,6 +67,18 @@ void GensWindow::on_actionFileLoadState_triggered(void)
 	d->emuManager->loadState();
 }
 
+void GensWindow::on_actionFileCaptureVGM_triggered(bool checked)
+{
+	Q_D(GensWindow);
+	d->emuManager->vgmCapture(checked);
+}
+
+void GensWindow::on_actionFileCaptureWAV_triggered(bool checked)
+{
+	Q_D(GensWindow);
+	d->emuManager->wavCapture(checked);
+}
+
 void GensWindow::on_actionFileGeneralConfiguration_triggered(void)
 {
 	GeneralConfigWindow::ShowSingle(this);
@@ -115,6 +115,9 @@ void GensWindowPrivate::updateMenusForStateChanged(void)
 	ui.actionFileCloseROM->setEnabled(isRomOpen);
 	ui.actionFileSaveState->setEnabled(isRomOpen);
 	ui.actionFileLoadState->setEnabled(isRomOpen);
+	ui.actionFileCaptureVGM->setEnabled(isRomOpen);
+	ui.actionFileCaptureWAV->setEnabled(isRomOpen);
+	syncAudioCapture();
 	ui.actionGraphicsScreenshot->setEnabled(isRomOpen);
 	ui.actionSystemHardReset->setEnabled(isRomOpen);
 	ui.actionSystemSoftReset->setEnabled(isRomOpen);
@@ -141,6 +144,16 @@ void GensWindowPrivate::updateMenusForStateChanged(void)
 	ui.actionSystemResetSSH2->setVisible(false);
 }
 
+/**
+ * Synchronize the audio capture actions.
+ */
+void GensWindowPrivate::syncAudioCapture(void)
+{
+	const bool isRomOpen = (this->emuManager && this->emuManager->isRomOpen());
+	ui.actionFileCaptureVGM->setChecked(isRomOpen && this->emuManager->isVgmCapturing());
+	ui.actionFileCaptureWAV->setChecked(isRomOpen && this->emuManager->isWavCapturing());
+}
+
 /** Menu synchronization slots. **/
 
 /**
@@ -287,4 +300,13 @@ void GensWindow::showMenuBar_changed_slot(const QVariant &showMenuBar)
 	d->updateMenuBarVisibility();
 }
 
+/**
+ * VGM or WAV capture was started or stopped.
+ */
+void GensWindow::audioCapture_changed_slot(void)
+{
+	Q_D(GensWindow);
+	d->syncAudioCapture();
+}
+
 }
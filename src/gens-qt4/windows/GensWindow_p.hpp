@@ -107,6 +107,11 @@ class GensWindowPrivate
 		void stretchMode_changed_slot_int(StretchMode_t stretchMode);
 		void regionCode_changed_slot_int(LibGens::SysVersion::RegionCode_t regionCode);
 		void enableSRam_changed_slot_int(bool enableSRam);
+
+		/**
+		 * Synchronize the audio capture actions.
+		 */
+		void syncAudioCapture(void);
 };
 
 /**
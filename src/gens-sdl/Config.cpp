@@ -188,16 +188,19 @@ std::string getSavestateFilename(const LibGens::Rom *rom, int saveSlot)
 }
 
 /**
- * Take a screenshot.
- * @param fb	[in] MdFb.
- * @param rom	[in] ROM object.
- * @return Screenshot number on success; negative errno on error.
+ * Get the next unused numbered filename for a ROM.
+ * Format: [configDir]/[subdir]/[ROM basename]_[number].[ext]
+ * @param rom		[in] ROM object.
+ * @param subdir	[in] Subdirectory in the configuration directory.
+ * @param ext		[in] File extension, including the leading dot.
+ * @param pNumber	[out,opt] File number.
+ * @return Filename, or empty string on error.
  */
-int doScreenShot(const MdFb *fb, const Rom *rom)
+string getNumberedFilename(const Rom *rom, const char *subdir, const char *ext, int *pNumber)
 {
-	const string configDir = getConfigDir("Screenshots");
-	if (configDir.empty() || !fb || !rom)
-		return -EINVAL;
+	const string configDir = getConfigDir(subdir);
+	if (configDir.empty() || !rom)
+		return string();
 
 	// TODO: Include z_file information?
 	string basename = rom->filename_baseNoExt();
@@ -205,19 +208,40 @@ int doScreenShot(const MdFb *fb, const Rom *rom)
 	romFilename += DIR_SEP_CHR;
 	romFilename += basename;
 
-	// Add the current directory, number, and .png extension.
-	const char scrFilenameSuffix[] = ".png";
-	char scrFilename[260];
-	int scrNumber = -1;
+	// Add the current directory, number, and extension.
+	char filename[260];
+	int number = -1;
 	do {
 		// TODO: Figure out how to optimize this!
-		scrNumber++;
-		snprintf(scrFilename, sizeof(scrFilename), "%s_%03d%s",
-			 romFilename.c_str(), scrNumber, scrFilenameSuffix);
-	} while (!access(scrFilename, F_OK));
+		number++;
+		snprintf(filename, sizeof(filename), "%s_%03d%s",
+			 romFilename.c_str(), number, ext);
+	} while (!access(filename, F_OK));
+
+	if (pNumber) {
+		*pNumber = number;
+	}
+	return string(filename);
+}
+
+/**
+ * Take a screenshot.
+ * @param fb	[in] MdFb.
+ * @param rom	[in] ROM object.
+ * @return Screenshot number on success; negative errno on error.
+ */
+int doScreenShot(const MdFb *fb, const Rom *rom)
+{
+	if (!fb)
+		return -EINVAL;
+
+	int scrNumber;
+	const string scrFilename = getNumberedFilename(rom, "Screenshots", ".png", &scrNumber);
+	if (scrFilename.empty())
+		return -EINVAL;
 
 	// Take the screenshot.
-	int ret = Screenshot::toFile(scrFilename, fb, rom);
+	int ret = Screenshot::toFile(scrFilename.c_str(), fb, rom);
 	return (ret == 0 ? scrNumber : ret);
 }
 
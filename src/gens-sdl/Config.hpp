@@ -54,6 +54,18 @@ std::string getConfigDir(const char *subdir = nullptr);
  */
 std::string getSavestateFilename(const LibGens::Rom *rom, int saveSlot);
 
+/**
+ * Get the next unused numbered filename for a ROM.
+ * Format: [configDir]/[subdir]/[ROM basename]_[number].[ext]
+ * @param rom		[in] ROM object.
+ * @param subdir	[in] Subdirectory in the configuration directory.
+ * @param ext		[in] File extension, including the leading dot.
+ * @param pNumber	[out,opt] File number.
+ * @return Filename, or empty string on error.
+ */
+std::string getNumberedFilename(const LibGens::Rom *rom,
+	const char *subdir, const char *ext, int *pNumber = nullptr);
+
 /**
  * Take a screenshot.
  * @param fb	[in] MdFb.
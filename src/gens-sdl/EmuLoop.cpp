@@ -43,16 +43,26 @@ using GensSdl::VBackend;
 #include "libgens/Util/MdFb.hpp"
 #include "libgens/Vdp/Vdp.hpp"
 #include "libgens/EmuContext/SysVersion.hpp"
+#include "libgens/sound/SoundMgr.hpp"
 using LibGens::Rom;
 using LibGens::MdFb;
 using LibGens::Vdp;
 using LibGens::SysVersion;
+using LibGens::SoundMgr;
 
 // Emulation Context.
 #include "libgens/EmuContext/EmuContext.hpp"
 #include "libgens/EmuContext/EmuContextFactory.hpp"
+#include "libgens/EmuContext/SaveStateWorker.hpp"
+#include "libgens/EmuContext/SaveSlotCache.hpp"
+#include "libgens/EmuContext/InputMovie.hpp"
+#include "libgens/EmuContext/StateHash.hpp"
 using LibGens::EmuContext;
 using LibGens::EmuContextFactory;
+using LibGens::SaveStateWorker;
+using LibGens::SaveSlotCache;
+using LibGens::InputMovie;
+using LibGens::StateHash;
 
 // LibGensKeys
 #include "libgens/IO/IoManager.hpp"
@@ -63,20 +73,21 @@ using LibGens::IoManager;
 using LibGensKeys::KeyManager;
 
 // LibZomg
-#include "libzomg/Zomg.hpp"
 #include "libzomg/img_data.h"
-using LibZomg::ZomgBase;
-using LibZomg::Zomg;
 
 // Command line parameters.
 #include "Options.hpp"
 
 // C includes. (C++ namespace)
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 
 // C++ includes.
 #include <string>
+#include <vector>
 using std::string;
+using std::vector;
 
 #include "EventLoop_p.hpp"
 namespace GensSdl {
@@ -103,6 +114,19 @@ class EmuLoopPrivate : public EventLoopPrivate
 		// Save slot.
 		int saveSlot_selected;
 
+		// Savestates are compressed and written
+		// on a background thread.
+		SaveStateWorker saveStateWorker;
+
+		// Save slot metadata, so switching slots
+		// doesn't have to open the savestates.
+		SaveSlotCache saveSlotCache;
+
+		// Input movie.
+		InputMovie movie;
+		uint64_t movie_start;	// Playback start time.
+		bool movie_desync;	// True if a desync was detected.
+
 		// Keymaps.
 		static const GensKey_t keyMap_md[];
 		static const GensKey_t keyMap_pico[];
@@ -114,10 +138,10 @@ class EmuLoopPrivate : public EventLoopPrivate
 
 		/**
 		 * Get the modification time string for the specified save file.
-		 * @param zomg Save file.
+		 * @param zomg_mtime Save file's modification time.
 		 * @return String contianing the mtime, or an error message if invalid.
 		 */
-		static string getSaveSlot_mtime(const LibZomg::ZomgBase *zomg);
+		static string getSaveSlot_mtime(time_t zomg_mtime);
 
 		/**
 		 * Save slot selection.
@@ -132,9 +156,16 @@ class EmuLoopPrivate : public EventLoopPrivate
 
 		/**
 		 * Save the state in the selected slot.
+		 * The state is written on a background thread.
 		 */
 		void doSaveState(void);
 
+		/**
+		 * Show OSD messages for savestates that
+		 * have been written by the background thread.
+		 */
+		void checkSaveStates(void);
+
 		/**
 		 * Change stretch mode parameters.
 		 */
@@ -145,12 +176,61 @@ class EmuLoopPrivate : public EventLoopPrivate
 		 */
 		void doScreenShot(void);
 
+		/**
+		 * Start or stop VGM capture.
+		 */
+		void doVgmCapture(void);
+
+		/**
+		 * Start or stop WAV capture.
+		 */
+		void doWavCapture(void);
+
+		/**
+		 * Start or stop AVI capture.
+		 */
+		void doAviCapture(void);
+
+		/**
+		 * Stop AVI capture if an error occurred,
+		 * e.g. if the file size limit was reached.
+		 */
+		void checkAviCapture(void);
+
 		/**
 		 * Update the window title information.
 		 * This uses the system abbreviation
 		 * and the ROM name.
 		 */
 		void updateWinTitleInfo(void);
+
+		/**
+		 * Is an input movie being played back?
+		 * If so, the emulator is controlled by the movie,
+		 * and controller input, resets, and savestate loads
+		 * are ignored.
+		 * @return True if a movie is being played back.
+		 */
+		inline bool isPlayingMovie(void) const
+			{ return (movie.mode() == InputMovie::MODE_PLAY); }
+
+		/**
+		 * Compute the state hash for the input movie.
+		 * @return State hash.
+		 */
+		uint32_t movieStateHash(void) const;
+
+		/**
+		 * Start an input movie frame.
+		 * Call this before running a frame.
+		 */
+		void beginMovieFrame(void);
+
+		/**
+		 * Finish an input movie frame.
+		 * Call this after running a frame.
+		 */
+		void endMovieFrame(void);
 };
 
 /** EmuLoopPrivate **/
@@ -175,6 +255,8 @@ EmuLoopPrivate::EmuLoopPrivate()
 	, emuContext(nullptr)
 	, keyManager(nullptr)
 	, saveSlot_selected(0)
+	, movie_start(0)
+	, movie_desync(false)
 {
 	last_paused.data = 0;
 }
@@ -188,10 +270,10 @@ EmuLoopPrivate::~EmuLoopPrivate()
 
 /**
  * Get the modification time string for the specified save file.
- * @param zomg Save file.
+ * @param zomg_mtime Save file's modification time.
  * @return String contianing the mtime, or an error message if invalid.
  */
-string EmuLoopPrivate::getSaveSlot_mtime(const ZomgBase *zomg)
+string EmuLoopPrivate::getSaveSlot_mtime(time_t zomg_mtime)
 {
 	// TODO: This function can probably be optimized more...
 
@@ -202,7 +284,6 @@ string EmuLoopPrivate::getSaveSlot_mtime(const ZomgBase *zomg)
 	// TODO: mtime=0 is invalid.
 	bool doFullTimestamp = false;
 	time_t cur_time = time(nullptr);
-	time_t zomg_mtime = zomg->mtime();
 
 	// zomg_mtime is needed for printing.
 	// TODO: Custom localtime_r() if system version isn't available?
@@ -260,46 +341,41 @@ void EmuLoopPrivate::doSaveSlot(int saveSlot)
 		return;
 	saveSlot_selected = saveSlot;
 
-	// Metadata variables.
+	// Make sure the savestate isn't still being written.
+	// checkSaveStates() invalidates the slot if it was.
+	saveStateWorker.wait();
+	checkSaveStates();
+
+	// Get the slot metadata.
+	// This usually doesn't have to access the savestate.
 	string slot_state;
-	Zomg_Img_Data_t img_data;
-	img_data.data = nullptr;
-
-	// Check if the specified savestate exists.
-	// TODO: R_OK or just F_OK?
-	string filename = getSavestateFilename(rom, saveSlot);
-	if (!access(filename.c_str(), F_OK)) {
-		// Savestate exists.
-		// Load some file information.
-		LibZomg::Zomg zomg(filename.c_str(), Zomg::ZOMG_LOAD);
-		if (!zomg.isOpen()) {
-			// Error opening the savestate.
-			slot_state = "error";
-		} else {
-			// Get the slot mtime.
-			slot_state = getSaveSlot_mtime(&zomg);
-
-			// Get the preview image.
-			// TODO: Rename loadPreview() to loadPreviewImage()?
-			int ret = zomg.loadPreview(&img_data);
-			if (ret != 0) {
-				// Image load failed.
-				// TODO: Ensure all reading functions
-				// called by loadPreview() free the
-				// memory on error.
-				img_data.data = nullptr;
-			}
-		}
+	SaveSlotCache::SlotInfo info;
+	info.img.data = nullptr;
+	if (saveSlotCache.slotInfo(saveSlot, &info) != 0) {
+		// Slot metadata isn't available.
+		slot_state = "error";
 	} else {
-		// Savestate does not exist.
-		slot_state = "empty";
+		switch (info.status) {
+			case SaveSlotCache::SLOT_EMPTY:
+			default:
+				// Savestate does not exist.
+				slot_state = "empty";
+				break;
+			case SaveSlotCache::SLOT_ERROR:
+				// Error opening the savestate.
+				slot_state = "error";
+				break;
+			case SaveSlotCache::SLOT_OCCUPIED:
+				// Get the slot mtime.
+				slot_state = getSaveSlot_mtime(info.mtime);
+				break;
+		}
 	}
 
 	// Show an OSD message.
 	vBackend->osd_printf(1500, "Slot %d [%s]", saveSlot, slot_state.c_str());
-	// If img_data.data is nullptr, this will hide the current image.
-	vBackend->osd_preview_image(1500, &img_data);
-	free(img_data.data);
+	// If info.img.data is nullptr, this will hide the current image.
+	vBackend->osd_preview_image(1500, &info.img);
 }
 
 /**
@@ -311,6 +387,10 @@ void EmuLoopPrivate::doLoadState(void)
 	if (saveSlot_selected < 0 || saveSlot_selected > 9)
 		return;
 
+	// Make sure the savestate isn't still being written.
+	saveStateWorker.wait();
+	checkSaveStates();
+
 	string filename = getSavestateFilename(rom, saveSlot_selected);
 	int ret = emuContext->zomgLoad(filename.c_str());
 	if (ret == 0) {
@@ -334,6 +414,7 @@ void EmuLoopPrivate::doLoadState(void)
 
 /**
  * Save the state in the selected slot.
+ * The state is written on a background thread.
  */
 void EmuLoopPrivate::doSaveState(void)
 {
@@ -341,14 +422,12 @@ void EmuLoopPrivate::doSaveState(void)
 	if (saveSlot_selected < 0 || saveSlot_selected > 9)
 		return;
 
+	// Snapshot the state here; compression and file writes
+	// are done by the worker. checkSaveStates() shows the
+	// OSD message once the file has been written.
 	string filename = getSavestateFilename(rom, saveSlot_selected);
-	int ret = emuContext->zomgSave(filename.c_str());
-	if (ret == 0) {
-		// State saved.
-		vBackend->osd_printf(1500,
-				"Slot %d saved.",
-				saveSlot_selected);
-	} else {
+	int ret = saveStateWorker.save(emuContext, filename.c_str(), saveSlot_selected);
+	if (ret != 0) {
 		// Error saving state.
 		vBackend->osd_printf(1500,
 				"Error saving Slot %d:\n* %s",
@@ -356,6 +435,31 @@ void EmuLoopPrivate::doSaveState(void)
 	}
 }
 
+/**
+ * Show OSD messages for savestates that
+ * have been written by the background thread.
+ */
+void EmuLoopPrivate::checkSaveStates(void)
+{
+	SaveStateWorker::Result result;
+	while (saveStateWorker.poll(&result)) {
+		// The slot's cached metadata is out of date.
+		saveSlotCache.invalidate(result.id);
+
+		if (result.ret == 0) {
+			// State saved.
+			vBackend->osd_printf(1500,
+					"Slot %d saved.",
+					result.id);
+		} else {
+			// Error saving state.
+			vBackend->osd_printf(1500,
+					"Error saving Slot %d:\n* %s",
+					result.id, strerror(-result.ret));
+		}
+	}
+}
+
 /**
  * Change stretch mode parameters.
  */
@@ -403,6 +507,118 @@ void EmuLoopPrivate::doScreenShot(void)
 	}
 }
 
+/**
+ * Start or stop VGM capture.
+ */
+void EmuLoopPrivate::doVgmCapture(void)
+{
+	if (SoundMgr::IsVgmCapturing()) {
+		int ret = SoundMgr::StopVgmCapture();
+		if (ret == 0) {
+			vBackend->osd_print(1500, "VGM capture stopped.");
+		} else {
+			vBackend->osd_printf(1500,
+				"Error saving VGM file:\n* %s", strerror(-ret));
+		}
+		return;
+	}
+
+	int vgmNumber;
+	const string filename = GensSdl::getNumberedFilename(rom, "VGM", ".vgm", &vgmNumber);
+	int ret = (filename.empty() ? -EINVAL : SoundMgr::StartVgmCapture(filename.c_str()));
+	if (ret == 0) {
+		vBackend->osd_printf(1500, "VGM capture %d started.", vgmNumber);
+	} else {
+		vBackend->osd_printf(1500,
+			"Error starting VGM capture:\n* %s", strerror(-ret));
+	}
+}
+
+/**
+ * Start or stop WAV capture.
+ */
+void EmuLoopPrivate::doWavCapture(void)
+{
+	if (SoundMgr::IsWavCapturing()) {
+		int ret = SoundMgr::StopWavCapture();
+		if (ret == 0) {
+			vBackend->osd_print(1500, "WAV capture stopped.");
+		} else {
+			vBackend->osd_printf(1500,
+				"Error saving WAV file:\n* %s", strerror(-ret));
+		}
+		return;
+	}
+
+	int wavNumber;
+	const string filename = GensSdl::getNumberedFilename(rom, "WAV", ".wav", &wavNumber);
+	int ret = (filename.empty() ? -EINVAL : SoundMgr::StartWavCapture(filename.c_str()));
+	if (ret == 0) {
+		vBackend->osd_printf(1500, "WAV capture %d started.", wavNumber);
+	} else {
+		vBackend->osd_printf(1500,
+			"Error starting WAV capture:\n* %s", strerror(-ret));
+	}
+}
+
+/**
+ * Start or stop AVI capture.
+ */
+void EmuLoopPrivate::doAviCapture(void)
+{
+	if (sdlHandler->is_video_capturing()) {
+		const unsigned int dropped = sdlHandler->video_capture_dropped();
+		int ret = sdlHandler->stop_video_capture();
+		if (ret == 0) {
+			if (dropped == 0) {
+				vBackend->osd_print(1500, "AVI capture stopped.");
+			} else {
+				vBackend->osd_printf(1500,
+					"AVI capture stopped.\n* %u frame(s) dropped.", dropped);
+			}
+		} else {
+			vBackend->osd_printf(1500,
+				"Error saving AVI file:\n* %s", strerror(-ret));
+		}
+		return;
+	}
+
+	int aviNumber;
+	const string filename = GensSdl::getNumberedFilename(rom, "AVI", ".avi", &aviNumber);
+	int ret = (filename.empty() ? -EINVAL :
+		sdlHandler->start_video_capture(filename.c_str(), framerate));
+	if (ret == 0) {
+		vBackend->osd_printf(1500, "AVI capture %d started.", aviNumber);
+	} else {
+		vBackend->osd_printf(1500,
+			"Error starting AVI capture:\n* %s", strerror(-ret));
+	}
+}
+
+/**
+ * Stop AVI capture if an error occurred,
+ * e.g. if the file size limit was reached.
+ */
+void EmuLoopPrivate::checkAviCapture(void)
+{
+	if (!sdlHandler->is_video_capturing())
+		return;
+	const int err = sdlHandler->video_capture_error();
+	if (err == 0)
+		return;
+
+	// The file is still valid up to the error,
+	// so close() only reports the same error.
+	sdlHandler->stop_video_capture();
+	if (err == -EFBIG) {
+		vBackend->osd_print(1500,
+			"AVI capture stopped:\n* The AVI file size limit (4 GB) was reached.");
+	} else {
+		vBackend->osd_printf(1500,
+			"AVI capture stopped:\n* %s", strerror(-err));
+	}
+}
+
 /**
  * Update the window title information.
  * This uses the system abbreviation
@@ -484,6 +700,100 @@ void EmuLoopPrivate::updateWinTitleInfo(void)
 	updateWindowTitle(winTitle.c_str());
 }
 
+/**
+ * Compute the state hash for the input movie.
+ * @return State hash.
+ */
+uint32_t EmuLoopPrivate::movieStateHash(void) const
+{
+	// NOTE: The framebuffer and audio aren't hashed,
+	// since they depend on the video and audio settings.
+	StateHash hash;
+	emuContext->stateHash(&hash);
+	return hash.combined();
+}
+
+/**
+ * Start an input movie frame.
+ * Call this before running a frame.
+ */
+void EmuLoopPrivate::beginMovieFrame(void)
+{
+	if (movie.mode() == InputMovie::MODE_NONE)
+		return;
+
+	if (movie.frame() == 0) {
+		movie_start = clks.timing.getTime();
+	}
+
+	const int events = movie.beginFrame(EmuContext::m_ioManager);
+	if (events < 0) {
+		// Error reading the movie.
+		fprintf(stderr, "Error playing movie at frame %u: %s\n",
+			movie.frame(), strerror(-events));
+		movie_desync = true;
+		running = false;
+		return;
+	}
+
+	// Apply the events in the documented order.
+	if (events & InputMovie::EVENT_REGION) {
+		const SysVersion::RegionCode_t region = movie.region();
+		emuContext->setRegion(region);
+		const bool isPal = (region == SysVersion::REGION_EU_PAL ||
+				    region == SysVersion::REGION_ASIA_PAL);
+		setFrameTiming(isPal ? 50 : 60);
+	}
+	if (events & InputMovie::EVENT_HARD_RESET) {
+		emuContext->hardReset();
+	}
+	if (events & InputMovie::EVENT_SOFT_RESET) {
+		emuContext->softReset();
+	}
+}
+
+/**
+ * Finish an input movie frame.
+ * Call this after running a frame.
+ */
+void EmuLoopPrivate::endMovieFrame(void)
+{
+	switch (movie.mode()) {
+		case InputMovie::MODE_RECORD:
+			if (!movie.endFrame(movieStateHash())) {
+				// Write error.
+				int ret = movie.close();
+				vBackend->osd_printf(1500,
+					"Error recording movie:\n* %s",
+					strerror(ret != 0 ? -ret : EIO));
+			}
+			break;
+
+		case InputMovie::MODE_PLAY: {
+			if (!movie.endFrame(movieStateHash()) && !movie_desync) {
+				// First desync.
+				fprintf(stderr, "Movie desync at frame %d.\n", movie.desyncFrame());
+				vBackend->osd_printf(1500, "Movie desync at frame %d.", movie.desyncFrame());
+				movie_desync = true;
+			}
+
+			if (movie.isFinished()) {
+				// Playback is finished.
+				const double secs = (double)(clks.timing.getTime() - movie_start) / 1000000.0;
+				const unsigned int frames = movie.frame();
+				fprintf(stderr, "Movie playback finished: %u frames in %0.3f s (%0.1f fps)%s\n",
+					frames, secs, (secs > 0 ? frames / secs : 0.0),
+					(movie_desync ? "; desynced." : "; no desyncs."));
+				running = false;
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
 /** EmuLoop **/
 
 EmuLoop::EmuLoop()
@@ -509,13 +819,18 @@ int EmuLoop::processSdlEvent(const SDL_Event *event) {
 			switch (event->key.keysym.sym) {
 				case SDLK_TAB:
 					// Check for Shift.
-					if (event->key.keysym.mod & (KMOD_LSHIFT | KMOD_RSHIFT)) {
+					if (d->isPlayingMovie()) {
+						// Resets are controlled by the movie.
+						d->vBackend->osd_print(1500, "Can't reset during movie playback.");
+					} else if (event->key.keysym.mod & (KMOD_LSHIFT | KMOD_RSHIFT)) {
 						// Hard Reset.
 						d->emuContext->hardReset();
+						d->movie.recordHardReset();
 						d->vBackend->osd_print(1500, "Hard Reset.");
 					} else {
 						// Soft Reset.
 						d->emuContext->softReset();
+						d->movie.recordSoftReset();
 						d->vBackend->osd_print(1500, "Soft Reset.");
 					}
 					break;
@@ -570,7 +885,27 @@ int EmuLoop::processSdlEvent(const SDL_Event *event) {
 
 				case SDLK_F8:
 					// Load state.
-					d->doLoadState();
+					if (d->movie.mode() != InputMovie::MODE_NONE) {
+						// Loading a state would break the movie.
+						d->vBackend->osd_print(1500, "Can't load states while a movie is active.");
+					} else {
+						d->doLoadState();
+					}
+					break;
+
+				case SDLK_F10:
+					// Start or stop VGM capture.
+					d->doVgmCapture();
+					break;
+
+				case SDLK_F11:
+					if (event->key.keysym.mod & (KMOD_LSHIFT | KMOD_RSHIFT)) {
+						// Start or stop AVI capture.
+						d->doAviCapture();
+					} else {
+						// Start or stop WAV capture.
+						d->doWavCapture();
+					}
 					break;
 
 				default: {
@@ -666,6 +1001,13 @@ int EmuLoop::run(const Options *options)
 		d->isPico = true;
 	}
 
+	// Load the save slot metadata in the background.
+	vector<string> saveSlot_filenames;
+	for (int i = 0; i < SaveSlotCache::MAX_SLOTS; i++) {
+		saveSlot_filenames.push_back(getSavestateFilename(d->rom, i));
+	}
+	d->saveSlotCache.setFilenames(saveSlot_filenames);
+
 	// Set the SRAM/EEPROM path.
 	EmuContext::SetPathSRam(getConfigDir("SRAM").c_str());
 
@@ -677,8 +1019,25 @@ int EmuLoop::run(const Options *options)
 		EmuContext::SetTmssEnabled(true);
 	}
 
-	// Detect the ROM region.
+	// Open the input movie for playback.
+	// The movie's region code overrides the command line.
 	SysVersion::RegionCode_t region = options->region();
+	const string play_movie = options->play_movie();
+	if (!play_movie.empty()) {
+		int ret = d->movie.play(play_movie.c_str());
+		if (ret != 0) {
+			fprintf(stderr, "Error opening movie file %s: %s\n",
+				play_movie.c_str(), strerror(-ret));
+			return EXIT_FAILURE;
+		}
+		if (d->movie.romCrc32() != d->rom->rom_crc32()) {
+			fprintf(stderr, "WARNING: Movie %s was recorded with a different ROM.\n",
+				play_movie.c_str());
+		}
+		region = d->movie.region();
+	}
+
+	// Detect the ROM region.
 	SysVersion::RegionCode_t region_auto = SysVersion::REGION_AUTO;
 	if (region == SysVersion::REGION_AUTO) {
 		// Auto-detect the region code.
@@ -709,12 +1068,45 @@ int EmuLoop::run(const Options *options)
 	Vdp *vdp = d->emuContext->m_vdp;
 	vdp->options.spriteLimits = options->sprite_limits();
 
+	// Set up the input movie's starting state.
+	// Power-on is the state of the new EmuContext.
+	const string record_movie = options->record_movie();
+	const string movie_state = (!record_movie.empty()
+		? options->movie_state() : d->movie.zomgFilename());
+	if (!record_movie.empty() || d->isPlayingMovie()) {
+		// Movies start with cleared SRAM/EEPROM, and they
+		// must not modify the user's save file. Otherwise,
+		// playback would depend on the save file.
+		d->emuContext->unloadSaveData();
+	}
+	if (!movie_state.empty()) {
+		int ret = d->emuContext->zomgLoad(movie_state.c_str());
+		if (ret != 0) {
+			fprintf(stderr, "Error loading movie savestate %s: %s\n",
+				movie_state.c_str(), strerror(-ret));
+			return EXIT_FAILURE;
+		}
+	}
+	if (!record_movie.empty()) {
+		int ret = d->movie.record(record_movie.c_str(), d->rom->rom_crc32(), region,
+			(!movie_state.empty() ? movie_state.c_str() : nullptr));
+		if (ret != 0) {
+			fprintf(stderr, "Error creating movie file %s: %s\n",
+				record_movie.c_str(), strerror(-ret));
+			return EXIT_FAILURE;
+		}
+	}
+
 	// Initialize the SDL handlers.
 	d->sdlHandler = new SdlHandler();
-	if (d->sdlHandler->init_video() < 0)
+	if (d->sdlHandler->init_video(options->upscale_filter(), options->upscale()) < 0)
 		return EXIT_FAILURE;
 	if (d->sdlHandler->init_audio(options->sound_freq(), options->stereo()) < 0)
 		return EXIT_FAILURE;
+	if (options->native_rate()) {
+		// Render audio at the YM2612's native rate.
+		SoundMgr::SetNativeRate(true, true);
+	}
 	d->vBackend = d->sdlHandler->vBackend();
 
 	// Check for startup messages.
@@ -761,6 +1153,7 @@ int EmuLoop::run(const Options *options)
 	// Set the color depth.
 	MdFb *fb = d->emuContext->m_vdp->MD_Screen->ref();
 	fb->setBpp(options->bpp());
+	fb->setIndexed(options->indexed_fb());
 
 	// Set the SDL video source.
 	d->sdlHandler->set_video_source(fb);
@@ -782,6 +1175,19 @@ int EmuLoop::run(const Options *options)
 		d->keyManager->setIoType(IoManager::VIRTPORT_2, IoManager::IOT_NONE);
 	}
 
+	// Input movie status.
+	if (d->movie.mode() == InputMovie::MODE_RECORD) {
+		d->vBackend->osd_print(1500, "Movie recording started.");
+	} else if (d->isPlayingMovie()) {
+		d->vBackend->osd_print(1500, "Movie playback started.");
+	}
+
+	// Unthrottled mode disables frame timing.
+	d->frameskip = !options->unthrottled();
+	if (options->turbo()) {
+		d->doTurbo();
+	}
+
 	// TODO: Move some more common stuff back to gens-sdl.cpp.
 	d->running = true;
 	d->paused.data = 0;
@@ -794,6 +1200,12 @@ int EmuLoop::run(const Options *options)
 			break;
 		}
 
+		// Check for completed savestates.
+		d->checkSaveStates();
+
+		// Check if AVI capture was stopped by an error.
+		d->checkAviCapture();
+
 		// Check if the 'paused' state was changed.
 		// If it was, autosave SRAM/EEPROM.
 		if (d->last_paused.data != d->paused.data) {
@@ -802,7 +1214,7 @@ int EmuLoop::run(const Options *options)
 			// TODO: Evaluate both fields as boolean,
 			// so switching from manual to manual+auto
 			// or vice-versa doesn't trigger an autosave?
-			d->emuContext->autoSaveData(-1);
+			d->emuContext->autoSaveData();
 			d->last_paused.data = d->paused.data;
 		}
 
@@ -819,17 +1231,41 @@ int EmuLoop::run(const Options *options)
 		// EventLoop::runFrame() handles frameskip timing.
 		runFrame();
 
-		// Autosave SRAM/EEPROM.
-		// TODO: EmuContext::execFrame() should probably do this itself...
-		d->emuContext->autoSaveData(1);
+		// NOTE: SRAM/EEPROM autosave is handled by
+		// LibGens::SaveDataWriter's background thread.
 
 		// Update the I/O manager.
-		d->keyManager->updateIoManager(d->emuContext->m_ioManager);
+		// During movie playback, the movie controls the I/O manager.
+		if (!d->isPlayingMovie()) {
+			d->keyManager->updateIoManager(d->emuContext->m_ioManager);
+		}
 	}
 
 	// Unreference the framebuffer.
 	fb->unref();
 
+	// Stop audio capture.
+	SoundMgr::StopVgmCapture();
+	SoundMgr::StopWavCapture();
+
+	// Stop video capture.
+	d->sdlHandler->stop_video_capture();
+
+	// Finish the input movie.
+	if (d->movie.mode() == InputMovie::MODE_RECORD) {
+		const unsigned int frames = d->movie.frame();
+		int ret = d->movie.close();
+		if (ret == 0) {
+			fprintf(stderr, "Movie recorded: %u frames.\n", frames);
+		} else {
+			fprintf(stderr, "Error recording movie: %s\n", strerror(-ret));
+		}
+	}
+	d->movie.close();
+
+	// Finish writing savestates.
+	d->saveStateWorker.wait();
+
 	// Save SRAM/EEPROM, if necessary.
 	// TODO: Move to EmuContext::~EmuContext()?
 	d->emuContext->saveData();
@@ -855,7 +1291,9 @@ int EmuLoop::run(const Options *options)
 	d->vBackend = nullptr;
 
 	// Done running the emulation loop.
-	return 0;
+	// A movie desync is reported as a failure
+	// so scripted benchmarks can detect it.
+	return (d->movie_desync ? EXIT_FAILURE : 0);
 }
 
 /**
@@ -867,7 +1305,9 @@ int EmuLoop::run(const Options *options)
 void EmuLoop::runFullFrame(void)
 {
 	EmuLoopPrivate *const d = d_func();
+	d->beginMovieFrame();
 	d->emuContext->execFrame();
+	d->endMovieFrame();
 }
 
 /**
@@ -879,7 +1319,9 @@ void EmuLoop::runFullFrame(void)
 void EmuLoop::runFastFrame(void)
 {
 	EmuLoopPrivate *const d = d_func();
+	d->beginMovieFrame();
 	d->emuContext->execFrameFast();
+	d->endMovieFrame();
 }
 
 }
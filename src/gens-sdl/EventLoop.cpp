@@ -63,12 +63,16 @@ EventLoopPrivate::EventLoopPrivate()
 	, exposed(false)
 	, lastF1time(0)
 	, usec_per_frame(0)
+	, framerate(0)
 	, win_title("Gens/GS II [SDL]")
 {
 	paused.data = 0;
 
 	// Default to 60 fps.
 	setFrameTiming(60);
+
+	turbo.enabled = false;
+	turbo.reset(clks.start_clk);
 }
 
 EventLoopPrivate::~EventLoopPrivate()
@@ -109,7 +113,11 @@ void EventLoopPrivate::doPauseProcessing(void)
 	}
 
 	// Reset the clocks and counters.
+	// The turbo render interval is kept, but the
+	// paused time shouldn't count towards the speed.
 	clks.reset();
+	turbo.period_clk = clks.start_clk;
+	turbo.period_frames = 0;
 	// Pause audio.
 	sdlHandler->pause_audio(any);
 
@@ -173,6 +181,68 @@ void EventLoopPrivate::doAboutMessage(void)
        lastF1time = curTime;
 }
 
+/**
+ * Toggle turbo mode.
+ */
+void EventLoopPrivate::doTurbo(void)
+{
+	turbo.enabled = !turbo.enabled;
+
+	// Reset the clocks so normal frame timing
+	// doesn't try to catch up after turbo mode.
+	clks.reset();
+	turbo.reset(clks.start_clk);
+
+	// Show an OSD message.
+	if (turbo.enabled) {
+		vBackend->osd_print(1500, "Turbo mode enabled.");
+	} else {
+		vBackend->osd_print(1500, "Turbo mode disabled.");
+	}
+
+	// Update the window title.
+	updateWindowTitle();
+}
+
+/**
+ * Update the turbo mode speed measurement.
+ * Call this after each frame in turbo mode.
+ * The render interval is retuned and the
+ * speed is shown on the OSD periodically.
+ */
+void EventLoopPrivate::updateTurbo(void)
+{
+	// Measurement period, in microseconds.
+	static const unsigned int TURBO_PERIOD = 500000;
+
+	// NOTE: clks.new_clk is sampled before the frame is run,
+	// but period_frames includes the current frame, so the
+	// time has to be sampled again after the frame.
+	turbo.period_frames++;
+	const uint64_t now = clks.timing.getTime();
+	const uint64_t elapsed = now - turbo.period_clk;
+	if (elapsed < TURBO_PERIOD)
+		return;
+
+	// Emulated frames per second, relative to the system's frame rate.
+	const double fps = (turbo.period_frames * 1000000.0) / elapsed;
+	turbo.speed = fps / framerate;
+
+	// Render one frame out of every N, where N is the
+	// speed multiplier, so the display is updated at
+	// the system's frame rate. Fast frames are cheaper
+	// than rendered frames, so this converges over a
+	// few periods.
+	turbo.interval = (unsigned int)(turbo.speed + 0.5);
+	if (turbo.interval == 0)
+		turbo.interval = 1;
+
+	turbo.period_clk = now;
+	turbo.period_frames = 0;
+
+	vBackend->osd_printf(TURBO_PERIOD / 1000, "Turbo: %0.1fx", turbo.speed);
+}
+
 /**
  * Set frame timing.
  * This resets the frameskip timers.
@@ -180,6 +250,7 @@ void EventLoopPrivate::doAboutMessage(void)
  */
 void EventLoopPrivate::setFrameTiming(int framerate)
 {
+	this->framerate = framerate;
 	usec_per_frame = (1000000 / framerate);
 	clks.reset();
 }
@@ -197,6 +268,13 @@ void EventLoopPrivate::updateWindowTitle(void)
 	// prefix the window title.
 	const char *paused_prefix = (paused.manual ? "[Paused] " : "");
 
+	// If turbo mode is enabled, show the speed multiplier.
+	char turbo_prefix[32];
+	turbo_prefix[0] = 0;
+	if (turbo.enabled && turbo.speed > 0.0) {
+		snprintf(turbo_prefix, sizeof(turbo_prefix), "[Turbo %0.1fx] ", turbo.speed);
+	}
+
 #ifdef GENS_ENABLE_EMULATION
 #define NOEMU_PREFIX
 #else /* !GENS_ENABLE_EMULATION */
@@ -205,14 +283,14 @@ void EventLoopPrivate::updateWindowTitle(void)
 
 	if (clks.fps > 0) {
 		snprintf(title, sizeof(title),
-			 NOEMU_PREFIX "%s%s (%u fps)",
-			 paused_prefix,
+			 NOEMU_PREFIX "%s%s%s (%u fps)",
+			 paused_prefix, turbo_prefix,
 			 this->win_title.c_str(),
 			 clks.fps);
 	} else {
 		snprintf(title, sizeof(title),
-			 NOEMU_PREFIX "%s%s",
-			 paused_prefix,
+			 NOEMU_PREFIX "%s%s%s",
+			 paused_prefix, turbo_prefix,
 			 this->win_title.c_str());
 	}
 
@@ -306,6 +384,11 @@ int EventLoop::processSdlEvent(const SDL_Event *event)
 					d_ptr->doFastBlur();
 					break;
 
+				case SDLK_BACKQUOTE:
+					// Turbo mode.
+					d_ptr->doTurbo();
+					break;
+
 				case SDLK_F12:
 					// FIXME: TEMPORARY KEY BINDING for debugging.
 					d_ptr->vBackend->setAspectRatioConstraint(!d_ptr->vBackend->aspectRatioConstraint());
@@ -439,6 +522,25 @@ void EventLoop::runFrame(void)
 		d_ptr->updateWindowTitle();
 	}
 
+	if (d_ptr->turbo.enabled) {
+		// Turbo mode. Run frames as fast as possible,
+		// and only render every Nth frame.
+		if (++d_ptr->turbo.counter >= d_ptr->turbo.interval) {
+			d_ptr->turbo.counter = 0;
+			runFullFrame();
+			d_ptr->sdlHandler->update_audio(true);
+			d_ptr->sdlHandler->update_video();
+			// Increment the frame counter.
+			d_ptr->clks.frames++;
+		} else {
+			// Run a frame without rendering.
+			runFastFrame();
+			d_ptr->sdlHandler->update_audio(true);
+		}
+		d_ptr->updateTurbo();
+		return;
+	}
+
 	// Frameskip.
 	if (d_ptr->frameskip) {
 		// Determine how many frames to run.
@@ -98,6 +98,11 @@ class EventLoopPrivate
 		 */
 		void doAboutMessage(void);
 
+		/**
+		 * Toggle turbo mode.
+		 */
+		void doTurbo(void);
+
 	public:
 		/** SDL handler and video backend. **/
 		SdlHandler *sdlHandler;
@@ -161,6 +166,46 @@ class EventLoopPrivate
 		};
 		clks_t clks;
 
+		// Turbo mode.
+		// Frame pacing is disabled and audio is muted.
+		// Only every Nth frame is rendered, with N tuned
+		// so the display is updated at the system's frame rate.
+		class turbo_t {
+			public:
+				// Reset the turbo counters.
+				void reset(uint64_t clk) {
+					interval = 1;
+					counter = 0;
+					period_clk = clk;
+					period_frames = 0;
+					speed = 0.0;
+				}
+
+				bool enabled;
+
+				// Render every Nth frame.
+				unsigned int interval;
+				// Frames run since the last rendered frame.
+				unsigned int counter;
+
+				// Current measurement period.
+				uint64_t period_clk;
+				unsigned int period_frames;
+
+				// Speed multiplier for the last period,
+				// relative to the system's frame rate.
+				double speed;
+		};
+		turbo_t turbo;
+
+		/**
+		 * Update the turbo mode speed measurement.
+		 * Call this after each frame in turbo mode.
+		 * The render interval is retuned and the
+		 * speed is shown on the OSD periodically.
+		 */
+		void updateTurbo(void);
+
 		// Last time the F1 message was displayed.
 		// This is here to prevent the user from spamming
 		// the display with the message.
@@ -168,6 +213,8 @@ class EventLoopPrivate
 
 		// Microseconds per frame.
 		unsigned int usec_per_frame;
+		// Frame rate, e.g. 50 or 60.
+		int framerate;
 
 		/**
 		 * Set frame timing.
@@ -69,6 +69,9 @@ class GLBackendPrivate {
 
 		// OpenGL texture.
 		GLTex tex;
+		// If true, the entire texture must be uploaded,
+		// regardless of which MdFb lines are dirty.
+		bool texNeedsFullUpload;
 
 		// Texture rectangle.
 		GLdouble texRectF[4][2];
@@ -126,6 +129,7 @@ class GLBackendPrivate {
 GLBackendPrivate::GLBackendPrivate(GLBackend *q)
 	: q(q)
 	, lastBpp(MdFb::BPP_MAX)
+	, texNeedsFullUpload(true)
 	, prevMD_W(0), prevMD_H(0)
 	, prevStretchMode(VBackend::STRETCH_MAX)
 	, prevAspectRatioConstraint(true)
@@ -189,6 +193,7 @@ void GLBackendPrivate::reallocTexture(void)
 
 	// Allocate the GL texture.
 	tex.alloc(format, fb->pxPerLine(), fb->numLines());
+	texNeedsFullUpload = true;
 
 	// Recalculate the texture rectangle.
 	recalcTexRectF();
@@ -433,20 +438,47 @@ void GLBackend::update(bool fb_dirty)
 			d->reallocTexture();
 		}
 
+		// Convert indexed lines to RGB, if necessary.
+		m_fb->resolve();
+
 		// Apply software framebuffer effects.
 		const MdFb *fb = d->applySoftwareEffects();
 
+		// Software effects modify the entire framebuffer,
+		// so only upload dirty lines if none are in use.
+		if (fb != m_fb || isForceFbDirty()) {
+			d->texNeedsFullUpload = true;
+		}
+
 		// Get the screen buffer.
-		const GLvoid *screen;
+		const uint8_t *screen;
+		int bytesPerLine;
 		if (fb->bpp() != MdFb::BPP_32) {
-			screen = fb->fb16();
+			screen = (const uint8_t*)fb->fb16();
+			bytesPerLine = fb->pxPitch() * sizeof(uint16_t);
+		} else {
+			screen = (const uint8_t*)fb->fb32();
+			bytesPerLine = fb->pxPitch() * sizeof(uint32_t);
+		}
+
+		if (d->texNeedsFullUpload) {
+			// (Re-)Upload the entire texture.
+			d->tex.subImage2D(fb->pxPerLine(), fb->numLines(),
+					fb->pxPitch(), screen);
+			d->texNeedsFullUpload = false;
 		} else {
-			screen = fb->fb32();
+			// Upload the dirty lines.
+			int count;
+			for (int y = fb->nextDirtyRange(0, &count); y >= 0;
+			     y = fb->nextDirtyRange(y + count, &count))
+			{
+				d->tex.subImage2D(y, fb->pxPerLine(), count,
+						fb->pxPitch(), screen + (y * bytesPerLine));
+			}
 		}
 
-		// (Re-)Upload the texture.
-		d->tex.subImage2D(fb->pxPerLine(), fb->numLines(),
-				fb->pxPitch(), screen);
+		// All lines have been uploaded.
+		m_fb->clearDirty();
 	}
 
 	// Bind the texture.
@@ -216,6 +216,20 @@ void GLTex::dealloc(void)
  * @param data Image data.
  */
 void GLTex::subImage2D(int w, int h, int pxPitch, const void *data)
+{
+	subImage2D(0, w, h, pxPitch, data);
+}
+
+/**
+ * Upload a range of lines.
+ * Image data must be in the format allocated in alloc().
+ * @param y First line.
+ * @param w Width.
+ * @param h Number of lines.
+ * @param pxPitch Pitch, in pixels.
+ * @param data Image data, starting at line y.
+ */
+void GLTex::subImage2D(int y, int w, int h, int pxPitch, const void *data)
 {
 	glEnable(GL_TEXTURE_2D);
 	glBindTexture(GL_TEXTURE_2D, name);
@@ -227,7 +241,7 @@ void GLTex::subImage2D(int w, int h, int pxPitch, const void *data)
 
 	// Upload the sub-image.
 	glTexSubImage2D(GL_TEXTURE_2D, 0,
-			0, 0,		// x/y offset
+			0, y,		// x/y offset
 			w, h,		// width/height
 			this->format, this->type, data);
 
@@ -24,6 +24,10 @@
 // LibGens
 using LibGens::MdFb;
 using LibGens::SysVersion;
+using LibGens::Upscaler;
+
+// LibZomg
+using LibZomg::Zomg;
 
 // C includes. (C++ namespace)
 #include <cstring>
@@ -70,24 +74,39 @@ class OptionsPrivate
 		// TODO: Convert to bool to make access faster?
 		string rom_filename;		// ROM to load.
 		string tmss_rom_filename;	// TMSS ROM image.
+		int rom_cache_size;		// ROM cache size, in MB. (0 to disable)
+		Zomg::SaveProfile savestate_compression;	// Savestate compression profile.
 
 		// Audio options.
 		int sound_freq;			// Sound frequency.
 		int stereo;			// Stereo audio?
+		int native_rate;		// Render at the YM2612's native rate?
 
 		// Emulation options.
 		int sprite_limits;		// Enable sprite limits?
 		int auto_fix_checksum;		// Auto fix checksum?
 		SysVersion::RegionCode_t region;	// Region code.
+		int unthrottled;		// Run as fast as possible?
+		int turbo;			// Start in turbo mode?
+
+		// Input movie options.
+		string record_movie;		// Movie to record.
+		string play_movie;		// Movie to play back.
+		string movie_state;		// Savestate to start recording from.
 
 		// UI options.
 		int fps_counter;		// Enable FPS counter?
 		int auto_pause;			// Auto pause?
 		int paused_effect;		// Paused effect?
 		MdFb::ColorDepth bpp;		// Color depth. (15, 16, 32)
+		int indexed_fb;			// Indexed color framebuffer?
+		Upscaler::Filter upscale_filter;	// CPU upscaler filter.
+		int upscale;			// CPU upscaler scale factor. (1 if disabled)
 
 		// Special run modes.
 		int run_crazy_effect;		// Run the Crazy Effect
+		string prewarm_rom_cache;	// Directory to store in the ROM cache.
+		string scan_roms;		// Directory to add to the ROM index.
 };
 
 /** OptionsPrivate **/
@@ -108,24 +127,39 @@ void OptionsPrivate::reset(void)
 	// TODO: Swap with empty strings?
 	rom_filename.clear();
 	tmss_rom_filename.clear();
+	rom_cache_size = 512;
+	savestate_compression = Zomg::SAVE_PROFILE_DEFAULT;
 
 	// Audio options.
 	sound_freq = 44100;
 	stereo = true;
+	native_rate = false;
 
 	// Emulation options.
 	sprite_limits = true;
 	auto_fix_checksum = false;
 	region = SysVersion::REGION_AUTO;
+	unthrottled = false;
+	turbo = false;
+
+	// Input movie options.
+	record_movie.clear();
+	play_movie.clear();
+	movie_state.clear();
 
 	// UI options.
 	fps_counter = true;
 	auto_pause = false;
 	paused_effect = true;
 	bpp = MdFb::BPP_32;
+	indexed_fb = false;
+	upscale_filter = Upscaler::UF_NEAREST;
+	upscale = 1;
 
 	// Special run modes.
 	run_crazy_effect = false;
+	prewarm_rom_cache.clear();
+	scan_roms.clear();
 }
 
 /** Options **/
@@ -207,7 +241,14 @@ int Options::parse(int argc, const char *argv[])
 	struct {
 		const char *rom_filename;
 		const char *tmss_rom_filename;
+		const char *prewarm_rom_cache;
+		const char *scan_roms;
 		const char *region;
+		const char *savestate_compression;
+		const char *upscale;
+		const char *record_movie;
+		const char *play_movie;
+		const char *movie_state;
 		int bpp;
 	} tmp;
 	memset(&tmp, 0, sizeof(tmp));
@@ -232,6 +273,10 @@ int Options::parse(int argc, const char *argv[])
 			"  Use monaural audio.", NULL},
 		{"stereo", '\0', POPT_ARG_VAL, &d->stereo, 1,
 			"  Use stereo audio.", NULL},
+		{"native-rate", '\0', POPT_ARG_VAL, &d->native_rate, 1,
+			"  Render audio at the YM2612's native rate and resample it.", NULL},
+		{"no-native-rate", '\0', POPT_ARG_VAL, &d->native_rate, 0,
+			"* Render audio at the output rate.", NULL},
 		POPT_TABLEEND
 	};
 
@@ -247,6 +292,23 @@ int Options::parse(int argc, const char *argv[])
 			"* Don't automatically fix checksums.", NULL},
 		{"region", '\0', POPT_ARG_STRING, &tmp.region, 0,
 			"  Set the region code: J,U,E,Asia,Auto (default is auto)", "REGION"},
+		{"unthrottled", '\0', POPT_ARG_VAL, &d->unthrottled, 1,
+			"  Run as fast as possible instead of at the system's frame rate.", NULL},
+		{"throttled", '\0', POPT_ARG_VAL, &d->unthrottled, 0,
+			"* Run at the system's frame rate.", NULL},
+		{"turbo", '\0', POPT_ARG_VAL, &d->turbo, 1,
+			"  Start in turbo mode. (toggle with `)", NULL},
+		POPT_TABLEEND
+	};
+
+	// popt: input movie options table.
+	struct poptOption movieOptionsTable[] = {
+		{"record-movie", '\0', POPT_ARG_STRING, &tmp.record_movie, 0,
+			"  Record controller input to a movie file.", "FILENAME"},
+		{"movie-state", '\0', POPT_ARG_STRING, &tmp.movie_state, 0,
+			"  Start recording from a savestate instead of power-on.", "FILENAME"},
+		{"play-movie", '\0', POPT_ARG_STRING, &tmp.play_movie, 0,
+			"  Play back a movie file, verify its state hashes, then exit.", "FILENAME"},
 		POPT_TABLEEND
 	};
 
@@ -266,6 +328,13 @@ int Options::parse(int argc, const char *argv[])
 			"  Don't tint the window when paused.", NULL},
 		{"bpp", '\0', POPT_ARG_INT, &tmp.bpp, 0,
 			"  Set the internal color depth. (15, 16, 32)", "BPP"},
+		{"indexed-fb", '\0', POPT_ARG_VAL, &d->indexed_fb, 1,
+			"  Render palette indexes and convert them in the video backend.", NULL},
+		{"no-indexed-fb", '\0', POPT_ARG_VAL, &d->indexed_fb, 0,
+			"* Render RGB pixels directly.", NULL},
+		{"upscale", '\0', POPT_ARG_STRING, &tmp.upscale, 0,
+			"  Upscale on the CPU and use the software renderer:\n"
+			"  none,nearest2x,nearest3x,nearest4x,scale2x,scale3x,xbr2x (default is none)", "FILTER"},
 		POPT_TABLEEND
 	};
 
@@ -273,6 +342,10 @@ int Options::parse(int argc, const char *argv[])
 	struct poptOption runModesTable[] = {
 		{"crazy-effect", '\0', POPT_ARG_VAL, &d->run_crazy_effect, 1,
 			"  Run the \"Crazy\" Effect instead of loading a ROM.", NULL},
+		{"prewarm-rom-cache", '\0', POPT_ARG_STRING, &tmp.prewarm_rom_cache, 0,
+			"  Store all compressed ROMs in a directory in the ROM cache, then exit.", "DIR"},
+		{"scan-roms", '\0', POPT_ARG_STRING, &tmp.scan_roms, 0,
+			"  Add all ROMs in a directory tree to the ROM index, then exit.", "DIR"},
 		POPT_TABLEEND
 	};
 
@@ -280,12 +353,18 @@ int Options::parse(int argc, const char *argv[])
 	struct poptOption optionsTable[] = {
 		{"tmss-rom", '\0', POPT_ARG_STRING, &tmp.tmss_rom_filename, 0,
 			"TMSS ROM filename.", "FILENAME"},
+		{"rom-cache-size", '\0', POPT_ARG_INT, &d->rom_cache_size, 0,
+			"Maximum size of the decompressed ROM cache, in MB. (0 to disable; default is 512)", "MB"},
+		{"savestate-compression", '\0', POPT_ARG_STRING, &tmp.savestate_compression, 0,
+			"Savestate compression: store,fast,default,best (default is default)", "PROFILE"},
 		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, audioOptionsTable, 0,
 			"Audio options: (* indicates default)", NULL},
 		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, emulationOptionsTable, 0,
 			"Emulation options: (* indicates default)", NULL},
 		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, uiOptionsTable, 0,
 			"UI options: (* indicates default)", NULL},
+		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, movieOptionsTable, 0,
+			"Input movie options:", NULL},
 		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, runModesTable, 0,
 			"Special run modes:", NULL},
 		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, helpOptionsTable, 0,
@@ -379,6 +458,90 @@ int Options::parse(int argc, const char *argv[])
 		d->tmss_rom_filename = string(tmp.tmss_rom_filename);
 	}
 
+	// ROM cache.
+	if (d->rom_cache_size < 0) {
+		// Invalid ROM cache size.
+		fprintf(stderr, "%s: '--rom-cache-size=%d': invalid ROM cache size\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], d->rom_cache_size, argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+	if (tmp.prewarm_rom_cache != nullptr) {
+		// Prewarm the ROM cache.
+		d->prewarm_rom_cache = string(tmp.prewarm_rom_cache);
+	}
+	if (tmp.scan_roms != nullptr) {
+		// Scan a ROM directory.
+		d->scan_roms = string(tmp.scan_roms);
+	}
+
+	// Savestate compression.
+	if (tmp.savestate_compression != nullptr) {
+		if (!strcasecmp(tmp.savestate_compression, "store") ||
+		    !strcasecmp(tmp.savestate_compression, "none"))
+		{
+			d->savestate_compression = Zomg::SAVE_PROFILE_STORE;
+		}
+		else if (!strcasecmp(tmp.savestate_compression, "fast"))
+		{
+			d->savestate_compression = Zomg::SAVE_PROFILE_FAST;
+		}
+		else if (!strcasecmp(tmp.savestate_compression, "default"))
+		{
+			d->savestate_compression = Zomg::SAVE_PROFILE_DEFAULT;
+		}
+		else if (!strcasecmp(tmp.savestate_compression, "best"))
+		{
+			d->savestate_compression = Zomg::SAVE_PROFILE_BEST;
+		}
+		else
+		{
+			// Invalid compression profile.
+			fprintf(stderr, "%s: '--savestate-compression=%s': invalid compression profile\n"
+				"Valid options are store, fast, default, and best.\n"
+				"Try `%s --help` for more information.\n",
+				argv[0], tmp.savestate_compression, argv[0]);
+			poptFreeContext(optCon);
+			return -EINVAL;
+		}
+	}
+
+	// CPU upscaler.
+	if (tmp.upscale != nullptr) {
+		static const struct {
+			const char *name;
+			Upscaler::Filter filter;
+			int scale;
+		} upscale_tbl[] = {
+			{"none",	Upscaler::UF_NEAREST, 1},
+			{"nearest2x",	Upscaler::UF_NEAREST, 2},
+			{"nearest3x",	Upscaler::UF_NEAREST, 3},
+			{"nearest4x",	Upscaler::UF_NEAREST, 4},
+			{"scale2x",	Upscaler::UF_SCALEX, 2},
+			{"scale3x",	Upscaler::UF_SCALEX, 3},
+			{"xbr2x",	Upscaler::UF_XBR, 2},
+		};
+
+		int i;
+		const int count = (int)(sizeof(upscale_tbl) / sizeof(upscale_tbl[0]));
+		for (i = 0; i < count; i++) {
+			if (!strcasecmp(tmp.upscale, upscale_tbl[i].name))
+				break;
+		}
+		if (i >= count) {
+			// Invalid upscaler.
+			fprintf(stderr, "%s: '--upscale=%s': invalid upscaler\n"
+				"Valid options are none, nearest2x, nearest3x, nearest4x, scale2x, scale3x, and xbr2x.\n"
+				"Try `%s --help` for more information.\n",
+				argv[0], tmp.upscale, argv[0]);
+			poptFreeContext(optCon);
+			return -EINVAL;
+		}
+		d->upscale_filter = upscale_tbl[i].filter;
+		d->upscale = upscale_tbl[i].scale;
+	}
+
 	// Region code.
 	if (tmp.region != nullptr) {
 		// Region code specified.
@@ -427,6 +590,33 @@ int Options::parse(int argc, const char *argv[])
 		}
 	}
 
+	// Input movies.
+	if (tmp.record_movie != nullptr && tmp.play_movie != nullptr) {
+		// Can't record and play back at the same time.
+		fprintf(stderr, "%s: '--record-movie' and '--play-movie' can't be used together\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+	if (tmp.movie_state != nullptr && tmp.record_movie == nullptr) {
+		// Starting savestate without recording.
+		fprintf(stderr, "%s: '--movie-state' requires '--record-movie'\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+	if (tmp.record_movie != nullptr) {
+		d->record_movie = string(tmp.record_movie);
+	}
+	if (tmp.play_movie != nullptr) {
+		d->play_movie = string(tmp.play_movie);
+	}
+	if (tmp.movie_state != nullptr) {
+		d->movie_state = string(tmp.movie_state);
+	}
+
 	// Verify certain options.
 	d->bpp = MdFb::bppToColorDepth(tmp.bpp);
 	if (d->bpp < 0 || d->bpp >= MdFb::BPP_MAX) {
@@ -450,9 +640,12 @@ int Options::parse(int argc, const char *argv[])
 	if (tmp.rom_filename != nullptr) {
 		// ROM filename was specified.
 		d->rom_filename = string(tmp.rom_filename);
-	} else if (d->rom_filename_required && !d->run_crazy_effect) {
+	} else if (d->rom_filename_required && !d->run_crazy_effect &&
+		   d->prewarm_rom_cache.empty() && d->scan_roms.empty())
+	{
 		// A ROM is required, but wasn't specified.
-		// (If --crazy-effect is specified, this is ignored.)
+		// (If --crazy-effect, --prewarm-rom-cache,
+		// or --scan-roms is specified, this is ignored.)
 		fprintf(stderr, "%s: no ROM filename specified\n"
 			"Try `%s --help` for more information.\n",
 			argv[0], argv[0]);
@@ -512,6 +705,8 @@ bool Options::name(void) const \
 /** General options. **/
 ACCESSOR(string, rom_filename)
 ACCESSOR(string, tmss_rom_filename)
+ACCESSOR(int, rom_cache_size)
+ACCESSOR(Zomg::SaveProfile, savestate_compression)
 
 /**
  * Is TMSS enabled?
@@ -526,19 +721,32 @@ bool Options::is_tmss_enabled(void) const
 /** Audio options. **/
 ACCESSOR(int, sound_freq)
 ACCESSOR_BOOL(stereo)
+ACCESSOR_BOOL(native_rate)
 
 /** Emulation options. **/
 ACCESSOR_BOOL(sprite_limits)
 ACCESSOR_BOOL(auto_fix_checksum)
 ACCESSOR(SysVersion::RegionCode_t, region);
+ACCESSOR_BOOL(unthrottled)
+ACCESSOR_BOOL(turbo)
+
+/** Input movie options. **/
+ACCESSOR(string, record_movie)
+ACCESSOR(string, play_movie)
+ACCESSOR(string, movie_state)
 
 /** UI options. **/
 ACCESSOR_BOOL(fps_counter)
 ACCESSOR_BOOL(auto_pause)
 ACCESSOR_BOOL(paused_effect)
 ACCESSOR(MdFb::ColorDepth, bpp)
+ACCESSOR_BOOL(indexed_fb)
+ACCESSOR(Upscaler::Filter, upscale_filter)
+ACCESSOR(int, upscale)
 
 /** Special run modes. **/
 ACCESSOR_BOOL(run_crazy_effect)
+ACCESSOR(string, prewarm_rom_cache)
+ACCESSOR(string, scan_roms)
 
 }
@@ -24,8 +24,12 @@
 
 // LibGens
 #include "libgens/Util/MdFb.hpp"
+#include "libgens/Effects/Upscaler.hpp"
 #include "libgens/EmuContext/SysVersion.hpp"
 
+// LibZomg
+#include "libzomg/Zomg.hpp"
+
 // C++ includes.
 #include <string>
 
@@ -96,6 +100,18 @@ class Options
 		 */
 		bool is_tmss_enabled(void) const;
 
+		/**
+		 * Maximum size of the decompressed ROM cache.
+		 * @return ROM cache size, in MB. (0 if disabled)
+		 */
+		int rom_cache_size(void) const;
+
+		/**
+		 * Savestate compression profile.
+		 * @return Savestate compression profile.
+		 */
+		LibZomg::Zomg::SaveProfile savestate_compression(void) const;
+
 		/** Audio options. **/
 
 		/**
@@ -110,6 +126,12 @@ class Options
 		 */
 		bool stereo(void) const;
 
+		/**
+		 * Render audio at the YM2612's native rate?
+		 * @return True to render at the native rate and resample.
+		 */
+		bool native_rate(void) const;
+
 		/** Emulation options. **/
 
 		/**
@@ -130,6 +152,40 @@ class Options
 		 */
 		LibGens::SysVersion::RegionCode_t region(void) const;
 
+		/**
+		 * Run as fast as possible?
+		 * @return True to run unthrottled; false to run at the system's frame rate.
+		 */
+		bool unthrottled(void) const;
+
+		/**
+		 * Start in turbo mode?
+		 * Turbo mode runs as fast as possible, only renders
+		 * enough frames to update the display, and mutes audio.
+		 * @return True to start in turbo mode; false to start normally.
+		 */
+		bool turbo(void) const;
+
+		/** Input movie options. **/
+
+		/**
+		 * Movie to record.
+		 * @return Movie filename, or empty string if not recording.
+		 */
+		std::string record_movie(void) const;
+
+		/**
+		 * Movie to play back.
+		 * @return Movie filename, or empty string if not playing.
+		 */
+		std::string play_movie(void) const;
+
+		/**
+		 * Savestate to start recording from.
+		 * @return Savestate filename, or empty string to start from power-on.
+		 */
+		std::string movie_state(void) const;
+
 		/** UI options. **/
 
 		/**
@@ -156,6 +212,26 @@ class Options
 		 */
 		LibGens::MdFb::ColorDepth bpp(void) const;
 
+		/**
+		 * Render to an indexed color framebuffer?
+		 * @return True to use indexed color; false to render RGB directly.
+		 */
+		bool indexed_fb(void) const;
+
+		/**
+		 * CPU upscaler filter.
+		 * Only used if upscale() is greater than 1.
+		 * @return CPU upscaler filter.
+		 */
+		LibGens::Upscaler::Filter upscale_filter(void) const;
+
+		/**
+		 * CPU upscaler scale factor.
+		 * If greater than 1, the software renderer is used.
+		 * @return Scale factor, or 1 if the CPU upscaler is disabled.
+		 */
+		int upscale(void) const;
+
 		/** Special run modes. **/
 
 		/**
@@ -163,6 +239,18 @@ class Options
 		 * @return True to run the Crazy Effect.
 		 */
 		bool run_crazy_effect(void) const;
+
+		/**
+		 * Store all compressed ROMs in a directory in the ROM cache?
+		 * @return Directory to store in the ROM cache, or empty string to run normally.
+		 */
+		std::string prewarm_rom_cache(void) const;
+
+		/**
+		 * Add all ROMs in a directory tree to the ROM index?
+		 * @return Directory to scan, or empty string to run normally.
+		 */
+		std::string scan_roms(void) const;
 };
 
 }
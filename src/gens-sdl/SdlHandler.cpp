@@ -42,10 +42,12 @@ namespace GensSdl {
 
 SdlHandler::SdlHandler()
 	: m_vBackend(nullptr)
+	, m_videoSource(nullptr)
 	, m_framesRendered(0)
 	, m_audioDevice(0)
 	, m_audioBuffer(nullptr)
 	, m_sampleSize(0)
+	, m_freq(0)
 	, m_stereo(false)
 	, m_segBuffer(nullptr)
 	, m_segBufferLen(0)
@@ -55,16 +57,20 @@ SdlHandler::SdlHandler()
 SdlHandler::~SdlHandler()
 {
 	// Shut. Down. EVERYTHING.
+	stop_video_capture();
 	end_video();
 	end_audio();
 }
 
 /**
  * Initialize SDL video.
- * TODO: Parameter for GL rendering.
+ * If upscale is greater than 1, the software renderer is
+ * used with a CPU upscaler; otherwise, OpenGL is used.
+ * @param upscaleFilter CPU upscaler filter.
+ * @param upscale CPU upscaler scale factor.
  * @return 0 on success; non-zero on error.
  */
-int SdlHandler::init_video(void)
+int SdlHandler::init_video(LibGens::Upscaler::Filter upscaleFilter, int upscale)
 {
 	if (m_vBackend) {
 		// Video is already initialized.
@@ -81,8 +87,22 @@ int SdlHandler::init_video(void)
 	}
 
 	// Initialize the video backend.
-	// TODO: Fullscreen; GL vs. SW selection; VSync.
-	m_vBackend = new SdlGLBackend();
+	// TODO: Fullscreen; VSync.
+	if (upscale > 1) {
+		// CPU upscaler. Use the software renderer.
+		SdlSWBackend *swBackend = new SdlSWBackend();
+		ret = swBackend->set_upscaler(upscaleFilter, upscale);
+		if (ret < 0) {
+			fprintf(stderr, "%s: unsupported upscaler: %d\n",
+				__func__, ret);
+			delete swBackend;
+			m_vBackend = nullptr;
+			return ret;
+		}
+		m_vBackend = swBackend;
+	} else {
+		m_vBackend = new SdlGLBackend();
+	}
 	return 0;
 }
 
@@ -116,6 +136,7 @@ void SdlHandler::set_window_title(const char *title)
  */
 void SdlHandler::set_video_source(MdFb *fb)
 {
+	m_videoSource = fb;
 	if (m_vBackend) {
 		m_vBackend->set_video_source(fb);
 	}
@@ -232,6 +253,7 @@ int SdlHandler::init_audio(int freq, bool stereo)
 	}
 
 	// Determine the sample size.
+	m_freq = actual_spec.freq;
 	m_stereo = stereo;
 	m_sampleSize = (stereo ? 4 : 2);
 
@@ -294,6 +316,7 @@ void SdlHandler::end_audio(void)
 	delete m_audioBuffer;
 	m_audioBuffer = nullptr;
 	m_sampleSize = 0;
+	m_freq = 0;
 	aligned_free(m_segBuffer);
 	m_segBuffer = nullptr;
 	m_segBufferLen = 0;
@@ -324,8 +347,11 @@ void SdlHandler::sdl_audio_callback(void *userdata, uint8_t *stream, int len)
 
 /**
  * Update SDL audio using SoundMgr.
+ * If video capture is enabled, the audio segment
+ * and the current video source are also captured.
+ * @param mute If true, the audio segment is captured but not played.
  */
-void SdlHandler::update_audio(void)
+void SdlHandler::update_audio(bool mute)
 {
 	// TODO: If !m_audioDevice, just clear the internal
 	// audio buffer instead of writing it.
@@ -340,12 +366,80 @@ void SdlHandler::update_audio(void)
 	}
 
 	// Write to the ringbuffer.
-	if (m_audioDevice > 0 && samples > 0) {
+	if (m_audioDevice > 0 && samples > 0 && !mute) {
 		const int bytes = samples * m_sampleSize;
 		SDL_LockAudioDevice(m_audioDevice);
 		m_audioBuffer->write(reinterpret_cast<const uint8_t*>(m_segBuffer), bytes);
 		SDL_UnlockAudioDevice(m_audioDevice);
 	}
+
+	// Capture the frame.
+	// This is called once per emulated frame, so
+	// audio and video stay in sync.
+	// NOTE: The capture never blocks. If the encoder
+	// falls behind, frames are dropped.
+	if (m_videoCapture.isOpen()) {
+		if (samples > 0) {
+			m_videoCapture.pushAudio(m_segBuffer, samples);
+		}
+		if (m_videoSource) {
+			m_videoCapture.pushFrame(m_videoSource);
+		}
+	}
+}
+
+/**
+ * Start video capture.
+ * update_audio() captures one frame per call,
+ * so frameskipped frames are captured, too.
+ * @param filename AVI file.
+ * @param framerate Frame rate, e.g. 50 or 60.
+ * @return 0 on success; negative errno on error.
+ */
+int SdlHandler::start_video_capture(const char *filename, int framerate)
+{
+	// If audio isn't initialized, capture video only.
+	const int freq = (m_audioDevice > 0 ? m_freq : 0);
+	return m_videoCapture.open(filename, framerate, 1, freq, (m_stereo ? 2 : 1));
+}
+
+/**
+ * Stop video capture.
+ * @return 0 on success; negative errno on error.
+ */
+int SdlHandler::stop_video_capture(void)
+{
+	return m_videoCapture.close();
+}
+
+/**
+ * Is video being captured?
+ * @return True if video is being captured.
+ */
+bool SdlHandler::is_video_capturing(void) const
+{
+	return m_videoCapture.isOpen();
+}
+
+/**
+ * Get the number of frames dropped by the video capture.
+ * @return Number of frames dropped.
+ */
+unsigned int SdlHandler::video_capture_dropped(void) const
+{
+	return m_videoCapture.framesDropped();
+}
+
+/**
+ * Get the video capture error.
+ * If the AVI file size limit is reached,
+ * this returns -EFBIG, and the capture
+ * should be stopped.
+ * @return 0 if no error occurred; negative errno on error.
+ */
+int SdlHandler::video_capture_error(void) const
+{
+	return m_videoCapture.error();
 }
 
 }
@@ -32,6 +32,8 @@
 #include <SDL.h>
 
 #include "libgens/Util/MdFb.hpp"
+#include "libgens/Effects/Upscaler.hpp"
+#include "libgens/Util/VideoCapture.hpp"
 #include "libgenskeys/GensKey_t.h"
 
 // TODO: Minimum gcc version, other compilers?
@@ -62,10 +64,14 @@ class SdlHandler {
 	public:
 		/**
 		 * Initialize SDL video.
-		 * TODO: Parameter for GL rendering.
+		 * If upscale is greater than 1, the software renderer is
+		 * used with a CPU upscaler; otherwise, OpenGL is used.
+		 * @param upscaleFilter CPU upscaler filter.
+		 * @param upscale CPU upscaler scale factor.
 		 * @return 0 on success; non-zero on error.
 		 */
-		int init_video(void);
+		int init_video(LibGens::Upscaler::Filter upscaleFilter = LibGens::Upscaler::UF_NEAREST,
+			       int upscale = 1);
 
 		/**
 		 * Shut down SDL video.
@@ -140,8 +146,48 @@ class SdlHandler {
 
 		/**
 		 * Update SDL audio using SoundMgr.
+		 * If video capture is enabled, the audio segment
+		 * and the current video source are also captured.
+		 * @param mute If true, the audio segment is captured but not played.
 		 */
-		void update_audio(void);
+		void update_audio(bool mute = false);
+
+		/**
+		 * Start video capture.
+		 * update_audio() captures one frame per call,
+		 * so frameskipped frames are captured, too.
+		 * @param filename AVI file.
+		 * @param framerate Frame rate, e.g. 50 or 60.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int start_video_capture(const char *filename, int framerate);
+
+		/**
+		 * Stop video capture.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int stop_video_capture(void);
+
+		/**
+		 * Is video being captured?
+		 * @return True if video is being captured.
+		 */
+		bool is_video_capturing(void) const;
+
+		/**
+		 * Get the number of frames dropped by the video capture.
+		 * @return Number of frames dropped.
+		 */
+		unsigned int video_capture_dropped(void) const;
+
+		/**
+		 * Get the video capture error.
+		 * If the AVI file size limit is reached,
+		 * this returns -EFBIG, and the capture
+		 * should be stopped.
+		 * @return 0 if no error occurred; negative errno on error.
+		 */
+		int video_capture_error(void) const;
 
 		/**
 		 * Convert an SDL2 scancode to a Gens keycode.
@@ -162,6 +208,10 @@ class SdlHandler {
 	private:
 		// Video backend.
 		VBackend *m_vBackend;
+		// Video source.
+		LibGens::MdFb *m_videoSource;
+		// Video capture.
+		LibGens::VideoCapture m_videoCapture;
 
 		// Frames rendered.
 		int m_framesRendered;
@@ -170,6 +220,7 @@ class SdlHandler {
 		SDL_AudioDeviceID m_audioDevice;
 		RingBuffer *m_audioBuffer;
 		int m_sampleSize;
+		int m_freq;
 		bool m_stereo;
 
 		// Segment buffer.
@@ -23,9 +23,15 @@
 
 #include "libgens/Util/MdFb.hpp"
 using LibGens::MdFb;
+using LibGens::Upscaler;
 
 // C includes. (C++ namespace)
 #include <cassert>
+#include <cerrno>
+
+// C++ includes.
+#include <vector>
+using std::vector;
 
 #include <SDL.h>
 #include <SDL_syswm.h>
@@ -62,6 +68,15 @@ class SdlSWBackendPrivate
 		// Last color depth.
 		MdFb::ColorDepth lastBpp;
 
+		// If true, the entire texture must be updated,
+		// regardless of which MdFb lines are dirty.
+		bool texNeedsFullUpdate;
+
+		// CPU upscaler.
+		Upscaler::Filter upscaleFilter;
+		int upscale;			// Scale factor. (1 if disabled)
+		vector<uint8_t> upscaleBuf;	// Upscaled image.
+
 	public:
 		/**
 		 * (Re-)Initialize the texture.
@@ -69,6 +84,14 @@ class SdlSWBackendPrivate
 		 * Otherwise, BPP_32 is used.
 		 */
 		void reinitTexture(void);
+
+		/**
+		 * Upscale a range of lines and upload them to the texture.
+		 * @param pitch Pitch of upscaleBuf, in bytes.
+		 * @param first First source line.
+		 * @param count Number of source lines.
+		 */
+		void upscaleLines(int pitch, int first, int count);
 };
 
 /** SdlSWBackendPrivate **/
@@ -79,6 +102,9 @@ SdlSWBackendPrivate::SdlSWBackendPrivate(SdlSWBackend *q)
 	, renderer(nullptr)
 	, texture(nullptr)
 	, lastBpp(MdFb::BPP_MAX)
+	, texNeedsFullUpdate(true)
+	, upscaleFilter(Upscaler::UF_NEAREST)
+	, upscale(1)
 {
 	// lastBpp is initialized to MdFb::BPP_MAX in order to
 	// ensure that the texture is initialized. If it's set
@@ -132,11 +158,34 @@ void SdlSWBackendPrivate::reinitTexture(void)
 	}
 
 	// Create the texture.
+	// If the CPU upscaler is enabled, the texture
+	// has to hold the upscaled image.
 	texture = SDL_CreateTexture(renderer, format,
 			SDL_TEXTUREACCESS_STREAMING,
-			320, 240);
+			320 * upscale, 240 * upscale);
 	// Save the last color depth.
 	lastBpp = bpp;
+	texNeedsFullUpdate = true;
+}
+
+/**
+ * Upscale a range of lines and upload them to the texture.
+ * @param pitch Pitch of upscaleBuf, in bytes.
+ * @param first First source line.
+ * @param count Number of source lines.
+ */
+void SdlSWBackendPrivate::upscaleLines(int pitch, int first, int count)
+{
+	Upscaler::DoUpscaleLines(upscaleBuf.data(), pitch, q->m_fb,
+				 upscaleFilter, upscale, first, count);
+
+	SDL_Rect rect;
+	rect.x = 0;
+	rect.y = first * upscale;
+	rect.w = q->m_fb->pxPerLine() * upscale;
+	rect.h = count * upscale;
+	SDL_UpdateTexture(texture, &rect,
+		upscaleBuf.data() + (rect.y * pitch), pitch);
 }
 
 /** SdlSWBackend **/
@@ -211,6 +260,9 @@ void SdlSWBackend::set_video_source(LibGens::MdFb *fb)
 		m_fb = fb->ref();
 		d->reinitTexture();
 	}
+
+	// The new MdFb must be uploaded in its entirety.
+	d->texNeedsFullUpdate = true;
 }
 
 
@@ -220,10 +272,6 @@ void SdlSWBackend::set_video_source(LibGens::MdFb *fb)
  */
 void SdlSWBackend::update(bool fb_dirty)
 {
-	// We always have to draw the MdFb in software mode.
-	// TODO: Is this true with SDL2?
-	((void)fb_dirty);
-
 	// Clear the screen before doing anything else.
 	SDL_RenderClear(d->renderer);
 	if (m_fb) {
@@ -234,14 +282,94 @@ void SdlSWBackend::update(bool fb_dirty)
 			d->reinitTexture();
 		}
 
-		// Update the texture.
-		if (bpp == MdFb::BPP_32) {
-			SDL_UpdateTexture(d->texture, nullptr,
-				m_fb->fb32(), m_fb->pxPitch() * sizeof(uint32_t));
-		} else {
-			SDL_UpdateTexture(d->texture, nullptr,
-				m_fb->fb16(), m_fb->pxPitch() * sizeof(uint16_t));
+		// SDL2 textures retain their contents, so the
+		// texture only needs to be updated if the MdFb
+		// has changed, and then only the dirty lines.
+		if (d->upscale > 1 && (fb_dirty || isForceFbDirty() || d->texNeedsFullUpdate)) {
+			const int scale = d->upscale;
+			const int bytesPerPx = (bpp == MdFb::BPP_32 ? 4 : 2);
+			const int pitch = m_fb->pxPerLine() * scale * bytesPerPx;
+			const int numLines = m_fb->numLines();
+			d->upscaleBuf.resize(pitch * numLines * scale);
+
+			if (d->texNeedsFullUpdate || isForceFbDirty()) {
+				// Upscale and update the entire texture.
+				Upscaler::DoUpscale(d->upscaleBuf.data(), pitch,
+						    m_fb, d->upscaleFilter, scale);
+				SDL_UpdateTexture(d->texture, nullptr, d->upscaleBuf.data(), pitch);
+				d->texNeedsFullUpdate = false;
+			} else {
+				// Upscale and update the dirty lines.
+				// Scale2x/Scale3x and xBR read the neighboring
+				// lines, so each dirty range is widened to
+				// include the upscaled lines that depend on it.
+				const int neighbors = Upscaler::neighborLines(d->upscaleFilter);
+				int rangeStart = -1, rangeEnd = -1;
+				int count;
+				for (int y = m_fb->nextDirtyRange(0, &count); y >= 0;
+				     y = m_fb->nextDirtyRange(y + count, &count))
+				{
+					const int start = (y > neighbors ? y - neighbors : 0);
+					int end = y + count + neighbors;
+					if (end > numLines)
+						end = numLines;
+
+					if (rangeStart >= 0 && start <= rangeEnd) {
+						// Overlaps the previous range.
+						rangeEnd = end;
+						continue;
+					}
+					if (rangeStart >= 0) {
+						d->upscaleLines(pitch, rangeStart, rangeEnd - rangeStart);
+					}
+					rangeStart = start;
+					rangeEnd = end;
+				}
+				if (rangeStart >= 0) {
+					d->upscaleLines(pitch, rangeStart, rangeEnd - rangeStart);
+				}
+			}
+
+			// All lines have been uploaded.
+			m_fb->clearDirty();
+		} else if (fb_dirty || isForceFbDirty() || d->texNeedsFullUpdate) {
+			// Convert indexed lines to RGB, if necessary.
+			m_fb->resolve();
+
+			const uint8_t *screen;
+			int bytesPerLine;
+			if (bpp == MdFb::BPP_32) {
+				screen = (const uint8_t*)m_fb->fb32();
+				bytesPerLine = m_fb->pxPitch() * sizeof(uint32_t);
+			} else {
+				screen = (const uint8_t*)m_fb->fb16();
+				bytesPerLine = m_fb->pxPitch() * sizeof(uint16_t);
+			}
+
+			if (d->texNeedsFullUpdate || isForceFbDirty()) {
+				// Update the entire texture.
+				SDL_UpdateTexture(d->texture, nullptr, screen, bytesPerLine);
+				d->texNeedsFullUpdate = false;
+			} else {
+				// Update the dirty lines.
+				SDL_Rect rect;
+				rect.x = 0;
+				rect.w = m_fb->pxPerLine();
+				int count;
+				for (int y = m_fb->nextDirtyRange(0, &count); y >= 0;
+				     y = m_fb->nextDirtyRange(y + count, &count))
+				{
+					rect.y = y;
+					rect.h = count;
+					SDL_UpdateTexture(d->texture, &rect,
+						screen + (y * bytesPerLine), bytesPerLine);
+				}
+			}
+
+			// All lines have been uploaded.
+			m_fb->clearDirty();
 		}
+
 		SDL_RenderCopy(d->renderer, d->texture, nullptr, nullptr);
 	}
 
@@ -281,4 +409,33 @@ void SdlSWBackend::toggle_fullscreen(void)
 	}
 }
 
+/**
+ * Set the CPU upscaler.
+ * The MdFb is upscaled before it's uploaded to the texture,
+ * so the renderer only has to scale by a small amount.
+ * @param filter Upscaler filter.
+ * @param scale Scale factor. (1 to disable upscaling)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int SdlSWBackend::set_upscaler(Upscaler::Filter filter, int scale)
+{
+	if (scale != 1 && !Upscaler::isSupported(filter, scale)) {
+		// Unsupported filter.
+		return -EINVAL;
+	}
+
+	d->upscaleFilter = filter;
+	d->upscale = scale;
+	if (scale == 1) {
+		// Free the upscaled image.
+		vector<uint8_t>().swap(d->upscaleBuf);
+	}
+
+	// Recreate the texture with the new size.
+	d->lastBpp = MdFb::BPP_MAX;
+	d->reinitTexture();
+	d->texNeedsFullUpdate = true;
+	return 0;
+}
+
 }
@@ -30,6 +30,9 @@
 // Video Backend.
 #include "VBackend.hpp"
 
+// LibGens
+#include "libgens/Effects/Upscaler.hpp"
+
 namespace LibGens {
 	class MdFb;
 }
@@ -84,6 +87,17 @@ class SdlSWBackend : public VBackend {
 		 * Toggle fullscreen.
 		 */
 		virtual void toggle_fullscreen(void) final;
+
+	public:
+		/**
+		 * Set the CPU upscaler.
+		 * The MdFb is upscaled before it's uploaded to the texture,
+		 * so the renderer only has to scale by a small amount.
+		 * @param filter Upscaler filter.
+		 * @param scale Scale factor. (1 to disable upscaling)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int set_upscaler(LibGens::Upscaler::Filter filter, int scale);
 };
 
 }
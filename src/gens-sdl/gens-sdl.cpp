@@ -39,6 +39,13 @@ using GensSdl::VBackend;
 // LibGens
 #include "libgens/lg_main.hpp"
 #include "libgens/lg_osd.h"
+#include "libgens/Rom.hpp"
+#include "libgens/RomIndex.hpp"
+#include "libgensfile/RomCache.hpp"
+#include "libzomg/Zomg.hpp"
+using LibGens::Rom;
+using LibGens::RomIndex;
+using LibGensFile::RomCache;
 
 // Main event loops.
 #include "EmuLoop.hpp"
@@ -70,6 +77,7 @@ using GensSdl::VBackend;
 // C includes. (C++ namespace)
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <clocale>
 
 // C++ includes.
@@ -171,6 +179,49 @@ void checkForStartupMessages(void)
 	}
 }
 
+/**
+ * Add all ROMs in a directory tree to the ROM index.
+ * The ROM index is updated incrementally.
+ * @param dir Directory.
+ * @return 0 on success; non-zero on error.
+ */
+static int scanRoms(const char *dir)
+{
+	const string configDir = getConfigDir();
+	if (configDir.empty()) {
+		fprintf(stderr, "Unable to determine the configuration directory.\n");
+		return EXIT_FAILURE;
+	}
+	const string indexFilename = configDir + DIR_SEP_CHR + "RomIndex.bin";
+
+	// Load the existing index so unchanged
+	// files don't have to be rescanned.
+	RomIndex index;
+	index.load(indexFilename.c_str());
+
+	// Don't store every scanned ROM in the ROM cache.
+	// That would push out the ROMs that are actually used.
+	RomCache *const romCache = Rom::GetRomCache();
+	Rom::SetRomCache(nullptr);
+	int count = index.scan(dir);
+	Rom::SetRomCache(romCache);
+	if (count < 0) {
+		fprintf(stderr, "Error scanning %s: %s\n", dir, strerror(-count));
+		return EXIT_FAILURE;
+	}
+
+	int ret = index.save(indexFilename.c_str());
+	if (ret != 0) {
+		fprintf(stderr, "Error saving %s: %s\n",
+			indexFilename.c_str(), strerror(-ret));
+		return EXIT_FAILURE;
+	}
+
+	printf("Scanned %d new or modified file(s) in %s. (%d ROM(s) in the index)\n",
+		count, dir, (int)index.entries().size());
+	return 0;
+}
+
 /**
  * Run the emulator.
  */
@@ -182,18 +233,59 @@ int run(void)
 	// Register the LibGens OSD handler.
 	lg_set_osd_fn(gsdl_osd);
 
-	if (options->run_crazy_effect()) {
-		// Run the Crazy Effect.
-		eventLoop = new CrazyEffectLoop();
-	} else {
-		// Start the emulation loop.
-		eventLoop = new EmuLoop();
+	// Initialize the ROM cache.
+	RomCache *romCache = nullptr;
+	if (options->rom_cache_size() > 0) {
+		const string romCacheDir = getConfigDir("ROMCache");
+		if (!romCacheDir.empty()) {
+			romCache = new RomCache(romCacheDir.c_str(),
+				(int64_t)options->rom_cache_size() * 1024 * 1024);
+			Rom::SetRomCache(romCache);
+		}
 	}
+
+	// Savestate compression.
+	LibZomg::Zomg::SetDefaultSaveProfile(options->savestate_compression());
+
 	int ret = 0;
-	if (eventLoop) {
-		ret = eventLoop->run(options);
+	const string prewarm_dir = options->prewarm_rom_cache();
+	const string scan_dir = options->scan_roms();
+	if (!scan_dir.empty()) {
+		// Scan a ROM directory.
+		ret = scanRoms(scan_dir.c_str());
+	} else if (!prewarm_dir.empty()) {
+		// Prewarm the ROM cache.
+		if (romCache) {
+			int count = Rom::PrewarmRomCache(prewarm_dir.c_str());
+			if (count >= 0) {
+				printf("%d ROM(s) from %s are in the ROM cache.\n",
+					count, prewarm_dir.c_str());
+			} else {
+				fprintf(stderr, "Error prewarming the ROM cache from %s: %s\n",
+					prewarm_dir.c_str(), strerror(-count));
+				ret = EXIT_FAILURE;
+			}
+		} else {
+			fprintf(stderr, "The ROM cache is disabled.\n");
+			ret = EXIT_FAILURE;
+		}
+	} else {
+		if (options->run_crazy_effect()) {
+			// Run the Crazy Effect.
+			eventLoop = new CrazyEffectLoop();
+		} else {
+			// Start the emulation loop.
+			eventLoop = new EmuLoop();
+		}
+		if (eventLoop) {
+			ret = eventLoop->run(options);
+		}
 	}
 
+	// Shut down the ROM cache.
+	Rom::SetRomCache(nullptr);
+	delete romCache;
+
 	// Unregister the LibGens OSD handler.
 	lg_set_osd_fn(nullptr);
 
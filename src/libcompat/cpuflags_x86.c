@@ -255,10 +255,18 @@ uint32_t LibCompat_GetCPUFlags(void)
 #endif /* defined(__i386__) || defined(_M_IX86) */
 
 	// Check for XSAVE.
-	if (__ecx & CPUFLAG_IA32_ECX_XSAVE) {
-		// CPU supports XSAVE. Does the OS?
-		/* FIXME: Detect XSAVE. */
-		can_XSAVE = 0;
+	if ((__ecx & CPUFLAG_IA32_ECX_XSAVE) &&
+	    (__ecx & CPUFLAG_IA32_ECX_OSXSAVE))
+	{
+		// CPU supports XSAVE, and the OS has enabled it.
+		// Check if the OS saves the SSE and AVX register states.
+		unsigned int xcr0;
+		XGETBV(xcr0);
+		if ((xcr0 & (XCR0_SSE_STATE | XCR0_AVX_STATE)) ==
+		    (XCR0_SSE_STATE | XCR0_AVX_STATE))
+		{
+			can_XSAVE = 1;
+		}
 	}
 
 	// Check for AVX.
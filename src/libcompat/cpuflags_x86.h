@@ -60,6 +60,11 @@
 // Flags stored in the %ebx register.
 #define CPUFLAG_IA32_FN7_EBX_AVX2	((uint32_t)(1U << 5))
 
+// XCR0: Extended Control Register 0 (read using XGETBV)
+// Indicates which register states are saved by the OS.
+#define XCR0_SSE_STATE			((uint32_t)(1U << 1))
+#define XCR0_AVX_STATE			((uint32_t)(1U << 2))
+
 // CPUID function 0x80000001: Extended Processor Info and Feature Bits
 
 // Flags stored in the %edx register.
@@ -99,7 +104,7 @@
 		"cpuid\n"					\
 		"xchgl	%%ebx, %1\n"				\
 		: "=a" (a), "=r" (b), "=c" (c), "=d" (d)	\
-		: "0" (level)					\
+		: "0" (level), "2" (0)				\
 		);						\
 	} while (0)
 #else
@@ -107,7 +112,7 @@
 	__asm__ (						\
 		"cpuid\n"					\
 		: "=a" (a), "=b" (b), "=c" (c), "=d" (d)	\
-		: "0" (level)					\
+		: "0" (level), "2" (0)				\
 		);						\
 	} while (0)
 #endif
@@ -135,6 +140,32 @@
 #error Missing 'cpuid' asm implementation for this compiler.
 #endif
 
+// XGETBV macro. Reads XCR0.
+// Only use this if CPUID reports OSXSAVE.
+#if defined(__GNUC__)
+// NOTE: Using the opcode directly, since older
+// assemblers don't recognize 'xgetbv'.
+#define XGETBV(xcr0) do {					\
+	unsigned int __xcr0_hi;					\
+	__asm__ (						\
+		".byte 0x0F, 0x01, 0xD0\n"			\
+		: "=a" (xcr0), "=d" (__xcr0_hi)			\
+		: "c" (0)					\
+		);						\
+	} while (0)
+#elif defined(_MSC_VER) && _MSC_FULL_VER >= 160040219
+// _xgetbv() was added in MSVC 2010 SP1.
+#include <immintrin.h>
+#define XGETBV(xcr0) do {					\
+	(xcr0) = (unsigned int)_xgetbv(0);			\
+} while (0)
+#else
+// Cannot check XCR0. Assume the OS doesn't support AVX.
+#define XGETBV(xcr0) do {					\
+	(xcr0) = 0;						\
+} while (0)
+#endif
+
 /**
  * Force a function to be marked as inline.
  * FORCE_INLINE: Release builds only.
@@ -143,6 +143,11 @@ class RomCartridgeMDPrivate
 		// EEPROM type.
 		// If less than 0, no EEPROM is in use.
 		int eprType;
+
+		// If the ROM image was mapped with Rom::mapRom()
+		// or Rom::mapRomHostOrder(),
+		// this is the size of the mapping. Otherwise, 0.
+		uint32_t romMapped_size;
 };
 
 /**
@@ -329,6 +334,7 @@ RomCartridgeMDPrivate::RomCartridgeMDPrivate(RomCartridgeMD *q, Rom *rom)
 	, rom(rom)
 	, romFixup(-1)
 	, eprType(-1)
+	, romMapped_size(0)
 { }
 
 RomCartridgeMDPrivate::~RomCartridgeMDPrivate()
@@ -353,8 +359,12 @@ RomCartridgeMD::RomCartridgeMD(Rom *rom)
 
 RomCartridgeMD::~RomCartridgeMD()
 {
+	if (d->romMapped_size != 0) {
+		Rom::unmapRom(m_romData, d->romMapped_size);
+	} else {
+		aligned_free(m_romData);
+	}
 	delete d;
-	aligned_free(m_romData);
 }
 
 /**
@@ -411,34 +421,50 @@ int RomCartridgeMD::loadRom(void)
 	// TODO: Store the rounded-up size.
 	m_romData_size = d->rom->romSize();
 	uint32_t rnd_512k = ((m_romData_size + 0x7FFFF) & ~0x7FFFF);
-	// Align to 16 bytes for potential SSE2 optimizations.
-	m_romData = aligned_malloc(16, rnd_512k);
-
-	// Load the ROM image.
-	// NOTE: Passing the size of the entire ROM buffer,
-	// not the expected size of the ROM.
-	int ret = d->rom->loadRom(m_romData, rnd_512k);
-	if (ret != (int)m_romData_size) {
-		// Error loading the ROM.
-		// TODO: Set an error number somewhere.
-		aligned_free(m_romData);
-		m_romData = nullptr;
-		m_romData_size = 0;
-		return -4;
+	// Map the host-order ROM image from the ROM cache.
+	// The mapping is copy-on-write, so the pages are shared
+	// with other emulator instances until they're modified,
+	// e.g. by fixChecksum(). The rest is zero-filled.
+	m_romData = d->rom->mapRomHostOrder(rnd_512k);
+#if SYS_BYTEORDER == SYS_BIG_ENDIAN
+	if (!m_romData) {
+		// Big-endian systems don't need to byteswap the ROM,
+		// so uncompressed ROMs can be mapped directly.
+		m_romData = d->rom->mapRom(rnd_512k);
 	}
+#endif /* SYS_BYTEORDER == SYS_BIG_ENDIAN */
+	if (m_romData) {
+		d->romMapped_size = rnd_512k;
+	} else {
+		// Align to 16 bytes for potential SSE2 optimizations.
+		m_romData = aligned_malloc(16, rnd_512k);
+
+		// Load the ROM image.
+		// NOTE: Passing the size of the entire ROM buffer,
+		// not the expected size of the ROM.
+		int ret = d->rom->loadRom(m_romData, rnd_512k);
+		if (ret != (int)m_romData_size) {
+			// Error loading the ROM.
+			// TODO: Set an error number somewhere.
+			aligned_free(m_romData);
+			m_romData = nullptr;
+			m_romData_size = 0;
+			return -4;
+		}
 
-	// Clear the empty part of the ROM buffer.
-	// TODO: Clear with 0 or 0xFF? (TMSS is cleared with 0xFF.)
-	if (m_romData_size < rnd_512k) {
-		const uint32_t diff = rnd_512k - m_romData_size;
-		memset((uint8_t*)m_romData + m_romData_size, 0, diff);
-	}
+		// Clear the empty part of the ROM buffer.
+		// TODO: Clear with 0 or 0xFF? (TMSS is cleared with 0xFF.)
+		if (m_romData_size < rnd_512k) {
+			const uint32_t diff = rnd_512k - m_romData_size;
+			memset((uint8_t*)m_romData + m_romData_size, 0, diff);
+		}
 
-	// Byteswap the ROM image.
-	// NOTE: If the ROM is an odd number of bytes, the final byte
-	// will be byteswapped with 0.
-	// m_romData_size is rounded up to the nearest multiple of two.
-	be16_to_cpu_array((uint16_t*)m_romData, ((m_romData_size + 1) & ~1));
+		// Byteswap the ROM image.
+		// NOTE: If the ROM is an odd number of bytes, the final byte
+		// will be byteswapped with 0.
+		// m_romData_size is rounded up to the nearest multiple of two.
+		be16_to_cpu_array((uint16_t*)m_romData, ((m_romData_size + 1) & ~1));
+	}
 
 	// Initialize the ROM mapper.
 	// NOTE: This must be done after loading the ROM;
@@ -625,23 +651,24 @@ int RomCartridgeMD::saveData(void)
 
 /**
  * AutoSave SRam/EEPRom.
- * @param frames Number of frames elapsed, or -1 for paused. (force autosave)
+ * Modified pages are written automatically in the background.
+ * This writes any pending pages immediately, e.g. on pause.
  * @return 1 if SRam was saved; 2 if EEPRom was saved; 0 if nothing was saved. (TODO: Enum?)
  */
-int RomCartridgeMD::autoSaveData(int framesElapsed)
+int RomCartridgeMD::autoSaveData(void)
 {
 	// TODO: Return a value indicating what was saved and the size.
 	// (that is, move lg_osd out of this function.)
 	if (m_EEPRom.isEEPRomTypeSet()) {
 		// Save EEPRom.
-		int eepromSize = m_EEPRom.autoSave(framesElapsed);
+		int eepromSize = m_EEPRom.autoSave();
 		if (eepromSize > 0) {
 			lg_osd(OSD_EEPROM_AUTOSAVE, eepromSize);
 			return 2;
 		}
 	} else {
 		// Save SRam.
-		int sramSize = m_SRam.autoSave(framesElapsed);
+		int sramSize = m_SRam.autoSave();
 		if (sramSize > 0)
 		{
 			lg_osd(OSD_SRAM_AUTOSAVE, sramSize);
@@ -653,6 +680,21 @@ int RomCartridgeMD::autoSaveData(int framesElapsed)
 	return 0;
 }
 
+/**
+ * Clear SRam/EEPRom and detach it from the save file.
+ * Nothing will be loaded from or saved to the save file.
+ * This is used for input movies, which must not
+ * depend on or modify the user's save data.
+ */
+void RomCartridgeMD::unloadSaveData(void)
+{
+	if (m_EEPRom.isEEPRomTypeSet()) {
+		m_EEPRom.unload();
+	} else {
+		m_SRam.unload();
+	}
+}
+
 /**
  * Initialize SRAM.
  * If the loaded ROM has an SRAM fixup, use the fixup.
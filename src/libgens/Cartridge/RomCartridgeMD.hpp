@@ -114,10 +114,19 @@ class RomCartridgeMD
 
 		/**
 		 * AutoSave SRam/EEPRom.
-		 * @param frames Number of frames elapsed, or -1 for paused. (force autosave)
+		 * Modified pages are written automatically in the background.
+		 * This writes any pending pages immediately, e.g. on pause.
 		 * @return 1 if SRam was saved; 2 if EEPRom was saved; 0 if nothing was saved. (TODO: Enum?)
 		 */
-		int autoSaveData(int framesElapsed);
+		int autoSaveData(void);
+
+		/**
+		 * Clear SRam/EEPRom and detach it from the save file.
+		 * Nothing will be loaded from or saved to the save file.
+		 * This is used for input movies, which must not
+		 * depend on or modify the user's save data.
+		 */
+		void unloadSaveData(void);
 
 		/** ZOMG savestate functions. **/
 		void zomgSave(LibZomg::Zomg *zomg) const;
@@ -173,7 +182,9 @@ class RomCartridgeMD
 		 */
 
 		// ROM data. (Should be allocated in 512 KB blocks.)
-		// (Use malloc() and free() for this pointer.)
+		// (Use aligned_malloc() and aligned_free() for this pointer,
+		// unless it was mapped with Rom::mapRom()
+		// or Rom::mapRomHostOrder().)
 		void *m_romData;
 		uint32_t m_romData_size;
 
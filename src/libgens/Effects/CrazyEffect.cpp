@@ -23,6 +23,7 @@
 
 #include "CrazyEffect.hpp"
 #include "Util/MdFb.hpp"
+#include "Util/StripeExecutor.hpp"
 
 // C includes.
 #include <stdlib.h>
@@ -34,6 +35,10 @@
 #include <cstdio>
 #include <ctime>
 
+// C++ includes.
+#include <vector>
+using std::vector;
+
 namespace LibGens {
 
 class CrazyEffectPrivate
@@ -53,37 +58,90 @@ class CrazyEffectPrivate
 		// Color mask.
 		CrazyEffect::ColorMask colorMask;
 
-		// Xorshift+ RNG state.
-		union {
-			uint32_t d[4];
-			uint64_t q[2];
-		} rng_state;
-
-		/**
-		 * RNG cache.
-		 * If 0, new random numbers
-		 * need to be generated.
-		 */
-		uint64_t rng_cache;
-
 		/**
-		 * Get a random number in the range [0,0x7FFF].
-		 * This uses the internal random number
-		 * cache if it's available.
-		 * @return Random number.
+		 * Xorshift+ RNG.
+		 * Each stripe gets its own RNG so the
+		 * worker threads don't share any state.
 		 */
-		unsigned int getRand(void);
+		struct Rng {
+			union {
+				uint32_t d[4];
+				uint64_t q[2];
+			} state;
+
+			/**
+			 * RNG cache.
+			 * If 0, new random numbers
+			 * need to be generated.
+			 */
+			uint64_t cache;
+
+			/**
+			 * Generate a new 64-bit random number.
+			 * @return Random number.
+			 */
+			inline uint64_t next(void);
+
+			/**
+			 * Get a random number in the range [0,0x7FFF].
+			 * This uses the internal random number
+			 * cache if it's available.
+			 * @return Random number.
+			 */
+			inline unsigned int getRand(void);
+
+			/**
+			 * Seed another RNG from this one.
+			 * @param other [out] RNG to seed.
+			 */
+			void seed(Rng *other);
+		};
+
+		// Main RNG. Used to seed the stripe RNGs.
+		Rng rng;
 
 		/**
 		 * Adjust a pixel's color.
 		 * @param pixel     [in] Type of pixel.
 		 * @param add_shift [in] Shift value for the add value.
+		 * @param rng       [in] RNG.
 		 * @param px        [in] Pixel data.
 		 * @param mask      [in] Pixel mask.
 		 * @return Adjusted pixel color.
 		 */
 		template<typename pixel, uint8_t add_shift>
-		inline pixel adj_color(pixel px, pixel mask);
+		static inline pixel adj_color(Rng &rng, pixel px, pixel mask);
+
+		/**
+		 * Calculate a new pixel for the "Crazy" effect.
+		 * @param pixel     [in] Type of pixel.
+		 * @param RBits     [in] Number of bits for Red.
+		 * @param GBits     [in] Number of bits for Green.
+		 * @param BBits     [in] Number of bits for Blue.
+		 * @param rng       [in] RNG.
+		 * @param pl        [in] Pixel above this pixel.
+		 * @param pp        [in] Pixel before this pixel.
+		 * @return New pixel.
+		 */
+		template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
+		inline pixel T_crazyPixel(Rng &rng, pixel pl, pixel pp) const;
+
+		/**
+		 * Do the "Crazy" effect on a stripe.
+		 * @param pixel     [in]  Type of pixel.
+		 * @param RBits     [in]  Number of bits for Red.
+		 * @param GBits     [in]  Number of bits for Green.
+		 * @param BBits     [in]  Number of bits for Blue.
+		 * @param outScreen [out] First line of the stripe.
+		 * @param lines     [in]  Number of lines in the stripe.
+		 * @param pxPitch   [in]  Row length, in pixels.
+		 * @param prevLine  [in]  Original contents of the line above the stripe.
+		 * @param rng       [in]  RNG for this stripe.
+		 */
+		template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
+		inline void T_doCrazyEffect(pixel *outScreen,
+			int lines, int pxPitch,
+			const pixel *prevLine, Rng &rng) const;
 
 		/**
 		 * Do the "Crazy" effect.
@@ -92,18 +150,15 @@ class CrazyEffectPrivate
 		 * @param GBits     [in]  Number of bits for Green.
 		 * @param BBits     [in]  Number of bits for Blue.
 		 * @param outScreen [out] Destination screen.
-		 * @param pxCount   [in]  Pixel count.
+		 * @param numLines  [in]  Number of lines.
 		 * @param pxPitch   [in]  Row length, in pixels.
 		 */
 		template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
-		inline void T_doCrazyEffect(pixel *outScreen,
-			unsigned int pxCount,
-			unsigned int pxPitch);
+		inline void T_run(pixel *outScreen, int numLines, int pxPitch);
 };
 
 CrazyEffectPrivate::CrazyEffectPrivate()
 	: colorMask(CrazyEffect::CM_WHITE)
-	, rng_cache(0)
 {
 	// Initialize the RNG state.
 	// FIXME: Move this srand() call somewhere else.
@@ -114,59 +169,83 @@ CrazyEffectPrivate::CrazyEffectPrivate()
 	// instead of simple assignment so systems where
 	// RAND_MAX > 0x7FFF get an extra bit of randomness.
 	for (int i = 0; i < 4; i++) {
-		rng_state.d[i]  =  rand();
-		rng_state.d[i] ^= (rand() << 15);
-		rng_state.d[i] ^= (rand() << 30);
+		rng.state.d[i]  =  rand();
+		rng.state.d[i] ^= (rand() << 15);
+		rng.state.d[i] ^= (rand() << 30);
 	}
+	rng.cache = 0;
 }
 
 /**
- * Get a random number in the range [0,0x7FFF].
+ * Generate a new 64-bit random number.
  * Based on Xorshift+:
  * - https://en.wikipedia.org/wiki/Xorshift#Xorshift.2B
  * @return Random number.
  */
-unsigned int CrazyEffectPrivate::getRand(void)
+inline uint64_t CrazyEffectPrivate::Rng::next(void)
 {
-	if (rng_cache == 0) {
+	uint64_t x = state.q[0];
+	uint64_t const y = state.q[1];
+	state.q[0] = y;
+	x ^= x << 23; // a
+	x ^= x >> 17; // b
+	x ^= y ^ (y >> 26); // c
+	state.q[1] = x;
+	return (x + y);
+}
+
+/**
+ * Get a random number in the range [0,0x7FFF].
+ * @return Random number.
+ */
+inline unsigned int CrazyEffectPrivate::Rng::getRand(void)
+{
+	if (cache == 0) {
 		// Generate new random numbers.
-		uint64_t x = rng_state.q[0];
-		uint64_t const y = rng_state.q[1];
-		rng_state.q[0] = y;
-		x ^= x << 23; // a
-		x ^= x >> 17; // b
-		x ^= y ^ (y >> 26); // c
-		rng_state.q[1] = x;
-		rng_cache = x + y;
+		cache = next();
 	}
 
 	// Random number is the lower 15 bits.
-	const unsigned int ret = rng_cache & 0x7FFF;
+	const unsigned int ret = cache & 0x7FFF;
 
 	// Shift the cache.
 	// NOTE: Shifting 16 bits to prevent issues.
 	// If we only shifted 15 bits, we'd have
 	// 4 bits left over after 4 cycles.
-	rng_cache >>= 16;
+	cache >>= 16;
 
 	// Return the value.
 	return ret;
 }
 
+/**
+ * Seed another RNG from this one.
+ * @param other [out] RNG to seed.
+ */
+void CrazyEffectPrivate::Rng::seed(Rng *other)
+{
+	do {
+		other->state.q[0] = next();
+		other->state.q[1] = next();
+	} while (other->state.q[0] == 0 && other->state.q[1] == 0);
+	other->cache = 0;
+}
+
 /**
  * Adjust a pixel's color.
  * @param pixel     [in] Type of pixel.
  * @param add_shift [in] Shift value for the add value.
+ * @param rng       [in] RNG.
  * @param px        [in] Pixel data.
  * @param mask      [in] Pixel mask.
  * @return Adjusted pixel color.
  */
 template<typename pixel, uint8_t add_shift>
-inline pixel CrazyEffectPrivate::adj_color(pixel px, pixel mask)
+inline pixel CrazyEffectPrivate::adj_color(Rng &rng, pixel px, pixel mask)
 {
 	pixel add = 1 << add_shift;
 	px &= mask;
-	if (getRand() > 0x2C00) {
+	if (rng.getRand() > 0x2C00) {
 		if ((mask - add) <= px) {
 			px = mask;
 		} else {
@@ -183,74 +262,129 @@ inline pixel CrazyEffectPrivate::adj_color(pixel px, pixel mask)
 }
 
 /**
- * Do the "Crazy" effect.
- * @param pixel     [in]  Type of pixel.
- * @param RBits     [in]  Number of bits for Red.
- * @param GBits     [in]  Number of bits for Green.
- * @param BBits     [in]  Number of bits for Blue.
- * @param outScreen [out] Destination screen.
- * @param pxCount   [in]  Pixel count.
- * @param pxPitch   [in]  Row length, in pixels.
+ * Calculate a new pixel for the "Crazy" effect.
+ * @param pixel     [in] Type of pixel.
+ * @param RBits     [in] Number of bits for Red.
+ * @param GBits     [in] Number of bits for Green.
+ * @param BBits     [in] Number of bits for Blue.
+ * @param rng       [in] RNG.
+ * @param pl        [in] Pixel above this pixel.
+ * @param pp        [in] Pixel before this pixel.
+ * @return New pixel.
  */
 template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
-inline void CrazyEffectPrivate::T_doCrazyEffect(
-	pixel *outScreen,
-	unsigned int pxCount,
-	unsigned int pxPitch)
+inline pixel CrazyEffectPrivate::T_crazyPixel(Rng &rng, pixel pl, pixel pp) const
 {
-	if (colorMask == CrazyEffect::CM_BLACK) {
-		// Intro effect color is black.
-		// Simply clear the screen.
-		memset(outScreen, 0, pxCount * sizeof(pixel));
-		return;
-	}
-
 	const pixel Rmask = (0x1F << (RBits-5)) << (GBits + BBits);
 	const pixel Gmask = (0x1F << (GBits-5)) << BBits;
 	const pixel Bmask = (0x1F << (BBits-5));
 	const pixel RBmask = (Rmask | Bmask);
 	pixel r = 0, g = 0, b = 0;
-	pixel RB, G;
 
-	pixel *pix = &outScreen[pxCount - 1];
-	pixel *prev_l = pix - pxPitch;
-	pixel *prev_p = pix - 1;
+	// Separate RB and G components.
+	const pixel RB = ((pl & RBmask) + (pp & RBmask)) >> 1;
+	const pixel G = ((pl & Gmask) + (pp & Gmask)) >> 1;
+
+	if (colorMask & CrazyEffect::CM_RED) {
+		// Red channel.
+		r = adj_color<pixel, (RBits-5)+GBits+BBits>(rng, RB, Rmask);
+	}
+	if (colorMask & CrazyEffect::CM_GREEN) {
+		// Green channel.
+		g = adj_color<pixel, (GBits-5)+BBits>(rng, G, Gmask);
+	}
+	if (colorMask & CrazyEffect::CM_BLUE) {
+		// Blue channel.
+		b = adj_color<pixel, (BBits-5)>(rng, RB, Bmask);
+	}
+
+	// Combine the color components.
+	return (r | g | b);
+}
 
+/**
+ * Do the "Crazy" effect on a stripe.
+ * @param pixel     [in]  Type of pixel.
+ * @param RBits     [in]  Number of bits for Red.
+ * @param GBits     [in]  Number of bits for Green.
+ * @param BBits     [in]  Number of bits for Blue.
+ * @param outScreen [out] First line of the stripe.
+ * @param lines     [in]  Number of lines in the stripe.
+ * @param pxPitch   [in]  Row length, in pixels.
+ * @param prevLine  [in]  Original contents of the line above the stripe.
+ * @param rng       [in]  RNG for this stripe.
+ */
+template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
+inline void CrazyEffectPrivate::T_doCrazyEffect(
+	pixel *outScreen,
+	int lines, int pxPitch,
+	const pixel *prevLine, Rng &rng) const
+{
 	// NOTE: This effect manipulates pixels outside of the
 	// visible image area, i.e. the border between the
 	// visible image width and the row pitch.
 
-	// TODO: Unroll the last-line/last-pixel code.
-	for (unsigned int i = pxCount; i != 0; i--) {
-		pixel pl, pp;
-		pl = (prev_l >= outScreen ? *prev_l : 0);
-		pp = (prev_p >= outScreen ? *prev_p : 0);
-
-		// Separate RB and G components.
-		RB = ((pl & RBmask) + (pp & RBmask)) >> 1;
-		G = ((pl & Gmask) + (pp & Gmask)) >> 1;
-
-		if (colorMask & CrazyEffect::CM_RED) {
-			// Red channel.
-			r = adj_color<pixel, (RBits-5)+GBits+BBits>(RB, Rmask);
-		}
-		if (colorMask & CrazyEffect::CM_GREEN) {
-			// Green channel.
-			g = adj_color<pixel, (GBits-5)+BBits>(G, Gmask);
-		}
-		if (colorMask & CrazyEffect::CM_BLUE) {
-			// Blue channel.
-			b = adj_color<pixel, (BBits-5)>(RB, Bmask);
+	// Pixels are processed from last to first, so the
+	// pixels above and before the current pixel haven't
+	// been modified yet.
+	for (int y = lines - 1; y >= 0; y--) {
+		pixel *const line = &outScreen[y * pxPitch];
+		const pixel *const above = (y > 0 ? (line - pxPitch) : prevLine);
+		for (int x = pxPitch - 1; x > 0; x--) {
+			line[x] = T_crazyPixel<pixel, RBits, GBits, BBits>(
+				rng, above[x], line[x-1]);
 		}
 
-		// Combine the color components.
-		*pix = r | g | b;
+		// The pixel before the first pixel is
+		// the last pixel of the line above.
+		line[0] = T_crazyPixel<pixel, RBits, GBits, BBits>(
+			rng, above[0], above[pxPitch-1]);
+	}
+}
 
-		// Next pixels.
-		prev_l--;
-		prev_p--;
-		pix--;
+/**
+ * Do the "Crazy" effect.
+ * @param pixel     [in]  Type of pixel.
+ * @param RBits     [in]  Number of bits for Red.
+ * @param GBits     [in]  Number of bits for Green.
+ * @param BBits     [in]  Number of bits for Blue.
+ * @param outScreen [out] Destination screen.
+ * @param numLines  [in]  Number of lines.
+ * @param pxPitch   [in]  Row length, in pixels.
+ */
+template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
+inline void CrazyEffectPrivate::T_run(pixel *outScreen, int numLines, int pxPitch)
+{
+	if (colorMask == CrazyEffect::CM_BLACK) {
+		// Intro effect color is black.
+		// Simply clear the screen.
+		memset(outScreen, 0, numLines * pxPitch * sizeof(pixel));
+		return;
 	}
+
+	// The first line of each stripe is blended with the
+	// last line of the previous stripe, which might be
+	// modified by another thread before it's read.
+	// Save those lines first. The first stripe is
+	// blended with a black line.
+	StripeExecutor *const executor = StripeExecutor::instance();
+	const int stripes = executor->stripeCount(numLines);
+	vector<pixel> prevLines(stripes * pxPitch, 0);
+	Rng stripeRng[StripeExecutor::MAX_THREADS];
+	for (int i = 0; i < stripes; i++) {
+		if (i > 0) {
+			const int line = StripeExecutor::stripeStart(numLines, stripes, i);
+			memcpy(&prevLines[i * pxPitch], &outScreen[(line - 1) * pxPitch],
+				pxPitch * sizeof(pixel));
+		}
+		rng.seed(&stripeRng[i]);
+	}
+
+	executor->run(numLines, stripes, [&](int first, int count, int stripe) {
+		T_doCrazyEffect<pixel, RBits, GBits, BBits>(
+			&outScreen[first * pxPitch], count, pxPitch,
+			&prevLines[stripe * pxPitch], stripeRng[stripe]);
+	});
 }
 
 /** CrazyEffect **/
@@ -283,22 +417,24 @@ void CrazyEffect::setColorMask(ColorMask colorMask)
  */
 void CrazyEffect::run(MdFb *fb)
 {
-	const unsigned int pxCount = (fb->pxPitch() * fb->numLines());
 	switch (fb->bpp()) {
 		case MdFb::BPP_15:
-			d->T_doCrazyEffect<uint16_t, 5, 5, 5>(
-				fb->fb16(), pxCount, fb->pxPitch());
+			d->T_run<uint16_t, 5, 5, 5>(
+				fb->fb16(), fb->numLines(), fb->pxPitch());
 			break;
 		case MdFb::BPP_16:
-			d->T_doCrazyEffect<uint16_t, 5, 6, 5>(
-				fb->fb16(), pxCount, fb->pxPitch());
+			d->T_run<uint16_t, 5, 6, 5>(
+				fb->fb16(), fb->numLines(), fb->pxPitch());
 			break;
 		case MdFb::BPP_32:
 		default:
-			d->T_doCrazyEffect<uint32_t, 8, 8, 8>(
-				fb->fb32(), pxCount, fb->pxPitch());
+			d->T_run<uint32_t, 8, 8, 8>(
+				fb->fb32(), fb->numLines(), fb->pxPitch());
 			break;
 	}
+
+	// The entire framebuffer was modified.
+	fb->markAllDirty();
 }
 
 }
@@ -23,6 +23,7 @@
 
 #include "FastBlur.hpp"
 #include "Util/MdFb.hpp"
+#include "Util/StripeExecutor.hpp"
 #include "libcompat/cpuflags.h"
 
 // C includes.
@@ -108,14 +109,63 @@ class FastBlurPrivate
 			uint32_t* RESTRICT outScreen,
 			const uint32_t* RESTRICT mdScreen,
 			unsigned int pxCount);
+
+		static const uint32_t MASK_DIV2_15_AVX2[8];
+		static const uint32_t MASK_DIV2_16_AVX2[8];
+
+		static void DoFastBlur_16_AVX2(
+			uint16_t* RESTRICT outScreen,
+			unsigned int pxCount,
+			const uint32_t *mask);
+		static void DoFastBlur_16_AVX2(
+			uint16_t* RESTRICT outScreen,
+			const uint16_t* RESTRICT mdScreen,
+			unsigned int pxCount,
+			const uint32_t *mask);
+
+		static void DoFastBlur_32_AVX2(
+			uint32_t* RESTRICT outScreen,
+			unsigned int pxCount);
+		static void DoFastBlur_32_AVX2(
+			uint32_t* RESTRICT outScreen,
+			const uint32_t* RESTRICT mdScreen,
+			unsigned int pxCount);
 #endif /* HAVE_MMX */
+
+		/**
+		 * Number of pixels at the end of each stripe that are
+		 * blurred separately in the 1-FB version.
+		 * All optimized versions process a multiple of this
+		 * number of pixels at a time.
+		 */
+		static const unsigned int STRIPE_TAIL = 16;
+
+		/**
+		 * Blur pixels using the best available implementation.
+		 * @param bpp       [in]  Color depth.
+		 * @param outScreen [out] Destination pixels.
+		 * @param mdScreen  [in]  Source pixels. (If nullptr, blur outScreen in place.)
+		 * @param pxCount   [in]  Pixel count. (Must be a multiple of STRIPE_TAIL.)
+		 */
+		static void blurPixels(MdFb::ColorDepth bpp,
+			void* RESTRICT outScreen,
+			const void* RESTRICT mdScreen,
+			unsigned int pxCount);
 };
 
 #ifdef HAVE_MMX
 const uint32_t FastBlurPrivate::MASK_DIV2_15_MMX[2] = {0x3DEF3DEF, 0x3DEF3DEF};
 const uint32_t FastBlurPrivate::MASK_DIV2_16_MMX[2] = {0x7BCF7BCF, 0x7BCF7BCF};
+const uint32_t FastBlurPrivate::MASK_DIV2_15_AVX2[8] =
+	{0x3DEF3DEF, 0x3DEF3DEF, 0x3DEF3DEF, 0x3DEF3DEF,
+	 0x3DEF3DEF, 0x3DEF3DEF, 0x3DEF3DEF, 0x3DEF3DEF};
+const uint32_t FastBlurPrivate::MASK_DIV2_16_AVX2[8] =
+	{0x7BCF7BCF, 0x7BCF7BCF, 0x7BCF7BCF, 0x7BCF7BCF,
+	 0x7BCF7BCF, 0x7BCF7BCF, 0x7BCF7BCF, 0x7BCF7BCF};
 #endif /* HAVE_MMX */
 
+const unsigned int FastBlurPrivate::STRIPE_TAIL;
+
 }
 
 // Generic versions.
@@ -127,7 +177,7 @@ const uint32_t FastBlurPrivate::MASK_DIV2_16_MMX[2] = {0x7BCF7BCF, 0x7BCF7BCF};
 #include "FastBlur.generic.inc.cpp"
 #undef DO_2FB
 
-// MMX/SSE2-optimized versions.
+// MMX/SSE2/AVX2-optimized versions.
 #ifdef HAVE_MMX
 #define DO_1FB
 #include "FastBlur.x86.inc.cpp"
@@ -140,60 +190,143 @@ const uint32_t FastBlurPrivate::MASK_DIV2_16_MMX[2] = {0x7BCF7BCF, 0x7BCF7BCF};
 namespace LibGens {
 
 /**
- * Apply a Fast Blur effect to the screen buffer.
- * @param outScreen Source and destination screen.
+ * Blur pixels using the best available implementation.
+ * @param bpp       [in]  Color depth.
+ * @param outScreen [out] Destination pixels.
+ * @param mdScreen  [in]  Source pixels. (If nullptr, blur outScreen in place.)
+ * @param pxCount   [in]  Pixel count. (Must be a multiple of STRIPE_TAIL.)
  */
-void FastBlur::DoFastBlur(MdFb* RESTRICT outScreen)
+void FastBlurPrivate::blurPixels(MdFb::ColorDepth bpp,
+	void* RESTRICT outScreen,
+	const void* RESTRICT mdScreen,
+	unsigned int pxCount)
 {
-	// Reference the framebuffer.
-	outScreen->ref();
-	const unsigned int pxCount = (outScreen->pxPitch() * outScreen->numLines());
+	assert(pxCount % STRIPE_TAIL == 0);
 
-	switch (outScreen->bpp()) {
+	switch (bpp) {
 		case MdFb::BPP_15:
+		case MdFb::BPP_16: {
+			uint16_t *const out16 = static_cast<uint16_t*>(outScreen);
+			const uint16_t *const md16 = static_cast<const uint16_t*>(mdScreen);
 #ifdef HAVE_MMX
-			if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
-				FastBlurPrivate::DoFastBlur_16_MMX(
-					outScreen->fb16(), pxCount,
-					FastBlurPrivate::MASK_DIV2_15_MMX);
-			} else
-#endif /* HAVE_MMX */
-			{
-				FastBlurPrivate::DoFastBlur_16(
-					outScreen->fb16(), pxCount,
-					FastBlurPrivate::MASK_DIV2_15);
+			if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+				const uint32_t *const mask = (bpp == MdFb::BPP_15
+					? MASK_DIV2_15_AVX2 : MASK_DIV2_16_AVX2);
+				if (md16) {
+					DoFastBlur_16_AVX2(out16, md16, pxCount, mask);
+				} else {
+					DoFastBlur_16_AVX2(out16, pxCount, mask);
+				}
+				break;
+			} else if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
+				const uint32_t *const mask = (bpp == MdFb::BPP_15
+					? MASK_DIV2_15_MMX : MASK_DIV2_16_MMX);
+				if (md16) {
+					DoFastBlur_16_MMX(out16, md16, pxCount, mask);
+				} else {
+					DoFastBlur_16_MMX(out16, pxCount, mask);
+				}
+				break;
 			}
-			break;
-
-		case MdFb::BPP_16:
-#ifdef HAVE_MMX
-			if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
-				FastBlurPrivate::DoFastBlur_16_MMX(
-					outScreen->fb16(), pxCount,
-					FastBlurPrivate::MASK_DIV2_16_MMX);
-			} else
 #endif /* HAVE_MMX */
-			{
-				FastBlurPrivate::DoFastBlur_16(
-					outScreen->fb16(), pxCount,
-					FastBlurPrivate::MASK_DIV2_16);
+
+			const uint16_t mask = (bpp == MdFb::BPP_15
+				? MASK_DIV2_15 : MASK_DIV2_16);
+			if (md16) {
+				DoFastBlur_16(out16, md16, pxCount, mask);
+			} else {
+				DoFastBlur_16(out16, pxCount, mask);
 			}
 			break;
+		}
 
 		case MdFb::BPP_32:
-		default:
+		default: {
+			uint32_t *const out32 = static_cast<uint32_t*>(outScreen);
+			const uint32_t *const md32 = static_cast<const uint32_t*>(mdScreen);
 #ifdef HAVE_MMX
-			if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
-				FastBlurPrivate::DoFastBlur_32_MMX(
-					outScreen->fb32(), pxCount);
-			} else
+			if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+				if (md32) {
+					DoFastBlur_32_AVX2(out32, md32, pxCount);
+				} else {
+					DoFastBlur_32_AVX2(out32, pxCount);
+				}
+				break;
+			} else if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
+				if (md32) {
+					DoFastBlur_32_MMX(out32, md32, pxCount);
+				} else {
+					DoFastBlur_32_MMX(out32, pxCount);
+				}
+				break;
+			}
 #endif /* HAVE_MMX */
-			{
-				FastBlurPrivate::DoFastBlur_32(
-					outScreen->fb32(), pxCount);
+
+			if (md32) {
+				DoFastBlur_32(out32, md32, pxCount);
+			} else {
+				DoFastBlur_32(out32, pxCount);
 			}
 			break;
+		}
 	}
+}
+
+/**
+ * Apply a Fast Blur effect to the screen buffer.
+ * @param outScreen Source and destination screen.
+ */
+void FastBlur::DoFastBlur(MdFb* RESTRICT outScreen)
+{
+	// Reference the framebuffer.
+	outScreen->ref();
+
+	const MdFb::ColorDepth bpp = outScreen->bpp();
+	const unsigned int bytesPerPx = (bpp == MdFb::BPP_32 ? 4 : 2);
+	const unsigned int pxPitch = outScreen->pxPitch();
+	const int numLines = outScreen->numLines();
+	uint8_t *const fb = (bpp == MdFb::BPP_32
+		? reinterpret_cast<uint8_t*>(outScreen->fb32())
+		: reinterpret_cast<uint8_t*>(outScreen->fb16()));
+
+	// Each pixel is blurred with the pixel after it, so the
+	// last pixel in each stripe needs the first pixel in the
+	// next stripe, which might be overwritten by another
+	// thread before it's read. Save those pixels first.
+	StripeExecutor *const executor = StripeExecutor::instance();
+	const int stripes = executor->stripeCount(numLines);
+	uint32_t nextPx[StripeExecutor::MAX_THREADS];
+	for (int i = 1; i < stripes; i++) {
+		const int line = StripeExecutor::stripeStart(numLines, stripes, i);
+		memcpy(&nextPx[i-1], fb + (line * pxPitch * bytesPerPx), bytesPerPx);
+	}
+
+	executor->run(numLines, stripes, [=, &nextPx](int first, int count, int stripe) {
+		uint8_t *const out = fb + (first * pxPitch * bytesPerPx);
+		const unsigned int pxCount = (count * pxPitch);
+		if (stripe == stripes - 1) {
+			// Last stripe. Nothing follows it.
+			FastBlurPrivate::blurPixels(bpp, out, nullptr, pxCount);
+			return;
+		}
+
+		// Blur the stripe's tail in a temporary buffer
+		// using the saved pixel from the next stripe.
+		const unsigned int tailPos = (pxCount - FastBlurPrivate::STRIPE_TAIL) * bytesPerPx;
+		const unsigned int tailSz = FastBlurPrivate::STRIPE_TAIL * bytesPerPx;
+		uint32_t tail[FastBlurPrivate::STRIPE_TAIL + 1];
+		memcpy(tail, out + tailPos, tailSz);
+		memcpy(reinterpret_cast<uint8_t*>(tail) + tailSz, &nextPx[stripe], bytesPerPx);
+
+		FastBlurPrivate::blurPixels(bpp, out, nullptr,
+			pxCount - FastBlurPrivate::STRIPE_TAIL);
+		FastBlurPrivate::blurPixels(bpp, tail, nullptr,
+			FastBlurPrivate::STRIPE_TAIL);
+		memcpy(out + tailPos, tail, tailSz);
+	});
+
+	// The entire framebuffer was modified.
+	outScreen->markAllDirty();
 
 	// Unreference the framebuffer.
 	outScreen->unref();
@@ -210,58 +343,34 @@ void FastBlur::DoFastBlur(MdFb* RESTRICT outScreen, const MdFb* RESTRICT mdScree
 	outScreen->ref();
 	mdScreen->ref();
 
+	// Convert indexed lines to RGB, if necessary.
+	mdScreen->resolve();
+
 	// Set outScreen's bpp to match mdScreen.
 	outScreen->setBpp(mdScreen->bpp());
 
-	// Pixel count.
 	// TODO: Verify that both framebuffers are the same.
-	const unsigned int pxCount = (outScreen->pxPitch() * outScreen->numLines());
-
-	switch (outScreen->bpp()) {
-		case MdFb::BPP_15:
-#ifdef HAVE_MMX
-			if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
-				FastBlurPrivate::DoFastBlur_16_MMX(
-					outScreen->fb16(), mdScreen->fb16(), pxCount,
-					FastBlurPrivate::MASK_DIV2_15_MMX);
-			} else
-#endif /* HAVE_MMX */
-			{
-				FastBlurPrivate::DoFastBlur_16(
-					outScreen->fb16(), mdScreen->fb16(),
-					pxCount, FastBlurPrivate::MASK_DIV2_15);
-			}
-			break;
-
-		case MdFb::BPP_16:
-#ifdef HAVE_MMX
-			if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
-				FastBlurPrivate::DoFastBlur_16_MMX(
-					outScreen->fb16(), mdScreen->fb16(), pxCount,
-					FastBlurPrivate::MASK_DIV2_16_MMX);
-			} else
-#endif /* HAVE_MMX */
-			{
-				FastBlurPrivate::DoFastBlur_16(
-					outScreen->fb16(), mdScreen->fb16(),
-					pxCount, FastBlurPrivate::MASK_DIV2_16);
-			}
-			break;
-
-		case MdFb::BPP_32:
-		default:
-#ifdef HAVE_MMX
-			if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
-				FastBlurPrivate::DoFastBlur_32_MMX(
-					outScreen->fb32(), mdScreen->fb32(), pxCount);
-			}
-#endif /* HAVE_MMX */
-			{
-				FastBlurPrivate::DoFastBlur_32(
-					outScreen->fb32(), mdScreen->fb32(), pxCount);
-			}
-			break;
-	}
+	const MdFb::ColorDepth bpp = outScreen->bpp();
+	const unsigned int bytesPerPx = (bpp == MdFb::BPP_32 ? 4 : 2);
+	const unsigned int pxPitch = outScreen->pxPitch();
+	uint8_t *const out = (bpp == MdFb::BPP_32
+		? reinterpret_cast<uint8_t*>(outScreen->fb32())
+		: reinterpret_cast<uint8_t*>(outScreen->fb16()));
+	const uint8_t *const md = (bpp == MdFb::BPP_32
+		? reinterpret_cast<const uint8_t*>(mdScreen->fb32())
+		: reinterpret_cast<const uint8_t*>(mdScreen->fb16()));
+
+	// The source screen isn't modified, so the
+	// stripes can be processed independently.
+	StripeExecutor::instance()->run(outScreen->numLines(),
+		[=](int first, int count, int stripe) {
+			((void)stripe);
+			const unsigned int pos = (first * pxPitch * bytesPerPx);
+			FastBlurPrivate::blurPixels(bpp, out + pos, md + pos, count * pxPitch);
+		});
+
+	// The entire framebuffer was modified.
+	outScreen->markAllDirty();
 
 	// Unreference the framebuffers.
 	outScreen->unref();
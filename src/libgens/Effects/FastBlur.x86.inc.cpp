@@ -274,4 +274,132 @@ void FastBlurPrivate::DoFastBlur_32_MMX(
 	__asm__ __volatile__ ("emms");
 }
 
+/**
+ * 15/16-bit color Fast Blur, AVX2-optimized.
+ * @param outScreen	[out] Destination screen.
+ * @param mdScreen	[in]  Source screen. [2-FB only]
+ * @param pxCount	[in]  Pixel count.
+ * @param mask		[in]  Division mask to use. (MASK_DIV2_15_AVX2[] or MASK_DIV2_16_AVX2[])
+ */
+void FastBlurPrivate::DoFastBlur_16_AVX2(
+	uint16_t* RESTRICT outScreen,
+#ifdef DO_2FB
+	const uint16_t* RESTRICT mdScreen,
+#endif
+	unsigned int pxCount,
+	const uint32_t *mask)
+{
+	// Blur 16px at a time.
+	// NOTE: The framebuffers are only 16-byte aligned,
+	// so unaligned loads and stores are used.
+	assert(pxCount % 16 == 0);
+	for (pxCount /= 16; pxCount > 0; pxCount--) {
+		__asm__ (
+			// Get source pixels.
+#ifdef DO_2FB
+			"vmovdqu	 (%[mdScreen]), %%ymm0\n"
+			"vmovdqu	2(%[mdScreen]), %%ymm1\n"
+#else /* DO_1FB */
+			"vmovdqu	 (%[outScreen]), %%ymm0\n"
+			"vmovdqu	2(%[outScreen]), %%ymm1\n"
+#endif
+
+			// Blur source pixels.
+			// NOTE: This may lose some precision in the Red LSB on LE architectures.
+			"vpsrlw	      $1, %%ymm0, %%ymm0\n"
+			"vpsrlw	      $1, %%ymm1, %%ymm1\n"
+			"vpand	%[mask], %%ymm0, %%ymm0\n"
+			"vpand	%[mask], %%ymm1, %%ymm1\n"
+			"vpaddw	 %%ymm1, %%ymm0, %%ymm0\n"
+
+			// Put destination pixels.
+			"vmovdqu	%%ymm0, (%[outScreen])\n"
+			:
+			: [outScreen] "r" (outScreen)
+#ifdef DO_2FB
+			, [mdScreen] "r" (mdScreen)
+#endif
+			, [mask] "m" (*mask)
+			: "memory"
+#ifdef __SSE__
+			, "xmm0", "xmm1"
+#endif
+			);
+
+		// Next group of pixels.
+		outScreen += 16;
+#ifdef DO_2FB
+		mdScreen += 16;
+#endif
+	}
+
+	// Prevent AVX/SSE transition penalties.
+	__asm__ __volatile__ ("vzeroupper");
+}
+
+/**
+ * 32-bit color Fast Blur, AVX2-optimized.
+ * @param outScreen [out] Destination screen.
+ * @param mdScreen  [in]  Source screen. [2-FB only]
+ * @param pxCount   [in]  Pixel count.
+ */
+void FastBlurPrivate::DoFastBlur_32_AVX2(
+	uint32_t* RESTRICT outScreen,
+#ifdef DO_2FB
+	const uint32_t* RESTRICT mdScreen,
+#endif
+	unsigned int pxCount)
+{
+	static const uint32_t MASK_DIV2_32_AVX2[8] =
+		{0x007F7F7F, 0x007F7F7F, 0x007F7F7F, 0x007F7F7F,
+		 0x007F7F7F, 0x007F7F7F, 0x007F7F7F, 0x007F7F7F};
+
+	// Blur 8px at a time.
+	// NOTE: The framebuffers are only 16-byte aligned,
+	// so unaligned loads and stores are used.
+	assert(pxCount % 8 == 0);
+	for (pxCount /= 8; pxCount > 0; pxCount--) {
+		__asm__ (
+			// Get source pixels.
+#ifdef DO_2FB
+			"vmovdqu	 (%[mdScreen]), %%ymm0\n"
+			"vmovdqu	4(%[mdScreen]), %%ymm1\n"
+#else /* DO_1FB */
+			"vmovdqu	 (%[outScreen]), %%ymm0\n"
+			"vmovdqu	4(%[outScreen]), %%ymm1\n"
+#endif
+
+			// Blur source pixels.
+			// NOTE: This may lose some precision in the Red LSB on LE architectures.
+			"vpsrld	      $1, %%ymm0, %%ymm0\n"
+			"vpsrld	      $1, %%ymm1, %%ymm1\n"
+			"vpand	%[mask], %%ymm0, %%ymm0\n"
+			"vpand	%[mask], %%ymm1, %%ymm1\n"
+			"vpaddd	 %%ymm1, %%ymm0, %%ymm0\n"
+
+			// Put destination pixels.
+			"vmovdqu	%%ymm0, (%[outScreen])\n"
+			:
+			: [outScreen] "r" (outScreen)
+#ifdef DO_2FB
+			, [mdScreen] "r" (mdScreen)
+#endif
+			, [mask] "m" (MASK_DIV2_32_AVX2[0])
+			: "memory"
+#ifdef __SSE__
+			, "xmm0", "xmm1"
+#endif
+			);
+
+		// Next group of pixels.
+		outScreen += 8;
+#ifdef DO_2FB
+		mdScreen += 8;
+#endif
+	}
+
+	// Prevent AVX/SSE transition penalties.
+	__asm__ __volatile__ ("vzeroupper");
+}
+
 }
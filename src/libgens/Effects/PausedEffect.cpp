@@ -25,6 +25,7 @@
 
 // MD framebuffer.
 #include "../Util/MdFb.hpp"
+#include "../Util/StripeExecutor.hpp"
 
 // C includes.
 #include <stdlib.h>
@@ -77,6 +78,15 @@ class PausedEffectPrivate
 			unsigned int pxCount);
 
 #ifdef HAVE_MMX
+		static inline void DoPausedEffect_32_AVX2(
+			uint32_t* RESTRICT outScreen,
+			unsigned int pxCount);
+
+		static inline void DoPausedEffect_32_AVX2(
+			uint32_t* RESTRICT outScreen,
+			const uint32_t* RESTRICT mdScreen,
+			unsigned int pxCount);
+
 		static inline void DoPausedEffect_32_SSE2(
 			uint32_t* RESTRICT outScreen,
 			unsigned int pxCount);
@@ -95,12 +105,24 @@ class PausedEffectPrivate
 			const uint32_t* RESTRICT mdScreen,
 			unsigned int pxCount);
 #endif
+
+		/**
+		 * Tint pixels using the best available implementation.
+		 * @param bpp Color depth.
+		 * @param outScreen Pointer to the destination pixels.
+		 * @param mdScreen Pointer to the source pixels. (If nullptr, tint outScreen in place.)
+		 * @param pxCount Pixel count.
+		 */
+		static void tintPixels(MdFb::ColorDepth bpp,
+			void* RESTRICT outScreen,
+			const void* RESTRICT mdScreen,
+			unsigned int pxCount);
 };
 
 }
 
 #if defined(HAVE_MMX)
-// MMX/SSE2-optimized functions.
+// MMX/SSE2/AVX2-optimized functions.
 #define __IN_LIBGENS_PAUSEDEFFECT_CPP__
 #define DO_1FB
 #include "PausedEffect.x86.inc.cpp"
@@ -229,42 +251,106 @@ inline void PausedEffectPrivate::T_DoPausedEffect(
 }
 
 /**
- * Tint the screen a purple hue to indicate that emulation is paused.
- * @param outScreen Source and destination screen.
+ * Tint pixels using the best available implementation.
+ * @param bpp Color depth.
+ * @param outScreen Pointer to the destination pixels.
+ * @param mdScreen Pointer to the source pixels. (If nullptr, tint outScreen in place.)
+ * @param pxCount Pixel count.
  */
-void PausedEffect::DoPausedEffect(MdFb *outScreen)
+void PausedEffectPrivate::tintPixels(MdFb::ColorDepth bpp,
+	void* RESTRICT outScreen,
+	const void* RESTRICT mdScreen,
+	unsigned int pxCount)
 {
-	// Reference the framebuffer.
-	outScreen->ref();
-	const unsigned int pxCount = (outScreen->pxPitch() * outScreen->numLines());
-
-	// Render to outScreen.
-	switch (outScreen->bpp()) {
-		case MdFb::BPP_15:
-			PausedEffectPrivate::T_DoPausedEffect<uint16_t, 5, 5, 5>
-				(outScreen->fb16(), pxCount);
+	switch (bpp) {
+		case MdFb::BPP_15: {
+			uint16_t *const out16 = static_cast<uint16_t*>(outScreen);
+			const uint16_t *const md16 = static_cast<const uint16_t*>(mdScreen);
+			if (md16) {
+				T_DoPausedEffect<uint16_t, 5, 5, 5>(out16, md16, pxCount);
+			} else {
+				T_DoPausedEffect<uint16_t, 5, 5, 5>(out16, pxCount);
+			}
 			break;
-		case MdFb::BPP_16:
-			PausedEffectPrivate::T_DoPausedEffect<uint16_t, 5, 6, 5>
-				(outScreen->fb16(), pxCount);
+		}
+
+		case MdFb::BPP_16: {
+			uint16_t *const out16 = static_cast<uint16_t*>(outScreen);
+			const uint16_t *const md16 = static_cast<const uint16_t*>(mdScreen);
+			if (md16) {
+				T_DoPausedEffect<uint16_t, 5, 6, 5>(out16, md16, pxCount);
+			} else {
+				T_DoPausedEffect<uint16_t, 5, 6, 5>(out16, pxCount);
+			}
 			break;
+		}
+
 		case MdFb::BPP_32:
-		default:
+		default: {
+			uint32_t *const out32 = static_cast<uint32_t*>(outScreen);
+			const uint32_t *const md32 = static_cast<const uint32_t*>(mdScreen);
 #ifdef HAVE_MMX
-			if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
-				PausedEffectPrivate::DoPausedEffect_32_SSE2(
-					outScreen->fb32(), pxCount);
+			if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+				if (md32) {
+					DoPausedEffect_32_AVX2(out32, md32, pxCount);
+				} else {
+					DoPausedEffect_32_AVX2(out32, pxCount);
+				}
+				break;
+			} else if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+				if (md32) {
+					DoPausedEffect_32_SSE2(out32, md32, pxCount);
+				} else {
+					DoPausedEffect_32_SSE2(out32, pxCount);
+				}
+				break;
 			} else if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
-				PausedEffectPrivate::DoPausedEffect_32_MMX(
-					outScreen->fb32(), pxCount);
-			} else
+				if (md32) {
+					DoPausedEffect_32_MMX(out32, md32, pxCount);
+				} else {
+					DoPausedEffect_32_MMX(out32, pxCount);
+				}
+				break;
+			}
 #endif /* HAVE_MMX */
-			{
-				PausedEffectPrivate::T_DoPausedEffect<uint32_t, 8, 8, 8>
-					(outScreen->fb32(), pxCount);
+
+			if (md32) {
+				T_DoPausedEffect<uint32_t, 8, 8, 8>(out32, md32, pxCount);
+			} else {
+				T_DoPausedEffect<uint32_t, 8, 8, 8>(out32, pxCount);
 			}
 			break;
+		}
 	}
+}
+
+/**
+ * Tint the screen a purple hue to indicate that emulation is paused.
+ * @param outScreen Source and destination screen.
+ */
+void PausedEffect::DoPausedEffect(MdFb *outScreen)
+{
+	// Reference the framebuffer.
+	outScreen->ref();
+
+	const MdFb::ColorDepth bpp = outScreen->bpp();
+	const unsigned int bytesPerPx = (bpp == MdFb::BPP_32 ? 4 : 2);
+	const unsigned int pxPitch = outScreen->pxPitch();
+	uint8_t *const out = (bpp == MdFb::BPP_32
+		? reinterpret_cast<uint8_t*>(outScreen->fb32())
+		: reinterpret_cast<uint8_t*>(outScreen->fb16()));
+
+	// Each pixel is tinted independently,
+	// so the stripes don't overlap.
+	StripeExecutor::instance()->run(outScreen->numLines(),
+		[=](int first, int count, int stripe) {
+			((void)stripe);
+			const unsigned int pos = (first * pxPitch * bytesPerPx);
+			PausedEffectPrivate::tintPixels(bpp, out + pos, nullptr, count * pxPitch);
+		});
+
+	// The entire framebuffer was modified.
+	outScreen->markAllDirty();
 
 	// Unreference the framebuffer.
 	outScreen->unref();
@@ -281,40 +367,32 @@ void PausedEffect::DoPausedEffect(MdFb* RESTRICT outScreen, const MdFb* RESTRICT
 	outScreen->ref();
 	mdScreen->ref();
 
+	// Convert indexed lines to RGB, if necessary.
+	mdScreen->resolve();
+
 	// Set outScreen's bpp to match mdScreen.
 	outScreen->setBpp(mdScreen->bpp());
 
-	// Pixel count.
 	// TODO: Verify that both framebuffers are the same.
-	const unsigned int pxCount = (outScreen->pxPitch() * outScreen->numLines());
-
-	// Render to outScreen.
-	switch (outScreen->bpp()) {
-		case MdFb::BPP_15:
-			PausedEffectPrivate::T_DoPausedEffect<uint16_t, 5, 5, 5>
-				(outScreen->fb16(), mdScreen->fb16(), pxCount);
-			break;
-		case MdFb::BPP_16:
-			PausedEffectPrivate::T_DoPausedEffect<uint16_t, 5, 6, 5>
-				(outScreen->fb16(), mdScreen->fb16(), pxCount);
-			break;
-		case MdFb::BPP_32:
-		default:
-#ifdef HAVE_MMX
-			if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
-				PausedEffectPrivate::DoPausedEffect_32_SSE2(
-					outScreen->fb32(), mdScreen->fb32(), pxCount);
-			} else if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
-				PausedEffectPrivate::DoPausedEffect_32_MMX(
-					outScreen->fb32(), mdScreen->fb32(), pxCount);
-			} else
-#endif /* HAVE_MMX */
-			{
-				PausedEffectPrivate::T_DoPausedEffect<uint32_t, 8, 8, 8>
-					(outScreen->fb32(), mdScreen->fb32(), pxCount);
-			}
-			break;
-	}
+	const MdFb::ColorDepth bpp = outScreen->bpp();
+	const unsigned int bytesPerPx = (bpp == MdFb::BPP_32 ? 4 : 2);
+	const unsigned int pxPitch = outScreen->pxPitch();
+	uint8_t *const out = (bpp == MdFb::BPP_32
+		? reinterpret_cast<uint8_t*>(outScreen->fb32())
+		: reinterpret_cast<uint8_t*>(outScreen->fb16()));
+	const uint8_t *const md = (bpp == MdFb::BPP_32
+		? reinterpret_cast<const uint8_t*>(mdScreen->fb32())
+		: reinterpret_cast<const uint8_t*>(mdScreen->fb16()));
+
+	StripeExecutor::instance()->run(outScreen->numLines(),
+		[=](int first, int count, int stripe) {
+			((void)stripe);
+			const unsigned int pos = (first * pxPitch * bytesPerPx);
+			PausedEffectPrivate::tintPixels(bpp, out + pos, md + pos, count * pxPitch);
+		});
+
+	// The entire framebuffer was modified.
+	outScreen->markAllDirty();
 
 	// Unreference the framebuffers.
 	outScreen->unref();
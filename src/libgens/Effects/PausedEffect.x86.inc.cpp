@@ -261,4 +261,105 @@ inline void PausedEffectPrivate::DoPausedEffect_32_MMX(
 	__asm__ __volatile__ ("emms");
 }
 
+/**
+ * Tint the screen a purple hue to indicate that emulation is paused.
+ * (32-bit color, AVX2-optimized.)
+ * @param outScreen Pointer to the source/destination screen buffer.
+ * @param mdScreen Pointer to the MD screen buffer. [2-FB only]
+ * @param pxCount Pixel count.
+ */
+inline void PausedEffectPrivate::DoPausedEffect_32_AVX2(
+	uint32_t* RESTRICT outScreen,
+#ifdef DO_2FB
+	const uint32_t* RESTRICT mdScreen,
+#endif
+	unsigned int pxCount)
+{
+	// Grayscale vector: [0.299 0.587 0.114] (ITU-R BT.601)
+	// Source: http://en.wikipedia.org/wiki/YCbCr
+
+	// 32-bit grayscale vector.
+	// Reference: http://www.asmcommunity.net/forums/topic/?id=19704
+	static const uint64_t GRAY_32_AVX2[4] = {
+		0x0000004D0096001D, 0x0000004D0096001D,
+		0x0000004D0096001D, 0x0000004D0096001D};
+	static const uint64_t BLUE_MASK_32_AVX2[4] = {
+		0x000000000000FFFF, 0x000000000000FFFF,
+		0x000000000000FFFF, 0x000000000000FFFF};
+
+	// Convert the pixels to grayscale.
+	// This is the same algorithm as the SSE2 version.
+	// Unpacking and packing both work within 128-bit
+	// lanes, so the pixels end up in the original order.
+	// NOTE: The framebuffers are only 16-byte aligned,
+	// so unaligned loads and stores are used.
+	assert(pxCount % 8 == 0);
+	for (pxCount /= 8; pxCount > 0; pxCount--) {
+		__asm__ (
+			"vpxor		%%ymm0, %%ymm0, %%ymm0\n"
+#ifdef DO_2FB
+			"vmovdqu	(%[mdScreen]), %%ymm1\n"		// Get 8 pixels.
+#else /* DO_1FB */
+			"vmovdqu	(%[outScreen]), %%ymm1\n"		// Get 8 pixels.
+#endif
+			"vpunpckhbw	%%ymm0, %%ymm1, %%ymm2\n"		// Unpack the high pixels of each lane into words.
+			"vpunpcklbw	%%ymm0, %%ymm1, %%ymm1\n"		// Unpack the low pixels of each lane into words.
+
+			"vpmaddwd	%[GRAY_32_AVX2], %%ymm1, %%ymm1\n"	// 0 + R * MULT | G * MULT + B * MULT
+			"vpmaddwd	%[GRAY_32_AVX2], %%ymm2, %%ymm2\n"	// 0 + R * MULT | G * MULT + B * MULT
+
+			// Add the R values to the G+B values.
+			"vpsrlq		$32, %%ymm1, %%ymm3\n"
+			"vpsrlq		$32, %%ymm2, %%ymm4\n"
+			"vpaddd		%%ymm3, %%ymm1, %%ymm1\n"
+			"vpaddd		%%ymm4, %%ymm2, %%ymm2\n"
+
+			// Shuffle words to create an RGB value with 16 bits per component.
+			"vpshuflw	$0xC0, %%ymm1, %%ymm1\n"
+			"vpshuflw	$0xC0, %%ymm2, %%ymm2\n"
+			"vpshufhw	$0xC0, %%ymm1, %%ymm1\n"
+			"vpshufhw	$0xC0, %%ymm2, %%ymm2\n"
+
+			// Mask the blue values and add it again to tint.
+			// NOTE: We're doing byte-wise adds because word-wise would
+			// have extra precision, which can cause the blue value to
+			// be slightly more than double the grayscale value.
+			"vpand		%[BLUE_MASK_32_AVX2], %%ymm1, %%ymm3\n"
+			"vpand		%[BLUE_MASK_32_AVX2], %%ymm2, %%ymm4\n"
+			"vpaddusb	%%ymm3, %%ymm1, %%ymm1\n"
+			"vpaddusb	%%ymm4, %%ymm2, %%ymm2\n"
+
+			// Shift each word to create 8-bit values.
+			"vpsrlw		$8, %%ymm1, %%ymm1\n"
+			"vpsrlw		$8, %%ymm2, %%ymm2\n"
+
+			// Repack %ymm1 and %ymm2 into a single 256-bit value, %ymm1.
+			"vpackuswb	%%ymm2, %%ymm1, %%ymm1\n"
+
+			// Write to the output screen.
+			"vmovdqu	%%ymm1, (%[outScreen])\n"
+			:
+			: [outScreen] "r" (outScreen)
+#ifdef DO_2FB
+			, [mdScreen] "r" (mdScreen)
+#endif
+			, [GRAY_32_AVX2] "m" (GRAY_32_AVX2[0])
+			, [BLUE_MASK_32_AVX2] "m" (BLUE_MASK_32_AVX2[0])
+			: "memory"
+#ifdef __SSE__
+			, "xmm0", "xmm1", "xmm2", "xmm3", "xmm4"
+#endif
+		);
+
+		// Next group of pixels.
+		outScreen += 8;
+#ifdef DO_2FB
+		mdScreen += 8;
+#endif
+	}
+
+	// Prevent AVX/SSE transition penalties.
+	__asm__ __volatile__ ("vzeroupper");
+}
+
 }
@@ -0,0 +1,961 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * Upscaler.cpp: Pixel art upscaling filters.                              *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "Upscaler.hpp"
+#include "Util/MdFb.hpp"
+#include "Util/StripeExecutor.hpp"
+#include "libcompat/cpuflags.h"
+
+// C includes.
+#include <stdint.h>
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
+#define HAVE_MMX
+#endif
+
+namespace LibGens {
+
+class UpscalerPrivate
+{
+	private:
+		UpscalerPrivate();
+		~UpscalerPrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		UpscalerPrivate(const UpscalerPrivate &);
+		UpscalerPrivate &operator=(const UpscalerPrivate &);
+
+	public:
+		/**
+		 * Scale a line horizontally using nearest-neighbor.
+		 * @param out	[out] Destination line. (width * scale pixels)
+		 * @param src	[in] Source line.
+		 * @param width	[in] Width of the source line, in pixels.
+		 * @param scale	[in] Scale factor.
+		 */
+		template<typename pixel>
+		static void T_nearestLine(pixel* RESTRICT out,
+				const pixel* RESTRICT src,
+				int width, int scale);
+
+		/**
+		 * Scale2x a range of pixels.
+		 * @param out0	[out] First destination line.
+		 * @param out1	[out] Second destination line.
+		 * @param B	[in] Line above the source line.
+		 * @param E	[in] Source line.
+		 * @param H	[in] Line below the source line.
+		 * @param x	[in] First pixel to process.
+		 * @param xEnd	[in] Last pixel to process, plus one.
+		 * @param width	[in] Width of the source line, in pixels.
+		 */
+		template<typename pixel>
+		static void T_scale2xRange(pixel* RESTRICT out0, pixel* RESTRICT out1,
+				const pixel *B, const pixel *E, const pixel *H,
+				int x, int xEnd, int width);
+
+		/**
+		 * Scale3x a line.
+		 * @param out0	[out] First destination line.
+		 * @param out1	[out] Second destination line.
+		 * @param out2	[out] Third destination line.
+		 * @param above	[in] Line above the source line.
+		 * @param src	[in] Source line.
+		 * @param below	[in] Line below the source line.
+		 * @param width	[in] Width of the source line, in pixels.
+		 */
+		template<typename pixel>
+		static void T_scale3xLine(pixel* RESTRICT out0,
+				pixel* RESTRICT out1, pixel* RESTRICT out2,
+				const pixel *above, const pixel *src, const pixel *below,
+				int width);
+
+		/**
+		 * xBR color format.
+		 * Channels are stored as red, green, blue.
+		 */
+		struct XbrFormat {
+			uint8_t shift[3];	// Channel shift.
+			uint8_t bits[3];	// Channel size, in bits.
+		};
+		static const XbrFormat xbrFormats[MdFb::BPP_MAX];
+
+		/**
+		 * xBR padding, in pixels.
+		 * The 5x5 neighborhood reads 2px in each direction.
+		 */
+		static const int XBR_PAD = 2;
+
+		/**
+		 * Colors closer than this distance are considered equal.
+		 */
+		static const unsigned int XBR_EQ_THRESHOLD = 155;
+
+		/**
+		 * xBR distance planes.
+		 * Each plane stores the distance between each pixel
+		 * and one of its neighbors.
+		 */
+		enum XbrPlane {
+			XBR_DH = 0,	// (x, y) to (x+1, y)
+			XBR_DV,		// (x, y) to (x, y+1)
+			XBR_DM,		// (x, y) to (x+1, y+1)
+			XBR_DA,		// (x+1, y) to (x, y+1)
+
+			XBR_PLANES
+		};
+
+		/**
+		 * xBR stripe data.
+		 * Source lines are padded by XBR_PAD pixels on each side,
+		 * plus XBR_PAD lines above and below, using the edge pixels.
+		 * This means the neighborhood never needs to be clamped.
+		 */
+		template<typename pixel>
+		struct XbrStripe {
+			int stride;		// Padded width, in pixels.
+			vector<pixel> px;	// Padded source pixels.
+			vector<int16_t> yuv;	// YUV planes. (3 per line)
+			vector<uint16_t> dist;	// Distance planes. (XBR_PLANES per line)
+
+			inline pixel p(int r, int x) const
+				{ return px[(r * stride) + x]; }
+
+			/**
+			 * Get the distance between two pixels.
+			 * Adjacent pixels use the distance planes;
+			 * anything else is calculated from the YUV planes.
+			 * @param r Line.
+			 * @param x Pixel.
+			 * @param dx1 First pixel's X offset.
+			 * @param dy1 First pixel's Y offset.
+			 * @param dx2 Second pixel's X offset.
+			 * @param dy2 Second pixel's Y offset.
+			 * @return Distance.
+			 */
+			inline unsigned int df(int r, int x,
+				int dx1, int dy1, int dx2, int dy2) const;
+		};
+
+		/**
+		 * Convert a pixel to YUV.
+		 * @param px	[in] Pixel.
+		 * @param fmt	[in] Color format.
+		 * @param Y	[out] Y.
+		 * @param U	[out] U.
+		 * @param V	[out] V.
+		 */
+		template<typename pixel>
+		static inline void T_xbrToYuv(pixel px, const XbrFormat &fmt,
+				int16_t *Y, int16_t *U, int16_t *V);
+
+		/**
+		 * Blend two pixels.
+		 * @param a	[in] First pixel.
+		 * @param b	[in] Second pixel.
+		 * @param w	[in] Weight of the second pixel, out of 256.
+		 * @param fmt	[in] Color format.
+		 * @return Blended pixel.
+		 */
+		template<typename pixel>
+		static inline pixel T_xbrBlend(pixel a, pixel b, unsigned int w,
+				const XbrFormat &fmt);
+
+		/**
+		 * Calculate the distance between each pixel of two YUV lines.
+		 * @param out		[out] Distances.
+		 * @param a		[in] Y plane of the first line.
+		 * @param b		[in] Y plane of the second line.
+		 * @param planeSize	[in] Distance between the Y, U, and V planes, in pixels.
+		 * @param pxCount	[in] Pixel count.
+		 */
+		static void xbrDistLine(uint16_t *out,
+				const int16_t *a, const int16_t *b,
+				int planeSize, int pxCount);
+
+		/**
+		 * Apply the xBR rule to one corner of a 2x2 output block.
+		 * The rule is written for the bottom-right corner;
+		 * rot rotates it counterclockwise by 90-degree steps.
+		 * @param out	[in/out] 2x2 output block.
+		 * @param s	[in] xBR stripe data.
+		 * @param r	[in] Line.
+		 * @param x	[in] Pixel.
+		 * @param fmt	[in] Color format.
+		 */
+		template<typename pixel, int rot>
+		static inline void T_xbrCorner(pixel out[4],
+				const XbrStripe<pixel> &s, int r, int x,
+				const XbrFormat &fmt);
+
+		/**
+		 * xBR 2x a stripe of an MdFb.
+		 * @param dest		[out] First destination line for this stripe.
+		 * @param destPitch	[in] Destination pitch, in bytes.
+		 * @param mdScreen	[in] Source screen.
+		 * @param first		[in] First source line.
+		 * @param count		[in] Number of source lines.
+		 */
+		template<typename pixel>
+		static void T_xbr2xStripe(uint8_t* RESTRICT dest, int destPitch,
+				const MdFb* RESTRICT mdScreen, int first, int count);
+
+		/**
+		 * Upscale a stripe of an MdFb.
+		 * @param dest		[out] First destination line for this stripe.
+		 * @param destPitch	[in] Destination pitch, in bytes.
+		 * @param mdScreen	[in] Source screen.
+		 * @param first		[in] First source line.
+		 * @param count		[in] Number of source lines.
+		 * @param filter	[in] Filter.
+		 * @param scale		[in] Scale factor.
+		 */
+		template<typename pixel>
+		static void T_upscaleStripe(uint8_t* RESTRICT dest, int destPitch,
+				const MdFb* RESTRICT mdScreen, int first, int count,
+				Upscaler::Filter filter, int scale);
+
+#ifdef HAVE_MMX
+		static void Nearest2x_16_SSE2(
+			uint16_t* RESTRICT out,
+			const uint16_t* RESTRICT src,
+			unsigned int pxCount);
+		static void Nearest2x_32_SSE2(
+			uint32_t* RESTRICT out,
+			const uint32_t* RESTRICT src,
+			unsigned int pxCount);
+
+		static void Scale2x_16_SSE2(
+			uint16_t* RESTRICT out0, uint16_t* RESTRICT out1,
+			const uint16_t *B, const uint16_t *E, const uint16_t *H,
+			unsigned int pxCount);
+		static void Scale2x_32_SSE2(
+			uint32_t* RESTRICT out0, uint32_t* RESTRICT out1,
+			const uint32_t *B, const uint32_t *E, const uint32_t *H,
+			unsigned int pxCount);
+
+		static void Nearest4x_16_SSE2(
+			uint16_t* RESTRICT out,
+			const uint16_t* RESTRICT src,
+			unsigned int pxCount);
+		static void Nearest4x_32_SSE2(
+			uint32_t* RESTRICT out,
+			const uint32_t* RESTRICT src,
+			unsigned int pxCount);
+
+		static void XbrDist_SSE2(uint16_t *out,
+			const int16_t *a, const int16_t *b,
+			int planeSize, unsigned int pxCount);
+#endif /* HAVE_MMX */
+};
+
+// xBR color formats.
+const UpscalerPrivate::XbrFormat UpscalerPrivate::xbrFormats[MdFb::BPP_MAX] = {
+	{{10, 5, 0}, {5, 5, 5}},	// BPP_15
+	{{11, 5, 0}, {5, 6, 5}},	// BPP_16
+	{{16, 8, 0}, {8, 8, 8}},	// BPP_32
+};
+
+/**
+ * Scale a line horizontally using nearest-neighbor.
+ * @param out	[out] Destination line. (width * scale pixels)
+ * @param src	[in] Source line.
+ * @param width	[in] Width of the source line, in pixels.
+ * @param scale	[in] Scale factor.
+ */
+template<typename pixel>
+void UpscalerPrivate::T_nearestLine(pixel* RESTRICT out,
+		const pixel* RESTRICT src,
+		int width, int scale)
+{
+	for (; width > 0; width--, src++) {
+		const pixel px = *src;
+		for (int i = scale; i > 0; i--) {
+			*out++ = px;
+		}
+	}
+}
+
+/**
+ * Scale2x a range of pixels.
+ * Pixels outside of the line are clamped to the edges.
+ * @param out0	[out] First destination line.
+ * @param out1	[out] Second destination line.
+ * @param B	[in] Line above the source line.
+ * @param E	[in] Source line.
+ * @param H	[in] Line below the source line.
+ * @param x	[in] First pixel to process.
+ * @param xEnd	[in] Last pixel to process, plus one.
+ * @param width	[in] Width of the source line, in pixels.
+ */
+template<typename pixel>
+inline void UpscalerPrivate::T_scale2xRange(pixel* RESTRICT out0, pixel* RESTRICT out1,
+		const pixel *B, const pixel *E, const pixel *H,
+		int x, int xEnd, int width)
+{
+	for (; x < xEnd; x++) {
+		const pixel b = B[x];
+		const pixel d = E[x > 0 ? x - 1 : 0];
+		const pixel e = E[x];
+		const pixel f = E[x < width - 1 ? x + 1 : width - 1];
+		const pixel h = H[x];
+
+		pixel *const p0 = &out0[x * 2];
+		pixel *const p1 = &out1[x * 2];
+		if (b != h && d != f) {
+			p0[0] = (d == b ? d : e);
+			p0[1] = (b == f ? f : e);
+			p1[0] = (d == h ? d : e);
+			p1[1] = (h == f ? f : e);
+		} else {
+			p0[0] = e; p0[1] = e;
+			p1[0] = e; p1[1] = e;
+		}
+	}
+}
+
+/**
+ * Scale3x a line.
+ * Pixels outside of the line are clamped to the edges.
+ * @param out0	[out] First destination line.
+ * @param out1	[out] Second destination line.
+ * @param out2	[out] Third destination line.
+ * @param above	[in] Line above the source line.
+ * @param src	[in] Source line.
+ * @param below	[in] Line below the source line.
+ * @param width	[in] Width of the source line, in pixels.
+ */
+template<typename pixel>
+void UpscalerPrivate::T_scale3xLine(pixel* RESTRICT out0,
+		pixel* RESTRICT out1, pixel* RESTRICT out2,
+		const pixel *above, const pixel *src, const pixel *below,
+		int width)
+{
+	for (int x = 0; x < width; x++, out0 += 3, out1 += 3, out2 += 3) {
+		const int xl = (x > 0 ? x - 1 : 0);
+		const int xr = (x < width - 1 ? x + 1 : width - 1);
+
+		// A B C
+		// D E F
+		// G H I
+		const pixel a = above[xl], b = above[x], c = above[xr];
+		const pixel d = src[xl],   e = src[x],   f = src[xr];
+		const pixel g = below[xl], h = below[x], i = below[xr];
+
+		if (b != h && d != f) {
+			out0[0] = (d == b ? d : e);
+			out0[1] = ((d == b && e != c) || (b == f && e != a) ? b : e);
+			out0[2] = (b == f ? f : e);
+			out1[0] = ((d == b && e != g) || (d == h && e != a) ? d : e);
+			out1[1] = e;
+			out1[2] = ((b == f && e != i) || (h == f && e != c) ? f : e);
+			out2[0] = (d == h ? d : e);
+			out2[1] = ((d == h && e != i) || (h == f && e != g) ? h : e);
+			out2[2] = (h == f ? f : e);
+		} else {
+			out0[0] = e; out0[1] = e; out0[2] = e;
+			out1[0] = e; out1[1] = e; out1[2] = e;
+			out2[0] = e; out2[1] = e; out2[2] = e;
+		}
+	}
+}
+
+/**
+ * Get the distance between two pixels.
+ * Adjacent pixels use the distance planes;
+ * anything else is calculated from the YUV planes.
+ * @param r Line.
+ * @param x Pixel.
+ * @param dx1 First pixel's X offset.
+ * @param dy1 First pixel's Y offset.
+ * @param dx2 Second pixel's X offset.
+ * @param dy2 Second pixel's Y offset.
+ * @return Distance.
+ */
+template<typename pixel>
+inline unsigned int UpscalerPrivate::XbrStripe<pixel>::df(int r, int x,
+	int dx1, int dy1, int dx2, int dy2) const
+{
+	// The offsets are constant in T_xbrCorner(),
+	// so this should be reduced to a single load.
+	if (dy2 < dy1 || (dy2 == dy1 && dx2 < dx1)) {
+		int tmp = dx1; dx1 = dx2; dx2 = tmp;
+		tmp = dy1; dy1 = dy2; dy2 = tmp;
+	}
+
+	int plane = -1;
+	int px = x + dx1;
+	if (dy2 == dy1 && dx2 == dx1 + 1) {
+		plane = XBR_DH;
+	} else if (dy2 == dy1 + 1) {
+		if (dx2 == dx1) {
+			plane = XBR_DV;
+		} else if (dx2 == dx1 + 1) {
+			plane = XBR_DM;
+		} else if (dx2 == dx1 - 1) {
+			plane = XBR_DA;
+			px = x + dx2;
+		}
+	}
+
+	if (plane >= 0) {
+		return dist[((((r + dy1) * XBR_PLANES) + plane) * stride) + px];
+	}
+
+	// Not adjacent.
+	const int16_t *const p1 = &yuv[(r + dy1) * stride * 3 + x + dx1];
+	const int16_t *const p2 = &yuv[(r + dy2) * stride * 3 + x + dx2];
+	unsigned int ret = 0;
+	for (int i = 0; i < 3; i++) {
+		const int d = p1[i * stride] - p2[i * stride];
+		ret += (d < 0 ? -d : d);
+	}
+	return ret;
+}
+
+/**
+ * Convert a pixel to YUV.
+ * @param px	[in] Pixel.
+ * @param fmt	[in] Color format.
+ * @param Y	[out] Y.
+ * @param U	[out] U.
+ * @param V	[out] V.
+ */
+template<typename pixel>
+inline void UpscalerPrivate::T_xbrToYuv(pixel px, const XbrFormat &fmt,
+		int16_t *Y, int16_t *U, int16_t *V)
+{
+	// Expand each channel to 8 bits.
+	int c[3];
+	for (int i = 0; i < 3; i++) {
+		const int bits = fmt.bits[i];
+		const int v = (px >> fmt.shift[i]) & ((1 << bits) - 1);
+		c[i] = (v << (8 - bits)) | (v >> ((bits * 2) - 8));
+	}
+
+	// ITU-R BT.601, 8.8 fixed point.
+	// U and V are offset by 128 before shifting
+	// so negative values aren't shifted.
+	*Y = (int16_t)(((77 * c[0]) + (150 * c[1]) + (29 * c[2])) >> 8);
+	*U = (int16_t)((((-43 * c[0]) - (85 * c[1]) + (128 * c[2]) + 32768) >> 8) - 128);
+	*V = (int16_t)((((128 * c[0]) - (107 * c[1]) - (21 * c[2]) + 32768) >> 8) - 128);
+}
+
+/**
+ * Blend two pixels.
+ * @param a	[in] First pixel.
+ * @param b	[in] Second pixel.
+ * @param w	[in] Weight of the second pixel, out of 256.
+ * @param fmt	[in] Color format.
+ * @return Blended pixel.
+ */
+template<typename pixel>
+inline pixel UpscalerPrivate::T_xbrBlend(pixel a, pixel b, unsigned int w,
+		const XbrFormat &fmt)
+{
+	pixel ret = 0;
+	for (int i = 0; i < 3; i++) {
+		const unsigned int mask = (1U << fmt.bits[i]) - 1;
+		const unsigned int ca = (a >> fmt.shift[i]) & mask;
+		const unsigned int cb = (b >> fmt.shift[i]) & mask;
+		const unsigned int c = ((ca * (256 - w)) + (cb * w)) >> 8;
+		ret |= (pixel)(c << fmt.shift[i]);
+	}
+	return ret;
+}
+
+/**
+ * Calculate the distance between each pixel of two YUV lines.
+ * The distance is |Y1-Y2| + |U1-U2| + |V1-V2|.
+ * @param out		[out] Distances.
+ * @param a		[in] Y plane of the first line.
+ * @param b		[in] Y plane of the second line.
+ * @param planeSize	[in] Distance between the Y, U, and V planes, in pixels.
+ * @param pxCount	[in] Pixel count.
+ */
+void UpscalerPrivate::xbrDistLine(uint16_t *out,
+		const int16_t *a, const int16_t *b,
+		int planeSize, int pxCount)
+{
+	int x = 0;
+#ifdef HAVE_MMX
+	if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+		// 8px at a time.
+		x = pxCount & ~7;
+		XbrDist_SSE2(out, a, b, planeSize, x);
+	}
+#endif /* HAVE_MMX */
+
+	for (; x < pxCount; x++) {
+		unsigned int d = 0;
+		for (int i = 0; i < 3; i++) {
+			const int c = a[x + (i * planeSize)] - b[x + (i * planeSize)];
+			d += (c < 0 ? -c : c);
+		}
+		out[x] = (uint16_t)d;
+	}
+}
+
+/**
+ * Apply the xBR rule to one corner of a 2x2 output block.
+ * The rule is written for the bottom-right corner;
+ * rot rotates it counterclockwise by 90-degree steps.
+ *
+ * Neighborhood, relative to E:
+ *      A1 B1 C1
+ *   A0  A  B  C C4
+ *   D0  D  E  F F4
+ *   G0  G  H  I I4
+ *      G5 H5 I5
+ *
+ * If the E-I diagonal is less of an edge than the H-F diagonal,
+ * the corner is blended towards F or H, whichever is closer to E.
+ * Shallow edges also blend into the neighboring corners.
+ *
+ * @param out	[in/out] 2x2 output block.
+ * @param s	[in] xBR stripe data.
+ * @param r	[in] Line.
+ * @param x	[in] Pixel.
+ * @param fmt	[in] Color format.
+ */
+template<typename pixel, int rot>
+inline void UpscalerPrivate::T_xbrCorner(pixel out[4],
+		const XbrStripe<pixel> &s, int r, int x,
+		const XbrFormat &fmt)
+{
+	// Rotate an offset counterclockwise.
+#define XBR_RX(dx, dy) (rot == 0 ? (dx) : rot == 1 ? (dy) : rot == 2 ? -(dx) : -(dy))
+#define XBR_RY(dx, dy) (rot == 0 ? (dy) : rot == 1 ? -(dx) : rot == 2 ? -(dy) : (dx))
+#define XBR_P(dx, dy) s.p(r + XBR_RY(dx, dy), x + XBR_RX(dx, dy))
+#define XBR_DF(dx1, dy1, dx2, dy2) \
+	s.df(r, x, XBR_RX(dx1, dy1), XBR_RY(dx1, dy1), XBR_RX(dx2, dy2), XBR_RY(dx2, dy2))
+#define XBR_EQ(dx1, dy1, dx2, dy2) (XBR_DF(dx1, dy1, dx2, dy2) < XBR_EQ_THRESHOLD)
+#define XBR_OUT(sx, sy) out[(XBR_RY(sx, sy) > 0 ? 2 : 0) + (XBR_RX(sx, sy) > 0 ? 1 : 0)]
+
+	const pixel PE = XBR_P(0, 0);
+	const pixel PF = XBR_P(1, 0);
+	const pixel PH = XBR_P(0, 1);
+	if (PE == PH || PE == PF)
+		return;
+
+	// Edge weights of the E-I and H-F diagonals.
+	const unsigned int e = XBR_DF(0, 0, 1, -1) + XBR_DF(0, 0, -1, 1) +	// E-C, E-G
+			       XBR_DF(1, 1, 0, 2) + XBR_DF(1, 1, 2, 0) +	// I-H5, I-F4
+			       (XBR_DF(0, 1, 1, 0) << 2);			// H-F
+	const unsigned int i = XBR_DF(0, 1, -1, 0) + XBR_DF(0, 1, 1, 2) +	// H-D, H-I5
+			       XBR_DF(1, 0, 2, 1) + XBR_DF(1, 0, 0, -1) +	// F-I4, F-B
+			       (XBR_DF(0, 0, 1, 1) << 2);			// E-I
+	if (e > i)
+		return;
+
+	const pixel px = (XBR_DF(0, 0, 1, 0) <= XBR_DF(0, 0, 0, 1) ? PF : PH);
+	pixel &n3 = XBR_OUT(1, 1);
+	if (e < i && ((!XBR_EQ(1, 0, 0, -1) && !XBR_EQ(0, 1, -1, 0)) ||
+		      (XBR_EQ(0, 0, 1, 1) && !XBR_EQ(1, 0, 2, 1) && !XBR_EQ(0, 1, 1, 2)) ||
+		      XBR_EQ(0, 0, -1, 1) || XBR_EQ(0, 0, 1, -1)))
+	{
+		// Check for shallow edges.
+		const unsigned int ke = XBR_DF(1, 0, -1, 1);	// F-G
+		const unsigned int ki = XBR_DF(0, 1, 1, -1);	// H-C
+		const pixel PB = XBR_P(0, -1), PC = XBR_P(1, -1);
+		const pixel PD = XBR_P(-1, 0), PG = XBR_P(-1, 1);
+		const bool left = ((ke << 1) <= ki && PE != PG && PD != PG);
+		const bool up = (ke >= (ki << 1) && PE != PC && PB != PC);
+		pixel &n1 = XBR_OUT(1, -1);
+		pixel &n2 = XBR_OUT(-1, 1);
+
+		if (left && up) {
+			n3 = T_xbrBlend<pixel>(n3, px, 224, fmt);
+			n2 = T_xbrBlend<pixel>(n2, px, 64, fmt);
+			n1 = n2;
+		} else if (left) {
+			n3 = T_xbrBlend<pixel>(n3, px, 192, fmt);
+			n2 = T_xbrBlend<pixel>(n2, px, 64, fmt);
+		} else if (up) {
+			n3 = T_xbrBlend<pixel>(n3, px, 192, fmt);
+			n1 = T_xbrBlend<pixel>(n1, px, 64, fmt);
+		} else {
+			// Diagonal.
+			n3 = T_xbrBlend<pixel>(n3, px, 128, fmt);
+		}
+	} else {
+		n3 = T_xbrBlend<pixel>(n3, px, 128, fmt);
+	}
+
+#undef XBR_RX
+#undef XBR_RY
+#undef XBR_P
+#undef XBR_DF
+#undef XBR_EQ
+#undef XBR_OUT
+}
+
+/**
+ * xBR 2x a stripe of an MdFb.
+ * @param dest		[out] First destination line for this stripe.
+ * @param destPitch	[in] Destination pitch, in bytes.
+ * @param mdScreen	[in] Source screen.
+ * @param first		[in] First source line.
+ * @param count		[in] Number of source lines.
+ */
+template<typename pixel>
+void UpscalerPrivate::T_xbr2xStripe(uint8_t* RESTRICT dest, int destPitch,
+		const MdFb* RESTRICT mdScreen, int first, int count)
+{
+	const int width = mdScreen->pxPerLine();
+	const int lastLine = mdScreen->numLines() - 1;
+	const XbrFormat &fmt = xbrFormats[mdScreen->bpp()];
+
+	XbrStripe<pixel> s;
+	s.stride = width + (XBR_PAD * 2);
+	const int stride = s.stride;
+	const int rows = count + (XBR_PAD * 2);
+	s.px.resize(rows * stride);
+	s.yuv.resize(rows * stride * 3);
+	s.dist.assign(rows * stride * XBR_PLANES, 0);
+
+	// Copy the source lines and convert them to YUV.
+	for (int r = 0; r < rows; r++) {
+		int y = first + r - XBR_PAD;
+		y = (y < 0 ? 0 : (y > lastLine ? lastLine : y));
+		const pixel *const src = mdScreen->lineBuf<pixel>(y);
+
+		pixel *const p = &s.px[r * stride];
+		for (int x = 0; x < stride; x++) {
+			const int sx = x - XBR_PAD;
+			p[x] = src[sx < 0 ? 0 : (sx >= width ? width - 1 : sx)];
+		}
+
+		int16_t *const Y = &s.yuv[r * stride * 3];
+		int16_t *const U = Y + stride;
+		int16_t *const V = U + stride;
+		for (int x = 0; x < stride; x++) {
+			if (x > 0 && p[x] == p[x - 1]) {
+				// Same color as the previous pixel.
+				Y[x] = Y[x - 1];
+				U[x] = U[x - 1];
+				V[x] = V[x - 1];
+			} else {
+				T_xbrToYuv<pixel>(p[x], fmt, &Y[x], &U[x], &V[x]);
+			}
+		}
+	}
+
+	// Calculate the distance planes.
+	for (int r = 0; r < rows; r++) {
+		uint16_t *const d = &s.dist[r * stride * XBR_PLANES];
+		const int16_t *const Y0 = &s.yuv[r * stride * 3];
+		xbrDistLine(&d[XBR_DH * stride], Y0, Y0 + 1, stride, stride - 1);
+		if (r == rows - 1)
+			break;
+
+		const int16_t *const Y1 = Y0 + (stride * 3);
+		xbrDistLine(&d[XBR_DV * stride], Y0, Y1, stride, stride);
+		xbrDistLine(&d[XBR_DM * stride], Y0, Y1 + 1, stride, stride - 1);
+		xbrDistLine(&d[XBR_DA * stride], Y0 + 1, Y1, stride, stride - 1);
+	}
+
+	// Scale the lines.
+	for (int r = XBR_PAD; r < count + XBR_PAD; r++, dest += (destPitch * 2)) {
+		pixel *const out0 = reinterpret_cast<pixel*>(dest);
+		pixel *const out1 = reinterpret_cast<pixel*>(dest + destPitch);
+		for (int x = XBR_PAD; x < width + XBR_PAD; x++) {
+			const pixel e = s.p(r, x);
+			pixel out[4] = {e, e, e, e};
+			T_xbrCorner<pixel, 0>(out, s, r, x, fmt);
+			T_xbrCorner<pixel, 1>(out, s, r, x, fmt);
+			T_xbrCorner<pixel, 2>(out, s, r, x, fmt);
+			T_xbrCorner<pixel, 3>(out, s, r, x, fmt);
+
+			const int ox = (x - XBR_PAD) * 2;
+			out0[ox] = out[0]; out0[ox + 1] = out[1];
+			out1[ox] = out[2]; out1[ox + 1] = out[3];
+		}
+	}
+}
+
+/**
+ * Upscale a stripe of an MdFb.
+ * @param dest		[out] First destination line for this stripe.
+ * @param destPitch	[in] Destination pitch, in bytes.
+ * @param mdScreen	[in] Source screen.
+ * @param first		[in] First source line.
+ * @param count		[in] Number of source lines.
+ * @param filter	[in] Filter.
+ * @param scale		[in] Scale factor.
+ */
+template<typename pixel>
+void UpscalerPrivate::T_upscaleStripe(uint8_t* RESTRICT dest, int destPitch,
+		const MdFb* RESTRICT mdScreen, int first, int count,
+		Upscaler::Filter filter, int scale)
+{
+	const int width = mdScreen->pxPerLine();
+	const int lastLine = mdScreen->numLines() - 1;
+	const int outBytesPerLine = width * scale * (int)sizeof(pixel);
+
+	if (filter == Upscaler::UF_XBR) {
+		// xBR works on the whole stripe at once.
+		T_xbr2xStripe<pixel>(dest, destPitch, mdScreen, first, count);
+		return;
+	}
+
+	for (int y = first; y < first + count; y++, dest += (destPitch * scale)) {
+		const pixel *const src = mdScreen->lineBuf<pixel>(y);
+		pixel *const out0 = reinterpret_cast<pixel*>(dest);
+
+		switch (filter) {
+			case Upscaler::UF_NEAREST:
+			default: {
+#ifdef HAVE_MMX
+				if ((scale == 2 || scale == 4) && (CPU_Flags & MDP_CPUFLAG_X86_SSE2)) {
+					// 16 bytes at a time.
+					const int pxSimd = width & ~(int)((16 / sizeof(pixel)) - 1);
+					if (sizeof(pixel) == 2) {
+						if (scale == 2) {
+							Nearest2x_16_SSE2((uint16_t*)out0,
+								(const uint16_t*)src, pxSimd);
+						} else {
+							Nearest4x_16_SSE2((uint16_t*)out0,
+								(const uint16_t*)src, pxSimd);
+						}
+					} else {
+						if (scale == 2) {
+							Nearest2x_32_SSE2((uint32_t*)out0,
+								(const uint32_t*)src, pxSimd);
+						} else {
+							Nearest4x_32_SSE2((uint32_t*)out0,
+								(const uint32_t*)src, pxSimd);
+						}
+					}
+					T_nearestLine<pixel>(&out0[pxSimd * scale], &src[pxSimd],
+							     width - pxSimd, scale);
+				} else
+#endif /* HAVE_MMX */
+				{
+					T_nearestLine<pixel>(out0, src, width, scale);
+				}
+
+				// Duplicate the line.
+				for (int i = 1; i < scale; i++) {
+					memcpy(dest + (destPitch * i), out0, outBytesPerLine);
+				}
+				break;
+			}
+
+			case Upscaler::UF_SCALEX: {
+				const pixel *const above = mdScreen->lineBuf<pixel>(y > 0 ? y - 1 : 0);
+				const pixel *const below = mdScreen->lineBuf<pixel>(y < lastLine ? y + 1 : lastLine);
+				pixel *const out1 = reinterpret_cast<pixel*>(dest + destPitch);
+
+				if (scale == 3) {
+					pixel *const out2 = reinterpret_cast<pixel*>(dest + (destPitch * 2));
+					T_scale3xLine<pixel>(out0, out1, out2, above, src, below, width);
+					break;
+				}
+
+				// Scale2x.
+				int x = 0;
+#ifdef HAVE_MMX
+				if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+					// The first pixel's left neighbor and the last
+					// pixel's right neighbor are clamped, so they're
+					// handled by the generic version.
+					const int vec = (int)(16 / sizeof(pixel));
+					const int pxSimd = ((width - 2) / vec) * vec;
+					T_scale2xRange<pixel>(out0, out1, above, src, below, 0, 1, width);
+					if (sizeof(pixel) == 2) {
+						Scale2x_16_SSE2((uint16_t*)&out0[2], (uint16_t*)&out1[2],
+							(const uint16_t*)&above[1], (const uint16_t*)&src[1],
+							(const uint16_t*)&below[1], pxSimd);
+					} else {
+						Scale2x_32_SSE2((uint32_t*)&out0[2], (uint32_t*)&out1[2],
+							(const uint32_t*)&above[1], (const uint32_t*)&src[1],
+							(const uint32_t*)&below[1], pxSimd);
+					}
+					x = pxSimd + 1;
+				}
+#endif /* HAVE_MMX */
+				T_scale2xRange<pixel>(out0, out1, above, src, below, x, width, width);
+				break;
+			}
+		}
+	}
+}
+
+}
+
+// MMX/SSE2-optimized versions.
+#ifdef HAVE_MMX
+#define __IN_LIBGENS_UPSCALER_CPP__
+#include "Upscaler.x86.inc.cpp"
+#endif /* HAVE_MMX */
+
+namespace LibGens {
+
+/**
+ * Check if a filter supports a scale factor.
+ * @param filter Filter.
+ * @param scale Scale factor.
+ * @return True if the filter supports the scale factor; false if not.
+ */
+bool Upscaler::isSupported(Filter filter, int scale)
+{
+	switch (filter) {
+		case UF_NEAREST:
+			return (scale >= 2 && scale <= 4);
+		case UF_SCALEX:
+			return (scale == 2 || scale == 3);
+		case UF_XBR:
+			return (scale == 2);
+		default:
+			break;
+	}
+	return false;
+}
+
+/**
+ * Get the number of neighboring lines a filter reads.
+ * Each upscaled line depends on this many source lines
+ * above and below its own source line.
+ * @param filter Filter.
+ * @return Number of neighboring lines.
+ */
+int Upscaler::neighborLines(Filter filter)
+{
+	switch (filter) {
+		case UF_SCALEX:
+			return 1;
+		case UF_XBR:
+			return UpscalerPrivate::XBR_PAD;
+		case UF_NEAREST:
+		default:
+			break;
+	}
+	return 0;
+}
+
+/**
+ * Upscale an MdFb.
+ *
+ * The visible area (pxPerLine() x numLines()) is scaled, and
+ * the destination buffer must be at least (pxPerLine() * scale)
+ * by (numLines() * scale) pixels, using mdScreen's color depth.
+ *
+ * @param dest		[out] Destination buffer.
+ * @param destPitch	[in] Destination pitch, in bytes.
+ * @param mdScreen	[in] Source screen.
+ * @param filter	[in] Filter.
+ * @param scale		[in] Scale factor.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int Upscaler::DoUpscale(void* RESTRICT dest, int destPitch,
+			const MdFb* RESTRICT mdScreen,
+			Filter filter, int scale)
+{
+	if (!mdScreen) {
+		return -EINVAL;
+	}
+	return DoUpscaleLines(dest, destPitch, mdScreen, filter, scale,
+			      0, mdScreen->numLines());
+}
+
+/**
+ * Upscale a range of lines of an MdFb.
+ *
+ * dest is the same buffer DoUpscale() would use, so only
+ * lines (first * scale) to ((first + count) * scale) - 1
+ * are written. Neighboring source lines are still read,
+ * as determined by neighborLines().
+ *
+ * @param dest		[out] Destination buffer.
+ * @param destPitch	[in] Destination pitch, in bytes.
+ * @param mdScreen	[in] Source screen.
+ * @param filter	[in] Filter.
+ * @param scale		[in] Scale factor.
+ * @param first		[in] First source line.
+ * @param count		[in] Number of source lines.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int Upscaler::DoUpscaleLines(void* RESTRICT dest, int destPitch,
+			     const MdFb* RESTRICT mdScreen,
+			     Filter filter, int scale,
+			     int first, int count)
+{
+	if (!dest || !mdScreen || !isSupported(filter, scale)) {
+		return -EINVAL;
+	}
+	if (first < 0 || count < 0 || first + count > mdScreen->numLines()) {
+		// Line range is out of bounds.
+		return -EINVAL;
+	}
+
+	const MdFb::ColorDepth bpp = mdScreen->bpp();
+	const int bytesPerPx = (bpp == MdFb::BPP_32 ? 4 : 2);
+	if (destPitch < mdScreen->pxPerLine() * scale * bytesPerPx) {
+		// Destination pitch is too small.
+		return -EINVAL;
+	}
+	if (count == 0) {
+		// Nothing to do.
+		return 0;
+	}
+
+	// Reference the framebuffer.
+	mdScreen->ref();
+
+	// Convert indexed lines to RGB, if necessary.
+	mdScreen->resolve();
+
+	// The source screen isn't modified, and each stripe
+	// writes its own destination lines, so the stripes
+	// can be processed independently.
+	uint8_t *const out = static_cast<uint8_t*>(dest);
+	StripeExecutor::instance()->run(count,
+		[=](int stripeFirst, int stripeCount, int stripe) {
+			((void)stripe);
+			const int line = first + stripeFirst;
+			uint8_t *const stripeOut = out + (line * scale * destPitch);
+			if (bpp == MdFb::BPP_32) {
+				UpscalerPrivate::T_upscaleStripe<uint32_t>(stripeOut,
+					destPitch, mdScreen, line, stripeCount, filter, scale);
+			} else {
+				UpscalerPrivate::T_upscaleStripe<uint16_t>(stripeOut,
+					destPitch, mdScreen, line, stripeCount, filter, scale);
+			}
+		});
+
+	// Unreference the framebuffer.
+	mdScreen->unref();
+	return 0;
+}
+
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * Upscaler.hpp: Pixel art upscaling filters.                              *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_EFFECTS_UPSCALER_HPP__
+#define __LIBGENS_EFFECTS_UPSCALER_HPP__
+
+#include "../macros/common.h"
+
+namespace LibGens {
+
+class MdFb;
+
+class Upscaler
+{
+	public:
+		enum Filter {
+			UF_NEAREST = 0,	// Integer nearest-neighbor. (2x, 3x, 4x)
+			UF_SCALEX,	// Scale2x/Scale3x. (AdvMAME2x/AdvMAME3x)
+			UF_XBR,		// xBR. (2x)
+
+			UF_MAX
+		};
+
+		/**
+		 * Check if a filter supports a scale factor.
+		 * @param filter Filter.
+		 * @param scale Scale factor.
+		 * @return True if the filter supports the scale factor; false if not.
+		 */
+		static bool isSupported(Filter filter, int scale);
+
+		/**
+		 * Get the number of neighboring lines a filter reads.
+		 * Each upscaled line depends on this many source lines
+		 * above and below its own source line.
+		 * @param filter Filter.
+		 * @return Number of neighboring lines.
+		 */
+		static int neighborLines(Filter filter);
+
+		/**
+		 * Upscale an MdFb.
+		 *
+		 * The visible area (pxPerLine() x numLines()) is scaled, and
+		 * the destination buffer must be at least (pxPerLine() * scale)
+		 * by (numLines() * scale) pixels, using mdScreen's color depth.
+		 *
+		 * @param dest		[out] Destination buffer.
+		 * @param destPitch	[in] Destination pitch, in bytes.
+		 * @param mdScreen	[in] Source screen.
+		 * @param filter	[in] Filter.
+		 * @param scale		[in] Scale factor.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int DoUpscale(void* RESTRICT dest, int destPitch,
+				     const MdFb* RESTRICT mdScreen,
+				     Filter filter, int scale);
+
+		/**
+		 * Upscale a range of lines of an MdFb.
+		 *
+		 * dest is the same buffer DoUpscale() would use, so only
+		 * lines (first * scale) to ((first + count) * scale) - 1
+		 * are written. Neighboring source lines are still read,
+		 * as determined by neighborLines().
+		 *
+		 * @param dest		[out] Destination buffer.
+		 * @param destPitch	[in] Destination pitch, in bytes.
+		 * @param mdScreen	[in] Source screen.
+		 * @param filter	[in] Filter.
+		 * @param scale		[in] Scale factor.
+		 * @param first		[in] First source line.
+		 * @param count		[in] Number of source lines.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int DoUpscaleLines(void* RESTRICT dest, int destPitch,
+					  const MdFb* RESTRICT mdScreen,
+					  Filter filter, int scale,
+					  int first, int count);
+
+	private:
+		Upscaler() { }
+		~Upscaler() { }
+};
+
+}
+
+#endif /* __LIBGENS_EFFECTS_UPSCALER_HPP__ */
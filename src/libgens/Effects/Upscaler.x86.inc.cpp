@@ -0,0 +1,402 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * Upscaler.x86.inc.cpp: Pixel art upscaling filters. (x86-optimized)      *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __IN_LIBGENS_UPSCALER_CPP__
+#error Upscaler.x86.inc.cpp should only be included by Upscaler.cpp.
+#endif
+
+#if !defined(__GNUC__) || !(defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
+#error Upscaler.x86.inc.cpp should only be compiled on i386/amd64 with gcc.
+#endif
+
+namespace LibGens {
+
+/**
+ * 15/16-bit color nearest-neighbor 2x, SSE2-optimized.
+ * @param out		[out] Destination line.
+ * @param src		[in]  Source line.
+ * @param pxCount	[in]  Source pixel count.
+ */
+void UpscalerPrivate::Nearest2x_16_SSE2(
+	uint16_t* RESTRICT out,
+	const uint16_t* RESTRICT src,
+	unsigned int pxCount)
+{
+	// Double 8px at a time.
+	assert(pxCount % 8 == 0);
+	for (pxCount /= 8; pxCount > 0; pxCount--) {
+		__asm__ (
+			"movdqu		(%[src]), %%xmm0\n"
+			"movdqa		%%xmm0, %%xmm1\n"
+			"punpcklwd	%%xmm0, %%xmm0\n"
+			"punpckhwd	%%xmm1, %%xmm1\n"
+			"movdqu		%%xmm0,   (%[out])\n"
+			"movdqu		%%xmm1, 16(%[out])\n"
+			:
+			: [out] "r" (out)
+			, [src] "r" (src)
+			: "memory"
+#ifdef __SSE__
+			, "xmm0", "xmm1"
+#endif
+		);
+
+		// Next group of pixels.
+		out += 16;
+		src += 8;
+	}
+}
+
+/**
+ * 32-bit color nearest-neighbor 2x, SSE2-optimized.
+ * @param out		[out] Destination line.
+ * @param src		[in]  Source line.
+ * @param pxCount	[in]  Source pixel count.
+ */
+void UpscalerPrivate::Nearest2x_32_SSE2(
+	uint32_t* RESTRICT out,
+	const uint32_t* RESTRICT src,
+	unsigned int pxCount)
+{
+	// Double 4px at a time.
+	assert(pxCount % 4 == 0);
+	for (pxCount /= 4; pxCount > 0; pxCount--) {
+		__asm__ (
+			"movdqu		(%[src]), %%xmm0\n"
+			"movdqa		%%xmm0, %%xmm1\n"
+			"punpckldq	%%xmm0, %%xmm0\n"
+			"punpckhdq	%%xmm1, %%xmm1\n"
+			"movdqu		%%xmm0,   (%[out])\n"
+			"movdqu		%%xmm1, 16(%[out])\n"
+			:
+			: [out] "r" (out)
+			, [src] "r" (src)
+			: "memory"
+#ifdef __SSE__
+			, "xmm0", "xmm1"
+#endif
+		);
+
+		// Next group of pixels.
+		out += 8;
+		src += 4;
+	}
+}
+
+/**
+ * 15/16-bit color nearest-neighbor 4x, SSE2-optimized.
+ * @param out		[out] Destination line.
+ * @param src		[in]  Source line.
+ * @param pxCount	[in]  Source pixel count.
+ */
+void UpscalerPrivate::Nearest4x_16_SSE2(
+	uint16_t* RESTRICT out,
+	const uint16_t* RESTRICT src,
+	unsigned int pxCount)
+{
+	// Quadruple 8px at a time.
+	assert(pxCount % 8 == 0);
+	for (pxCount /= 8; pxCount > 0; pxCount--) {
+		__asm__ (
+			"movdqu		(%[src]), %%xmm0\n"
+			"movdqa		%%xmm0, %%xmm2\n"
+			"punpcklwd	%%xmm0, %%xmm0\n"
+			"punpckhwd	%%xmm2, %%xmm2\n"
+			"movdqa		%%xmm0, %%xmm1\n"
+			"movdqa		%%xmm2, %%xmm3\n"
+			"punpckldq	%%xmm0, %%xmm0\n"
+			"punpckhdq	%%xmm1, %%xmm1\n"
+			"punpckldq	%%xmm2, %%xmm2\n"
+			"punpckhdq	%%xmm3, %%xmm3\n"
+			"movdqu		%%xmm0,   (%[out])\n"
+			"movdqu		%%xmm1, 16(%[out])\n"
+			"movdqu		%%xmm2, 32(%[out])\n"
+			"movdqu		%%xmm3, 48(%[out])\n"
+			:
+			: [out] "r" (out)
+			, [src] "r" (src)
+			: "memory"
+#ifdef __SSE__
+			, "xmm0", "xmm1", "xmm2", "xmm3"
+#endif
+		);
+
+		// Next group of pixels.
+		out += 32;
+		src += 8;
+	}
+}
+
+/**
+ * 32-bit color nearest-neighbor 4x, SSE2-optimized.
+ * @param out		[out] Destination line.
+ * @param src		[in]  Source line.
+ * @param pxCount	[in]  Source pixel count.
+ */
+void UpscalerPrivate::Nearest4x_32_SSE2(
+	uint32_t* RESTRICT out,
+	const uint32_t* RESTRICT src,
+	unsigned int pxCount)
+{
+	// Quadruple 4px at a time.
+	assert(pxCount % 4 == 0);
+	for (pxCount /= 4; pxCount > 0; pxCount--) {
+		__asm__ (
+			"movdqu		(%[src]), %%xmm0\n"
+			"pshufd		$0x00, %%xmm0, %%xmm1\n"
+			"pshufd		$0x55, %%xmm0, %%xmm2\n"
+			"pshufd		$0xAA, %%xmm0, %%xmm3\n"
+			"pshufd		$0xFF, %%xmm0, %%xmm0\n"
+			"movdqu		%%xmm1,   (%[out])\n"
+			"movdqu		%%xmm2, 16(%[out])\n"
+			"movdqu		%%xmm3, 32(%[out])\n"
+			"movdqu		%%xmm0, 48(%[out])\n"
+			:
+			: [out] "r" (out)
+			, [src] "r" (src)
+			: "memory"
+#ifdef __SSE__
+			, "xmm0", "xmm1", "xmm2", "xmm3"
+#endif
+		);
+
+		// Next group of pixels.
+		out += 16;
+		src += 4;
+	}
+}
+
+/**
+ * Scale2x, SSE2-optimized.
+ *
+ * Each group of pixels is compared with its neighbors:
+ *   B
+ * D E F
+ *   H
+ * If B != H and D != F, each output pixel is replaced with
+ * the neighbor that matches on both of its sides, if any.
+ * Otherwise, all four output pixels are E.
+ *
+ * D and F are loaded from E-1 and E+1, so the caller must
+ * handle the first and last pixels of each line.
+ *
+ * The mask is blended in as E ^ ((E ^ X) & mask).
+ * Only 8 XMM registers are used, so B, D, F, and H are
+ * reloaded from memory instead of being kept in registers.
+ *
+ * @param PCMPEQ	Compare instruction. (pcmpeqw or pcmpeqd)
+ * @param PUNPCKL	Low interleave instruction. (punpcklwd or punpckldq)
+ * @param PUNPCKH	High interleave instruction. (punpckhwd or punpckhdq)
+ * @param PXSIZE	Pixel size, in bytes.
+ */
+#define SCALE2X_SSE2_ASM(PCMPEQ, PUNPCKL, PUNPCKH, PXSIZE) \
+	__asm__ ( \
+		/* xmm0 = E; xmm5 = (B == H) || (D == F) */ \
+		"movdqu		(%[E]), %%xmm0\n" \
+		"movdqu		-" #PXSIZE "(%[E]), %%xmm1\n" \
+		"movdqu		" #PXSIZE "(%[E]), %%xmm2\n" \
+		"movdqu		(%[B]), %%xmm3\n" \
+		"movdqu		(%[H]), %%xmm4\n" \
+		PCMPEQ "	%%xmm4, %%xmm3\n" \
+		"movdqa		%%xmm1, %%xmm5\n" \
+		PCMPEQ "	%%xmm2, %%xmm5\n" \
+		"por		%%xmm3, %%xmm5\n" \
+		\
+		/* First line: E0 = (D == B ? D : E); E1 = (B == F ? F : E) */ \
+		"movdqu		(%[B]), %%xmm3\n" \
+		"movdqa		%%xmm1, %%xmm6\n" \
+		PCMPEQ "	%%xmm3, %%xmm6\n" \
+		"movdqa		%%xmm5, %%xmm7\n" \
+		"pandn		%%xmm6, %%xmm7\n" \
+		"movdqa		%%xmm1, %%xmm6\n" \
+		"pxor		%%xmm0, %%xmm6\n" \
+		"pand		%%xmm7, %%xmm6\n" \
+		"pxor		%%xmm0, %%xmm6\n" \
+		"movdqa		%%xmm3, %%xmm7\n" \
+		PCMPEQ "	%%xmm2, %%xmm7\n" \
+		"movdqa		%%xmm5, %%xmm4\n" \
+		"pandn		%%xmm7, %%xmm4\n" \
+		"movdqa		%%xmm2, %%xmm7\n" \
+		"pxor		%%xmm0, %%xmm7\n" \
+		"pand		%%xmm4, %%xmm7\n" \
+		"pxor		%%xmm0, %%xmm7\n" \
+		"movdqa		%%xmm6, %%xmm4\n" \
+		PUNPCKL "	%%xmm7, %%xmm4\n" \
+		PUNPCKH "	%%xmm7, %%xmm6\n" \
+		"movdqu		%%xmm4,   (%[out0])\n" \
+		"movdqu		%%xmm6, 16(%[out0])\n" \
+		\
+		/* Second line: E2 = (D == H ? D : E); E3 = (H == F ? F : E) */ \
+		"movdqu		(%[H]), %%xmm3\n" \
+		"movdqa		%%xmm1, %%xmm6\n" \
+		PCMPEQ "	%%xmm3, %%xmm6\n" \
+		"movdqa		%%xmm5, %%xmm7\n" \
+		"pandn		%%xmm6, %%xmm7\n" \
+		"movdqa		%%xmm1, %%xmm6\n" \
+		"pxor		%%xmm0, %%xmm6\n" \
+		"pand		%%xmm7, %%xmm6\n" \
+		"pxor		%%xmm0, %%xmm6\n" \
+		"movdqa		%%xmm3, %%xmm7\n" \
+		PCMPEQ "	%%xmm2, %%xmm7\n" \
+		"movdqa		%%xmm5, %%xmm4\n" \
+		"pandn		%%xmm7, %%xmm4\n" \
+		"movdqa		%%xmm2, %%xmm7\n" \
+		"pxor		%%xmm0, %%xmm7\n" \
+		"pand		%%xmm4, %%xmm7\n" \
+		"pxor		%%xmm0, %%xmm7\n" \
+		"movdqa		%%xmm6, %%xmm4\n" \
+		PUNPCKL "	%%xmm7, %%xmm4\n" \
+		PUNPCKH "	%%xmm7, %%xmm6\n" \
+		"movdqu		%%xmm4,   (%[out1])\n" \
+		"movdqu		%%xmm6, 16(%[out1])\n" \
+		: \
+		: [out0] "r" (out0) \
+		, [out1] "r" (out1) \
+		, [B] "r" (B) \
+		, [E] "r" (E) \
+		, [H] "r" (H) \
+		: "memory" \
+		  SCALE2X_SSE2_CLOBBERS \
+	)
+
+#ifdef __SSE__
+#define SCALE2X_SSE2_CLOBBERS \
+	, "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7"
+#else
+#define SCALE2X_SSE2_CLOBBERS
+#endif
+
+/**
+ * 15/16-bit color Scale2x, SSE2-optimized.
+ * @param out0		[out] First destination line.
+ * @param out1		[out] Second destination line.
+ * @param B		[in]  Line above the source line.
+ * @param E		[in]  Source line.
+ * @param H		[in]  Line below the source line.
+ * @param pxCount	[in]  Source pixel count.
+ */
+void UpscalerPrivate::Scale2x_16_SSE2(
+	uint16_t* RESTRICT out0, uint16_t* RESTRICT out1,
+	const uint16_t *B, const uint16_t *E, const uint16_t *H,
+	unsigned int pxCount)
+{
+	// Scale 8px at a time.
+	assert(pxCount % 8 == 0);
+	for (pxCount /= 8; pxCount > 0; pxCount--) {
+		SCALE2X_SSE2_ASM("pcmpeqw", "punpcklwd", "punpckhwd", 2);
+
+		// Next group of pixels.
+		out0 += 16; out1 += 16;
+		B += 8; E += 8; H += 8;
+	}
+}
+
+/**
+ * 32-bit color Scale2x, SSE2-optimized.
+ * @param out0		[out] First destination line.
+ * @param out1		[out] Second destination line.
+ * @param B		[in]  Line above the source line.
+ * @param E		[in]  Source line.
+ * @param H		[in]  Line below the source line.
+ * @param pxCount	[in]  Source pixel count.
+ */
+void UpscalerPrivate::Scale2x_32_SSE2(
+	uint32_t* RESTRICT out0, uint32_t* RESTRICT out1,
+	const uint32_t *B, const uint32_t *E, const uint32_t *H,
+	unsigned int pxCount)
+{
+	// Scale 4px at a time.
+	assert(pxCount % 4 == 0);
+	for (pxCount /= 4; pxCount > 0; pxCount--) {
+		SCALE2X_SSE2_ASM("pcmpeqd", "punpckldq", "punpckhdq", 4);
+
+		// Next group of pixels.
+		out0 += 8; out1 += 8;
+		B += 4; E += 4; H += 4;
+	}
+}
+
+#undef SCALE2X_SSE2_ASM
+#undef SCALE2X_SSE2_CLOBBERS
+
+/**
+ * xBR distance calculation, SSE2-optimized.
+ * The distance is |Y1-Y2| + |U1-U2| + |V1-V2|.
+ * |x| is calculated as max(x, -x).
+ * @param out		[out] Distances.
+ * @param a		[in]  Y plane of the first line.
+ * @param b		[in]  Y plane of the second line.
+ * @param planeSize	[in]  Distance between the Y, U, and V planes, in pixels.
+ * @param pxCount	[in]  Pixel count.
+ */
+void UpscalerPrivate::XbrDist_SSE2(uint16_t *out,
+	const int16_t *a, const int16_t *b,
+	int planeSize, unsigned int pxCount)
+{
+	// U is at (a + planeOffset); V is at (a + (planeOffset * 2)).
+	const intptr_t planeOffset = (intptr_t)planeSize * sizeof(*a);
+
+	// Process 8px at a time.
+	assert(pxCount % 8 == 0);
+	for (pxCount /= 8; pxCount > 0; pxCount--) {
+		__asm__ (
+			/* Y */
+			"movdqu		(%[a]), %%xmm0\n"
+			"movdqu		(%[b]), %%xmm1\n"
+			"psubw		%%xmm1, %%xmm0\n"
+			"pxor		%%xmm1, %%xmm1\n"
+			"psubw		%%xmm0, %%xmm1\n"
+			"pmaxsw		%%xmm1, %%xmm0\n"
+			/* U */
+			"movdqu		(%[a],%[off]), %%xmm2\n"
+			"movdqu		(%[b],%[off]), %%xmm3\n"
+			"psubw		%%xmm3, %%xmm2\n"
+			"pxor		%%xmm3, %%xmm3\n"
+			"psubw		%%xmm2, %%xmm3\n"
+			"pmaxsw		%%xmm3, %%xmm2\n"
+			"paddw		%%xmm2, %%xmm0\n"
+			/* V */
+			"movdqu		(%[a],%[off],2), %%xmm2\n"
+			"movdqu		(%[b],%[off],2), %%xmm3\n"
+			"psubw		%%xmm3, %%xmm2\n"
+			"pxor		%%xmm3, %%xmm3\n"
+			"psubw		%%xmm2, %%xmm3\n"
+			"pmaxsw		%%xmm3, %%xmm2\n"
+			"paddw		%%xmm2, %%xmm0\n"
+			"movdqu		%%xmm0, (%[out])\n"
+			:
+			: [out] "r" (out)
+			, [a] "r" (a)
+			, [b] "r" (b)
+			, [off] "r" (planeOffset)
+			: "memory"
+#ifdef __SSE__
+			, "xmm0", "xmm1", "xmm2", "xmm3"
+#endif
+		);
+
+		// Next group of pixels.
+		out += 8;
+		a += 8; b += 8;
+	}
+}
+
+}
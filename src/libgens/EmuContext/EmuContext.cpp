@@ -40,6 +40,15 @@ using std::string;
 // Maybe fixChecksum() / restoreChecksum() should be moved to EmuMD.
 #include "cpu/M68K_Mem.hpp"
 
+// State hash.
+#include "StateHash.hpp"
+#include "cpu/M68K.hpp"
+#include "sound/SoundMgr.hpp"
+#include "libzomg/zomg_m68k.h"
+
+// C includes. (C++ namespace)
+#include <cstring>
+
 namespace LibGens
 {
 
@@ -141,4 +150,66 @@ void EmuContext::SetPathSRam(const std::string &newPathSRam)
 	// TODO: Update SRam/EEPRom classes in active contexts.
 }
 
+/**
+ * Hash the current emulation state.
+ * This should be called after a frame is run.
+ * Two runs with the same inputs and starting
+ * state should produce identical hashes on
+ * every frame; see StateHash::compare().
+ *
+ * The base class hashes the hardware that's common
+ * to all MD-based systems: 68000, VDP, YM2612, and PSG.
+ *
+ * @param hash	[out] State hash.
+ * @param flags	[in] Optional subsystems. (StateHash::Flags)
+ */
+void EmuContext::stateHash(StateHash *hash, unsigned int flags) const
+{
+	hash->clear();
+
+	// 68000.
+	// NOTE: The register structs are cleared first
+	// so padding and unused fields don't affect the hash.
+	hash->set(StateHash::SS_M68K_RAM, Ram_68k.u16, sizeof(Ram_68k.u16));
+	Zomg_M68KRegSave_t m68k_reg;
+	memset(&m68k_reg, 0, sizeof(m68k_reg));
+	M68K::ZomgSaveReg(&m68k_reg);
+	hash->set(StateHash::SS_M68K_REG, &m68k_reg, sizeof(m68k_reg));
+
+	// VDP.
+	m_vdp->stateHashMD(hash);
+
+	// Audio.
+	SoundMgr::ms_Ym2612.stateHash(hash);
+	SoundMgr::ms_Psg.stateHash(hash);
+
+	if (flags & StateHash::HASH_FRAMEBUFFER) {
+		// Hash the visible area of each line.
+		// In indexed color mode, the RGB lines must be
+		// resolved first; otherwise, they're stale.
+		const MdFb *fb = m_vdp->MD_Screen;
+		fb->resolve();
+		const int lines = fb->numLines();
+		const int px = fb->pxPerLine();
+		if (fb->bpp() == MdFb::BPP_32) {
+			for (int line = 0; line < lines; line++) {
+				hash->append(StateHash::SS_FRAMEBUFFER,
+					     fb->lineBuf32(line), px * sizeof(uint32_t));
+			}
+		} else {
+			for (int line = 0; line < lines; line++) {
+				hash->append(StateHash::SS_FRAMEBUFFER,
+					     fb->lineBuf16(line), px * sizeof(uint16_t));
+			}
+		}
+	}
+
+	if (flags & StateHash::HASH_AUDIO) {
+		// Hash the frame's audio segment.
+		const size_t len = SoundMgr::GetSegLength() * sizeof(SoundMgr::ms_SegBufL[0]);
+		hash->set(StateHash::SS_AUDIO, SoundMgr::ms_SegBufL, len);
+		hash->append(StateHash::SS_AUDIO, SoundMgr::ms_SegBufR, len);
+	}
+}
+
 }
@@ -40,8 +40,14 @@
 // C++ includes.
 #include <string>
 
+namespace LibZomg {
+	class Zomg;
+}
+
 namespace LibGens {
 
+class StateHash;
+
 class EmuContext
 {
 	public:
@@ -70,10 +76,19 @@ class EmuContext
 
 		/**
 		 * AutoSave SRam/EEPRom.
-		 * @param frames Number of frames elapsed, or -1 for paused. (force autosave)
+		 * Modified pages are written automatically in the background.
+		 * This writes any pending pages immediately, e.g. on pause.
 		 * @return 1 if SRam was saved; 2 if EEPRom was saved; 0 if nothing was saved. (TODO: Enum?)
 		 */
-		virtual int autoSaveData(int framesElapsed) = 0;
+		virtual int autoSaveData(void) = 0;
+
+		/**
+		 * Clear SRam/EEPRom and detach it from the save file.
+		 * Nothing will be loaded from or saved to the save file.
+		 * This is used for input movies, which must not
+		 * depend on or modify the user's save data.
+		 */
+		virtual void unloadSaveData(void) = 0;
 
 		/**
 		 * Perform a soft reset.
@@ -141,6 +156,32 @@ class EmuContext
 		 */
 		virtual int zomgSave(const char *filename) const = 0;
 
+		/**
+		 * Save the current state to a ZOMG object.
+		 * If the ZOMG was opened with ZOMG_SAVE_DEFERRED, this
+		 * only copies the state into memory. Compression and
+		 * file writes are done by Zomg::writeDeferred().
+		 * The ZOMG object is not closed.
+		 * @param zomg		[in] ZOMG object, opened for saving.
+		 * @return 0 on success; negative errno on error.
+		 */
+		virtual int zomgSave(LibZomg::Zomg *zomg) const = 0;
+
+		/**
+		 * Hash the current emulation state.
+		 * This should be called after a frame is run.
+		 * Two runs with the same inputs and starting
+		 * state should produce identical hashes on
+		 * every frame; see StateHash::compare().
+		 *
+		 * The base class hashes the hardware that's common
+		 * to all MD-based systems: 68000, VDP, YM2612, and PSG.
+		 *
+		 * @param hash	[out] State hash.
+		 * @param flags	[in] Optional subsystems. (StateHash::Flags)
+		 */
+		virtual void stateHash(StateHash *hash, unsigned int flags = 0) const;
+
 		/**
 		 * Global settings.
 		 */
@@ -29,6 +29,11 @@
 // CPU emulators.
 #include "cpu/M68K.hpp"
 #include "cpu/Z80.hpp"
+#include "cpu/Z80_MD_Mem.hpp"
+
+// State hash.
+#include "StateHash.hpp"
+#include "libzomg/zomg_z80.h"
 
 // Sound Manager.
 #include "sound/SoundMgr.hpp"
@@ -42,6 +47,7 @@
 // C includes. (C++ namespace)
 #include <cstdio>
 #include <cmath>
+#include <cstring>
 
 // C++ namespace.
 #include <memory>
@@ -288,19 +294,32 @@ int EmuMD::saveData(void)
 
 /**
  * AutoSave SRam/EEPRom.
- * @param frames Number of frames elapsed, or -1 for paused. (force autosave)
+ * Modified pages are written automatically in the background.
+ * This writes any pending pages immediately, e.g. on pause.
  * @return 1 if SRam was saved; 2 if EEPRom was saved; 0 if nothing was saved. (TODO: Enum?)
  */
-int EmuMD::autoSaveData(int framesElapsed)
+int EmuMD::autoSaveData(void)
 {
 	// TODO: Call lg_osd here instead of in RomCartridgeMD().
 	if (M68K_Mem::ms_RomCartridge)
-		return M68K_Mem::ms_RomCartridge->autoSaveData(framesElapsed);
+		return M68K_Mem::ms_RomCartridge->autoSaveData();
 
 	// Nothing was saved.
 	return 0;
 }
 
+/**
+ * Clear SRam/EEPRom and detach it from the save file.
+ * Nothing will be loaded from or saved to the save file.
+ * This is used for input movies, which must not
+ * depend on or modify the user's save data.
+ */
+void EmuMD::unloadSaveData(void)
+{
+	if (M68K_Mem::ms_RomCartridge)
+		M68K_Mem::ms_RomCartridge->unloadSaveData();
+}
+
 /**
  * Initialize TMSS.
  * If TMSS is enabled by the user, this
@@ -329,8 +348,8 @@ template<EmuMD::LineType_t LineType, bool VDP>
 FORCE_INLINE void EmuMD::T_execLine(void)
 {
 	int writePos = SoundMgr::GetWritePos(m_vdp->VDP_Lines.currentLine);
-	int32_t *bufL = &SoundMgr::ms_SegBufL[writePos];
-	int32_t *bufR = &SoundMgr::ms_SegBufR[writePos];
+	int32_t *bufL = &SoundMgr::ms_RenderBufL[writePos];
+	int32_t *bufR = &SoundMgr::ms_RenderBufR[writePos];
 
 	// Update the sound chips.
 	int writeLen = SoundMgr::GetWriteLen(m_vdp->VDP_Lines.currentLine);
@@ -338,6 +357,10 @@ FORCE_INLINE void EmuMD::T_execLine(void)
 	SoundMgr::ms_Ym2612.addWriteLen(writeLen);
 	SoundMgr::ms_Psg.addWriteLen(writeLen);
 
+	// Register writes during this scanline are
+	// timestamped at the end of the rendered audio.
+	SoundMgr::AdvanceCapture(writeLen);
+
 	// Notify controllers that a new scanline is being drawn.
 	m_ioManager->doScanline();
 
@@ -488,14 +511,9 @@ FORCE_INLINE void EmuMD::T_execFrame(void)
 	// Update the PSG and YM2612 output.
 	SoundMgr::SpecialUpdate();
 
-#if 0
-	// If WAV or GYM is being dumped, update the WAV or GYM.
-	// TODO: VGM dumping
-	if (WAV_Dumping)
-		wav_dump_update();
-	if (GYM_Dumping)
-		gym_dump_update(0, 0, 0);
-#endif
+	// NOTE: Audio capture is handled by SoundMgr.
+	// VGM timestamps are advanced in T_execLine(),
+	// and WAV audio is saved by SoundMgr::write*().
 
 	// TODO: MDP. (LibGens)
 #if 0
@@ -529,4 +547,23 @@ void EmuMD::execFrameFast(void)
 	T_execFrame<false>();
 }
 
+/**
+ * Hash the current emulation state.
+ * This adds the Z80 to the base class's hash.
+ * @param hash	[out] State hash.
+ * @param flags	[in] Optional subsystems. (StateHash::Flags)
+ */
+void EmuMD::stateHash(StateHash *hash, unsigned int flags) const
+{
+	EmuContext::stateHash(hash, flags);
+
+	// Z80.
+	// TODO: Use the correct size based on system.
+	hash->set(StateHash::SS_Z80_RAM, Ram_Z80, 8192);
+	Zomg_Z80RegSave_t z80_reg;
+	memset(&z80_reg, 0, sizeof(z80_reg));
+	Z80::ZomgSaveReg(&z80_reg);
+	hash->set(StateHash::SS_Z80_REG, &z80_reg, sizeof(z80_reg));
+}
+
 }
@@ -71,10 +71,19 @@ class EmuMD : public EmuContext
 
 		/**
 		 * AutoSave SRam/EEPRom.
-		 * @param frames Number of frames elapsed, or -1 for paused. (force autosave)
+		 * Modified pages are written automatically in the background.
+		 * This writes any pending pages immediately, e.g. on pause.
 		 * @return 1 if SRam was saved; 2 if EEPRom was saved; 0 if nothing was saved. (TODO: Enum?)
 		 */
-		virtual int autoSaveData(int framesElapsed) final;
+		virtual int autoSaveData(void) final;
+
+		/**
+		 * Clear SRam/EEPRom and detach it from the save file.
+		 * Nothing will be loaded from or saved to the save file.
+		 * This is used for input movies, which must not
+		 * depend on or modify the user's save data.
+		 */
+		virtual void unloadSaveData(void) final;
 
 		/** Frame execution functions. **/
 		virtual void execFrame(void) final;
@@ -96,6 +105,26 @@ class EmuMD : public EmuContext
 		 */
 		virtual int zomgSave(const char *filename) const final;
 
+		/**
+		 * Save the current state to a ZOMG object.
+		 * If the ZOMG was opened with ZOMG_SAVE_DEFERRED, this
+		 * only copies the state into memory. Compression and
+		 * file writes are done by Zomg::writeDeferred().
+		 * The ZOMG object is not closed.
+		 * @param zomg		[in] ZOMG object, opened for saving.
+		 * @return 0 on success; non-zero on error.
+		 * TODO: Error code constants.
+		 */
+		virtual int zomgSave(LibZomg::Zomg *zomg) const final;
+
+		/**
+		 * Hash the current emulation state.
+		 * This adds the Z80 to the base class's hash.
+		 * @param hash	[out] State hash.
+		 * @param flags	[in] Optional subsystems. (StateHash::Flags)
+		 */
+		virtual void stateHash(StateHash *hash, unsigned int flags = 0) const final;
+
 	protected:
 		/**
 		 * Line types.
@@ -69,6 +69,7 @@
 
 // C++ includes.
 #include <string>
+#include <thread>
 using std::string;
 
 #ifdef _WIN32
@@ -107,6 +108,15 @@ int EmuMD::zomgLoad(const char *filename)
 	// TODO: Check error codes from the ZOMG functions.
 	// TODO: Load everything first, *then* copy it to LibGens.
 
+	// Load the M68K and Z80 memory on a separate thread.
+	// These are the largest sections, and nothing
+	// else that's restored here depends on them.
+	// TODO: Use the correct Z80 memory size based on system.
+	std::thread memLoader([&zomg]() {
+		zomg.loadM68KMem(Ram_68k.u16, sizeof(Ram_68k.u16), ZOMG_BYTEORDER_16H);
+		zomg.loadZ80Mem(Ram_Z80, 8192);
+	});
+
 	/** VDP **/
 	m_vdp->zomgRestoreMD(&zomg);
 
@@ -124,11 +134,10 @@ int EmuMD::zomgLoad(const char *filename)
 	zomg.loadMD_YM2612_reg(&ym2612_save);
 	SoundMgr::ms_Ym2612.zomgRestore(&ym2612_save);
 
-	/** Z80 **/
+	// Wait for the M68K and Z80 memory.
+	memLoader.join();
 
-	// Load the Z80 memory.
-	// TODO: Use the correct size based on system.
-	zomg.loadZ80Mem(Ram_Z80, 8192);
+	/** Z80 **/
 
 	// Load the Z80 registers.
 	Zomg_Z80RegSave_t z80_reg_save;
@@ -137,9 +146,6 @@ int EmuMD::zomgLoad(const char *filename)
 
 	/** MD: M68K **/
 
-	// Load the M68K memory.
-	zomg.loadM68KMem(Ram_68k.u16, sizeof(Ram_68k.u16), ZOMG_BYTEORDER_16H);
-
 	// Load the M68K registers.
 	Zomg_M68KRegSave_t m68k_reg_save;
 	zomg.loadM68KReg(&m68k_reg_save);
@@ -213,11 +219,36 @@ int EmuMD::zomgLoad(const char *filename)
  */
 int EmuMD::zomgSave(const char *filename) const
 {
+	// Rom object has some useful ROM information.
+	if (!m_rom)
+		return -EINVAL;
+
 	// TODO: More comprehensive error reporting.
 	LibZomg::Zomg zomg(filename, LibZomg::Zomg::ZOMG_SAVE);
 	if (!zomg.isOpen())
 		return -ENOENT;
 
+	int ret = zomgSave(&zomg);
+
+	// Close the savestate.
+	zomg.close();
+	return ret;
+}
+
+/**
+ * Save the current state to a ZOMG object.
+ * If the ZOMG was opened with ZOMG_SAVE_DEFERRED, this
+ * only copies the state into memory. Compression and
+ * file writes are done by Zomg::writeDeferred().
+ * The ZOMG object is not closed.
+ * @param zomg		[in] ZOMG object, opened for saving.
+ * @return 0 on success; negative errno on error.
+ */
+int EmuMD::zomgSave(LibZomg::Zomg *zomg) const
+{
+	if (!zomg || !zomg->isOpen())
+		return -EBADF;
+
 	// Rom object has some useful ROM information.
 	if (!m_rom)
 		return -EINVAL;
@@ -237,7 +268,7 @@ int EmuMD::zomgSave(const char *filename) const
 	metadata.setExtensions("EXT,THAT,DOESNT,EXIST,LOL");
 
 	// Save ZOMG.ini.
-	int ret = zomg.saveZomgIni(&metadata);
+	int ret = zomg->saveZomgIni(&metadata);
 	if (ret != 0) {
 		// Error saving ZOMG.ini.
 		return ret;
@@ -247,7 +278,7 @@ int EmuMD::zomgSave(const char *filename) const
 	// TODO: Use the existing metadata?
 	// TODO: Check the return value?
 	MdFb *fb = m_vdp->MD_Screen->ref();
-	Screenshot::toZomg(&zomg, fb, m_rom);
+	Screenshot::toZomg(zomg, fb, m_rom);
 	fb->unref();
 
 	// TODO: This is MD only!
@@ -255,42 +286,42 @@ int EmuMD::zomgSave(const char *filename) const
 	// TODO: Load everything first, *then* copy it to LibGens.
 	
 	/** VDP **/
-	m_vdp->zomgSaveMD(&zomg);
+	m_vdp->zomgSaveMD(zomg);
 	
 	/** Audio **/
 	
 	// Save the PSG state.
 	Zomg_PsgSave_t psg_save;
 	SoundMgr::ms_Psg.zomgSave(&psg_save);
-	zomg.savePsgReg(&psg_save);
+	zomg->savePsgReg(&psg_save);
 	
 	/** Audio: MD-specific **/
 	
 	// Save the YM2612 register state.
 	Zomg_Ym2612Save_t ym2612_save;
 	SoundMgr::ms_Ym2612.zomgSave(&ym2612_save);
-	zomg.saveMD_YM2612_reg(&ym2612_save);
+	zomg->saveMD_YM2612_reg(&ym2612_save);
 	
 	/** Z80 **/
 	
 	// Save the Z80 memory.
 	// TODO: Use the correct size based on system.
-	zomg.saveZ80Mem(Ram_Z80, 8192);
+	zomg->saveZ80Mem(Ram_Z80, 8192);
 	
 	// Save the Z80 registers.
 	Zomg_Z80RegSave_t z80_reg_save;
 	Z80::ZomgSaveReg(&z80_reg_save);
-	zomg.saveZ80Reg(&z80_reg_save);
+	zomg->saveZ80Reg(&z80_reg_save);
 	
 	/** MD: M68K **/
 	
 	// Save the M68K memory.
-	zomg.saveM68KMem(Ram_68k.u16, sizeof(Ram_68k.u16), ZOMG_BYTEORDER_16H);
+	zomg->saveM68KMem(Ram_68k.u16, sizeof(Ram_68k.u16), ZOMG_BYTEORDER_16H);
 	
 	// Save the M68K registers.
 	Zomg_M68KRegSave_t m68k_reg_save;
 	M68K::ZomgSaveReg(&m68k_reg_save);
-	zomg.saveM68KReg(&m68k_reg_save);
+	zomg->saveM68KReg(&m68k_reg_save);
 	
 	/** MD: Other **/
 	
@@ -299,21 +330,21 @@ int EmuMD::zomgSave(const char *filename) const
 	Zomg_MD_IoSave_t md_io_save;
 	m_ioManager->zomgSaveMD(&md_io_save);
 	md_io_save.version_reg = readVersionRegister_MD();
-	zomg.saveMD_IO(&md_io_save);
+	zomg->saveMD_IO(&md_io_save);
 
 	// Save the Z80 control registers.
 	Zomg_MD_Z80CtrlSave_t md_z80_ctrl_save;
 	md_z80_ctrl_save.busreq    = !(M68K_Mem::Z80_State & Z80_STATE_BUSREQ);
 	md_z80_ctrl_save.reset     = !(M68K_Mem::Z80_State & Z80_STATE_RESET);
 	md_z80_ctrl_save.m68k_bank = ((Z80_MD_Mem::Bank_Z80 >> 15) & 0x1FF);
-	zomg.saveMD_Z80Ctrl(&md_z80_ctrl_save);
+	zomg->saveMD_Z80Ctrl(&md_z80_ctrl_save);
 	
 	// Save the cartridge data.
 	// This includes:
 	// - MD /TIME registers. (SRAM control, etc.)
 	// - SRAM data.
 	// - EEPROM control and data.
-	M68K_Mem::ms_RomCartridge->zomgSave(&zomg);
+	M68K_Mem::ms_RomCartridge->zomgSave(zomg);
 
 	if (M68K_Mem::tmss_reg.isTmssEnabled()) {
 		// TMSS is enabled.
@@ -323,14 +354,11 @@ int EmuMD::zomgSave(const char *filename) const
 		tmss.header = ZOMG_MD_TMSS_REG_HEADER;
 		tmss.a14000 = M68K_Mem::tmss_reg.a14000.d;
 		tmss.n_cart_ce = M68K_Mem::tmss_reg.n_cart_ce & 1;
-		zomg.saveMD_TMSS_reg(&tmss);
+		zomg->saveMD_TMSS_reg(&tmss);
 	} else {
 		// TODO: Delete MD/TMSS_reg.bin from the savestate?
 	}
 
-	// Close the savestate.
-	zomg.close();
-	
 	// Savestate saved.
 	return 0;
 }
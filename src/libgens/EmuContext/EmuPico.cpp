@@ -262,19 +262,32 @@ int EmuPico::saveData(void)
 
 /**
  * AutoSave SRam/EEPRom.
- * @param frames Number of frames elapsed, or -1 for paused. (force autosave)
+ * Modified pages are written automatically in the background.
+ * This writes any pending pages immediately, e.g. on pause.
  * @return 1 if SRam was saved; 2 if EEPRom was saved; 0 if nothing was saved. (TODO: Enum?)
  */
-int EmuPico::autoSaveData(int framesElapsed)
+int EmuPico::autoSaveData(void)
 {
 	// TODO: Call lg_osd here instead of in RomCartridgeMD().
 	if (M68K_Mem::ms_RomCartridge)
-		return M68K_Mem::ms_RomCartridge->autoSaveData(framesElapsed);
+		return M68K_Mem::ms_RomCartridge->autoSaveData();
 
 	// Nothing was saved.
 	return 0;
 }
 
+/**
+ * Clear SRam/EEPRom and detach it from the save file.
+ * Nothing will be loaded from or saved to the save file.
+ * This is used for input movies, which must not
+ * depend on or modify the user's save data.
+ */
+void EmuPico::unloadSaveData(void)
+{
+	if (M68K_Mem::ms_RomCartridge)
+		M68K_Mem::ms_RomCartridge->unloadSaveData();
+}
+
 /**
  * Run a scanline.
  * @param LineType Line type.
@@ -287,6 +300,10 @@ FORCE_INLINE void EmuPico::T_execLine(void)
 	int writeLen = SoundMgr::GetWriteLen(m_vdp->VDP_Lines.currentLine);
 	SoundMgr::ms_Psg.addWriteLen(writeLen);
 
+	// Register writes during this scanline are
+	// timestamped at the end of the rendered audio.
+	SoundMgr::AdvanceCapture(writeLen);
+
 	// Notify controllers that a new scanline is being drawn.
 	m_ioManager->doScanline();
 
@@ -424,14 +441,9 @@ FORCE_INLINE void EmuPico::T_execFrame(void)
 	// Update the PSG and YM2612 output.
 	SoundMgr::SpecialUpdate();
 
-#if 0
-	// If WAV or GYM is being dumped, update the WAV or GYM.
-	// TODO: VGM dumping
-	if (WAV_Dumping)
-		wav_dump_update();
-	if (GYM_Dumping)
-		gym_dump_update(0, 0, 0);
-#endif
+	// NOTE: Audio capture is handled by SoundMgr.
+	// VGM timestamps are advanced in T_execLine(),
+	// and WAV audio is saved by SoundMgr::write*().
 
 	// TODO: MDP . (LibGens)
 #if 0
@@ -148,11 +148,36 @@ int EmuPico::zomgLoad(const char *filename)
  */
 int EmuPico::zomgSave(const char *filename) const
 {
+	// Rom object has some useful ROM information.
+	if (!m_rom)
+		return -EINVAL;
+
 	// TODO: More comprehensive error reporting.
 	LibZomg::Zomg zomg(filename, LibZomg::Zomg::ZOMG_SAVE);
 	if (!zomg.isOpen())
 		return -ENOENT;
 
+	int ret = zomgSave(&zomg);
+
+	// Close the savestate.
+	zomg.close();
+	return ret;
+}
+
+/**
+ * Save the current state to a ZOMG object.
+ * If the ZOMG was opened with ZOMG_SAVE_DEFERRED, this
+ * only copies the state into memory. Compression and
+ * file writes are done by Zomg::writeDeferred().
+ * The ZOMG object is not closed.
+ * @param zomg		[in] ZOMG object, opened for saving.
+ * @return 0 on success; negative errno on error.
+ */
+int EmuPico::zomgSave(LibZomg::Zomg *zomg) const
+{
+	if (!zomg || !zomg->isOpen())
+		return -EBADF;
+
 	// Rom object has some useful ROM information.
 	if (!m_rom)
 		return -EINVAL;
@@ -173,7 +198,7 @@ int EmuPico::zomgSave(const char *filename) const
 	metadata.setExtensions("EXT,THAT,DOESNT,EXIST,LOL");
 
 	// Save ZOMG.ini.
-	int ret = zomg.saveZomgIni(&metadata);
+	int ret = zomg->saveZomgIni(&metadata);
 	if (ret != 0) {
 		// Error saving ZOMG.ini.
 		return ret;
@@ -183,31 +208,31 @@ int EmuPico::zomgSave(const char *filename) const
 	// TODO: Use the existing metadata?
 	// TODO: Check the return value?
 	MdFb *fb = m_vdp->MD_Screen->ref();
-	Screenshot::toZomg(&zomg, fb, m_rom);
+	Screenshot::toZomg(zomg, fb, m_rom);
 	fb->unref();
 
 	// TODO: Check error codes from the ZOMG functions.
 	// TODO: Load everything first, *then* copy it to LibGens.
 
 	/** VDP **/
-	m_vdp->zomgSaveMD(&zomg);
+	m_vdp->zomgSaveMD(zomg);
 
 	/** Audio **/
 
 	// Save the PSG state.
 	Zomg_PsgSave_t psg_save;
 	SoundMgr::ms_Psg.zomgSave(&psg_save);
-	zomg.savePsgReg(&psg_save);
+	zomg->savePsgReg(&psg_save);
 
 	/** MD: M68K **/
 
 	// Save the M68K memory.
-	zomg.saveM68KMem(Ram_68k.u16, sizeof(Ram_68k.u16), ZOMG_BYTEORDER_16H);
+	zomg->saveM68KMem(Ram_68k.u16, sizeof(Ram_68k.u16), ZOMG_BYTEORDER_16H);
 
 	// Save the M68K registers.
 	Zomg_M68KRegSave_t m68k_reg_save;
 	M68K::ZomgSaveReg(&m68k_reg_save);
-	zomg.saveM68KReg(&m68k_reg_save);
+	zomg->saveM68KReg(&m68k_reg_save);
 
 	/* TODO: Pico-specific registers. ($800000) */
 
@@ -216,14 +241,11 @@ int EmuPico::zomgSave(const char *filename) const
 	// - MD /TIME registers. (SRAM control, etc.)
 	// - SRAM data.
 	// - EEPROM control and data.
-	M68K_Mem::ms_RomCartridge->zomgSave(&zomg);
+	M68K_Mem::ms_RomCartridge->zomgSave(zomg);
 
 	// TODO: Save TMSS.
 	// Pico TMSS only has one register, the 'SEGA' register.
 
-	// Close the savestate.
-	zomg.close();
-	
 	// Savestate saved.
 	return 0;
 }
@@ -0,0 +1,692 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * InputMovie.cpp: Input movie recording and playback.                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "InputMovie.hpp"
+#include "../IO/IoManager.hpp"
+
+#ifdef _WIN32
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+#include "libcompat/W32U/W32U_mini.h"
+#endif
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibGens {
+
+/**
+ * Movie file format. All values are little-endian.
+ *
+ * Header:
+ * - 0x00: Magic number. ("GMOV")
+ * - 0x04: Version. (uint16_t)
+ * - 0x06: Start type. (uint8_t; 0 == power-on, 1 == savestate)
+ * - 0x07: Reserved. (uint8_t)
+ * - 0x08: ROM CRC32. (uint32_t)
+ * - 0x0C: Frame count. (uint32_t; 0 if unknown)
+ * - 0x10: Starting region code. (int8_t)
+ * - 0x11: Reserved. (uint8_t)
+ * - 0x12: Length of the savestate filename. (uint16_t)
+ * - 0x14: Savestate filename. (UTF-8, not NULL-terminated)
+ *
+ * The header is followed by a stream of records.
+ * Each frame is zero or more event records,
+ * terminated by OP_FRAME or OP_FRAME_HASH.
+ */
+class InputMoviePrivate
+{
+	public:
+		InputMoviePrivate();
+		~InputMoviePrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		InputMoviePrivate(const InputMoviePrivate &);
+		InputMoviePrivate &operator=(const InputMoviePrivate &);
+
+	public:
+		static const char MAGIC[4];
+		static const uint16_t VERSION = 1;
+		static const int HEADER_SIZE = 0x14;
+		static const int FRAME_COUNT_OFFSET = 0x0C;
+
+		enum Opcode {
+			OP_FRAME	= 0x00,	// End of frame.
+			OP_FRAME_HASH	= 0x01,	// End of frame. [uint32_t hash]
+			OP_BUTTONS	= 0x02,	// Button state. [uint8_t virtPort, uint32_t buttons]
+			OP_DEVTYPE	= 0x03,	// Device type. [uint8_t virtPort, uint8_t ioType]
+			OP_SOFT_RESET	= 0x04,	// Soft reset.
+			OP_HARD_RESET	= 0x05,	// Hard reset.
+			OP_REGION	= 0x06,	// Region change. [int8_t region]
+		};
+
+		InputMovie::Mode mode;
+		FILE *file;		// Recording only.
+		int err;		// First write error. (Recording only)
+
+		uint32_t romCrc32;
+		SysVersion::RegionCode_t region;
+		string zomgFilename;
+		unsigned int frame;
+		unsigned int frameCount;
+		int desyncFrame;
+
+		// Recording: records for the current frame.
+		vector<uint8_t> buf;
+
+		// Playback: movie data.
+		vector<uint8_t> data;
+		size_t pos;
+
+		// Playback: stored hash for the current frame.
+		bool hasHash;
+		uint32_t hash;
+
+		// Last recorded or played device types and button states.
+		// Device types are initialized to IOT_MAX so that
+		// all of them are stored in the first frame.
+		uint8_t ioTypes[IoManager::VIRTPORT_MAX];
+		uint32_t buttons[IoManager::VIRTPORT_MAX];
+
+		/**
+		 * Reset the movie state.
+		 */
+		void reset(void);
+
+		/**
+		 * Append values to the record buffer.
+		 */
+		inline void put8(uint8_t val)
+			{ buf.push_back(val); }
+		void put16(uint16_t val);
+		void put32(uint32_t val);
+
+		/**
+		 * Read values from the movie data.
+		 * The caller must check that enough data is available.
+		 */
+		inline uint8_t get8(void)
+			{ return data[pos++]; }
+		uint32_t get32(void);
+
+		/**
+		 * Write the record buffer to the file.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int flush(void);
+};
+
+/** InputMoviePrivate **/
+
+const char InputMoviePrivate::MAGIC[4] = {'G','M','O','V'};
+
+InputMoviePrivate::InputMoviePrivate()
+	: file(nullptr)
+{
+	reset();
+}
+
+InputMoviePrivate::~InputMoviePrivate()
+{
+	if (file) {
+		fclose(file);
+	}
+}
+
+/**
+ * Reset the movie state.
+ */
+void InputMoviePrivate::reset(void)
+{
+	mode = InputMovie::MODE_NONE;
+	err = 0;
+	romCrc32 = 0;
+	region = SysVersion::REGION_US_NTSC;
+	zomgFilename.clear();
+	frame = 0;
+	frameCount = 0;
+	desyncFrame = -1;
+	buf.clear();
+	data.clear();
+	pos = 0;
+	hasHash = false;
+	hash = 0;
+	memset(ioTypes, IoManager::IOT_MAX, sizeof(ioTypes));
+	for (int i = 0; i < IoManager::VIRTPORT_MAX; i++) {
+		buttons[i] = ~0U;
+	}
+}
+
+void InputMoviePrivate::put16(uint16_t val)
+{
+	buf.push_back(val & 0xFF);
+	buf.push_back(val >> 8);
+}
+
+void InputMoviePrivate::put32(uint32_t val)
+{
+	buf.push_back(val & 0xFF);
+	buf.push_back((val >> 8) & 0xFF);
+	buf.push_back((val >> 16) & 0xFF);
+	buf.push_back(val >> 24);
+}
+
+uint32_t InputMoviePrivate::get32(void)
+{
+	const uint8_t *p = &data[pos];
+	pos += 4;
+	return (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+/**
+ * Write the record buffer to the file.
+ * @return 0 on success; negative errno on error.
+ */
+int InputMoviePrivate::flush(void)
+{
+	if (buf.empty() || err != 0)
+		return err;
+
+	errno = 0;
+	if (fwrite(buf.data(), 1, buf.size(), file) != buf.size()) {
+		err = (errno != 0 ? -errno : -EIO);
+	}
+	buf.clear();
+	return err;
+}
+
+/** InputMovie **/
+
+InputMovie::InputMovie()
+	: d(new InputMoviePrivate())
+{ }
+
+InputMovie::~InputMovie()
+{
+	close();
+	delete d;
+}
+
+/**
+ * Start recording a movie.
+ *
+ * The movie stores the button state of every virtual
+ * port as it was passed to IoManager::update(), once
+ * per frame, plus device type changes, resets, and
+ * region changes. Only changes are stored, so a frame
+ * with no input changes takes a single byte, plus
+ * four bytes if a state hash is recorded.
+ *
+ * The caller is responsible for putting the emulator
+ * in the starting state: a hard reset for power-on,
+ * or loading zomgFilename.
+ *
+ * @param filename	[in] Movie file. (UTF-8)
+ * @param romCrc32	[in] ROM CRC32.
+ * @param region	[in] Starting region code.
+ * @param zomgFilename	[in, opt] Starting savestate, or nullptr for power-on.
+ * @return 0 on success; negative errno on error.
+ */
+int InputMovie::record(const char *filename, uint32_t romCrc32,
+		       SysVersion::RegionCode_t region,
+		       const char *zomgFilename)
+{
+	if (!filename || region < SysVersion::REGION_JP_NTSC ||
+	    region > SysVersion::REGION_EU_PAL)
+	{
+		return -EINVAL;
+	}
+	const size_t zomgLen = (zomgFilename ? strlen(zomgFilename) : 0);
+	if (zomgLen > 0xFFFF)
+		return -ENAMETOOLONG;
+
+	close();
+
+	errno = 0;
+	d->file = fopen(filename, "wb");
+	if (!d->file) {
+		return (errno != 0 ? -errno : -EIO);
+	}
+
+	d->romCrc32 = romCrc32;
+	d->region = region;
+	if (zomgLen > 0) {
+		d->zomgFilename = string(zomgFilename, zomgLen);
+	}
+
+	// Write the header.
+	// The frame count is written by close().
+	d->buf.insert(d->buf.end(), &d->MAGIC[0], &d->MAGIC[4]);
+	d->put16(d->VERSION);
+	d->put8(zomgLen > 0 ? 1 : 0);
+	d->put8(0);
+	d->put32(romCrc32);
+	d->put32(0);
+	d->put8((uint8_t)(int8_t)region);
+	d->put8(0);
+	d->put16((uint16_t)zomgLen);
+	d->buf.insert(d->buf.end(), d->zomgFilename.begin(), d->zomgFilename.end());
+
+	int ret = d->flush();
+	if (ret != 0) {
+		fclose(d->file);
+		d->file = nullptr;
+		d->reset();
+		return ret;
+	}
+
+	d->mode = MODE_RECORD;
+	return 0;
+}
+
+/**
+ * Start playing a movie.
+ *
+ * The movie is read into memory, so playback doesn't
+ * do any file I/O. The caller is responsible for
+ * putting the emulator in the starting state using
+ * region() and zomgFilename().
+ *
+ * @param filename	[in] Movie file. (UTF-8)
+ * @return 0 on success; negative errno on error.
+ */
+int InputMovie::play(const char *filename)
+{
+	if (!filename)
+		return -EINVAL;
+
+	close();
+
+	errno = 0;
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		return (errno != 0 ? -errno : -EIO);
+	}
+
+	// Read the entire movie.
+	uint8_t tmp[4096];
+	size_t size;
+	while ((size = fread(tmp, 1, sizeof(tmp), f)) > 0) {
+		d->data.insert(d->data.end(), &tmp[0], &tmp[size]);
+	}
+	const bool readErr = !!ferror(f);
+	fclose(f);
+	if (readErr) {
+		d->reset();
+		return -EIO;
+	}
+
+	// Check the header.
+	const uint8_t *const hdr = d->data.data();
+	if (d->data.size() < (size_t)d->HEADER_SIZE ||
+	    memcmp(hdr, d->MAGIC, sizeof(d->MAGIC)) != 0 ||
+	    (hdr[4] | (hdr[5] << 8)) != d->VERSION)
+	{
+		d->reset();
+		return -EINVAL;
+	}
+
+	d->pos = 8;
+	d->romCrc32 = d->get32();
+	d->frameCount = d->get32();
+	const int region = (int8_t)d->get8();
+	d->pos++;
+	const size_t zomgLen = (d->get8() | (d->get8() << 8));
+	if (region < SysVersion::REGION_JP_NTSC || region > SysVersion::REGION_EU_PAL ||
+	    (hdr[6] != 0) != (zomgLen > 0) ||
+	    d->data.size() < d->HEADER_SIZE + zomgLen)
+	{
+		d->reset();
+		return -EINVAL;
+	}
+	d->region = (SysVersion::RegionCode_t)region;
+	d->zomgFilename = string((const char*)&hdr[d->HEADER_SIZE], zomgLen);
+	d->pos = d->HEADER_SIZE + zomgLen;
+
+	d->mode = MODE_PLAY;
+	return 0;
+}
+
+/**
+ * Stop recording or playing.
+ * When recording, this finishes writing the movie.
+ * @return 0 on success; negative errno on error.
+ */
+int InputMovie::close(void)
+{
+	int ret = 0;
+	if (d->mode == MODE_RECORD) {
+		// Write any pending events and the frame count.
+		ret = d->flush();
+		if (ret == 0) {
+			d->put32(d->frame);
+			if (fseek(d->file, d->FRAME_COUNT_OFFSET, SEEK_SET) != 0) {
+				ret = -EIO;
+			} else {
+				ret = d->flush();
+			}
+		}
+		if (fclose(d->file) != 0 && ret == 0) {
+			ret = -EIO;
+		}
+		d->file = nullptr;
+	}
+
+	d->reset();
+	return ret;
+}
+
+/**
+ * Get the current mode.
+ * @return Mode.
+ */
+InputMovie::Mode InputMovie::mode(void) const
+{
+	return d->mode;
+}
+
+/** Movie information. **/
+
+/**
+ * Get the CRC32 of the ROM the movie was recorded with.
+ * @return ROM CRC32.
+ */
+uint32_t InputMovie::romCrc32(void) const
+{
+	return d->romCrc32;
+}
+
+/**
+ * Get the current region code.
+ * This is the starting region code until
+ * an EVENT_REGION is returned by beginFrame().
+ * @return Region code.
+ */
+SysVersion::RegionCode_t InputMovie::region(void) const
+{
+	return d->region;
+}
+
+/**
+ * Get the starting savestate.
+ * @return Starting savestate filename, or empty string for power-on.
+ */
+string InputMovie::zomgFilename(void) const
+{
+	return d->zomgFilename;
+}
+
+/**
+ * Get the number of frames recorded or played so far.
+ * @return Number of frames.
+ */
+unsigned int InputMovie::frame(void) const
+{
+	return d->frame;
+}
+
+/**
+ * Get the total number of frames in the movie. (playback)
+ * @return Number of frames, or 0 if the movie wasn't closed properly.
+ */
+unsigned int InputMovie::frameCount(void) const
+{
+	return d->frameCount;
+}
+
+/**
+ * Have all frames been played?
+ * @return True if playback reached the end of the movie.
+ */
+bool InputMovie::isFinished(void) const
+{
+	return (d->mode == MODE_PLAY && d->pos >= d->data.size());
+}
+
+/**
+ * Get the first frame whose state hash didn't match. (playback)
+ * @return Frame number, or -1 if all hashes matched.
+ */
+int InputMovie::desyncFrame(void) const
+{
+	return d->desyncFrame;
+}
+
+/** Recording events. **/
+
+/**
+ * Record a soft reset.
+ * The reset applies to the next frame.
+ */
+void InputMovie::recordSoftReset(void)
+{
+	if (d->mode != MODE_RECORD)
+		return;
+	d->put8(d->OP_SOFT_RESET);
+}
+
+/**
+ * Record a hard reset.
+ * The reset applies to the next frame.
+ */
+void InputMovie::recordHardReset(void)
+{
+	if (d->mode != MODE_RECORD)
+		return;
+	d->put8(d->OP_HARD_RESET);
+}
+
+/**
+ * Record a region change.
+ * The change applies to the next frame.
+ * @param region New region code.
+ */
+void InputMovie::recordRegion(SysVersion::RegionCode_t region)
+{
+	if (d->mode != MODE_RECORD)
+		return;
+	d->put8(d->OP_REGION);
+	d->put8((uint8_t)(int8_t)region);
+	d->region = region;
+}
+
+/** Per-frame functions. **/
+
+/**
+ * Start a frame.
+ * This must be called before running each frame,
+ * including frames run with execFrameFast().
+ *
+ * Recording: Device types and button states are
+ * read from the I/O Manager and recorded.
+ *
+ * Playback: Device types and button states are
+ * applied to the I/O Manager. Events (EVENT_*)
+ * are returned, and must be applied by the caller.
+ * Resets clear the button states, which matches
+ * the recording, since events are recorded before
+ * the frame's button states.
+ *
+ * @param ioManager I/O Manager.
+ * @return Events on success; negative errno on error.
+ */
+int InputMovie::beginFrame(IoManager *ioManager)
+{
+	if (d->mode == MODE_RECORD) {
+		// Record changed device types and button states.
+		for (int virtPort = 0; virtPort < IoManager::VIRTPORT_MAX; virtPort++) {
+			const uint8_t ioType = (uint8_t)ioManager->devType((IoManager::VirtPort_t)virtPort);
+			if (ioType != d->ioTypes[virtPort]) {
+				d->put8(d->OP_DEVTYPE);
+				d->put8((uint8_t)virtPort);
+				d->put8(ioType);
+				d->ioTypes[virtPort] = ioType;
+			}
+
+			const uint32_t buttons = ioManager->buttons(virtPort);
+			if (buttons != d->buttons[virtPort]) {
+				d->put8(d->OP_BUTTONS);
+				d->put8((uint8_t)virtPort);
+				d->put32(buttons);
+				d->buttons[virtPort] = buttons;
+			}
+		}
+		return 0;
+	} else if (d->mode != MODE_PLAY) {
+		return -EBADF;
+	}
+
+	// Apply records until the end of the frame.
+	const size_t size = d->data.size();
+	int events = 0;
+	while (d->pos < size) {
+		const uint8_t op = d->get8();
+		switch (op) {
+			case InputMoviePrivate::OP_FRAME:
+				d->hasHash = false;
+				return events;
+
+			case InputMoviePrivate::OP_FRAME_HASH:
+				if (size - d->pos < 4)
+					break;
+				d->hasHash = true;
+				d->hash = d->get32();
+				return events;
+
+			case InputMoviePrivate::OP_BUTTONS: {
+				if (size - d->pos < 5)
+					break;
+				const int virtPort = d->get8();
+				const uint32_t buttons = d->get32();
+				if (virtPort >= IoManager::VIRTPORT_MAX)
+					break;
+				ioManager->update(virtPort, buttons);
+				d->buttons[virtPort] = buttons;
+				continue;
+			}
+
+			case InputMoviePrivate::OP_DEVTYPE: {
+				if (size - d->pos < 2)
+					break;
+				const int virtPort = d->get8();
+				const int ioType = d->get8();
+				if (virtPort >= IoManager::VIRTPORT_MAX || ioType >= IoManager::IOT_MAX)
+					break;
+				ioManager->setDevType((IoManager::VirtPort_t)virtPort, (IoManager::IoType_t)ioType);
+				d->ioTypes[virtPort] = (uint8_t)ioType;
+				continue;
+			}
+
+			case InputMoviePrivate::OP_SOFT_RESET:
+				events |= EVENT_SOFT_RESET;
+				continue;
+
+			case InputMoviePrivate::OP_HARD_RESET:
+				events |= EVENT_HARD_RESET;
+				continue;
+
+			case InputMoviePrivate::OP_REGION: {
+				if (size - d->pos < 1)
+					break;
+				const int region = (int8_t)d->get8();
+				if (region < SysVersion::REGION_JP_NTSC || region > SysVersion::REGION_EU_PAL)
+					break;
+				d->region = (SysVersion::RegionCode_t)region;
+				events |= EVENT_REGION;
+				continue;
+			}
+
+			default:
+				break;
+		}
+
+		// Invalid or truncated record.
+		d->pos = size;
+		return -EINVAL;
+	}
+
+	// The movie ended in the middle of a frame.
+	d->hasHash = false;
+	return events;
+}
+
+/**
+ * Finish a frame without a state hash.
+ * @return True on success; false on error.
+ */
+bool InputMovie::endFrame(void)
+{
+	if (d->mode == MODE_RECORD) {
+		d->put8(d->OP_FRAME);
+		d->frame++;
+		return (d->flush() == 0);
+	} else if (d->mode == MODE_PLAY) {
+		d->frame++;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Finish a frame with a state hash.
+ *
+ * Recording: The hash is stored in the movie.
+ *
+ * Playback: The hash is compared to the hash stored
+ * in the movie, if any. The first mismatched frame
+ * is available from desyncFrame().
+ *
+ * @param hash State hash for this frame.
+ * @return True if the hash matched or wasn't recorded; false on desync or error.
+ */
+bool InputMovie::endFrame(uint32_t hash)
+{
+	if (d->mode == MODE_RECORD) {
+		d->put8(d->OP_FRAME_HASH);
+		d->put32(hash);
+		d->frame++;
+		return (d->flush() == 0);
+	} else if (d->mode != MODE_PLAY) {
+		return false;
+	}
+
+	bool ret = true;
+	if (d->hasHash && d->hash != hash) {
+		if (d->desyncFrame < 0) {
+			d->desyncFrame = (int)d->frame;
+		}
+		ret = false;
+	}
+	d->frame++;
+	return ret;
+}
+
+}
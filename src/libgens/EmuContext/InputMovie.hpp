@@ -0,0 +1,234 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * InputMovie.hpp: Input movie recording and playback.                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_EMUCONTEXT_INPUTMOVIE_HPP__
+#define __LIBGENS_EMUCONTEXT_INPUTMOVIE_HPP__
+
+// Region code.
+#include "SysVersion.hpp"
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <string>
+
+namespace LibGens {
+
+class IoManager;
+
+class InputMoviePrivate;
+class InputMovie
+{
+	public:
+		InputMovie();
+		~InputMovie();
+
+	protected:
+		friend class InputMoviePrivate;
+		InputMoviePrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		InputMovie(const InputMovie &);
+		InputMovie &operator=(const InputMovie &);
+
+	public:
+		enum Mode {
+			MODE_NONE	= 0,	// Not recording or playing.
+			MODE_RECORD	= 1,	// Recording.
+			MODE_PLAY	= 2,	// Playing back.
+		};
+
+		/**
+		 * Events returned by beginFrame() during playback.
+		 * The frontend must apply these to the EmuContext
+		 * before running the frame, in this order.
+		 */
+		enum Event {
+			EVENT_REGION		= (1 << 0),	// Region changed. (See region().)
+			EVENT_HARD_RESET	= (1 << 1),	// Hard reset.
+			EVENT_SOFT_RESET	= (1 << 2),	// Soft reset.
+		};
+
+		/**
+		 * Start recording a movie.
+		 *
+		 * The movie stores the button state of every virtual
+		 * port as it was passed to IoManager::update(), once
+		 * per frame, plus device type changes, resets, and
+		 * region changes. Only changes are stored, so a frame
+		 * with no input changes takes a single byte, plus
+		 * four bytes if a state hash is recorded.
+		 *
+		 * The caller is responsible for putting the emulator
+		 * in the starting state: a hard reset for power-on,
+		 * or loading zomgFilename.
+		 *
+		 * @param filename	[in] Movie file. (UTF-8)
+		 * @param romCrc32	[in] ROM CRC32.
+		 * @param region	[in] Starting region code.
+		 * @param zomgFilename	[in, opt] Starting savestate, or nullptr for power-on.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int record(const char *filename, uint32_t romCrc32,
+			   SysVersion::RegionCode_t region,
+			   const char *zomgFilename = nullptr);
+
+		/**
+		 * Start playing a movie.
+		 *
+		 * The movie is read into memory, so playback doesn't
+		 * do any file I/O. The caller is responsible for
+		 * putting the emulator in the starting state using
+		 * region() and zomgFilename().
+		 *
+		 * @param filename	[in] Movie file. (UTF-8)
+		 * @return 0 on success; negative errno on error.
+		 */
+		int play(const char *filename);
+
+		/**
+		 * Stop recording or playing.
+		 * When recording, this finishes writing the movie.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int close(void);
+
+		/**
+		 * Get the current mode.
+		 * @return Mode.
+		 */
+		Mode mode(void) const;
+
+		/** Movie information. **/
+
+		/**
+		 * Get the CRC32 of the ROM the movie was recorded with.
+		 * @return ROM CRC32.
+		 */
+		uint32_t romCrc32(void) const;
+
+		/**
+		 * Get the current region code.
+		 * This is the starting region code until
+		 * an EVENT_REGION is returned by beginFrame().
+		 * @return Region code.
+		 */
+		SysVersion::RegionCode_t region(void) const;
+
+		/**
+		 * Get the starting savestate.
+		 * @return Starting savestate filename, or empty string for power-on.
+		 */
+		std::string zomgFilename(void) const;
+
+		/**
+		 * Get the number of frames recorded or played so far.
+		 * @return Number of frames.
+		 */
+		unsigned int frame(void) const;
+
+		/**
+		 * Get the total number of frames in the movie. (playback)
+		 * @return Number of frames, or 0 if the movie wasn't closed properly.
+		 */
+		unsigned int frameCount(void) const;
+
+		/**
+		 * Have all frames been played?
+		 * @return True if playback reached the end of the movie.
+		 */
+		bool isFinished(void) const;
+
+		/**
+		 * Get the first frame whose state hash didn't match. (playback)
+		 * @return Frame number, or -1 if all hashes matched.
+		 */
+		int desyncFrame(void) const;
+
+		/** Recording events. **/
+
+		/**
+		 * Record a soft reset.
+		 * The reset applies to the next frame.
+		 */
+		void recordSoftReset(void);
+
+		/**
+		 * Record a hard reset.
+		 * The reset applies to the next frame.
+		 */
+		void recordHardReset(void);
+
+		/**
+		 * Record a region change.
+		 * The change applies to the next frame.
+		 * @param region New region code.
+		 */
+		void recordRegion(SysVersion::RegionCode_t region);
+
+		/** Per-frame functions. **/
+
+		/**
+		 * Start a frame.
+		 * This must be called before running each frame,
+		 * including frames run with execFrameFast().
+		 *
+		 * Recording: Device types and button states are
+		 * read from the I/O Manager and recorded.
+		 *
+		 * Playback: Device types and button states are
+		 * applied to the I/O Manager. Events (EVENT_*)
+		 * are returned, and must be applied by the caller.
+		 * Resets clear the button states, which matches
+		 * the recording, since events are recorded before
+		 * the frame's button states.
+		 *
+		 * @param ioManager I/O Manager.
+		 * @return Events on success; negative errno on error.
+		 */
+		int beginFrame(IoManager *ioManager);
+
+		/**
+		 * Finish a frame without a state hash.
+		 * @return True on success; false on error.
+		 */
+		bool endFrame(void);
+
+		/**
+		 * Finish a frame with a state hash.
+		 *
+		 * Recording: The hash is stored in the movie.
+		 *
+		 * Playback: The hash is compared to the hash stored
+		 * in the movie, if any. The first mismatched frame
+		 * is available from desyncFrame().
+		 *
+		 * @param hash State hash for this frame.
+		 * @return True if the hash matched or wasn't recorded; false on desync or error.
+		 */
+		bool endFrame(uint32_t hash);
+};
+
+}
+
+#endif /* __LIBGENS_EMUCONTEXT_INPUTMOVIE_HPP__ */
@@ -0,0 +1,613 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * SaveSlotCache.cpp: Savestate slot metadata cache.                       *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include <libgens/config.libgens.h>
+
+#include "SaveSlotCache.hpp"
+
+// LibZomg
+#include "libzomg/Zomg.hpp"
+using LibZomg::Zomg;
+
+// C includes.
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_INOTIFY_INIT1
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif /* HAVE_INOTIFY_INIT1 */
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+using std::string;
+using std::vector;
+
+#ifdef _WIN32
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+#include "libcompat/W32U/W32U_mini.h"
+#endif /* _WIN32 */
+
+namespace LibGens {
+
+class SaveSlotCachePrivate
+{
+	public:
+		SaveSlotCachePrivate();
+		~SaveSlotCachePrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		SaveSlotCachePrivate(const SaveSlotCachePrivate &);
+		SaveSlotCachePrivate &operator=(const SaveSlotCachePrivate &);
+
+	public:
+		/**
+		 * File timestamp.
+		 * Used to check if a savestate has changed
+		 * since it was cached.
+		 */
+		struct FileStamp {
+			bool exists;
+			int64_t size;
+			int64_t mtime_ns;
+
+			bool operator==(const FileStamp &other) const {
+				return (exists == other.exists &&
+					size == other.size &&
+					mtime_ns == other.mtime_ns);
+			}
+		};
+
+		/**
+		 * Get a file's timestamp.
+		 * @param filename	[in] Filename.
+		 * @param stamp		[out] File timestamp.
+		 */
+		static void statFile(const string &filename, FileStamp *stamp);
+
+		/**
+		 * Load a savestate's metadata.
+		 * This doesn't access any cache data, so the
+		 * mutex should not be held while calling it.
+		 * @param filename	[in] Savestate filename.
+		 * @param stamp		[out] File timestamp.
+		 * @param info		[out] Slot metadata.
+		 */
+		static void loadSlot(const string &filename,
+			FileStamp *stamp, SaveSlotCache::SlotInfo *info);
+
+		// Cache entry.
+		struct Entry {
+			string filename;
+
+			enum State {
+				STATE_STALE,	// Needs to be loaded.
+				STATE_LOADING,	// Being loaded.
+				STATE_VALID,	// info is up to date.
+			};
+			State state;
+
+			// Incremented when the entry is invalidated.
+			// If it changes while the slot is being loaded,
+			// the loaded data is discarded.
+			unsigned int gen;
+
+			FileStamp stamp;
+			SaveSlotCache::SlotInfo info;
+
+#ifdef HAVE_INOTIFY_INIT1
+			int wd;		// inotify watch descriptor.
+			string basename;
+#endif /* HAVE_INOTIFY_INIT1 */
+		};
+
+		// Cache entries. Protected by mtx.
+		std::mutex mtx;
+		std::condition_variable cond;	// Slot invalidated, or quit.
+		std::condition_variable loaded;	// Slot loaded.
+		Entry slots[SaveSlotCache::MAX_SLOTS];
+		int numSlots;
+		bool quit;
+
+		// Loader thread.
+		// Started when the filenames are first set.
+		std::thread thread;
+
+		/**
+		 * Loader thread function.
+		 */
+		void run(void);
+
+		/**
+		 * Load a slot and store it in the cache.
+		 * The mutex must be held by the caller.
+		 * It's released while the slot is loaded.
+		 * @param lock	[in] Lock on mtx.
+		 * @param slot	[in] Save slot.
+		 * @param info	[out, opt] Slot metadata.
+		 */
+		void refreshSlot(std::unique_lock<std::mutex> &lock,
+			int slot, SaveSlotCache::SlotInfo *info);
+
+		/**
+		 * Mark a slot as stale.
+		 * The mutex must be held by the caller.
+		 * @param slot Save slot.
+		 */
+		void invalidateSlot(int slot);
+
+		/**
+		 * Check for savestates that were changed
+		 * outside of the cache.
+		 * The mutex must be held by the caller.
+		 */
+		void checkChanges(void);
+
+#ifdef HAVE_INOTIFY_INIT1
+		// inotify instance.
+		// Watches the savestate directories for changes.
+		int inotify_fd;
+
+		/**
+		 * Remove all inotify watches.
+		 * The mutex must be held by the caller.
+		 */
+		void removeWatches(void);
+#endif /* HAVE_INOTIFY_INIT1 */
+};
+
+SaveSlotCachePrivate::SaveSlotCachePrivate()
+	: numSlots(0)
+	, quit(false)
+{
+	for (int i = 0; i < SaveSlotCache::MAX_SLOTS; i++) {
+		Entry *const entry = &slots[i];
+		entry->state = Entry::STATE_STALE;
+		entry->gen = 0;
+		memset(&entry->stamp, 0, sizeof(entry->stamp));
+#ifdef HAVE_INOTIFY_INIT1
+		entry->wd = -1;
+#endif /* HAVE_INOTIFY_INIT1 */
+	}
+
+#ifdef HAVE_INOTIFY_INIT1
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif /* HAVE_INOTIFY_INIT1 */
+}
+
+SaveSlotCachePrivate::~SaveSlotCachePrivate()
+{
+#ifdef HAVE_INOTIFY_INIT1
+	if (inotify_fd >= 0) {
+		// Closing the instance removes all watches.
+		::close(inotify_fd);
+	}
+#endif /* HAVE_INOTIFY_INIT1 */
+}
+
+/**
+ * Get a file's timestamp.
+ * @param filename	[in] Filename.
+ * @param stamp		[out] File timestamp.
+ */
+void SaveSlotCachePrivate::statFile(const string &filename, FileStamp *stamp)
+{
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0) {
+		stamp->exists = false;
+		stamp->size = 0;
+		stamp->mtime_ns = 0;
+		return;
+	}
+
+	stamp->exists = true;
+	stamp->size = (int64_t)st.st_size;
+#ifdef __linux__
+	// Savestates may be written more than once per second.
+	stamp->mtime_ns = ((int64_t)st.st_mtim.tv_sec * 1000000000) + st.st_mtim.tv_nsec;
+#else
+	stamp->mtime_ns = (int64_t)st.st_mtime * 1000000000;
+#endif
+}
+
+/**
+ * Load a savestate's metadata.
+ * This doesn't access any cache data, so the
+ * mutex should not be held while calling it.
+ * @param filename	[in] Savestate filename.
+ * @param stamp		[out] File timestamp.
+ * @param info		[out] Slot metadata.
+ */
+void SaveSlotCachePrivate::loadSlot(const string &filename,
+	FileStamp *stamp, SaveSlotCache::SlotInfo *info)
+{
+	info->mtime = 0;
+	memset(&info->img, 0, sizeof(info->img));
+	info->imgBuf.clear();
+
+	// Get the timestamp first. If the file is changed
+	// while it's being loaded, the timestamp won't
+	// match, and the slot will be loaded again.
+	statFile(filename, stamp);
+	if (!stamp->exists) {
+		// Savestate does not exist.
+		info->status = SaveSlotCache::SLOT_EMPTY;
+		return;
+	}
+
+	Zomg zomg(filename.c_str(), Zomg::ZOMG_LOAD);
+	if (!zomg.isOpen()) {
+		// Error opening the savestate.
+		info->status = SaveSlotCache::SLOT_ERROR;
+		return;
+	}
+	info->status = SaveSlotCache::SLOT_OCCUPIED;
+	info->mtime = zomg.mtime();
+
+	// Get the preview image.
+	Zomg_Img_Data_t img_data;
+	img_data.data = nullptr;
+	int ret = zomg.loadPreview(&img_data);
+	if (ret == 0 && img_data.data) {
+		// Keep the full-size image.
+		// The OSDs lay out the preview based on
+		// the original framebuffer dimensions.
+		const uint8_t *const data = (const uint8_t*)img_data.data;
+		info->imgBuf.assign(data, data + (img_data.pitch * img_data.h));
+		info->img = img_data;
+		info->img.data = nullptr;
+	}
+	free(img_data.data);
+}
+
+/**
+ * Loader thread function.
+ */
+void SaveSlotCachePrivate::run(void)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		// Find a stale slot.
+		int slot = -1;
+		cond.wait(lock, [this, &slot] {
+			if (quit)
+				return true;
+			for (int i = 0; i < numSlots; i++) {
+				if (slots[i].state == Entry::STATE_STALE) {
+					slot = i;
+					return true;
+				}
+			}
+			return false;
+		});
+		if (quit)
+			break;
+
+		refreshSlot(lock, slot, nullptr);
+	}
+}
+
+/**
+ * Load a slot and store it in the cache.
+ * The mutex must be held by the caller.
+ * It's released while the slot is loaded.
+ * @param lock	[in] Lock on mtx.
+ * @param slot	[in] Save slot.
+ * @param info	[out, opt] Slot metadata.
+ */
+void SaveSlotCachePrivate::refreshSlot(std::unique_lock<std::mutex> &lock,
+	int slot, SaveSlotCache::SlotInfo *info)
+{
+	Entry *const entry = &slots[slot];
+	entry->state = Entry::STATE_LOADING;
+	const string filename = entry->filename;
+	const unsigned int gen = entry->gen;
+
+	// Don't hold the lock while loading.
+	lock.unlock();
+	FileStamp stamp;
+	SaveSlotCache::SlotInfo newInfo;
+	loadSlot(filename, &stamp, &newInfo);
+	lock.lock();
+
+	if (entry->gen == gen) {
+		// Slot wasn't invalidated while it was loading.
+		entry->stamp = stamp;
+		entry->info = newInfo;
+		entry->state = Entry::STATE_VALID;
+	}
+	loaded.notify_all();
+
+	if (info) {
+		// The loaded data is still newer than
+		// anything that was in the cache.
+		*info = std::move(newInfo);
+	}
+}
+
+/**
+ * Mark a slot as stale.
+ * The mutex must be held by the caller.
+ * @param slot Save slot.
+ */
+void SaveSlotCachePrivate::invalidateSlot(int slot)
+{
+	Entry *const entry = &slots[slot];
+	entry->state = Entry::STATE_STALE;
+	entry->gen++;
+}
+
+/**
+ * Check for savestates that were changed
+ * outside of the cache.
+ * The mutex must be held by the caller.
+ */
+void SaveSlotCachePrivate::checkChanges(void)
+{
+	bool changed = false;
+
+#ifdef HAVE_INOTIFY_INIT1
+	if (inotify_fd >= 0) {
+		// Read all pending events.
+		union {
+			struct inotify_event ev;
+			char buf[4096];
+		} events;
+
+		ssize_t len;
+		while ((len = read(inotify_fd, events.buf, sizeof(events.buf))) > 0) {
+			const char *ptr = events.buf;
+			const char *const end = events.buf + len;
+			while (ptr < end) {
+				const struct inotify_event *ev = (const struct inotify_event*)ptr;
+				ptr += sizeof(*ev) + ev->len;
+
+				for (int i = 0; i < numSlots; i++) {
+					Entry *const entry = &slots[i];
+					if (entry->state != Entry::STATE_VALID)
+						continue;
+					if ((ev->mask & IN_Q_OVERFLOW) ||
+					    (ev->wd == entry->wd && ev->len > 0 &&
+					     entry->basename == ev->name))
+					{
+						// Our own savestates also trigger events.
+						// Only reload if the file doesn't match
+						// what's already in the cache.
+						FileStamp stamp;
+						statFile(entry->filename, &stamp);
+						if (!(stamp == entry->stamp)) {
+							invalidateSlot(i);
+							changed = true;
+						}
+					}
+				}
+			}
+		}
+	}
+#endif /* HAVE_INOTIFY_INIT1 */
+
+	// Slots that aren't being watched are checked
+	// by comparing timestamps.
+	for (int i = 0; i < numSlots; i++) {
+		Entry *const entry = &slots[i];
+		if (entry->state != Entry::STATE_VALID)
+			continue;
+#ifdef HAVE_INOTIFY_INIT1
+		if (entry->wd >= 0)
+			continue;
+#endif /* HAVE_INOTIFY_INIT1 */
+		FileStamp stamp;
+		statFile(entry->filename, &stamp);
+		if (!(stamp == entry->stamp)) {
+			invalidateSlot(i);
+			changed = true;
+		}
+	}
+
+	if (changed) {
+		cond.notify_one();
+	}
+}
+
+#ifdef HAVE_INOTIFY_INIT1
+/**
+ * Remove all inotify watches.
+ * The mutex must be held by the caller.
+ */
+void SaveSlotCachePrivate::removeWatches(void)
+{
+	for (int i = 0; i < numSlots; i++) {
+		Entry *const entry = &slots[i];
+		if (entry->wd < 0)
+			continue;
+
+		// Multiple slots may share a watch descriptor.
+		const int wd = entry->wd;
+		for (int j = i; j < numSlots; j++) {
+			if (slots[j].wd == wd) {
+				slots[j].wd = -1;
+			}
+		}
+		inotify_rm_watch(inotify_fd, wd);
+	}
+
+	// Discard events from the old watches.
+	char buf[4096];
+	while (read(inotify_fd, buf, sizeof(buf)) > 0) { }
+}
+#endif /* HAVE_INOTIFY_INIT1 */
+
+/** SaveSlotCache **/
+
+SaveSlotCache::SaveSlotCache()
+	: d(new SaveSlotCachePrivate())
+{ }
+
+SaveSlotCache::~SaveSlotCache()
+{
+	if (d->thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(d->mtx);
+			d->quit = true;
+		}
+		d->cond.notify_one();
+		d->thread.join();
+	}
+	delete d;
+}
+
+/**
+ * Set the savestate filenames for the current ROM.
+ *
+ * Any cached metadata is discarded. The slots are
+ * then loaded on a background thread, so slotInfo()
+ * usually won't have to touch the disk.
+ *
+ * @param filenames Savestate filenames, indexed by slot. (UTF-8)
+ * Slots past MAX_SLOTS are ignored.
+ */
+void SaveSlotCache::setFilenames(const vector<string> &filenames)
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+#ifdef HAVE_INOTIFY_INIT1
+	if (d->inotify_fd >= 0) {
+		d->removeWatches();
+	}
+#endif /* HAVE_INOTIFY_INIT1 */
+
+	d->numSlots = (int)filenames.size();
+	if (d->numSlots > MAX_SLOTS) {
+		d->numSlots = MAX_SLOTS;
+	}
+
+	for (int i = 0; i < d->numSlots; i++) {
+		SaveSlotCachePrivate::Entry *const entry = &d->slots[i];
+		entry->filename = filenames[i];
+		d->invalidateSlot(i);
+
+#ifdef HAVE_INOTIFY_INIT1
+		if (d->inotify_fd < 0)
+			continue;
+
+		// Watch the savestate directory.
+		// Watching the directory instead of the file
+		// catches savestates being created or replaced.
+		string dirname;
+		size_t slash_pos = entry->filename.rfind('/');
+		if (slash_pos == string::npos) {
+			dirname = ".";
+			entry->basename = entry->filename;
+		} else {
+			dirname = entry->filename.substr(0, slash_pos);
+			if (dirname.empty())
+				dirname = "/";
+			entry->basename = entry->filename.substr(slash_pos + 1);
+		}
+
+		// NOTE: inotify_add_watch() returns the existing
+		// watch descriptor if the directory is already watched.
+		entry->wd = inotify_add_watch(d->inotify_fd, dirname.c_str(),
+			IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+#endif /* HAVE_INOTIFY_INIT1 */
+	}
+
+	if (d->numSlots > 0) {
+		if (!d->thread.joinable()) {
+			d->thread = std::thread(&SaveSlotCachePrivate::run, d);
+		}
+		d->cond.notify_one();
+	}
+}
+
+/**
+ * Clear the cache, e.g. when the ROM is closed.
+ */
+void SaveSlotCache::clear(void)
+{
+	setFilenames(vector<string>());
+}
+
+/**
+ * Get the metadata for a savestate slot.
+ *
+ * If the slot has already been loaded, this is a
+ * memory lookup. If it hasn't been loaded yet, or if
+ * it was invalidated, it's loaded before returning.
+ *
+ * @param slot	[in] Save slot.
+ * @param info	[out] Slot metadata.
+ * @return 0 on success; negative errno on error.
+ */
+int SaveSlotCache::slotInfo(int slot, SlotInfo *info)
+{
+	if (slot < 0 || slot >= MAX_SLOTS)
+		return -EINVAL;
+
+	std::unique_lock<std::mutex> lock(d->mtx);
+	if (slot >= d->numSlots) {
+		// No filename for this slot.
+		return -ENOENT;
+	}
+
+	d->checkChanges();
+
+	// If the loader thread is working on this slot, wait for it.
+	SaveSlotCachePrivate::Entry *const entry = &d->slots[slot];
+	d->loaded.wait(lock, [entry] {
+		return (entry->state != SaveSlotCachePrivate::Entry::STATE_LOADING);
+	});
+
+	if (entry->state == SaveSlotCachePrivate::Entry::STATE_STALE) {
+		// Load the slot on this thread.
+		d->refreshSlot(lock, slot, info);
+	} else {
+		*info = entry->info;
+	}
+
+	// img.data points into this copy's buffer.
+	info->img.data = (info->imgBuf.empty() ? nullptr : &info->imgBuf[0]);
+	return 0;
+}
+
+/**
+ * Invalidate a savestate slot.
+ * This should be called after a savestate is written.
+ * The slot will be reloaded on a background thread.
+ * @param slot Save slot.
+ */
+void SaveSlotCache::invalidate(int slot)
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	if (slot < 0 || slot >= d->numSlots)
+		return;
+	d->invalidateSlot(slot);
+	d->cond.notify_one();
+}
+
+}
@@ -0,0 +1,125 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * SaveSlotCache.hpp: Savestate slot metadata cache.                       *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_EMUCONTEXT_SAVESLOTCACHE_HPP__
+#define __LIBGENS_EMUCONTEXT_SAVESLOTCACHE_HPP__
+
+// LibZomg
+#include "libzomg/img_data.h"
+
+// C includes.
+#include <stdint.h>
+#include <time.h>
+
+// C++ includes.
+#include <string>
+#include <vector>
+
+namespace LibGens {
+
+class SaveSlotCachePrivate;
+class SaveSlotCache
+{
+	public:
+		SaveSlotCache();
+		~SaveSlotCache();
+
+	protected:
+		friend class SaveSlotCachePrivate;
+		SaveSlotCachePrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		SaveSlotCache(const SaveSlotCache &);
+		SaveSlotCache &operator=(const SaveSlotCache &);
+
+	public:
+		/**
+		 * Maximum number of save slots.
+		 */
+		static const int MAX_SLOTS = 10;
+
+		/**
+		 * Set the savestate filenames for the current ROM.
+		 *
+		 * Any cached metadata is discarded. The slots are
+		 * then loaded on a background thread, so slotInfo()
+		 * usually won't have to touch the disk.
+		 *
+		 * @param filenames Savestate filenames, indexed by slot. (UTF-8)
+		 * Slots past MAX_SLOTS are ignored.
+		 */
+		void setFilenames(const std::vector<std::string> &filenames);
+
+		/**
+		 * Clear the cache, e.g. when the ROM is closed.
+		 */
+		void clear(void);
+
+		/**
+		 * Slot status.
+		 */
+		enum SlotStatus {
+			SLOT_EMPTY,	// Savestate does not exist.
+			SLOT_OCCUPIED,	// Savestate exists.
+			SLOT_ERROR,	// Savestate exists, but could not be opened.
+		};
+
+		/**
+		 * Savestate slot metadata.
+		 */
+		struct SlotInfo {
+			SlotStatus status;
+			time_t mtime;		// Savestate modification time.
+
+			// Preview image.
+			// If there's no preview image, img.data is nullptr.
+			// Otherwise, img.data points into imgBuf, so it must
+			// be reset if this struct is copied.
+			Zomg_Img_Data_t img;
+			std::vector<uint8_t> imgBuf;
+		};
+
+		/**
+		 * Get the metadata for a savestate slot.
+		 *
+		 * If the slot has already been loaded, this is a
+		 * memory lookup. If it hasn't been loaded yet, or if
+		 * it was invalidated, it's loaded before returning.
+		 *
+		 * @param slot	[in] Save slot.
+		 * @param info	[out] Slot metadata.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int slotInfo(int slot, SlotInfo *info);
+
+		/**
+		 * Invalidate a savestate slot.
+		 * This should be called after a savestate is written.
+		 * The slot will be reloaded on a background thread.
+		 * @param slot Save slot.
+		 */
+		void invalidate(int slot);
+};
+
+}
+
+#endif /* __LIBGENS_EMUCONTEXT_SAVESLOTCACHE_HPP__ */
@@ -0,0 +1,225 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * SaveStateWorker.cpp: Asynchronous savestate writer.                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "SaveStateWorker.hpp"
+#include "EmuContext.hpp"
+
+// LibZomg
+#include "libzomg/Zomg.hpp"
+using LibZomg::Zomg;
+
+// C includes. (C++ namespace)
+#include <cerrno>
+
+// C++ includes.
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+using std::deque;
+using std::string;
+
+namespace LibGens {
+
+class SaveStateWorkerPrivate
+{
+	public:
+		SaveStateWorkerPrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		SaveStateWorkerPrivate(const SaveStateWorkerPrivate &);
+		SaveStateWorkerPrivate &operator=(const SaveStateWorkerPrivate &);
+
+	public:
+		// Pending savestate.
+		// The ZOMG was opened with ZOMG_SAVE_DEFERRED.
+		struct Job {
+			Zomg *zomg;
+			string filename;
+			int id;
+		};
+
+		// Job and result queues. Protected by mtx.
+		mutable std::mutex mtx;
+		std::condition_variable cond;	// New job, or quit.
+		std::condition_variable idle;	// Job completed.
+		deque<Job> queue;
+		deque<SaveStateWorker::Result> results;
+		bool busy;	// Worker thread is writing a savestate.
+		bool quit;
+
+		// Worker thread.
+		// Started when the first savestate is queued.
+		std::thread thread;
+
+		/**
+		 * Worker thread function.
+		 */
+		void run(void);
+};
+
+SaveStateWorkerPrivate::SaveStateWorkerPrivate()
+	: busy(false)
+	, quit(false)
+{ }
+
+/**
+ * Worker thread function.
+ */
+void SaveStateWorkerPrivate::run(void)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		cond.wait(lock, [this] { return (!queue.empty() || quit); });
+		if (queue.empty()) {
+			// No more jobs, and we've been told to quit.
+			break;
+		}
+
+		Job job = queue.front();
+		queue.pop_front();
+		busy = true;
+
+		// Don't hold the lock while compressing.
+		lock.unlock();
+		SaveStateWorker::Result result;
+		result.filename = job.filename;
+		result.id = job.id;
+		result.ret = job.zomg->writeDeferred();
+		delete job.zomg;
+		lock.lock();
+
+		results.push_back(result);
+		busy = false;
+		idle.notify_all();
+	}
+}
+
+/** SaveStateWorker **/
+
+SaveStateWorker::SaveStateWorker()
+	: d(new SaveStateWorkerPrivate())
+{ }
+
+SaveStateWorker::~SaveStateWorker()
+{
+	// Finish writing any pending savestates.
+	if (d->thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(d->mtx);
+			d->quit = true;
+		}
+		d->cond.notify_one();
+		d->thread.join();
+	}
+	delete d;
+}
+
+/**
+ * Save the current state to a ZOMG file.
+ *
+ * The emulation state and preview image are copied
+ * into memory on the calling thread. Compression and
+ * file writes are done on a background thread.
+ * Use poll() to get the result.
+ *
+ * @param context	[in] Emulation context.
+ * @param filename	[in] ZOMG file. (UTF-8)
+ * @param id		[in] Caller-defined ID, e.g. the save slot.
+ * @return 0 if the save was queued; negative errno on error.
+ */
+int SaveStateWorker::save(const EmuContext *context, const char *filename, int id)
+{
+	if (!context || !filename || !filename[0])
+		return -EINVAL;
+
+	// Snapshot the emulation state.
+	Zomg *zomg = new Zomg(filename, Zomg::ZOMG_SAVE_DEFERRED);
+	if (!zomg->isOpen()) {
+		int ret = zomg->lastError();
+		delete zomg;
+		return (ret != 0 ? ret : -EIO);
+	}
+	int ret = context->zomgSave(zomg);
+	if (ret != 0) {
+		// Don't write a partial savestate.
+		// Deleting the ZOMG discards the deferred files.
+		delete zomg;
+		return ret;
+	}
+
+	// Queue the savestate for the worker thread.
+	{
+		std::lock_guard<std::mutex> lock(d->mtx);
+		SaveStateWorkerPrivate::Job job;
+		job.zomg = zomg;
+		job.filename = filename;
+		job.id = id;
+		d->queue.push_back(job);
+		if (!d->thread.joinable()) {
+			d->quit = false;
+			d->thread = std::thread(&SaveStateWorkerPrivate::run, d);
+		}
+	}
+	d->cond.notify_one();
+	return 0;
+}
+
+/**
+ * Get the next completed savestate.
+ * This function does not block.
+ * @param result	[out] Completed savestate.
+ * @return True if a result was returned; false if none are available.
+ */
+bool SaveStateWorker::poll(Result *result)
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	if (d->results.empty())
+		return false;
+	*result = d->results.front();
+	d->results.pop_front();
+	return true;
+}
+
+/**
+ * Are any savestates still being written?
+ * @return True if savestates are pending.
+ */
+bool SaveStateWorker::isBusy(void) const
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	return (d->busy || !d->queue.empty());
+}
+
+/**
+ * Wait for all pending savestates to be written.
+ * This should be called before loading a savestate
+ * that may still be pending.
+ */
+void SaveStateWorker::wait(void)
+{
+	std::unique_lock<std::mutex> lock(d->mtx);
+	d->idle.wait(lock, [this] { return (!d->busy && d->queue.empty()); });
+}
+
+}
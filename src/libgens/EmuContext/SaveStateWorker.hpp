@@ -0,0 +1,97 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * SaveStateWorker.hpp: Asynchronous savestate writer.                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_EMUCONTEXT_SAVESTATEWORKER_HPP__
+#define __LIBGENS_EMUCONTEXT_SAVESTATEWORKER_HPP__
+
+// C++ includes.
+#include <string>
+
+namespace LibGens {
+
+class EmuContext;
+
+class SaveStateWorkerPrivate;
+class SaveStateWorker
+{
+	public:
+		SaveStateWorker();
+		~SaveStateWorker();
+
+	protected:
+		friend class SaveStateWorkerPrivate;
+		SaveStateWorkerPrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		SaveStateWorker(const SaveStateWorker &);
+		SaveStateWorker &operator=(const SaveStateWorker &);
+
+	public:
+		/**
+		 * Save the current state to a ZOMG file.
+		 *
+		 * The emulation state and preview image are copied
+		 * into memory on the calling thread. Compression and
+		 * file writes are done on a background thread.
+		 * Use poll() to get the result.
+		 *
+		 * @param context	[in] Emulation context.
+		 * @param filename	[in] ZOMG file. (UTF-8)
+		 * @param id		[in] Caller-defined ID, e.g. the save slot.
+		 * @return 0 if the save was queued; negative errno on error.
+		 */
+		int save(const EmuContext *context, const char *filename, int id);
+
+		/**
+		 * Completed savestate.
+		 */
+		struct Result {
+			std::string filename;
+			int id;		// Caller-defined ID.
+			int ret;	// 0 on success; negative errno on error.
+		};
+
+		/**
+		 * Get the next completed savestate.
+		 * This function does not block.
+		 * @param result	[out] Completed savestate.
+		 * @return True if a result was returned; false if none are available.
+		 */
+		bool poll(Result *result);
+
+		/**
+		 * Are any savestates still being written?
+		 * @return True if savestates are pending.
+		 */
+		bool isBusy(void) const;
+
+		/**
+		 * Wait for all pending savestates to be written.
+		 * This should be called before loading a savestate
+		 * that may still be pending.
+		 */
+		void wait(void);
+};
+
+}
+
+#endif /* __LIBGENS_EMUCONTEXT_SAVESTATEWORKER_HPP__ */
@@ -0,0 +1,136 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * StateHash.cpp: Per-frame emulation state hash.                          *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "StateHash.hpp"
+
+// Byteswapping macros.
+#include "libcompat/byteswap.h"
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cstring>
+
+// zlib
+#include <zlib.h>
+
+namespace LibGens {
+
+StateHash::StateHash()
+{
+	clear();
+}
+
+/**
+ * Clear all subsystem hashes.
+ */
+void StateHash::clear(void)
+{
+	memset(m_hash, 0, sizeof(m_hash));
+}
+
+/**
+ * Hash a subsystem.
+ * @param ss Subsystem.
+ * @param buf Data.
+ * @param len Length of data.
+ */
+void StateHash::set(Subsystem ss, const void *buf, size_t len)
+{
+	assert(ss >= 0 && ss < SS_MAX);
+	m_hash[ss] = 0;
+	append(ss, buf, len);
+}
+
+/**
+ * Append data to a subsystem's hash.
+ * This is used for subsystems that aren't
+ * stored in a single contiguous buffer.
+ * @param ss Subsystem.
+ * @param buf Data.
+ * @param len Length of data.
+ */
+void StateHash::append(Subsystem ss, const void *buf, size_t len)
+{
+	assert(ss >= 0 && ss < SS_MAX);
+	// NOTE: zlib's crc32() takes a uInt length,
+	// but none of the subsystems are anywhere near 4 GB.
+	m_hash[ss] = (uint32_t)crc32(m_hash[ss], (const Bytef*)buf, (uInt)len);
+}
+
+/**
+ * Get a hash of all subsystems.
+ * This is the value stored in input movies.
+ * @return Combined hash.
+ */
+uint32_t StateHash::combined(void) const
+{
+	// Hash the subsystem hashes in little-endian
+	// so the combined hash doesn't depend on how
+	// the hash array is stored.
+	uint32_t le[SS_MAX];
+	for (int i = 0; i < SS_MAX; i++) {
+		le[i] = cpu_to_le32(m_hash[i]);
+	}
+	return (uint32_t)crc32(0, (const Bytef*)le, (uInt)sizeof(le));
+}
+
+/**
+ * Find the first subsystem that differs from another hash.
+ * @param other Other state hash.
+ * @return First subsystem that differs, or SS_MAX if they're identical.
+ */
+StateHash::Subsystem StateHash::compare(const StateHash &other) const
+{
+	for (int i = 0; i < SS_MAX; i++) {
+		if (m_hash[i] != other.m_hash[i])
+			return (Subsystem)i;
+	}
+	return SS_MAX;
+}
+
+/**
+ * Get the name of a subsystem.
+ * @param ss Subsystem.
+ * @return Subsystem name, or nullptr if ss is invalid.
+ */
+const char *StateHash::SubsystemName(Subsystem ss)
+{
+	static const char *const names[SS_MAX] = {
+		"68000 RAM",		// SS_M68K_RAM
+		"68000 registers",	// SS_M68K_REG
+		"Z80 RAM",		// SS_Z80_RAM
+		"Z80 registers",	// SS_Z80_REG
+		"VDP registers",	// SS_VDP_REG
+		"VRAM",			// SS_VRAM
+		"CRAM",			// SS_CRAM
+		"VSRAM",		// SS_VSRAM
+		"YM2612",		// SS_YM2612
+		"PSG",			// SS_PSG
+		"Framebuffer",		// SS_FRAMEBUFFER
+		"Audio",		// SS_AUDIO
+	};
+
+	if (ss < 0 || ss >= SS_MAX)
+		return nullptr;
+	return names[ss];
+}
+
+}
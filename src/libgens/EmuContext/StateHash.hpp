@@ -0,0 +1,147 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * StateHash.hpp: Per-frame emulation state hash.                          *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_EMUCONTEXT_STATEHASH_HPP__
+#define __LIBGENS_EMUCONTEXT_STATEHASH_HPP__
+
+// C includes.
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LibGens {
+
+/**
+ * Emulation state hash.
+ * This is filled in by EmuContext::stateHash() after
+ * a frame is run. Each subsystem is hashed separately,
+ * so if two runs diverge, the first subsystem that
+ * differs can be determined.
+ *
+ * Hashes are CRC32s of the host representation of
+ * each subsystem, so they can only be compared with
+ * hashes from a host with the same byte order.
+ */
+class StateHash
+{
+	public:
+		StateHash();
+
+		/**
+		 * Subsystems.
+		 * Subsystems that aren't emulated by the
+		 * current system are left as 0.
+		 */
+		enum Subsystem {
+			SS_M68K_RAM,	// 68000 RAM.
+			SS_M68K_REG,	// 68000 registers.
+			SS_Z80_RAM,	// Z80 RAM.
+			SS_Z80_REG,	// Z80 registers.
+			SS_VDP_REG,	// VDP registers and control state.
+			SS_VRAM,	// VDP VRAM.
+			SS_CRAM,	// VDP CRAM.
+			SS_VSRAM,	// VDP VSRAM.
+			SS_YM2612,	// YM2612 registers.
+			SS_PSG,		// PSG registers.
+			SS_FRAMEBUFFER,	// Framebuffer. (optional)
+			SS_AUDIO,	// Audio output. (optional)
+
+			SS_MAX
+		};
+
+		/**
+		 * Optional subsystems for EmuContext::stateHash().
+		 */
+		enum Flags {
+			// Hash the visible area of the framebuffer.
+			// The framebuffer isn't updated by execFrameFast(),
+			// and it depends on the color depth.
+			HASH_FRAMEBUFFER	= (1 << 0),
+
+			// Hash the frame's audio output.
+			// This must be hashed before the frontend
+			// writes the audio, which clears the buffer.
+			HASH_AUDIO		= (1 << 1),
+		};
+
+		/**
+		 * Clear all subsystem hashes.
+		 */
+		void clear(void);
+
+		/**
+		 * Hash a subsystem.
+		 * @param ss Subsystem.
+		 * @param buf Data.
+		 * @param len Length of data.
+		 */
+		void set(Subsystem ss, const void *buf, size_t len);
+
+		/**
+		 * Append data to a subsystem's hash.
+		 * This is used for subsystems that aren't
+		 * stored in a single contiguous buffer.
+		 * @param ss Subsystem.
+		 * @param buf Data.
+		 * @param len Length of data.
+		 */
+		void append(Subsystem ss, const void *buf, size_t len);
+
+		/**
+		 * Get a subsystem's hash.
+		 * @param ss Subsystem.
+		 * @return Hash.
+		 */
+		inline uint32_t hash(Subsystem ss) const
+			{ return m_hash[ss]; }
+
+		/**
+		 * Get a hash of all subsystems.
+		 * This is the value stored in input movies.
+		 * @return Combined hash.
+		 */
+		uint32_t combined(void) const;
+
+		/**
+		 * Find the first subsystem that differs from another hash.
+		 * @param other Other state hash.
+		 * @return First subsystem that differs, or SS_MAX if they're identical.
+		 */
+		Subsystem compare(const StateHash &other) const;
+
+		inline bool operator==(const StateHash &other) const
+			{ return (compare(other) == SS_MAX); }
+		inline bool operator!=(const StateHash &other) const
+			{ return (compare(other) != SS_MAX); }
+
+		/**
+		 * Get the name of a subsystem.
+		 * @param ss Subsystem.
+		 * @return Subsystem name, or nullptr if ss is invalid.
+		 */
+		static const char *SubsystemName(Subsystem ss);
+
+	private:
+		uint32_t m_hash[SS_MAX];
+};
+
+}
+
+#endif /* __LIBGENS_EMUCONTEXT_STATEHASH_HPP__ */
@@ -67,6 +67,44 @@ void IoManager::reset(void)
 			dev->reset();
 		}
 	}
+
+	// Device state may have changed.
+	d->generation = IoManagerPrivate::newGeneration();
+}
+
+/**
+ * Set the input event queue.
+ *
+ * If set, queued button states are applied when the
+ * game reads a controller port, instead of once per
+ * frame by update(). Events may be pushed from any thread.
+ *
+ * The queue must outlive the IoManager, or be unset first.
+ * @param queue Input event queue, or nullptr to disable.
+ */
+void IoManager::setInputQueue(InputQueue *queue)
+{
+	d->inputQueue = queue;
+	d->hasNextEvent = false;
+}
+
+/**
+ * Get the input event queue.
+ * @return Input event queue, or nullptr if disabled.
+ */
+IoManager::InputQueue *IoManager::inputQueue(void) const
+{
+	return d->inputQueue;
+}
+
+/**
+ * Get the timestamp of the most recently applied input event.
+ * This can be used to measure input latency.
+ * @return Timestamp, or 0 if no events have been applied.
+ */
+uint64_t IoManager::lastInputTimestamp(void) const
+{
+	return d->lastInputTimestamp;
 }
 
 /**
@@ -77,6 +115,7 @@ void IoManager::reset(void)
  */
 void IoManager::doScanline(void)
 {
+	d->scanlines++;
 	for (int i = 0; i < ARRAY_SIZE(d->ioDevices); i++) {
 		IO::Device *const dev = d->ioDevices[i];
 		if (dev != nullptr) {
@@ -217,6 +256,20 @@ IoManager::IoType_t IoManager::devType(VirtPort_t virtPort) const
 	return d->ioDevices[virtPort]->type();
 }
 
+/**
+ * Get the device configuration generation.
+ * This changes whenever the device types may have
+ * changed, i.e. on construction, reset(), and
+ * setDevType(). Generations are unique across
+ * all IoManager instances, so a new IoManager at
+ * the same address as a deleted one can be detected.
+ * @return Device configuration generation.
+ */
+unsigned int IoManager::generation(void) const
+{
+	return d->generation;
+}
+
 /**
  * Set the device type for a given virtual port.
  * @param virtPort Virtual port.
@@ -265,6 +318,9 @@ void IoManager::setDevType(VirtPort_t virtPort, IoType_t ioType)
 		}
 	}
 
+	// The device type is changing.
+	d->generation = IoManagerPrivate::newGeneration();
+
 	// Create a new device.
 	// TODO: Copy MD-side data from old device using a pseudo-copy constructor...
 	// TODO: Don't create TP/4WP sub-devices if the main devices are missing?
@@ -409,6 +465,9 @@ uint8_t IoManager::readDataMD(int physPort) const
 	// All input bits should read the device data.
 	// All output bits should read the MD data.
 
+	// Apply any input events that arrived since the last read.
+	d->applyInputQueue();
+
 	// TODO: 4WP (and maybe TP?) needs to receive updates from the virtual potrs.
 	IO::Device *const dev = d->ioDevices[physPort];
 	assert(dev != nullptr);	// Physical ports must be allocated.
@@ -705,6 +764,9 @@ uint8_t IoManager::readStartGG(void) const
  */
 uint8_t IoManager::picoReadButtons(void) const
 {
+	// Apply any input events that arrived since the last read.
+	d->applyInputQueue();
+
 	uint8_t ret = 0xFF;
 	const IO::Device *dev = d->ioDevices[VIRTPORT_1];
 	// TODO: Remove the dev->type() check?
@@ -831,6 +893,18 @@ void IoManager::update(int virtPort, uint32_t buttons)
 	}
 }
 
+/**
+ * Get an I/O device's button state.
+ * @param virtPort Virtual port.
+ * @return Button state, as set by update(); ~0 if no device is connected.
+ */
+uint32_t IoManager::buttons(int virtPort) const
+{
+	assert(virtPort >= VIRTPORT_1 && virtPort < VIRTPORT_MAX);
+	const IO::Device *const dev = d->ioDevices[virtPort];
+	return (dev ? dev->getButtons() : ~0U);
+}
+
 /**
  * Update an I/O device's absolute tablet coordinates.
  * Coordinates must be scaled to 1280x240.
@@ -33,6 +33,9 @@
 // ZOMG savestate structs.
 #include "libzomg/zomg_md_io.h"
 
+// Lock-free input event queue.
+#include "../Util/MpscQueue.hpp"
+
 namespace LibGens
 {
 
@@ -122,6 +125,13 @@ class IoManager
 		 */
 		void update(int virtPort, uint32_t buttons);
 
+		/**
+		 * Get an I/O device's button state.
+		 * @param virtPort Virtual port.
+		 * @return Button state, as set by update(); ~0 if no device is connected.
+		 */
+		uint32_t buttons(int virtPort) const;
+
 		/**
 		 * Update an I/O device's absolute tablet coordinates.
 		 * Coordinates must be scaled to 1280x240.
@@ -134,6 +144,50 @@ class IoManager
 		 */
 		void updateAbsolutePosition(int virtPort, int x, int y);
 
+		/** Sub-frame input. **/
+
+		/**
+		 * Timestamped button state for a virtual port.
+		 * Frontends push one of these whenever a port's
+		 * button state changes.
+		 */
+		struct InputEvent {
+			int virtPort;		// Virtual port.
+			uint32_t buttons;	// New button state. (Same format as update().)
+			uint64_t timestamp;	// Frontend-defined, e.g. Timing::getTime().
+		};
+		typedef MpscQueue<InputEvent> InputQueue;
+
+		/**
+		 * Set the input event queue.
+		 *
+		 * If set, queued button states are applied when the
+		 * game reads a controller port, instead of once per
+		 * frame by update(). Events may be pushed from any thread.
+		 *
+		 * Each new button state is held for a few scanlines
+		 * before the next one for the same port is applied,
+		 * so a press that's shorter than a frame is still
+		 * seen by the game's entire controller poll.
+		 *
+		 * The queue must outlive the IoManager, or be unset first.
+		 * @param queue Input event queue, or nullptr to disable.
+		 */
+		void setInputQueue(InputQueue *queue);
+
+		/**
+		 * Get the input event queue.
+		 * @return Input event queue, or nullptr if disabled.
+		 */
+		InputQueue *inputQueue(void) const;
+
+		/**
+		 * Get the timestamp of the most recently applied input event.
+		 * This can be used to measure input latency.
+		 * @return Timestamp, or 0 if no events have been applied.
+		 */
+		uint64_t lastInputTimestamp(void) const;
+
 		/**
 		 * Update the scanline counter for all controllers.
 		 * This is used by the 6-button controller,
@@ -297,6 +351,17 @@ class IoManager
 		 */
 		void setDevType(VirtPort_t virtPort, IoType_t ioType);
 
+		/**
+		 * Get the device configuration generation.
+		 * This changes whenever the device types may have
+		 * changed, i.e. on construction, reset(), and
+		 * setDevType(). Generations are unique across
+		 * all IoManager instances, so a new IoManager at
+		 * the same address as a deleted one can be detected.
+		 * @return Device configuration generation.
+		 */
+		unsigned int generation(void) const;
+
 		/** Properties. **/
 
 		// Constrain D-Pad input.
@@ -30,6 +30,9 @@
 // C includes. (C++ namespace)
 #include <cstring>
 
+// C++ includes.
+#include <atomic>
+
 namespace LibGens {
 
 /**
@@ -72,9 +75,16 @@ const IoManagerPrivate::IoDevInfo IoManagerPrivate::ioDevInfo[IoManager::IOT_MAX
 IoManagerPrivate::IoManagerPrivate(IoManager *q)
 	: q(q)
 	, constrainDPad(true)
+	, generation(newGeneration())
+	, inputQueue(nullptr)
+	, hasNextEvent(false)
+	, scanlines(INPUT_HOLD_LINES)
+	, lastInputTimestamp(0)
 {
 	// Clear the I/O devices array.
 	memset(ioDevices, 0, sizeof(ioDevices));
+	memset(portScanline, 0, sizeof(portScanline));
+	memset(&nextEvent, 0, sizeof(nextEvent));
 
 	// Allocate empty devices for the three physical ports.
 	ioDevices[IoManager::VIRTPORT_1] = new IO::Device();
@@ -90,4 +100,51 @@ IoManagerPrivate::~IoManagerPrivate()
 	}
 }
 
+/**
+ * Get a new device configuration generation.
+ * @return New generation.
+ */
+unsigned int IoManagerPrivate::newGeneration(void)
+{
+	static std::atomic<unsigned int> nextGeneration(1);
+	return nextGeneration++;
+}
+
+/**
+ * Apply queued input events.
+ * Called when a controller port is read.
+ */
+void IoManagerPrivate::applyInputQueue(void)
+{
+	if (!inputQueue)
+		return;
+
+	while (true) {
+		if (!hasNextEvent) {
+			if (!inputQueue->pop(&nextEvent))
+				break;
+			hasNextEvent = true;
+		}
+
+		const int virtPort = nextEvent.virtPort;
+		if (virtPort < IoManager::VIRTPORT_1 || virtPort >= IoManager::VIRTPORT_MAX) {
+			// Invalid virtual port.
+			hasNextEvent = false;
+			continue;
+		}
+
+		if (scanlines - portScanline[virtPort] < INPUT_HOLD_LINES) {
+			// The current state was applied too recently.
+			// Hold this event (and everything after it)
+			// so the rest of this poll sees a consistent state.
+			break;
+		}
+
+		q->update(virtPort, nextEvent.buttons);
+		portScanline[virtPort] = scanlines;
+		lastInputTimestamp = nextEvent.timestamp;
+		hasNextEvent = false;
+	}
+}
+
 }
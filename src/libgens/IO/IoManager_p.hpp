@@ -141,6 +141,48 @@ class IoManagerPrivate
 		// This only affects devices with a D-Pad
 		// as buttons 0-3.
 		bool constrainDPad;
+
+		/**
+		 * Device configuration generation.
+		 * Changed whenever the device types may have changed.
+		 * Generations are unique across all IoManager instances.
+		 */
+		unsigned int generation;
+
+		/**
+		 * Get a new device configuration generation.
+		 * @return New generation.
+		 */
+		static unsigned int newGeneration(void);
+
+		/** Sub-frame input. **/
+
+		// Input event queue.
+		IoManager::InputQueue *inputQueue;
+
+		// Next event. Held if it can't be applied yet.
+		IoManager::InputEvent nextEvent;
+		bool hasNextEvent;
+
+		// Scanline counter. Incremented by doScanline().
+		uint32_t scanlines;
+		// Scanline each virtual port's state was last applied.
+		uint32_t portScanline[IoManager::VIRTPORT_MAX];
+		// Timestamp of the most recently applied event.
+		uint64_t lastInputTimestamp;
+
+		/**
+		 * Minimum number of scanlines to hold a button state
+		 * before applying the next one for the same port.
+		 * Controller polls usually finish within a few lines.
+		 */
+		static const uint32_t INPUT_HOLD_LINES = 16;
+
+		/**
+		 * Apply queued input events.
+		 * Called when a controller port is read.
+		 */
+		void applyInputQueue(void);
 };
 
 }
@@ -27,26 +27,35 @@
 #include "libgensfile/Archive.hpp"
 #include "libgensfile/ArchiveFactory.hpp"
 #include "libgensfile/MemFake.hpp"
+#include "libgensfile/MemMapped.hpp"
+#include "libgensfile/RomCache.hpp"
 using LibGensFile::Archive;
 using LibGensFile::ArchiveFactory;
 using LibGensFile::MemFake;
+using LibGensFile::MemMapped;
+using LibGensFile::RomCache;
 
 // C includes. (C++ namespace)
 #include <cstring>
 #include <cctype>
 #include <cstdio>
 #include <cassert>
+#include <cerrno>
 
 // C++ includes.
 #include <algorithm>
 #include <string>
 using std::string;
 using std::u16string;
+using std::vector;
 
 #ifdef _WIN32
 // Win32 Unicode Translation Layer.
 // Needed for proper Unicode filename support on Windows.
 #include "libcompat/W32U/W32U_mini.h"
+#else /* !_WIN32 */
+// stat()
+#include <sys/stat.h>
 #endif
 
 // Character set conversion.
@@ -138,6 +147,19 @@ class RomPrivate
 		 */
 		void DecodeSMDBlock(uint8_t *dest, const uint8_t *src);
 
+		/**
+		 * Decode the ROM image into a buffer.
+		 * The ROM is read from the file mapping or rawData
+		 * if available; otherwise, it's read from the archive.
+		 * SMD blocks are deinterleaved and the CRC32
+		 * is updated in the same pass.
+		 * @param buf	[out] Buffer.
+		 * @param siz	[in]  Size of buf.
+		 * @param pCrc	[out] CRC32 of the ROM image.
+		 * @return Number of bytes read on success; negative on error.
+		 */
+		int64_t decodeRom(uint8_t *buf, size_t siz, uint32_t *pCrc);
+
 		/** ROM header functions. **/
 		int loadRomHeader(Rom::MDP_SYSTEM_ID sysOverride, Rom::RomFormat fmtOverride);
 		void readHeaderMD(const uint8_t *header, size_t header_size);
@@ -180,8 +202,37 @@ class RomPrivate
 		MD_RomHeader m_mdHeader;
 
 		uint32_t rom_crc32;	// ROM CRC32.
+
+		/**
+		 * Raw ROM data, as stored in the file.
+		 * loadRomHeader() reads the entire file if it isn't
+		 * too big, and loadRom() decodes the ROM from here,
+		 * so compressed ROMs are only decompressed once.
+		 * This is freed by loadRom().
+		 */
+		uint8_t *rawData;
+		size_t rawData_size;
+		static const size_t RAW_DATA_MAX = (32*1024*1024) + 512;
+
+		// ROM cache.
+		static RomCache *ms_romCache;
+		// Cache key for the selected file.
+		// Empty if the file can't be cached.
+		std::string cacheKey;
+		// Cached ROM image, if the selected file was found
+		// in the ROM cache. This is freed by loadRom().
+		RomCache::Entry *cacheEntry;
+
+		/**
+		 * Look up the selected file in the ROM cache.
+		 * cacheKey and cacheEntry are updated.
+		 * @param fmtOverride ROM format override.
+		 */
+		void lookupRomCache(Rom::RomFormat fmtOverride);
 };
 
+RomCache *RomPrivate::ms_romCache = nullptr;
+
 /**
  * Initialize a new RomPrivate object.
  * @param q Rom object that owns this RomPrivate object.
@@ -204,6 +255,9 @@ RomPrivate::RomPrivate(Rom *q, const char *filename,
 	, romSize(0)
 	, regionCode(0)
 	, rom_crc32(0)
+	, rawData(nullptr)
+	, rawData_size(0)
+	, cacheEntry(nullptr)
 {
 	// If filename is nullptr, don't do anything else.
 	if (!filename)
@@ -283,6 +337,9 @@ RomPrivate::RomPrivate(Rom *q, const uint8_t *rom_data, unsigned int rom_size,
 	, romSize(0)
 	, regionCode(0)
 	, rom_crc32(0)
+	, rawData(nullptr)
+	, rawData_size(0)
+	, cacheEntry(nullptr)
 {
 	// TODO: Support decompression from RAM.
 	// For now, use a fake decompressor that provides the same
@@ -336,6 +393,10 @@ RomPrivate::~RomPrivate()
 	if (file) {
 		fclose(file);
 	}
+
+	// Free the raw ROM data.
+	free(rawData);
+	delete cacheEntry;
 }
 
 /**
@@ -576,30 +637,78 @@ int RomPrivate::loadRomHeader(Rom::MDP_SYSTEM_ID sysOverride, Rom::RomFormat fmt
 	// TODO: Save the internal filename for multi-file archives.
 	romSize = z_entry_sel->filesize;
 
+	// Discard any previously-read ROM data.
+	free(rawData);
+	rawData = nullptr;
+	rawData_size = 0;
+
+	// Check the ROM cache first.
+	lookupRomCache(fmtOverride);
+	if (cacheEntry) {
+		// The cached ROM image is already decompressed
+		// and deinterleaved, so use it as the header.
+		if (romFormat == Rom::RFMT_UNKNOWN) {
+			romFormat = (Rom::RomFormat)cacheEntry->romFormat;
+		}
+		if (sysId == Rom::MDP_SYSTEM_UNKNOWN) {
+			sysId = (Rom::MDP_SYSTEM_ID)cacheEntry->sysId;
+		}
+		romSize = (unsigned int)cacheEntry->data.size();
+		readHeaderMD(&cacheEntry->data[0], cacheEntry->data.size());
+		return 0;
+	}
+
 	// Load the ROM header for detection purposes.
+	// If the file is mapped into memory, use the mapping directly.
+	// Otherwise, if the ROM isn't too big, read the entire file now.
+	// loadRom() will decode the ROM from this data, so
+	// the file only has to be read (and decompressed) once.
 	static const size_t ROM_HEADER_SIZE = 65536+512;
-	uint8_t *header = (uint8_t*)malloc(ROM_HEADER_SIZE);
-	if (!header) {
-		// Memory allocation error.
-		// TODO: Error code constants.
-		return -2;
-	}
+	const uint8_t *mapped = archive->mappedData(z_entry_sel);
+	const bool readAll = (!mapped && z_entry_sel->filesize <= RAW_DATA_MAX);
+	const uint8_t *header;
+	size_t header_size;
+	uint8_t *buf = nullptr;
+
+	if (mapped && z_entry_sel->filesize >= ROM_HEADER_SIZE) {
+		// File is mapped into memory.
+		header = mapped;
+		header_size = ROM_HEADER_SIZE;
+	} else {
+		const size_t read_size = (readAll || z_entry_sel->filesize < ROM_HEADER_SIZE
+						? z_entry_sel->filesize : ROM_HEADER_SIZE);
+		const size_t buf_size = std::max(read_size, ROM_HEADER_SIZE);
+		buf = (uint8_t*)malloc(buf_size);
+		if (!buf) {
+			// Memory allocation error.
+			// TODO: Error code constants.
+			return -2;
+		}
 
-	// Read the ROM header.
-	Archive::file_offset_t header_size_fo;
-	int ret = archive->readFile(z_entry_sel, header, ROM_HEADER_SIZE, &header_size_fo);
-	if (ret != 0 || header_size_fo <= 0 || header_size_fo > ROM_HEADER_SIZE) {
-		// File read error.
-		// TODO: Error code constants.
-		free(header);
-		return -3;
-	}
+		// Read the ROM data.
+		Archive::file_offset_t data_size_fo;
+		int ret = archive->readFile(z_entry_sel, buf, read_size, &data_size_fo);
+		if (ret != 0 || data_size_fo <= 0 || data_size_fo > (Archive::file_offset_t)read_size) {
+			// File read error.
+			// TODO: Error code constants.
+			free(buf);
+			return -3;
+		}
+
+		// If the data is smaller than the buffer,
+		// clear the rest of the buffer.
+		const size_t data_size = (size_t)data_size_fo;
+		if (data_size < buf_size) {
+			memset(&buf[data_size], 0x00, (buf_size - data_size));
+		}
+		if (readAll) {
+			// Keep the data for loadRom().
+			rawData = buf;
+			rawData_size = data_size;
+		}
 
-	// If the header size is smaller than the header buffer,
-	// clear the rest of the header buffer.
-	size_t header_size = (size_t)header_size_fo;
-	if (header_size < sizeof(header)) {
-		memset(&header[header_size], 0x00, (ROM_HEADER_SIZE - header_size));
+		header = buf;
+		header_size = std::min(data_size, ROM_HEADER_SIZE);
 	}
 
 	// Detect the ROM format first.
@@ -608,6 +717,7 @@ int RomPrivate::loadRomHeader(Rom::MDP_SYSTEM_ID sysOverride, Rom::RomFormat fmt
 	}
 
 	// Adjust the ROM size for certain interleaved ROM formats.
+	uint8_t *bin_header = nullptr;
 	switch (romFormat) {
 		case Rom::RFMT_SMD:
 		case Rom::RFMT_SMD_SPLIT: {
@@ -622,14 +732,19 @@ int RomPrivate::loadRomHeader(Rom::MDP_SYSTEM_ID sysOverride, Rom::RomFormat fmt
 			// Deinterleave the ROM header.
 			// Note that the actual SMD data starts at byte 512.
 			static const size_t BIN_HEADER_SIZE = 65536;
-			uint8_t *smd_header = header;
-			header = (uint8_t*)malloc(BIN_HEADER_SIZE);
-			header_size = BIN_HEADER_SIZE;
-			// TODO: Use pointer arithmetic?
+			bin_header = (uint8_t*)malloc(BIN_HEADER_SIZE);
+			if (!bin_header) {
+				// Memory allocation error.
+				if (!readAll) {
+					free(buf);
+				}
+				return -2;
+			}
 			for (size_t i = 0; i < BIN_HEADER_SIZE; i += 16384) {
-				DecodeSMDBlock(&header[i], &smd_header[i + 512]);
+				DecodeSMDBlock(&bin_header[i], &header[i + 512]);
 			}
-			free(smd_header);
+			header = bin_header;
+			header_size = BIN_HEADER_SIZE;
 		}
 
 		case Rom::RFMT_MGD:
@@ -654,10 +769,155 @@ int RomPrivate::loadRomHeader(Rom::MDP_SYSTEM_ID sysOverride, Rom::RomFormat fmt
 	readHeaderMD(header, header_size);
 
 	// ROM header loaded.
-	free(header);
+	free(bin_header);
+	if (!readAll) {
+		free(buf);
+	}
 	return 0;
 }
 
+/**
+ * Decode the ROM image into a buffer.
+ * The ROM is read from the file mapping or rawData
+ * if available; otherwise, it's read from the archive.
+ * SMD blocks are deinterleaved and the CRC32
+ * is updated in the same pass.
+ * @param buf	[out] Buffer.
+ * @param siz	[in]  Size of buf.
+ * @param pCrc	[out] CRC32 of the ROM image.
+ * @return Number of bytes read on success; negative on error.
+ */
+int64_t RomPrivate::decodeRom(uint8_t *buf, size_t siz, uint32_t *pCrc)
+{
+	if (cacheEntry) {
+		// ROM image is in the ROM cache.
+		// NOTE: If the buffer is too small, the ROM is truncated.
+		const size_t data_size = std::min(cacheEntry->data.size(), siz);
+		memcpy(buf, &cacheEntry->data[0], data_size);
+		if (data_size == cacheEntry->data.size()) {
+			*pCrc = cacheEntry->crc32;
+		} else {
+			*pCrc = (uint32_t)crc32(0, buf, (uInt)data_size);
+		}
+		return (int64_t)data_size;
+	}
+
+	// Header size for interleaved formats.
+	const size_t skip = (romFormat == Rom::RFMT_BINARY ? 0 : 512);
+
+	// Get the raw ROM data.
+	// If the file is mapped into memory, the ROM is
+	// decoded directly from the mapping. Otherwise, if
+	// rawData isn't available, read the file directly
+	// into the ROM buffer and decode it in place.
+	const uint8_t *raw = rawData;
+	size_t raw_size = rawData_size;
+	if (!raw) {
+		raw = archive->mappedData(z_entry_sel);
+		raw_size = z_entry_sel->filesize;
+	}
+
+	const uint8_t *src;
+	size_t data_size;
+	if (raw) {
+		if (raw_size <= skip)
+			return -1;
+		src = &raw[skip];
+		// NOTE: If the buffer is too small, the ROM is truncated.
+		data_size = std::min(raw_size - skip, siz);
+	} else {
+		Archive::file_offset_t ret_siz = 0;
+		int ret = archive->readFile(z_entry_sel, skip, romSize, buf, siz, &ret_siz);
+		if (ret != 0 || ret_siz <= 0 || ret_siz > (Archive::file_offset_t)siz) {
+			// Read error.
+			return -1;
+		}
+		src = buf;
+		data_size = (size_t)ret_siz;
+	}
+
+	uLong crc = crc32(0, nullptr, 0);
+	uint8_t *dest = buf;
+	size_t remain = data_size;
+
+	if (skip != 0) {
+		// Super Magic Drive. Process 16 KB blocks.
+		// If decoding in place, each block has to be
+		// copied to a temporary buffer first.
+		uint8_t *smd_block = nullptr;
+		if (src == dest) {
+			smd_block = (uint8_t*)malloc(16384);
+			if (!smd_block)
+				return -1;
+		}
+
+		for (; remain >= 16384; remain -= 16384, src += 16384, dest += 16384) {
+			if (smd_block) {
+				memcpy(smd_block, src, 16384);
+				DecodeSMDBlock(dest, smd_block);
+			} else {
+				DecodeSMDBlock(dest, src);
+			}
+			crc = crc32(crc, dest, 16384);
+		}
+		free(smd_block);
+
+		// FIXME: What do we do if remain > 0?
+		// For now, the last partial block is copied as-is.
+	}
+
+	// Copy the rest of the data, updating the CRC32 in
+	// chunks so the data is still in the cache.
+	static const size_t CHUNK_SIZE = 65536;
+	while (remain > 0) {
+		const size_t len = std::min(remain, CHUNK_SIZE);
+		if (src != dest) {
+			memcpy(dest, src, len);
+		}
+		crc = crc32(crc, dest, (uInt)len);
+		src += len;
+		dest += len;
+		remain -= len;
+	}
+
+	*pCrc = (uint32_t)crc;
+	return (int64_t)data_size;
+}
+
+/**
+ * Look up the selected file in the ROM cache.
+ * cacheKey and cacheEntry are updated.
+ * @param fmtOverride ROM format override.
+ */
+void RomPrivate::lookupRomCache(Rom::RomFormat fmtOverride)
+{
+	delete cacheEntry;
+	cacheEntry = nullptr;
+	cacheKey.clear();
+
+	// Only compressed ROMs are cached.
+	// Uncompressed ROMs are mapped into memory,
+	// which is just as fast as the ROM cache.
+	if (!ms_romCache || filename.empty() || archive->mappedData(z_entry_sel))
+		return;
+
+	cacheKey = RomCache::makeKey(filename.c_str(),
+			z_entry_sel->filename, z_entry_sel->filesize);
+	if (cacheKey.empty())
+		return;
+
+	RomCache::Entry *entry = new RomCache::Entry;
+	if (ms_romCache->lookup(cacheKey, entry) == 0 &&
+	    (fmtOverride == Rom::RFMT_UNKNOWN || fmtOverride == entry->romFormat))
+	{
+		// Found the ROM image in the cache.
+		cacheEntry = entry;
+	} else {
+		// Not cached, or cached with a different ROM format.
+		delete entry;
+	}
+}
+
 /**
  * Read the Mega Drive ROM header.
  * @param header ROM header.
@@ -771,70 +1031,188 @@ int Rom::loadRom(void *buf, size_t siz)
 	}
 
 	// Load the ROM image.
-	// TODO: Error handling.
-	int ret = -1;
-	Archive::file_offset_t ret_siz = 0;
+	int64_t ret_siz;
 	switch (d->romFormat) {
 		case Rom::RFMT_BINARY:
 			// Plain binary ROM file.
- 			ret = d->archive->readFile(d->z_entry_sel, buf, siz, &ret_siz);
-			break;
-
 		case RFMT_SMD:
 		case RFMT_SMD_SPLIT: {
+			// Super Magic Drive.
 			// TODO: Split SMD isn't supported.
 			// Handling it as plain SMD for now.
-
-			// Read the SMD data.
-			// (Skip the 512-byte header.)
-			ret = d->archive->readFile(d->z_entry_sel, 512, d->romSize, buf, siz, &ret_siz);
-			if (ret != 0 || ret_siz == 0 || ret_siz > (Archive::file_offset_t)siz) {
-				// Read error.
-				ret_siz = 0;
-				break;
+			uint32_t crc;
+			ret_siz = d->decodeRom(reinterpret_cast<uint8_t*>(buf), siz, &crc);
+			if (ret_siz > 0) {
+				// NOTE: The CRC32 only covers the ROM data,
+				// not the unused part of the buffer.
+				// TODO: Also MD5?
+				d->rom_crc32 = crc;
 			}
-
-			// Temporary SMD block buffer.
-			uint8_t *smd_block = (uint8_t*)malloc(16384);
-
-			// Process 16 KB blocks.
-			// NOTE: If ret_siz isn't a multiple of 16 KB,
-			// the last block will not be decoded properly.
-			Archive::file_offset_t remain = ret_siz;
-			const uint8_t *buf_read = reinterpret_cast<const uint8_t*>(buf);
-			uint8_t *buf_write = reinterpret_cast<uint8_t*>(buf);
-			for (; remain >= 16384; remain -= 16384, buf_read += 16384, buf_write += 16384) {
-				memcpy(smd_block, buf_read, 16384);
-				d->DecodeSMDBlock(buf_write, smd_block);
-			}
-
-			// FIXME: What do we do if remain > 0?
-			// TODO: Verify that the SMD code works with the Archive skip parameter.
-			free(smd_block);
-			ret = 0;
 			break;
 		}
 
 		default:
 			// Unsupported ROM format.
-			ret = -1;
+			ret_siz = -1;
 			break;
 	}
 
-	if (ret != 0 || ret_siz > (Archive::file_offset_t)siz) {
+	if (ret_siz > 0 && ret_siz <= (int64_t)siz && !d->cacheEntry &&
+	    !d->cacheKey.empty() && RomPrivate::ms_romCache)
+	{
+		// Store the decoded ROM image in the ROM cache.
+		RomPrivate::ms_romCache->store(d->cacheKey,
+			reinterpret_cast<const uint8_t*>(buf), (size_t)ret_siz,
+			d->rom_crc32, d->romFormat, d->sysId);
+	}
+	d->cacheKey.clear();
+
+	// The raw ROM data is no longer needed.
+	// If the ROM is loaded again, it will be read from the archive.
+	free(d->rawData);
+	d->rawData = nullptr;
+	d->rawData_size = 0;
+	delete d->cacheEntry;
+	d->cacheEntry = nullptr;
+
+	if (ret_siz <= 0 || ret_siz > (int64_t)siz) {
 		// Error reading the file.
 		return -6;
 	}
 
-	// Calculate the CRC32.
-	// TODO: Also MD5?
-	d->rom_crc32 = crc32(0, (const Bytef*)buf, siz);
-
 	// Return the number of bytes read.
 	// TODO: Change return value to Archive::file_offset_t?
 	return (int)ret_siz;
 }
 
+/**
+ * Map the ROM image into memory. (copy-on-write)
+ * This is only supported for uncompressed binary ROMs
+ * that aren't writable, since truncating the file while
+ * it's mapped would crash the emulator with SIGBUS.
+ * Pages are shared with other processes using the same
+ * ROM image until they're written to.
+ * NOTE: The ROM image is NOT byteswapped.
+ * @param siz	[in] Size of the mapping. (Must be >= romSize(); the rest is zero-filled.)
+ * @return ROM image, or nullptr if the ROM can't be mapped. Free it with unmapRom().
+ */
+void *Rom::mapRom(size_t siz)
+{
+	if (!isOpen() || !d->archive || !d->z_entry_sel)
+		return nullptr;
+	else if (d->romFormat != RFMT_BINARY || siz < (size_t)d->romSize)
+		return nullptr;
+#ifndef _WIN32
+	struct stat st;
+	if (d->filename.empty() || stat(d->filename.c_str(), &st) != 0 ||
+	    (st.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)))
+	{
+		// ROM file is writable.
+		return nullptr;
+	}
+#endif /* !_WIN32 */
+
+	void *ptr = d->archive->mapCopyOnWrite(d->z_entry_sel, siz);
+	if (!ptr)
+		return nullptr;
+
+	// Calculate the CRC32.
+	// This reads the pages, but doesn't copy them.
+	// TODO: Also MD5?
+	d->rom_crc32 = crc32(0, (const Bytef*)ptr, d->romSize);
+
+	// The raw ROM data isn't needed.
+	free(d->rawData);
+	d->rawData = nullptr;
+	d->rawData_size = 0;
+	return ptr;
+}
+
+/**
+ * Map the ROM image into memory in host 16-bit word order. (copy-on-write)
+ * The decoded, byteswapped image is stored in the ROM cache
+ * the first time the ROM is loaded, and mapped from there, so
+ * all emulator instances share one physical copy of the ROM
+ * until they write to it.
+ * This requires the ROM cache.
+ * @param siz	[in] Size of the mapping. (Must be >= romSize(); the rest is zero-filled.)
+ * @return ROM image, or nullptr if the ROM can't be mapped. Free it with unmapRom().
+ */
+void *Rom::mapRomHostOrder(size_t siz)
+{
+	RomCache *const romCache = RomPrivate::ms_romCache;
+	if (!romCache || !isOpen() || !d->z_entry_sel || d->filename.empty())
+		return nullptr;
+	else if (siz < (size_t)d->romSize)
+		return nullptr;
+
+	// The image depends on the ROM format and the host byte order.
+	string key = RomCache::makeKey(d->filename.c_str(),
+			d->z_entry_sel->filename, d->z_entry_sel->filesize);
+	if (key.empty())
+		return nullptr;
+	char buf[32];
+	snprintf(buf, sizeof(buf), "\nimage:%d:%s", (int)d->romFormat,
+#if SYS_BYTEORDER == SYS_LIL_ENDIAN
+		"le16"
+#else /* SYS_BYTEORDER == SYS_BIG_ENDIAN */
+		"be16"
+#endif
+		);
+	key += buf;
+
+	// NOTE: Odd-sized ROMs are padded with 0 before byteswapping.
+	const size_t img_size = ((d->romSize + 1) & ~1);
+	void *ptr = nullptr;
+	size_t ptr_size = 0;
+	uint32_t crc = 0;
+	int ret = romCache->mapImage(key, siz, &ptr, &ptr_size, &crc);
+	if (ret == -ENOENT) {
+		// Image isn't cached yet. Decode the ROM and store it.
+		uint8_t *img = (uint8_t*)malloc(img_size);
+		if (!img)
+			return nullptr;
+		if (loadRom(img, img_size) != (int)d->romSize) {
+			free(img);
+			return nullptr;
+		}
+		if (img_size > d->romSize) {
+			img[d->romSize] = 0;
+		}
+		be16_to_cpu_array((uint16_t*)img, img_size);
+		ret = romCache->storeImage(key, img, img_size, d->rom_crc32);
+		free(img);
+		if (ret == 0) {
+			ret = romCache->mapImage(key, siz, &ptr, &ptr_size, &crc);
+		}
+	}
+	if (ret != 0)
+		return nullptr;
+	if (ptr_size != img_size) {
+		// Image doesn't match the ROM.
+		RomCache::unmapImage(ptr, siz);
+		return nullptr;
+	}
+
+	d->rom_crc32 = crc;
+
+	// The raw ROM data isn't needed.
+	free(d->rawData);
+	d->rawData = nullptr;
+	d->rawData_size = 0;
+	return ptr;
+}
+
+/**
+ * Free a ROM image mapped with mapRom() or mapRomHostOrder().
+ * @param ptr	[in] ROM image.
+ * @param siz	[in] Size of the mapping.
+ */
+void Rom::unmapRom(void *ptr, size_t siz)
+{
+	MemMapped::unmapCopyOnWrite(ptr, siz);
+}
+
 /**
  * Property accessors.
  */
@@ -1067,4 +1445,92 @@ int Rom::select_z_entry(const mdp_z_entry_t *sel)
 bool Rom::isRomSelected(void) const
 	{ return (d->z_entry_sel != nullptr); }
 
+/** ROM cache. **/
+
+/**
+ * Get the ROM cache.
+ * @return ROM cache, or nullptr if the ROM cache is disabled.
+ */
+RomCache *Rom::GetRomCache(void)
+{
+	return RomPrivate::ms_romCache;
+}
+
+/**
+ * Set the ROM cache.
+ * Compressed ROMs are stored in the cache after they're
+ * decompressed and deinterleaved, so reopening them is faster.
+ * NOTE: The ROM cache is NOT owned by Rom.
+ * @param romCache ROM cache, or nullptr to disable the ROM cache.
+ */
+void Rom::SetRomCache(RomCache *romCache)
+{
+	RomPrivate::ms_romCache = romCache;
+}
+
+/**
+ * Store all compressed ROMs in a directory in the ROM cache.
+ * ROMs that are already cached are marked as recently used.
+ * Subdirectories are not scanned.
+ * @param dir Directory.
+ * @return Number of ROMs stored in or found in the ROM cache, or negative POSIX error code on error.
+ */
+int Rom::PrewarmRomCache(const char *dir)
+{
+	if (!RomPrivate::ms_romCache)
+		return -EINVAL;
+
+	vector<string> files;
+	int ret = RomCache::listFiles(dir, &files);
+	if (ret != 0)
+		return ret;
+
+	int count = 0;
+	vector<uint8_t> buf;
+	for (vector<string>::const_iterator iter = files.begin();
+	     iter != files.end(); ++iter)
+	{
+		// Multi-file archives need a separate Rom object
+		// for each file, since a file can only be selected once.
+		for (int idx = 0; ; idx++) {
+			Rom rom(iter->c_str());
+			if (!rom.isOpen())
+				break;
+
+			if (rom.isMultiFile()) {
+				const mdp_z_entry_t *z_entry = rom.get_z_entry_list();
+				for (int i = 0; i < idx && z_entry; i++) {
+					z_entry = z_entry->next;
+				}
+				if (!z_entry)
+					break;
+				rom.select_z_entry(z_entry);
+			} else if (idx > 0) {
+				break;
+			}
+
+			if (rom.d->cacheEntry) {
+				// Already cached.
+				count++;
+			} else if (!rom.d->cacheKey.empty() &&
+				   rom.romSize() > 0 && rom.d->romSize <= RomPrivate::RAW_DATA_MAX &&
+				   (rom.romFormat() == RFMT_BINARY ||
+				    rom.romFormat() == RFMT_SMD ||
+				    rom.romFormat() == RFMT_SMD_SPLIT))
+			{
+				// Load the ROM. This stores it in the cache.
+				buf.resize(rom.romSize());
+				if (rom.loadRom(&buf[0], buf.size()) == rom.romSize()) {
+					count++;
+				}
+			}
+
+			if (!rom.isMultiFile())
+				break;
+		}
+	}
+
+	return count;
+}
+
 }
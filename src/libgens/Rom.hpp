@@ -34,6 +34,10 @@
 // TODO: Move to MDP headers.
 #include "libgensfile/Archive.hpp"
 
+namespace LibGensFile {
+	class RomCache;
+}
+
 namespace LibGens {
 
 class RomPrivate;
@@ -128,6 +132,38 @@ class Rom
 		 */
 		int loadRom(void *buf, size_t siz);
 
+		/**
+		 * Map the ROM image into memory. (copy-on-write)
+		 * This is only supported for uncompressed binary ROMs
+		 * that aren't writable, since truncating the file while
+		 * it's mapped would crash the emulator with SIGBUS.
+		 * Pages are shared with other processes using the same
+		 * ROM image until they're written to.
+		 * NOTE: The ROM image is NOT byteswapped.
+		 * @param siz	[in] Size of the mapping. (Must be >= romSize(); the rest is zero-filled.)
+		 * @return ROM image, or nullptr if the ROM can't be mapped. Free it with unmapRom().
+		 */
+		void *mapRom(size_t siz);
+
+		/**
+		 * Map the ROM image into memory in host 16-bit word order. (copy-on-write)
+		 * The decoded, byteswapped image is stored in the ROM cache
+		 * the first time the ROM is loaded, and mapped from there, so
+		 * all emulator instances share one physical copy of the ROM
+		 * until they write to it.
+		 * This requires the ROM cache.
+		 * @param siz	[in] Size of the mapping. (Must be >= romSize(); the rest is zero-filled.)
+		 * @return ROM image, or nullptr if the ROM can't be mapped. Free it with unmapRom().
+		 */
+		void *mapRomHostOrder(size_t siz);
+
+		/**
+		 * Free a ROM image mapped with mapRom() or mapRomHostOrder().
+		 * @param ptr	[in] ROM image.
+		 * @param siz	[in] Size of the mapping.
+		 */
+		static void unmapRom(void *ptr, size_t siz);
+
 		/**
 		 * Get the ROM filename.
 		 * @return ROM filename (UTF-8), or empty string on error.
@@ -249,6 +285,32 @@ class Rom
 		 * @return True if a ROM has been selected.
 		 */
 		bool isRomSelected(void) const;
+
+		/** ROM cache. **/
+
+		/**
+		 * Get the ROM cache.
+		 * @return ROM cache, or nullptr if the ROM cache is disabled.
+		 */
+		static LibGensFile::RomCache *GetRomCache(void);
+
+		/**
+		 * Set the ROM cache.
+		 * Compressed ROMs are stored in the cache after they're
+		 * decompressed and deinterleaved, so reopening them is faster.
+		 * NOTE: The ROM cache is NOT owned by Rom.
+		 * @param romCache ROM cache, or nullptr to disable the ROM cache.
+		 */
+		static void SetRomCache(LibGensFile::RomCache *romCache);
+
+		/**
+		 * Store all compressed ROMs in a directory in the ROM cache.
+		 * ROMs that are already cached are marked as recently used.
+		 * Subdirectories are not scanned.
+		 * @param dir Directory.
+		 * @return Number of ROMs stored in or found in the ROM cache, or negative POSIX error code on error.
+		 */
+		static int PrewarmRomCache(const char *dir);
 };
 
 }
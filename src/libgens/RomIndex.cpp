@@ -0,0 +1,622 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * RomIndex.cpp: ROM library index.                                        *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "RomIndex.hpp"
+#include "Rom.hpp"
+#include "libgensfile/RomCache.hpp"
+using LibGensFile::RomCache;
+
+// C includes.
+#include <sys/types.h>
+#include <sys/stat.h>
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <atomic>
+#include <map>
+#include <thread>
+using std::map;
+using std::string;
+using std::vector;
+
+#ifdef _WIN32
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+#include "libcompat/W32U/W32U_mini.h"
+#define DIR_SEP_CHR '\\'
+#else /* !_WIN32 */
+#define DIR_SEP_CHR '/'
+#endif /* _WIN32 */
+
+// Byteswapping macros.
+#include "libcompat/byteswap.h"
+
+namespace LibGens {
+
+class RomIndexPrivate
+{
+	public:
+		RomIndexPrivate() { }
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		RomIndexPrivate(const RomIndexPrivate &);
+		RomIndexPrivate &operator=(const RomIndexPrivate &);
+
+	public:
+		vector<RomIndex::Entry> entries;
+
+		// Index file magic number.
+		static const char INDEX_MAGIC[8];
+
+		// Maximum directory depth.
+		// Prevents infinite recursion with symlink loops.
+		static const int MAX_DEPTH = 32;
+
+		// Maximum ROM size for CRC32 calculation.
+		static const uint32_t MAX_CRC_SIZE = 32*1024*1024;
+
+		// Minimum size of an index entry in the index file.
+		// 44 bytes of fixed-size fields, plus five strings
+		// with a 16-bit length each.
+		static const size_t MIN_ENTRY_SIZE = 44 + (5 * 2);
+
+		/**
+		 * Check if a file is in a directory tree.
+		 * @param filename	[in] Filename, as returned by findFiles().
+		 * @param dir		[in] Directory.
+		 * @return True if the file is in the directory tree.
+		 */
+		static bool isInDir(const string &filename, const string &dir);
+
+		/**
+		 * File found while scanning a directory tree.
+		 */
+		struct ScanFile {
+			string filename;
+			int64_t mtime;
+			int64_t fileSize;
+		};
+
+		/**
+		 * Find all regular files in a directory tree.
+		 * @param dir	[in] Directory.
+		 * @param files	[out] Files.
+		 * @param depth	[in] Current directory depth.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int findFiles(const string &dir, vector<ScanFile> *files, int depth);
+
+		/**
+		 * Scan a ROM file.
+		 * Multi-file archives get one entry per file.
+		 * @param file	[in] File to scan.
+		 * @param out	[out] Index entries.
+		 * @param buf	[in/out] Scratch buffer for loading ROMs.
+		 */
+		static void scanFile(const ScanFile &file, vector<RomIndex::Entry> *out, vector<uint8_t> *buf);
+
+		/** Index file serialization. **/
+
+		static void putU16(vector<uint8_t> &buf, uint16_t val);
+		static void putU32(vector<uint8_t> &buf, uint32_t val);
+		static void putU64(vector<uint8_t> &buf, uint64_t val);
+		static void putString(vector<uint8_t> &buf, const string &str);
+
+		/**
+		 * Index file reader.
+		 * All reads are bounds-checked; if any read
+		 * goes past the end of the buffer, ok is cleared.
+		 */
+		struct Reader {
+			const uint8_t *p;
+			const uint8_t *end;
+			bool ok;
+
+			Reader(const uint8_t *p, size_t size)
+				: p(p), end(p + size), ok(true) { }
+
+			inline bool check(size_t len)
+			{
+				if (!ok || (size_t)(end - p) < len)
+					ok = false;
+				return ok;
+			}
+
+			uint8_t u8(void);
+			uint16_t u16(void);
+			uint32_t u32(void);
+			uint64_t u64(void);
+			string str(void);
+		};
+};
+
+const char RomIndexPrivate::INDEX_MAGIC[8] = {'G','E','N','S','I','D','X','1'};
+
+/**
+ * Find all regular files in a directory tree.
+ * @param dir	[in] Directory.
+ * @param files	[out] Files.
+ * @param depth	[in] Current directory depth.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomIndexPrivate::findFiles(const string &dir, vector<ScanFile> *files, int depth)
+{
+	vector<string> filenames, subdirs;
+	int ret = RomCache::listFiles(dir.c_str(), &filenames, &subdirs);
+	if (ret != 0)
+		return ret;
+
+	for (vector<string>::const_iterator iter = filenames.begin();
+	     iter != filenames.end(); ++iter)
+	{
+		struct stat st;
+		if (stat(iter->c_str(), &st) != 0)
+			continue;
+		ScanFile file = {*iter, (int64_t)st.st_mtime, (int64_t)st.st_size};
+		files->push_back(file);
+	}
+
+	if (depth >= MAX_DEPTH)
+		return 0;
+	for (vector<string>::const_iterator iter = subdirs.begin();
+	     iter != subdirs.end(); ++iter)
+	{
+		// Errors in subdirectories are ignored.
+		findFiles(*iter, files, depth + 1);
+	}
+	return 0;
+}
+
+/**
+ * Check if a file is in a directory tree.
+ * @param filename	[in] Filename, as returned by findFiles().
+ * @param dir		[in] Directory.
+ * @return True if the file is in the directory tree.
+ */
+bool RomIndexPrivate::isInDir(const string &filename, const string &dir)
+{
+	// RomCache::listFiles() appends a separator
+	// to the directory name if it doesn't have one,
+	// so "roms" doesn't match "roms2/foo.bin".
+	string prefix(dir);
+	if (prefix.empty() || prefix[prefix.size()-1] != DIR_SEP_CHR) {
+		prefix += DIR_SEP_CHR;
+	}
+	return (filename.size() > prefix.size() &&
+		filename.compare(0, prefix.size(), prefix) == 0);
+}
+
+/**
+ * Scan a ROM file.
+ * Multi-file archives get one entry per file.
+ * @param file	[in] File to scan.
+ * @param out	[out] Index entries.
+ * @param buf	[in/out] Scratch buffer for loading ROMs.
+ */
+void RomIndexPrivate::scanFile(const ScanFile &file, vector<RomIndex::Entry> *out, vector<uint8_t> *buf)
+{
+	RomIndex::Entry entry;
+	entry.filename = file.filename;
+	entry.mtime = file.mtime;
+	entry.fileSize = file.fileSize;
+
+	// Multi-file archives need a separate Rom object
+	// for each file, since a file can only be selected once.
+	for (int idx = 0; ; idx++) {
+		Rom rom(file.filename.c_str());
+		if (!rom.isOpen())
+			break;
+
+		if (rom.isMultiFile()) {
+			const mdp_z_entry_t *z_entry = rom.get_z_entry_list();
+			for (int i = 0; i < idx && z_entry; i++) {
+				z_entry = z_entry->next;
+			}
+			if (!z_entry)
+				break;
+			rom.select_z_entry(z_entry);
+		} else if (idx > 0) {
+			break;
+		}
+
+		entry.z_filename = rom.z_filename();
+		entry.sysId = (uint8_t)rom.sysId();
+		entry.romFormat = (uint8_t)rom.romFormat();
+		entry.checksum = rom.checksum();
+		entry.regionCode = rom.regionCode();
+		entry.romSize = (uint32_t)(rom.romSize() > 0 ? rom.romSize() : 0);
+		entry.romNameJP = rom.romNameJP();
+		entry.romNameUS = rom.romNameUS();
+		entry.serial = rom.rom_serial();
+		rom.romSramInfo(&entry.sramInfo, &entry.sramStartAddr, &entry.sramEndAddr);
+
+		// Load the ROM to get the CRC32.
+		entry.crc32 = 0;
+		if (entry.sysId != Rom::MDP_SYSTEM_UNKNOWN &&
+		    entry.romSize > 0 && entry.romSize <= MAX_CRC_SIZE &&
+		    (rom.romFormat() == Rom::RFMT_BINARY ||
+		     rom.romFormat() == Rom::RFMT_SMD ||
+		     rom.romFormat() == Rom::RFMT_SMD_SPLIT))
+		{
+			buf->resize(entry.romSize);
+			if (rom.loadRom(&(*buf)[0], buf->size()) == rom.romSize()) {
+				entry.crc32 = rom.rom_crc32();
+			}
+		}
+
+		out->push_back(entry);
+		if (!rom.isMultiFile())
+			break;
+	}
+
+	if (out->empty()) {
+		// The file couldn't be opened. Add a placeholder entry so it
+		// isn't rescanned unless it's modified.
+		entry.sysId = Rom::MDP_SYSTEM_UNKNOWN;
+		entry.romFormat = Rom::RFMT_UNKNOWN;
+		entry.checksum = 0;
+		entry.regionCode = 0;
+		entry.romSize = 0;
+		entry.crc32 = 0;
+		entry.sramInfo = 0;
+		entry.sramStartAddr = 0;
+		entry.sramEndAddr = 0;
+		out->push_back(entry);
+	}
+}
+
+/** Index file serialization. **/
+
+void RomIndexPrivate::putU16(vector<uint8_t> &buf, uint16_t val)
+{
+	const uint16_t le = cpu_to_le16(val);
+	const uint8_t *p = (const uint8_t*)&le;
+	buf.insert(buf.end(), p, p + sizeof(le));
+}
+
+void RomIndexPrivate::putU32(vector<uint8_t> &buf, uint32_t val)
+{
+	const uint32_t le = cpu_to_le32(val);
+	const uint8_t *p = (const uint8_t*)&le;
+	buf.insert(buf.end(), p, p + sizeof(le));
+}
+
+void RomIndexPrivate::putU64(vector<uint8_t> &buf, uint64_t val)
+{
+	putU32(buf, (uint32_t)val);
+	putU32(buf, (uint32_t)(val >> 32));
+}
+
+void RomIndexPrivate::putString(vector<uint8_t> &buf, const string &str)
+{
+	const uint16_t len = (uint16_t)(str.size() > 0xFFFF ? 0xFFFF : str.size());
+	putU16(buf, len);
+	buf.insert(buf.end(), str.begin(), str.begin() + len);
+}
+
+uint8_t RomIndexPrivate::Reader::u8(void)
+{
+	if (!check(1))
+		return 0;
+	return *p++;
+}
+
+uint16_t RomIndexPrivate::Reader::u16(void)
+{
+	if (!check(2))
+		return 0;
+	const uint16_t val = (uint16_t)(p[0] | (p[1] << 8));
+	p += 2;
+	return val;
+}
+
+uint32_t RomIndexPrivate::Reader::u32(void)
+{
+	if (!check(4))
+		return 0;
+	const uint32_t val = (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+	p += 4;
+	return val;
+}
+
+uint64_t RomIndexPrivate::Reader::u64(void)
+{
+	const uint64_t lo = u32();
+	const uint64_t hi = u32();
+	return (lo | (hi << 32));
+}
+
+string RomIndexPrivate::Reader::str(void)
+{
+	const uint16_t len = u16();
+	if (!check(len))
+		return string();
+	string ret((const char*)p, len);
+	p += len;
+	return ret;
+}
+
+/** RomIndex **/
+
+RomIndex::RomIndex()
+	: d(new RomIndexPrivate())
+{ }
+
+RomIndex::~RomIndex()
+{
+	delete d;
+}
+
+/**
+ * Get the index entries.
+ * @return Index entries.
+ */
+const vector<RomIndex::Entry> &RomIndex::entries(void) const
+{
+	return d->entries;
+}
+
+/**
+ * Clear the index.
+ */
+void RomIndex::clear(void)
+{
+	d->entries.clear();
+}
+
+/**
+ * Load an index file.
+ * @param filename Index filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomIndex::load(const char *filename)
+{
+	FILE *f = fopen(filename, "rb");
+	if (!f)
+		return -errno;
+
+	// Read the entire file.
+	vector<uint8_t> buf;
+	uint8_t block[65536];
+	size_t size;
+	while ((size = fread(block, 1, sizeof(block), f)) > 0) {
+		buf.insert(buf.end(), block, block + size);
+	}
+	fclose(f);
+
+	if (buf.size() < 16 || memcmp(&buf[0], RomIndexPrivate::INDEX_MAGIC,
+				       sizeof(RomIndexPrivate::INDEX_MAGIC)) != 0)
+	{
+		// Not a ROM index file.
+		return -EIO;
+	}
+
+	RomIndexPrivate::Reader reader(&buf[8], buf.size() - 8);
+	const uint32_t count = reader.u32();
+	reader.u32();	// reserved
+
+	// Make sure the entry count is sane before
+	// allocating memory for the entries.
+	if (!reader.ok || count > (size_t)(reader.end - reader.p) / RomIndexPrivate::MIN_ENTRY_SIZE) {
+		// Index file is truncated or corrupted.
+		return -EIO;
+	}
+
+	vector<Entry> entries;
+	entries.reserve(count);
+	for (uint32_t i = 0; i < count && reader.ok; i++) {
+		Entry entry;
+		entry.mtime = (int64_t)reader.u64();
+		entry.fileSize = (int64_t)reader.u64();
+		entry.sysId = reader.u8();
+		entry.romFormat = reader.u8();
+		entry.checksum = reader.u16();
+		entry.regionCode = (int)reader.u32();
+		entry.romSize = reader.u32();
+		entry.crc32 = reader.u32();
+		entry.sramInfo = reader.u32();
+		entry.sramStartAddr = reader.u32();
+		entry.sramEndAddr = reader.u32();
+		entry.filename = reader.str();
+		entry.z_filename = reader.str();
+		entry.romNameJP = reader.str();
+		entry.romNameUS = reader.str();
+		entry.serial = reader.str();
+		entries.push_back(entry);
+	}
+
+	if (!reader.ok) {
+		// Index file is truncated.
+		return -EIO;
+	}
+
+	d->entries.swap(entries);
+	return 0;
+}
+
+/**
+ * Save the index to a file.
+ * @param filename Index filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomIndex::save(const char *filename) const
+{
+	vector<uint8_t> buf;
+	buf.reserve(16 + (d->entries.size() * 128));
+	buf.insert(buf.end(), RomIndexPrivate::INDEX_MAGIC,
+		   RomIndexPrivate::INDEX_MAGIC + sizeof(RomIndexPrivate::INDEX_MAGIC));
+	RomIndexPrivate::putU32(buf, (uint32_t)d->entries.size());
+	RomIndexPrivate::putU32(buf, 0);	// reserved
+
+	for (vector<Entry>::const_iterator iter = d->entries.begin();
+	     iter != d->entries.end(); ++iter)
+	{
+		const Entry &entry = *iter;
+		RomIndexPrivate::putU64(buf, (uint64_t)entry.mtime);
+		RomIndexPrivate::putU64(buf, (uint64_t)entry.fileSize);
+		buf.push_back(entry.sysId);
+		buf.push_back(entry.romFormat);
+		RomIndexPrivate::putU16(buf, entry.checksum);
+		RomIndexPrivate::putU32(buf, (uint32_t)entry.regionCode);
+		RomIndexPrivate::putU32(buf, entry.romSize);
+		RomIndexPrivate::putU32(buf, entry.crc32);
+		RomIndexPrivate::putU32(buf, entry.sramInfo);
+		RomIndexPrivate::putU32(buf, entry.sramStartAddr);
+		RomIndexPrivate::putU32(buf, entry.sramEndAddr);
+		RomIndexPrivate::putString(buf, entry.filename);
+		RomIndexPrivate::putString(buf, entry.z_filename);
+		RomIndexPrivate::putString(buf, entry.romNameJP);
+		RomIndexPrivate::putString(buf, entry.romNameUS);
+		RomIndexPrivate::putString(buf, entry.serial);
+	}
+
+	// Write to a temporary file first, then rename it,
+	// so an interrupted write doesn't corrupt the index.
+	const string tmpFilename = string(filename) + ".tmp";
+	FILE *f = fopen(tmpFilename.c_str(), "wb");
+	if (!f)
+		return -errno;
+
+	int ret = 0;
+	if (fwrite(&buf[0], 1, buf.size(), f) != buf.size()) {
+		ret = (errno != 0 ? -errno : -EIO);
+	}
+	if (fclose(f) != 0 && ret == 0) {
+		ret = (errno != 0 ? -errno : -EIO);
+	}
+	if (ret != 0) {
+		remove(tmpFilename.c_str());
+		return ret;
+	}
+
+#ifdef _WIN32
+	// rename() fails on Windows if the destination exists.
+	remove(filename);
+#endif /* _WIN32 */
+	if (rename(tmpFilename.c_str(), filename) != 0) {
+		ret = -errno;
+		remove(tmpFilename.c_str());
+		return ret;
+	}
+	return 0;
+}
+
+/**
+ * Scan a directory tree for ROMs.
+ * Files whose size and modification time match the
+ * existing index entries aren't rescanned.
+ * Entries for files that weren't found are removed.
+ * NOTE: If a ROM cache is set, scanned compressed ROMs
+ * will be stored in it.
+ * @param dir Directory.
+ * @param threads Number of threads to use. (0 for one per CPU)
+ * @return Number of files that were (re)scanned, or negative POSIX error code on error.
+ */
+int RomIndex::scan(const char *dir, int threads)
+{
+	if (!dir || dir[0] == 0)
+		return -EINVAL;
+
+	vector<RomIndexPrivate::ScanFile> files;
+	int ret = RomIndexPrivate::findFiles(dir, &files, 0);
+	if (ret != 0)
+		return ret;
+
+	// Index the existing entries by filename.
+	// Multi-file archives have consecutive entries.
+	map<string, size_t> oldEntries;
+	for (size_t i = d->entries.size(); i > 0; i--) {
+		oldEntries[d->entries[i-1].filename] = i-1;
+	}
+
+	// Reuse entries for files that haven't changed.
+	vector<vector<Entry> > results(files.size());
+	vector<size_t> toScan;
+	for (size_t i = 0; i < files.size(); i++) {
+		const RomIndexPrivate::ScanFile &file = files[i];
+		map<string, size_t>::const_iterator iter = oldEntries.find(file.filename);
+		if (iter != oldEntries.end()) {
+			const Entry *entry = &d->entries[iter->second];
+			if (entry->mtime == file.mtime && entry->fileSize == file.fileSize) {
+				const Entry *const end = &d->entries[0] + d->entries.size();
+				for (; entry != end && entry->filename == file.filename; entry++) {
+					results[i].push_back(*entry);
+				}
+				continue;
+			}
+		}
+		toScan.push_back(i);
+	}
+
+	// Scan the new and modified files.
+	// Each worker thread takes the next file from the list.
+	if (threads <= 0) {
+		threads = (int)std::thread::hardware_concurrency();
+		if (threads <= 0)
+			threads = 1;
+	}
+	if ((size_t)threads > toScan.size()) {
+		threads = (int)toScan.size();
+	}
+
+	std::atomic<size_t> next(0);
+	auto worker = [&]() {
+		vector<uint8_t> buf;
+		size_t n;
+		while ((n = next++) < toScan.size()) {
+			const size_t i = toScan[n];
+			RomIndexPrivate::scanFile(files[i], &results[i], &buf);
+		}
+	};
+
+	vector<std::thread> pool;
+	pool.reserve(threads > 1 ? threads - 1 : 0);
+	for (int i = 1; i < threads; i++) {
+		pool.push_back(std::thread(worker));
+	}
+	worker();
+	for (size_t i = 0; i < pool.size(); i++) {
+		pool[i].join();
+	}
+
+	// Rebuild the index.
+	// Entries from other directory trees are kept as-is,
+	// followed by this directory tree in directory order.
+	vector<Entry> entries;
+	entries.reserve(d->entries.size() + files.size());
+	for (size_t i = 0; i < d->entries.size(); i++) {
+		if (!RomIndexPrivate::isInDir(d->entries[i].filename, dir)) {
+			entries.push_back(d->entries[i]);
+		}
+	}
+	for (size_t i = 0; i < results.size(); i++) {
+		entries.insert(entries.end(), results[i].begin(), results[i].end());
+	}
+	d->entries.swap(entries);
+	return (int)toScan.size();
+}
+
+}
@@ -0,0 +1,124 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * RomIndex.hpp: ROM library index.                                        *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_ROMINDEX_HPP__
+#define __LIBGENS_ROMINDEX_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <string>
+#include <vector>
+
+namespace LibGens {
+
+class RomIndexPrivate;
+class RomIndex
+{
+	public:
+		RomIndex();
+		~RomIndex();
+
+	protected:
+		friend class RomIndexPrivate;
+		RomIndexPrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		RomIndex(const RomIndex &);
+		RomIndex &operator=(const RomIndex &);
+
+	public:
+		/**
+		 * ROM index entry.
+		 * Multi-file archives have one entry per file.
+		 * Files that couldn't be opened as ROMs have an
+		 * entry with sysId == Rom::MDP_SYSTEM_UNKNOWN,
+		 * so they aren't rescanned unless they're modified.
+		 */
+		struct Entry {
+			std::string filename;	// ROM filename.
+			std::string z_filename;	// Filename within the archive.
+			int64_t mtime;		// File modification time.
+			int64_t fileSize;	// File size.
+
+			uint8_t sysId;		// Rom::MDP_SYSTEM_ID
+			uint8_t romFormat;	// Rom::RomFormat
+			uint16_t checksum;	// ROM checksum. (from the header)
+			int regionCode;		// Region code. (MD hex format)
+			uint32_t romSize;	// ROM size.
+			uint32_t crc32;		// ROM CRC32. (0 if the ROM wasn't loaded)
+
+			std::string romNameJP;	// Domestic name. (UTF-8)
+			std::string romNameUS;	// Overseas name. (UTF-8)
+			std::string serial;	// Serial number.
+
+			// SRAM information. (from the header)
+			uint32_t sramInfo;
+			uint32_t sramStartAddr;
+			uint32_t sramEndAddr;
+		};
+
+		/**
+		 * Get the index entries.
+		 * @return Index entries.
+		 */
+		const std::vector<Entry> &entries(void) const;
+
+		/**
+		 * Clear the index.
+		 */
+		void clear(void);
+
+		/**
+		 * Load an index file.
+		 * @param filename Index filename.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int load(const char *filename);
+
+		/**
+		 * Save the index to a file.
+		 * @param filename Index filename.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int save(const char *filename) const;
+
+		/**
+		 * Scan a directory tree for ROMs.
+		 * Files whose size and modification time match the
+		 * existing index entries aren't rescanned.
+		 * Entries for files in this directory tree that
+		 * weren't found are removed. Entries for files
+		 * in other directory trees are kept.
+		 * NOTE: If a ROM cache is set, scanned compressed ROMs
+		 * will be stored in it.
+		 * @param dir Directory.
+		 * @param threads Number of threads to use. (0 for one per CPU)
+		 * @return Number of files that were (re)scanned, or negative POSIX error code on error.
+		 */
+		int scan(const char *dir, int threads = 0);
+};
+
+}
+
+#endif /* __LIBGENS_ROMINDEX_HPP__ */
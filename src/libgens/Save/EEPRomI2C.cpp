@@ -39,8 +39,7 @@ namespace LibGens {
 
 EEPRomI2CPrivate::EEPRomI2CPrivate(EEPRomI2C *q)
 	: q(q)
-	, dirty(false)
-	, framesElapsed(0)
+	, writer(sizeof(eeprom))
 {
 	// Clear the EEPRom chip specification.
 	memset(&eprChip, 0, sizeof(eprChip));
@@ -58,7 +57,7 @@ void EEPRomI2CPrivate::reset(void)
 	// EEProm is initialized with 0xFF.
 	memset(eeprom, 0xFF, sizeof(eeprom));
 	memset(page_cache, 0xFF, sizeof(page_cache));
-	clearDirty();
+	writer.discard();
 
 	// Reset the clock and data line states.
 	scl = 1;
@@ -127,14 +126,20 @@ void EEPRomI2CPrivate::stopWriteData(void)
 	const unsigned int pgAddress = address & ~eprChip.pg_mask;
 	const unsigned int pgSize = eprChip.pg_mask + 1;
 
+	bool changed = false;
 	for (unsigned int i = 0; i < pgSize; i++) {
 		const unsigned int byte_address = pgAddress | i;
 		if (page_cache[i] != eeprom[byte_address]) {
 			// Byte has changed.
 			eeprom[byte_address] = page_cache[i];
-			setDirty();
+			changed = true;
 		}
 	}
+
+	if (changed) {
+		// Mark the page as dirty.
+		writer.update(eeprom, pgAddress, pgSize);
+	}
 }
 
 /**
@@ -510,7 +515,7 @@ bool EEPRomI2C::isEEPRomTypeSet(void) const
  * @return True if EEPRom has been modified since the last save; false otherwise.
  */
 bool EEPRomI2C::isDirty(void) const
-	{ return d->isDirty(); }
+	{ return d->writer.isPending(); }
 
 /**
  * Read the specified port. (byte-wide)
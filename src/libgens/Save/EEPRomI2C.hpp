@@ -125,17 +125,27 @@ class EEPRomI2C
 
 		/**
 		 * Save the EEPRom file.
+		 * Only modified pages are written.
 		 * @return Positive value indicating EEPRom size on success; 0 if no save is needed; negative on error.
 		 */
 		int save(void);
 
 		/**
 		 * Autosave the EEPRom file.
-		 * This saves the EEPRom file if its last modification time is past a certain threshold.
-		 * @param framesElapsed Number of frames elapsed, or -1 for paused. (force autosave)
-		 * @return Positive value indicating SRam size on success; 0 if no save is needed; negative on error.
+		 * Modified pages are normally written by a background
+		 * thread shortly after they're modified. This writes
+		 * them immediately, e.g. when emulation is paused.
+		 * @return Positive value indicating EEPRom size on success; 0 if no save is needed; negative on error.
+		 */
+		int autoSave(void);
+
+		/**
+		 * Clear the EEPRom and detach it from the EEPRom file.
+		 * Nothing will be read from or written to the
+		 * EEPRom file until load() is called again.
+		 * This function does NOT reset the EEPRom type!
 		 */
-		int autoSave(int framesElapsed);
+		void unload(void);
 
 		/** ZOMG functions. **/
 		int zomgRestore(LibZomg::Zomg *zomg, bool loadSaveData);
@@ -122,6 +122,11 @@ int EEPRomI2C::load(void)
 	if (!isEEPRomTypeSet())
 		return -2;
 
+	// Modified pages will be written to this file.
+	// This also replays the journal if the last
+	// write was interrupted.
+	d->writer.setFilename(d->fullPathname);
+
 	// Attempt to open the EEPRom file.
 	FILE *f = fopen(d->fullPathname.c_str(), "rb");
 	if (!f) {
@@ -139,68 +144,48 @@ int EEPRomI2C::load(void)
 	fclose(f);
 
 	// Return the number of bytes read.
-	d->clearDirty();
 	return ret;
 }
 
 /**
  * Save the EEPRom file.
+ * Only modified pages are written.
  * @return Positive value indicating EEPRom size on success; 0 if no save is needed; negative on error.
  */
 int EEPRomI2C::save(void)
 {
 	if (!isEEPRomTypeSet())
 		return -2;
-	if (!d->isDirty())
-		return 0;
-
-	int size = d->getUsedSize();
-	if (size <= 0) {
-		// EEPRom is empty.
-		return 0;
-	}
-
-	FILE *f = fopen(d->fullPathname.c_str(), "wb");
-	if (!f) {
-		// Unable to open EEPRom file.
-		// TODO: Error code constants.
-		return -1;
-	}
-
-	// Save EEPRom to the file.
-	int ret = fwrite(d->eeprom, 1, size, f);
-	fclose(f);
-
-	// Return the number of bytes saved.
-	d->clearDirty();
-	return ret;
+	return d->writer.flush();
 }
 
 /**
  * Autosave the EEPRom file.
- * This saves the EEPRom file if its last modification time is past a certain threshold.
- * @param framesElapsed Number of frames elapsed, or -1 for paused.
+ * Modified pages are normally written by a background
+ * thread shortly after they're modified. This writes
+ * them immediately, e.g. when emulation is paused.
  * @return Positive value indicating EEPRom size on success; 0 if no save is needed; negative on error.
  */
-int EEPRomI2C::autoSave(int framesElapsed)
+int EEPRomI2C::autoSave(void)
 {
 	if (!isEEPRomTypeSet())
 		return -2;
-	if (!d->isDirty())
-		return 0;
-
-	// TODO: Customizable autosave threshold.
-	// TODO: PAL/NTSC detection.
-	if (d->framesElapsed >= 0) {
-		// Check if we've passed the autosave threshold.
-		bool isPal = false;
-		d->framesElapsed += framesElapsed;
-		if (d->framesElapsed < (d->AUTOSAVE_THRESHOLD_DEFAULT / (isPal ? 20 : 16)))
-			return 0;
-	}
+	// TODO: Customizable autosave delay.
+	return d->writer.flush();
+}
 
-	// Autosave threshold has passed.
-	return save();
+/**
+ * Clear the EEPRom and detach it from the EEPRom file.
+ * Nothing will be read from or written to the
+ * EEPRom file until load() is called again.
+ * This function does NOT reset the EEPRom type!
+ */
+void EEPRomI2C::unload(void)
+{
+	// NOTE: reset() discards pending pages,
+	// so they aren't flushed by setFilename().
+	d->reset();
+	d->writer.setFilename(string());
 }
 
 /**
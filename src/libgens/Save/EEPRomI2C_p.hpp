@@ -29,6 +29,7 @@
 #include <string>
 
 #include "EEPRomI2C.hpp"
+#include "SaveDataWriter.hpp"
 namespace LibGens {
 
 class EEPRomI2C;
@@ -111,25 +112,8 @@ class EEPRomI2CPrivate
 		};
 		EEPRomState_t state;
 
-	private:
-		// Dirty flag.
-		bool dirty;
-	public:
-		// TODO: Accessor/mutator function?
-		int framesElapsed;
-
-	public:
-		inline bool isDirty(void) const
-			{ return dirty; }
-		inline void setDirty(void)
-			{ dirty = true; framesElapsed = 0; }
-		inline void clearDirty(void)
-			{ dirty = false; framesElapsed = 0; }
-
-		/**
-		 * AUTOSAVE_THRESHOLD_DEFAULT: Default autosave threshold, in milliseconds.
-		 */
-		static const int AUTOSAVE_THRESHOLD_DEFAULT = 1000;
+		// Writes modified pages to the EEPRom file.
+		SaveDataWriter writer;
 
 		/**
 		 * Determine how many bytes are used in the SRam chip.
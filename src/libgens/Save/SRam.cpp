@@ -22,6 +22,7 @@
  ***************************************************************************/
 
 #include "SRam.hpp"
+#include "SaveDataWriter.hpp"
 #include "macros/common.h"
 #include "libgenstext/StringManip.hpp"
 
@@ -72,11 +73,9 @@ class SRamPrivate
 		std::string pathname;		// SRam pathname.
 		std::string fullPathname;	// Full pathname. (m_pathname + m_filename)
 
-		/**
-		 * Default autosave threshold, in milliseconds.
-		 */
-		static const int AUTOSAVE_THRESHOLD_DEFAULT = 1000;
-		
+		// Writes modified pages to the SRam file.
+		SaveDataWriter writer;
+
 		/**
 		 * Determine how many bytes are used in the SRam chip.
 		 * @return Number of bytes used, rounded to the highest power of two.
@@ -101,6 +100,7 @@ const char SRamPrivate::fileExt[] = "srm";
 
 SRamPrivate::SRamPrivate(SRam *q)
 	: q(q)
+	, writer(sizeof(q->m_sram))
 { }
 
 /**
@@ -156,7 +156,7 @@ void SRam::reset(void)
 	memset(m_sram, 0xFF, sizeof(m_sram));
 	m_on = false;
 	m_write = false;
-	clearDirty();
+	d->writer.discard();
 }
 
 /** Memory read/write. **/
@@ -199,8 +199,8 @@ void SRam::writeByte(uint32_t address, uint8_t data)
 	address -= m_start;
 	if (m_sram[address] != data) {
 		m_sram[address] = data;
-		// Set the dirty flag.
-		setDirty();
+		// Mark the page as dirty.
+		d->writer.update(m_sram, address, 1);
 	}
 }
 
@@ -219,11 +219,20 @@ void SRam::writeWord(uint32_t address, uint16_t data)
 	if (m_sram[address] != hi || m_sram[address+1] != lo) {
 		m_sram[address] = hi;
 		m_sram[address+1] = lo;
-		// Set the dirty flag.
-		setDirty();
+		// Mark the page as dirty.
+		d->writer.update(m_sram, address, 2);
 	}
 }
 
+/**
+ * Check if the SRam is dirty.
+ * @return True if SRam has been modified since the last save; false otherwise.
+ */
+bool SRam::isDirty(void) const
+{
+	return d->writer.isPending();
+}
+
 /**
  * Set the SRam filename based on a ROM filename.
  * The file extension is changed to ".srm".
@@ -276,6 +285,11 @@ void SRam::setPathname(const string& pathname)
  */
 int SRam::load(void)
 {
+	// Modified pages will be written to this file.
+	// This also replays the journal if the last
+	// write was interrupted.
+	d->writer.setFilename(d->fullPathname);
+
 	// Attempt to open the SRam file.
 	FILE *f = fopen(d->fullPathname.c_str(), "rb");
 	if (!f) {
@@ -293,64 +307,45 @@ int SRam::load(void)
 	fclose(f);
 
 	// Return the number of bytes read.
-	clearDirty();
 	return ret;
 }
 
 /**
  * Save the SRam file.
+ * Only modified pages are written.
  * @return Positive value indicating SRam size on success; 0 if no save is needed; negative on error.
  */
 int SRam::save(void)
 {
-	if (!m_dirty)
-		return 0;
-
-	int size = d->getUsedSize();
-	if (size <= 0) {
-		// SRam is empty.
-		return 0;
-	}
-
-	FILE *f = fopen(d->fullPathname.c_str(), "wb");
-	if (!f) {
-		// Unable to open SRam file.
-		// TODO: Error code constants.
-		return -1;
-	}
-
-	// Save SRam to the file.
-	int ret = fwrite(m_sram, 1, size, f);
-	fclose(f);
-
-	// Return the number of bytes saved.
-	clearDirty();
-	return ret;
+	return d->writer.flush();
 }
 
 /**
  * Autosave the SRam file.
- * This saves the SRam file if its last modification time is past a certain threshold.
- * @param framesElapsed Number of frames elapsed, or -1 for paused. (force autosave)
+ * Modified pages are normally written by a background
+ * thread shortly after they're modified. This writes
+ * them immediately, e.g. when emulation is paused.
  * @return Positive value indicating SRam size on success; 0 if no save is needed; negative on error.
  */
-int SRam::autoSave(int framesElapsed)
+int SRam::autoSave(void)
 {
-	if (!m_dirty)
-		return 0;
-
-	// TODO: Customizable autosave threshold.
-	// TODO: PAL/NTSC detection.
-	if (framesElapsed >= 0) {
-		// Check if we've passed the autosave threshold.
-		bool isPal = false;
-		m_framesElapsed += framesElapsed;
-		if (m_framesElapsed < (d->AUTOSAVE_THRESHOLD_DEFAULT / (isPal ? 20 : 16)))
-			return 0;
-	}
+	// TODO: Customizable autosave delay.
+	return d->writer.flush();
+}
 
-	// Autosave threshold has passed.
-	return save();
+/**
+ * Clear SRam and detach it from the SRam file.
+ * Nothing will be read from or written to the
+ * SRam file until load() is called again.
+ * This does NOT reset the control logic.
+ */
+void SRam::unload(void)
+{
+	// Discard pending pages first so they
+	// aren't flushed by setFilename().
+	d->writer.discard();
+	d->writer.setFilename(string());
+	memset(m_sram, 0xFF, sizeof(m_sram));
 }
 
 /**
@@ -364,7 +359,7 @@ int SRam::zomgRestore(LibZomg::Zomg *zomg)
 	int ret = zomg->loadSRam(m_sram, sizeof(m_sram));
 	if (ret > 0) {
 		// SRam loaded.
-		setDirty();
+		d->writer.updateAll(m_sram, d->getUsedSize());
 		return 0;
 	}
 
@@ -92,7 +92,7 @@ class SRam
 		 * Check if the SRam is dirty.
 		 * @return True if SRam has been modified since the last save; false otherwise.
 		 */
-		inline bool isDirty(void) const;
+		bool isDirty(void) const;
 
 		// SRam filename and pathname.
 		void setFilename(const std::string &filename);
@@ -106,27 +106,32 @@ class SRam
 
 		/**
 		 * Save the SRam file.
+		 * Only modified pages are written.
 		 * @return Positive value indicating SRam size on success; 0 if no save is needed; negative on error.
 		 */
 		int save(void);
-		
+
 		/**
 		 * Autosave the SRam file.
-		 * This saves the SRam file if its last modification time is past a certain threshold.
-		 * @param framesElapsed Number of frames elapsed, or -1 for paused. (force autosave)
+		 * Modified pages are normally written by a background
+		 * thread shortly after they're modified. This writes
+		 * them immediately, e.g. when emulation is paused.
 		 * @return Positive value indicating SRam size on success; 0 if no save is needed; negative on error.
 		 */
-		int autoSave(int framesElapsed);
-		
+		int autoSave(void);
+
+		/**
+		 * Clear SRam and detach it from the SRam file.
+		 * Nothing will be read from or written to the
+		 * SRam file until load() is called again.
+		 * This does NOT reset the control logic.
+		 */
+		void unload(void);
+
 		/** ZOMG functions. **/
 		int zomgRestore(LibZomg::Zomg *zomg);
 		int zomgSave(LibZomg::Zomg *zomg) const;
 
-	protected:
-		// Dirty flag.
-		void setDirty(void);
-		void clearDirty(void);
-
 	private:
 		// SRam data.
 		uint8_t m_sram[64*1024];
@@ -136,10 +141,6 @@ class SRam
 
 		uint32_t m_start;	// SRam starting address.
 		uint32_t m_end;		// SRam ending address.
-
-		// Dirty flag.
-		bool m_dirty;
-		int m_framesElapsed;
 };
 
 /** Settings. **/
@@ -226,27 +227,6 @@ inline uint8_t SRam::zomgReadCtrl(void) const
 inline bool SRam::isAddressInRange(uint32_t address) const
 	{ return (address >= m_start && address <= m_end); }
 
-/**
- * Check if the SRam is dirty.
- * @return True if SRam has been modified since the last save; false otherwise.
- */
-inline bool SRam::isDirty(void) const
-	{ return m_dirty; }
-
-/** Inline protected functions. **/
-
-inline void SRam::setDirty(void)
-{
-	m_dirty = true;
-	m_framesElapsed = 0;
-}
-
-inline void SRam::clearDirty(void)
-{
-	m_dirty = false;
-	m_framesElapsed = 0;
-}
-
 }
 
 #endif /* __LIBGENS_SAVE_SRAM_HPP__ */
@@ -0,0 +1,782 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * SaveDataWriter.cpp: Incremental SRam/EEPRom file writer.                *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "SaveDataWriter.hpp"
+
+// C includes.
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::string;
+using std::vector;
+
+// zlib is used for the journal checksum.
+#include <zlib.h>
+
+#ifdef _WIN32
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+#include "libcompat/W32U/W32U_mini.h"
+#endif /* _WIN32 */
+
+// Byteswapping macros.
+#include "libcompat/byteswap.h"
+
+namespace LibGens {
+
+class SaveDataWriterPrivate
+{
+	public:
+		explicit SaveDataWriterPrivate(unsigned int size);
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		SaveDataWriterPrivate(const SaveDataWriterPrivate &);
+		SaveDataWriterPrivate &operator=(const SaveDataWriterPrivate &);
+
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		// Save data size.
+		const unsigned int size;
+		const unsigned int numPages;
+
+		// Pending pages. Protected by mtx.
+		mutable std::mutex mtx;
+		std::condition_variable cond;	// Pages are pending, or quit.
+		std::condition_variable idle;	// Pending pages were written.
+		vector<uint8_t> pendBuf;
+		vector<bool> pendPages;
+		bool pending;		// Pages are pending.
+		bool busy;		// Worker thread is writing pages.
+		bool flushRequested;	// Don't wait for the autosave delay.
+		bool quit;
+		clock::time_point deadline;
+		int autoSaveDelay;	// Autosave delay, in milliseconds.
+		int lastError;
+
+		// Save file.
+		string filename;
+		unsigned int filePages;	// Number of pages in the save file.
+
+		// Pages being written by the worker thread.
+		// Only accessed by the worker thread.
+		vector<uint8_t> writeBuf;
+		vector<bool> writePages;
+
+		// Worker thread.
+		// Started when the first page is modified.
+		std::thread thread;
+
+		/**
+		 * Worker thread function.
+		 */
+		void run(void);
+
+		/**
+		 * Get the save file size.
+		 * The mutex must be held by the caller.
+		 * @return Save file size, in bytes.
+		 */
+		inline unsigned int fileSize(void) const
+		{
+			unsigned int bytes = filePages * SaveDataWriter::PAGE_SIZE;
+			return (bytes > size ? size : bytes);
+		}
+
+		/**
+		 * Copy a page into the pending buffer.
+		 * The mutex must be held by the caller.
+		 * @param data Save data buffer.
+		 * @param page Page number.
+		 */
+		void copyPage(const uint8_t *data, unsigned int page);
+
+		/**
+		 * Extend the save file to include the specified pages.
+		 * The save file size is rounded up to a power of two,
+		 * and any new pages are copied into the pending buffer.
+		 * The mutex must be held by the caller.
+		 * @param data Save data buffer.
+		 * @param endPage One past the last page that must be in the file.
+		 */
+		void extendFile(const uint8_t *data, unsigned int endPage);
+
+		/**
+		 * Start the autosave delay if it isn't running.
+		 * The mutex must be held by the caller.
+		 */
+		void arm(void);
+
+		/** Journal functions. **/
+
+		// Journal format: (all values are little-endian)
+		// - char magic[8]: "GENSJNL1"
+		// - uint32_t count: Number of pages.
+		// - Pages: uint32_t offset, uint32_t length, uint8_t data[length]
+		// - uint32_t crc32: CRC32 of everything above.
+		static const char JournalMagic[8];
+		static const char JournalExt[];
+
+		// Page in a journal.
+		struct JournalPage {
+			uint32_t offset;
+			uint32_t length;
+			const uint8_t *data;
+		};
+
+		/**
+		 * Parse a journal.
+		 * @param jnl	[in] Journal data.
+		 * @param pages	[out] Pages. (Data pointers point into jnl.)
+		 * @return 0 on success; negative errno on error.
+		 */
+		static int parseJournal(const vector<uint8_t> &jnl, vector<JournalPage> *pages);
+
+		/**
+		 * Write a file to disk and make sure it's been committed.
+		 * @param f File.
+		 * @return 0 on success; negative errno on error.
+		 */
+		static int syncFile(FILE *f);
+
+		/**
+		 * Write pages to the save file in place.
+		 * @param filename Save file.
+		 * @param pages Pages.
+		 * @return 0 on success; negative errno on error.
+		 */
+		static int writeInPlace(const string &filename, const vector<JournalPage> &pages);
+
+		/**
+		 * Write pages to the save file.
+		 * The pages are written to the journal first.
+		 * @param filename Save file.
+		 * @param buf Page buffer.
+		 * @param pages Pages to write.
+		 * @param fileSize Save file size.
+		 * @return 0 on success; negative errno on error.
+		 */
+		static int writeJournaled(const string &filename, const vector<uint8_t> &buf,
+			const vector<bool> &pages, unsigned int fileSize);
+
+		/**
+		 * Replay an interrupted journal.
+		 * If the journal is incomplete, the save file wasn't
+		 * modified yet, so the journal is simply removed.
+		 * @param filename Save file.
+		 * @return 1 if the journal was replayed; 0 if not; negative errno on error.
+		 */
+		static int recover(const string &filename);
+};
+
+const char SaveDataWriterPrivate::JournalMagic[8] = {'G','E','N','S','J','N','L','1'};
+const char SaveDataWriterPrivate::JournalExt[] = ".jnl";
+
+SaveDataWriterPrivate::SaveDataWriterPrivate(unsigned int size)
+	: size(size)
+	, numPages((size + SaveDataWriter::PAGE_SIZE - 1) / SaveDataWriter::PAGE_SIZE)
+	, pendBuf(size)
+	, pendPages(numPages)
+	, pending(false)
+	, busy(false)
+	, flushRequested(false)
+	, quit(false)
+	, autoSaveDelay(SaveDataWriter::AUTOSAVE_DELAY_DEFAULT)
+	, lastError(0)
+	, filePages(0)
+	, writeBuf(size)
+	, writePages(numPages)
+{ }
+
+/**
+ * Worker thread function.
+ */
+void SaveDataWriterPrivate::run(void)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		cond.wait(lock, [this] { return (pending || quit); });
+		if (!pending) {
+			// No more pages, and we've been told to quit.
+			break;
+		}
+
+		// Wait for the autosave delay.
+		// Changes made in the meantime are coalesced.
+		cond.wait_until(lock, deadline, [this] {
+			return (!pending || flushRequested || quit);
+		});
+		if (!pending) {
+			// Pending pages were discarded.
+			continue;
+		}
+
+		// Take the pending pages.
+		writeBuf.swap(pendBuf);
+		writePages.swap(pendPages);
+		pending = false;
+		busy = true;
+		const string fn = filename;
+		const unsigned int fsz = fileSize();
+
+		// Don't hold the lock while writing.
+		lock.unlock();
+		int ret = writeJournaled(fn, writeBuf, writePages, fsz);
+		writePages.assign(numPages, false);
+		lock.lock();
+
+		if (ret != 0) {
+			lastError = ret;
+		}
+		busy = false;
+		idle.notify_all();
+	}
+}
+
+/**
+ * Copy a page into the pending buffer.
+ * The mutex must be held by the caller.
+ * @param data Save data buffer.
+ * @param page Page number.
+ */
+void SaveDataWriterPrivate::copyPage(const uint8_t *data, unsigned int page)
+{
+	const unsigned int offset = page * SaveDataWriter::PAGE_SIZE;
+	unsigned int len = SaveDataWriter::PAGE_SIZE;
+	if (offset + len > size) {
+		len = size - offset;
+	}
+	memcpy(&pendBuf[offset], &data[offset], len);
+	pendPages[page] = true;
+}
+
+/**
+ * Extend the save file to include the specified pages.
+ * The save file size is rounded up to a power of two,
+ * and any new pages are copied into the pending buffer.
+ * The mutex must be held by the caller.
+ * @param data Save data buffer.
+ * @param endPage One past the last page that must be in the file.
+ */
+void SaveDataWriterPrivate::extendFile(const uint8_t *data, unsigned int endPage)
+{
+	if (endPage <= filePages)
+		return;
+
+	// Round the file size up to a power of two.
+	unsigned int bytes = 1;
+	while (bytes < endPage * SaveDataWriter::PAGE_SIZE) {
+		bytes <<= 1;
+	}
+	if (bytes > size) {
+		bytes = size;
+	}
+
+	const unsigned int newPages = (bytes + SaveDataWriter::PAGE_SIZE - 1) / SaveDataWriter::PAGE_SIZE;
+	for (unsigned int page = filePages; page < newPages; page++) {
+		copyPage(data, page);
+	}
+	filePages = newPages;
+}
+
+/**
+ * Start the autosave delay if it isn't running.
+ * The mutex must be held by the caller.
+ */
+void SaveDataWriterPrivate::arm(void)
+{
+	if (pending)
+		return;
+
+	// The delay starts at the first change, so data
+	// is written even if the game keeps writing.
+	pending = true;
+	deadline = clock::now() + std::chrono::milliseconds(autoSaveDelay);
+	if (!thread.joinable()) {
+		thread = std::thread(&SaveDataWriterPrivate::run, this);
+	}
+	cond.notify_one();
+}
+
+/**
+ * Parse a journal.
+ * @param jnl	[in] Journal data.
+ * @param pages	[out] Pages. (Data pointers point into jnl.)
+ * @return 0 on success; negative errno on error.
+ */
+int SaveDataWriterPrivate::parseJournal(const vector<uint8_t> &jnl, vector<JournalPage> *pages)
+{
+	pages->clear();
+	const size_t hdrSize = sizeof(JournalMagic) + sizeof(uint32_t);
+	if (jnl.size() < hdrSize + sizeof(uint32_t) ||
+	    memcmp(&jnl[0], JournalMagic, sizeof(JournalMagic)) != 0)
+	{
+		// Not a journal.
+		return -EINVAL;
+	}
+
+	// Verify the checksum.
+	const size_t crcPos = jnl.size() - sizeof(uint32_t);
+	uint32_t crc_jnl;
+	memcpy(&crc_jnl, &jnl[crcPos], sizeof(crc_jnl));
+	const uint32_t crc = (uint32_t)crc32(0, &jnl[0], (uInt)crcPos);
+	if (le32_to_cpu(crc_jnl) != crc) {
+		// Journal is incomplete.
+		return -EINVAL;
+	}
+
+	uint32_t count;
+	memcpy(&count, &jnl[sizeof(JournalMagic)], sizeof(count));
+	count = le32_to_cpu(count);
+
+	size_t pos = hdrSize;
+	for (; count > 0; count--) {
+		if (pos + 8 > crcPos)
+			return -EINVAL;
+
+		JournalPage page;
+		memcpy(&page.offset, &jnl[pos], sizeof(page.offset));
+		memcpy(&page.length, &jnl[pos+4], sizeof(page.length));
+		page.offset = le32_to_cpu(page.offset);
+		page.length = le32_to_cpu(page.length);
+		pos += 8;
+		if (page.length > crcPos - pos)
+			return -EINVAL;
+		page.data = &jnl[pos];
+		pos += page.length;
+		pages->push_back(page);
+	}
+
+	return (pos == crcPos ? 0 : -EINVAL);
+}
+
+/**
+ * Write a file to disk and make sure it's been committed.
+ * @param f File.
+ * @return 0 on success; negative errno on error.
+ */
+int SaveDataWriterPrivate::syncFile(FILE *f)
+{
+	if (fflush(f) != 0)
+		return -errno;
+#ifndef _WIN32
+	if (fsync(fileno(f)) != 0)
+		return -errno;
+#else
+	if (_commit(_fileno(f)) != 0)
+		return -errno;
+#endif
+	return 0;
+}
+
+/**
+ * Write pages to the save file in place.
+ * @param filename Save file.
+ * @param pages Pages.
+ * @return 0 on success; negative errno on error.
+ */
+int SaveDataWriterPrivate::writeInPlace(const string &filename, const vector<JournalPage> &pages)
+{
+#ifndef _WIN32
+	int fd = open(filename.c_str(), O_WRONLY | O_CREAT, 0666);
+	if (fd < 0)
+		return -errno;
+
+	int ret = 0;
+	for (size_t i = 0; i < pages.size() && ret == 0; i++) {
+		const JournalPage &page = pages[i];
+		size_t done = 0;
+		while (done < page.length) {
+			ssize_t n = pwrite(fd, page.data + done, page.length - done, page.offset + done);
+			if (n < 0) {
+				if (errno == EINTR)
+					continue;
+				ret = -errno;
+				break;
+			}
+			done += n;
+		}
+	}
+
+	if (ret == 0 && fsync(fd) != 0) {
+		ret = -errno;
+	}
+	close(fd);
+	return ret;
+#else /* _WIN32 */
+	// No pwrite() on Windows.
+	FILE *f = fopen(filename.c_str(), "r+b");
+	if (!f) {
+		f = fopen(filename.c_str(), "w+b");
+		if (!f)
+			return -errno;
+	}
+
+	int ret = 0;
+	for (size_t i = 0; i < pages.size(); i++) {
+		const JournalPage &page = pages[i];
+		if (fseek(f, page.offset, SEEK_SET) != 0 ||
+		    fwrite(page.data, 1, page.length, f) != page.length)
+		{
+			ret = -EIO;
+			break;
+		}
+	}
+
+	if (ret == 0) {
+		ret = syncFile(f);
+	}
+	fclose(f);
+	return ret;
+#endif /* _WIN32 */
+}
+
+/**
+ * Write pages to the save file.
+ * The pages are written to the journal first.
+ * @param filename Save file.
+ * @param buf Page buffer.
+ * @param pages Pages to write.
+ * @param fileSize Save file size.
+ * @return 0 on success; negative errno on error.
+ */
+int SaveDataWriterPrivate::writeJournaled(const string &filename, const vector<uint8_t> &buf,
+	const vector<bool> &pages, unsigned int fileSize)
+{
+	// Build the journal.
+	vector<uint8_t> jnl(JournalMagic, JournalMagic + sizeof(JournalMagic));
+	jnl.resize(jnl.size() + sizeof(uint32_t));
+	uint32_t count = 0;
+	for (unsigned int page = 0; page < pages.size(); page++) {
+		if (!pages[page])
+			continue;
+		const uint32_t offset = page * SaveDataWriter::PAGE_SIZE;
+		if (offset >= fileSize)
+			continue;
+		uint32_t length = SaveDataWriter::PAGE_SIZE;
+		if (offset + length > fileSize) {
+			length = fileSize - offset;
+		}
+
+		const uint32_t hdr[2] = {cpu_to_le32(offset), cpu_to_le32(length)};
+		const uint8_t *const hdr8 = (const uint8_t*)hdr;
+		jnl.insert(jnl.end(), hdr8, hdr8 + sizeof(hdr));
+		jnl.insert(jnl.end(), &buf[offset], &buf[offset] + length);
+		count++;
+	}
+	if (count == 0)
+		return 0;
+
+	const uint32_t count_le = cpu_to_le32(count);
+	memcpy(&jnl[sizeof(JournalMagic)], &count_le, sizeof(count_le));
+	const uint32_t crc_le = cpu_to_le32((uint32_t)crc32(0, &jnl[0], (uInt)jnl.size()));
+	const uint8_t *const crc8 = (const uint8_t*)&crc_le;
+	jnl.insert(jnl.end(), crc8, crc8 + sizeof(crc_le));
+
+	// Write the journal.
+	// The save file isn't touched until the
+	// journal has been committed to disk.
+	const string jnlFilename = filename + JournalExt;
+	FILE *f = fopen(jnlFilename.c_str(), "wb");
+	if (!f)
+		return -errno;
+	int ret = 0;
+	if (fwrite(&jnl[0], 1, jnl.size(), f) != jnl.size()) {
+		ret = -EIO;
+	} else {
+		ret = syncFile(f);
+	}
+	fclose(f);
+	if (ret != 0) {
+		remove(jnlFilename.c_str());
+		return ret;
+	}
+
+	// Write the pages to the save file.
+	vector<JournalPage> jpages;
+	parseJournal(jnl, &jpages);
+	ret = writeInPlace(filename, jpages);
+	if (ret != 0) {
+		// Leave the journal so it can be replayed.
+		return ret;
+	}
+
+	// Save file has been updated.
+	remove(jnlFilename.c_str());
+	return 0;
+}
+
+/**
+ * Replay an interrupted journal.
+ * If the journal is incomplete, the save file wasn't
+ * modified yet, so the journal is simply removed.
+ * @param filename Save file.
+ * @return 1 if the journal was replayed; 0 if not; negative errno on error.
+ */
+int SaveDataWriterPrivate::recover(const string &filename)
+{
+	const string jnlFilename = filename + JournalExt;
+	FILE *f = fopen(jnlFilename.c_str(), "rb");
+	if (!f) {
+		// No journal.
+		return 0;
+	}
+
+	// Journals only contain changed pages,
+	// so they should be small.
+	vector<uint8_t> jnl;
+	uint8_t buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+		jnl.insert(jnl.end(), buf, buf + n);
+	}
+	fclose(f);
+
+	vector<JournalPage> pages;
+	int ret = parseJournal(jnl, &pages);
+	if (ret == 0) {
+		ret = writeInPlace(filename, pages);
+		if (ret != 0) {
+			// Keep the journal for next time.
+			return ret;
+		}
+		ret = 1;
+	} else {
+		// Incomplete journal.
+		ret = 0;
+	}
+
+	remove(jnlFilename.c_str());
+	return ret;
+}
+
+/** SaveDataWriter **/
+
+/**
+ * Create a save data writer.
+ * @param size Size of the save data buffer.
+ */
+SaveDataWriter::SaveDataWriter(unsigned int size)
+	: d(new SaveDataWriterPrivate(size))
+{ }
+
+SaveDataWriter::~SaveDataWriter()
+{
+	// Write any pending pages.
+	if (d->thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(d->mtx);
+			d->quit = true;
+		}
+		d->cond.notify_one();
+		d->thread.join();
+	}
+	delete d;
+}
+
+/**
+ * Set the save file.
+ * Pending changes are written to the previous save file.
+ * If the new save file has an interrupted journal,
+ * it's replayed, so the save file should be read
+ * after calling this function.
+ * @param filename Save file. (UTF-8) (If empty, changes won't be written.)
+ */
+void SaveDataWriter::setFilename(const string &filename)
+{
+	flush();
+
+	std::lock_guard<std::mutex> lock(d->mtx);
+	d->filename = filename;
+	d->filePages = 0;
+	d->lastError = 0;
+	if (filename.empty())
+		return;
+
+	// Replay an interrupted journal.
+	int ret = d->recover(filename);
+	if (ret < 0) {
+		d->lastError = ret;
+	}
+
+	// Get the current save file size.
+	struct stat st;
+	if (stat(filename.c_str(), &st) == 0 && st.st_size > 0) {
+		unsigned int bytes = (st.st_size > (off_t)d->size ? d->size : (unsigned int)st.st_size);
+		d->filePages = (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+	}
+}
+
+/**
+ * Get the autosave delay.
+ * @return Autosave delay, in milliseconds.
+ */
+int SaveDataWriter::autoSaveDelay(void) const
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	return d->autoSaveDelay;
+}
+
+/**
+ * Set the autosave delay.
+ * This is the time between the first change and
+ * when the changes are written to the save file.
+ * @param ms Autosave delay, in milliseconds.
+ */
+void SaveDataWriter::setAutoSaveDelay(int ms)
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	d->autoSaveDelay = (ms < 0 ? 0 : ms);
+}
+
+/**
+ * Save data was modified.
+ * The pages containing the modified bytes are copied,
+ * along with any pages needed to extend the save file.
+ * @param data Save data buffer. (must be the full buffer)
+ * @param address First modified byte.
+ * @param length Number of modified bytes.
+ */
+void SaveDataWriter::update(const uint8_t *data, unsigned int address, unsigned int length)
+{
+	if (length == 0 || address >= d->size)
+		return;
+	if (address + length > d->size) {
+		length = d->size - address;
+	}
+
+	const unsigned int firstPage = address / PAGE_SIZE;
+	const unsigned int lastPage = (address + length - 1) / PAGE_SIZE;
+
+	std::lock_guard<std::mutex> lock(d->mtx);
+	if (d->filename.empty())
+		return;
+
+	d->extendFile(data, lastPage + 1);
+	for (unsigned int page = firstPage; page <= lastPage; page++) {
+		d->copyPage(data, page);
+	}
+	d->arm();
+}
+
+/**
+ * The entire save data buffer was replaced.
+ * @param data Save data buffer.
+ * @param usedSize Number of bytes used in the save data buffer.
+ */
+void SaveDataWriter::updateAll(const uint8_t *data, unsigned int usedSize)
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	if (d->filename.empty())
+		return;
+
+	// Pages past the end of the used data that are
+	// already in the save file must be overwritten.
+	if (usedSize > d->size) {
+		usedSize = d->size;
+	}
+	d->extendFile(data, (usedSize + PAGE_SIZE - 1) / PAGE_SIZE);
+	if (d->filePages == 0)
+		return;
+	for (unsigned int page = 0; page < d->filePages; page++) {
+		d->copyPage(data, page);
+	}
+	d->arm();
+}
+
+/**
+ * Discard all pending changes.
+ * This should be called if the save data buffer is
+ * cleared without changing the save file.
+ */
+void SaveDataWriter::discard(void)
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	d->pending = false;
+	d->pendPages.assign(d->numPages, false);
+	d->cond.notify_one();
+}
+
+/**
+ * Are any changes waiting to be written?
+ * @return True if changes are pending.
+ */
+bool SaveDataWriter::isPending(void) const
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	return (d->pending || d->busy);
+}
+
+/**
+ * Write all pending changes now.
+ * This waits for the changes to be written.
+ * @return Save file size if changes were written; 0 if nothing was pending; negative errno on error.
+ */
+int SaveDataWriter::flush(void)
+{
+	std::unique_lock<std::mutex> lock(d->mtx);
+	if (!d->pending && !d->busy)
+		return 0;
+
+	d->flushRequested = true;
+	d->cond.notify_one();
+	d->idle.wait(lock, [this] { return (!d->pending && !d->busy); });
+	d->flushRequested = false;
+
+	if (d->lastError != 0) {
+		int ret = d->lastError;
+		d->lastError = 0;
+		return ret;
+	}
+	return (int)d->fileSize();
+}
+
+/**
+ * Get and clear the last background write error.
+ * @return 0 if no errors occurred; negative errno on error.
+ */
+int SaveDataWriter::lastError(void)
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	int ret = d->lastError;
+	d->lastError = 0;
+	return ret;
+}
+
+}
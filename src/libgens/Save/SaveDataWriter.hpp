@@ -0,0 +1,147 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * SaveDataWriter.hpp: Incremental SRam/EEPRom file writer.                *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_SAVE_SAVEDATAWRITER_HPP__
+#define __LIBGENS_SAVE_SAVEDATAWRITER_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <string>
+
+namespace LibGens {
+
+/**
+ * Writes SRam/EEPRom changes to the save file.
+ *
+ * Modified pages are copied when the emulated memory is
+ * written, and a background thread writes them to the
+ * save file once the autosave delay has passed. Writes
+ * made during the delay are coalesced.
+ *
+ * Pages are written in place, so unmodified pages aren't
+ * rewritten. To keep the save file consistent if the
+ * emulator crashes during a write, the pages are first
+ * written to a journal, which is replayed when the save
+ * file is opened again.
+ *
+ * All functions except the destructor must be called
+ * from the emulation thread.
+ */
+class SaveDataWriterPrivate;
+class SaveDataWriter
+{
+	public:
+		/**
+		 * Create a save data writer.
+		 * @param size Size of the save data buffer.
+		 */
+		explicit SaveDataWriter(unsigned int size);
+		~SaveDataWriter();
+
+	protected:
+		friend class SaveDataWriterPrivate;
+		SaveDataWriterPrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		SaveDataWriter(const SaveDataWriter &);
+		SaveDataWriter &operator=(const SaveDataWriter &);
+
+	public:
+		// Page size.
+		static const unsigned int PAGE_SIZE = 256;
+
+		// Default autosave delay, in milliseconds.
+		static const int AUTOSAVE_DELAY_DEFAULT = 1000;
+
+		/**
+		 * Set the save file.
+		 * Pending changes are written to the previous save file.
+		 * If the new save file has an interrupted journal,
+		 * it's replayed, so the save file should be read
+		 * after calling this function.
+		 * @param filename Save file. (UTF-8) (If empty, changes won't be written.)
+		 */
+		void setFilename(const std::string &filename);
+
+		/**
+		 * Get the autosave delay.
+		 * @return Autosave delay, in milliseconds.
+		 */
+		int autoSaveDelay(void) const;
+
+		/**
+		 * Set the autosave delay.
+		 * This is the time between the first change and
+		 * when the changes are written to the save file.
+		 * @param ms Autosave delay, in milliseconds.
+		 */
+		void setAutoSaveDelay(int ms);
+
+		/**
+		 * Save data was modified.
+		 * The pages containing the modified bytes are copied,
+		 * along with any pages needed to extend the save file.
+		 * @param data Save data buffer. (must be the full buffer)
+		 * @param address First modified byte.
+		 * @param length Number of modified bytes.
+		 */
+		void update(const uint8_t *data, unsigned int address, unsigned int length);
+
+		/**
+		 * The entire save data buffer was replaced.
+		 * @param data Save data buffer.
+		 * @param usedSize Number of bytes used in the save data buffer.
+		 */
+		void updateAll(const uint8_t *data, unsigned int usedSize);
+
+		/**
+		 * Discard all pending changes.
+		 * This should be called if the save data buffer is
+		 * cleared without changing the save file.
+		 */
+		void discard(void);
+
+		/**
+		 * Are any changes waiting to be written?
+		 * @return True if changes are pending.
+		 */
+		bool isPending(void) const;
+
+		/**
+		 * Write all pending changes now.
+		 * This waits for the changes to be written.
+		 * @return Save file size if changes were written; 0 if nothing was pending; negative errno on error.
+		 */
+		int flush(void);
+
+		/**
+		 * Get and clear the last background write error.
+		 * @return 0 if no errors occurred; negative errno on error.
+		 */
+		int lastError(void);
+};
+
+}
+
+#endif /* __LIBGENS_SAVE_SAVEDATAWRITER_HPP__ */
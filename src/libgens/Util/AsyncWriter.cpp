@@ -0,0 +1,312 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * AsyncWriter.cpp: Asynchronous file writer.                              *
+ * Buffers data in memory and writes it on a background thread.            *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "AsyncWriter.hpp"
+
+#ifdef _WIN32
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+#include "libcompat/W32U/W32U_mini.h"
+#endif
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::deque;
+using std::vector;
+
+namespace LibGens {
+
+class AsyncWriterPrivate
+{
+	public:
+		AsyncWriterPrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		AsyncWriterPrivate(const AsyncWriterPrivate &);
+		AsyncWriterPrivate &operator=(const AsyncWriterPrivate &);
+
+	public:
+		FILE *file;
+
+		// Current in-memory block.
+		// Only accessed by the caller's thread.
+		vector<uint8_t> block;
+		uint32_t size;
+
+		// Pending write job.
+		struct Job {
+			// Position in the file, or -1 to append.
+			int64_t pos;
+			vector<uint8_t> data;
+		};
+
+		// Job queue. Protected by mtx.
+		std::mutex mtx;
+		std::condition_variable cond;
+		deque<Job> queue;
+		bool quit;
+
+		// First error reported by the writer thread. (negative errno)
+		// Protected by mtx.
+		int err;
+
+		// Writer thread.
+		std::thread thread;
+
+		/**
+		 * Queue a job for the writer thread.
+		 * @param pos Position in the file, or -1 to append.
+		 * @param data Data. (swapped into the job)
+		 */
+		void enqueue(int64_t pos, vector<uint8_t> &data);
+
+		/**
+		 * Writer thread function.
+		 */
+		void run(void);
+};
+
+AsyncWriterPrivate::AsyncWriterPrivate()
+	: file(nullptr)
+	, size(0)
+	, quit(false)
+	, err(0)
+{ }
+
+/**
+ * Queue a job for the writer thread.
+ * @param pos Position in the file, or -1 to append.
+ * @param data Data. (swapped into the job)
+ */
+void AsyncWriterPrivate::enqueue(int64_t pos, vector<uint8_t> &data)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		queue.push_back(Job());
+		Job &job = queue.back();
+		job.pos = pos;
+		job.data.swap(data);
+	}
+	cond.notify_one();
+}
+
+/**
+ * Writer thread function.
+ */
+void AsyncWriterPrivate::run(void)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		cond.wait(lock, [this] { return (!queue.empty() || quit); });
+		if (queue.empty()) {
+			// No more jobs, and we've been told to quit.
+			break;
+		}
+
+		Job job;
+		job.pos = queue.front().pos;
+		job.data.swap(queue.front().data);
+		queue.pop_front();
+
+		// Don't hold the lock while writing to the file.
+		lock.unlock();
+		int ret = 0;
+		if (job.pos >= 0) {
+			// Positioned write. (header update)
+			if (fseek(file, (long)job.pos, SEEK_SET) != 0) {
+				ret = (errno != 0 ? -errno : -EIO);
+			}
+		}
+		if (ret == 0 && !job.data.empty()) {
+			size_t sz = fwrite(job.data.data(), 1, job.data.size(), file);
+			if (sz != job.data.size()) {
+				ret = (errno != 0 ? -errno : -EIO);
+			}
+		}
+		if (job.pos >= 0) {
+			// Return to the end of the file.
+			fseek(file, 0, SEEK_END);
+		}
+		lock.lock();
+
+		if (ret != 0 && err == 0) {
+			err = ret;
+		}
+	}
+}
+
+/** AsyncWriter **/
+
+AsyncWriter::AsyncWriter()
+	: d(new AsyncWriterPrivate())
+{ }
+
+AsyncWriter::~AsyncWriter()
+{
+	close();
+	delete d;
+}
+
+/**
+ * Open a file for writing.
+ * The file is truncated if it already exists.
+ * This starts the background writer thread.
+ * @param filename Filename. (UTF-8)
+ * @return 0 on success; negative errno on error.
+ */
+int AsyncWriter::open(const char *filename)
+{
+	close();
+
+	errno = 0;
+	d->file = fopen(filename, "wb");
+	if (!d->file) {
+		return (errno != 0 ? -errno : -EIO);
+	}
+
+	d->block.clear();
+	d->block.reserve(BLOCK_SIZE);
+	d->size = 0;
+	d->quit = false;
+	d->err = 0;
+	d->thread = std::thread(&AsyncWriterPrivate::run, d);
+	return 0;
+}
+
+/**
+ * Close the file.
+ * All pending data is written before the file is closed.
+ * @return 0 on success; negative errno if any write failed.
+ */
+int AsyncWriter::close(void)
+{
+	if (!d->file)
+		return 0;
+
+	// Hand off the last block and wait for the writer thread.
+	flush();
+	{
+		std::lock_guard<std::mutex> lock(d->mtx);
+		d->quit = true;
+	}
+	d->cond.notify_one();
+	d->thread.join();
+
+	int ret = d->err;
+	if (fclose(d->file) != 0 && ret == 0) {
+		ret = (errno != 0 ? -errno : -EIO);
+	}
+	d->file = nullptr;
+
+	// Release the block's memory.
+	vector<uint8_t>().swap(d->block);
+	return ret;
+}
+
+/**
+ * Is the file open?
+ * @return True if the file is open.
+ */
+bool AsyncWriter::isOpen(void) const
+{
+	return (d->file != nullptr);
+}
+
+/**
+ * Append data to the file.
+ * Data is copied into an in-memory block, which is
+ * handed to the writer thread once it's full.
+ * @param data Data.
+ * @param size Size of data, in bytes.
+ */
+void AsyncWriter::write(const void *data, size_t size)
+{
+	if (!d->file || size == 0)
+		return;
+
+	const uint8_t *p = (const uint8_t*)data;
+	d->block.insert(d->block.end(), p, p + size);
+	d->size += (uint32_t)size;
+	if (d->block.size() >= BLOCK_SIZE) {
+		flush();
+	}
+}
+
+/**
+ * Overwrite data at a specific position in the file.
+ * This is intended for updating file headers.
+ * The position must be within data that has already
+ * been appended with write().
+ * @param pos Position in the file.
+ * @param data Data.
+ * @param size Size of data, in bytes.
+ */
+void AsyncWriter::writeAt(uint32_t pos, const void *data, size_t size)
+{
+	if (!d->file || size == 0)
+		return;
+
+	// Previously-appended data must be queued first.
+	flush();
+
+	const uint8_t *p = (const uint8_t*)data;
+	vector<uint8_t> buf(p, p + size);
+	d->enqueue(pos, buf);
+}
+
+/**
+ * Hand the current block to the writer thread.
+ * This does not wait for the data to be written.
+ */
+void AsyncWriter::flush(void)
+{
+	if (!d->file || d->block.empty())
+		return;
+
+	d->enqueue(-1, d->block);
+
+	// d->block was swapped with an empty vector.
+	d->block.reserve(BLOCK_SIZE);
+}
+
+/**
+ * Get the number of bytes appended to the file.
+ * This includes data that hasn't been written yet.
+ * @return Number of bytes appended.
+ */
+uint32_t AsyncWriter::size(void) const
+{
+	return d->size;
+}
+
+}
@@ -0,0 +1,112 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * AsyncWriter.hpp: Asynchronous file writer.                              *
+ * Buffers data in memory and writes it on a background thread.            *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_UTIL_ASYNCWRITER_HPP__
+#define __LIBGENS_UTIL_ASYNCWRITER_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// C includes. (C++ namespace)
+#include <cstddef>
+
+namespace LibGens {
+
+class AsyncWriterPrivate;
+class AsyncWriter
+{
+	public:
+		AsyncWriter();
+		~AsyncWriter();
+
+	protected:
+		friend class AsyncWriterPrivate;
+		AsyncWriterPrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		AsyncWriter(const AsyncWriter &);
+		AsyncWriter &operator=(const AsyncWriter &);
+
+	public:
+		/**
+		 * Open a file for writing.
+		 * The file is truncated if it already exists.
+		 * This starts the background writer thread.
+		 * @param filename Filename. (UTF-8)
+		 * @return 0 on success; negative errno on error.
+		 */
+		int open(const char *filename);
+
+		/**
+		 * Close the file.
+		 * All pending data is written before the file is closed.
+		 * @return 0 on success; negative errno if any write failed.
+		 */
+		int close(void);
+
+		/**
+		 * Is the file open?
+		 * @return True if the file is open.
+		 */
+		bool isOpen(void) const;
+
+		/**
+		 * Append data to the file.
+		 * Data is copied into an in-memory block, which is
+		 * handed to the writer thread once it's full.
+		 * @param data Data.
+		 * @param size Size of data, in bytes.
+		 */
+		void write(const void *data, size_t size);
+
+		/**
+		 * Overwrite data at a specific position in the file.
+		 * This is intended for updating file headers.
+		 * The position must be within data that has already
+		 * been appended with write().
+		 * @param pos Position in the file.
+		 * @param data Data.
+		 * @param size Size of data, in bytes.
+		 */
+		void writeAt(uint32_t pos, const void *data, size_t size);
+
+		/**
+		 * Hand the current block to the writer thread.
+		 * This does not wait for the data to be written.
+		 */
+		void flush(void);
+
+		/**
+		 * Get the number of bytes appended to the file.
+		 * This includes data that hasn't been written yet.
+		 * @return Number of bytes appended.
+		 */
+		uint32_t size(void) const;
+
+		// Size of each in-memory block.
+		static const size_t BLOCK_SIZE = 64*1024;
+};
+
+}
+
+#endif /* __LIBGENS_UTIL_ASYNCWRITER_HPP__ */
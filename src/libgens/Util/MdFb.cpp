@@ -45,6 +45,10 @@ MdFb::MdFb()
 	// Color depth.
 	, m_bpp(BPP_32)
 	, m_fb(nullptr)
+	// Indexed color mode.
+	, m_indexed(false)
+	, m_fb8(nullptr)
+	, m_lastPalSlot(-1)
 	// Image parameters.
 	, m_imgWidth(m_pxPerLine)
 	, m_imgHeight(m_numLines)
@@ -56,6 +60,7 @@ MdFb::MdFb()
 
 MdFb::~MdFb() {
 	aligned_free(m_fb);
+	aligned_free(m_fb8);
 }
 
 /**
@@ -84,6 +89,415 @@ void MdFb::reinitFb(void) {
 	for (int y = 0, px = 0; y < m_numLines; y++, px += m_pxPitch) {
 		m_lineNumTable[y] = px;
 	}
+
+	// Initialize dirty line tracking.
+	const int words = ((m_numLines + 31) / 32);
+	m_dirtyLines.resize(words);
+	m_lineHashValid.resize(words);
+	m_lineHash.assign(m_numLines, 0);
+	markAllDirty();
+
+	// Initialize indexed color mode.
+	m_lineResolved.assign(words, 0);
+	m_linePalette.assign(m_numLines, -1);
+}
+
+/**
+ * Hash an array of 64-bit words.
+ * FNV-1a style hash, with two independent lanes
+ * to reduce the multiply dependency chain.
+ * @param p Words.
+ * @param words Number of words.
+ * @param seed Seed.
+ * @return Hash.
+ */
+static uint64_t hashWords(const uint64_t *p, int words, uint64_t seed)
+{
+	static const uint64_t FNV_PRIME = 0x100000001B3ULL;
+	uint64_t h0 = 0xCBF29CE484222325ULL;
+	uint64_t h1 = h0 ^ seed;
+	int i;
+	for (i = 0; i < words - 1; i += 2) {
+		h0 = (h0 ^ p[i]) * FNV_PRIME;
+		h1 = (h1 ^ p[i+1]) * FNV_PRIME;
+	}
+	if (i < words) {
+		h0 = (h0 ^ p[i]) * FNV_PRIME;
+	}
+	return (h0 ^ (h1 >> 29) ^ (h1 << 35));
+}
+
+/** Dirty line tracking. **/
+
+/**
+ * Hash a line's visible pixels.
+ * @param line Line number.
+ * @return Line hash.
+ */
+uint64_t MdFb::hashLine(int line) const
+{
+	// NOTE: pxPerLine is a multiple of 8, so the
+	// visible area is always a multiple of 8 bytes.
+	if (m_indexed && m_linePalette[line] >= 0) {
+		// Indexed line. Hash the palette indexes,
+		// plus the palette snapshot's hash.
+		const uint64_t *p = reinterpret_cast<const uint64_t*>(lineBuf8(line));
+		return (hashWords(p, m_pxPerLine / 8, line) ^
+			m_palHash[m_linePalette[line]]);
+	}
+
+	const int bytesPerPx = (m_bpp == BPP_32 ? 4 : 2);
+	const uint64_t *p = reinterpret_cast<const uint64_t*>(
+		static_cast<const uint8_t*>(m_fb) +
+		((m_lineNumTable[line] + m_pxStart) * bytesPerPx));
+	return hashWords(p, ((m_pxPerLine * bytesPerPx) / 8), line);
+}
+
+/**
+ * Check if a line was changed by the renderer.
+ * This should be called after a line is rendered.
+ * The line's visible pixels are hashed, and the
+ * line is marked as dirty if the hash differs
+ * from the previous hash.
+ * @param line Line number.
+ * @return True if the line is now dirty.
+ */
+bool MdFb::commitLine(int line)
+{
+	assert(line >= 0 && line < m_numLines);
+	const uint64_t hash = hashLine(line);
+	const int word = (line >> 5);
+	const uint32_t bit = (1U << (line & 31));
+
+	if (!(m_lineHashValid[word] & bit) || m_lineHash[line] != hash) {
+		m_lineHash[line] = hash;
+		m_lineHashValid[word] |= bit;
+		m_dirtyLines[word] |= bit;
+		// RGB pixels must be regenerated.
+		m_lineResolved[word] &= ~bit;
+	}
+	return !!(m_dirtyLines[word] & bit);
+}
+
+/**
+ * Mark all lines as dirty.
+ * This should be used if the entire framebuffer
+ * is modified without calling commitLine().
+ */
+void MdFb::markAllDirty(void)
+{
+	const int words = (int)m_dirtyLines.size();
+	for (int i = 0; i < words; i++) {
+		m_dirtyLines[i] = ~0U;
+		m_lineHashValid[i] = 0;
+	}
+
+	// Don't mark lines past the end of the framebuffer.
+	if (m_numLines & 31) {
+		m_dirtyLines[words - 1] = ((1U << (m_numLines & 31)) - 1);
+	}
+}
+
+/**
+ * Are any lines dirty?
+ * @return True if any lines are dirty.
+ */
+bool MdFb::isDirty(void) const
+{
+	for (size_t i = 0; i < m_dirtyLines.size(); i++) {
+		if (m_dirtyLines[i] != 0)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Find the next range of dirty lines.
+ * @param start	[in] First line to check.
+ * @param count	[out] Number of dirty lines in the range.
+ * @return First dirty line at or after start, or -1 if none.
+ */
+int MdFb::nextDirtyRange(int start, int *count) const
+{
+	// Find the first dirty line.
+	int line = start;
+	while (line < m_numLines) {
+		const uint32_t bits = (m_dirtyLines[line >> 5] >> (line & 31));
+		if (bits & 1)
+			break;
+		if (bits == 0) {
+			// No more dirty lines in this word.
+			line = (line | 31) + 1;
+		} else {
+			line++;
+		}
+	}
+	if (line >= m_numLines) {
+		*count = 0;
+		return -1;
+	}
+
+	// Find the end of the range.
+	int end = line + 1;
+	while (end < m_numLines) {
+		const uint32_t bits = (m_dirtyLines[end >> 5] >> (end & 31));
+		if (!(bits & 1))
+			break;
+		if (bits == (~0U >> (end & 31))) {
+			// Rest of this word is dirty.
+			end = (end | 31) + 1;
+		} else {
+			end++;
+		}
+	}
+	if (end > m_numLines)
+		end = m_numLines;
+
+	*count = (end - line);
+	return line;
+}
+
+/**
+ * Copy the image and image parameters from another MdFb.
+ * @param src Source MdFb.
+ */
+void MdFb::copyFrom(const MdFb *src)
+{
+	if (src == this)
+		return;
+
+	// The framebuffer dimensions are fixed,
+	// so only the contents need to be copied.
+	assert(m_fb_sz == src->m_fb_sz);
+	m_bpp = src->m_bpp;
+	setIndexed(src->m_indexed);
+	if (!m_indexed) {
+		memcpy(m_fb, src->m_fb, m_fb_sz);
+	} else {
+		// Copy the palette indexes, palette snapshots,
+		// and RGB lines. Indexed lines will be converted
+		// by resolve() if they're needed.
+		memcpy(m_fb8, src->m_fb8, (m_pxPitch * m_numLines + 16));
+		const int bytesPerPx = (m_bpp == BPP_32 ? 4 : 2);
+		for (int y = 0; y < m_numLines; y++) {
+			const int slot = src->m_linePalette[y];
+			m_linePalette[y] = slot;
+			if (slot < 0) {
+				// RGB line.
+				const size_t offset = (m_lineNumTable[y] * bytesPerPx);
+				memcpy(static_cast<uint8_t*>(m_fb) + offset,
+				       static_cast<const uint8_t*>(src->m_fb) + offset,
+				       m_pxPitch * bytesPerPx);
+			} else if (m_palSerial[slot] != src->m_palSerial[slot]) {
+				// Palette serial numbers are unique,
+				// so the snapshot only needs to be
+				// copied if the serial number differs.
+				memcpy(&m_palettes[slot * 256], &src->m_palettes[slot * 256],
+				       256 * sizeof(m_palettes[0]));
+				m_palSerial[slot] = src->m_palSerial[slot];
+				m_palHash[slot] = src->m_palHash[slot];
+			}
+		}
+		m_lastPalSlot = src->m_lastPalSlot;
+		for (size_t i = 0; i < m_lineResolved.size(); i++) {
+			m_lineResolved[i] = 0;
+		}
+	}
+	m_imgWidth = src->m_imgWidth;
+	m_imgHeight = src->m_imgHeight;
+	m_imgXStart = src->m_imgXStart;
+	m_imgYStart = src->m_imgYStart;
+
+	// Dirty lines are relative to whatever was last
+	// uploaded from this MdFb, so src's dirty lines
+	// can't be used here.
+	markAllDirty();
+}
+
+/** Indexed color mode. **/
+
+/**
+ * Enable or disable indexed color mode.
+ * When indexed color mode is enabled, all lines
+ * are RGB lines until they're given a palette.
+ * When it's disabled, indexed lines are converted
+ * to RGB first.
+ * @param indexed If true, enable indexed color mode.
+ */
+void MdFb::setIndexed(bool indexed)
+{
+	if (m_indexed == indexed)
+		return;
+
+	if (indexed) {
+		// Allocate the indexed framebuffer.
+		const size_t fb8_sz = (m_pxPitch * m_numLines + 16);
+		m_fb8 = static_cast<uint8_t*>(aligned_malloc(16, fb8_sz));
+		if (!m_fb8) {
+			// Error allocating the framebuffer.
+			return;
+		}
+		memset(m_fb8, 0, fb8_sz);
+
+		m_palettes.assign(m_numLines * 256, 0);
+		m_palSerial.assign(m_numLines, 0);
+		m_palHash.assign(m_numLines, 0);
+		m_indexed = true;
+		clearLinePalettes();
+	} else {
+		// Convert all indexed lines to RGB first.
+		resolve();
+		m_indexed = false;
+		aligned_free(m_fb8);
+		m_fb8 = nullptr;
+		vector<uint32_t>().swap(m_palettes);
+	}
+
+	// Line hashes depend on the color mode.
+	markAllDirty();
+}
+
+/**
+ * Set a line's palette. (templated version)
+ * @param pixel Pixel type. (uint16_t or uint32_t)
+ * @param line Line number.
+ * @param palette Active palette. (256 entries)
+ * @param serial Palette serial number.
+ */
+template<typename pixel>
+inline void MdFb::T_setLinePalette(int line, const pixel *palette, uint32_t serial)
+{
+	assert(m_indexed);
+	assert(line >= 0 && line < m_numLines);
+
+	// NOTE: m_lastPalSlot is reset by beginFrame(), so the
+	// most recent slot is always owned by a line that was
+	// already rendered in this frame. A slot from the
+	// previous frame could be overwritten later in this
+	// frame while lines rendered earlier still use it.
+	int slot = m_lastPalSlot;
+	if (slot < 0 || m_palSerial[slot] != serial) {
+		// New palette. Store it in this line's slot.
+		// Any other lines using this slot were rendered
+		// in the previous frame, so they will be given
+		// a new palette before they're used.
+		slot = line;
+		uint32_t *dest = &m_palettes[slot * 256];
+		for (int i = 0; i < 256; i++) {
+			dest[i] = palette[i];
+		}
+		dest[INDEX_BLACK] = 0;
+
+		m_palSerial[slot] = serial;
+		m_palHash[slot] = hashWords(reinterpret_cast<const uint64_t*>(dest),
+					    (256 * sizeof(*dest)) / 8, 0);
+		m_lastPalSlot = slot;
+	}
+
+	m_linePalette[line] = slot;
+}
+
+/**
+ * Set a line's palette. (indexed color)
+ * Snapshots are shared between lines if the serial
+ * number matches the most recent snapshot.
+ * @param line Line number.
+ * @param palette Active palette. (256 entries, in the current color depth)
+ * @param serial Palette serial number. (See VdpPalette::serial().)
+ */
+void MdFb::setLinePalette(int line, const uint16_t *palette, uint32_t serial)
+{
+	assert(m_bpp != BPP_32);
+	T_setLinePalette<uint16_t>(line, palette, serial);
+}
+
+/**
+ * Set a line's palette. (indexed color)
+ * Snapshots are shared between lines if the serial
+ * number matches the most recent snapshot.
+ * @param line Line number.
+ * @param palette Active palette. (256 entries, in the current color depth)
+ * @param serial Palette serial number. (See VdpPalette::serial().)
+ */
+void MdFb::setLinePalette(int line, const uint32_t *palette, uint32_t serial)
+{
+	assert(m_bpp == BPP_32);
+	T_setLinePalette<uint32_t>(line, palette, serial);
+}
+
+/**
+ * Remove all line palettes.
+ * All lines will be treated as RGB lines.
+ * This should be used before drawing RGB pixels
+ * directly in indexed color mode.
+ */
+void MdFb::clearLinePalettes(void)
+{
+	for (int y = 0; y < m_numLines; y++) {
+		m_linePalette[y] = -1;
+	}
+	for (size_t i = 0; i < m_palSerial.size(); i++) {
+		m_palSerial[i] = 0;
+	}
+	m_lastPalSlot = -1;
+	markAllDirty();
+}
+
+/**
+ * Convert an indexed line to RGB.
+ * @param pixel Pixel type. (uint16_t or uint32_t)
+ * @param line Line number.
+ */
+template<typename pixel>
+inline void MdFb::T_resolveLine(int line) const
+{
+	const uint32_t *palette = &m_palettes[m_linePalette[line] * 256];
+	const uint8_t *src = lineBuf8(line);
+	pixel *dest = const_cast<MdFb*>(this)->lineBuf<pixel>(line);
+
+	// NOTE: pxPerLine is a multiple of 8.
+	const pixel *const dest_end = dest + m_pxPerLine;
+	for (; dest < dest_end; dest += 8, src += 8) {
+		*(dest+0) = (pixel)palette[*(src+0)];
+		*(dest+1) = (pixel)palette[*(src+1)];
+		*(dest+2) = (pixel)palette[*(src+2)];
+		*(dest+3) = (pixel)palette[*(src+3)];
+		*(dest+4) = (pixel)palette[*(src+4)];
+		*(dest+5) = (pixel)palette[*(src+5)];
+		*(dest+6) = (pixel)palette[*(src+6)];
+		*(dest+7) = (pixel)palette[*(src+7)];
+	}
+}
+
+/**
+ * Convert indexed lines to RGB.
+ * Only lines that have changed since they were
+ * last converted are converted.
+ * This is a no-op if indexed color mode is disabled.
+ */
+void MdFb::resolve(void) const
+{
+	if (!m_indexed)
+		return;
+
+	for (int y = 0; y < m_numLines; y++) {
+		const int word = (y >> 5);
+		const uint32_t bit = (1U << (y & 31));
+		if (m_lineResolved[word] == ~0U) {
+			// All lines in this word are resolved.
+			y |= 31;
+			continue;
+		}
+		if ((m_lineResolved[word] & bit) || m_linePalette[y] < 0)
+			continue;
+
+		if (m_bpp == BPP_32) {
+			T_resolveLine<uint32_t>(y);
+		} else {
+			T_resolveLine<uint16_t>(y);
+		}
+		m_lineResolved[word] |= bit;
+	}
 }
 
 /** Convenience functions. **/
@@ -28,6 +28,7 @@
 #include <cstring>
 #include <stdint.h>
 
+#include <atomic>
 #include <vector>
 
 namespace LibGens {
@@ -42,7 +43,10 @@ class MdFb
 
 	protected:
 		~MdFb();
-		mutable int m_refcnt;	// Allow ref()/unref() even for const MdFb.
+		// Allow ref()/unref() even for const MdFb.
+		// Atomic, since MdFbs are shared between the
+		// emulation thread and the UI thread.
+		mutable std::atomic<int> m_refcnt;
 
 	private:
 		// Q_DISABLE_COPY() equivalent.
@@ -54,6 +58,68 @@ class MdFb
 		// Clear the screen.
 		void clear(void);
 
+		/** Dirty line tracking. **/
+
+		/**
+		 * Check if a line was changed by the renderer.
+		 * This should be called after a line is rendered.
+		 * The line's visible pixels are hashed, and the
+		 * line is marked as dirty if the hash differs
+		 * from the previous hash.
+		 * @param line Line number.
+		 * @return True if the line is now dirty.
+		 */
+		bool commitLine(int line);
+
+		/**
+		 * Mark a line as dirty.
+		 * This should be used if a line is modified
+		 * without calling commitLine().
+		 * @param line Line number.
+		 */
+		void markLineDirty(int line);
+
+		/**
+		 * Mark all lines as dirty.
+		 * This should be used if the entire framebuffer
+		 * is modified without calling commitLine().
+		 */
+		void markAllDirty(void);
+
+		/**
+		 * Is a line dirty?
+		 * @param line Line number.
+		 * @return True if the line is dirty.
+		 */
+		bool isLineDirty(int line) const;
+
+		/**
+		 * Are any lines dirty?
+		 * @return True if any lines are dirty.
+		 */
+		bool isDirty(void) const;
+
+		/**
+		 * Find the next range of dirty lines.
+		 * @param start	[in] First line to check.
+		 * @param count	[out] Number of dirty lines in the range.
+		 * @return First dirty line at or after start, or -1 if none.
+		 */
+		int nextDirtyRange(int start, int *count) const;
+
+		/**
+		 * Clear all dirty lines.
+		 * This should be called by the video backend
+		 * once the dirty lines have been uploaded.
+		 */
+		void clearDirty(void);
+
+		/**
+		 * Copy the image and image parameters from another MdFb.
+		 * @param src Source MdFb.
+		 */
+		void copyFrom(const MdFb *src);
+
 		// Color depth.
 		enum ColorDepth {
 			// RGB color modes.
@@ -76,6 +142,69 @@ class MdFb
 		template<typename pixel> pixel *lineBuf(int line);
 		template<typename pixel> const pixel *lineBuf(int line) const;
 
+		/** Indexed color mode. **/
+
+		/**
+		 * In indexed color mode, the renderer stores 8-bit
+		 * palette indexes instead of RGB pixels, along with
+		 * a snapshot of the active palette for each line.
+		 * Lines are converted to RGB by resolve(), which
+		 * must be called before accessing RGB pixels.
+		 *
+		 * Lines without a palette snapshot are RGB lines,
+		 * e.g. the VDP error screen.
+		 *
+		 * commitLine() must be called after rendering
+		 * an indexed line so resolve() can tell that
+		 * the line has changed.
+		 */
+		bool isIndexed(void) const;
+		void setIndexed(bool indexed);
+
+		// Palette index that is always black.
+		// Used for the border if border color emulation is disabled.
+		static const uint8_t INDEX_BLACK = 0xFF;
+
+		// Line access. (indexed color)
+		uint8_t *lineBuf8(int line);
+		const uint8_t *lineBuf8(int line) const;
+
+		/**
+		 * Set a line's palette. (indexed color)
+		 * Snapshots are shared between lines if the serial
+		 * number matches the most recent snapshot.
+		 * @param line Line number.
+		 * @param palette Active palette. (256 entries, in the current color depth)
+		 * @param serial Palette serial number. (See VdpPalette::serial().)
+		 */
+		void setLinePalette(int line, const uint16_t *palette, uint32_t serial);
+		void setLinePalette(int line, const uint32_t *palette, uint32_t serial);
+
+		/**
+		 * Start a new frame. (indexed color)
+		 * The most recent palette snapshot won't be shared
+		 * with lines in the new frame, since its slot may
+		 * be overwritten before the new frame is resolved.
+		 * This must be called before rendering each frame.
+		 */
+		void beginFrame(void);
+
+		/**
+		 * Remove all line palettes.
+		 * All lines will be treated as RGB lines.
+		 * This should be used before drawing RGB pixels
+		 * directly in indexed color mode.
+		 */
+		void clearLinePalettes(void);
+
+		/**
+		 * Convert indexed lines to RGB.
+		 * Only lines that have changed since they were
+		 * last converted are converted.
+		 * This is a no-op if indexed color mode is disabled.
+		 */
+		void resolve(void) const;
+
 		/** Framebuffer access. **/
 
 		/**
@@ -203,6 +332,95 @@ class MdFb
 		 */
 		std::vector<uint32_t> m_lineNumTable;
 
+		/**
+		 * Dirty line bitfield.
+		 * One bit per line; 32 lines per element.
+		 */
+		std::vector<uint32_t> m_dirtyLines;
+
+		/**
+		 * Line hash valid bitfield.
+		 * If a line's bit is clear, its hash must not be
+		 * compared, since the line was modified without
+		 * calling commitLine().
+		 */
+		std::vector<uint32_t> m_lineHashValid;
+
+		/**
+		 * Hash of each line's visible pixels,
+		 * as of the last call to commitLine().
+		 */
+		std::vector<uint64_t> m_lineHash;
+
+		/**
+		 * Hash a line's visible pixels.
+		 * In indexed color mode, the palette indexes
+		 * and the line palette are hashed instead.
+		 * @param line Line number.
+		 * @return Line hash.
+		 */
+		uint64_t hashLine(int line) const;
+
+		/** Indexed color mode. **/
+
+		/**
+		 * Indexed color mode enabled?
+		 */
+		bool m_indexed;
+
+		/**
+		 * Indexed framebuffer.
+		 * Same layout as m_fb, with 8-bit pixels.
+		 */
+		uint8_t *m_fb8;
+
+		/**
+		 * Palette snapshot used by each line.
+		 * -1 means the line is an RGB line.
+		 */
+		std::vector<int16_t> m_linePalette;
+
+		/**
+		 * Palette snapshots.
+		 * Each line owns one slot of 256 entries,
+		 * which is only written when that line needs
+		 * a new snapshot. Later lines with the same
+		 * palette reference the same slot.
+		 */
+		std::vector<uint32_t> m_palettes;
+		std::vector<uint32_t> m_palSerial;	// 0 == empty slot
+		std::vector<uint64_t> m_palHash;
+
+		/**
+		 * Most recent palette snapshot slot, or -1 if none.
+		 */
+		int m_lastPalSlot;
+
+		/**
+		 * Resolved line bitfield.
+		 * If a line's bit is set, its RGB pixels are
+		 * up to date with its palette indexes.
+		 */
+		mutable std::vector<uint32_t> m_lineResolved;
+
+		/**
+		 * Set a line's palette. (templated version)
+		 * @param pixel Pixel type. (uint16_t or uint32_t)
+		 * @param line Line number.
+		 * @param palette Active palette. (256 entries)
+		 * @param serial Palette serial number.
+		 */
+		template<typename pixel>
+		void T_setLinePalette(int line, const pixel *palette, uint32_t serial);
+
+		/**
+		 * Convert an indexed line to RGB.
+		 * @param pixel Pixel type. (uint16_t or uint32_t)
+		 * @param line Line number.
+		 */
+		template<typename pixel>
+		void T_resolveLine(int line) const;
+
 		/**
 		 * Reinitialize the framebuffer.
 		 */
@@ -224,17 +442,15 @@ class MdFb
 
 inline MdFb* MdFb::ref(void) const
 {
-	// TODO: Use atomic access?
-	m_refcnt++;
+	m_refcnt.fetch_add(1, std::memory_order_relaxed);
 	return (MdFb*)this;
 }
 
 inline void MdFb::unref(void) const
 {
-	// TODO: Use atomic access?
-	assert(m_refcnt > 0);
-	m_refcnt--;
-	if (m_refcnt <= 0)
+	const int refcnt = m_refcnt.fetch_sub(1, std::memory_order_acq_rel);
+	assert(refcnt > 0);
+	if (refcnt <= 1)
 		delete this;
 }
 
@@ -244,6 +460,48 @@ inline void MdFb::unref(void) const
 inline void MdFb::clear(void)
 {
 	memset(m_fb, 0x00, m_fb_sz);
+	if (m_indexed) {
+		// Cleared lines are RGB lines.
+		clearLinePalettes();
+	}
+	markAllDirty();
+}
+
+/** Dirty line tracking. **/
+
+/**
+ * Mark a line as dirty.
+ * This should be used if a line is modified
+ * without calling commitLine().
+ * @param line Line number.
+ */
+inline void MdFb::markLineDirty(int line)
+{
+	assert(line >= 0 && line < m_numLines);
+	const uint32_t bit = (1U << (line & 31));
+	m_dirtyLines[line >> 5] |= bit;
+	m_lineHashValid[line >> 5] &= ~bit;
+}
+
+/**
+ * Is a line dirty?
+ * @param line Line number.
+ * @return True if the line is dirty.
+ */
+inline bool MdFb::isLineDirty(int line) const
+{
+	assert(line >= 0 && line < m_numLines);
+	return !!(m_dirtyLines[line >> 5] & (1U << (line & 31)));
+}
+
+/**
+ * Clear all dirty lines.
+ * This should be called by the video backend
+ * once the dirty lines have been uploaded.
+ */
+inline void MdFb::clearDirty(void)
+{
+	memset(&m_dirtyLines[0], 0, m_dirtyLines.size() * sizeof(m_dirtyLines[0]));
 }
 
 /** Color depth. **/
@@ -251,7 +509,17 @@ inline void MdFb::clear(void)
 inline MdFb::ColorDepth MdFb::bpp(void) const
 	{ return m_bpp; }
 inline void MdFb::setBpp(ColorDepth bpp)
-	{ m_bpp = bpp; }
+{
+	if (m_bpp != bpp) {
+		// Line hashes and palette snapshots
+		// depend on the color depth.
+		m_bpp = bpp;
+		if (m_indexed) {
+			clearLinePalettes();
+		}
+		markAllDirty();
+	}
+}
 
 /** Line access. **/
 // TODO: Assert on incorrect color depth.
@@ -336,6 +604,45 @@ inline const pixel *MdFb::lineBuf(int line) const
 		return (pixel*)lineBuf16(line);
 }
 
+/** Indexed color mode. **/
+
+inline bool MdFb::isIndexed(void) const
+	{ return m_indexed; }
+
+/**
+ * Get a pointer to the specified line buffer. (indexed color)
+ * @param line Line number.
+ * @return Pointer to the specified line buffer. (indexed color)
+ */
+inline uint8_t *MdFb::lineBuf8(int line)
+{
+	assert(m_indexed);
+	assert(line >= 0 && line < m_numLines);
+	return &m_fb8[m_lineNumTable[line] + m_pxStart];
+}
+
+/**
+ * Get a pointer to the specified line buffer. (indexed color) [const pointer]
+ * @param line Line number.
+ * @return Pointer to the specified line buffer. (indexed color)
+ */
+inline const uint8_t *MdFb::lineBuf8(int line) const
+{
+	assert(m_indexed);
+	assert(line >= 0 && line < m_numLines);
+	return &m_fb8[m_lineNumTable[line] + m_pxStart];
+}
+
+/**
+ * Start a new frame. (indexed color)
+ * The most recent palette snapshot won't be shared
+ * with lines in the new frame, since its slot may
+ * be overwritten before the new frame is resolved.
+ * This must be called before rendering each frame.
+ */
+inline void MdFb::beginFrame(void)
+	{ m_lastPalSlot = -1; }
+
 /** Framebuffer access. **/
 
 inline uint16_t *MdFb::fb16(void)
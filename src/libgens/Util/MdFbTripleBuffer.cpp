@@ -0,0 +1,101 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * MdFbTripleBuffer.cpp: Lock-free MdFb triple buffer.                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "MdFbTripleBuffer.hpp"
+#include "MdFb.hpp"
+
+namespace LibGens {
+
+MdFbTripleBuffer::MdFbTripleBuffer()
+	: m_back(0)
+	, m_front(1)
+	, m_middle(2)
+{
+	for (int i = 0; i < 3; i++) {
+		m_fb[i] = new MdFb();
+	}
+}
+
+MdFbTripleBuffer::~MdFbTripleBuffer()
+{
+	// The consumer may still hold a reference
+	// to the front buffer, so unref() instead
+	// of deleting the buffers.
+	for (int i = 0; i < 3; i++) {
+		m_fb[i]->unref();
+	}
+}
+
+/**
+ * Get the back buffer.
+ * The back buffer is owned by the producer
+ * until publish() is called.
+ * @return Back buffer.
+ */
+MdFb *MdFbTripleBuffer::backBuffer(void)
+{
+	return m_fb[m_back];
+}
+
+/**
+ * Publish the back buffer.
+ * A new back buffer is returned by backBuffer().
+ */
+void MdFbTripleBuffer::publish(void)
+{
+	// acq_rel: Release the back buffer's contents to the
+	// consumer, and acquire the buffer it's done with.
+	const int prev = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel);
+	m_back = (prev & INDEX_MASK);
+}
+
+/**
+ * Get the most recently published frame.
+ * The previous front buffer may be reused by the
+ * producer once this function returns, so any
+ * references to it must be replaced by the new
+ * front buffer.
+ * @return True if a new frame was published since the last call.
+ */
+bool MdFbTripleBuffer::consume(void)
+{
+	if (!(m_middle.load(std::memory_order_relaxed) & FRESH)) {
+		// No new frame.
+		return false;
+	}
+
+	const int prev = m_middle.exchange(m_front, std::memory_order_acq_rel);
+	m_front = (prev & INDEX_MASK);
+	return true;
+}
+
+/**
+ * Get the front buffer.
+ * The front buffer is owned by the consumer
+ * until consume() is called.
+ * @return Front buffer.
+ */
+const MdFb *MdFbTripleBuffer::frontBuffer(void) const
+{
+	return m_fb[m_front];
+}
+
+}
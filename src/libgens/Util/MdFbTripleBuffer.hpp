@@ -0,0 +1,112 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * MdFbTripleBuffer.hpp: Lock-free MdFb triple buffer.                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_UTIL_MDFBTRIPLEBUFFER_HPP__
+#define __LIBGENS_UTIL_MDFBTRIPLEBUFFER_HPP__
+
+// C++ includes.
+#include <atomic>
+
+namespace LibGens {
+
+class MdFb;
+
+/**
+ * Passes completed frames from the emulation thread
+ * to the UI thread without locking.
+ *
+ * The producer renders into the back buffer and calls
+ * publish(), which swaps it with the middle buffer.
+ * The consumer calls consume(), which swaps the front
+ * buffer with the middle buffer if a new frame was
+ * published. Neither side ever waits for the other;
+ * if the consumer falls behind, older frames are
+ * simply overwritten.
+ *
+ * Only one thread may act as the producer, and only
+ * one thread may act as the consumer.
+ */
+class MdFbTripleBuffer
+{
+	public:
+		MdFbTripleBuffer();
+		~MdFbTripleBuffer();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		MdFbTripleBuffer(const MdFbTripleBuffer &);
+		MdFbTripleBuffer &operator=(const MdFbTripleBuffer &);
+
+	public:
+		/** Producer functions. **/
+
+		/**
+		 * Get the back buffer.
+		 * The back buffer is owned by the producer
+		 * until publish() is called.
+		 * @return Back buffer.
+		 */
+		MdFb *backBuffer(void);
+
+		/**
+		 * Publish the back buffer.
+		 * A new back buffer is returned by backBuffer().
+		 */
+		void publish(void);
+
+		/** Consumer functions. **/
+
+		/**
+		 * Get the most recently published frame.
+		 * The previous front buffer may be reused by the
+		 * producer once this function returns, so any
+		 * references to it must be replaced by the new
+		 * front buffer.
+		 * @return True if a new frame was published since the last call.
+		 */
+		bool consume(void);
+
+		/**
+		 * Get the front buffer.
+		 * The front buffer is owned by the consumer
+		 * until consume() is called.
+		 * @return Front buffer.
+		 */
+		const MdFb *frontBuffer(void) const;
+
+	private:
+		MdFb *m_fb[3];
+
+		// Buffer indexes.
+		int m_back;	// Producer only.
+		int m_front;	// Consumer only.
+
+		// Middle buffer index, plus FRESH if it
+		// hasn't been consumed yet.
+		std::atomic<int> m_middle;
+		static const int FRESH = 0x4;
+		static const int INDEX_MASK = 0x3;
+};
+
+}
+
+#endif /* __LIBGENS_UTIL_MDFBTRIPLEBUFFER_HPP__ */
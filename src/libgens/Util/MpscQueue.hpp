@@ -0,0 +1,196 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * MpscQueue.hpp: Lock-free multiple-producer, single-consumer queue.      *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_UTIL_MPSCQUEUE_HPP__
+#define __LIBGENS_UTIL_MPSCQUEUE_HPP__
+
+// C++ includes.
+#include <atomic>
+
+namespace LibGens {
+
+/**
+ * Lock-free multiple-producer, single-consumer queue.
+ *
+ * Based on Dmitry Vyukov's intrusive MPSC node-based queue.
+ * push() is wait-free and may be called from any thread.
+ * pop() and isEmpty() may only be called from one thread
+ * at a time.
+ *
+ * If a producer is preempted in the middle of push(),
+ * pop() won't see items pushed after it until it resumes.
+ *
+ * @param T Item type. Must be default-constructible and copyable.
+ */
+template<typename T>
+class MpscQueue
+{
+	public:
+		MpscQueue();
+		~MpscQueue();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		MpscQueue(const MpscQueue &);
+		MpscQueue &operator=(const MpscQueue &);
+
+	public:
+		/**
+		 * Add an item to the end of the queue.
+		 * @param item Item.
+		 */
+		void push(const T &item);
+
+		/**
+		 * Remove an item from the start of the queue.
+		 * (Consumer only)
+		 * @param item [out] Item.
+		 * @return True if an item was removed; false if the queue is empty.
+		 */
+		bool pop(T *item);
+
+		/**
+		 * Is the queue empty?
+		 * (Consumer only)
+		 * @return True if the queue is empty.
+		 */
+		bool isEmpty(void) const;
+
+	private:
+		struct Node {
+			std::atomic<Node*> next;
+			T item;
+
+			Node() : next(nullptr) { }
+			explicit Node(const T &item) : next(nullptr), item(item) { }
+		};
+
+		/**
+		 * Link a node to the end of the queue.
+		 * @param node Node.
+		 */
+		void pushNode(Node *node);
+
+		std::atomic<Node*> m_head;	// Last node pushed.
+		Node *m_tail;			// Next node to pop. (Consumer only)
+		Node m_stub;
+};
+
+template<typename T>
+MpscQueue<T>::MpscQueue()
+	: m_head(&m_stub)
+	, m_tail(&m_stub)
+{ }
+
+template<typename T>
+MpscQueue<T>::~MpscQueue()
+{
+	T item;
+	while (pop(&item)) { }
+}
+
+/**
+ * Link a node to the end of the queue.
+ * @param node Node.
+ */
+template<typename T>
+inline void MpscQueue<T>::pushNode(Node *node)
+{
+	node->next.store(nullptr, std::memory_order_relaxed);
+	Node *prev = m_head.exchange(node, std::memory_order_acq_rel);
+	prev->next.store(node, std::memory_order_release);
+}
+
+/**
+ * Add an item to the end of the queue.
+ * @param item Item.
+ */
+template<typename T>
+inline void MpscQueue<T>::push(const T &item)
+{
+	pushNode(new Node(item));
+}
+
+/**
+ * Remove an item from the start of the queue.
+ * (Consumer only)
+ * @param item [out] Item.
+ * @return True if an item was removed; false if the queue is empty.
+ */
+template<typename T>
+bool MpscQueue<T>::pop(T *item)
+{
+	Node *tail = m_tail;
+	Node *next = tail->next.load(std::memory_order_acquire);
+	if (tail == &m_stub) {
+		// Skip the stub node.
+		if (!next)
+			return false;
+		m_tail = next;
+		tail = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+
+	if (next) {
+		*item = tail->item;
+		m_tail = next;
+		delete tail;
+		return true;
+	}
+
+	if (tail != m_head.load(std::memory_order_acquire)) {
+		// A producer is in the middle of push().
+		return false;
+	}
+
+	// This is the last node. Push the stub node
+	// so the last node can be removed.
+	pushNode(&m_stub);
+	next = tail->next.load(std::memory_order_acquire);
+	if (next) {
+		*item = tail->item;
+		m_tail = next;
+		delete tail;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Is the queue empty?
+ * (Consumer only)
+ * @return True if the queue is empty.
+ */
+template<typename T>
+inline bool MpscQueue<T>::isEmpty(void) const
+{
+	if (m_tail != &m_stub) {
+		// m_tail hasn't been popped yet.
+		return false;
+	}
+	return (m_stub.next.load(std::memory_order_acquire) == nullptr);
+}
+
+}
+
+#endif /* __LIBGENS_UTIL_MPSCQUEUE_HPP__ */
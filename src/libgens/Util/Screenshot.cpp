@@ -83,6 +83,7 @@ void ScreenshotPrivate::toImgData(Zomg_Img_Data_t *img_data,
 {
 	// Take the screenshot.
 	fb->ref();
+	fb->resolve();
 	const int imgXStart = fb->imgXStart();
 	const int imgYStart = fb->imgYStart();
 
@@ -174,9 +175,10 @@ void ScreenshotPrivate::toImgData(Zomg_Img_Data_t *img_data,
  * @param filename	[in] Filename for the screenshot.
  * @param fb		[in] MD framebuffer.
  * @param rom		[in, opt] ROM object. (Needed for some metadata.)
+ * @param fast		[in, opt] If true, use fast PNG encoding. (e.g. for burst screenshots)
  * @return 0 on success; negative errno on error.
  */
-int Screenshot::toFile(const char *filename, const MdFb *fb, const Rom *rom)
+int Screenshot::toFile(const char *filename, const MdFb *fb, const Rom *rom, bool fast)
 {
 	if (!fb || !filename || !filename[0])
 		return -EINVAL;
@@ -189,6 +191,9 @@ int Screenshot::toFile(const char *filename, const MdFb *fb, const Rom *rom)
 	// Write the PNG image.
 	// TODO: Do UTF-8 filenames work with libpng on Windows?
 	PngWriter pngWriter;
+	if (fast) {
+		pngWriter.setEncodeMode(PngWriter::ENCODE_FAST);
+	}
 	return pngWriter.writeToFile(&img_data, filename,
 				&metadata, Metadata::MF_Default);
 }
@@ -52,9 +52,10 @@ class Screenshot
 		 * @param fb		[in] MD framebuffer.
 		 * @param filename	[in] Filename for the screenshot.
 		 * @param rom		[in, opt] ROM object. (Needed for some metadata.)
+		 * @param fast		[in, opt] If true, use fast PNG encoding. (e.g. for burst screenshots)
 		 * @return 0 on success; negative errno on error.
 		 */
-		static int toFile(const char *filename, const MdFb *fb, const Rom *rom);
+		static int toFile(const char *filename, const MdFb *fb, const Rom *rom, bool fast = false);
 
 		/**
 		 * Save a screenshot to a ZOMG savestate.
@@ -0,0 +1,314 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * StripeExecutor.cpp: Multithreaded framebuffer stripe executor.          *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "StripeExecutor.hpp"
+
+// C++ includes.
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::vector;
+
+namespace LibGens {
+
+class StripeExecutorPrivate
+{
+	public:
+		explicit StripeExecutorPrivate(int threads);
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		StripeExecutorPrivate(const StripeExecutorPrivate &);
+		StripeExecutorPrivate &operator=(const StripeExecutorPrivate &);
+
+	public:
+		/**
+		 * Get the automatic number of threads.
+		 * @return Number of threads.
+		 */
+		static int autoThreads(void);
+
+		// Number of threads, including the calling thread.
+		int threads;
+
+		// Serializes run() and setThreads().
+		std::mutex runMtx;
+
+		// Worker threads. Stripe 0 is processed
+		// by the calling thread, so worker i
+		// processes stripe i+1.
+		vector<std::thread> workers;
+
+		// Current job. Protected by mtx.
+		std::mutex mtx;
+		std::condition_variable startCond;
+		std::condition_variable doneCond;
+		const StripeExecutor::StripeFn *fn;
+		int numLines;
+		int stripes;
+		unsigned int generation;	// Incremented for each job.
+		int pending;			// Stripes still being processed by workers.
+		bool quit;
+
+		/**
+		 * Process a stripe.
+		 * @param stripe Stripe number.
+		 */
+		inline void runStripe(int stripe);
+
+		/**
+		 * Worker thread function.
+		 * @param stripe Stripe number.
+		 * @param seen Generation when the thread was started.
+		 */
+		void worker(int stripe, unsigned int seen);
+
+		/**
+		 * Start the worker threads.
+		 * @param count Number of threads, including the calling thread.
+		 */
+		void startWorkers(int count);
+
+		/**
+		 * Stop the worker threads.
+		 */
+		void stopWorkers(void);
+};
+
+StripeExecutorPrivate::StripeExecutorPrivate(int threads)
+	: threads(threads > 0 ? threads : autoThreads())
+	, fn(nullptr)
+	, numLines(0)
+	, stripes(0)
+	, generation(0)
+	, pending(0)
+	, quit(false)
+{
+	if (this->threads > StripeExecutor::MAX_THREADS) {
+		this->threads = StripeExecutor::MAX_THREADS;
+	}
+}
+
+/**
+ * Get the automatic number of threads.
+ * @return Number of threads.
+ */
+int StripeExecutorPrivate::autoThreads(void)
+{
+	int threads = (int)std::thread::hardware_concurrency();
+	if (threads < 1) {
+		threads = 1;
+	} else if (threads > StripeExecutor::MAX_THREADS) {
+		threads = StripeExecutor::MAX_THREADS;
+	}
+	return threads;
+}
+
+/**
+ * Process a stripe.
+ * @param stripe Stripe number.
+ */
+inline void StripeExecutorPrivate::runStripe(int stripe)
+{
+	const int first = StripeExecutor::stripeStart(numLines, stripes, stripe);
+	const int last = StripeExecutor::stripeStart(numLines, stripes, stripe + 1);
+	(*fn)(first, last - first, stripe);
+}
+
+/**
+ * Worker thread function.
+ * @param stripe Stripe number.
+ * @param seen Generation when the thread was started.
+ */
+void StripeExecutorPrivate::worker(int stripe, unsigned int seen)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		startCond.wait(lock, [this, seen] { return (generation != seen || quit); });
+		if (quit)
+			break;
+		seen = generation;
+		if (stripe >= stripes) {
+			// Not enough lines for this worker.
+			continue;
+		}
+
+		// Don't hold the lock while processing the stripe.
+		lock.unlock();
+		runStripe(stripe);
+		lock.lock();
+
+		if (--pending == 0) {
+			doneCond.notify_one();
+		}
+	}
+}
+
+/**
+ * Start the worker threads.
+ * @param count Number of threads, including the calling thread.
+ */
+void StripeExecutorPrivate::startWorkers(int count)
+{
+	// NOTE: The threads might not start running until after
+	// the first job is posted, so pass in the current generation.
+	quit = false;
+	for (int i = 1; i < count; i++) {
+		workers.push_back(std::thread(&StripeExecutorPrivate::worker, this, i, generation));
+	}
+}
+
+/**
+ * Stop the worker threads.
+ */
+void StripeExecutorPrivate::stopWorkers(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		quit = true;
+	}
+	startCond.notify_all();
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+/** StripeExecutor **/
+
+/**
+ * Create a stripe executor.
+ * @param threads Number of threads, or 0 for automatic.
+ */
+StripeExecutor::StripeExecutor(int threads)
+	: d(new StripeExecutorPrivate(threads))
+{ }
+
+StripeExecutor::~StripeExecutor()
+{
+	d->stopWorkers();
+	delete d;
+}
+
+/**
+ * Get the shared stripe executor used by the effects.
+ * @return Shared stripe executor.
+ */
+StripeExecutor *StripeExecutor::instance(void)
+{
+	static StripeExecutor executor;
+	return &executor;
+}
+
+/**
+ * Get the number of threads.
+ * This includes the calling thread.
+ * @return Number of threads.
+ */
+int StripeExecutor::threads(void) const
+{
+	return d->threads;
+}
+
+/**
+ * Set the number of threads.
+ * @param threads Number of threads, or 0 for automatic.
+ */
+void StripeExecutor::setThreads(int threads)
+{
+	if (threads <= 0) {
+		threads = StripeExecutorPrivate::autoThreads();
+	} else if (threads > MAX_THREADS) {
+		threads = MAX_THREADS;
+	}
+
+	std::lock_guard<std::mutex> runLock(d->runMtx);
+	if (threads == d->threads)
+		return;
+
+	// The worker threads will be restarted by run().
+	d->stopWorkers();
+	d->threads = threads;
+}
+
+/**
+ * Get the number of stripes run() will use.
+ * @param numLines Number of lines.
+ * @return Number of stripes.
+ */
+int StripeExecutor::stripeCount(int numLines) const
+{
+	int stripes = (numLines / MIN_LINES);
+	if (stripes > d->threads) {
+		stripes = d->threads;
+	} else if (stripes < 1) {
+		stripes = 1;
+	}
+	return stripes;
+}
+
+/**
+ * Process a framebuffer in stripes.
+ * Use this version if the caller needs to know the
+ * stripe boundaries in advance.
+ * @param numLines Number of lines.
+ * @param stripes Number of stripes, from stripeCount().
+ * @param fn Stripe function.
+ */
+void StripeExecutor::run(int numLines, int stripes, const StripeFn &fn)
+{
+	if (stripes > MAX_THREADS) {
+		stripes = MAX_THREADS;
+	}
+	if (stripes <= 1) {
+		// Single-threaded.
+		fn(0, numLines, 0);
+		return;
+	}
+
+	std::lock_guard<std::mutex> runLock(d->runMtx);
+	if ((int)d->workers.size() < stripes - 1) {
+		d->stopWorkers();
+		d->startWorkers(stripes);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(d->mtx);
+		d->fn = &fn;
+		d->numLines = numLines;
+		d->stripes = stripes;
+		d->pending = stripes - 1;
+		d->generation++;
+	}
+	d->startCond.notify_all();
+
+	// Process the first stripe on this thread.
+	d->runStripe(0);
+
+	// Wait for the workers.
+	std::unique_lock<std::mutex> lock(d->mtx);
+	d->doneCond.wait(lock, [this] { return (d->pending == 0); });
+	d->fn = nullptr;
+}
+
+}
@@ -0,0 +1,141 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * StripeExecutor.hpp: Multithreaded framebuffer stripe executor.          *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_UTIL_STRIPEEXECUTOR_HPP__
+#define __LIBGENS_UTIL_STRIPEEXECUTOR_HPP__
+
+// C++ includes.
+#include <functional>
+
+namespace LibGens {
+
+/**
+ * Splits a framebuffer into horizontal stripes
+ * and processes them on a pool of worker threads.
+ *
+ * The calling thread processes the first stripe,
+ * and run() doesn't return until all stripes have
+ * been processed. Calls to run() from multiple
+ * threads are serialized.
+ */
+class StripeExecutorPrivate;
+class StripeExecutor
+{
+	public:
+		/**
+		 * Create a stripe executor.
+		 * @param threads Number of threads, or 0 for automatic.
+		 */
+		explicit StripeExecutor(int threads = 0);
+		~StripeExecutor();
+
+	protected:
+		friend class StripeExecutorPrivate;
+		StripeExecutorPrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		StripeExecutor(const StripeExecutor &);
+		StripeExecutor &operator=(const StripeExecutor &);
+
+	public:
+		/**
+		 * Get the shared stripe executor used by the effects.
+		 * @return Shared stripe executor.
+		 */
+		static StripeExecutor *instance(void);
+
+		// Maximum number of threads.
+		static const int MAX_THREADS = 8;
+
+		// Minimum number of lines per stripe.
+		// Smaller stripes aren't worth the thread overhead.
+		static const int MIN_LINES = 16;
+
+		/**
+		 * Get the number of threads.
+		 * This includes the calling thread.
+		 * @return Number of threads.
+		 */
+		int threads(void) const;
+
+		/**
+		 * Set the number of threads.
+		 * @param threads Number of threads, or 0 for automatic.
+		 */
+		void setThreads(int threads);
+
+		/**
+		 * Get the number of stripes run() will use.
+		 * @param numLines Number of lines.
+		 * @return Number of stripes.
+		 */
+		int stripeCount(int numLines) const;
+
+		/**
+		 * Get the first line of a stripe.
+		 * @param numLines Number of lines.
+		 * @param stripes Number of stripes.
+		 * @param stripe Stripe number.
+		 * @return First line of the stripe.
+		 */
+		static inline int stripeStart(int numLines, int stripes, int stripe)
+			{ return ((numLines * stripe) / stripes); }
+
+		/**
+		 * Stripe function.
+		 * @param first First line in the stripe.
+		 * @param count Number of lines in the stripe.
+		 * @param stripe Stripe number.
+		 */
+		typedef std::function<void(int first, int count, int stripe)> StripeFn;
+
+		/**
+		 * Process a framebuffer in stripes.
+		 * @param numLines Number of lines.
+		 * @param fn Stripe function.
+		 */
+		inline void run(int numLines, const StripeFn &fn);
+
+		/**
+		 * Process a framebuffer in stripes.
+		 * Use this version if the caller needs to know the
+		 * stripe boundaries in advance.
+		 * @param numLines Number of lines.
+		 * @param stripes Number of stripes, from stripeCount().
+		 * @param fn Stripe function.
+		 */
+		void run(int numLines, int stripes, const StripeFn &fn);
+};
+
+/**
+ * Process a framebuffer in stripes.
+ * @param numLines Number of lines.
+ * @param fn Stripe function.
+ */
+inline void StripeExecutor::run(int numLines, const StripeFn &fn)
+{
+	run(numLines, stripeCount(numLines), fn);
+}
+
+}
+
+#endif /* __LIBGENS_UTIL_STRIPEEXECUTOR_HPP__ */
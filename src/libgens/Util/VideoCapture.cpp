@@ -0,0 +1,1010 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * VideoCapture.cpp: Lossless video capture. (ZMBV AVI)                    *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "VideoCapture.hpp"
+#include "MdFb.hpp"
+
+#include "libcompat/byteswap.h"
+
+#ifdef _WIN32
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+#include "libcompat/W32U/W32U_mini.h"
+#endif
+
+// zlib
+#include <zlib.h>
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::deque;
+using std::vector;
+
+namespace LibGens {
+
+class VideoCapturePrivate
+{
+	public:
+		VideoCapturePrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		VideoCapturePrivate(const VideoCapturePrivate &);
+		VideoCapturePrivate &operator=(const VideoCapturePrivate &);
+
+	public:
+		FILE *file;
+
+		// Stream parameters.
+		int fpsNum, fpsDen;
+		int audioRate;
+		int channels;
+		int width, height;
+
+		// Queued video frame or audio segment.
+		struct Item {
+			// Video frame, or nullptr for audio.
+			// This is a pooled frame with an extra reference.
+			MdFb *fb;
+			vector<int16_t> audio;
+
+			// Frames dropped before this item.
+			unsigned int dropsBefore;
+			// Audio sample frames dropped before this item.
+			unsigned int silenceBefore;
+		};
+
+		// Queue and frame pool. Protected by mtx.
+		mutable std::mutex mtx;
+		std::condition_variable cond;	// New item, or quit.
+		deque<Item> queue;
+		vector<MdFb*> pool;		// All pooled frames.
+		vector<MdFb*> freeFrames;	// Pooled frames not in the queue.
+		unsigned int pendingDrops;	// Frames dropped since the last item.
+		unsigned int pendingSilence;	// Sample frames dropped since the last item.
+		unsigned int audioQueued;	// Sample frames in the queue.
+		unsigned int audioMax;		// Maximum sample frames in the queue.
+		unsigned int captured;
+		unsigned int dropped;
+		bool quit;
+
+		// Encoder thread.
+		std::thread thread;
+
+		/**
+		 * Encoder thread function.
+		 */
+		void run(void);
+
+		/** Encoder state. Only used by the encoder thread. **/
+
+		// ZMBV parameters.
+		static const int BLOCK_W = 16;
+		static const int BLOCK_H = 16;
+		static const int KEYFRAME_INTERVAL = 300;
+
+		z_stream zs;
+		vector<uint32_t> cur;	// Current frame. (xRGB32)
+		vector<uint32_t> prev;	// Previous frame. (xRGB32)
+		vector<uint8_t> work;	// Uncompressed frame data.
+		vector<uint8_t> out;	// Compressed frame data.
+		int keyframeCountdown;
+
+		// AVI index entry.
+		struct IndexEntry {
+			uint32_t fourcc;
+			uint32_t flags;
+			uint32_t offset;
+			uint32_t size;
+		};
+		vector<IndexEntry> index;
+		uint32_t moviSize;	// Includes the 'movi' list type.
+		uint32_t maxChunk;
+		uint32_t totalFrames;
+		uint32_t totalSamples;
+		std::atomic<int> err;	// First write error.
+
+		// File size limit.
+		// AVI 1.0 uses 32-bit sizes and offsets, so files
+		// can't be larger than 4 GB. (OpenDML isn't supported.)
+		// If a chunk would exceed the limit, it's not written,
+		// and err is set to -EFBIG.
+		static const uint64_t MAX_FILE_SIZE = 0xFFFFFFFFULL;
+		uint64_t maxFileSize;	// Set by the caller.
+		uint64_t sizeLimit;	// Used by the encoder thread.
+		uint32_t hdrSize;	// Size of the AVI headers.
+
+		/**
+		 * Convert a frame to xRGB32.
+		 * @param fb Frame.
+		 */
+		void convertFrame(const MdFb *fb);
+
+		/**
+		 * Encode the current frame and write it to the file.
+		 */
+		void encodeFrame(void);
+
+		/**
+		 * Write audio samples to the file.
+		 * @param samples Samples, or nullptr for silence.
+		 * @param count Number of sample frames.
+		 */
+		void writeAudio(const int16_t *samples, unsigned int count);
+
+		/**
+		 * Write a chunk to the 'movi' list.
+		 * @param fourcc Chunk ID.
+		 * @param data Chunk data.
+		 * @param size Chunk size.
+		 * @param flags idx1 flags.
+		 * @return True if the chunk was written; false if the file is full or an error occurred.
+		 */
+		bool writeChunk(const char *fourcc, const void *data, uint32_t size, uint32_t flags);
+
+		/**
+		 * Write data to the file.
+		 * The first write error is saved in err.
+		 * @param data Data.
+		 * @param size Size.
+		 */
+		void writeData(const void *data, size_t size);
+
+		/**
+		 * Build the AVI headers, up to and including the 'movi' list header.
+		 * The headers are always the same size, so they're written
+		 * once with placeholder values in open() and again in close().
+		 * @param buf [out] Header buffer.
+		 */
+		void buildHeaders(vector<uint8_t> &buf) const;
+};
+
+VideoCapturePrivate::VideoCapturePrivate()
+	: file(nullptr)
+	, fpsNum(60), fpsDen(1)
+	, audioRate(0)
+	, channels(2)
+	, width(0), height(0)
+	, pendingDrops(0)
+	, pendingSilence(0)
+	, audioQueued(0)
+	, audioMax(0)
+	, captured(0)
+	, dropped(0)
+	, quit(false)
+	, keyframeCountdown(0)
+	, moviSize(4)
+	, maxChunk(0)
+	, totalFrames(0)
+	, totalSamples(0)
+	, err(0)
+	, maxFileSize(MAX_FILE_SIZE)
+	, sizeLimit(MAX_FILE_SIZE)
+	, hdrSize(0)
+{
+	memset(&zs, 0, sizeof(zs));
+}
+
+/**
+ * Encoder thread function.
+ */
+void VideoCapturePrivate::run(void)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		cond.wait(lock, [this] { return (!queue.empty() || quit); });
+		if (queue.empty()) {
+			// No more items, and we've been told to quit.
+			break;
+		}
+
+		Item item;
+		item.fb = queue.front().fb;
+		item.audio.swap(queue.front().audio);
+		item.dropsBefore = queue.front().dropsBefore;
+		item.silenceBefore = queue.front().silenceBefore;
+		queue.pop_front();
+
+		// Don't hold the lock while encoding.
+		lock.unlock();
+
+		// Dropped frames are written as empty chunks,
+		// which are treated as duplicates of the previous
+		// frame. Dropped audio is written as silence.
+		for (unsigned int i = item.dropsBefore; i > 0; i--) {
+			if (writeChunk("00dc", nullptr, 0, 0))
+				totalFrames++;
+		}
+		if (item.silenceBefore > 0) {
+			writeAudio(nullptr, item.silenceBefore);
+		}
+
+		if (item.fb) {
+			convertFrame(item.fb);
+			encodeFrame();
+		} else {
+			writeAudio(item.audio.data(), (unsigned int)(item.audio.size() / channels));
+		}
+
+		lock.lock();
+		if (item.fb) {
+			// Return the frame to the pool.
+			item.fb->unref();
+			freeFrames.push_back(item.fb);
+		} else {
+			audioQueued -= (unsigned int)(item.audio.size() / channels);
+		}
+	}
+
+	// Write anything that was dropped after the last item.
+	const unsigned int drops = pendingDrops;
+	const unsigned int silence = pendingSilence;
+	pendingDrops = 0;
+	pendingSilence = 0;
+	lock.unlock();
+
+	for (unsigned int i = drops; i > 0; i--) {
+		if (writeChunk("00dc", nullptr, 0, 0))
+			totalFrames++;
+	}
+	if (silence > 0) {
+		writeAudio(nullptr, silence);
+	}
+}
+
+/**
+ * Convert a frame to xRGB32.
+ * @param fb Frame.
+ */
+void VideoCapturePrivate::convertFrame(const MdFb *fb)
+{
+	fb->resolve();
+
+	uint32_t *dest = cur.data();
+	switch (fb->bpp()) {
+		case MdFb::BPP_15:
+			for (int y = 0; y < height; y++) {
+				const uint16_t *src = fb->lineBuf16(y);
+				for (int x = 0; x < width; x++, src++, dest++) {
+					const unsigned int r = (*src >> 10) & 0x1F;
+					const unsigned int g = (*src >> 5) & 0x1F;
+					const unsigned int b = *src & 0x1F;
+					*dest = (((r << 3) | (r >> 2)) << 16) |
+						(((g << 3) | (g >> 2)) << 8) |
+						((b << 3) | (b >> 2));
+				}
+			}
+			break;
+
+		case MdFb::BPP_16:
+			for (int y = 0; y < height; y++) {
+				const uint16_t *src = fb->lineBuf16(y);
+				for (int x = 0; x < width; x++, src++, dest++) {
+					const unsigned int r = (*src >> 11) & 0x1F;
+					const unsigned int g = (*src >> 5) & 0x3F;
+					const unsigned int b = *src & 0x1F;
+					*dest = (((r << 3) | (r >> 2)) << 16) |
+						(((g << 2) | (g >> 4)) << 8) |
+						((b << 3) | (b >> 2));
+				}
+			}
+			break;
+
+		case MdFb::BPP_32:
+		default:
+			for (int y = 0; y < height; y++, dest += width) {
+				const uint32_t *src = fb->lineBuf32(y);
+				for (int x = 0; x < width; x++) {
+					dest[x] = (src[x] & 0xFFFFFF);
+				}
+			}
+			break;
+	}
+}
+
+/**
+ * Encode the current frame and write it to the file.
+ */
+void VideoCapturePrivate::encodeFrame(void)
+{
+	const bool keyframe = (keyframeCountdown <= 0);
+	uint8_t hdr[7];
+	unsigned int hdrSize;
+
+	work.clear();
+	if (keyframe) {
+		// Keyframe: the whole image.
+		// The deflate stream restarts on each keyframe.
+		hdr[0] = 0x01;		// ZMBV_KEYFRAME
+		hdr[1] = 0;		// Major version.
+		hdr[2] = 1;		// Minor version.
+		hdr[3] = 1;		// Compression: zlib
+		hdr[4] = 8;		// Format: 32bpp
+		hdr[5] = BLOCK_W;
+		hdr[6] = BLOCK_H;
+		hdrSize = 7;
+		deflateReset(&zs);
+
+		work.resize(cur.size() * 4);
+		memcpy(work.data(), cur.data(), work.size());
+		keyframeCountdown = KEYFRAME_INTERVAL;
+	} else {
+		// Delta frame: one motion vector per block,
+		// followed by XOR data for changed blocks.
+		// Motion vectors are always zero; the low bit
+		// of the X vector indicates that XOR data is present.
+		hdr[0] = 0x00;
+		hdrSize = 1;
+
+		const int bx = (width + BLOCK_W - 1) / BLOCK_W;
+		const int by = (height + BLOCK_H - 1) / BLOCK_H;
+		work.resize(((bx * by * 2) + 3) & ~3, 0);
+
+		int block = 0;
+		for (int y = 0; y < height; y += BLOCK_H) {
+			const int bh = (height - y < BLOCK_H ? height - y : BLOCK_H);
+			for (int x = 0; x < width; x += BLOCK_W, block++) {
+				const int bw = (width - x < BLOCK_W ? width - x : BLOCK_W);
+				const uint32_t *c = &cur[(y * width) + x];
+				const uint32_t *p = &prev[(y * width) + x];
+
+				bool changed = false;
+				for (int i = 0; i < bh && !changed; i++) {
+					changed = (memcmp(&c[i * width], &p[i * width], bw * 4) != 0);
+				}
+				if (!changed)
+					continue;
+
+				work[block * 2] = 1;
+				for (int i = 0; i < bh; i++) {
+					const size_t pos = work.size();
+					work.resize(pos + (bw * 4));
+					uint32_t *xorData = reinterpret_cast<uint32_t*>(&work[pos]);
+					for (int j = 0; j < bw; j++) {
+						xorData[j] = c[(i * width) + j] ^ p[(i * width) + j];
+					}
+				}
+			}
+		}
+	}
+	keyframeCountdown--;
+
+#if SYS_BYTEORDER == SYS_BIG_ENDIAN
+	// Pixel data is little-endian.
+	// (The motion vectors are bytes, and the pixel
+	// data after them is always 32-bit aligned.)
+	if (keyframe) {
+		cpu_to_le32_array(reinterpret_cast<uint32_t*>(work.data()), work.size());
+	} else {
+		const size_t vecSize = ((((width + BLOCK_W - 1) / BLOCK_W) *
+					 ((height + BLOCK_H - 1) / BLOCK_H) * 2) + 3) & ~3;
+		cpu_to_le32_array(reinterpret_cast<uint32_t*>(&work[vecSize]), work.size() - vecSize);
+	}
+#endif
+
+	// Compress the frame.
+	// Z_SYNC_FLUSH ends each frame on a byte boundary
+	// without resetting the dictionary.
+	out.resize(hdrSize + deflateBound(&zs, (uLong)work.size()) + 16);
+	memcpy(out.data(), hdr, hdrSize);
+	zs.next_in = work.data();
+	zs.avail_in = (uInt)work.size();
+	zs.next_out = &out[hdrSize];
+	zs.avail_out = (uInt)(out.size() - hdrSize);
+	while (true) {
+		int ret = deflate(&zs, Z_SYNC_FLUSH);
+		if (ret != Z_OK && ret != Z_BUF_ERROR) {
+			if (err == 0)
+				err = -EIO;
+			return;
+		}
+		if (zs.avail_out != 0)
+			break;
+
+		// Output buffer is full.
+		const size_t pos = out.size();
+		out.resize(pos * 2);
+		zs.next_out = &out[pos];
+		zs.avail_out = (uInt)(out.size() - pos);
+	}
+
+	const uint32_t size = (uint32_t)(out.size() - zs.avail_out);
+	if (writeChunk("00dc", out.data(), size, (keyframe ? 0x10 : 0)))	// AVIIF_KEYFRAME
+		totalFrames++;
+	cur.swap(prev);
+}
+
+/**
+ * Write audio samples to the file.
+ * @param samples Samples, or nullptr for silence.
+ * @param count Number of sample frames.
+ */
+void VideoCapturePrivate::writeAudio(const int16_t *samples, unsigned int count)
+{
+	if (audioRate <= 0 || count == 0)
+		return;
+
+	const size_t n = count * channels;
+	vector<int16_t> buf;
+	if (samples) {
+		buf.assign(samples, samples + n);
+		cpu_to_le16_array(reinterpret_cast<uint16_t*>(buf.data()), n * sizeof(int16_t));
+	} else {
+		buf.assign(n, 0);
+	}
+	if (writeChunk("01wb", buf.data(), (uint32_t)(n * sizeof(int16_t)), 0x10))
+		totalSamples += count;
+}
+
+/**
+ * Write a chunk to the 'movi' list.
+ * @param fourcc Chunk ID.
+ * @param data Chunk data.
+ * @param size Chunk size.
+ * @param flags idx1 flags.
+ * @return True if the chunk was written; false if the file is full or an error occurred.
+ */
+bool VideoCapturePrivate::writeChunk(const char *fourcc, const void *data, uint32_t size, uint32_t flags)
+{
+	if (err != 0) {
+		// The file is full, or a write error occurred.
+		return false;
+	}
+
+	// Make sure the file will fit within the size limit
+	// with this chunk and its index entry.
+	// File: headers (including the 'movi' list type),
+	// 'movi' chunks, and the idx1 chunk.
+	const uint64_t fileSize = (uint64_t)hdrSize + (moviSize - 4) +
+		8 + size + (size & 1) +
+		8 + ((uint64_t)(index.size() + 1) * 16);
+	if (fileSize > sizeLimit) {
+		// File size limit reached.
+		err = -EFBIG;
+		return false;
+	}
+
+	IndexEntry entry;
+	memcpy(&entry.fourcc, fourcc, 4);
+	entry.flags = flags;
+	entry.offset = moviSize;
+	entry.size = size;
+	index.push_back(entry);
+
+	const uint8_t chunkHdr[8] = {
+		(uint8_t)fourcc[0], (uint8_t)fourcc[1],
+		(uint8_t)fourcc[2], (uint8_t)fourcc[3],
+		(uint8_t)(size & 0xFF), (uint8_t)((size >> 8) & 0xFF),
+		(uint8_t)((size >> 16) & 0xFF), (uint8_t)(size >> 24)
+	};
+	writeData(chunkHdr, sizeof(chunkHdr));
+	if (size > 0) {
+		writeData(data, size);
+	}
+	moviSize += 8 + size;
+	if (size & 1) {
+		// Chunks are padded to 16-bit boundaries.
+		const uint8_t pad = 0;
+		writeData(&pad, 1);
+		moviSize++;
+	}
+
+	if (size > maxChunk) {
+		maxChunk = size;
+	}
+	return true;
+}
+
+/**
+ * Write data to the file.
+ * The first write error is saved in err.
+ * @param data Data.
+ * @param size Size.
+ */
+void VideoCapturePrivate::writeData(const void *data, size_t size)
+{
+	errno = 0;
+	if (fwrite(data, 1, size, file) != size && err == 0) {
+		err = (errno != 0 ? -errno : -EIO);
+	}
+}
+
+/**
+ * Append a little-endian 16-bit value.
+ * @param buf Buffer.
+ * @param val Value.
+ */
+static inline void put16(vector<uint8_t> &buf, uint16_t val)
+{
+	buf.push_back(val & 0xFF);
+	buf.push_back(val >> 8);
+}
+
+/**
+ * Append a little-endian 32-bit value.
+ * @param buf Buffer.
+ * @param val Value.
+ */
+static inline void put32(vector<uint8_t> &buf, uint32_t val)
+{
+	put16(buf, val & 0xFFFF);
+	put16(buf, val >> 16);
+}
+
+/**
+ * Append a FourCC.
+ * @param buf Buffer.
+ * @param fourcc FourCC.
+ */
+static inline void putFourCC(vector<uint8_t> &buf, const char *fourcc)
+{
+	buf.insert(buf.end(), fourcc, fourcc + 4);
+}
+
+/**
+ * Start a RIFF list or chunk.
+ * @param buf Buffer.
+ * @param fourcc List or chunk ID.
+ * @return Position of the size field.
+ */
+static inline size_t beginChunk(vector<uint8_t> &buf, const char *fourcc)
+{
+	putFourCC(buf, fourcc);
+	const size_t pos = buf.size();
+	put32(buf, 0);
+	return pos;
+}
+
+/**
+ * Finish a RIFF list or chunk.
+ * @param buf Buffer.
+ * @param pos Position of the size field.
+ */
+static inline void endChunk(vector<uint8_t> &buf, size_t pos)
+{
+	const uint32_t size = (uint32_t)(buf.size() - pos - 4);
+	buf[pos+0] = size & 0xFF;
+	buf[pos+1] = (size >> 8) & 0xFF;
+	buf[pos+2] = (size >> 16) & 0xFF;
+	buf[pos+3] = size >> 24;
+}
+
+/**
+ * Build the AVI headers, up to and including the 'movi' list header.
+ * The headers are always the same size, so they're written
+ * once with placeholder values in open() and again in close().
+ * @param buf [out] Header buffer.
+ */
+void VideoCapturePrivate::buildHeaders(vector<uint8_t> &buf) const
+{
+	const int streams = (audioRate > 0 ? 2 : 1);
+	const uint32_t blockAlign = channels * sizeof(int16_t);
+	const uint32_t idxSize = (uint32_t)(8 + (index.size() * 16));
+
+	buf.clear();
+	putFourCC(buf, "RIFF");
+	put32(buf, 0);	// Filled in below.
+	putFourCC(buf, "AVI ");
+
+	const size_t hdrl = beginChunk(buf, "LIST");
+	putFourCC(buf, "hdrl");
+
+	// Main AVI header.
+	size_t pos = beginChunk(buf, "avih");
+	put32(buf, (uint32_t)((1000000ULL * fpsDen) / fpsNum));	// dwMicroSecPerFrame
+	put32(buf, 0);			// dwMaxBytesPerSec
+	put32(buf, 0);			// dwPaddingGranularity
+	put32(buf, 0x10 | 0x100);	// dwFlags: AVIF_HASINDEX | AVIF_ISINTERLEAVED
+	put32(buf, totalFrames);	// dwTotalFrames
+	put32(buf, 0);			// dwInitialFrames
+	put32(buf, streams);		// dwStreams
+	put32(buf, maxChunk + 8);	// dwSuggestedBufferSize
+	put32(buf, width);		// dwWidth
+	put32(buf, height);		// dwHeight
+	for (int i = 0; i < 4; i++) {
+		put32(buf, 0);		// dwReserved
+	}
+	endChunk(buf, pos);
+
+	// Video stream.
+	size_t strl = beginChunk(buf, "LIST");
+	putFourCC(buf, "strl");
+	pos = beginChunk(buf, "strh");
+	putFourCC(buf, "vids");		// fccType
+	putFourCC(buf, "ZMBV");		// fccHandler
+	put32(buf, 0);			// dwFlags
+	put32(buf, 0);			// wPriority, wLanguage
+	put32(buf, 0);			// dwInitialFrames
+	put32(buf, fpsDen);		// dwScale
+	put32(buf, fpsNum);		// dwRate
+	put32(buf, 0);			// dwStart
+	put32(buf, totalFrames);	// dwLength
+	put32(buf, maxChunk + 8);	// dwSuggestedBufferSize
+	put32(buf, 0xFFFFFFFF);		// dwQuality
+	put32(buf, 0);			// dwSampleSize
+	put16(buf, 0); put16(buf, 0);	// rcFrame
+	put16(buf, width); put16(buf, height);
+	endChunk(buf, pos);
+	pos = beginChunk(buf, "strf");
+	put32(buf, 40);			// biSize
+	put32(buf, width);		// biWidth
+	put32(buf, height);		// biHeight
+	put16(buf, 1);			// biPlanes
+	put16(buf, 32);			// biBitCount
+	putFourCC(buf, "ZMBV");		// biCompression
+	put32(buf, width * height * 4);	// biSizeImage
+	for (int i = 0; i < 4; i++) {
+		put32(buf, 0);		// Resolution and palette.
+	}
+	endChunk(buf, pos);
+	endChunk(buf, strl);
+
+	if (audioRate > 0) {
+		// Audio stream.
+		strl = beginChunk(buf, "LIST");
+		putFourCC(buf, "strl");
+		pos = beginChunk(buf, "strh");
+		putFourCC(buf, "auds");		// fccType
+		put32(buf, 0);			// fccHandler
+		put32(buf, 0);			// dwFlags
+		put32(buf, 0);			// wPriority, wLanguage
+		put32(buf, 0);			// dwInitialFrames
+		put32(buf, blockAlign);		// dwScale
+		put32(buf, audioRate * blockAlign);	// dwRate
+		put32(buf, 0);			// dwStart
+		put32(buf, totalSamples);	// dwLength
+		put32(buf, 0);			// dwSuggestedBufferSize
+		put32(buf, 0xFFFFFFFF);		// dwQuality
+		put32(buf, blockAlign);		// dwSampleSize
+		put32(buf, 0); put32(buf, 0);	// rcFrame
+		endChunk(buf, pos);
+		pos = beginChunk(buf, "strf");
+		put16(buf, 1);			// wFormatTag: WAVE_FORMAT_PCM
+		put16(buf, channels);		// nChannels
+		put32(buf, audioRate);		// nSamplesPerSec
+		put32(buf, audioRate * blockAlign);	// nAvgBytesPerSec
+		put16(buf, blockAlign);		// nBlockAlign
+		put16(buf, 16);			// wBitsPerSample
+		endChunk(buf, pos);
+		endChunk(buf, strl);
+	}
+	endChunk(buf, hdrl);
+
+	// 'movi' list header.
+	// The list contents are written by the encoder thread.
+	putFourCC(buf, "LIST");
+	put32(buf, moviSize);
+	putFourCC(buf, "movi");
+
+	// RIFF size: headers, 'movi' list, and index.
+	const uint32_t riffSize = (uint32_t)(buf.size() - 8 - 4 + moviSize + idxSize);
+	buf[4] = riffSize & 0xFF;
+	buf[5] = (riffSize >> 8) & 0xFF;
+	buf[6] = (riffSize >> 16) & 0xFF;
+	buf[7] = riffSize >> 24;
+}
+
+/** VideoCapture **/
+
+VideoCapture::VideoCapture()
+	: d(new VideoCapturePrivate())
+{ }
+
+VideoCapture::~VideoCapture()
+{
+	close();
+	delete d;
+}
+
+/**
+ * Start a capture.
+ *
+ * Video is encoded as 32-bit ZMBV (zlib-compressed
+ * frame deltas), and audio is stored as 16-bit PCM.
+ * Encoding and file writes are done on a background
+ * thread, so pushFrame() and pushAudio() never block
+ * on the encoder.
+ *
+ * @param filename	[in] AVI file. (UTF-8)
+ * @param fpsNum	[in] Frame rate numerator.
+ * @param fpsDen	[in] Frame rate denominator.
+ * @param audioRate	[in] Audio sample rate. (0 for no audio)
+ * @param channels	[in] Number of audio channels. (1 or 2)
+ * @return 0 on success; negative errno on error.
+ */
+int VideoCapture::open(const char *filename, int fpsNum, int fpsDen,
+		       int audioRate, int channels)
+{
+	if (fpsNum <= 0 || fpsDen <= 0 || audioRate < 0 ||
+	    (channels != 1 && channels != 2))
+	{
+		return -EINVAL;
+	}
+
+	close();
+
+	errno = 0;
+	d->file = fopen(filename, "wb");
+	if (!d->file) {
+		return (errno != 0 ? -errno : -EIO);
+	}
+
+	if (deflateInit(&d->zs, Z_DEFAULT_COMPRESSION) != Z_OK) {
+		fclose(d->file);
+		d->file = nullptr;
+		return -ENOMEM;
+	}
+
+	d->fpsNum = fpsNum;
+	d->fpsDen = fpsDen;
+	d->audioRate = audioRate;
+	d->channels = channels;
+
+	// Allocate the frame pool.
+	// The pool holds one reference to each frame.
+	d->pool.clear();
+	for (int i = 0; i < FRAME_POOL_SIZE; i++) {
+		d->pool.push_back(new MdFb());
+	}
+	d->freeFrames = d->pool;
+	d->width = d->pool[0]->pxPerLine();
+	d->height = d->pool[0]->numLines();
+	d->cur.assign(d->width * d->height, 0);
+	d->prev.assign(d->width * d->height, 0);
+
+	// Allow up to one second of queued audio.
+	d->audioMax = audioRate;
+	d->audioQueued = 0;
+	d->pendingDrops = 0;
+	d->pendingSilence = 0;
+	d->captured = 0;
+	d->dropped = 0;
+	d->quit = false;
+
+	d->keyframeCountdown = 0;
+	d->index.clear();
+	d->moviSize = 4;
+	d->maxChunk = 0;
+	d->totalFrames = 0;
+	d->totalSamples = 0;
+	d->err = 0;
+	d->sizeLimit = d->maxFileSize;
+
+	// Write placeholder headers.
+	// They're rewritten with the final values in close().
+	vector<uint8_t> hdr;
+	d->buildHeaders(hdr);
+	d->hdrSize = (uint32_t)hdr.size();
+	d->writeData(hdr.data(), hdr.size());
+
+	d->thread = std::thread(&VideoCapturePrivate::run, d);
+	return 0;
+}
+
+/**
+ * Stop the capture.
+ * This waits for the encoder to finish all queued frames.
+ * @return 0 on success; negative errno on error.
+ */
+int VideoCapture::close(void)
+{
+	if (!d->file)
+		return 0;
+
+	// Finish encoding all queued frames.
+	{
+		std::lock_guard<std::mutex> lock(d->mtx);
+		d->quit = true;
+	}
+	d->cond.notify_one();
+	d->thread.join();
+
+	// Write the index.
+	vector<uint8_t> buf;
+	buf.reserve(8 + (d->index.size() * 16));
+	putFourCC(buf, "idx1");
+	put32(buf, (uint32_t)(d->index.size() * 16));
+	for (size_t i = 0; i < d->index.size(); i++) {
+		const VideoCapturePrivate::IndexEntry &entry = d->index[i];
+		buf.insert(buf.end(), (const uint8_t*)&entry.fourcc,
+			   (const uint8_t*)&entry.fourcc + 4);
+		put32(buf, entry.flags);
+		put32(buf, entry.offset);
+		put32(buf, entry.size);
+	}
+	d->writeData(buf.data(), buf.size());
+
+	// Rewrite the headers with the final values.
+	d->buildHeaders(buf);
+	if (fseek(d->file, 0, SEEK_SET) != 0 && d->err == 0) {
+		d->err = (errno != 0 ? -errno : -EIO);
+	}
+	d->writeData(buf.data(), buf.size());
+
+	if (fclose(d->file) != 0 && d->err == 0) {
+		d->err = (errno != 0 ? -errno : -EIO);
+	}
+	d->file = nullptr;
+	deflateEnd(&d->zs);
+
+	// Release the frame pool.
+	for (size_t i = 0; i < d->pool.size(); i++) {
+		d->pool[i]->unref();
+	}
+	d->pool.clear();
+	d->freeFrames.clear();
+	d->index.clear();
+	return d->err;
+}
+
+/**
+ * Is a capture in progress?
+ * @return True if a capture is in progress.
+ */
+bool VideoCapture::isOpen(void) const
+{
+	return (d->file != nullptr);
+}
+
+/**
+ * Add a video frame.
+ *
+ * The frame is copied into a pooled MdFb, which is
+ * referenced while it's waiting for the encoder.
+ * If all pooled frames are in use, the frame is
+ * dropped, and an empty frame will be written in
+ * its place to keep audio and video in sync.
+ *
+ * @param fb Frame to add.
+ * @return True if the frame was queued; false if it was dropped.
+ */
+bool VideoCapture::pushFrame(const MdFb *fb)
+{
+	if (!d->file)
+		return false;
+
+	MdFb *frame;
+	{
+		std::lock_guard<std::mutex> lock(d->mtx);
+		if (d->freeFrames.empty()) {
+			// Encoder can't keep up.
+			d->pendingDrops++;
+			d->dropped++;
+			return false;
+		}
+		frame = d->freeFrames.back();
+		d->freeFrames.pop_back();
+	}
+
+	// The frame isn't in the queue, so it
+	// can be copied without holding the lock.
+	frame->copyFrom(fb);
+
+	VideoCapturePrivate::Item item;
+	item.fb = frame->ref();
+	item.silenceBefore = 0;
+	{
+		std::lock_guard<std::mutex> lock(d->mtx);
+		item.dropsBefore = d->pendingDrops;
+		item.silenceBefore = d->pendingSilence;
+		d->pendingDrops = 0;
+		d->pendingSilence = 0;
+		d->captured++;
+		d->queue.push_back(item);
+	}
+	d->cond.notify_one();
+	return true;
+}
+
+/**
+ * Add audio samples.
+ * If too much audio is waiting for the encoder,
+ * the samples are dropped and replaced with silence.
+ * @param samples	[in] Samples. (interleaved if stereo)
+ * @param count		[in] Number of sample frames.
+ * @return True if the samples were queued; false if they were dropped.
+ */
+bool VideoCapture::pushAudio(const int16_t *samples, int count)
+{
+	if (!d->file || d->audioRate <= 0 || count <= 0)
+		return false;
+
+	VideoCapturePrivate::Item item;
+	item.fb = nullptr;
+	item.audio.assign(samples, samples + (count * d->channels));
+	{
+		std::lock_guard<std::mutex> lock(d->mtx);
+		if (d->audioQueued + count > d->audioMax) {
+			// Encoder can't keep up.
+			d->pendingSilence += count;
+			return false;
+		}
+		item.dropsBefore = d->pendingDrops;
+		item.silenceBefore = d->pendingSilence;
+		d->pendingDrops = 0;
+		d->pendingSilence = 0;
+		d->audioQueued += count;
+		d->queue.push_back(std::move(item));
+	}
+	d->cond.notify_one();
+	return true;
+}
+
+/**
+ * Get the capture error.
+ * If the file size limit is reached, nothing else
+ * is written, and this returns -EFBIG. The capture
+ * should be stopped with close().
+ * @return 0 if no error occurred; negative errno on error.
+ */
+int VideoCapture::error(void) const
+{
+	return d->err;
+}
+
+/**
+ * Set the maximum file size.
+ * This must be called before open().
+ * Sizes larger than the AVI 1.0 limit of 4 GB are clamped.
+ * @param size Maximum file size, in bytes.
+ */
+void VideoCapture::setMaxFileSize(uint64_t size)
+{
+	assert(!d->file);
+	if (size > VideoCapturePrivate::MAX_FILE_SIZE) {
+		size = VideoCapturePrivate::MAX_FILE_SIZE;
+	}
+	d->maxFileSize = size;
+}
+
+/**
+ * Get the number of frames queued since open().
+ * @return Number of frames queued.
+ */
+unsigned int VideoCapture::framesCaptured(void) const
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	return d->captured;
+}
+
+/**
+ * Get the number of frames dropped since open().
+ * @return Number of frames dropped.
+ */
+unsigned int VideoCapture::framesDropped(void) const
+{
+	std::lock_guard<std::mutex> lock(d->mtx);
+	return d->dropped;
+}
+
+}
@@ -0,0 +1,144 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * VideoCapture.hpp: Lossless video capture. (ZMBV AVI)                    *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_UTIL_VIDEOCAPTURE_HPP__
+#define __LIBGENS_UTIL_VIDEOCAPTURE_HPP__
+
+// C includes.
+#include <stdint.h>
+
+namespace LibGens {
+
+class MdFb;
+
+class VideoCapturePrivate;
+class VideoCapture
+{
+	public:
+		VideoCapture();
+		~VideoCapture();
+
+	protected:
+		friend class VideoCapturePrivate;
+		VideoCapturePrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		VideoCapture(const VideoCapture &);
+		VideoCapture &operator=(const VideoCapture &);
+
+	public:
+		/**
+		 * Start a capture.
+		 *
+		 * Video is encoded as 32-bit ZMBV (zlib-compressed
+		 * frame deltas), and audio is stored as 16-bit PCM.
+		 * Encoding and file writes are done on a background
+		 * thread, so pushFrame() and pushAudio() never block
+		 * on the encoder.
+		 *
+		 * @param filename	[in] AVI file. (UTF-8)
+		 * @param fpsNum	[in] Frame rate numerator.
+		 * @param fpsDen	[in] Frame rate denominator.
+		 * @param audioRate	[in] Audio sample rate. (0 for no audio)
+		 * @param channels	[in] Number of audio channels. (1 or 2)
+		 * @return 0 on success; negative errno on error.
+		 */
+		int open(const char *filename, int fpsNum, int fpsDen,
+			 int audioRate, int channels);
+
+		/**
+		 * Stop the capture.
+		 * This waits for the encoder to finish all queued frames.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int close(void);
+
+		/**
+		 * Is a capture in progress?
+		 * @return True if a capture is in progress.
+		 */
+		bool isOpen(void) const;
+
+		/**
+		 * Add a video frame.
+		 *
+		 * The frame is copied into a pooled MdFb, which is
+		 * referenced while it's waiting for the encoder.
+		 * If all pooled frames are in use, the frame is
+		 * dropped, and an empty frame will be written in
+		 * its place to keep audio and video in sync.
+		 *
+		 * @param fb Frame to add.
+		 * @return True if the frame was queued; false if it was dropped.
+		 */
+		bool pushFrame(const MdFb *fb);
+
+		/**
+		 * Add audio samples.
+		 * If too much audio is waiting for the encoder,
+		 * the samples are dropped and replaced with silence.
+		 * @param samples	[in] Samples. (interleaved if stereo)
+		 * @param count		[in] Number of sample frames.
+		 * @return True if the samples were queued; false if they were dropped.
+		 */
+		bool pushAudio(const int16_t *samples, int count);
+
+		/**
+		 * Get the capture error.
+		 * If the file size limit is reached, nothing else
+		 * is written, and this returns -EFBIG. The capture
+		 * should be stopped with close().
+		 * @return 0 if no error occurred; negative errno on error.
+		 */
+		int error(void) const;
+
+		/**
+		 * Set the maximum file size.
+		 * This must be called before open().
+		 * Sizes larger than the AVI 1.0 limit of 4 GB are clamped.
+		 * @param size Maximum file size, in bytes.
+		 */
+		void setMaxFileSize(uint64_t size);
+
+		/**
+		 * Get the number of frames queued since open().
+		 * @return Number of frames queued.
+		 */
+		unsigned int framesCaptured(void) const;
+
+		/**
+		 * Get the number of frames dropped since open().
+		 * @return Number of frames dropped.
+		 */
+		unsigned int framesDropped(void) const;
+
+		/**
+		 * Number of pooled frames.
+		 * This is the maximum number of frames that can
+		 * be waiting for the encoder at once.
+		 */
+		static const int FRAME_POOL_SIZE = 8;
+};
+
+}
+
+#endif /* __LIBGENS_UTIL_VIDEOCAPTURE_HPP__ */
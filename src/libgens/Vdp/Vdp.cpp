@@ -32,6 +32,9 @@
 // ZOMG
 #include "libzomg/Zomg.hpp"
 
+// State hash.
+#include "EmuContext/StateHash.hpp"
+
 // VDP includes.
 #include "VdpPalette.hpp"
 
@@ -276,6 +279,10 @@ void Vdp::updateVdpLines(bool resetCurrent)
 		// Reset VDP_Lines.currentLine.
 		// NOTE: VDP starts at visible line 0.
 		VDP_Lines.currentLine = 0;
+
+		// Palette snapshots from the previous frame
+		// can't be shared with lines in this frame.
+		MD_Screen->beginFrame();
 	}
 
 	// Check interlaced mode.
@@ -437,6 +444,37 @@ void Vdp::zomgSaveMD(LibZomg::Zomg *zomg) const
 	zomg->saveMD_VDP_SAT(vdp_sat, sizeof(vdp_sat), ZOMG_BYTEORDER_16H);
 }
 
+/**
+ * Hash the VDP state. (MD mode)
+ * This hashes the registers, VRam, CRam, and VSRam.
+ * @param hash State hash to update.
+ */
+void Vdp::stateHashMD(StateHash *hash) const
+{
+	// User-accessible registers.
+	// TODO: Move "24" to a const somewhere.
+	hash->set(StateHash::SS_VDP_REG, d->VDP_Reg.reg, 24);
+
+	// Internal registers.
+	// NOTE: Hashed as an array instead of a struct
+	// so padding doesn't affect the hash.
+	const uint32_t ctrl[5] = {
+		d->VDP_Ctrl.ctrl_latch,
+		d->VDP_Ctrl.addr_hi_latch,
+		d->VDP_Ctrl.code,
+		d->VDP_Ctrl.address,
+		d->Reg_Status.read_raw(),
+	};
+	hash->append(StateHash::SS_VDP_REG, ctrl, sizeof(ctrl));
+
+	// VRam, CRam, VSRam.
+	hash->set(StateHash::SS_VRAM, d->VRam.u16, sizeof(d->VRam.u16));
+	Zomg_CRam_t cram;
+	d->palette.zomgSaveCRam(&cram);
+	hash->set(StateHash::SS_CRAM, cram.md, sizeof(cram.md));
+	hash->set(StateHash::SS_VSRAM, d->VSRam.u16, sizeof(d->VSRam.u16));
+}
+
 
 /**
  * Restore the VDP state. (MD mode)
@@ -41,6 +41,7 @@ namespace LibZomg {
 
 namespace LibGens {
 
+class StateHash;
 class VdpPrivate;
 class Vdp
 {
@@ -210,6 +211,13 @@ class Vdp
 		 */
 		void zomgRestoreMD(LibZomg::Zomg *zomg);
 
+		/**
+		 * Hash the VDP state. (MD mode)
+		 * This hashes the registers, VRam, CRam, and VSRam.
+		 * @param hash State hash to update.
+		 */
+		void stateHashMD(StateHash *hash) const;
+
 	public:
 		// TODO: Move to private class.
 		int DMAT_Length;
@@ -28,8 +28,15 @@
 #include <windows.h>
 #endif /* _WIN32 */
 
+// C++ includes.
+#include <atomic>
+
 namespace LibGens {
 
+// Last assigned palette serial number.
+// Shared by all VdpPalette objects.
+static std::atomic<uint32_t> lastSerial(0);
+
 /** VdpPalettePrivate **/
 
 VdpPalettePrivate::VdpPalettePrivate(VdpPalette *q)
@@ -101,6 +108,7 @@ VdpPalette::VdpPalette()
 	// Set the dirty flags.
 	m_dirty.active = true;
 	m_dirty.full = true;
+	nextSerial();
 
 	// Reset CRam and other palette variables.
 	reset();
@@ -114,6 +122,19 @@ VdpPalette::~VdpPalette()
 	// TODO: Other cleanup.
 }
 
+/**
+ * Assign a new serial number to the active palette.
+ */
+void VdpPalette::nextSerial(void)
+{
+	uint32_t serial;
+	do {
+		// Skip 0 if the serial number wraps around.
+		serial = lastSerial.fetch_add(1, std::memory_order_relaxed) + 1;
+	} while (serial == 0);
+	m_serial = serial;
+}
+
 /**
  * Reset the palette, including CRam.
  */
@@ -74,6 +74,16 @@ class VdpPalette
 		 */
 		bool isDirty(void) const;
 
+		/**
+		 * Get the active palette's serial number.
+		 * The serial number changes whenever the active
+		 * palette is recalculated, and it's unique across
+		 * all VdpPalette objects, so it can be used to
+		 * identify snapshots of the active palette.
+		 * @return Active palette serial number. (Never 0.)
+		 */
+		uint32_t serial(void) const;
+
 		/** CRam functions. **/
 
 		/**
@@ -236,6 +246,14 @@ class VdpPalette
 			};
 		} m_dirty;
 
+		// Active palette serial number.
+		uint32_t m_serial;
+
+		/**
+		 * Assign a new serial number to the active palette.
+		 */
+		void nextSerial(void);
+
 		/** Active palette recalculation functions. **/
 
 		template<typename pixel>
@@ -272,6 +290,17 @@ class VdpPalette
 inline bool VdpPalette::isDirty(void) const
 	{ return !!(m_dirty.data); }
 
+/**
+ * Get the active palette's serial number.
+ * The serial number changes whenever the active
+ * palette is recalculated, and it's unique across
+ * all VdpPalette objects, so it can be used to
+ * identify snapshots of the active palette.
+ * @return Active palette serial number. (Never 0.)
+ */
+inline uint32_t VdpPalette::serial(void) const
+	{ return m_serial; }
+
 /** CRam functions. **/
 
 /**
@@ -383,6 +383,7 @@ void VdpPalette::update(void)
 
 	// Clear the active palette dirty bit.
 	m_dirty.active = false;
+	nextSerial();
 }
 
 // TODO: Port to LibGens: T_update_32X()
@@ -406,6 +406,9 @@ void VdpPrivate::renderLine_Err(void)
 	{
 		// VDP mode has changed.
 		// Redraw the color bars and reprint the error message.
+		// The error screen is drawn in RGB, even in indexed color mode.
+		if (q->MD_Screen->isIndexed())
+			q->MD_Screen->clearLinePalettes();
 		switch (palette.bpp()) {
 			case MdFb::BPP_15:
 				d_err->T_DrawColorBars<uint16_t>(q->MD_Screen, VdpRend_Err_Private::ColorBarsPalette_15);
@@ -424,6 +427,9 @@ void VdpPrivate::renderLine_Err(void)
 				break;
 		}
 
+		// The entire screen was redrawn.
+		q->MD_Screen->markAllDirty();
+
 		// Update the borders.
 		updateBorders = true;
 	}
@@ -447,6 +453,7 @@ void VdpPrivate::renderLine_Err(void)
 				d_err->T_DrawColorBars_Border<uint16_t>(q->MD_Screen, (uint16_t)newBorderColor);
 			else
 				d_err->T_DrawColorBars_Border<uint32_t>(q->MD_Screen, newBorderColor);
+			q->MD_Screen->markAllDirty();
 		}
 
 		// Save the new border color.
@@ -1343,6 +1343,68 @@ FORCE_INLINE void VdpPrivate::T_Render_LineBuf(pixel *dest, pixel *md_palette)
 	}
 }
 
+/**
+ * Copy the line buffer's palette indexes to the destination surface.
+ * Used in indexed color mode; the palette itself is stored
+ * separately with MdFb::setLinePalette().
+ * @param dest Destination surface.
+ */
+FORCE_INLINE void VdpPrivate::Render_LineBuf_Indexed(uint8_t *dest)
+{
+	const LineBuf_t::LineBuf_px_t *src = &LineBuf.px[8];
+
+	// Shadow+Highlight indexes (0xC0-0xFF) use the normal
+	// palette, so fold them into 0x00-0x3F. This leaves
+	// MdFb::INDEX_BLACK available for the border.
+	static const uint8_t fold_mask[4] = {0xFF, 0xFF, 0xFF, 0x3F};
+#define INDEX_PX(px) ((px) & fold_mask[(px) >> 6])
+
+	// Render the line buffer to the destination surface.
+	dest += H_Pix_Begin;
+	const uint8_t *dest_end = dest + H_Pix;
+	for (; dest < dest_end; dest += 8, src += 8) {
+		*(dest+0) = INDEX_PX(src->pixel);
+		*(dest+1) = INDEX_PX((src+1)->pixel);
+		*(dest+2) = INDEX_PX((src+2)->pixel);
+		*(dest+3) = INDEX_PX((src+3)->pixel);
+		*(dest+4) = INDEX_PX((src+4)->pixel);
+		*(dest+5) = INDEX_PX((src+5)->pixel);
+		*(dest+6) = INDEX_PX((src+6)->pixel);
+		*(dest+7) = INDEX_PX((src+7)->pixel);
+	}
+#undef INDEX_PX
+
+	if (H_Pix_Begin == 0)
+		return;
+
+	// Draw the borders.
+	// NOTE: S/H is ignored if we're in the border region.
+	const uint8_t border_idx =
+		(q->options.borderColorEmulation ? 0 : MdFb::INDEX_BLACK);
+	dest -= H_Pix;
+	memset(dest - H_Pix_Begin, border_idx, H_Pix_Begin);
+	memset(dest + H_Pix, border_idx, H_Pix_Begin);
+}
+
+/**
+ * Set a line's palette to the active palette. (indexed color)
+ * @param lineNum Line number in MD_Screen.
+ */
+FORCE_INLINE void VdpPrivate::setLinePalette(int lineNum)
+{
+	MdFb *const fb = q->MD_Screen;
+	if (palette.bpp() != fb->bpp()) {
+		// Palette hasn't been converted to the new color depth yet.
+		// The line will be treated as an RGB line until it is.
+		return;
+	}
+
+	if (fb->bpp() != MdFb::BPP_32)
+		fb->setLinePalette(lineNum, palette.m_palActive.u16, palette.serial());
+	else
+		fb->setLinePalette(lineNum, palette.m_palActive.u32, palette.serial());
+}
+
 /**
  * Apply SMS left-column blanking to the destination surface.
  * FIXME: Should not be post-processing...
@@ -1427,13 +1489,18 @@ void VdpPrivate::renderLine_m5(void)
 		// We're in the border area, but border color emulation is disabled.
 		// Clear the border area.
 		// TODO: Only clear this if the option changes or V/H mode changes.
-		if (palette.bpp() != MdFb::BPP_32) {
+		if (q->MD_Screen->isIndexed()) {
+			memset(q->MD_Screen->lineBuf8(lineNum), MdFb::INDEX_BLACK,
+				q->MD_Screen->pxPerLine());
+			setLinePalette(lineNum);
+		} else if (palette.bpp() != MdFb::BPP_32) {
 			memset(q->MD_Screen->lineBuf16(lineNum), 0x00,
 				(q->MD_Screen->pxPerLine() * sizeof(uint16_t)));
 		} else {
 			memset(q->MD_Screen->lineBuf32(lineNum), 0x00,
 				(q->MD_Screen->pxPerLine() * sizeof(uint32_t)));
 		}
+		q->MD_Screen->commitLine(lineNum);
 
 		// ...and we're done here.
 		return;
@@ -1502,7 +1569,18 @@ void VdpPrivate::renderLine_m5(void)
 
 	// Render the image.
 	// TODO: Optimize SMS LCB handling. (maybe use Linux's unlikely() macro?)
-	if (q->MD_Screen->bpp() != MdFb::BPP_32) {
+	if (q->MD_Screen->isIndexed()) {
+		uint8_t *lineBuf8 = q->MD_Screen->lineBuf8(lineNum);
+		Render_LineBuf_Indexed(lineBuf8);
+		setLinePalette(lineNum);
+
+		if (VDP_Reg.m5.Set1 & VDP_REG_M5_SET1_LCB) {
+			// SMS left-column blanking bit is set.
+			// FIXME: Should borderColorEmulation apply here?
+			T_Apply_SMS_LCB<uint8_t>(lineBuf8,
+				(q->options.borderColorEmulation ? 0 : MdFb::INDEX_BLACK));
+		}
+	} else if (q->MD_Screen->bpp() != MdFb::BPP_32) {
 		uint16_t *lineBuf16 = q->MD_Screen->lineBuf16(lineNum);
 		T_Render_LineBuf<uint16_t>(lineBuf16, palette.m_palActive.u16);
 
@@ -1523,6 +1601,9 @@ void VdpPrivate::renderLine_m5(void)
 				(q->options.borderColorEmulation ? palette.m_palActive.u32[0] : 0));
 		}
 	}
+
+	// Check if the line has changed since the last frame.
+	q->MD_Screen->commitLine(lineNum);
 }
 
 // TODO: 32X stuff.
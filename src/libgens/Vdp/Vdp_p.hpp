@@ -584,6 +584,9 @@ class VdpPrivate
 		template<typename pixel>
 		FORCE_INLINE void T_Render_LineBuf(pixel *dest, pixel *md_palette);
 
+		FORCE_INLINE void Render_LineBuf_Indexed(uint8_t *dest);
+		FORCE_INLINE void setLinePalette(int lineNum);
+
 		template<typename pixel>
 		FORCE_INLINE void T_Apply_SMS_LCB(pixel *dest, pixel border_color);
 
@@ -62,6 +62,12 @@
 #include "audio/audio.h"
 #endif
 
+// VGM logging.
+#include "VgmWriter.hpp"
+
+// State hash.
+#include "EmuContext/StateHash.hpp"
+
 namespace LibGens {
 
 /** PsgPrivate **/
@@ -82,6 +88,7 @@ PsgPrivate::PsgPrivate(Psg *q)
 	: q(q)
 	, writeLen(0)
 	, enabled(true)	// TODO: Make this customizable.
+	, vgmWriter(nullptr)
 {
 	// TODO: Move this here?
 	// (It's currently initialized in the Psg constructors.)
@@ -269,10 +276,8 @@ void Psg::reInit(int clock, int rate)
  */
 void Psg::write(uint8_t data)
 {
-#if 0 // TODO: GYM
-	if (GYM_Dumping)
-		gym_dump_update(3, (uint8_t)data, 0);
-#endif
+	if (d->vgmWriter)
+		d->vgmWriter->writePsg(data);
 
 	// TODO: Combine the masking used in both cases.
 	if (data & 0x80) {
@@ -378,6 +383,24 @@ void Psg::zomgSave(Zomg_PsgSave_t *state)
 	state->gg_stereo = 0x00;
 }
 
+/**
+ * Hash the PSG state.
+ * This hashes the registers as well as the
+ * internal counters, volumes, and LFSR.
+ * @param hash State hash to update.
+ */
+void Psg::stateHash(StateHash *hash) const
+{
+	const uint32_t latch[2] = {(uint32_t)d->curChan, (uint32_t)d->curReg};
+	hash->set(StateHash::SS_PSG, latch, sizeof(latch));
+	hash->append(StateHash::SS_PSG, d->reg, sizeof(d->reg));
+	hash->append(StateHash::SS_PSG, d->counter, sizeof(d->counter));
+	hash->append(StateHash::SS_PSG, d->cntStep, sizeof(d->cntStep));
+	hash->append(StateHash::SS_PSG, d->volume, sizeof(d->volume));
+	const uint32_t noise[2] = {d->lfsrMask, d->lfsr};
+	hash->append(StateHash::SS_PSG, noise, sizeof(noise));
+}
+
 /**
  * Restore the PSG state.
  * @param state Zomg_PsgSave_t struct to restore from.
@@ -433,8 +456,8 @@ void Psg::specialUpdate(void)
 	int writePos = SoundMgr::GetWritePos(line_num);
 
 	// Update the PSG buffer pointers.
-	d->bufPtrL = &SoundMgr::ms_SegBufL[writePos];
-	d->bufPtrR = &SoundMgr::ms_SegBufR[writePos];
+	d->bufPtrL = &SoundMgr::ms_RenderBufL[writePos];
+	d->bufPtrR = &SoundMgr::ms_RenderBufR[writePos];
 }
 
 /** PSG write length. **/
@@ -449,13 +472,22 @@ void Psg::clearWriteLen(void)
 	d->writeLen = 0;
 }
 
+/**
+ * Set the VGM writer for register write logging.
+ * @param vgmWriter VGM writer, or nullptr to disable logging.
+ */
+void Psg::setVgmWriter(VgmWriter *vgmWriter)
+{
+	d->vgmWriter = vgmWriter;
+}
+
 /**
  * Reset the PSG buffer pointers.
  */
 void Psg::resetBufferPtrs(void)
 {
-	d->bufPtrL = &SoundMgr::ms_SegBufL[0];
-	d->bufPtrR = &SoundMgr::ms_SegBufR[0];
+	d->bufPtrL = &SoundMgr::ms_RenderBufL[0];
+	d->bufPtrR = &SoundMgr::ms_RenderBufR[0];
 }
 
 // TODO: Eliminate the GSXv7 stuff.
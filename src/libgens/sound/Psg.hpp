@@ -34,6 +34,9 @@ struct _Zomg_PsgSave_t;
 
 namespace LibGens {
 
+class VgmWriter;
+class StateHash;
+
 class PsgPrivate;
 class Psg
 {
@@ -68,6 +71,14 @@ class Psg
 		/** ZOMG savestate functions. **/
 		void zomgSave(_Zomg_PsgSave_t *state);
 		void zomgRestore(const _Zomg_PsgSave_t *state);
+
+		/**
+		 * Hash the PSG state.
+		 * This hashes the registers as well as the
+		 * internal counters, volumes, and LFSR.
+		 * @param hash State hash to update.
+		 */
+		void stateHash(StateHash *hash) const;
 		
 		/** Gens-specific code. */
 		void specialUpdate(void);
@@ -81,6 +92,12 @@ class Psg
 		// Reset buffer pointers.
 		void resetBufferPtrs(void);
 
+		/**
+		 * Set the VGM writer for register write logging.
+		 * @param vgmWriter VGM writer, or nullptr to disable logging.
+		 */
+		void setVgmWriter(VgmWriter *vgmWriter);
+
 	public:
 		// Super secret debug stuff!
 		// For use by MDP plugins and test suites.
@@ -32,6 +32,8 @@
 
 namespace LibGens {
 
+class VgmWriter;
+
 // TODO: Needs more optimization.
 class PsgPrivate
 {
@@ -121,6 +123,9 @@ class PsgPrivate
 		// TODO: Figure out how to get rid of these!
 		int32_t *bufPtrL;
 		int32_t *bufPtrR;
+
+		// VGM writer for register write logging.
+		VgmWriter *vgmWriter;
 };
 
 }
@@ -0,0 +1,424 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * Resampler.cpp: Polyphase FIR audio resampler.                           *
+ * Converts audio from a chip's native rate to the output rate.            *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth                                       *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "Resampler.hpp"
+#include "libcompat/cpuflags.h"
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+// aligned_malloc()
+#include "libcompat/aligned_malloc.h"
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+// NOTE: We're implementing the SSE2 code
+// using GNU inline assembler *only*.
+#if defined(__GNUC__) && \
+    (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
+#define RESAMPLER_HAS_SSE2 1
+// gcc only accepts xmm register clobbers if SSE is enabled.
+#ifdef __SSE__
+#define RESAMPLER_XMM_CLOBBERS , "xmm0", "xmm1", "xmm2", "xmm3", "xmm4"
+#else
+#define RESAMPLER_XMM_CLOBBERS
+#endif
+#endif
+
+namespace LibGens {
+
+class ResamplerPrivate
+{
+	public:
+		ResamplerPrivate();
+		~ResamplerPrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		ResamplerPrivate(const ResamplerPrivate &);
+		ResamplerPrivate &operator=(const ResamplerPrivate &);
+
+	public:
+		// log2(Resampler::PHASES)
+		static const int PHASE_BITS = 7;
+
+		// Block lengths.
+		int inLen;
+		int outLen;
+
+		// Input position step per output sample. (32.32 fixed-point)
+		uint64_t step;
+		// Current position in the working buffers. (32.32 fixed-point)
+		int64_t pos;
+
+		// Coefficient table: [PHASES][TAPS]
+		// Allocated with aligned_malloc() for SSE2.
+		float *coeffs;
+
+		// Working buffers: [TAPS history + MAX_INPUT]
+		float *bufL;
+		float *bufR;
+
+		/**
+		 * Zeroth-order modified Bessel function of the first kind.
+		 * Used for the Kaiser window.
+		 * @param x Value.
+		 * @return I0(x)
+		 */
+		static double besselI0(double x);
+
+		/**
+		 * Calculate the coefficient table.
+		 * @param cutoff Cutoff frequency, relative to the input Nyquist frequency.
+		 */
+		void calcCoeffs(double cutoff);
+
+		/**
+		 * Calculate a single stereo output sample.
+		 * @param coeff	[in] Coefficients for the current phase. (TAPS floats)
+		 * @param srcL	[in] Left input samples. (TAPS floats)
+		 * @param srcR	[in] Right input samples. (TAPS floats)
+		 * @param destL	[out] Left output sample.
+		 * @param destR	[out] Right output sample.
+		 */
+		static void dotProduct_noasm(const float *coeff,
+			const float *srcL, const float *srcR,
+			int32_t *destL, int32_t *destR);
+
+#ifdef RESAMPLER_HAS_SSE2
+		/**
+		 * Calculate a single stereo output sample. (SSE2-optimized)
+		 * @param coeff	[in] Coefficients for the current phase. (TAPS floats; 16-byte aligned)
+		 * @param srcL	[in] Left input samples. (TAPS floats)
+		 * @param srcR	[in] Right input samples. (TAPS floats)
+		 * @param destL	[out] Left output sample.
+		 * @param destR	[out] Right output sample.
+		 */
+		static void dotProduct_SSE2(const float *coeff,
+			const float *srcL, const float *srcR,
+			int32_t *destL, int32_t *destR);
+#endif /* RESAMPLER_HAS_SSE2 */
+};
+
+/** ResamplerPrivate **/
+
+ResamplerPrivate::ResamplerPrivate()
+	: inLen(0)
+	, outLen(0)
+	, step(0)
+	, pos(0)
+{
+	coeffs = (float*)aligned_malloc(16, Resampler::PHASES * Resampler::TAPS * sizeof(float));
+	bufL = (float*)aligned_malloc(16, (Resampler::TAPS + Resampler::MAX_INPUT) * sizeof(float));
+	bufR = (float*)aligned_malloc(16, (Resampler::TAPS + Resampler::MAX_INPUT) * sizeof(float));
+	memset(coeffs, 0, Resampler::PHASES * Resampler::TAPS * sizeof(float));
+	memset(bufL, 0, (Resampler::TAPS + Resampler::MAX_INPUT) * sizeof(float));
+	memset(bufR, 0, (Resampler::TAPS + Resampler::MAX_INPUT) * sizeof(float));
+}
+
+ResamplerPrivate::~ResamplerPrivate()
+{
+	aligned_free(coeffs);
+	aligned_free(bufL);
+	aligned_free(bufR);
+}
+
+/**
+ * Zeroth-order modified Bessel function of the first kind.
+ * Used for the Kaiser window.
+ * @param x Value.
+ * @return I0(x)
+ */
+double ResamplerPrivate::besselI0(double x)
+{
+	// Power series. Converges quickly for
+	// the beta values used by the Kaiser window.
+	double sum = 1.0, term = 1.0;
+	const double xh = x / 2.0;
+	for (int k = 1; k < 32; k++) {
+		term *= (xh / k);
+		sum += (term * term);
+		if (term * term < (sum * 1e-12))
+			break;
+	}
+	return sum;
+}
+
+/**
+ * Calculate the coefficient table.
+ * @param cutoff Cutoff frequency, relative to the input Nyquist frequency.
+ */
+void ResamplerPrivate::calcCoeffs(double cutoff)
+{
+	static const double beta = 7.0;
+	const double i0_beta = besselI0(beta);
+	const double halfTaps = (double)(Resampler::TAPS / 2);
+
+	for (int p = 0; p < Resampler::PHASES; p++) {
+		// Output sample is located between taps
+		// (TAPS/2 - 1) and (TAPS/2), offset by the phase.
+		const double frac = (double)p / (double)Resampler::PHASES;
+		float *c = &coeffs[p * Resampler::TAPS];
+
+		double sum = 0.0;
+		double tmp[Resampler::TAPS];
+		for (int k = 0; k < Resampler::TAPS; k++) {
+			const double x = (double)(k - (Resampler::TAPS/2 - 1)) - frac;
+
+			// Windowed sinc.
+			double sinc;
+			if (fabs(x) < 1e-9) {
+				sinc = cutoff;
+			} else {
+				sinc = sin(PI * cutoff * x) / (PI * x);
+			}
+
+			const double r = (x / halfTaps);
+			double win = 0.0;
+			if (r * r < 1.0) {
+				win = besselI0(beta * sqrt(1.0 - (r * r))) / i0_beta;
+			}
+
+			tmp[k] = sinc * win;
+			sum += tmp[k];
+		}
+
+		// Normalize each phase for unity gain at DC.
+		for (int k = 0; k < Resampler::TAPS; k++) {
+			c[k] = (float)(tmp[k] / sum);
+		}
+	}
+}
+
+/**
+ * Calculate a single stereo output sample.
+ * @param coeff	[in] Coefficients for the current phase. (TAPS floats)
+ * @param srcL	[in] Left input samples. (TAPS floats)
+ * @param srcR	[in] Right input samples. (TAPS floats)
+ * @param destL	[out] Left output sample.
+ * @param destR	[out] Right output sample.
+ */
+void ResamplerPrivate::dotProduct_noasm(const float *coeff,
+	const float *srcL, const float *srcR,
+	int32_t *destL, int32_t *destR)
+{
+	float accL = 0.0f, accR = 0.0f;
+	for (int k = 0; k < Resampler::TAPS; k++) {
+		accL += (coeff[k] * srcL[k]);
+		accR += (coeff[k] * srcR[k]);
+	}
+
+	// NOTE: lrintf() uses the current rounding mode,
+	// which matches SSE2's cvtps2dq.
+	*destL = (int32_t)lrintf(accL);
+	*destR = (int32_t)lrintf(accR);
+}
+
+#ifdef RESAMPLER_HAS_SSE2
+/**
+ * Calculate a single stereo output sample. (SSE2-optimized)
+ * @param coeff	[in] Coefficients for the current phase. (TAPS floats; 16-byte aligned)
+ * @param srcL	[in] Left input samples. (TAPS floats)
+ * @param srcR	[in] Right input samples. (TAPS floats)
+ * @param destL	[out] Left output sample.
+ * @param destR	[out] Right output sample.
+ */
+void ResamplerPrivate::dotProduct_SSE2(const float *coeff,
+	const float *srcL, const float *srcR,
+	int32_t *destL, int32_t *destR)
+{
+	// Coefficients are aligned; input samples may not be.
+	assert((uintptr_t)coeff % 16 == 0);
+	int n = Resampler::TAPS;
+	__asm__ __volatile__ (
+		"xorps		%%xmm0, %%xmm0\n"	// %xmm0 = left accumulator
+		"xorps		%%xmm1, %%xmm1\n"	// %xmm1 = right accumulator
+		"1:\n"
+		"movaps		(%[coeff]), %%xmm2\n"
+		"movups		(%[srcL]), %%xmm3\n"
+		"movups		(%[srcR]), %%xmm4\n"
+		"mulps		%%xmm2, %%xmm3\n"
+		"mulps		%%xmm2, %%xmm4\n"
+		"addps		%%xmm3, %%xmm0\n"
+		"addps		%%xmm4, %%xmm1\n"
+		"add		$16, %[coeff]\n"
+		"add		$16, %[srcL]\n"
+		"add		$16, %[srcR]\n"
+		"sub		$4, %[n]\n"
+		"jnz		1b\n"
+
+		// Horizontal sum of both accumulators.
+		"movaps		%%xmm0, %%xmm2\n"
+		"unpcklps	%%xmm1, %%xmm0\n"	// %xmm0 = [R1  | L1  | R0  | L0 ]
+		"unpckhps	%%xmm1, %%xmm2\n"	// %xmm2 = [R3  | L3  | R2  | L2 ]
+		"addps		%%xmm2, %%xmm0\n"	// %xmm0 = [R13 | L13 | R02 | L02]
+		"movhlps	%%xmm0, %%xmm2\n"	// %xmm2 = [ x  |  x  | R13 | L13]
+		"addps		%%xmm2, %%xmm0\n"	// %xmm0 = [ x  |  x  |  R  |  L ]
+		"cvtps2dq	%%xmm0, %%xmm0\n"
+		"movd		%%xmm0, (%[destL])\n"
+		"pshufd		$0x55, %%xmm0, %%xmm0\n"
+		"movd		%%xmm0, (%[destR])\n"
+		: [coeff] "+r" (coeff), [srcL] "+r" (srcL), [srcR] "+r" (srcR), [n] "+r" (n)
+		: [destL] "r" (destL), [destR] "r" (destR)
+		: "cc", "memory" RESAMPLER_XMM_CLOBBERS
+		);
+}
+#endif /* RESAMPLER_HAS_SSE2 */
+
+/** Resampler **/
+
+Resampler::Resampler()
+	: d(new ResamplerPrivate())
+{ }
+
+Resampler::~Resampler()
+{
+	delete d;
+}
+
+/**
+ * (Re-)Initialize the resampler.
+ * The ratio is specified as block lengths so that
+ * exactly outLen samples are produced for every
+ * inLen samples, e.g. one frame's worth of audio.
+ * This also clears the filter history.
+ * @param inLen Input samples per block.
+ * @param outLen Output samples per block.
+ * @return 0 on success; non-zero on error.
+ */
+int Resampler::reInit(int inLen, int outLen)
+{
+	static_assert((1 << ResamplerPrivate::PHASE_BITS) == PHASES, "PHASE_BITS does not match PHASES.");
+	static_assert(TAPS % 4 == 0, "TAPS must be a multiple of 4 for SSE2.");
+	if (inLen <= 0 || inLen > MAX_INPUT || outLen <= 0)
+		return -1;
+
+	d->inLen = inLen;
+	d->outLen = outLen;
+	d->step = ((uint64_t)inLen << 32) / (uint64_t)outLen;
+
+	// Cutoff is slightly below the lower of the two
+	// Nyquist frequencies to leave room for the
+	// transition band.
+	double cutoff = 0.90;
+	if (outLen < inLen) {
+		cutoff *= ((double)outLen / (double)inLen);
+	}
+	d->calcCoeffs(cutoff);
+
+	reset();
+	return 0;
+}
+
+/**
+ * Clear the filter history.
+ */
+void Resampler::reset(void)
+{
+	d->pos = 0;
+	memset(d->bufL, 0, (TAPS + MAX_INPUT) * sizeof(float));
+	memset(d->bufR, 0, (TAPS + MAX_INPUT) * sizeof(float));
+}
+
+/**
+ * Resample a block of stereo audio.
+ * Input and output buffers are 32-bit in order to
+ * handle oversaturation, like SoundMgr's segment buffers.
+ * The block lengths specified in reInit() are used.
+ * @param srcL	[in] Left input buffer.
+ * @param srcR	[in] Right input buffer.
+ * @param destL	[out] Left output buffer.
+ * @param destR	[out] Right output buffer.
+ * @return Number of samples written.
+ */
+int Resampler::process(const int32_t *srcL, const int32_t *srcR,
+		       int32_t *destL, int32_t *destR)
+{
+	if (d->inLen <= 0)
+		return 0;
+
+	// Append the new input after the filter history.
+	float *inL = &d->bufL[TAPS];
+	float *inR = &d->bufR[TAPS];
+	for (int i = 0; i < d->inLen; i++) {
+		inL[i] = (float)srcL[i];
+		inR[i] = (float)srcR[i];
+	}
+
+	typedef void (*dotProduct_fn)(const float *coeff,
+		const float *srcL, const float *srcR,
+		int32_t *destL, int32_t *destR);
+	dotProduct_fn dotProduct = ResamplerPrivate::dotProduct_noasm;
+#ifdef RESAMPLER_HAS_SSE2
+	if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+		dotProduct = ResamplerPrivate::dotProduct_SSE2;
+	}
+#endif /* RESAMPLER_HAS_SSE2 */
+
+	// Since step == inLen / outLen, the integer part
+	// of pos never exceeds inLen, so all taps are
+	// within the history and the current block.
+	int64_t pos = d->pos;
+	for (int i = 0; i < d->outLen; i++, pos += d->step) {
+		const int idx = (int)(pos >> 32);
+		const int phase = (int)((uint32_t)pos >> (32 - ResamplerPrivate::PHASE_BITS));
+		dotProduct(&d->coeffs[phase * TAPS], &d->bufL[idx], &d->bufR[idx],
+			   &destL[i], &destR[i]);
+	}
+
+	// Save the last TAPS input samples as history.
+	memmove(d->bufL, &d->bufL[d->inLen], TAPS * sizeof(float));
+	memmove(d->bufR, &d->bufR[d->inLen], TAPS * sizeof(float));
+	pos -= ((int64_t)d->inLen << 32);
+	if (pos < 0) {
+		// step is rounded down, so the position
+		// may drift slightly behind the block.
+		pos = 0;
+	}
+	d->pos = pos;
+	return d->outLen;
+}
+
+/**
+ * Get the number of input samples per block.
+ * @return Input samples per block.
+ */
+int Resampler::inLen(void) const
+{
+	return d->inLen;
+}
+
+/**
+ * Get the number of output samples per block.
+ * @return Output samples per block.
+ */
+int Resampler::outLen(void) const
+{
+	return d->outLen;
+}
+
+}
@@ -0,0 +1,101 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * Resampler.hpp: Polyphase FIR audio resampler.                           *
+ * Converts audio from a chip's native rate to the output rate.            *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth                                       *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_SOUND_RESAMPLER_HPP__
+#define __LIBGENS_SOUND_RESAMPLER_HPP__
+
+// C includes.
+#include <stdint.h>
+
+namespace LibGens {
+
+class ResamplerPrivate;
+class Resampler
+{
+	public:
+		Resampler();
+		~Resampler();
+
+	protected:
+		friend class ResamplerPrivate;
+		ResamplerPrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		Resampler(const Resampler &);
+		Resampler &operator=(const Resampler &);
+
+	public:
+		// Number of FIR taps per phase.
+		static const int TAPS = 32;
+		// Number of polyphase filter phases.
+		static const int PHASES = 128;
+		// Maximum number of input samples per block.
+		static const int MAX_INPUT = 2048;
+
+		/**
+		 * (Re-)Initialize the resampler.
+		 * The ratio is specified as block lengths so that
+		 * exactly outLen samples are produced for every
+		 * inLen samples, e.g. one frame's worth of audio.
+		 * This also clears the filter history.
+		 * @param inLen Input samples per block.
+		 * @param outLen Output samples per block.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int reInit(int inLen, int outLen);
+
+		/**
+		 * Clear the filter history.
+		 */
+		void reset(void);
+
+		/**
+		 * Resample a block of stereo audio.
+		 * Input and output buffers are 32-bit in order to
+		 * handle oversaturation, like SoundMgr's segment buffers.
+		 * The block lengths specified in reInit() are used.
+		 * @param srcL	[in] Left input buffer.
+		 * @param srcR	[in] Right input buffer.
+		 * @param destL	[out] Left output buffer.
+		 * @param destR	[out] Right output buffer.
+		 * @return Number of samples written.
+		 */
+		int process(const int32_t *srcL, const int32_t *srcR,
+			    int32_t *destL, int32_t *destR);
+
+		/**
+		 * Get the number of input samples per block.
+		 * @return Input samples per block.
+		 */
+		int inLen(void) const;
+
+		/**
+		 * Get the number of output samples per block.
+		 * @return Output samples per block.
+		 */
+		int outLen(void) const;
+};
+
+}
+
+#endif /* __LIBGENS_SOUND_RESAMPLER_HPP__ */
@@ -25,6 +25,7 @@
 #include "SoundMgr.hpp"
 
 // C includes. (C++ namespace)
+#include <cassert>
 #include <cmath>
 #include <cstring>
 
@@ -51,6 +52,17 @@ namespace LibGens {
 int SoundMgrPrivate::rate = 44100;
 bool SoundMgrPrivate::isPal = false;
 
+// Native-rate rendering.
+bool SoundMgrPrivate::nativeRate = false;
+int SoundMgrPrivate::renderLength = 0;
+int32_t ALIGN(16) SoundMgrPrivate::nativeBufL[SoundMgr::MAX_NATIVE_SEGMENT_SIZE];
+int32_t ALIGN(16) SoundMgrPrivate::nativeBufR[SoundMgr::MAX_NATIVE_SEGMENT_SIZE];
+Resampler SoundMgrPrivate::resampler;
+
+// Audio capture.
+VgmWriter *SoundMgrPrivate::vgmWriter = nullptr;
+WavWriter *SoundMgrPrivate::wavWriter = nullptr;
+
 /**
  * Calculate the segment length.
  * @param rate Sound rate, in Hz.
@@ -77,6 +89,88 @@ int SoundMgrPrivate::CalcSegLength(int rate, bool isPal)
 	}
 }
 
+/**
+ * Resample the native-rate render buffers into the segment buffers.
+ * This clears the native-rate render buffers.
+ * Does nothing if native-rate rendering is disabled.
+ */
+void SoundMgrPrivate::resampleNative(void)
+{
+	if (!nativeRate)
+		return;
+
+	resampler.process(nativeBufL, nativeBufR,
+			  SoundMgr::ms_SegBufL, SoundMgr::ms_SegBufR);
+
+	// Clear the native-rate buffers.
+	// These buffers are additive, so if they aren't cleared,
+	// we'll end up with static.
+	memset(nativeBufL, 0, renderLength * sizeof(nativeBufL[0]));
+	memset(nativeBufR, 0, renderLength * sizeof(nativeBufR[0]));
+}
+
+/**
+ * Write the current YM2612 and PSG register state to the VGM file.
+ */
+void SoundMgrPrivate::vgmWriteInitialState(void)
+{
+	const Ym2612 &ym2612 = SoundMgr::ms_Ym2612;
+
+	// YM2612: LFO, channel 3 mode, and DAC enable.
+	// Timer values aren't needed for playback.
+	vgmWriter->writeYm2612(0, 0x22, (uint8_t)ym2612.getReg(0x22));
+	vgmWriter->writeYm2612(0, 0x27, (uint8_t)(ym2612.getReg(0x27) & 0xC0));
+	vgmWriter->writeYm2612(0, 0x2B, (uint8_t)ym2612.getReg(0x2B));
+
+	for (int port = 0; port < 2; port++) {
+		const int base = (port << 8);
+
+		// Operator registers.
+		for (int reg = 0x30; reg < 0xA0; reg++) {
+			if ((reg & 3) == 3)
+				continue;
+			vgmWriter->writeYm2612(port, (uint8_t)reg, (uint8_t)ym2612.getReg(base | reg));
+		}
+
+		// Frequency registers. (channel 3 special mode: 0xA8-0xAA)
+		// The MSB register must be written before the LSB register.
+		static const uint8_t freqRegs[6] = {0xA0, 0xA1, 0xA2, 0xA8, 0xA9, 0xAA};
+		for (int i = 0; i < ARRAY_SIZE(freqRegs); i++) {
+			const int reg = freqRegs[i];
+			vgmWriter->writeYm2612(port, (uint8_t)(reg + 4), (uint8_t)ym2612.getReg(base | (reg + 4)));
+			vgmWriter->writeYm2612(port, (uint8_t)reg, (uint8_t)ym2612.getReg(base | reg));
+		}
+
+		// Algorithm, feedback, and stereo/LFO sensitivity.
+		for (int reg = 0xB0; reg < 0xB8; reg++) {
+			if ((reg & 3) == 3)
+				continue;
+			vgmWriter->writeYm2612(port, (uint8_t)reg, (uint8_t)ym2612.getReg(base | reg));
+		}
+	}
+
+	// PSG registers.
+	// Even registers are tone/noise; odd registers are volume.
+	const Psg &psg = SoundMgr::ms_Psg;
+	for (int reg = 0; reg < 8; reg++) {
+		uint16_t val;
+		if (psg.dbg_getReg(reg, &val) != 0)
+			continue;
+
+		if (reg == 6) {
+			// Noise register.
+			vgmWriter->writePsg((uint8_t)(0x80 | (reg << 4) | (val & 0x07)));
+		} else if (!(reg & 1)) {
+			// Tone register. (10-bit)
+			vgmWriter->writePsg((uint8_t)(0x80 | (reg << 4) | (val & 0x0F)));
+			vgmWriter->writePsg((uint8_t)((val >> 4) & 0x3F));
+		} else {
+			// Volume register.
+			vgmWriter->writePsg((uint8_t)(0x80 | (reg << 4) | (val & 0x0F)));
+		}
+	}
+}
+
 /** SoundMgr **/
 
 // Segment buffer.
@@ -84,8 +178,13 @@ int SoundMgrPrivate::CalcSegLength(int rate, bool isPal)
 // (32-bit instead of 16-bit to handle oversaturation properly.)
 // TODO: Convert to interleaved stereo.
 // TODO: Make SoundMgr non-static and allocate this using aligned_malloc().
-int32_t ALIGN(16) SoundMgr::ms_SegBufL[MAX_SEGMENT_SIZE];
-int32_t ALIGN(16) SoundMgr::ms_SegBufR[MAX_SEGMENT_SIZE];
+// NOTE: 32-byte alignment is used for AVX2.
+int32_t ALIGN(32) SoundMgr::ms_SegBufL[MAX_SEGMENT_SIZE];
+int32_t ALIGN(32) SoundMgr::ms_SegBufR[MAX_SEGMENT_SIZE];
+
+// Render buffer pointers.
+int32_t *SoundMgr::ms_RenderBufL = &SoundMgr::ms_SegBufL[0];
+int32_t *SoundMgr::ms_RenderBufR = &SoundMgr::ms_SegBufR[0];
 
 // Audio ICs.
 Psg SoundMgr::ms_Psg;
@@ -105,7 +204,9 @@ void SoundMgr::Init(void)
 
 void SoundMgr::End(void)
 {
-	// TODO
+	// Stop audio capture.
+	StopVgmCapture();
+	StopWavCapture();
 }
 
 /**
@@ -116,17 +217,44 @@ void SoundMgr::End(void)
  */
 void SoundMgr::ReInit(int rate, bool isPal, bool preserveState)
 {
+	const int prevRate = SoundMgrPrivate::rate;
 	SoundMgrPrivate::rate = rate;
 	SoundMgrPrivate::isPal = isPal;
 
 	// Calculate the segment length.
 	ms_SegLength = SoundMgrPrivate::CalcSegLength(rate, isPal);
 
+	// Determine the render rate.
+	const int ymClock = (int)((double)(isPal ? CLOCK_PAL : CLOCK_NTSC) / 7.0);
+	const int psgClock = (int)((double)(isPal ? CLOCK_PAL : CLOCK_NTSC) / 15.0);
+	int renderRate = rate;
+	if (SoundMgrPrivate::nativeRate) {
+		// YM2612 native rate: one sample every 144 clocks.
+		// NOTE: Rounding up prevents the YM2612 from
+		// enabling its own interpolation.
+		renderRate = (int)ceil((double)ymClock / 144.0);
+		SoundMgrPrivate::renderLength = (int)ceil((double)renderRate / (isPal ? 50.0 : 60.0));
+		assert(SoundMgrPrivate::renderLength <= MAX_NATIVE_SEGMENT_SIZE);
+		if (SoundMgrPrivate::renderLength > MAX_NATIVE_SEGMENT_SIZE) {
+			SoundMgrPrivate::renderLength = MAX_NATIVE_SEGMENT_SIZE;
+		}
+
+		ms_RenderBufL = &SoundMgrPrivate::nativeBufL[0];
+		ms_RenderBufR = &SoundMgrPrivate::nativeBufR[0];
+		SoundMgrPrivate::resampler.reInit(SoundMgrPrivate::renderLength, ms_SegLength);
+	} else {
+		// Chips render directly into the segment buffers.
+		SoundMgrPrivate::renderLength = ms_SegLength;
+		ms_RenderBufL = &ms_SegBufL[0];
+		ms_RenderBufR = &ms_SegBufR[0];
+	}
+
 	// Build the sound extrapolation table.
+	const int renderLength = SoundMgrPrivate::renderLength;
 	const int lines = (isPal ? 312 : 262);
 	for (int i = 0; i < lines; i++) {
-		ms_Extrapol[i][0] = ((ms_SegLength * i) / lines);
-		ms_Extrapol[i][1] = (((ms_SegLength * (i+1)) / lines) - ms_Extrapol[i][0]);
+		ms_Extrapol[i][0] = ((renderLength * i) / lines);
+		ms_Extrapol[i][1] = (((renderLength * (i+1)) / lines) - ms_Extrapol[i][0]);
 	}
 	// Copy the last extrapolation value to 8 more lines.
 	// This may help at the end of the frame.
@@ -138,6 +266,8 @@ void SoundMgr::ReInit(int rate, bool isPal, bool preserveState)
 	// Clear the segment buffers.
 	memset(ms_SegBufL, 0x00, sizeof(ms_SegBufL));
 	memset(ms_SegBufR, 0x00, sizeof(ms_SegBufR));
+	memset(SoundMgrPrivate::nativeBufL, 0x00, sizeof(SoundMgrPrivate::nativeBufL));
+	memset(SoundMgrPrivate::nativeBufR, 0x00, sizeof(SoundMgrPrivate::nativeBufR));
 
 	// If requested, save the PSG/YM state.
 	Zomg_PsgSave_t psgState;
@@ -148,19 +278,23 @@ void SoundMgr::ReInit(int rate, bool isPal, bool preserveState)
 	}
 
 	// Initialize the PSG and YM2612.
-	if (isPal) {
-		ms_Psg.reInit((int)((double)CLOCK_PAL / 15.0), rate);
-		ms_Ym2612.reInit((int)((double)CLOCK_PAL / 7.0), rate);
-	} else {
-		ms_Psg.reInit((int)((double)CLOCK_NTSC / 15.0), rate);
-		ms_Ym2612.reInit((int)((double)CLOCK_NTSC / 7.0), rate);
-	}
+	ms_Psg.reInit(psgClock, renderRate);
+	ms_Ym2612.reInit(ymClock, renderRate);
 
 	// If requested, restore the PSG/YM state.
 	if (preserveState) {
 		ms_Psg.zomgRestore(&psgState);
 		ms_Ym2612.zomgRestore(&ym2612State);
 	}
+
+	// Update the audio capture timestamps.
+	if (SoundMgrPrivate::vgmWriter) {
+		SoundMgrPrivate::vgmWriter->setRenderRate(SoundMgrPrivate::vgmRenderRate());
+	}
+	if (SoundMgrPrivate::wavWriter && prevRate != rate) {
+		// WAV files can't change rates.
+		StopWavCapture();
+	}
 }
 
 /** ReInit() wrappers. **/
@@ -175,4 +309,148 @@ void SoundMgr::SetRegion(bool isPal, bool preserveState)
 	ReInit(SoundMgrPrivate::rate, isPal, preserveState);
 }
 
+/**
+ * Render audio at the YM2612's native rate?
+ * If enabled, the YM2612 and PSG render into a native-rate
+ * buffer, which is converted to the output rate using a
+ * polyphase FIR resampler when the audio is written.
+ * @param nativeRate True to render at the native rate.
+ * @param preserveState If true, save the PSG/YM state before reinitializing them.
+ */
+void SoundMgr::SetNativeRate(bool nativeRate, bool preserveState)
+{
+	SoundMgrPrivate::nativeRate = nativeRate;
+	ReInit(SoundMgrPrivate::rate, SoundMgrPrivate::isPal, preserveState);
+}
+
+/**
+ * Is audio rendered at the YM2612's native rate?
+ * @return True if native-rate rendering is enabled.
+ */
+bool SoundMgr::IsNativeRate(void)
+{
+	return SoundMgrPrivate::nativeRate;
+}
+
+/** Audio capture. **/
+
+/**
+ * Start logging YM2612 and PSG register writes to a VGM file.
+ * The current register state is written first so that
+ * capture can be started in the middle of a song.
+ * File writes are done on a background thread.
+ * @param filename VGM filename. (UTF-8)
+ * @return 0 on success; negative errno on error.
+ */
+int SoundMgr::StartVgmCapture(const char *filename)
+{
+	StopVgmCapture();
+
+	const bool isPal = SoundMgrPrivate::isPal;
+	const int ymClock = (int)((double)(isPal ? CLOCK_PAL : CLOCK_NTSC) / 7.0);
+	const int psgClock = (int)((double)(isPal ? CLOCK_PAL : CLOCK_NTSC) / 15.0);
+
+	VgmWriter *vgmWriter = new VgmWriter();
+	int ret = vgmWriter->open(filename, ymClock, psgClock);
+	if (ret != 0) {
+		delete vgmWriter;
+		return ret;
+	}
+	vgmWriter->setRenderRate(SoundMgrPrivate::vgmRenderRate());
+
+	SoundMgrPrivate::vgmWriter = vgmWriter;
+	SoundMgrPrivate::vgmWriteInitialState();
+	ms_Ym2612.setVgmWriter(vgmWriter);
+	ms_Psg.setVgmWriter(vgmWriter);
+	return 0;
+}
+
+/**
+ * Stop VGM capture.
+ * @return 0 on success; negative errno if a write failed.
+ */
+int SoundMgr::StopVgmCapture(void)
+{
+	VgmWriter *vgmWriter = SoundMgrPrivate::vgmWriter;
+	if (!vgmWriter)
+		return 0;
+
+	ms_Ym2612.setVgmWriter(nullptr);
+	ms_Psg.setVgmWriter(nullptr);
+	SoundMgrPrivate::vgmWriter = nullptr;
+
+	int ret = vgmWriter->close();
+	delete vgmWriter;
+	return ret;
+}
+
+/**
+ * Is VGM capture active?
+ * @return True if VGM capture is active.
+ */
+bool SoundMgr::IsVgmCapturing(void)
+{
+	return (SoundMgrPrivate::vgmWriter != nullptr);
+}
+
+/**
+ * Start saving the mixed audio output to a WAV file.
+ * Audio is captured by the write*() functions at the output rate.
+ * File writes are done on a background thread.
+ * @param filename WAV filename. (UTF-8)
+ * @return 0 on success; negative errno on error.
+ */
+int SoundMgr::StartWavCapture(const char *filename)
+{
+	StopWavCapture();
+
+	WavWriter *wavWriter = new WavWriter();
+	int ret = wavWriter->open(filename, SoundMgrPrivate::rate);
+	if (ret != 0) {
+		delete wavWriter;
+		return ret;
+	}
+
+	SoundMgrPrivate::wavWriter = wavWriter;
+	return 0;
+}
+
+/**
+ * Stop WAV capture.
+ * @return 0 on success; negative errno if a write failed.
+ */
+int SoundMgr::StopWavCapture(void)
+{
+	WavWriter *wavWriter = SoundMgrPrivate::wavWriter;
+	if (!wavWriter)
+		return 0;
+
+	SoundMgrPrivate::wavWriter = nullptr;
+	int ret = wavWriter->close();
+	delete wavWriter;
+	return ret;
+}
+
+/**
+ * Is WAV capture active?
+ * @return True if WAV capture is active.
+ */
+bool SoundMgr::IsWavCapturing(void)
+{
+	return (SoundMgrPrivate::wavWriter != nullptr);
+}
+
+/**
+ * Advance the audio capture timestamp.
+ * This must be called once per scanline, after the
+ * sound chips' write lengths have been updated.
+ * @param writeLen Number of samples rendered for this scanline.
+ */
+void SoundMgr::AdvanceCapture(int writeLen)
+{
+	if (SoundMgrPrivate::vgmWriter) {
+		SoundMgrPrivate::vgmWriter->advance(writeLen);
+	}
+}
+
 }
@@ -47,6 +47,70 @@ class SoundMgr
 		static void SetRate(int rate, bool preserveState = true);
 		static void SetRegion(bool isPal, bool preserveState = true);
 
+		/**
+		 * Render audio at the YM2612's native rate?
+		 * If enabled, the YM2612 and PSG render into a native-rate
+		 * buffer, which is converted to the output rate using a
+		 * polyphase FIR resampler when the audio is written.
+		 * @param nativeRate True to render at the native rate.
+		 * @param preserveState If true, save the PSG/YM state before reinitializing them.
+		 */
+		static void SetNativeRate(bool nativeRate, bool preserveState = true);
+		static bool IsNativeRate(void);
+
+		/** Audio capture. **/
+
+		/**
+		 * Start logging YM2612 and PSG register writes to a VGM file.
+		 * The current register state is written first so that
+		 * capture can be started in the middle of a song.
+		 * File writes are done on a background thread.
+		 * @param filename VGM filename. (UTF-8)
+		 * @return 0 on success; negative errno on error.
+		 */
+		static int StartVgmCapture(const char *filename);
+
+		/**
+		 * Stop VGM capture.
+		 * @return 0 on success; negative errno if a write failed.
+		 */
+		static int StopVgmCapture(void);
+
+		/**
+		 * Is VGM capture active?
+		 * @return True if VGM capture is active.
+		 */
+		static bool IsVgmCapturing(void);
+
+		/**
+		 * Start saving the mixed audio output to a WAV file.
+		 * Audio is captured by the write*() functions at the output rate.
+		 * File writes are done on a background thread.
+		 * @param filename WAV filename. (UTF-8)
+		 * @return 0 on success; negative errno on error.
+		 */
+		static int StartWavCapture(const char *filename);
+
+		/**
+		 * Stop WAV capture.
+		 * @return 0 on success; negative errno if a write failed.
+		 */
+		static int StopWavCapture(void);
+
+		/**
+		 * Is WAV capture active?
+		 * @return True if WAV capture is active.
+		 */
+		static bool IsWavCapturing(void);
+
+		/**
+		 * Advance the audio capture timestamp.
+		 * This must be called once per scanline, after the
+		 * sound chips' write lengths have been updated.
+		 * @param writeLen Number of samples rendered for this scanline.
+		 */
+		static void AdvanceCapture(int writeLen);
+
 		static inline int GetSegLength(void);
 
 		// TODO: Bounds checking.
@@ -57,6 +121,10 @@ class SoundMgr
 		static const int MAX_SAMPLING_RATE = 48000;
 		static const int MAX_SEGMENT_SIZE = 960;	// ceil(MAX_SAMPLING_RATE / 50)
 
+		// Maximum native-rate segment size.
+		// YM2612 native rate is (CLOCK_NTSC / 7 / 144) ~= 53,267 Hz.
+		static const int MAX_NATIVE_SEGMENT_SIZE = 1088;	// ceil(53,267 / 50), rounded up
+
 		// Segment buffer.
 		// Stores up to MAX_SEGMENT_SIZE 16-bit stereo samples.
 		// (Samples are actually 32-bit in order to handle oversaturation properly.)
@@ -65,6 +133,16 @@ class SoundMgr
 		static int32_t ms_SegBufL[MAX_SEGMENT_SIZE];
 		static int32_t ms_SegBufR[MAX_SEGMENT_SIZE];
 
+		// Render buffer pointers.
+		// Sound chips write to these buffers.
+		// Normally, these point to ms_SegBufL and ms_SegBufR.
+		// If native-rate rendering is enabled, they point to
+		// the native-rate buffers, which are resampled into
+		// ms_SegBufL and ms_SegBufR by writeStereo() and writeMono().
+		// Use GetWritePos() and GetWriteLen() for offsets.
+		static int32_t *ms_RenderBufL;
+		static int32_t *ms_RenderBufR;
+
 		// Audio ICs.
 		// TODO: Add wrapper functions?
 		static Psg ms_Psg;
@@ -108,6 +186,26 @@ class SoundMgr
 		 */
 		static int writeMono(int16_t *dest, int samples);
 
+		/**
+		 * Write stereo audio to a buffer. (32-bit float, interleaved)
+		 * Samples are clamped to 16-bit and scaled to [-1.0, 1.0).
+		 * This clears the internal audio buffer.
+		 * @param dest Destination buffer.
+		 * @param samples Number of samples in the buffer. (1 sample == 8 bytes)
+		 * @return Number of samples written.
+		 */
+		static int writeStereoFloat(float *dest, int samples);
+
+		/**
+		 * Write monaural audio to a buffer. (32-bit float)
+		 * Samples are clamped to 16-bit and scaled to [-1.0, 1.0).
+		 * This clears the internal audio buffer.
+		 * @param dest Destination buffer.
+		 * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
+		 * @return Number of samples written.
+		 */
+		static int writeMonoFloat(float *dest, int samples);
+
 	protected:
 		// TODO: Move these into the private class.
 
@@ -116,6 +214,8 @@ class SoundMgr
 
 		// Line extrapolation values. [312 + extra room to prevent overflows]
 		// Index 0 == start; Index 1 == length
+		// NOTE: These are relative to the render buffer,
+		// which may be at the native rate.
 		static unsigned int ms_Extrapol[312+8][2];
 
 	private:
@@ -31,6 +31,13 @@
 #define SOUNDMGR_HAS_MMX 1
 #endif
 
+// Native-rate resampler.
+#include "Resampler.hpp"
+
+// Audio capture.
+#include "VgmWriter.hpp"
+#include "WavWriter.hpp"
+
 namespace LibGens {
 
 // SoundMgrPrivate
@@ -53,8 +60,109 @@ class SoundMgrPrivate
 		static int rate;
 		static bool isPal;
 
+	public:
+		/** Native-rate rendering. **/
+		static bool nativeRate;
+
+		// Render segment length.
+		// Same as ms_SegLength unless nativeRate is set.
+		static int renderLength;
+
+		// Native-rate render buffers.
+		static int32_t nativeBufL[SoundMgr::MAX_NATIVE_SEGMENT_SIZE];
+		static int32_t nativeBufR[SoundMgr::MAX_NATIVE_SEGMENT_SIZE];
+
+		// Resampler for native-rate rendering.
+		static Resampler resampler;
+
+		/**
+		 * Resample the native-rate render buffers into the segment buffers.
+		 * This clears the native-rate render buffers.
+		 * Does nothing if native-rate rendering is disabled.
+		 */
+		static void resampleNative(void);
+
+	public:
+		/** Audio capture. **/
+
+		// VGM writer. (nullptr if VGM capture is inactive)
+		static VgmWriter *vgmWriter;
+
+		// WAV writer. (nullptr if WAV capture is inactive)
+		static WavWriter *wavWriter;
+
+		/**
+		 * Get the render rate used for VGM timestamps.
+		 * This is the render segment length times the frame rate,
+		 * so one frame is always exactly one frame in the VGM.
+		 * @return Render rate, in samples per second.
+		 */
+		static inline int vgmRenderRate(void)
+		{
+			return renderLength * (isPal ? 50 : 60);
+		}
+
+		/**
+		 * Write the current YM2612 and PSG register state to the VGM file.
+		 */
+		static void vgmWriteInitialState(void);
+
+		/**
+		 * Write the segment buffers to the WAV file.
+		 * Does nothing if WAV capture is inactive.
+		 * @param samples Number of samples.
+		 */
+		static inline void captureWav(int samples)
+		{
+			if (wavWriter) {
+				wavWriter->write(SoundMgr::ms_SegBufL, SoundMgr::ms_SegBufR, samples);
+			}
+		}
+
 	public:
 #ifdef SOUNDMGR_HAS_MMX
+		/**
+		 * Write stereo audio to a buffer. (AVX2-optimized)
+		 * @param dest Destination buffer.
+		 * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
+		 */
+		static void writeStereo_AVX2(int16_t *dest, int samples);
+
+		/**
+		 * Write monaural audio to a buffer. (AVX2-optimized)
+		 * @param dest Destination buffer.
+		 * @param samples Number of samples in the buffer. (1 sample == 2 bytes)
+		 */
+		static void writeMono_AVX2(int16_t *dest, int samples);
+
+		/**
+		 * Write stereo audio to a float buffer. (AVX2-optimized)
+		 * @param dest Destination buffer.
+		 * @param samples Number of samples in the buffer. (1 sample == 8 bytes)
+		 */
+		static void writeStereoFloat_AVX2(float *dest, int samples);
+
+		/**
+		 * Write monaural audio to a float buffer. (AVX2-optimized)
+		 * @param dest Destination buffer.
+		 * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
+		 */
+		static void writeMonoFloat_AVX2(float *dest, int samples);
+
+		/**
+		 * Write stereo audio to a float buffer. (SSE2-optimized)
+		 * @param dest Destination buffer.
+		 * @param samples Number of samples in the buffer. (1 sample == 8 bytes)
+		 */
+		static void writeStereoFloat_SSE2(float *dest, int samples);
+
+		/**
+		 * Write monaural audio to a float buffer. (SSE2-optimized)
+		 * @param dest Destination buffer.
+		 * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
+		 */
+		static void writeMonoFloat_SSE2(float *dest, int samples);
+
 		/**
 		 * Write stereo audio to a buffer. (SSE2-optimized)
 		 * @param dest Destination buffer.
@@ -97,6 +205,20 @@ class SoundMgrPrivate
 		 * @param samples Number of samples in the buffer. (1 sample == 2 bytes)
 		 */
 		static void writeMono_noasm(int16_t *dest, int samples);
+
+		/**
+		 * Write stereo audio to a float buffer.
+		 * @param dest Destination buffer.
+		 * @param samples Number of samples in the buffer. (1 sample == 8 bytes)
+		 */
+		static void writeStereoFloat_noasm(float *dest, int samples);
+
+		/**
+		 * Write monaural audio to a float buffer.
+		 * @param dest Destination buffer.
+		 * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
+		 */
+		static void writeMonoFloat_noasm(float *dest, int samples);
 };
 
 }
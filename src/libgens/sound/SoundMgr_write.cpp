@@ -32,6 +32,9 @@
 // C++ includes.
 #include <algorithm>
 
+// ALIGN()
+#include "libcompat/aligned_malloc.h"
+
 #include "SoundMgr_p.hpp"
 namespace LibGens {
 
@@ -51,6 +54,243 @@ static inline int16_t clamp(int32_t sample)
 	return (int16_t)sample;
 }
 
+/**
+ * Convert a 32-bit sample to float.
+ * The sample is clamped to 16-bit first.
+ * @param sample 32-bit sample.
+ * @return Float sample in the range [-1.0, 1.0).
+ */
+static inline float clampFloat(int32_t sample)
+{
+	return (float)clamp(sample) * (1.0f / 32768.0f);
+}
+
+#ifdef SOUNDMGR_HAS_MMX
+// Constants for float conversion.
+// [0]: Minimum (-32768.0)
+// [8]: Maximum (32767.0)
+// [16]: Scale (1.0 / 32768.0)
+static const float ALIGN(32) floatConsts[24] = {
+	-32768.0f, -32768.0f, -32768.0f, -32768.0f,
+	-32768.0f, -32768.0f, -32768.0f, -32768.0f,
+	 32767.0f,  32767.0f,  32767.0f,  32767.0f,
+	 32767.0f,  32767.0f,  32767.0f,  32767.0f,
+	(1.0f / 32768.0f), (1.0f / 32768.0f), (1.0f / 32768.0f), (1.0f / 32768.0f),
+	(1.0f / 32768.0f), (1.0f / 32768.0f), (1.0f / 32768.0f), (1.0f / 32768.0f),
+};
+
+// xmm/ymm clobbers.
+// gcc only recognizes these if SSE is enabled.
+#ifdef __SSE__
+#define SOUNDMGR_XMM_CLOBBERS , "xmm0", "xmm1", "xmm2", "xmm3"
+#else
+#define SOUNDMGR_XMM_CLOBBERS
+#endif
+#endif /* SOUNDMGR_HAS_MMX */
+
+/** SoundMgrPrivate: AVX2-optimized functions. **/
+
+#ifdef SOUNDMGR_HAS_MMX
+/**
+ * Write stereo audio to a buffer. (AVX2-optimized)
+ * @param dest Destination buffer.
+ * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
+ */
+void SoundMgrPrivate::writeStereo_AVX2(int16_t *dest, int samples)
+{
+	// samples is clamped to std::min(samples, ms_SegLength)
+	// by writeStereo().
+
+	// Source buffer pointers.
+	const int32_t *srcL = &SoundMgr::ms_SegBufL[0];
+	const int32_t *srcR = &SoundMgr::ms_SegBufR[0];
+
+	// Write 16 samples at once using AVX2.
+	// NOTE: dest might only be 16-byte aligned,
+	// so unaligned stores are used.
+	int i = samples;
+	for (; i > 15; i -= 16, srcL += 16, srcR += 16, dest += 32) {
+		__asm__ (
+			"vmovdqu	(%[srcL]), %%ymm0\n"		// %ymm0 = [L8 | L7 | L6 | L5 | L4 | L3 | L2 | L1]
+			"vmovdqu	(%[srcR]), %%ymm1\n"		// %ymm1 = [R8 | R7 | R6 | R5 | R4 | R3 | R2 | R1]
+			"vpunpckldq	%%ymm1, %%ymm0, %%ymm2\n"	// %ymm2 = [R6 | L6 | R5 | L5 | R2 | L2 | R1 | L1]
+			"vpunpckhdq	%%ymm1, %%ymm0, %%ymm3\n"	// %ymm3 = [R8 | L8 | R7 | L7 | R4 | L4 | R3 | L3]
+			"vpackssdw	%%ymm3, %%ymm2, %%ymm0\n"	// %ymm0 = [R8..L5 (16-bit) | R4..L1 (16-bit)]
+			"vmovdqu	%%ymm0, (%[dest])\n"
+
+			"vmovdqu	32(%[srcL]), %%ymm0\n"		// %ymm0 = [L16 | ... | L9]
+			"vmovdqu	32(%[srcR]), %%ymm1\n"		// %ymm1 = [R16 | ... | R9]
+			"vpunpckldq	%%ymm1, %%ymm0, %%ymm2\n"
+			"vpunpckhdq	%%ymm1, %%ymm0, %%ymm3\n"
+			"vpackssdw	%%ymm3, %%ymm2, %%ymm0\n"
+			"vmovdqu	%%ymm0, 32(%[dest])\n"
+			:
+			: [srcL] "r" (srcL), [srcR] "r" (srcR), [dest] "r" (dest)
+			: "memory" SOUNDMGR_XMM_CLOBBERS
+			);
+	}
+
+	// Clear the upper halves of the ymm registers
+	// to prevent SSE transition penalties.
+	__asm__ __volatile__ ("vzeroupper");
+
+	// If the buffer size isn't a multiple of 16 samples,
+	// write the remaining samples normally.
+	for (; i > 0; i--, srcL++, srcR++, dest += 2) {
+		*(dest+0) = clamp(*srcL);
+		*(dest+1) = clamp(*srcR);
+	}
+}
+
+/**
+ * Write monaural audio to a buffer. (AVX2-optimized)
+ * @param dest Destination buffer.
+ * @param samples Number of samples in the buffer. (1 sample == 2 bytes)
+ */
+void SoundMgrPrivate::writeMono_AVX2(int16_t *dest, int samples)
+{
+	// samples is clamped to std::min(samples, ms_SegLength)
+	// by writeMono().
+
+	// Source buffer pointers.
+	const int32_t *srcL = &SoundMgr::ms_SegBufL[0];
+	const int32_t *srcR = &SoundMgr::ms_SegBufR[0];
+
+	// Write 16 samples at once using AVX2.
+	int i = samples;
+	for (; i > 15; i -= 16, srcL += 16, srcR += 16, dest += 16) {
+		__asm__ (
+			"vmovdqu	(%[srcL]), %%ymm0\n"		// %ymm0 = [L8  | ... | L1]
+			"vmovdqu	32(%[srcL]), %%ymm2\n"		// %ymm2 = [L16 | ... | L9]
+			// NOTE: This may overflow if samples are >= 2^30,
+			// but that shouldn't happen except in unit tests.
+			"vpaddd		(%[srcR]), %%ymm0, %%ymm0\n"
+			"vpaddd		32(%[srcR]), %%ymm2, %%ymm2\n"
+			"vpsrad		$1, %%ymm0, %%ymm0\n"		// %ymm0 = [M8  | ... | M1]
+			"vpsrad		$1, %%ymm2, %%ymm2\n"		// %ymm2 = [M16 | ... | M9]
+			"vpackssdw	%%ymm2, %%ymm0, %%ymm0\n"	// %ymm0 = [M16..M13 | M8..M5 | M12..M9 | M4..M1]
+			"vpermq		$0xD8, %%ymm0, %%ymm0\n"	// %ymm0 = [M16..M13 | M12..M9 | M8..M5 | M4..M1]
+			"vmovdqu	%%ymm0, (%[dest])\n"
+			:
+			: [srcL] "r" (srcL), [srcR] "r" (srcR), [dest] "r" (dest)
+			: "memory" SOUNDMGR_XMM_CLOBBERS
+			);
+	}
+
+	// Clear the upper halves of the ymm registers
+	// to prevent SSE transition penalties.
+	__asm__ __volatile__ ("vzeroupper");
+
+	// If the buffer size isn't a multiple of 16 samples,
+	// write the remaining samples normally.
+	for (; i > 0; i--, srcL++, srcR++, dest++) {
+		// Combine the L and R samples into one sample.
+		const int32_t out = ((*srcL + *srcR) >> 1);
+		*dest = clamp(out);
+	}
+}
+
+/**
+ * Write stereo audio to a float buffer. (AVX2-optimized)
+ * @param dest Destination buffer.
+ * @param samples Number of samples in the buffer. (1 sample == 8 bytes)
+ */
+void SoundMgrPrivate::writeStereoFloat_AVX2(float *dest, int samples)
+{
+	// samples is clamped to std::min(samples, ms_SegLength)
+	// by writeStereoFloat().
+
+	// Source buffer pointers.
+	const int32_t *srcL = &SoundMgr::ms_SegBufL[0];
+	const int32_t *srcR = &SoundMgr::ms_SegBufR[0];
+
+	// Write 8 samples at once using AVX2.
+	int i = samples;
+	for (; i > 7; i -= 8, srcL += 8, srcR += 8, dest += 16) {
+		__asm__ (
+			"vcvtdq2ps	(%[srcL]), %%ymm0\n"		// %ymm0 = [L8 | ... | L1] (float)
+			"vcvtdq2ps	(%[srcR]), %%ymm1\n"		// %ymm1 = [R8 | ... | R1] (float)
+			// Clamp to 16-bit and scale to [-1.0, 1.0).
+			"vmaxps		(%[consts]), %%ymm0, %%ymm0\n"
+			"vmaxps		(%[consts]), %%ymm1, %%ymm1\n"
+			"vminps		32(%[consts]), %%ymm0, %%ymm0\n"
+			"vminps		32(%[consts]), %%ymm1, %%ymm1\n"
+			"vmulps		64(%[consts]), %%ymm0, %%ymm0\n"
+			"vmulps		64(%[consts]), %%ymm1, %%ymm1\n"
+			// Interleave.
+			"vunpcklps	%%ymm1, %%ymm0, %%ymm2\n"	// %ymm2 = [R6 | L6 | R5 | L5 | R2 | L2 | R1 | L1]
+			"vunpckhps	%%ymm1, %%ymm0, %%ymm3\n"	// %ymm3 = [R8 | L8 | R7 | L7 | R4 | L4 | R3 | L3]
+			"vperm2f128	$0x20, %%ymm3, %%ymm2, %%ymm0\n"	// %ymm0 = [R4 | L4 | R3 | L3 | R2 | L2 | R1 | L1]
+			"vperm2f128	$0x31, %%ymm3, %%ymm2, %%ymm1\n"	// %ymm1 = [R8 | L8 | R7 | L7 | R6 | L6 | R5 | L5]
+			"vmovups	%%ymm0, (%[dest])\n"
+			"vmovups	%%ymm1, 32(%[dest])\n"
+			:
+			: [srcL] "r" (srcL), [srcR] "r" (srcR), [dest] "r" (dest),
+			  [consts] "r" (floatConsts)
+			: "memory" SOUNDMGR_XMM_CLOBBERS
+			);
+	}
+
+	// Clear the upper halves of the ymm registers
+	// to prevent SSE transition penalties.
+	__asm__ __volatile__ ("vzeroupper");
+
+	// If the buffer size isn't a multiple of 8 samples,
+	// write the remaining samples normally.
+	for (; i > 0; i--, srcL++, srcR++, dest += 2) {
+		*(dest+0) = clampFloat(*srcL);
+		*(dest+1) = clampFloat(*srcR);
+	}
+}
+
+/**
+ * Write monaural audio to a float buffer. (AVX2-optimized)
+ * @param dest Destination buffer.
+ * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
+ */
+void SoundMgrPrivate::writeMonoFloat_AVX2(float *dest, int samples)
+{
+	// samples is clamped to std::min(samples, ms_SegLength)
+	// by writeMonoFloat().
+
+	// Source buffer pointers.
+	const int32_t *srcL = &SoundMgr::ms_SegBufL[0];
+	const int32_t *srcR = &SoundMgr::ms_SegBufR[0];
+
+	// Write 8 samples at once using AVX2.
+	int i = samples;
+	for (; i > 7; i -= 8, srcL += 8, srcR += 8, dest += 8) {
+		__asm__ (
+			"vmovdqu	(%[srcL]), %%ymm0\n"		// %ymm0 = [L8 | ... | L1]
+			"vpaddd		(%[srcR]), %%ymm0, %%ymm0\n"
+			"vpsrad		$1, %%ymm0, %%ymm0\n"		// %ymm0 = [M8 | ... | M1]
+			"vcvtdq2ps	%%ymm0, %%ymm0\n"
+			// Clamp to 16-bit and scale to [-1.0, 1.0).
+			"vmaxps		(%[consts]), %%ymm0, %%ymm0\n"
+			"vminps		32(%[consts]), %%ymm0, %%ymm0\n"
+			"vmulps		64(%[consts]), %%ymm0, %%ymm0\n"
+			"vmovups	%%ymm0, (%[dest])\n"
+			:
+			: [srcL] "r" (srcL), [srcR] "r" (srcR), [dest] "r" (dest),
+			  [consts] "r" (floatConsts)
+			: "memory" SOUNDMGR_XMM_CLOBBERS
+			);
+	}
+
+	// Clear the upper halves of the ymm registers
+	// to prevent SSE transition penalties.
+	__asm__ __volatile__ ("vzeroupper");
+
+	// If the buffer size isn't a multiple of 8 samples,
+	// write the remaining samples normally.
+	for (; i > 0; i--, srcL++, srcR++, dest++) {
+		// Combine the L and R samples into one sample.
+		const int32_t out = ((*srcL + *srcR) >> 1);
+		*dest = clampFloat(out);
+	}
+}
+#endif /* SOUNDMGR_HAS_MMX */
+
 /** SoundMgrPrivate: SSE-optimized functions. **/
 
 #ifdef SOUNDMGR_HAS_MMX
@@ -169,6 +409,107 @@ void SoundMgrPrivate::writeMono_SSE2(int16_t *dest, int samples)
 		*dest = clamp(out);
         }
 }
+
+/**
+ * Write stereo audio to a float buffer. (SSE2-optimized)
+ * @param dest Destination buffer.
+ * @param samples Number of samples in the buffer. (1 sample == 8 bytes)
+ */
+void SoundMgrPrivate::writeStereoFloat_SSE2(float *dest, int samples)
+{
+	// samples is clamped to std::min(samples, ms_SegLength)
+	// by writeStereoFloat().
+
+	// Source buffer pointers.
+	const int32_t *srcL = &SoundMgr::ms_SegBufL[0];
+	const int32_t *srcR = &SoundMgr::ms_SegBufR[0];
+
+	// Write 4 samples at once using SSE2.
+	assert((uintptr_t)dest % 16 == 0);
+	int i = samples;
+	for (; i > 3; i -= 4, srcL += 4, srcR += 4, dest += 8) {
+		__asm__ (
+			"cvtdq2ps	(%[srcL]), %%xmm0\n"	// %xmm0 = [L4 | L3 | L2 | L1] (float)
+			"cvtdq2ps	(%[srcR]), %%xmm1\n"	// %xmm1 = [R4 | R3 | R2 | R1] (float)
+			// Clamp to 16-bit and scale to [-1.0, 1.0).
+			"maxps		(%[consts]), %%xmm0\n"
+			"maxps		(%[consts]), %%xmm1\n"
+			"minps		32(%[consts]), %%xmm0\n"
+			"minps		32(%[consts]), %%xmm1\n"
+			"mulps		64(%[consts]), %%xmm0\n"
+			"mulps		64(%[consts]), %%xmm1\n"
+			// Interleave.
+			"movaps		%%xmm0, %%xmm2\n"
+			"unpcklps	%%xmm1, %%xmm0\n"	// %xmm0 = [R2 | L2 | R1 | L1]
+			"unpckhps	%%xmm1, %%xmm2\n"	// %xmm2 = [R4 | L4 | R3 | L3]
+			"movaps		%%xmm0, (%[dest])\n"
+			"movaps		%%xmm2, 16(%[dest])\n"
+			:
+			: [srcL] "r" (srcL), [srcR] "r" (srcR), [dest] "r" (dest),
+			  [consts] "r" (floatConsts)
+			: "memory" SOUNDMGR_XMM_CLOBBERS
+			);
+	}
+
+	// If the buffer size isn't a multiple of 4 samples,
+	// write the remaining samples normally.
+	for (; i > 0; i--, srcL++, srcR++, dest += 2) {
+		*(dest+0) = clampFloat(*srcL);
+		*(dest+1) = clampFloat(*srcR);
+	}
+}
+
+/**
+ * Write monaural audio to a float buffer. (SSE2-optimized)
+ * @param dest Destination buffer.
+ * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
+ */
+void SoundMgrPrivate::writeMonoFloat_SSE2(float *dest, int samples)
+{
+	// samples is clamped to std::min(samples, ms_SegLength)
+	// by writeMonoFloat().
+
+	// Source buffer pointers.
+	const int32_t *srcL = &SoundMgr::ms_SegBufL[0];
+	const int32_t *srcR = &SoundMgr::ms_SegBufR[0];
+
+	// Write 8 samples at once using SSE2.
+	assert((uintptr_t)dest % 16 == 0);
+	int i = samples;
+	for (; i > 7; i -= 8, srcL += 8, srcR += 8, dest += 8) {
+		__asm__ (
+			"movdqa		(%[srcL]), %%xmm0\n"	// %xmm0 = [L4 | L3 | L2 | L1]
+			"movdqa		16(%[srcL]), %%xmm2\n"	// %xmm2 = [L8 | L7 | L6 | L5]
+			"paddd		(%[srcR]), %%xmm0\n"
+			"paddd		16(%[srcR]), %%xmm2\n"
+			"psrad		$1, %%xmm0\n"		// %xmm0 = [M4 | M3 | M2 | M1]
+			"psrad		$1, %%xmm2\n"		// %xmm2 = [M8 | M7 | M6 | M5]
+			"cvtdq2ps	%%xmm0, %%xmm0\n"
+			"cvtdq2ps	%%xmm2, %%xmm2\n"
+			// Clamp to 16-bit and scale to [-1.0, 1.0).
+			"maxps		(%[consts]), %%xmm0\n"
+			"maxps		(%[consts]), %%xmm2\n"
+			"minps		32(%[consts]), %%xmm0\n"
+			"minps		32(%[consts]), %%xmm2\n"
+			"mulps		64(%[consts]), %%xmm0\n"
+			"mulps		64(%[consts]), %%xmm2\n"
+			"movaps		%%xmm0, (%[dest])\n"
+			"movaps		%%xmm2, 16(%[dest])\n"
+			:
+			: [srcL] "r" (srcL), [srcR] "r" (srcR), [dest] "r" (dest),
+			  [consts] "r" (floatConsts)
+			: "memory" SOUNDMGR_XMM_CLOBBERS
+			);
+	}
+
+	// If the buffer size isn't a multiple of 8 samples,
+	// write the remaining samples normally.
+	for (; i > 0; i--, srcL++, srcR++, dest++) {
+		// Combine the L and R samples into one sample.
+		const int32_t out = ((*srcL + *srcR) >> 1);
+		*dest = clampFloat(out);
+	}
+}
 #endif /* SOUNDMGR_HAS_MMX */
 
 /** SoundMgrPrivate: MMX-optimized functions. **/
@@ -349,6 +690,51 @@ void SoundMgrPrivate::writeMono_noasm(int16_t *dest, int samples)
 	}
 }
 
+/**
+ * Write stereo audio to a float buffer.
+ * @param dest Destination buffer.
+ * @param samples Number of samples in the buffer. (1 sample == 8 bytes)
+ */
+void SoundMgrPrivate::writeStereoFloat_noasm(float *dest, int samples)
+{
+	// samples is clamped to std::min(samples, ms_SegLength)
+	// by writeStereoFloat().
+
+	// Source buffer pointers.
+	const int32_t *srcL = &SoundMgr::ms_SegBufL[0];
+	const int32_t *srcR = &SoundMgr::ms_SegBufR[0];
+
+	for (int i = samples; i > 0;
+	     i--, srcL++, srcR++, dest += 2)
+	{
+		*(dest+0) = clampFloat(*srcL);
+		*(dest+1) = clampFloat(*srcR);
+	}
+}
+
+/**
+ * Write monaural audio to a float buffer.
+ * @param dest Destination buffer.
+ * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
+ */
+void SoundMgrPrivate::writeMonoFloat_noasm(float *dest, int samples)
+{
+	// samples is clamped to std::min(samples, ms_SegLength)
+	// by writeMonoFloat().
+
+	// Source buffer pointers.
+	const int32_t *srcL = &SoundMgr::ms_SegBufL[0];
+	const int32_t *srcR = &SoundMgr::ms_SegBufR[0];
+
+	for (int i = samples; i > 0;
+	     i--, srcL++, srcR++, dest++)
+	{
+		// NOTE: See writeMono_noasm() regarding overflow.
+		const int32_t out = ((*srcL + *srcR) >> 1);
+		*dest = clampFloat(out);
+	}
+}
+
 /** SoundMgr **/
 
 /**
@@ -360,9 +746,15 @@ void SoundMgrPrivate::writeMono_noasm(int16_t *dest, int samples)
  */
 int SoundMgr::writeStereo(int16_t *dest, int samples)
 {
+	// If rendering at the native rate, resample
+	// the audio into the segment buffers first.
+	SoundMgrPrivate::resampleNative();
+
 	samples = std::min(samples, ms_SegLength);
 #ifdef SOUNDMGR_HAS_MMX
-	if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+	if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+		SoundMgrPrivate::writeStereo_AVX2(dest, samples);
+	} else if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
 		SoundMgrPrivate::writeStereo_SSE2(dest, samples);
 	} else if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
 		SoundMgrPrivate::writeStereo_MMX(dest, samples);
@@ -372,6 +764,9 @@ int SoundMgr::writeStereo(int16_t *dest, int samples)
 		SoundMgrPrivate::writeStereo_noasm(dest, samples);
 	}
 
+	// Save the audio to the WAV file, if necessary.
+	SoundMgrPrivate::captureWav(samples);
+
 	// Clear the segment buffers.
 	// These buffers are additive, so if they aren't cleared,
 	// we'll end up with static.
@@ -390,9 +785,15 @@ int SoundMgr::writeStereo(int16_t *dest, int samples)
  */
 int SoundMgr::writeMono(int16_t *dest, int samples)
 {
+	// If rendering at the native rate, resample
+	// the audio into the segment buffers first.
+	SoundMgrPrivate::resampleNative();
+
 	samples = std::min(samples, ms_SegLength);
 #ifdef SOUNDMGR_HAS_MMX
-	if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+	if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+		SoundMgrPrivate::writeMono_AVX2(dest, samples);
+	} else if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
 		SoundMgrPrivate::writeMono_SSE2(dest, samples);
 	} else if (CPU_Flags & MDP_CPUFLAG_X86_MMX) {
 		SoundMgrPrivate::writeMono_MMX(dest, samples);
@@ -402,6 +803,85 @@ int SoundMgr::writeMono(int16_t *dest, int samples)
 		SoundMgrPrivate::writeMono_noasm(dest, samples);
 	}
 
+	// Save the audio to the WAV file, if necessary.
+	SoundMgrPrivate::captureWav(samples);
+
+	// Clear the segment buffers.
+	// These buffers are additive, so if they aren't cleared,
+	// we'll end up with static.
+	memset(ms_SegBufL, 0, ms_SegLength * sizeof(ms_SegBufL[0]));
+	memset(ms_SegBufR, 0, ms_SegLength * sizeof(ms_SegBufL[0]));
+
+	return samples;
+}
+
+/**
+ * Write stereo audio to a buffer. (32-bit float, interleaved)
+ * Samples are clamped to 16-bit and scaled to [-1.0, 1.0).
+ * This clears the internal audio buffer.
+ * @param dest Destination buffer.
+ * @param samples Number of samples in the buffer. (1 sample == 8 bytes)
+ * @return Number of samples written.
+ */
+int SoundMgr::writeStereoFloat(float *dest, int samples)
+{
+	// If rendering at the native rate, resample
+	// the audio into the segment buffers first.
+	SoundMgrPrivate::resampleNative();
+
+	samples = std::min(samples, ms_SegLength);
+#ifdef SOUNDMGR_HAS_MMX
+	if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+		SoundMgrPrivate::writeStereoFloat_AVX2(dest, samples);
+	} else if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+		SoundMgrPrivate::writeStereoFloat_SSE2(dest, samples);
+	} else
+#endif /* SOUNDMGR_HAS_MMX */
+	{
+		SoundMgrPrivate::writeStereoFloat_noasm(dest, samples);
+	}
+
+	// Save the audio to the WAV file, if necessary.
+	SoundMgrPrivate::captureWav(samples);
+
+	// Clear the segment buffers.
+	// These buffers are additive, so if they aren't cleared,
+	// we'll end up with static.
+	memset(ms_SegBufL, 0, ms_SegLength * sizeof(ms_SegBufL[0]));
+	memset(ms_SegBufR, 0, ms_SegLength * sizeof(ms_SegBufL[0]));
+
+	return samples;
+}
+
+/**
+ * Write monaural audio to a buffer. (32-bit float)
+ * Samples are clamped to 16-bit and scaled to [-1.0, 1.0).
+ * This clears the internal audio buffer.
+ * @param dest Destination buffer.
+ * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
+ * @return Number of samples written.
+ */
+int SoundMgr::writeMonoFloat(float *dest, int samples)
+{
+	// If rendering at the native rate, resample
+	// the audio into the segment buffers first.
+	SoundMgrPrivate::resampleNative();
+
+	samples = std::min(samples, ms_SegLength);
+#ifdef SOUNDMGR_HAS_MMX
+	if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+		SoundMgrPrivate::writeMonoFloat_AVX2(dest, samples);
+	} else if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+		SoundMgrPrivate::writeMonoFloat_SSE2(dest, samples);
+	} else
+#endif /* SOUNDMGR_HAS_MMX */
+	{
+		SoundMgrPrivate::writeMonoFloat_noasm(dest, samples);
+	}
+
+	// Save the audio to the WAV file, if necessary.
+	SoundMgrPrivate::captureWav(samples);
+
 	// Clear the segment buffers.
 	// These buffers are additive, so if they aren't cleared,
 	// we'll end up with static.
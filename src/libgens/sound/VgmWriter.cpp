@@ -0,0 +1,284 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * VgmWriter.cpp: VGM audio log writer.                                    *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "VgmWriter.hpp"
+#include "Util/AsyncWriter.hpp"
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// Byteswapping macros.
+#include "libcompat/byteswap.h"
+
+namespace LibGens {
+
+class VgmWriterPrivate
+{
+	public:
+		VgmWriterPrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		VgmWriterPrivate(const VgmWriterPrivate &);
+		VgmWriterPrivate &operator=(const VgmWriterPrivate &);
+
+	public:
+		AsyncWriter file;
+
+		// Render rate.
+		int renderRate;
+
+		// Timestamps.
+		uint64_t srcPos;	// Render samples since the last rate change.
+		uint64_t vgmBase;	// VGM samples at the last rate change.
+		uint64_t vgmPos;	// VGM samples written as wait commands.
+
+		/**
+		 * Get the current timestamp.
+		 * @return Current timestamp, in VGM samples.
+		 */
+		inline uint64_t curTime(void) const
+		{
+			return vgmBase + (srcPos * VgmWriter::VGM_RATE / renderRate);
+		}
+
+		/**
+		 * Write wait commands up to the current timestamp.
+		 */
+		void sync(void);
+
+		// VGM header.
+		static const uint32_t VGM_VERSION = 0x150;
+		static const uint32_t VGM_HEADER_SIZE = 0x40;
+
+		// VGM commands.
+		enum VgmCommand {
+			VGM_CMD_PSG		= 0x50,
+			VGM_CMD_YM2612_PORT0	= 0x52,
+			VGM_CMD_YM2612_PORT1	= 0x53,
+			VGM_CMD_WAIT		= 0x61,
+			VGM_CMD_WAIT_735	= 0x62,
+			VGM_CMD_WAIT_882	= 0x63,
+			VGM_CMD_END		= 0x66,
+			VGM_CMD_WAIT_SHORT	= 0x70,
+		};
+};
+
+VgmWriterPrivate::VgmWriterPrivate()
+	: renderRate(VgmWriter::VGM_RATE)
+	, srcPos(0)
+	, vgmBase(0)
+	, vgmPos(0)
+{ }
+
+/**
+ * Write wait commands up to the current timestamp.
+ */
+void VgmWriterPrivate::sync(void)
+{
+	const uint64_t now = curTime();
+	while (vgmPos < now) {
+		const uint64_t diff = (now - vgmPos);
+		uint8_t cmd[3];
+		int len;
+		unsigned int wait;
+
+		if (diff <= 16) {
+			// Short wait: 1-16 samples.
+			wait = (unsigned int)diff;
+			cmd[0] = VGM_CMD_WAIT_SHORT | (wait - 1);
+			len = 1;
+		} else if (diff == 735) {
+			// One NTSC frame.
+			wait = 735;
+			cmd[0] = VGM_CMD_WAIT_735;
+			len = 1;
+		} else if (diff == 882) {
+			// One PAL frame.
+			wait = 882;
+			cmd[0] = VGM_CMD_WAIT_882;
+			len = 1;
+		} else {
+			wait = (diff > 0xFFFF ? 0xFFFF : (unsigned int)diff);
+			cmd[0] = VGM_CMD_WAIT;
+			cmd[1] = (wait & 0xFF);
+			cmd[2] = (wait >> 8);
+			len = 3;
+		}
+
+		file.write(cmd, len);
+		vgmPos += wait;
+	}
+}
+
+/** VgmWriter **/
+
+VgmWriter::VgmWriter()
+	: d(new VgmWriterPrivate())
+{ }
+
+VgmWriter::~VgmWriter()
+{
+	close();
+	delete d;
+}
+
+/**
+ * Open a VGM file for writing.
+ * File writes are done on a background thread.
+ * @param filename Filename. (UTF-8)
+ * @param ymClock YM2612 clock, in Hz.
+ * @param psgClock PSG clock, in Hz.
+ * @return 0 on success; negative errno on error.
+ */
+int VgmWriter::open(const char *filename, int ymClock, int psgClock)
+{
+	close();
+	int ret = d->file.open(filename);
+	if (ret != 0)
+		return ret;
+
+	d->srcPos = 0;
+	d->vgmBase = 0;
+	d->vgmPos = 0;
+
+	// Write the VGM header.
+	// EOF offset and total samples are updated in close().
+	uint32_t header[VgmWriterPrivate::VGM_HEADER_SIZE / 4];
+	memset(header, 0, sizeof(header));
+	memcpy(&header[0x00/4], "Vgm ", 4);
+	header[0x08/4] = cpu_to_le32(VgmWriterPrivate::VGM_VERSION);
+	header[0x0C/4] = cpu_to_le32((uint32_t)psgClock);
+	// SN76489 feedback (0x0009) and shift register width (16).
+	header[0x28/4] = cpu_to_le32(0x0009 | (16 << 16));
+	header[0x2C/4] = cpu_to_le32((uint32_t)ymClock);
+	// Data offset is relative to 0x34.
+	header[0x34/4] = cpu_to_le32(VgmWriterPrivate::VGM_HEADER_SIZE - 0x34);
+	d->file.write(header, sizeof(header));
+	return 0;
+}
+
+/**
+ * Close the VGM file.
+ * The end-of-data command is written and
+ * the header is updated with the final lengths.
+ * @return 0 on success; negative errno on error.
+ */
+int VgmWriter::close(void)
+{
+	if (!d->file.isOpen())
+		return 0;
+
+	// Wait until the end of the last rendered block.
+	d->sync();
+	const uint8_t cmd = VgmWriterPrivate::VGM_CMD_END;
+	d->file.write(&cmd, 1);
+
+	// Update the header.
+	const uint32_t eofOffset = cpu_to_le32(d->file.size() - 0x04);
+	const uint32_t samples = cpu_to_le32((uint32_t)d->vgmPos);
+	d->file.writeAt(0x04, &eofOffset, sizeof(eofOffset));
+	d->file.writeAt(0x18, &samples, sizeof(samples));
+	return d->file.close();
+}
+
+/**
+ * Is a VGM file open?
+ * @return True if a VGM file is open.
+ */
+bool VgmWriter::isOpen(void) const
+{
+	return d->file.isOpen();
+}
+
+/**
+ * Set the sound chips' render rate.
+ * Timestamps are converted from this rate to VGM_RATE.
+ * @param rate Render rate, in samples per second.
+ */
+void VgmWriter::setRenderRate(int rate)
+{
+	if (rate <= 0 || rate == d->renderRate)
+		return;
+
+	// Rebase the timestamp so previous samples
+	// keep their original duration.
+	d->vgmBase = d->curTime();
+	d->srcPos = 0;
+	d->renderRate = rate;
+}
+
+/**
+ * Advance the current timestamp.
+ * Register writes are timestamped with the
+ * number of samples rendered so far.
+ * @param samples Number of samples rendered at the render rate.
+ */
+void VgmWriter::advance(int samples)
+{
+	d->srcPos += samples;
+}
+
+/**
+ * Log a YM2612 register write.
+ * @param port Port number. (0 or 1)
+ * @param reg Register number.
+ * @param data Data.
+ */
+void VgmWriter::writeYm2612(int port, uint8_t reg, uint8_t data)
+{
+	if (!d->file.isOpen())
+		return;
+
+	d->sync();
+	const uint8_t cmd[3] = {
+		(uint8_t)(port ? VgmWriterPrivate::VGM_CMD_YM2612_PORT1
+			       : VgmWriterPrivate::VGM_CMD_YM2612_PORT0),
+		reg, data
+	};
+	d->file.write(cmd, sizeof(cmd));
+}
+
+/**
+ * Log a PSG write.
+ * @param data Data.
+ */
+void VgmWriter::writePsg(uint8_t data)
+{
+	if (!d->file.isOpen())
+		return;
+
+	d->sync();
+	const uint8_t cmd[2] = {VgmWriterPrivate::VGM_CMD_PSG, data};
+	d->file.write(cmd, sizeof(cmd));
+}
+
+/**
+ * Get the number of VGM samples logged so far.
+ * @return Number of VGM samples.
+ */
+uint32_t VgmWriter::totalSamples(void) const
+{
+	return (uint32_t)d->curTime();
+}
+
+}
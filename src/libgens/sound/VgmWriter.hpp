@@ -0,0 +1,112 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * VgmWriter.hpp: VGM audio log writer.                                    *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_SOUND_VGMWRITER_HPP__
+#define __LIBGENS_SOUND_VGMWRITER_HPP__
+
+// C includes.
+#include <stdint.h>
+
+namespace LibGens {
+
+class VgmWriterPrivate;
+class VgmWriter
+{
+	public:
+		VgmWriter();
+		~VgmWriter();
+
+	protected:
+		friend class VgmWriterPrivate;
+		VgmWriterPrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		VgmWriter(const VgmWriter &);
+		VgmWriter &operator=(const VgmWriter &);
+
+	public:
+		// VGM sample rate.
+		static const int VGM_RATE = 44100;
+
+		/**
+		 * Open a VGM file for writing.
+		 * File writes are done on a background thread.
+		 * @param filename Filename. (UTF-8)
+		 * @param ymClock YM2612 clock, in Hz.
+		 * @param psgClock PSG clock, in Hz.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int open(const char *filename, int ymClock, int psgClock);
+
+		/**
+		 * Close the VGM file.
+		 * The end-of-data command is written and
+		 * the header is updated with the final lengths.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int close(void);
+
+		/**
+		 * Is a VGM file open?
+		 * @return True if a VGM file is open.
+		 */
+		bool isOpen(void) const;
+
+		/**
+		 * Set the sound chips' render rate.
+		 * Timestamps are converted from this rate to VGM_RATE.
+		 * @param rate Render rate, in samples per second.
+		 */
+		void setRenderRate(int rate);
+
+		/**
+		 * Advance the current timestamp.
+		 * Register writes are timestamped with the
+		 * number of samples rendered so far.
+		 * @param samples Number of samples rendered at the render rate.
+		 */
+		void advance(int samples);
+
+		/**
+		 * Log a YM2612 register write.
+		 * @param port Port number. (0 or 1)
+		 * @param reg Register number.
+		 * @param data Data.
+		 */
+		void writeYm2612(int port, uint8_t reg, uint8_t data);
+
+		/**
+		 * Log a PSG write.
+		 * @param data Data.
+		 */
+		void writePsg(uint8_t data);
+
+		/**
+		 * Get the number of VGM samples logged so far.
+		 * @return Number of VGM samples.
+		 */
+		uint32_t totalSamples(void) const;
+};
+
+}
+
+#endif /* __LIBGENS_SOUND_VGMWRITER_HPP__ */
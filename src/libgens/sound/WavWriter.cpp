@@ -0,0 +1,180 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * WavWriter.cpp: WAV audio writer.                                        *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "WavWriter.hpp"
+#include "Util/AsyncWriter.hpp"
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// Byteswapping macros.
+#include "libcompat/byteswap.h"
+
+namespace LibGens {
+
+class WavWriterPrivate
+{
+	public:
+		WavWriterPrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		WavWriterPrivate(const WavWriterPrivate &);
+		WavWriterPrivate &operator=(const WavWriterPrivate &);
+
+	public:
+		AsyncWriter file;
+		uint32_t samples;
+
+		// WAV header size. (RIFF + fmt + data chunk headers)
+		static const uint32_t WAV_HEADER_SIZE = 44;
+
+		// Conversion buffer.
+		// 1 sample == 2 channels.
+		static const int CONV_SAMPLES = 1024;
+		int16_t conv[CONV_SAMPLES * 2];
+};
+
+WavWriterPrivate::WavWriterPrivate()
+	: samples(0)
+{ }
+
+/** WavWriter **/
+
+WavWriter::WavWriter()
+	: d(new WavWriterPrivate())
+{ }
+
+WavWriter::~WavWriter()
+{
+	close();
+	delete d;
+}
+
+/**
+ * Open a WAV file for writing.
+ * Audio is saved as 16-bit stereo PCM.
+ * File writes are done on a background thread.
+ * @param filename Filename. (UTF-8)
+ * @param rate Sample rate, in Hz.
+ * @return 0 on success; negative errno on error.
+ */
+int WavWriter::open(const char *filename, int rate)
+{
+	close();
+	int ret = d->file.open(filename);
+	if (ret != 0)
+		return ret;
+
+	d->samples = 0;
+
+	// Write the WAV header.
+	// Chunk sizes are updated in close().
+	uint8_t header[WavWriterPrivate::WAV_HEADER_SIZE];
+	uint16_t *const h16 = (uint16_t*)header;
+	uint32_t *const h32 = (uint32_t*)header;
+	memcpy(&header[0], "RIFF", 4);
+	h32[1] = cpu_to_le32(WavWriterPrivate::WAV_HEADER_SIZE - 8);
+	memcpy(&header[8], "WAVEfmt ", 8);
+	h32[4] = cpu_to_le32(16);			// fmt chunk size
+	h16[10] = cpu_to_le16(1);			// PCM
+	h16[11] = cpu_to_le16(2);			// Channels
+	h32[6] = cpu_to_le32((uint32_t)rate);		// Sample rate
+	h32[7] = cpu_to_le32((uint32_t)rate * 4);	// Bytes per second
+	h16[16] = cpu_to_le16(4);			// Block align
+	h16[17] = cpu_to_le16(16);			// Bits per sample
+	memcpy(&header[36], "data", 4);
+	h32[10] = 0;					// data chunk size
+	d->file.write(header, sizeof(header));
+	return 0;
+}
+
+/**
+ * Close the WAV file.
+ * The header is updated with the final lengths.
+ * @return 0 on success; negative errno on error.
+ */
+int WavWriter::close(void)
+{
+	if (!d->file.isOpen())
+		return 0;
+
+	const uint32_t dataSize = d->samples * 4;
+	const uint32_t riffSize = cpu_to_le32(dataSize + WavWriterPrivate::WAV_HEADER_SIZE - 8);
+	const uint32_t dataSize_le = cpu_to_le32(dataSize);
+	d->file.writeAt(4, &riffSize, sizeof(riffSize));
+	d->file.writeAt(40, &dataSize_le, sizeof(dataSize_le));
+	return d->file.close();
+}
+
+/**
+ * Is a WAV file open?
+ * @return True if a WAV file is open.
+ */
+bool WavWriter::isOpen(void) const
+{
+	return d->file.isOpen();
+}
+
+/**
+ * Write a block of audio.
+ * Samples are clamped to 16-bit.
+ * @param bufL Left channel. (32-bit for oversaturation)
+ * @param bufR Right channel. (32-bit for oversaturation)
+ * @param samples Number of samples.
+ */
+void WavWriter::write(const int32_t *bufL, const int32_t *bufR, int samples)
+{
+	if (!d->file.isOpen())
+		return;
+
+	while (samples > 0) {
+		const int len = (samples > WavWriterPrivate::CONV_SAMPLES
+				? WavWriterPrivate::CONV_SAMPLES : samples);
+		int16_t *dest = d->conv;
+		for (int i = 0; i < len; i++, dest += 2) {
+			int32_t L = bufL[i];
+			int32_t R = bufR[i];
+			if (L < -0x8000) L = -0x8000; else if (L > 0x7FFF) L = 0x7FFF;
+			if (R < -0x8000) R = -0x8000; else if (R > 0x7FFF) R = 0x7FFF;
+			dest[0] = cpu_to_le16((int16_t)L);
+			dest[1] = cpu_to_le16((int16_t)R);
+		}
+
+		d->file.write(d->conv, len * 4);
+		d->samples += len;
+		bufL += len;
+		bufR += len;
+		samples -= len;
+	}
+}
+
+/**
+ * Get the number of samples written so far.
+ * @return Number of samples.
+ */
+uint32_t WavWriter::totalSamples(void) const
+{
+	return d->samples;
+}
+
+}
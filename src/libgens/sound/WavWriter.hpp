@@ -0,0 +1,88 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * WavWriter.hpp: WAV audio writer.                                        *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_SOUND_WAVWRITER_HPP__
+#define __LIBGENS_SOUND_WAVWRITER_HPP__
+
+// C includes.
+#include <stdint.h>
+
+namespace LibGens {
+
+class WavWriterPrivate;
+class WavWriter
+{
+	public:
+		WavWriter();
+		~WavWriter();
+
+	protected:
+		friend class WavWriterPrivate;
+		WavWriterPrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		WavWriter(const WavWriter &);
+		WavWriter &operator=(const WavWriter &);
+
+	public:
+		/**
+		 * Open a WAV file for writing.
+		 * Audio is saved as 16-bit stereo PCM.
+		 * File writes are done on a background thread.
+		 * @param filename Filename. (UTF-8)
+		 * @param rate Sample rate, in Hz.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int open(const char *filename, int rate);
+
+		/**
+		 * Close the WAV file.
+		 * The header is updated with the final lengths.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int close(void);
+
+		/**
+		 * Is a WAV file open?
+		 * @return True if a WAV file is open.
+		 */
+		bool isOpen(void) const;
+
+		/**
+		 * Write a block of audio.
+		 * Samples are clamped to 16-bit.
+		 * @param bufL Left channel. (32-bit for oversaturation)
+		 * @param bufR Right channel. (32-bit for oversaturation)
+		 * @param samples Number of samples.
+		 */
+		void write(const int32_t *bufL, const int32_t *bufR, int samples);
+
+		/**
+		 * Get the number of samples written so far.
+		 * @return Number of samples.
+		 */
+		uint32_t totalSamples(void) const;
+};
+
+}
+
+#endif /* __LIBGENS_SOUND_WAVWRITER_HPP__ */
@@ -64,6 +64,12 @@
 // ZOMG YM2612 struct.
 #include "libzomg/zomg_ym2612.h"
 
+// State hash.
+#include "EmuContext/StateHash.hpp"
+
+// VGM logging.
+#include "VgmWriter.hpp"
+
 namespace LibGens {
 
 /** Ym2612Private **/
@@ -146,6 +152,8 @@ int Ym2612Private::LFO_FREQ_TAB[LFO_LENGTH];	// LFO FMS TABLE
 
 Ym2612Private::Ym2612Private(Ym2612 *q)
 	: q(q)
+	, timerTicks(0)
+	, vgmWriter(nullptr)
 {
 	if (!isInit) {
 		// Initialize the static tables.
@@ -389,6 +397,60 @@ inline void Ym2612Private::CSM_Key_Control(void)
 	KEY_ON(&state.CHANNEL[2], 3);
 }
 
+/**
+ * Reload a timer counter after it has overflowed.
+ * More than one period may have elapsed since the
+ * timer was last updated.
+ * @param cnt Timer counter. (<= 0)
+ * @param period Timer period.
+ * @return New timer counter.
+ */
+static inline int reloadTimer(int cnt, int period)
+{
+	if (period <= 0) {
+		// Timer period hasn't been set.
+		return cnt + period;
+	}
+	return period - ((-cnt) % period);
+}
+
+/**
+ * Apply pending timer ticks to timers A and B.
+ */
+void Ym2612Private::updateTimers(void)
+{
+	const int ticks = timerTicks;
+	if (ticks == 0)
+		return;
+	timerTicks = 0;
+
+	if (state.Mode & 1) {
+		// Timer A is ON.
+		if ((state.TimerAcnt -= ticks) <= 0) {
+			state.status |= (state.Mode & 0x04) >> 2;
+			state.TimerAcnt = reloadTimer(state.TimerAcnt, state.TimerAL);
+
+			LOG_MSG(ym2612, LOG_MSG_LEVEL_DEBUG1,
+				"Counter A overflow");
+
+			if (state.Mode & 0x80) {
+				CSM_Key_Control();
+			}
+		}
+	}
+
+	if (state.Mode & 2) {
+		// Timer B is ON.
+		if ((state.TimerBcnt -= ticks) <= 0) {
+			state.status |= (state.Mode & 0x08) >> 2;
+			state.TimerBcnt = reloadTimer(state.TimerBcnt, state.TimerBL);
+
+			LOG_MSG(ym2612, LOG_MSG_LEVEL_DEBUG1,
+				"Counter B overflow");
+		}
+	}
+}
+
 /**
  * Set a value for a slot.
  * @param address Register address.
@@ -681,6 +743,12 @@ int Ym2612Private::CHANNEL_SET(int address, uint8_t data)
  */
 int Ym2612Private::YM_SET(int address, uint8_t data)
 {
+	if (address >= 0x24 && address <= 0x27) {
+		// Timer registers.
+		// Apply pending ticks using the old timer settings.
+		updateTimers();
+	}
+
 	switch (address) {
 		case 0x22:
 			// LFO enable
@@ -1528,6 +1596,7 @@ int Ym2612::reInit(int clock, int rate)
 
 	d->state.Frequence = ((double)(d->state.Clock) / (double)(d->state.Rate)) / 144.0;
 	d->state.TimerBase = (int)(d->state.Frequence * 4096.0);
+	d->timerTicks = 0;
 
 	if (m_improved && (d->state.Frequence > 1.0)) {
 		d->state.Inter_Step = (unsigned int)((1.0 / d->state.Frequence) * (double)(0x4000));
@@ -1637,6 +1706,7 @@ void Ym2612::reset(void)
 	d->state.DACdata = 0;
 
 	d->state.status = 0;
+	d->timerTicks = 0;
 
 	d->state.OPNAadr = 0;
 	d->state.OPNBadr = 0;
@@ -1720,6 +1790,7 @@ uint8_t Ym2612::read(void) const
 	 * OVRA: If 1, timer A has overflowed.
 	 * OVRB: If 1, timer B has overflowed.
 	 */
+	d->updateTimers();
 	return (uint8_t)d->state.status;
 }
 
@@ -1746,6 +1817,9 @@ int Ym2612::write(unsigned int address, uint8_t data)
 			break;
 
 		case 1:
+			if (d->vgmWriter)
+				d->vgmWriter->writeYm2612(0, d->state.OPNAadr, data);
+
 			// Trivial optimization for DAC.
 			if (d->state.OPNAadr == 0x2A) {
 				d->state.DACdata = ((int)data - 0x80) << 7;
@@ -1762,11 +1836,6 @@ int Ym2612::write(unsigned int address, uint8_t data)
 				}
 				d->state.REG[0][d->state.OPNAadr] = data;
 
-				/* TODO: Reimplement GYM dumping support in LibGens.
-				if (GYM_Dumping)
-					gym_dump_update(1, (uint8_t)d->state.OPNAadr, data);
-				*/
-
 				if (reg_num < 0xA0) {
 					d->SLOT_SET(d->state.OPNAadr, data);
 				} else {
@@ -1775,17 +1844,6 @@ int Ym2612::write(unsigned int address, uint8_t data)
 			} else {
 				// YM2612 control registers.
 				d->state.REG[0][d->state.OPNAadr] = data;
-
-				/* TODO: Reimplement GYM dumping support in LibGens.
-				if ((GYM_Dumping) &&
-				    ((d->state.OPNAadr == 0x22) ||
-				     (d->state.OPNAadr == 0x27) ||
-				     (d->state.OPNAadr == 0x28)))
-				{
-					gym_dump_update(1, (uint8_t)d->state.OPNAadr, data);
-				}
-				*/
-
 				d->YM_SET(d->state.OPNAadr, data);
 			}
 			break;
@@ -1795,6 +1853,9 @@ int Ym2612::write(unsigned int address, uint8_t data)
 			break;
 
 		case 3:
+			if (d->vgmWriter)
+				d->vgmWriter->writeYm2612(1, d->state.OPNBadr, data);
+
 			reg_num = d->state.OPNBadr & 0xF0;
 
 			if (reg_num >= 0x30) {
@@ -1806,11 +1867,6 @@ int Ym2612::write(unsigned int address, uint8_t data)
 				}
 				d->state.REG[1][d->state.OPNBadr] = data;
 
-				/* TODO: Reimplement GYM dumping support in LibGens.
-				if (GYM_Dumping)
-					gym_dump_update(2, (uint8_t)d->state.OPNBadr, data);
-				*/
-				
 				if (reg_num < 0xA0) {
 					d->SLOT_SET(d->state.OPNBadr + 0x100, data);
 				} else {
@@ -1944,6 +2000,61 @@ void Ym2612::zomgSave(Zomg_Ym2612Save_t *state) const
 	// TODO: Save other counters and stuff!
 }
 
+/**
+ * Hash the YM2612 state.
+ * This hashes the registers as well as the internal
+ * timer, LFO, channel, and envelope state, so counters
+ * that diverge are attributed to the YM2612 even if
+ * the registers still match.
+ * @param hash State hash to update.
+ */
+void Ym2612::stateHash(StateHash *hash) const
+{
+	const Ym2612Private::state_t &st = d->state;
+	hash->set(StateHash::SS_YM2612, st.REG, sizeof(st.REG));
+
+	// NOTE: The fields are copied into arrays so padding
+	// and the table pointers don't affect the hash.
+	// The table pointers are derived from the registers.
+	const int32_t global[] = {
+		st.status, st.OPNAadr, st.OPNBadr,
+		st.LFOcnt, st.LFOinc,
+		st.TimerA, st.TimerAL, st.TimerAcnt,
+		st.TimerB, st.TimerBL, st.TimerBcnt,
+		st.Mode, st.DAC, st.DACdata,
+		(int32_t)st.Inter_Cnt, (int32_t)st.Inter_Step,
+		// Timer ticks that haven't been evaluated yet.
+		d->timerTicks,
+	};
+	hash->append(StateHash::SS_YM2612, global, sizeof(global));
+
+	for (int i = 0; i < 6; i++) {
+		const Ym2612Private::channel_t &ch = st.CHANNEL[i];
+		const int32_t chan[] = {
+			ch.S0_OUT[0], ch.S0_OUT[1], ch.S0_OUT[2], ch.S0_OUT[3],
+			ch.Old_OUTd, ch.OUTd, ch.LEFT, ch.RIGHT,
+			ch.ALGO, ch.FB, ch.FMS, ch.AMS,
+			ch.FNUM[0], ch.FNUM[1], ch.FNUM[2], ch.FNUM[3],
+			ch.FOCT[0], ch.FOCT[1], ch.FOCT[2], ch.FOCT[3],
+			ch.KC[0], ch.KC[1], ch.KC[2], ch.KC[3],
+			ch.FFlag,
+		};
+		hash->append(StateHash::SS_YM2612, chan, sizeof(chan));
+
+		for (int j = 0; j < 4; j++) {
+			const Ym2612Private::slot_t &sl = ch._SLOT[j];
+			const int32_t slot[] = {
+				sl.MUL, sl.TL, sl.TLL, sl.SLL, sl.KSR_S, sl.KSR, sl.SEG,
+				sl.Fcnt, sl.Finc,
+				sl.Ecurp, sl.Ecnt, sl.Einc, sl.Ecmp,
+				sl.EincA, sl.EincD, sl.EincS, sl.EincR,
+				sl.INd, sl.ChgEnM, sl.AMS, sl.AMSon,
+			};
+			hash->append(StateHash::SS_YM2612, slot, sizeof(slot));
+		}
+	}
+}
+
 /**
  * Restore the YM2612 state.
  * @param state Zomg_Ym2612Save_t struct to restore from.
@@ -2256,34 +2367,19 @@ void Ym2612::updateDacAndTimers(int32_t *bufL, int32_t *bufR, int length)
 	}
 
 	// Update timers.
-	int i = d->state.TimerBase * length;
-	
-	if (d->state.Mode & 1) {
-		// Timer A is ON.
-		//if ((YM2612.TimerAcnt -= 14073) <= 0)           // 13879=NTSC (old: 14475=NTSC  14586=PAL)
-		if ((d->state.TimerAcnt -= i) <= 0) {
-			d->state.status |= (d->state.Mode & 0x04) >> 2;
-			d->state.TimerAcnt += d->state.TimerAL;
-
-			LOG_MSG(ym2612, LOG_MSG_LEVEL_DEBUG1,
-				"Counter A overflow");
-
-			if (d->state.Mode & 0x80) {
-				d->CSM_Key_Control();
-			}
-		}
+	// The timers are evaluated lazily; see Ym2612Private::timerTicks.
+	if (!(d->state.Mode & 3)) {
+		// Both timers are OFF.
+		return;
 	}
-
-	if (d->state.Mode & 2) {
-		// Timer B is ON.
-		//if ((d->state.TimerBcnt -= 14073) <= 0)           // 13879=NTSC (old: 14475=NTSC  14586=PAL)
-		if ((d->state.TimerBcnt -= i) <= 0) {
-			d->state.status |= (d->state.Mode & 0x08) >> 2;
-			d->state.TimerBcnt += d->state.TimerBL;
-
-			LOG_MSG(ym2612, LOG_MSG_LEVEL_DEBUG1,
-				"Counter B overflow");
-		}
+	d->timerTicks += d->state.TimerBase * length;
+	if ((d->state.Mode & 0x81) == 0x81 ||
+	    d->timerTicks >= Ym2612Private::TIMER_TICKS_MAX)
+	{
+		// CSM mode is enabled with timer A ON, so key-on
+		// events must be triggered as soon as timer A overflows.
+		// (Also prevent the pending ticks from overflowing.)
+		d->updateTimers();
 	}
 }
 
@@ -2309,8 +2405,8 @@ void Ym2612::specialUpdate(void)
 	int writePos = SoundMgr::GetWritePos(line_num);
 
 	// Update the PSG buffer pointers.
-	m_bufPtrL = &SoundMgr::ms_SegBufL[writePos];
-	m_bufPtrR = &SoundMgr::ms_SegBufR[writePos];
+	m_bufPtrL = &SoundMgr::ms_RenderBufL[writePos];
+	m_bufPtrR = &SoundMgr::ms_RenderBufR[writePos];
 }
 
 /**
@@ -2326,13 +2422,22 @@ int Ym2612::getReg(int regID) const
 	return d->state.REG[(regID >> 8) & 1][regID & 0xFF];
 }
 
+/**
+ * Set the VGM writer for register write logging.
+ * @param vgmWriter VGM writer, or nullptr to disable logging.
+ */
+void Ym2612::setVgmWriter(VgmWriter *vgmWriter)
+{
+	d->vgmWriter = vgmWriter;
+}
+
 /**
  * Reset the YM2612 buffer pointers.
  */
 void Ym2612::resetBufferPtrs(void)
 {
-	m_bufPtrL = &SoundMgr::ms_SegBufL[0];
-	m_bufPtrR = &SoundMgr::ms_SegBufR[0];
+	m_bufPtrL = &SoundMgr::ms_RenderBufL[0];
+	m_bufPtrR = &SoundMgr::ms_RenderBufR[0];
 }
 
 /* end */
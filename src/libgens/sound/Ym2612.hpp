@@ -30,6 +30,9 @@ struct _Zomg_Ym2612Save_t;
 
 namespace LibGens {
 
+class VgmWriter;
+class StateHash;
+
 class Ym2612Private;
 class Ym2612
 {
@@ -65,11 +68,25 @@ class Ym2612
 		void zomgSave(_Zomg_Ym2612Save_t *state) const;
 		void zomgRestore(const _Zomg_Ym2612Save_t *state);
 
+		/**
+		 * Hash the YM2612 state.
+		 * This hashes the registers as well as the internal
+		 * timer, LFO, channel, and envelope state.
+		 * @param hash State hash to update.
+		 */
+		void stateHash(StateHash *hash) const;
+
 		/** Gens-specific code. **/
 		void updateDacAndTimers(int32_t *bufL, int32_t *bufR, int length);
 		void specialUpdate(void);
 		int getReg(int regID) const;
 
+		/**
+		 * Set the VGM writer for register write logging.
+		 * @param vgmWriter VGM writer, or nullptr to disable logging.
+		 */
+		void setVgmWriter(VgmWriter *vgmWriter);
+
 		// YM write length.
 		inline void addWriteLen(int len)
 			{ m_writeLen += len; }
@@ -32,6 +32,8 @@
 
 namespace LibGens {
 
+class VgmWriter;
+
 class Ym2612;
 class Ym2612Private
 {
@@ -290,6 +292,26 @@ class Ym2612Private
 		// Interpolation calculation.
 		int int_cnt;
 
+		/** Timers. **/
+
+		// Timer ticks that haven't been applied to the timers yet.
+		// The timers are only updated when their state is needed:
+		// status register reads, timer register writes, and
+		// CSM mode, which requires key-on events on overflow.
+		int timerTicks;
+
+		// Maximum number of pending timer ticks.
+		// Prevents overflow if the timers aren't polled.
+		static const int TIMER_TICKS_MAX = 0x40000000;
+
+		/**
+		 * Apply pending timer ticks to timers A and B.
+		 */
+		void updateTimers(void);
+
+		// VGM writer for register write logging.
+		VgmWriter *vgmWriter;
+
 		/** Functions for calculating parameters. **/
 		static void CALC_FINC_SL(slot_t *SL, int finc, int kc);
 		void CALC_FINC_CH(channel_t *CH);
@@ -25,7 +25,8 @@
 #include "libzomg/PngReader.hpp"
 using LibZomg::PngReader;
 
-// LibCompat
+// LibGens, LibCompat
+#include "Util/StripeExecutor.hpp"
 #include "libcompat/cpuflags.h"
 #include "libcompat/aligned_malloc.h"
 
@@ -39,6 +40,24 @@ using LibZomg::PngReader;
 
 namespace LibGens { namespace Tests {
 
+/**
+ * Get test parameters if the CPU supports the specified flags.
+ * Use with ::testing::ValuesIn() for optional instruction sets.
+ * @param flags Test parameters.
+ * @return Vector containing flags, or an empty vector if the CPU doesn't support them.
+ */
+std::vector<EffectTest_flags> EffectTest_ifSupported(const EffectTest_flags &flags)
+{
+	// NOTE: Test parameters are generated by InitGoogleTest(),
+	// which is called after LibGens::Init(), so CPU_Flags
+	// has already been initialized.
+	std::vector<EffectTest_flags> ret;
+	if ((CPU_Flags & flags.cpuFlags) == flags.cpuFlags) {
+		ret.push_back(flags);
+	}
+	return ret;
+}
+
 /**
  * Set up the test.
  */
@@ -74,6 +93,10 @@ void EffectTest::SetUp(void)
 
 	cpuFlags_old = CPU_Flags;
 	CPU_Flags = flags.cpuFlags;
+
+	StripeExecutor *const executor = StripeExecutor::instance();
+	threads_old = executor->threads();
+	executor->setThreads(flags.threads);
 }
 
 /**
@@ -100,6 +123,7 @@ void EffectTest::TearDown(void)
 	}
 
 	CPU_Flags = cpuFlags_old;
+	StripeExecutor::instance()->setThreads(threads_old);
 }
 
 /**
@@ -314,4 +338,21 @@ void EffectTest::compareFb(const MdFb *fb_expected, const MdFb *fb_actual)
 	}
 }
 
+/**
+ * Print the speed of a benchmark.
+ * @param fb		[in] Framebuffer that was processed.
+ * @param iterations	[in] Number of iterations.
+ * @param secs		[in] Elapsed time, in seconds.
+ */
+void EffectTest::printSpeed(const MdFb *fb, int iterations, double secs)
+{
+	const double px = (double)fb->pxPitch() * (double)fb->numLines() * iterations;
+	const ::testing::TestInfo *const info =
+		::testing::UnitTest::GetInstance()->current_test_info();
+	printf("%s.%s: %.1f Mpx/s (%d thread(s))\n",
+		info->test_case_name(), info->name(),
+		(secs > 0 ? (px / secs / 1000000.0) : 0.0),
+		StripeExecutor::instance()->threads());
+}
+
 } }
@@ -28,6 +28,9 @@
 // C includes.
 #include <stdint.h>
 
+// C++ includes.
+#include <vector>
+
 // LibGens, LibZomg
 #include "Util/MdFb.hpp"
 #include "libzomg/img_data.h"
@@ -37,14 +40,24 @@ namespace LibGens { namespace Tests {
 struct EffectTest_flags {
 	uint32_t cpuFlags;
 	uint32_t cpuFlags_slow;
+	int threads;	// Number of effect threads. (0 for automatic)
 
-	EffectTest_flags(uint32_t cpuFlags, uint32_t cpuFlags_slow)
+	EffectTest_flags(uint32_t cpuFlags, uint32_t cpuFlags_slow, int threads = 1)
 	{
 		this->cpuFlags = cpuFlags;
 		this->cpuFlags_slow = cpuFlags_slow;
+		this->threads = threads;
 	}
 };
 
+/**
+ * Get test parameters if the CPU supports the specified flags.
+ * Use with ::testing::ValuesIn() for optional instruction sets.
+ * @param flags Test parameters.
+ * @return Vector containing flags, or an empty vector if the CPU doesn't support them.
+ */
+std::vector<EffectTest_flags> EffectTest_ifSupported(const EffectTest_flags &flags);
+
 class EffectTest : public ::testing::TestWithParam<EffectTest_flags>
 {
 	protected:
@@ -53,7 +66,8 @@ class EffectTest : public ::testing::TestWithParam<EffectTest_flags>
 			, fb_normal(nullptr)
 			, fb_paused(nullptr)
 			, fb_test1(nullptr)
-			, fb_test2(nullptr) { }
+			, fb_test2(nullptr)
+			, threads_old(0) { }
 		virtual ~EffectTest() { }
 
 		virtual void SetUp(void) override;
@@ -109,6 +123,14 @@ class EffectTest : public ::testing::TestWithParam<EffectTest_flags>
 		 */
 		void compareFb(const MdFb *fb_expected, const MdFb *fb_actual);
 
+		/**
+		 * Print the speed of a benchmark.
+		 * @param fb		[in] Framebuffer that was processed.
+		 * @param iterations	[in] Number of iterations.
+		 * @param secs		[in] Elapsed time, in seconds.
+		 */
+		void printSpeed(const MdFb *fb, int iterations, double secs);
+
 	protected:
 		Zomg_Img_Data_t img_normal;
 		Zomg_Img_Data_t img_paused;
@@ -124,6 +146,9 @@ class EffectTest : public ::testing::TestWithParam<EffectTest_flags>
 
 		// Previous CPU flags.
 		uint32_t cpuFlags_old;
+
+		// Previous number of effect threads.
+		int threads_old;
 };
 
 } }
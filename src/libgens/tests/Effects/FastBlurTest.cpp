@@ -152,12 +152,24 @@ INSTANTIATE_TEST_CASE_P(FastBlurTest_NoFlags, FastBlurTest,
 	::testing::Values(EffectTest_flags(0, 0)
 ));
 
-// NOTE: FastBlur.cpp only implements MMX/SSE2 using GNU assembler.
+// Multithreaded. The stripe boundaries must not
+// affect the output image.
+INSTANTIATE_TEST_CASE_P(FastBlurTest_NoFlags_MT, FastBlurTest,
+	::testing::Values(EffectTest_flags(0, 0, 4)
+));
+
+// NOTE: FastBlur.cpp only implements MMX/SSE2/AVX2 using GNU assembler.
 #if defined(__GNUC__) && \
     (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
 INSTANTIATE_TEST_CASE_P(FastBlurTest_MMX, FastBlurTest,
 	::testing::Values(EffectTest_flags(MDP_CPUFLAG_X86_MMX, 0)
 ));
+INSTANTIATE_TEST_CASE_P(FastBlurTest_AVX2, FastBlurTest,
+	::testing::ValuesIn(EffectTest_ifSupported(EffectTest_flags(MDP_CPUFLAG_X86_AVX2, 0))
+));
+INSTANTIATE_TEST_CASE_P(FastBlurTest_AVX2_MT, FastBlurTest,
+	::testing::ValuesIn(EffectTest_ifSupported(EffectTest_flags(MDP_CPUFLAG_X86_AVX2, 0, 4))
+));
 #if 0
 // FIXME: SSE2 Fast Blur is generally slow due to
 // unaligned access requirements.
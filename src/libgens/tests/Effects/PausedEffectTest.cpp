@@ -152,12 +152,24 @@ INSTANTIATE_TEST_CASE_P(PausedEffectTest_NoFlags, PausedEffectTest,
 	::testing::Values(EffectTest_flags(0, 0)
 ));
 
-// NOTE: PausedEffect.cpp only implements MMX/SSE2 using GNU assembler.
+// Multithreaded. The stripe boundaries must not
+// affect the output image.
+INSTANTIATE_TEST_CASE_P(PausedEffectTest_NoFlags_MT, PausedEffectTest,
+	::testing::Values(EffectTest_flags(0, 0, 4)
+));
+
+// NOTE: PausedEffect.cpp only implements MMX/SSE2/AVX2 using GNU assembler.
 #if defined(__GNUC__) && \
     (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
 INSTANTIATE_TEST_CASE_P(PausedEffectTest_MMX, PausedEffectTest,
 	::testing::Values(EffectTest_flags(MDP_CPUFLAG_X86_MMX, 0)
 ));
+INSTANTIATE_TEST_CASE_P(PausedEffectTest_AVX2, PausedEffectTest,
+	::testing::ValuesIn(EffectTest_ifSupported(EffectTest_flags(MDP_CPUFLAG_X86_AVX2, 0))
+));
+INSTANTIATE_TEST_CASE_P(PausedEffectTest_AVX2_MT, PausedEffectTest,
+	::testing::ValuesIn(EffectTest_ifSupported(EffectTest_flags(MDP_CPUFLAG_X86_AVX2, 0, 4))
+));
 INSTANTIATE_TEST_CASE_P(PausedEffectTest_SSE2, PausedEffectTest,
 	::testing::Values(EffectTest_flags(MDP_CPUFLAG_X86_SSE2, MDP_CPUFLAG_X86_SSE2SLOW)
 ));
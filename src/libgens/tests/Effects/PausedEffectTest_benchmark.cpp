@@ -23,6 +23,7 @@
 
 // LibGens, LibCompat
 #include "Effects/PausedEffect.hpp"
+#include "Util/Timing.hpp"
 #include "libcompat/cpuflags.h"
 
 namespace LibGens { namespace Tests {
@@ -50,6 +51,8 @@ TEST_P(PausedEffectTest_benchmark, do15bit_1FB)
 	ASSERT_NO_FATAL_FAILURE(copyToFb15(fb_test1, &img_normal));
 
 	// Run this test BENCHMARK_ITERATIONS times.
+	Timing timing;
+	const double start = timing.getTimeD();
 	const uint32_t fb_sz = fb_test1->pxPitch() * fb_test1->numLines() * 2;
 	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
 		// Copy the initialized framebuffer to fb_test2.
@@ -57,6 +60,7 @@ TEST_P(PausedEffectTest_benchmark, do15bit_1FB)
 		// Apply the "paused" effect. (1-FB version)
 		PausedEffect::DoPausedEffect(fb_test2);
 	}
+	printSpeed(fb_test2, BENCHMARK_ITERATIONS, timing.getTimeD() - start);
 }
 
 /**
@@ -70,10 +74,13 @@ TEST_P(PausedEffectTest_benchmark, do15bit_2FB)
 	ASSERT_NO_FATAL_FAILURE(copyToFb15(fb_test1, &img_normal));
 
 	// Run this test BENCHMARK_ITERATIONS times.
+	Timing timing;
+	const double start = timing.getTimeD();
 	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
 		// Apply the "paused" effect. (2-FB version)
 		PausedEffect::DoPausedEffect(fb_test2, fb_test1);
 	}
+	printSpeed(fb_test2, BENCHMARK_ITERATIONS, timing.getTimeD() - start);
 }
 
 /**
@@ -87,6 +94,8 @@ TEST_P(PausedEffectTest_benchmark, do16bit_1FB)
 	ASSERT_NO_FATAL_FAILURE(copyToFb16(fb_test1, &img_normal));
 
 	// Run this test BENCHMARK_ITERATIONS times.
+	Timing timing;
+	const double start = timing.getTimeD();
 	const uint32_t fb_sz = fb_test1->pxPitch() * fb_test1->numLines() * 2;
 	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
 		// Copy the initialized framebuffer to fb_test2.
@@ -94,6 +103,7 @@ TEST_P(PausedEffectTest_benchmark, do16bit_1FB)
 		// Apply the "paused" effect. (1-FB version)
 		PausedEffect::DoPausedEffect(fb_test2);
 	}
+	printSpeed(fb_test2, BENCHMARK_ITERATIONS, timing.getTimeD() - start);
 }
 
 /**
@@ -107,10 +117,13 @@ TEST_P(PausedEffectTest_benchmark, do16bit_2FB)
 	ASSERT_NO_FATAL_FAILURE(copyToFb16(fb_test1, &img_normal));
 
 	// Run this test BENCHMARK_ITERATIONS times.
+	Timing timing;
+	const double start = timing.getTimeD();
 	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
 		// Apply the "paused" effect. (2-FB version)
 		PausedEffect::DoPausedEffect(fb_test2, fb_test1);
 	}
+	printSpeed(fb_test2, BENCHMARK_ITERATIONS, timing.getTimeD() - start);
 }
 
 /**
@@ -124,6 +137,8 @@ TEST_P(PausedEffectTest_benchmark, do32bit_1FB)
 	ASSERT_NO_FATAL_FAILURE(copyToFb32(fb_test1, &img_normal));
 
 	// Run this test BENCHMARK_ITERATIONS times.
+	Timing timing;
+	const double start = timing.getTimeD();
 	const uint32_t fb_sz = fb_test1->pxPitch() * fb_test1->numLines() * 4;
 	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
 		// Copy the initialized framebuffer to fb_test2.
@@ -131,6 +146,7 @@ TEST_P(PausedEffectTest_benchmark, do32bit_1FB)
 		// Apply the "paused" effect. (1-FB version)
 		PausedEffect::DoPausedEffect(fb_test2);
 	}
+	printSpeed(fb_test2, BENCHMARK_ITERATIONS, timing.getTimeD() - start);
 }
 
 /**
@@ -144,22 +160,34 @@ TEST_P(PausedEffectTest_benchmark, do32bit_2FB)
 	ASSERT_NO_FATAL_FAILURE(copyToFb32(fb_test1, &img_normal));
 
 	// Run this test BENCHMARK_ITERATIONS times.
+	Timing timing;
+	const double start = timing.getTimeD();
 	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
 		// Apply the "paused" effect. (2-FB version)
 		PausedEffect::DoPausedEffect(fb_test2, fb_test1);
 	}
+	printSpeed(fb_test2, BENCHMARK_ITERATIONS, timing.getTimeD() - start);
 }
 
 INSTANTIATE_TEST_CASE_P(PausedEffectTest_benchmark_NoFlags, PausedEffectTest_benchmark,
 	::testing::Values(EffectTest_flags(0, 0)
 ));
+INSTANTIATE_TEST_CASE_P(PausedEffectTest_benchmark_NoFlags_MT, PausedEffectTest_benchmark,
+	::testing::Values(EffectTest_flags(0, 0, 0)
+));
 
-// NOTE: PausedEffect.cpp only implements MMX/SSE2 using GNU assembler.
+// NOTE: PausedEffect.cpp only implements MMX/SSE2/AVX2 using GNU assembler.
 #if defined(__GNUC__) && \
     (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
 INSTANTIATE_TEST_CASE_P(PausedEffectTest_benchmark_MMX, PausedEffectTest_benchmark,
 	::testing::Values(EffectTest_flags(MDP_CPUFLAG_X86_MMX, 0)
 ));
+INSTANTIATE_TEST_CASE_P(PausedEffectTest_benchmark_AVX2, PausedEffectTest_benchmark,
+	::testing::ValuesIn(EffectTest_ifSupported(EffectTest_flags(MDP_CPUFLAG_X86_AVX2, 0))
+));
+INSTANTIATE_TEST_CASE_P(PausedEffectTest_benchmark_AVX2_MT, PausedEffectTest_benchmark,
+	::testing::ValuesIn(EffectTest_ifSupported(EffectTest_flags(MDP_CPUFLAG_X86_AVX2, 0, 0))
+));
 INSTANTIATE_TEST_CASE_P(PausedEffectTest_benchmark_SSE2, PausedEffectTest_benchmark,
 	::testing::Values(EffectTest_flags(MDP_CPUFLAG_X86_SSE2, MDP_CPUFLAG_X86_SSE2SLOW)
 ));
@@ -0,0 +1,517 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * UpscalerTest.cpp: Upscaler test.                                        *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "UpscalerTest.hpp"
+
+// LibGens
+#include "lg_main.hpp"
+
+// LibZomg
+#include "libzomg/PngReader.hpp"
+using LibZomg::PngReader;
+
+// LibCompat
+#include "libcompat/cpuflags.h"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace LibGens { namespace Tests {
+
+// Padding added to the output buffer's pitch, in bytes.
+static const int OUT_PITCH_PADDING = 64;
+
+// Output buffer fill value, used to detect writes
+// outside of the scaled image.
+static const uint8_t OUT_FILL = 0xCD;
+
+/**
+ * Get the base filename for the output reference images.
+ * @return Base filename, e.g. "Upscaler".
+ */
+const char *UpscalerTest::baseFilename(void)
+{
+	return "Upscaler";
+}
+
+/**
+ * Get the render type for the output reference images.
+ * @return Render type, e.g. "Scale2x", "Scale3x", or "xBR2x".
+ */
+const char *UpscalerTest::renderType(void)
+{
+	return m_renderType;
+}
+
+/**
+ * Initialize image data.
+ * The reference image is only loaded for Scale2x/Scale3x and xBR.
+ * @param bpp Color depth.
+ * @param filter Upscaler filter.
+ * @param scale Scale factor.
+ */
+void UpscalerTest::initUpscale(MdFb::ColorDepth bpp, Upscaler::Filter filter, int scale)
+{
+	int bppNum;
+	switch (bpp) {
+		case MdFb::BPP_15:
+			bppNum = 15;
+			break;
+		case MdFb::BPP_16:
+			bppNum = 16;
+			break;
+		case MdFb::BPP_32:
+			bppNum = 32;
+			break;
+		default:
+			ASSERT_TRUE(false) << "bpp is invalid: " << bpp;
+	}
+
+	// Load the original image.
+	char filename[64];
+	snprintf(filename, sizeof(filename), "Effects.Normal.%d.png", bppNum);
+	PngReader reader;
+	int ret = reader.readFromFile(&img_normal, filename,
+			PngReader::RF_INVERTED_ALPHA);
+	ASSERT_EQ(0, ret) << "Error loading \"" << filename << "\": " << strerror(-ret);
+
+	// Copy the original image into an MdFb.
+	fb_normal = new MdFb();
+	fb_normal->setBpp(bpp);
+	ASSERT_EQ(fb_normal->pxPerLine(), (int)img_normal.w);
+	ASSERT_EQ(fb_normal->numLines(),  (int)img_normal.h);
+	switch (bpp) {
+		case MdFb::BPP_15:
+			copyToFb15(fb_normal, &img_normal);
+			break;
+		case MdFb::BPP_16:
+			copyToFb16(fb_normal, &img_normal);
+			break;
+		case MdFb::BPP_32:
+		default:
+			copyToFb32(fb_normal, &img_normal);
+			break;
+	}
+
+	const int outWidth = fb_normal->pxPerLine() * scale;
+	const int outHeight = fb_normal->numLines() * scale;
+
+	if (filter == Upscaler::UF_SCALEX || filter == Upscaler::UF_XBR) {
+		// Load the reference image.
+		if (filter == Upscaler::UF_XBR) {
+			m_renderType = "xBR2x";
+		} else {
+			m_renderType = (scale == 3 ? "Scale3x" : "Scale2x");
+		}
+		snprintf(filename, sizeof(filename), "%s.%s.%d.png",
+			 baseFilename(), renderType(), bppNum);
+		ret = reader.readFromFile(&img_paused, filename,
+				PngReader::RF_INVERTED_ALPHA);
+		ASSERT_EQ(0, ret) << "Error loading \"" << filename << "\": " << strerror(-ret);
+		ASSERT_EQ(32, img_paused.bpp);
+		ASSERT_EQ(outWidth,  (int)img_paused.w);
+		ASSERT_EQ(outHeight, (int)img_paused.h);
+	}
+
+	// Allocate the output buffer.
+	const int bytesPerPx = (bpp == MdFb::BPP_32 ? 4 : 2);
+	m_outPitch = (outWidth * bytesPerPx) + OUT_PITCH_PADDING;
+	m_out.assign(m_outPitch * outHeight, OUT_FILL);
+}
+
+/**
+ * Compare the output buffer to the reference image.
+ * Reference images are 32-bit color; they're converted to
+ * the output buffer's color depth before comparing.
+ * @param bpp Color depth.
+ */
+void UpscalerTest::compareReference(MdFb::ColorDepth bpp)
+{
+	const int bytesPerPx = (bpp == MdFb::BPP_32 ? 4 : 2);
+	for (int y = 0; y < (int)img_paused.h; y++) {
+		const uint32_t *pSrc = (const uint32_t*)
+			((const uint8_t*)img_paused.data + (y * img_paused.pitch));
+		const uint8_t *pOut = &m_out[y * m_outPitch];
+
+		int mismatch = -1;
+		for (int x = 0; x < (int)img_paused.w; x++) {
+			const uint8_t r = (pSrc[x] >> 16) & 0xFF;
+			const uint8_t g = (pSrc[x] >> 8) & 0xFF;
+			const uint8_t b = (pSrc[x] >> 0) & 0xFF;
+
+			bool match;
+			switch (bpp) {
+				case MdFb::BPP_15: {
+					const uint16_t px = ((r & 0xF8) << 7) | ((g & 0xF8) << 2) | ((b & 0xF8) >> 3);
+					match = (((const uint16_t*)pOut)[x] == px);
+					break;
+				}
+				case MdFb::BPP_16: {
+					const uint16_t px = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | ((b & 0xF8) >> 3);
+					match = (((const uint16_t*)pOut)[x] == px);
+					break;
+				}
+				case MdFb::BPP_32:
+				default:
+					// Ignore the alpha channel.
+					match = ((((const uint32_t*)pOut)[x] & 0xFFFFFF) == (pSrc[x] & 0xFFFFFF));
+					break;
+			}
+			if (!match) {
+				mismatch = x;
+				break;
+			}
+		}
+		EXPECT_EQ(-1, mismatch) <<
+			"Line " << y << " did not match the reference image.";
+
+		// The padding must not be modified.
+		const uint8_t *pPad = pOut + (img_paused.w * bytesPerPx);
+		for (int i = 0; i < OUT_PITCH_PADDING; i++) {
+			if (pPad[i] != OUT_FILL) {
+				ADD_FAILURE() << "Line " << y << ": padding was modified.";
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Compare the output buffer to the nearest-neighbor
+ * scaled "normal" image.
+ * @param bpp Color depth.
+ * @param scale Scale factor.
+ */
+void UpscalerTest::compareNearest(MdFb::ColorDepth bpp, int scale)
+{
+	const int outWidth = fb_normal->pxPerLine() * scale;
+	const int outHeight = fb_normal->numLines() * scale;
+	for (int y = 0; y < outHeight; y++) {
+		const uint8_t *pOut = &m_out[y * m_outPitch];
+		int mismatch = -1;
+		if (bpp == MdFb::BPP_32) {
+			const uint32_t *pSrc = fb_normal->lineBuf32(y / scale);
+			for (int x = 0; x < outWidth; x++) {
+				if (((const uint32_t*)pOut)[x] != pSrc[x / scale]) {
+					mismatch = x;
+					break;
+				}
+			}
+		} else {
+			const uint16_t *pSrc = fb_normal->lineBuf16(y / scale);
+			for (int x = 0; x < outWidth; x++) {
+				if (((const uint16_t*)pOut)[x] != pSrc[x / scale]) {
+					mismatch = x;
+					break;
+				}
+			}
+		}
+		EXPECT_EQ(-1, mismatch) <<
+			"Line " << y << " did not match the source image.";
+	}
+}
+
+/**
+ * Test nearest-neighbor scaling in 15-bit color.
+ */
+TEST_P(UpscalerTest, nearest15bit)
+{
+	for (int scale = 2; scale <= 4; scale++) {
+		SCOPED_TRACE(scale);
+		ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_15, Upscaler::UF_NEAREST, scale));
+		ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+						 Upscaler::UF_NEAREST, scale));
+		compareNearest(MdFb::BPP_15, scale);
+
+		// Reset the images for the next scale factor.
+		free(img_normal.data);
+		img_normal.data = nullptr;
+		fb_normal->unref();
+		fb_normal = nullptr;
+	}
+}
+
+/**
+ * Test nearest-neighbor scaling in 16-bit color.
+ */
+TEST_P(UpscalerTest, nearest16bit)
+{
+	for (int scale = 2; scale <= 4; scale++) {
+		SCOPED_TRACE(scale);
+		ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_16, Upscaler::UF_NEAREST, scale));
+		ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+						 Upscaler::UF_NEAREST, scale));
+		compareNearest(MdFb::BPP_16, scale);
+
+		// Reset the images for the next scale factor.
+		free(img_normal.data);
+		img_normal.data = nullptr;
+		fb_normal->unref();
+		fb_normal = nullptr;
+	}
+}
+
+/**
+ * Test nearest-neighbor scaling in 32-bit color.
+ */
+TEST_P(UpscalerTest, nearest32bit)
+{
+	for (int scale = 2; scale <= 4; scale++) {
+		SCOPED_TRACE(scale);
+		ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_32, Upscaler::UF_NEAREST, scale));
+		ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+						 Upscaler::UF_NEAREST, scale));
+		compareNearest(MdFb::BPP_32, scale);
+
+		// Reset the images for the next scale factor.
+		free(img_normal.data);
+		img_normal.data = nullptr;
+		fb_normal->unref();
+		fb_normal = nullptr;
+	}
+}
+
+/**
+ * Test Scale2x in 15-bit color.
+ */
+TEST_P(UpscalerTest, scale2x15bit)
+{
+	ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_15, Upscaler::UF_SCALEX, 2));
+	ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+					 Upscaler::UF_SCALEX, 2));
+	compareReference(MdFb::BPP_15);
+}
+
+/**
+ * Test Scale2x in 16-bit color.
+ */
+TEST_P(UpscalerTest, scale2x16bit)
+{
+	ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_16, Upscaler::UF_SCALEX, 2));
+	ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+					 Upscaler::UF_SCALEX, 2));
+	compareReference(MdFb::BPP_16);
+}
+
+/**
+ * Test Scale2x in 32-bit color.
+ */
+TEST_P(UpscalerTest, scale2x32bit)
+{
+	ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_32, Upscaler::UF_SCALEX, 2));
+	ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+					 Upscaler::UF_SCALEX, 2));
+	compareReference(MdFb::BPP_32);
+}
+
+/**
+ * Test Scale3x in 15-bit color.
+ */
+TEST_P(UpscalerTest, scale3x15bit)
+{
+	ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_15, Upscaler::UF_SCALEX, 3));
+	ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+					 Upscaler::UF_SCALEX, 3));
+	compareReference(MdFb::BPP_15);
+}
+
+/**
+ * Test Scale3x in 16-bit color.
+ */
+TEST_P(UpscalerTest, scale3x16bit)
+{
+	ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_16, Upscaler::UF_SCALEX, 3));
+	ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+					 Upscaler::UF_SCALEX, 3));
+	compareReference(MdFb::BPP_16);
+}
+
+/**
+ * Test Scale3x in 32-bit color.
+ */
+TEST_P(UpscalerTest, scale3x32bit)
+{
+	ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_32, Upscaler::UF_SCALEX, 3));
+	ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+					 Upscaler::UF_SCALEX, 3));
+	compareReference(MdFb::BPP_32);
+}
+
+/**
+ * Test xBR 2x in 15-bit color.
+ */
+TEST_P(UpscalerTest, xbr2x15bit)
+{
+	ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_15, Upscaler::UF_XBR, 2));
+	ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+					 Upscaler::UF_XBR, 2));
+	compareReference(MdFb::BPP_15);
+}
+
+/**
+ * Test xBR 2x in 16-bit color.
+ */
+TEST_P(UpscalerTest, xbr2x16bit)
+{
+	ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_16, Upscaler::UF_XBR, 2));
+	ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+					 Upscaler::UF_XBR, 2));
+	compareReference(MdFb::BPP_16);
+}
+
+/**
+ * Test xBR 2x in 32-bit color.
+ */
+TEST_P(UpscalerTest, xbr2x32bit)
+{
+	ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_32, Upscaler::UF_XBR, 2));
+	ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+					 Upscaler::UF_XBR, 2));
+	compareReference(MdFb::BPP_32);
+}
+
+/**
+ * Upscaling a range of lines should match the same lines
+ * of the full image, and nothing else should be written.
+ */
+TEST_P(UpscalerTest, upscaleLines)
+{
+	static const Upscaler::Filter filters[] = {
+		Upscaler::UF_NEAREST, Upscaler::UF_SCALEX, Upscaler::UF_XBR
+	};
+	static const int first = 50, count = 20;
+
+	for (int i = 0; i < (int)(sizeof(filters) / sizeof(filters[0])); i++) {
+		const Upscaler::Filter filter = filters[i];
+		SCOPED_TRACE(filter);
+		ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_32, filter, 2));
+
+		// Upscale the entire image.
+		ASSERT_EQ(0, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+						 filter, 2));
+		const std::vector<uint8_t> full = m_out;
+
+		// Upscale the line range.
+		m_out.assign(m_out.size(), OUT_FILL);
+		ASSERT_EQ(0, Upscaler::DoUpscaleLines(m_out.data(), m_outPitch, fb_normal,
+						      filter, 2, first, count));
+		const int outBytesPerLine = fb_normal->pxPerLine() * 2 * 4;
+		for (int y = 0; y < fb_normal->numLines() * 2; y++) {
+			const uint8_t *const pOut = &m_out[y * m_outPitch];
+			if (y >= first * 2 && y < (first + count) * 2) {
+				EXPECT_EQ(0, memcmp(pOut, &full[y * m_outPitch], outBytesPerLine)) <<
+					"Line " << y << " did not match the full image.";
+			} else {
+				for (int x = 0; x < outBytesPerLine; x++) {
+					if (pOut[x] != OUT_FILL) {
+						ADD_FAILURE() << "Line " << y << " was modified.";
+						break;
+					}
+				}
+			}
+		}
+
+		// The range must be within the source image.
+		EXPECT_EQ(-EINVAL, Upscaler::DoUpscaleLines(m_out.data(), m_outPitch,
+					fb_normal, filter, 2, -1, count));
+		EXPECT_EQ(-EINVAL, Upscaler::DoUpscaleLines(m_out.data(), m_outPitch,
+					fb_normal, filter, 2, fb_normal->numLines() - 1, 2));
+
+		// Reset the images for the next filter.
+		free(img_normal.data);
+		img_normal.data = nullptr;
+		free(img_paused.data);
+		img_paused.data = nullptr;
+		fb_normal->unref();
+		fb_normal = nullptr;
+	}
+}
+
+/**
+ * Unsupported scale factors and undersized buffers should be rejected.
+ */
+TEST_P(UpscalerTest, invalidParams)
+{
+	ASSERT_NO_FATAL_FAILURE(initUpscale(MdFb::BPP_32, Upscaler::UF_NEAREST, 2));
+
+	EXPECT_FALSE(Upscaler::isSupported(Upscaler::UF_NEAREST, 1));
+	EXPECT_FALSE(Upscaler::isSupported(Upscaler::UF_NEAREST, 5));
+	EXPECT_FALSE(Upscaler::isSupported(Upscaler::UF_SCALEX, 4));
+	EXPECT_FALSE(Upscaler::isSupported(Upscaler::UF_XBR, 3));
+	EXPECT_FALSE(Upscaler::isSupported(Upscaler::UF_MAX, 2));
+
+	EXPECT_EQ(-EINVAL, Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal,
+					       Upscaler::UF_SCALEX, 4));
+	EXPECT_EQ(-EINVAL, Upscaler::DoUpscale(m_out.data(), m_outPitch, nullptr,
+					       Upscaler::UF_NEAREST, 2));
+	EXPECT_EQ(-EINVAL, Upscaler::DoUpscale(m_out.data(), fb_normal->pxPerLine() * 4,
+					       fb_normal, Upscaler::UF_NEAREST, 2));
+
+	// Nothing should have been written.
+	for (size_t i = 0; i < m_out.size(); i++) {
+		if (m_out[i] != OUT_FILL) {
+			ADD_FAILURE() << "Output buffer was modified at byte " << i << ".";
+			break;
+		}
+	}
+}
+
+INSTANTIATE_TEST_CASE_P(UpscalerTest_NoFlags, UpscalerTest,
+	::testing::Values(EffectTest_flags(0, 0)
+));
+
+// Multithreaded. The stripe boundaries must not
+// affect the output image.
+INSTANTIATE_TEST_CASE_P(UpscalerTest_NoFlags_MT, UpscalerTest,
+	::testing::Values(EffectTest_flags(0, 0, 4)
+));
+
+// NOTE: Upscaler.cpp only implements SSE2 using GNU assembler.
+#if defined(__GNUC__) && \
+    (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
+INSTANTIATE_TEST_CASE_P(UpscalerTest_SSE2, UpscalerTest,
+	::testing::ValuesIn(EffectTest_ifSupported(EffectTest_flags(MDP_CPUFLAG_X86_SSE2, 0))
+));
+INSTANTIATE_TEST_CASE_P(UpscalerTest_SSE2_MT, UpscalerTest,
+	::testing::ValuesIn(EffectTest_ifSupported(EffectTest_flags(MDP_CPUFLAG_X86_SSE2, 0, 4))
+));
+#endif
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Upscaler test.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,94 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * UpscalerTest.hpp: Upscaler test.                                        *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_TESTS_EFFECTS_UPSCALERTEST_HPP
+#define __LIBGENS_TESTS_EFFECTS_UPSCALERTEST_HPP
+
+#include "EffectTest.hpp"
+
+// LibGens
+#include "Effects/Upscaler.hpp"
+
+// C++ includes.
+#include <vector>
+
+namespace LibGens { namespace Tests {
+
+class UpscalerTest : public EffectTest
+{
+	protected:
+		UpscalerTest()
+			: EffectTest()
+			, m_renderType("Scale2x")
+			, m_outPitch(0) { }
+		virtual ~UpscalerTest() { }
+
+		/**
+		 * Get the base filename for the output reference images.
+		 * @return Base filename, e.g. "Upscaler".
+		 */
+		virtual const char *baseFilename(void) override;
+
+		/**
+		 * Get the render type for the output reference images.
+		 * @return Render type, e.g. "Scale2x", "Scale3x", or "xBR2x".
+		 */
+		virtual const char *renderType(void) override;
+
+		/**
+		 * Initialize image data.
+		 * The reference image is only loaded for Scale2x/Scale3x and xBR.
+		 * @param bpp Color depth.
+		 * @param filter Upscaler filter.
+		 * @param scale Scale factor.
+		 */
+		void initUpscale(MdFb::ColorDepth bpp, Upscaler::Filter filter, int scale);
+
+		/**
+		 * Compare the output buffer to the reference image.
+		 * Reference images are 32-bit color; they're converted to
+		 * the output buffer's color depth before comparing.
+		 * @param bpp Color depth.
+		 */
+		void compareReference(MdFb::ColorDepth bpp);
+
+		/**
+		 * Compare the output buffer to the nearest-neighbor
+		 * scaled "normal" image.
+		 * @param bpp Color depth.
+		 * @param scale Scale factor.
+		 */
+		void compareNearest(MdFb::ColorDepth bpp, int scale);
+
+	protected:
+		// Reference image render type.
+		const char *m_renderType;
+
+		// Output buffer.
+		// The pitch is padded to make sure it's used
+		// instead of the width.
+		std::vector<uint8_t> m_out;
+		int m_outPitch;
+};
+
+} }
+
+#endif /* __LIBGENS_TESTS_EFFECTS_UPSCALERTEST_HPP */
@@ -0,0 +1,144 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * UpscalerTest_benchmark.cpp: Upscaler benchmarks.                        *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "UpscalerTest.hpp"
+
+// LibGens, LibCompat
+#include "Util/Timing.hpp"
+#include "libcompat/cpuflags.h"
+
+namespace LibGens { namespace Tests {
+
+class UpscalerTest_benchmark : public UpscalerTest
+{
+	protected:
+		UpscalerTest_benchmark()
+			: UpscalerTest() { }
+		virtual ~UpscalerTest_benchmark() { }
+
+		/**
+		 * Run a benchmark.
+		 * @param bpp Color depth.
+		 * @param filter Upscaler filter.
+		 * @param scale Scale factor.
+		 */
+		void benchmark(MdFb::ColorDepth bpp, Upscaler::Filter filter, int scale);
+
+	protected:
+		// Run benchmark loops 500 times.
+		static const int BENCHMARK_ITERATIONS = 500;
+};
+
+/**
+ * Run a benchmark.
+ * @param bpp Color depth.
+ * @param filter Upscaler filter.
+ * @param scale Scale factor.
+ */
+void UpscalerTest_benchmark::benchmark(MdFb::ColorDepth bpp, Upscaler::Filter filter, int scale)
+{
+	// Initialize the images.
+	ASSERT_NO_FATAL_FAILURE(initUpscale(bpp, filter, scale));
+
+	// Run this test BENCHMARK_ITERATIONS times.
+	Timing timing;
+	const double start = timing.getTimeD();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		Upscaler::DoUpscale(m_out.data(), m_outPitch, fb_normal, filter, scale);
+	}
+	printSpeed(fb_normal, BENCHMARK_ITERATIONS, timing.getTimeD() - start);
+}
+
+/**
+ * Benchmark nearest-neighbor 2x in 16-bit color.
+ */
+TEST_P(UpscalerTest_benchmark, nearest2x16bit)
+{
+	benchmark(MdFb::BPP_16, Upscaler::UF_NEAREST, 2);
+}
+
+/**
+ * Benchmark nearest-neighbor 2x in 32-bit color.
+ */
+TEST_P(UpscalerTest_benchmark, nearest2x32bit)
+{
+	benchmark(MdFb::BPP_32, Upscaler::UF_NEAREST, 2);
+}
+
+/**
+ * Benchmark nearest-neighbor 4x in 32-bit color.
+ */
+TEST_P(UpscalerTest_benchmark, nearest4x32bit)
+{
+	benchmark(MdFb::BPP_32, Upscaler::UF_NEAREST, 4);
+}
+
+/**
+ * Benchmark Scale2x in 16-bit color.
+ */
+TEST_P(UpscalerTest_benchmark, scale2x16bit)
+{
+	benchmark(MdFb::BPP_16, Upscaler::UF_SCALEX, 2);
+}
+
+/**
+ * Benchmark Scale2x in 32-bit color.
+ */
+TEST_P(UpscalerTest_benchmark, scale2x32bit)
+{
+	benchmark(MdFb::BPP_32, Upscaler::UF_SCALEX, 2);
+}
+
+/**
+ * Benchmark Scale3x in 32-bit color.
+ */
+TEST_P(UpscalerTest_benchmark, scale3x32bit)
+{
+	benchmark(MdFb::BPP_32, Upscaler::UF_SCALEX, 3);
+}
+
+/**
+ * Benchmark xBR 2x in 32-bit color.
+ */
+TEST_P(UpscalerTest_benchmark, xbr2x32bit)
+{
+	benchmark(MdFb::BPP_32, Upscaler::UF_XBR, 2);
+}
+
+INSTANTIATE_TEST_CASE_P(UpscalerTest_benchmark_NoFlags, UpscalerTest_benchmark,
+	::testing::Values(EffectTest_flags(0, 0)
+));
+INSTANTIATE_TEST_CASE_P(UpscalerTest_benchmark_NoFlags_MT, UpscalerTest_benchmark,
+	::testing::Values(EffectTest_flags(0, 0, 0)
+));
+
+// NOTE: Upscaler.cpp only implements SSE2 using GNU assembler.
+#if defined(__GNUC__) && \
+    (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
+INSTANTIATE_TEST_CASE_P(UpscalerTest_benchmark_SSE2, UpscalerTest_benchmark,
+	::testing::ValuesIn(EffectTest_ifSupported(EffectTest_flags(MDP_CPUFLAG_X86_SSE2, 0))
+));
+INSTANTIATE_TEST_CASE_P(UpscalerTest_benchmark_SSE2_MT, UpscalerTest_benchmark,
+	::testing::ValuesIn(EffectTest_ifSupported(EffectTest_flags(MDP_CPUFLAG_X86_SSE2, 0, 0))
+));
+#endif
+
+} }
@@ -0,0 +1,248 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * InputMovieTest.cpp: Input movie tests.                                  *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens
+#include "lg_main.hpp"
+#include "EmuContext/InputMovie.hpp"
+#include "IO/IoManager.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+
+namespace LibGens { namespace Tests {
+
+class InputMovieTest : public ::testing::Test
+{
+	protected:
+		InputMovieTest() { }
+		virtual ~InputMovieTest() { }
+
+		virtual void SetUp(void) override
+		{
+			m_ioManager.setDevType(IoManager::VIRTPORT_1, IoManager::IOT_6BTN);
+			m_ioManager.setDevType(IoManager::VIRTPORT_2, IoManager::IOT_3BTN);
+		}
+
+		virtual void TearDown(void) override
+		{
+			m_movie.close();
+			remove(filename());
+		}
+
+		static const char *filename(void)
+		{
+			return "InputMovieTest.gmv";
+		}
+
+		/**
+		 * Record a movie with one hashed frame per hash.
+		 * @param hashes Hashes.
+		 * @param count Number of hashes.
+		 */
+		void recordHashes(const uint32_t *hashes, int count)
+		{
+			ASSERT_EQ(0, m_movie.record(filename(), 0x12345678, SysVersion::REGION_US_NTSC));
+			for (int i = 0; i < count; i++) {
+				ASSERT_EQ(0, m_movie.beginFrame(&m_ioManager));
+				ASSERT_TRUE(m_movie.endFrame(hashes[i]));
+			}
+			ASSERT_EQ(0, m_movie.close());
+		}
+
+	protected:
+		InputMovie m_movie;
+		IoManager m_ioManager;
+
+		// B button. (active low)
+		static const uint32_t BTN_B = 0x10;
+};
+
+/**
+ * Device types, buttons, events, and hashes
+ * should be played back as they were recorded.
+ */
+TEST_F(InputMovieTest, roundTrip)
+{
+	ASSERT_EQ(0, m_movie.record(filename(), 0x12345678, SysVersion::REGION_US_NTSC));
+	EXPECT_EQ(InputMovie::MODE_RECORD, m_movie.mode());
+
+	// Frame 0: No input.
+	ASSERT_EQ(0, m_movie.beginFrame(&m_ioManager));
+	ASSERT_TRUE(m_movie.endFrame(0x11));
+
+	// Frame 1: B pressed.
+	m_ioManager.update(IoManager::VIRTPORT_1, ~BTN_B);
+	ASSERT_EQ(0, m_movie.beginFrame(&m_ioManager));
+	ASSERT_TRUE(m_movie.endFrame(0x22));
+
+	// Frame 2: Soft reset. B is still pressed.
+	m_movie.recordSoftReset();
+	ASSERT_EQ(0, m_movie.beginFrame(&m_ioManager));
+	ASSERT_TRUE(m_movie.endFrame(0x33));
+
+	// Frame 3: Region change. B released. No hash.
+	m_movie.recordRegion(SysVersion::REGION_EU_PAL);
+	m_ioManager.update(IoManager::VIRTPORT_1, ~0U);
+	ASSERT_EQ(0, m_movie.beginFrame(&m_ioManager));
+	ASSERT_TRUE(m_movie.endFrame());
+	EXPECT_EQ(4U, m_movie.frame());
+	ASSERT_EQ(0, m_movie.close());
+	EXPECT_EQ(InputMovie::MODE_NONE, m_movie.mode());
+
+	// Play it back on a new I/O Manager.
+	IoManager ioManager;
+	ASSERT_EQ(0, m_movie.play(filename()));
+	EXPECT_EQ(InputMovie::MODE_PLAY, m_movie.mode());
+	EXPECT_EQ(0x12345678U, m_movie.romCrc32());
+	EXPECT_EQ(SysVersion::REGION_US_NTSC, m_movie.region());
+	EXPECT_TRUE(m_movie.zomgFilename().empty());
+	EXPECT_EQ(4U, m_movie.frameCount());
+
+	EXPECT_EQ(0, m_movie.beginFrame(&ioManager));
+	EXPECT_EQ(IoManager::IOT_6BTN, ioManager.devType(IoManager::VIRTPORT_1));
+	EXPECT_EQ(IoManager::IOT_3BTN, ioManager.devType(IoManager::VIRTPORT_2));
+	EXPECT_EQ(~0U, ioManager.buttons(IoManager::VIRTPORT_1));
+	EXPECT_TRUE(m_movie.endFrame(0x11));
+
+	EXPECT_EQ(0, m_movie.beginFrame(&ioManager));
+	EXPECT_EQ(~BTN_B, ioManager.buttons(IoManager::VIRTPORT_1));
+	EXPECT_TRUE(m_movie.endFrame(0x22));
+
+	EXPECT_EQ(InputMovie::EVENT_SOFT_RESET, m_movie.beginFrame(&ioManager));
+	EXPECT_EQ(~BTN_B, ioManager.buttons(IoManager::VIRTPORT_1));
+	EXPECT_TRUE(m_movie.endFrame(0x33));
+	EXPECT_FALSE(m_movie.isFinished());
+
+	EXPECT_EQ(InputMovie::EVENT_REGION, m_movie.beginFrame(&ioManager));
+	EXPECT_EQ(SysVersion::REGION_EU_PAL, m_movie.region());
+	EXPECT_EQ(~0U, ioManager.buttons(IoManager::VIRTPORT_1));
+	EXPECT_TRUE(m_movie.endFrame(0x44));
+	EXPECT_TRUE(m_movie.isFinished());
+	EXPECT_EQ(-1, m_movie.desyncFrame());
+}
+
+/**
+ * The first frame with a different hash should be reported.
+ */
+TEST_F(InputMovieTest, desync)
+{
+	static const uint32_t hashes[] = {1, 2, 3, 4};
+	ASSERT_NO_FATAL_FAILURE(recordHashes(hashes, 4));
+
+	ASSERT_EQ(0, m_movie.play(filename()));
+	static const uint32_t played[] = {1, 5, 3, 6};
+	static const bool match[] = {true, false, true, false};
+	for (int i = 0; i < 4; i++) {
+		EXPECT_EQ(0, m_movie.beginFrame(&m_ioManager));
+		EXPECT_EQ(match[i], m_movie.endFrame(played[i]));
+	}
+	EXPECT_TRUE(m_movie.isFinished());
+	EXPECT_EQ(1, m_movie.desyncFrame());
+}
+
+/**
+ * Frames with no input changes should take one byte,
+ * plus four bytes for the hash.
+ */
+TEST_F(InputMovieTest, compact)
+{
+	static const uint32_t hashes[] = {1, 2, 3, 4, 5, 6, 7, 8};
+	ASSERT_NO_FATAL_FAILURE(recordHashes(hashes, 8));
+
+	FILE *f = fopen(filename(), "rb");
+	ASSERT_TRUE(f != nullptr);
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fclose(f);
+
+	// The first frame also stores all device types.
+	// Button states are only stored when they change.
+	EXPECT_EQ(0x14 + (IoManager::VIRTPORT_MAX * 3) + (8 * 5), size);
+}
+
+/**
+ * The starting savestate should be stored.
+ */
+TEST_F(InputMovieTest, startState)
+{
+	ASSERT_EQ(0, m_movie.record(filename(), 0, SysVersion::REGION_JP_NTSC, "start.zomg"));
+	ASSERT_EQ(0, m_movie.close());
+
+	ASSERT_EQ(0, m_movie.play(filename()));
+	EXPECT_EQ(SysVersion::REGION_JP_NTSC, m_movie.region());
+	EXPECT_EQ("start.zomg", m_movie.zomgFilename());
+	EXPECT_EQ(0U, m_movie.frameCount());
+	EXPECT_TRUE(m_movie.isFinished());
+}
+
+/**
+ * Invalid movies should be rejected.
+ */
+TEST_F(InputMovieTest, invalid)
+{
+	EXPECT_EQ(-ENOENT, m_movie.play("InputMovieTest.nonexistent"));
+	EXPECT_EQ(-EINVAL, m_movie.record(filename(), 0, SysVersion::REGION_AUTO));
+	EXPECT_EQ(-EBADF, m_movie.beginFrame(&m_ioManager));
+
+	// Bad magic number.
+	FILE *f = fopen(filename(), "wb");
+	ASSERT_TRUE(f != nullptr);
+	fputs("Not a movie file.   ", f);
+	fclose(f);
+	EXPECT_EQ(-EINVAL, m_movie.play(filename()));
+	EXPECT_EQ(InputMovie::MODE_NONE, m_movie.mode());
+
+	// Truncated button record.
+	static const uint32_t hashes[] = {1};
+	ASSERT_NO_FATAL_FAILURE(recordHashes(hashes, 1));
+	f = fopen(filename(), "ab");
+	ASSERT_TRUE(f != nullptr);
+	fputc(0x02, f);
+	fputc(0x00, f);
+	fclose(f);
+	ASSERT_EQ(0, m_movie.play(filename()));
+	EXPECT_EQ(0, m_movie.beginFrame(&m_ioManager));
+	EXPECT_TRUE(m_movie.endFrame(1));
+	EXPECT_EQ(-EINVAL, m_movie.beginFrame(&m_ioManager));
+	EXPECT_TRUE(m_movie.isFinished());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Input movie tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,170 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * IoManagerInputQueueTest.cpp: Sub-frame input tests.                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens
+#include "lg_main.hpp"
+#include "IO/IoManager.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+namespace LibGens { namespace Tests {
+
+class IoManagerInputQueueTest : public ::testing::Test
+{
+	protected:
+		IoManagerInputQueueTest()
+			: m_ioManager(nullptr) { }
+		virtual ~IoManagerInputQueueTest() { }
+
+		virtual void SetUp(void) override
+		{
+			// 3-button controller on port 1, with TH set
+			// to output 1 so reads return ?1CBRLDU.
+			m_ioManager = new IoManager();
+			m_ioManager->setDevType(IoManager::VIRTPORT_1, IoManager::IOT_3BTN);
+			m_ioManager->writeCtrlMD(IoManager::PHYSPORT_1, 0x40);
+			m_ioManager->writeDataMD(IoManager::PHYSPORT_1, 0x40);
+			m_ioManager->setInputQueue(&m_queue);
+		}
+
+		virtual void TearDown(void) override
+		{
+			delete m_ioManager;
+			m_ioManager = nullptr;
+		}
+
+		/**
+		 * Push a button state for port 1.
+		 * @param buttons Button state. (active low)
+		 * @param timestamp Timestamp.
+		 */
+		void push(uint32_t buttons, uint64_t timestamp)
+		{
+			IoManager::InputEvent event;
+			event.virtPort = IoManager::VIRTPORT_1;
+			event.buttons = buttons;
+			event.timestamp = timestamp;
+			m_queue.push(event);
+		}
+
+		/**
+		 * Read port 1's buttons.
+		 * @return CBRLDU. (active low)
+		 */
+		uint8_t read(void)
+		{
+			return (m_ioManager->readDataMD(IoManager::PHYSPORT_1) & 0x3F);
+		}
+
+		/**
+		 * Run scanlines.
+		 * @param lines Number of scanlines.
+		 */
+		void scanlines(int lines)
+		{
+			for (; lines > 0; lines--) {
+				m_ioManager->doScanline();
+			}
+		}
+
+	protected:
+		IoManager *m_ioManager;
+		IoManager::InputQueue m_queue;
+
+		// B button. (active low)
+		static const uint32_t BTN_B = 0x10;
+};
+
+/**
+ * Events should be applied when the port is read,
+ * not when they're pushed.
+ */
+TEST_F(IoManagerInputQueueTest, appliedOnRead)
+{
+	EXPECT_EQ(0x3F, read());
+	EXPECT_EQ(0U, m_ioManager->lastInputTimestamp());
+
+	push(~BTN_B, 100);
+	EXPECT_FALSE(m_queue.isEmpty());
+	EXPECT_EQ((uint8_t)(0x3F & ~BTN_B), read());
+	EXPECT_TRUE(m_queue.isEmpty());
+	EXPECT_EQ(100U, m_ioManager->lastInputTimestamp());
+}
+
+/**
+ * A press and release that arrive between two reads
+ * should still be seen by the next poll.
+ */
+TEST_F(IoManagerInputQueueTest, shortPressIsHeld)
+{
+	push(~BTN_B, 100);
+	push(~0U, 101);
+
+	// The press is applied first, and the release
+	// is held for the rest of the poll.
+	EXPECT_EQ((uint8_t)(0x3F & ~BTN_B), read());
+	scanlines(2);
+	EXPECT_EQ((uint8_t)(0x3F & ~BTN_B), read());
+	EXPECT_EQ(100U, m_ioManager->lastInputTimestamp());
+
+	// Next poll.
+	scanlines(262);
+	EXPECT_EQ(0x3F, read());
+	EXPECT_EQ(101U, m_ioManager->lastInputTimestamp());
+}
+
+/**
+ * Without an input queue, update() should be used as before.
+ */
+TEST_F(IoManagerInputQueueTest, noQueue)
+{
+	m_ioManager->setInputQueue(nullptr);
+	EXPECT_TRUE(m_ioManager->inputQueue() == nullptr);
+
+	push(~BTN_B, 100);
+	EXPECT_EQ(0x3F, read());
+	EXPECT_FALSE(m_queue.isEmpty());
+
+	m_ioManager->update(IoManager::VIRTPORT_1, ~BTN_B);
+	EXPECT_EQ((uint8_t)(0x3F & ~BTN_B), read());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Sub-frame input tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
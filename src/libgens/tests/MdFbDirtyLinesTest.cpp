@@ -0,0 +1,223 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * MdFbDirtyLinesTest.cpp: MdFb dirty line tracking tests.                 *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens
+#include "lg_main.hpp"
+#include "Util/MdFb.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+namespace LibGens { namespace Tests {
+
+class MdFbDirtyLinesTest : public ::testing::Test
+{
+	protected:
+		MdFbDirtyLinesTest()
+			: ::testing::Test()
+			, fb(nullptr) { }
+		virtual ~MdFbDirtyLinesTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		/**
+		 * Commit all lines and clear the dirty lines,
+		 * as if a frame was rendered and uploaded.
+		 */
+		void commitAll(void);
+
+		MdFb *fb;
+};
+
+/**
+ * Create an MdFb with no dirty lines.
+ */
+void MdFbDirtyLinesTest::SetUp(void)
+{
+	fb = new MdFb();
+	commitAll();
+}
+
+/**
+ * Release the MdFb.
+ */
+void MdFbDirtyLinesTest::TearDown(void)
+{
+	fb->unref();
+	fb = nullptr;
+}
+
+/**
+ * Commit all lines and clear the dirty lines,
+ * as if a frame was rendered and uploaded.
+ */
+void MdFbDirtyLinesTest::commitAll(void)
+{
+	for (int y = 0; y < fb->numLines(); y++) {
+		fb->commitLine(y);
+	}
+	fb->clearDirty();
+}
+
+/**
+ * A new MdFb should be entirely dirty.
+ */
+TEST_F(MdFbDirtyLinesTest, newFbIsDirty)
+{
+	MdFb *newFb = new MdFb();
+	EXPECT_TRUE(newFb->isDirty());
+	int count;
+	EXPECT_EQ(0, newFb->nextDirtyRange(0, &count));
+	EXPECT_EQ(newFb->numLines(), count);
+	newFb->unref();
+}
+
+/**
+ * Only lines whose contents changed should be marked dirty.
+ */
+TEST_F(MdFbDirtyLinesTest, commitLine)
+{
+	EXPECT_FALSE(fb->isDirty());
+
+	// Re-rendering identical lines isn't a change.
+	commitAll();
+	EXPECT_FALSE(fb->isDirty());
+
+	fb->lineBuf32(10)[0] = 0x123456;
+	fb->lineBuf32(11)[fb->pxPerLine() - 1] = 0x654321;
+	for (int y = 0; y < fb->numLines(); y++) {
+		EXPECT_EQ(y == 10 || y == 11, fb->commitLine(y)) << "line " << y;
+	}
+	EXPECT_TRUE(fb->isDirty());
+
+	int count;
+	EXPECT_EQ(10, fb->nextDirtyRange(0, &count));
+	EXPECT_EQ(2, count);
+	EXPECT_EQ(-1, fb->nextDirtyRange(12, &count));
+	EXPECT_EQ(0, count);
+
+	// Changing a line back is also a change.
+	fb->clearDirty();
+	fb->lineBuf32(10)[0] = 0;
+	EXPECT_TRUE(fb->commitLine(10));
+}
+
+/**
+ * Pixels outside of the visible area shouldn't affect dirty lines.
+ */
+TEST_F(MdFbDirtyLinesTest, offscreenPixels)
+{
+	fb->lineBuf32(20)[-1] = 0xFFFFFF;
+	fb->lineBuf32(20)[fb->pxPerLine()] = 0xFFFFFF;
+	EXPECT_FALSE(fb->commitLine(20));
+}
+
+/**
+ * Dirty ranges should be split at clean lines
+ * and span 32-line boundaries.
+ */
+TEST_F(MdFbDirtyLinesTest, nextDirtyRange)
+{
+	fb->markLineDirty(0);
+	for (int y = 30; y < 70; y++) {
+		fb->markLineDirty(y);
+	}
+	fb->markLineDirty(fb->numLines() - 1);
+
+	int count;
+	EXPECT_EQ(0, fb->nextDirtyRange(0, &count));
+	EXPECT_EQ(1, count);
+	EXPECT_EQ(30, fb->nextDirtyRange(1, &count));
+	EXPECT_EQ(40, count);
+	EXPECT_EQ(35, fb->nextDirtyRange(35, &count));
+	EXPECT_EQ(35, count);
+	EXPECT_EQ(fb->numLines() - 1, fb->nextDirtyRange(70, &count));
+	EXPECT_EQ(1, count);
+	EXPECT_EQ(-1, fb->nextDirtyRange(fb->numLines(), &count));
+}
+
+/**
+ * Lines modified without commitLine() must be
+ * dirty on the next commitLine(), even if the
+ * contents match the last committed contents.
+ */
+TEST_F(MdFbDirtyLinesTest, markLineDirty)
+{
+	// e.g. an effect modifies the line...
+	fb->lineBuf32(5)[0] = 0xFF00FF;
+	fb->markLineDirty(5);
+	EXPECT_TRUE(fb->isLineDirty(5));
+	fb->clearDirty();
+
+	// ...and the renderer restores the original contents.
+	fb->lineBuf32(5)[0] = 0;
+	EXPECT_TRUE(fb->commitLine(5));
+}
+
+/**
+ * Clearing the screen and changing the color depth
+ * should mark all lines as dirty.
+ */
+TEST_F(MdFbDirtyLinesTest, markAllDirty)
+{
+	int count;
+
+	fb->clear();
+	EXPECT_EQ(0, fb->nextDirtyRange(0, &count));
+	EXPECT_EQ(fb->numLines(), count);
+	commitAll();
+
+	// Same color depth: no change.
+	fb->setBpp(MdFb::BPP_32);
+	EXPECT_FALSE(fb->isDirty());
+
+	fb->setBpp(MdFb::BPP_16);
+	EXPECT_EQ(0, fb->nextDirtyRange(0, &count));
+	EXPECT_EQ(fb->numLines(), count);
+
+	// 16-bit lines should be hashed correctly.
+	commitAll();
+	fb->lineBuf16(100)[fb->pxPerLine() - 1] = 0x1234;
+	EXPECT_TRUE(fb->commitLine(100));
+	EXPECT_FALSE(fb->commitLine(101));
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: MdFb dirty line tracking tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,248 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * MdFbIndexedTest.cpp: MdFb indexed color tests.                          *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens
+#include "lg_main.hpp"
+#include "Util/MdFb.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+namespace LibGens { namespace Tests {
+
+class MdFbIndexedTest : public ::testing::Test
+{
+	protected:
+		MdFbIndexedTest()
+			: ::testing::Test()
+			, fb(nullptr) { }
+		virtual ~MdFbIndexedTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		/**
+		 * Render a line filled with a single palette index.
+		 * @param line Line number.
+		 * @param idx Palette index.
+		 * @param serial Palette serial number.
+		 */
+		void renderLine(int line, uint8_t idx, uint32_t serial);
+
+		/**
+		 * Fill the test palettes.
+		 * palA[i] == 0x10000 + i; palB[i] == 0x20000 + i
+		 */
+		void initPalettes(void);
+
+		MdFb *fb;
+		uint32_t palA[256];
+		uint32_t palB[256];
+		uint16_t pal16[256];
+};
+
+/**
+ * Create an indexed MdFb.
+ */
+void MdFbIndexedTest::SetUp(void)
+{
+	fb = new MdFb();
+	fb->setIndexed(true);
+	ASSERT_TRUE(fb->isIndexed());
+	initPalettes();
+}
+
+/**
+ * Release the MdFb.
+ */
+void MdFbIndexedTest::TearDown(void)
+{
+	fb->unref();
+	fb = nullptr;
+}
+
+/**
+ * Fill the test palettes.
+ * palA[i] == 0x10000 + i; palB[i] == 0x20000 + i
+ */
+void MdFbIndexedTest::initPalettes(void)
+{
+	for (int i = 0; i < 256; i++) {
+		palA[i] = 0x10000 + i;
+		palB[i] = 0x20000 + i;
+		pal16[i] = (uint16_t)(0x8000 | i);
+	}
+}
+
+/**
+ * Render a line filled with a single palette index.
+ * @param line Line number.
+ * @param idx Palette index.
+ * @param serial Palette serial number.
+ */
+void MdFbIndexedTest::renderLine(int line, uint8_t idx, uint32_t serial)
+{
+	memset(fb->lineBuf8(line), idx, fb->pxPerLine());
+	if (fb->bpp() == MdFb::BPP_32) {
+		fb->setLinePalette(line, (serial & 1) ? palA : palB, serial);
+	} else {
+		fb->setLinePalette(line, pal16, serial);
+	}
+	fb->commitLine(line);
+}
+
+/**
+ * Each line should be converted using the palette
+ * that was active when it was rendered.
+ */
+TEST_F(MdFbIndexedTest, linePalettes)
+{
+	// Palette A for lines 0-99; palette B for lines 100+.
+	for (int y = 0; y < fb->numLines(); y++) {
+		renderLine(y, (uint8_t)y, (y < 100 ? 1 : 2));
+	}
+	fb->resolve();
+
+	for (int y = 0; y < fb->numLines(); y++) {
+		const uint32_t expected = (y < 100 ? palA[y] : palB[y]);
+		EXPECT_EQ(expected, fb->lineBuf32(y)[0]) << "line " << y;
+		EXPECT_EQ(expected, fb->lineBuf32(y)[fb->pxPerLine() - 1]) << "line " << y;
+	}
+}
+
+/**
+ * INDEX_BLACK should always be black.
+ */
+TEST_F(MdFbIndexedTest, indexBlack)
+{
+	renderLine(0, MdFb::INDEX_BLACK, 1);
+	fb->lineBuf8(0)[0] = 0x12;
+	fb->commitLine(0);
+	fb->resolve();
+	EXPECT_EQ(palA[0x12], fb->lineBuf32(0)[0]);
+	EXPECT_EQ(0U, fb->lineBuf32(0)[1]);
+}
+
+/**
+ * 15/16-bit palettes should be converted to 16-bit pixels.
+ */
+TEST_F(MdFbIndexedTest, resolve16)
+{
+	fb->setBpp(MdFb::BPP_16);
+	renderLine(10, 0x34, 3);
+	fb->resolve();
+	EXPECT_EQ(pal16[0x34], fb->lineBuf16(10)[0]);
+	EXPECT_EQ(pal16[0x34], fb->lineBuf16(10)[fb->pxPerLine() - 1]);
+}
+
+/**
+ * Lines without a palette are RGB lines,
+ * and must not be overwritten by resolve().
+ */
+TEST_F(MdFbIndexedTest, rgbLines)
+{
+	for (int y = 0; y < fb->numLines(); y++) {
+		renderLine(y, 0x01, 1);
+	}
+	fb->resolve();
+
+	// e.g. the VDP error screen.
+	fb->clearLinePalettes();
+	fb->lineBuf32(5)[0] = 0xABCDEF;
+	fb->resolve();
+	EXPECT_EQ(0xABCDEFU, fb->lineBuf32(5)[0]);
+}
+
+/**
+ * Changing a line's palette should mark it dirty
+ * and reconvert it, even if the indexes are the same.
+ */
+TEST_F(MdFbIndexedTest, paletteChange)
+{
+	for (int y = 0; y < fb->numLines(); y++) {
+		renderLine(y, 0x05, 1);
+	}
+	fb->resolve();
+	fb->clearDirty();
+
+	// Same indexes and palette.
+	renderLine(20, 0x05, 1);
+	EXPECT_FALSE(fb->isDirty());
+
+	// Same indexes; new palette.
+	renderLine(20, 0x05, 2);
+	EXPECT_TRUE(fb->isLineDirty(20));
+	EXPECT_FALSE(fb->isLineDirty(21));
+	fb->resolve();
+	EXPECT_EQ(palB[0x05], fb->lineBuf32(20)[0]);
+	EXPECT_EQ(palA[0x05], fb->lineBuf32(21)[0]);
+}
+
+/**
+ * copyFrom() should copy the indexes and palettes.
+ * Disabling indexed color mode should convert all lines.
+ */
+TEST_F(MdFbIndexedTest, copyFrom)
+{
+	for (int y = 0; y < fb->numLines(); y++) {
+		renderLine(y, (uint8_t)y, (y < 50 ? 1 : 2));
+	}
+	fb->clearLinePalettes();
+	fb->lineBuf32(0)[0] = 0x123456;
+	for (int y = 1; y < fb->numLines(); y++) {
+		renderLine(y, (uint8_t)y, (y < 50 ? 1 : 2));
+	}
+
+	MdFb *copy = new MdFb();
+	copy->copyFrom(fb);
+	EXPECT_TRUE(copy->isIndexed());
+	copy->setIndexed(false);
+	EXPECT_FALSE(copy->isIndexed());
+
+	EXPECT_EQ(0x123456U, copy->lineBuf32(0)[0]);
+	for (int y = 1; y < fb->numLines(); y++) {
+		const uint32_t expected = (y < 50 ? palA[y] : palB[y]);
+		EXPECT_EQ(expected, copy->lineBuf32(y)[0]) << "line " << y;
+	}
+	copy->unref();
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: MdFb indexed color tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,214 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * MdFbTripleBufferTest.cpp: MdFb triple buffer and MPSC queue tests.      *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens
+#include "lg_main.hpp"
+#include "Util/MdFb.hpp"
+#include "Util/MdFbTripleBuffer.hpp"
+#include "Util/MpscQueue.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+// C++ includes.
+#include <thread>
+#include <vector>
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+/**
+ * Frames should be consumed in order, and only once.
+ */
+TEST(MdFbTripleBufferTest, publishConsume)
+{
+	MdFbTripleBuffer tb;
+	EXPECT_FALSE(tb.consume());
+
+	tb.backBuffer()->lineBuf32(0)[0] = 1;
+	tb.publish();
+	ASSERT_TRUE(tb.consume());
+	EXPECT_EQ(1U, tb.frontBuffer()->lineBuf32(0)[0]);
+	EXPECT_FALSE(tb.consume());
+
+	// If the consumer falls behind, only the
+	// most recent frame should be consumed.
+	tb.backBuffer()->lineBuf32(0)[0] = 2;
+	tb.publish();
+	tb.backBuffer()->lineBuf32(0)[0] = 3;
+	tb.publish();
+	ASSERT_TRUE(tb.consume());
+	EXPECT_EQ(3U, tb.frontBuffer()->lineBuf32(0)[0]);
+
+	// The front buffer must never be handed to the producer.
+	const MdFb *front = tb.frontBuffer();
+	for (int i = 0; i < 4; i++) {
+		EXPECT_NE(front, tb.backBuffer());
+		tb.publish();
+	}
+}
+
+/**
+ * MdFb::copyFrom() should copy the image parameters.
+ */
+TEST(MdFbTripleBufferTest, copyFrom)
+{
+	MdFb *src = new MdFb();
+	src->setBpp(MdFb::BPP_16);
+	src->setImgWidth(256);
+	src->lineBuf16(10)[20] = 0x1234;
+
+	MdFbTripleBuffer tb;
+	tb.backBuffer()->copyFrom(src);
+	tb.publish();
+	src->unref();
+
+	ASSERT_TRUE(tb.consume());
+	const MdFb *front = tb.frontBuffer();
+	EXPECT_EQ(MdFb::BPP_16, front->bpp());
+	EXPECT_EQ(256, front->imgWidth());
+	EXPECT_EQ(0x1234, front->lineBuf16(10)[20]);
+}
+
+/**
+ * The consumer should see complete frames while
+ * the producer is publishing on another thread.
+ */
+TEST(MdFbTripleBufferTest, threaded)
+{
+	static const unsigned int FRAMES = 5000;
+	MdFbTripleBuffer tb;
+
+	std::thread producer([&tb] {
+		for (unsigned int frame = 1; frame <= FRAMES; frame++) {
+			MdFb *fb = tb.backBuffer();
+			const int lines = fb->numLines();
+			for (int y = 0; y < lines; y++) {
+				fb->lineBuf32(y)[0] = frame;
+			}
+			tb.publish();
+		}
+	});
+
+	unsigned int last = 0;
+	while (last < FRAMES) {
+		if (!tb.consume())
+			continue;
+
+		const MdFb *fb = tb.frontBuffer();
+		const unsigned int frame = fb->lineBuf32(0)[0];
+		EXPECT_GT(frame, last);
+		EXPECT_EQ(frame, fb->lineBuf32(fb->numLines() - 1)[0]);
+		last = frame;
+	}
+
+	producer.join();
+}
+
+/**
+ * Items should be popped in the order they were pushed.
+ */
+TEST(MpscQueueTest, fifo)
+{
+	MpscQueue<int> q;
+	int item;
+	EXPECT_TRUE(q.isEmpty());
+	EXPECT_FALSE(q.pop(&item));
+
+	for (int i = 0; i < 3; i++) {
+		q.push(i);
+	}
+	EXPECT_FALSE(q.isEmpty());
+	for (int i = 0; i < 3; i++) {
+		ASSERT_TRUE(q.pop(&item));
+		EXPECT_EQ(i, item);
+	}
+	EXPECT_TRUE(q.isEmpty());
+	EXPECT_FALSE(q.pop(&item));
+
+	// The queue should still work after being emptied.
+	q.push(42);
+	EXPECT_FALSE(q.isEmpty());
+	ASSERT_TRUE(q.pop(&item));
+	EXPECT_EQ(42, item);
+	EXPECT_TRUE(q.isEmpty());
+}
+
+/**
+ * Items from multiple producers should all be popped,
+ * in order for each producer.
+ */
+TEST(MpscQueueTest, multipleProducers)
+{
+	static const int PRODUCERS = 4;
+	static const int ITEMS = 10000;
+	MpscQueue<int> q;
+
+	vector<std::thread> producers;
+	for (int p = 0; p < PRODUCERS; p++) {
+		producers.push_back(std::thread([&q, p] {
+			for (int i = 0; i < ITEMS; i++) {
+				q.push((p << 16) | i);
+			}
+		}));
+	}
+
+	vector<int> next(PRODUCERS, 0);
+	int count = 0;
+	while (count < PRODUCERS * ITEMS) {
+		int item;
+		if (!q.pop(&item))
+			continue;
+
+		const int p = (item >> 16);
+		ASSERT_GE(p, 0);
+		ASSERT_LT(p, PRODUCERS);
+		EXPECT_EQ(next[p], (item & 0xFFFF));
+		next[p]++;
+		count++;
+	}
+
+	for (size_t i = 0; i < producers.size(); i++) {
+		producers[i].join();
+	}
+	EXPECT_TRUE(q.isEmpty());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: MdFbTripleBuffer tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
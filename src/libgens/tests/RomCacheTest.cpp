@@ -0,0 +1,361 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * RomCacheTest.cpp: ROM cache test.                                       *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+#include "libgensfile/RomCache.hpp"
+using LibGensFile::RomCache;
+
+// zlib.
+#include <zlib.h>
+
+// C includes.
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <unistd.h>
+#include <utime.h>
+#endif
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+class RomCacheTest : public ::testing::Test
+{
+	protected:
+		RomCacheTest()
+			: ::testing::Test() { }
+		virtual ~RomCacheTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		/**
+		 * Create a test ROM image.
+		 * @param seed Random seed.
+		 * @param size ROM size.
+		 * @return ROM image.
+		 */
+		static vector<uint8_t> makeRom(uint32_t seed, size_t size);
+
+		/**
+		 * Write a gzipped ROM file.
+		 * The file is stored without compression, so
+		 * the file size only depends on the ROM size.
+		 * @param data ROM image.
+		 * @return True on success; false on error.
+		 */
+		static bool writeGzip(const vector<uint8_t> &data);
+
+		/**
+		 * Set a file's modification time.
+		 * @param filename Filename.
+		 * @param mtime Modification time.
+		 */
+		static void setMtime(const char *filename, time_t mtime);
+
+		// Temporary filenames.
+		static const char cacheDir[];
+		static const char filename[];
+};
+
+const char RomCacheTest::cacheDir[] = "RomCacheTest.cache";
+const char RomCacheTest::filename[] = "RomCacheTest.gz";
+
+/**
+ * Create the cache directory.
+ */
+void RomCacheTest::SetUp(void)
+{
+#ifdef _WIN32
+	_mkdir(cacheDir);
+#else
+	mkdir(cacheDir, 0777);
+#endif
+}
+
+/**
+ * Remove the temporary files.
+ */
+void RomCacheTest::TearDown(void)
+{
+	Rom::SetRomCache(nullptr);
+	remove(filename);
+
+	vector<string> files;
+	RomCache::listFiles(cacheDir, &files);
+	for (size_t i = 0; i < files.size(); i++) {
+		remove(files[i].c_str());
+	}
+#ifdef _WIN32
+	_rmdir(cacheDir);
+#else
+	rmdir(cacheDir);
+#endif
+}
+
+/**
+ * Create a test ROM image.
+ * @param seed Random seed.
+ * @param size ROM size.
+ * @return ROM image.
+ */
+vector<uint8_t> RomCacheTest::makeRom(uint32_t seed, size_t size)
+{
+	vector<uint8_t> rom(size);
+	uint32_t x = seed;
+	for (size_t i = 0; i < rom.size(); i++) {
+		// Simple LCG.
+		x = (x * 1103515245) + 12345;
+		rom[i] = (uint8_t)(x >> 16);
+	}
+
+	// Add a Mega Drive header.
+	memcpy(&rom[0x100], "SEGA MEGA DRIVE ", 16);
+	return rom;
+}
+
+/**
+ * Write a gzipped ROM file.
+ * The file is stored without compression, so
+ * the file size only depends on the ROM size.
+ * @param data ROM image.
+ * @return True on success; false on error.
+ */
+bool RomCacheTest::writeGzip(const vector<uint8_t> &data)
+{
+	gzFile gz = gzopen(filename, "wb0");
+	if (!gz)
+		return false;
+	int ret = gzwrite(gz, &data[0], (unsigned int)data.size());
+	gzclose(gz);
+	return (ret == (int)data.size());
+}
+
+/**
+ * Set a file's modification time.
+ * @param filename Filename.
+ * @param mtime Modification time.
+ */
+void RomCacheTest::setMtime(const char *filename, time_t mtime)
+{
+	struct utimbuf times;
+	times.actime = mtime;
+	times.modtime = mtime;
+	utime(filename, &times);
+}
+
+/**
+ * Compressed ROMs should be loaded from the cache
+ * the second time they're opened.
+ */
+TEST_F(RomCacheTest, cacheHit)
+{
+	RomCache cache(cacheDir);
+	Rom::SetRomCache(&cache);
+
+	const vector<uint8_t> rom1 = makeRom(1, 128*1024);
+	ASSERT_TRUE(writeGzip(rom1));
+	const time_t mtime = time(nullptr) - 60;
+	setMtime(filename, mtime);
+
+	// First load: not cached.
+	{
+		Rom rom(filename);
+		ASSERT_TRUE(rom.isOpen());
+		EXPECT_EQ((int)rom1.size(), rom.romSize());
+		vector<uint8_t> buf(rom1.size());
+		ASSERT_EQ((int)rom1.size(), rom.loadRom(&buf[0], buf.size()));
+		EXPECT_TRUE(buf == rom1);
+	}
+
+	vector<string> files;
+	ASSERT_EQ(0, RomCache::listFiles(cacheDir, &files));
+	EXPECT_EQ(1U, files.size());
+
+	// Replace the file with a different ROM, but keep
+	// the same size and modification time. The cache
+	// key doesn't change, so the cached ROM is used.
+	const vector<uint8_t> rom2 = makeRom(2, rom1.size());
+	ASSERT_TRUE(writeGzip(rom2));
+	setMtime(filename, mtime);
+	{
+		Rom rom(filename);
+		ASSERT_TRUE(rom.isOpen());
+		vector<uint8_t> buf(rom1.size());
+		ASSERT_EQ((int)rom1.size(), rom.loadRom(&buf[0], buf.size()));
+		EXPECT_TRUE(buf == rom1);
+		EXPECT_EQ((uint32_t)crc32(0, &rom1[0], (uInt)rom1.size()), rom.rom_crc32());
+	}
+
+	// Changing the modification time invalidates the cached ROM.
+	setMtime(filename, mtime + 1);
+	{
+		Rom rom(filename);
+		ASSERT_TRUE(rom.isOpen());
+		vector<uint8_t> buf(rom2.size());
+		ASSERT_EQ((int)rom2.size(), rom.loadRom(&buf[0], buf.size()));
+		EXPECT_TRUE(buf == rom2);
+	}
+}
+
+/**
+ * Host-order ROM images should be mapped from the cache.
+ * Writes to a mapping should not affect the cached image.
+ */
+TEST_F(RomCacheTest, mapRomHostOrder)
+{
+	RomCache cache(cacheDir);
+	Rom::SetRomCache(&cache);
+
+	// NOTE: Odd size, so the last word is padded with 0.
+	static const size_t BUF_SIZE = 512*1024;
+	const vector<uint8_t> rom1 = makeRom(3, 128*1024 + 1);
+	ASSERT_TRUE(writeGzip(rom1));
+	const time_t mtime = time(nullptr) - 60;
+	setMtime(filename, mtime);
+
+	for (int pass = 0; pass < 2; pass++) {
+		Rom rom(filename);
+		ASSERT_TRUE(rom.isOpen());
+		uint16_t *ptr = (uint16_t*)rom.mapRomHostOrder(BUF_SIZE);
+		if (!ptr) {
+			// Copy-on-write mappings aren't supported on this system.
+			return;
+		}
+
+		for (size_t i = 0; i < rom1.size(); i += 2) {
+			const uint8_t lo = (i + 1 < rom1.size() ? rom1[i + 1] : 0);
+			ASSERT_EQ((uint16_t)((rom1[i] << 8) | lo), ptr[i / 2]) << "offset " << i;
+		}
+		for (size_t i = (rom1.size() + 1) / 2; i < BUF_SIZE / 2; i++) {
+			ASSERT_EQ(0, ptr[i]) << "offset " << (i * 2);
+		}
+		EXPECT_EQ((uint32_t)crc32(0, &rom1[0], (uInt)rom1.size()), rom.rom_crc32());
+
+		// Modify the mapping.
+		ptr[0] ^= 0xFFFF;
+		Rom::unmapRom(ptr, BUF_SIZE);
+
+		if (pass == 0) {
+			// Replace the file with a different ROM, but keep
+			// the same size and modification time. The cache
+			// key doesn't change, so the cached image is used.
+			ASSERT_TRUE(writeGzip(makeRom(4, rom1.size())));
+			setMtime(filename, mtime);
+		}
+	}
+}
+
+/**
+ * Least-recently used ROMs should be removed
+ * if the cache exceeds the maximum size.
+ */
+TEST_F(RomCacheTest, lruTrim)
+{
+	// Room for two ROMs, plus headers.
+	const size_t romSize = 4096;
+	RomCache cache(cacheDir, (romSize * 2) + 1024);
+
+	const vector<uint8_t> data = makeRom(3, romSize);
+	const uint32_t crc = (uint32_t)crc32(0, &data[0], (uInt)data.size());
+	const time_t now = time(nullptr);
+
+	ASSERT_EQ(0, cache.store("A", &data[0], data.size(), crc, Rom::RFMT_BINARY, Rom::MDP_SYSTEM_MD));
+	ASSERT_EQ(0, cache.store("B", &data[0], data.size(), crc, Rom::RFMT_BINARY, Rom::MDP_SYSTEM_MD));
+
+	// Make both ROMs old, with A older than B.
+	vector<string> files;
+	ASSERT_EQ(0, RomCache::listFiles(cacheDir, &files));
+	ASSERT_EQ(2U, files.size());
+	for (size_t i = 0; i < files.size(); i++) {
+		setMtime(files[i].c_str(), now - 100);
+	}
+
+	// Using A marks it as recently used.
+	RomCache::Entry entry;
+	ASSERT_EQ(0, cache.lookup("A", &entry));
+	EXPECT_TRUE(entry.data == data);
+	EXPECT_EQ(crc, entry.crc32);
+	EXPECT_EQ((int)Rom::RFMT_BINARY, entry.romFormat);
+	EXPECT_EQ((int)Rom::MDP_SYSTEM_MD, entry.sysId);
+
+	// Storing C removes B.
+	ASSERT_EQ(0, cache.store("C", &data[0], data.size(), crc, Rom::RFMT_BINARY, Rom::MDP_SYSTEM_MD));
+	EXPECT_EQ(0, cache.lookup("A", &entry));
+	EXPECT_EQ(-ENOENT, cache.lookup("B", &entry));
+	EXPECT_EQ(0, cache.lookup("C", &entry));
+}
+
+/**
+ * Prewarming should store all compressed ROMs in a directory.
+ */
+TEST_F(RomCacheTest, prewarm)
+{
+	RomCache cache(cacheDir);
+	Rom::SetRomCache(&cache);
+
+	const vector<uint8_t> rom1 = makeRom(4, 64*1024);
+	ASSERT_TRUE(writeGzip(rom1));
+
+	// Prewarm the current directory.
+	// (RomCacheTest.gz is the only compressed ROM here.)
+	EXPECT_GE(Rom::PrewarmRomCache("."), 1);
+
+	vector<string> files;
+	ASSERT_EQ(0, RomCache::listFiles(cacheDir, &files));
+	EXPECT_EQ(1U, files.size());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: ROM cache tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,413 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * RomIndexTest.cpp: ROM library index test.                               *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+#include "RomIndex.hpp"
+
+// zlib.
+#include <zlib.h>
+
+// C includes.
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <unistd.h>
+#include <utime.h>
+#endif
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#ifdef _WIN32
+#define DIR_SEP "\\"
+#else
+#define DIR_SEP "/"
+#endif
+
+namespace LibGens { namespace Tests {
+
+class RomIndexTest : public ::testing::Test
+{
+	protected:
+		RomIndexTest()
+			: ::testing::Test() { }
+		virtual ~RomIndexTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		/**
+		 * Create a test ROM image with a Mega Drive header.
+		 * @param seed Random seed.
+		 * @param size ROM size.
+		 * @param name ROM name.
+		 * @return ROM image.
+		 */
+		static vector<uint8_t> makeRom(uint32_t seed, size_t size, const char *name);
+
+		/**
+		 * Write a file.
+		 * @param filename Filename.
+		 * @param data Data.
+		 * @param mtime Modification time.
+		 * @return True on success; false on error.
+		 */
+		static bool writeFile(const char *filename, const vector<uint8_t> &data, time_t mtime);
+
+		/**
+		 * Find an index entry by filename.
+		 * @param index ROM index.
+		 * @param filename Filename.
+		 * @return Index entry, or nullptr if not found.
+		 */
+		static const RomIndex::Entry *findEntry(const RomIndex &index, const char *filename);
+
+		// Temporary filenames.
+		static const char romDir[];
+		static const char subDir[];
+		static const char rom1File[];
+		static const char rom2File[];
+		static const char textFile[];
+		static const char indexFile[];
+};
+
+const char RomIndexTest::romDir[] = "RomIndexTest.dir";
+const char RomIndexTest::subDir[] = "RomIndexTest.dir" DIR_SEP "sub";
+const char RomIndexTest::rom1File[] = "RomIndexTest.dir" DIR_SEP "rom1.bin";
+const char RomIndexTest::rom2File[] = "RomIndexTest.dir" DIR_SEP "sub" DIR_SEP "rom2.bin";
+const char RomIndexTest::textFile[] = "RomIndexTest.dir" DIR_SEP "readme.txt";
+const char RomIndexTest::indexFile[] = "RomIndexTest.idx";
+
+/**
+ * Create the ROM directories.
+ */
+void RomIndexTest::SetUp(void)
+{
+#ifdef _WIN32
+	_mkdir(romDir);
+	_mkdir(subDir);
+#else
+	mkdir(romDir, 0777);
+	mkdir(subDir, 0777);
+#endif
+}
+
+/**
+ * Remove the temporary files.
+ */
+void RomIndexTest::TearDown(void)
+{
+	remove(rom1File);
+	remove(rom2File);
+	remove(textFile);
+	remove(indexFile);
+#ifdef _WIN32
+	_rmdir(subDir);
+	_rmdir(romDir);
+#else
+	rmdir(subDir);
+	rmdir(romDir);
+#endif
+}
+
+/**
+ * Create a test ROM image with a Mega Drive header.
+ * @param seed Random seed.
+ * @param size ROM size.
+ * @param name ROM name.
+ * @return ROM image.
+ */
+vector<uint8_t> RomIndexTest::makeRom(uint32_t seed, size_t size, const char *name)
+{
+	vector<uint8_t> rom(size);
+	uint32_t x = seed;
+	for (size_t i = 0; i < rom.size(); i++) {
+		// Simple LCG.
+		x = (x * 1103515245) + 12345;
+		rom[i] = (uint8_t)(x >> 16);
+	}
+
+	// Mega Drive header.
+	memset(&rom[0x100], ' ', 0x100);
+	memcpy(&rom[0x100], "SEGA MEGA DRIVE ", 16);
+	memcpy(&rom[0x120], name, strlen(name));
+	memcpy(&rom[0x150], name, strlen(name));
+	memcpy(&rom[0x180], "GM 00001234-00", 14);
+	rom[0x18E] = 0x12;
+	rom[0x18F] = 0x34;
+
+	// SRAM: 'R', 'A', 0xF8, 0x20; $200001-$203FFF
+	static const uint8_t sram[12] = {
+		'R', 'A', 0xF8, 0x20,
+		0x00, 0x20, 0x00, 0x01,
+		0x00, 0x20, 0x3F, 0xFF
+	};
+	memcpy(&rom[0x1B0], sram, sizeof(sram));
+	rom[0x1F0] = 'U';
+	return rom;
+}
+
+/**
+ * Write a file.
+ * @param filename Filename.
+ * @param data Data.
+ * @param mtime Modification time.
+ * @return True on success; false on error.
+ */
+bool RomIndexTest::writeFile(const char *filename, const vector<uint8_t> &data, time_t mtime)
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f)
+		return false;
+	size_t size = fwrite(&data[0], 1, data.size(), f);
+	fclose(f);
+
+	struct utimbuf times;
+	times.actime = mtime;
+	times.modtime = mtime;
+	utime(filename, &times);
+	return (size == data.size());
+}
+
+/**
+ * Find an index entry by filename.
+ * @param index ROM index.
+ * @param filename Filename.
+ * @return Index entry, or nullptr if not found.
+ */
+const RomIndex::Entry *RomIndexTest::findEntry(const RomIndex &index, const char *filename)
+{
+	const vector<RomIndex::Entry> &entries = index.entries();
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i].filename.find(filename) != string::npos)
+			return &entries[i];
+	}
+	return nullptr;
+}
+
+/**
+ * Scanning a directory tree should index all ROMs,
+ * including ROMs in subdirectories.
+ */
+TEST_F(RomIndexTest, scan)
+{
+	const time_t mtime = time(nullptr) - 60;
+	const vector<uint8_t> rom1 = makeRom(1, 128*1024, "TEST ROM ONE");
+	const vector<uint8_t> rom2 = makeRom(2, 256*1024, "TEST ROM TWO");
+	ASSERT_TRUE(writeFile(rom1File, rom1, mtime));
+	ASSERT_TRUE(writeFile(rom2File, rom2, mtime));
+
+	RomIndex index;
+	EXPECT_EQ(2, index.scan(romDir, 2));
+	ASSERT_EQ(2U, index.entries().size());
+
+	const RomIndex::Entry *entry = findEntry(index, "rom1.bin");
+	ASSERT_TRUE(entry != nullptr);
+	EXPECT_EQ((int64_t)mtime, entry->mtime);
+	EXPECT_EQ((int64_t)rom1.size(), entry->fileSize);
+	EXPECT_EQ((uint8_t)Rom::MDP_SYSTEM_MD, entry->sysId);
+	EXPECT_EQ((uint8_t)Rom::RFMT_BINARY, entry->romFormat);
+	EXPECT_EQ((uint32_t)rom1.size(), entry->romSize);
+	EXPECT_EQ((uint32_t)crc32(0, &rom1[0], (uInt)rom1.size()), entry->crc32);
+	EXPECT_EQ("TEST ROM ONE", entry->romNameJP);
+	EXPECT_EQ("TEST ROM ONE", entry->romNameUS);
+	EXPECT_EQ("GM 00001234-00", entry->serial);
+	EXPECT_EQ(0x1234, entry->checksum);
+	EXPECT_EQ(0x04, entry->regionCode);
+	EXPECT_EQ(0x5241F820U, entry->sramInfo);
+	EXPECT_EQ(0x200001U, entry->sramStartAddr);
+	EXPECT_EQ(0x203FFFU, entry->sramEndAddr);
+
+	entry = findEntry(index, "rom2.bin");
+	ASSERT_TRUE(entry != nullptr);
+	EXPECT_EQ((uint32_t)crc32(0, &rom2[0], (uInt)rom2.size()), entry->crc32);
+	EXPECT_EQ("TEST ROM TWO", entry->romNameUS);
+}
+
+/**
+ * A saved index should be identical when it's loaded.
+ */
+TEST_F(RomIndexTest, saveLoad)
+{
+	const time_t mtime = time(nullptr) - 60;
+	ASSERT_TRUE(writeFile(rom1File, makeRom(1, 128*1024, "TEST ROM ONE"), mtime));
+	ASSERT_TRUE(writeFile(rom2File, makeRom(2, 64*1024, "TEST ROM TWO"), mtime));
+
+	RomIndex index;
+	ASSERT_EQ(2, index.scan(romDir));
+	ASSERT_EQ(0, index.save(indexFile));
+
+	RomIndex loaded;
+	ASSERT_EQ(0, loaded.load(indexFile));
+	ASSERT_EQ(index.entries().size(), loaded.entries().size());
+	for (size_t i = 0; i < index.entries().size(); i++) {
+		const RomIndex::Entry &a = index.entries()[i];
+		const RomIndex::Entry &b = loaded.entries()[i];
+		EXPECT_EQ(a.filename, b.filename);
+		EXPECT_EQ(a.z_filename, b.z_filename);
+		EXPECT_EQ(a.mtime, b.mtime);
+		EXPECT_EQ(a.fileSize, b.fileSize);
+		EXPECT_EQ(a.sysId, b.sysId);
+		EXPECT_EQ(a.romFormat, b.romFormat);
+		EXPECT_EQ(a.checksum, b.checksum);
+		EXPECT_EQ(a.regionCode, b.regionCode);
+		EXPECT_EQ(a.romSize, b.romSize);
+		EXPECT_EQ(a.crc32, b.crc32);
+		EXPECT_EQ(a.romNameJP, b.romNameJP);
+		EXPECT_EQ(a.romNameUS, b.romNameUS);
+		EXPECT_EQ(a.serial, b.serial);
+		EXPECT_EQ(a.sramInfo, b.sramInfo);
+		EXPECT_EQ(a.sramStartAddr, b.sramStartAddr);
+		EXPECT_EQ(a.sramEndAddr, b.sramEndAddr);
+	}
+
+	// Truncated index files should be rejected.
+	FILE *f = fopen(indexFile, "rb");
+	ASSERT_TRUE(f != nullptr);
+	vector<uint8_t> data;
+	uint8_t buf[4096];
+	size_t size;
+	while ((size = fread(buf, 1, sizeof(buf), f)) > 0) {
+		data.insert(data.end(), buf, buf + size);
+	}
+	fclose(f);
+	data.resize(data.size() - 1);
+	ASSERT_TRUE(writeFile(indexFile, data, mtime));
+	EXPECT_EQ(-EIO, loaded.load(indexFile));
+	EXPECT_EQ(index.entries().size(), loaded.entries().size());
+
+	// Index files with an entry count that can't
+	// fit in the file should also be rejected.
+	data[8] = 0xFF;
+	data[9] = 0xFF;
+	data[10] = 0xFF;
+	data[11] = 0xFF;
+	ASSERT_TRUE(writeFile(indexFile, data, mtime));
+	EXPECT_EQ(-EIO, loaded.load(indexFile));
+	EXPECT_EQ(index.entries().size(), loaded.entries().size());
+}
+
+/**
+ * Rescanning should only scan new and modified files.
+ */
+TEST_F(RomIndexTest, incremental)
+{
+	const time_t mtime = time(nullptr) - 60;
+	ASSERT_TRUE(writeFile(rom1File, makeRom(1, 128*1024, "TEST ROM ONE"), mtime));
+	ASSERT_TRUE(writeFile(rom2File, makeRom(2, 64*1024, "TEST ROM TWO"), mtime));
+
+	RomIndex index;
+	ASSERT_EQ(2, index.scan(romDir));
+
+	// Nothing changed.
+	EXPECT_EQ(0, index.scan(romDir));
+	EXPECT_EQ(2U, index.entries().size());
+
+	// Modify one ROM and add a non-ROM file.
+	const vector<uint8_t> rom2 = makeRom(3, 64*1024, "TEST ROM THREE");
+	ASSERT_TRUE(writeFile(rom2File, rom2, mtime + 1));
+	const char text[] = "This is not a ROM.\n";
+	ASSERT_TRUE(writeFile(textFile, vector<uint8_t>(text, text + sizeof(text) - 1), mtime));
+	EXPECT_EQ(2, index.scan(romDir));
+	ASSERT_EQ(3U, index.entries().size());
+
+	const RomIndex::Entry *entry = findEntry(index, "rom2.bin");
+	ASSERT_TRUE(entry != nullptr);
+	EXPECT_EQ("TEST ROM THREE", entry->romNameUS);
+	EXPECT_EQ((uint32_t)crc32(0, &rom2[0], (uInt)rom2.size()), entry->crc32);
+
+	// The non-ROM file has an entry,
+	// so it isn't rescanned.
+	EXPECT_TRUE(findEntry(index, "readme.txt") != nullptr);
+	EXPECT_EQ(0, index.scan(romDir));
+
+	// Removed files are removed from the index.
+	remove(rom1File);
+	EXPECT_EQ(0, index.scan(romDir));
+	EXPECT_EQ(2U, index.entries().size());
+	EXPECT_TRUE(findEntry(index, "rom1.bin") == nullptr);
+}
+
+/**
+ * Scanning a directory tree shouldn't remove
+ * entries from other directory trees.
+ */
+TEST_F(RomIndexTest, multipleDirs)
+{
+	const time_t mtime = time(nullptr) - 60;
+	ASSERT_TRUE(writeFile(rom1File, makeRom(1, 128*1024, "TEST ROM ONE"), mtime));
+	ASSERT_TRUE(writeFile(rom2File, makeRom(2, 64*1024, "TEST ROM TWO"), mtime));
+
+	// Scan the subdirectory first, then the parent directory.
+	RomIndex index;
+	ASSERT_EQ(1, index.scan(subDir));
+	EXPECT_EQ(1, index.scan(romDir));
+	EXPECT_EQ(2U, index.entries().size());
+
+	// Rescanning the subdirectory keeps rom1.bin,
+	// since it's outside of the subdirectory.
+	EXPECT_EQ(0, index.scan(subDir));
+	EXPECT_EQ(2U, index.entries().size());
+	EXPECT_TRUE(findEntry(index, "rom1.bin") != nullptr);
+	EXPECT_TRUE(findEntry(index, "rom2.bin") != nullptr);
+
+	// Removed files are only removed from
+	// the directory tree that was scanned.
+	remove(rom2File);
+	EXPECT_EQ(0, index.scan(subDir));
+	EXPECT_EQ(1U, index.entries().size());
+	EXPECT_TRUE(findEntry(index, "rom1.bin") != nullptr);
+	EXPECT_TRUE(findEntry(index, "rom2.bin") == nullptr);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: ROM index tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
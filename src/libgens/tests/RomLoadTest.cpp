@@ -0,0 +1,302 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * RomLoadTest.cpp: ROM loading test.                                      *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+
+// zlib.
+#include <zlib.h>
+
+// C includes.
+#include <sys/types.h>
+#include <sys/stat.h>
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+class RomLoadTest : public ::testing::Test
+{
+	protected:
+		RomLoadTest()
+			: ::testing::Test() { }
+		virtual ~RomLoadTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		// ROM size. (Not a multiple of 512 KB.)
+		static const size_t ROM_SIZE = 160*1024;
+		// Buffer size. (ROM size, rounded up to 512 KB.)
+		static const size_t BUF_SIZE = 512*1024;
+
+		// Plain binary ROM image.
+		vector<uint8_t> bin;
+
+		/**
+		 * Encode a plain binary ROM image as SMD.
+		 * @param smd [out] SMD image.
+		 */
+		void encodeSMD(vector<uint8_t> &smd) const;
+
+		/**
+		 * Write data to the temporary ROM file.
+		 * @param data Data.
+		 * @return True on success; false on error.
+		 */
+		static bool writeFile(const vector<uint8_t> &data);
+
+		// Temporary ROM filename.
+		static const char filename[];
+};
+
+const char RomLoadTest::filename[] = "RomLoadTest.tmp";
+
+/**
+ * Create a test ROM image.
+ */
+void RomLoadTest::SetUp(void)
+{
+	bin.resize(ROM_SIZE);
+	uint32_t x = 0x12345678;
+	for (size_t i = 0; i < bin.size(); i++) {
+		// Simple LCG.
+		x = (x * 1103515245) + 12345;
+		bin[i] = (uint8_t)(x >> 16);
+	}
+
+	// Add a Mega Drive header.
+	memcpy(&bin[0x100], "SEGA MEGA DRIVE ", 16);
+	memset(&bin[0x120], ' ', 0x60);
+	memcpy(&bin[0x120], "ROM LOAD TEST", 13);
+	memcpy(&bin[0x150], "ROM LOAD TEST", 13);
+}
+
+/**
+ * Remove the temporary ROM file.
+ */
+void RomLoadTest::TearDown(void)
+{
+	remove(filename);
+}
+
+/**
+ * Write data to the temporary ROM file.
+ * @param data Data.
+ * @return True on success; false on error.
+ */
+bool RomLoadTest::writeFile(const vector<uint8_t> &data)
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f)
+		return false;
+	size_t size = fwrite(&data[0], 1, data.size(), f);
+	fclose(f);
+	return (size == data.size());
+}
+
+/**
+ * Encode a plain binary ROM image as SMD.
+ * @param smd [out] SMD image.
+ */
+void RomLoadTest::encodeSMD(vector<uint8_t> &smd) const
+{
+	smd.assign(512 + bin.size(), 0);
+	// SMD header.
+	smd[0] = (uint8_t)(bin.size() / 16384);
+	smd[1] = 0x03;
+	smd[8] = 0xAA;
+	smd[9] = 0xBB;
+
+	// Odd bytes go in the first half of each 16 KB block;
+	// even bytes go in the second half.
+	for (size_t blk = 0; blk < bin.size(); blk += 16384) {
+		uint8_t *dest = &smd[512 + blk];
+		const uint8_t *src = &bin[blk];
+		for (size_t i = 0; i < 8192; i++) {
+			dest[i] = src[i*2 + 1];
+			dest[i + 8192] = src[i*2];
+		}
+	}
+}
+
+/**
+ * Plain binary ROM.
+ * The CRC32 should only cover the ROM data.
+ */
+TEST_F(RomLoadTest, binary)
+{
+	Rom rom(&bin[0], (unsigned int)bin.size());
+	ASSERT_TRUE(rom.isOpen());
+	EXPECT_EQ(Rom::RFMT_BINARY, rom.romFormat());
+	EXPECT_EQ((int)ROM_SIZE, rom.romSize());
+	EXPECT_EQ("ROM LOAD TEST", rom.romNameUS());
+
+	vector<uint8_t> buf(BUF_SIZE, 0xFF);
+	ASSERT_EQ((int)ROM_SIZE, rom.loadRom(&buf[0], buf.size()));
+	EXPECT_EQ(0, memcmp(&buf[0], &bin[0], ROM_SIZE));
+	EXPECT_EQ((uint32_t)crc32(0, &bin[0], ROM_SIZE), rom.rom_crc32());
+
+	// Load the ROM again. This reads from the archive.
+	vector<uint8_t> buf2(BUF_SIZE, 0xFF);
+	ASSERT_EQ((int)ROM_SIZE, rom.loadRom(&buf2[0], buf2.size()));
+	EXPECT_EQ(0, memcmp(&buf2[0], &bin[0], ROM_SIZE));
+	EXPECT_EQ((uint32_t)crc32(0, &bin[0], ROM_SIZE), rom.rom_crc32());
+}
+
+/**
+ * Super Magic Drive ROM.
+ * The decoded ROM should be identical to the plain binary ROM.
+ */
+TEST_F(RomLoadTest, smd)
+{
+	vector<uint8_t> smd;
+	encodeSMD(smd);
+
+	Rom rom(&smd[0], (unsigned int)smd.size(),
+		Rom::MDP_SYSTEM_UNKNOWN, Rom::RFMT_SMD);
+	ASSERT_TRUE(rom.isOpen());
+	EXPECT_EQ(Rom::RFMT_SMD, rom.romFormat());
+	EXPECT_EQ((int)ROM_SIZE, rom.romSize());
+	EXPECT_EQ("ROM LOAD TEST", rom.romNameUS());
+
+	vector<uint8_t> buf(BUF_SIZE, 0xFF);
+	ASSERT_EQ((int)ROM_SIZE, rom.loadRom(&buf[0], buf.size()));
+	EXPECT_EQ(0, memcmp(&buf[0], &bin[0], ROM_SIZE));
+	EXPECT_EQ((uint32_t)crc32(0, &bin[0], ROM_SIZE), rom.rom_crc32());
+
+	// Load the ROM again. This decodes the ROM in place.
+	vector<uint8_t> buf2(BUF_SIZE, 0xFF);
+	ASSERT_EQ((int)ROM_SIZE, rom.loadRom(&buf2[0], buf2.size()));
+	EXPECT_EQ(0, memcmp(&buf2[0], &bin[0], ROM_SIZE));
+	EXPECT_EQ((uint32_t)crc32(0, &bin[0], ROM_SIZE), rom.rom_crc32());
+}
+
+/**
+ * Uncompressed ROM file.
+ * This is loaded from a memory mapping.
+ */
+TEST_F(RomLoadTest, mappedFile)
+{
+	ASSERT_TRUE(writeFile(bin));
+	Rom rom(filename);
+	ASSERT_TRUE(rom.isOpen());
+	EXPECT_EQ(Rom::RFMT_BINARY, rom.romFormat());
+	EXPECT_EQ((int)ROM_SIZE, rom.romSize());
+	EXPECT_EQ("ROM LOAD TEST", rom.romNameUS());
+
+	vector<uint8_t> buf(BUF_SIZE, 0xFF);
+	ASSERT_EQ((int)ROM_SIZE, rom.loadRom(&buf[0], buf.size()));
+	EXPECT_EQ(0, memcmp(&buf[0], &bin[0], ROM_SIZE));
+	EXPECT_EQ((uint32_t)crc32(0, &bin[0], ROM_SIZE), rom.rom_crc32());
+}
+
+/**
+ * Uncompressed SMD ROM file.
+ * This is decoded directly from a memory mapping.
+ */
+TEST_F(RomLoadTest, mappedFileSMD)
+{
+	vector<uint8_t> smd;
+	encodeSMD(smd);
+	ASSERT_TRUE(writeFile(smd));
+
+	Rom rom(filename, Rom::MDP_SYSTEM_UNKNOWN, Rom::RFMT_SMD);
+	ASSERT_TRUE(rom.isOpen());
+	EXPECT_EQ((int)ROM_SIZE, rom.romSize());
+	EXPECT_EQ("ROM LOAD TEST", rom.romNameUS());
+
+	vector<uint8_t> buf(BUF_SIZE, 0xFF);
+	ASSERT_EQ((int)ROM_SIZE, rom.loadRom(&buf[0], buf.size()));
+	EXPECT_EQ(0, memcmp(&buf[0], &bin[0], ROM_SIZE));
+	EXPECT_EQ((uint32_t)crc32(0, &bin[0], ROM_SIZE), rom.rom_crc32());
+}
+
+/**
+ * Copy-on-write ROM mapping.
+ * The rest of the mapping should be zero-filled,
+ * and writes should not affect the file.
+ */
+TEST_F(RomLoadTest, mapRom)
+{
+	ASSERT_TRUE(writeFile(bin));
+#ifndef _WIN32
+	{
+		// Writable ROM files should not be mapped,
+		// since they might be truncated.
+		Rom rom(filename);
+		ASSERT_TRUE(rom.isOpen());
+		EXPECT_TRUE(rom.mapRom(BUF_SIZE) == nullptr);
+	}
+	ASSERT_EQ(0, chmod(filename, 0444));
+#endif /* !_WIN32 */
+
+	Rom rom(filename);
+	ASSERT_TRUE(rom.isOpen());
+
+	uint8_t *ptr = (uint8_t*)rom.mapRom(BUF_SIZE);
+	if (!ptr) {
+		// Copy-on-write mappings aren't supported on this system.
+		return;
+	}
+	EXPECT_EQ(0, memcmp(ptr, &bin[0], ROM_SIZE));
+	EXPECT_EQ((uint32_t)crc32(0, &bin[0], ROM_SIZE), rom.rom_crc32());
+	for (size_t i = ROM_SIZE; i < BUF_SIZE; i++) {
+		ASSERT_EQ(0, ptr[i]) << "offset " << i;
+	}
+
+	// Modify the mapping.
+	ptr[0x18E] ^= 0xFF;
+	ptr[BUF_SIZE - 1] = 0x55;
+	Rom::unmapRom(ptr, BUF_SIZE);
+
+	// The ROM file should not be modified.
+	vector<uint8_t> buf(BUF_SIZE, 0xFF);
+	ASSERT_EQ((int)ROM_SIZE, rom.loadRom(&buf[0], buf.size()));
+	EXPECT_EQ(0, memcmp(&buf[0], &bin[0], ROM_SIZE));
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: ROM loading tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
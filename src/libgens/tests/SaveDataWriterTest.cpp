@@ -0,0 +1,391 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * SaveDataWriterTest.cpp: Incremental SRam/EEPRom file writer test.       *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens
+#include "lg_main.hpp"
+#include "Save/SaveDataWriter.hpp"
+#include "Save/SRam.hpp"
+
+// zlib is used for the journal checksum.
+#include <zlib.h>
+
+// Byteswapping macros.
+#include "libcompat/byteswap.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+class SaveDataWriterTest : public ::testing::Test
+{
+	protected:
+		SaveDataWriterTest()
+			: ::testing::Test()
+			, filename("SaveDataWriterTest.srm")
+			, jnlFilename("SaveDataWriterTest.srm.jnl") { }
+		virtual ~SaveDataWriterTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		/**
+		 * Write a file.
+		 * @param fn Filename.
+		 * @param data File data.
+		 */
+		static void writeFile(const string &fn, const vector<uint8_t> &data);
+
+		/**
+		 * Read a file.
+		 * @param fn Filename.
+		 * @return File data. (Empty if the file doesn't exist.)
+		 */
+		static vector<uint8_t> readFile(const string &fn);
+
+		/**
+		 * Check if a file exists.
+		 * @param fn Filename.
+		 * @return True if the file exists.
+		 */
+		static bool fileExists(const string &fn);
+
+		/**
+		 * Build a journal containing a single page.
+		 * @param offset Page offset.
+		 * @param data Page data.
+		 * @return Journal data.
+		 */
+		static vector<uint8_t> buildJournal(uint32_t offset, const vector<uint8_t> &data);
+
+		// Save data size.
+		static const unsigned int SAVE_SIZE = 0x2000;
+
+		const string filename;
+		const string jnlFilename;
+};
+
+const unsigned int SaveDataWriterTest::SAVE_SIZE;
+
+/**
+ * Remove any leftover files.
+ */
+void SaveDataWriterTest::SetUp(void)
+{
+	remove(filename.c_str());
+	remove(jnlFilename.c_str());
+}
+
+/**
+ * Remove the test files.
+ */
+void SaveDataWriterTest::TearDown(void)
+{
+	remove(filename.c_str());
+	remove(jnlFilename.c_str());
+}
+
+/**
+ * Write a file.
+ * @param fn Filename.
+ * @param data File data.
+ */
+void SaveDataWriterTest::writeFile(const string &fn, const vector<uint8_t> &data)
+{
+	FILE *f = fopen(fn.c_str(), "wb");
+	ASSERT_TRUE(f != nullptr);
+	if (!data.empty()) {
+		ASSERT_EQ(data.size(), fwrite(&data[0], 1, data.size(), f));
+	}
+	fclose(f);
+}
+
+/**
+ * Read a file.
+ * @param fn Filename.
+ * @return File data. (Empty if the file doesn't exist.)
+ */
+vector<uint8_t> SaveDataWriterTest::readFile(const string &fn)
+{
+	vector<uint8_t> data;
+	FILE *f = fopen(fn.c_str(), "rb");
+	if (!f)
+		return data;
+
+	uint8_t buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+		data.insert(data.end(), buf, buf + n);
+	}
+	fclose(f);
+	return data;
+}
+
+/**
+ * Check if a file exists.
+ * @param fn Filename.
+ * @return True if the file exists.
+ */
+bool SaveDataWriterTest::fileExists(const string &fn)
+{
+	FILE *f = fopen(fn.c_str(), "rb");
+	if (!f)
+		return false;
+	fclose(f);
+	return true;
+}
+
+/**
+ * Build a journal containing a single page.
+ * @param offset Page offset.
+ * @param data Page data.
+ * @return Journal data.
+ */
+vector<uint8_t> SaveDataWriterTest::buildJournal(uint32_t offset, const vector<uint8_t> &data)
+{
+	static const char magic[8] = {'G','E','N','S','J','N','L','1'};
+	vector<uint8_t> jnl(magic, magic + sizeof(magic));
+
+	const uint32_t hdr[3] = {cpu_to_le32(1), cpu_to_le32(offset), cpu_to_le32((uint32_t)data.size())};
+	const uint8_t *const hdr8 = (const uint8_t*)hdr;
+	jnl.insert(jnl.end(), hdr8, hdr8 + sizeof(hdr));
+	jnl.insert(jnl.end(), data.begin(), data.end());
+
+	const uint32_t crc_le = cpu_to_le32((uint32_t)crc32(0, &jnl[0], (uInt)jnl.size()));
+	const uint8_t *const crc8 = (const uint8_t*)&crc_le;
+	jnl.insert(jnl.end(), crc8, crc8 + sizeof(crc_le));
+	return jnl;
+}
+
+/**
+ * Only modified pages should be written to an existing save file.
+ */
+TEST_F(SaveDataWriterTest, incrementalWrite)
+{
+	writeFile(filename, vector<uint8_t>(SAVE_SIZE, 0xAA));
+
+	SaveDataWriter writer(SAVE_SIZE);
+	writer.setFilename(filename);
+	EXPECT_FALSE(writer.isPending());
+	EXPECT_EQ(0, writer.flush());
+
+	// Change the first page in the file behind the writer's back.
+	// Since the first page isn't modified, it shouldn't be rewritten.
+	vector<uint8_t> file = readFile(filename);
+	memset(&file[0], 0x55, SaveDataWriter::PAGE_SIZE);
+	writeFile(filename, file);
+
+	vector<uint8_t> sram(SAVE_SIZE, 0xAA);
+	sram[0x1234] = 0x12;
+	sram[0x1235] = 0x34;
+	writer.update(&sram[0], 0x1234, 2);
+	EXPECT_TRUE(writer.isPending());
+	EXPECT_EQ((int)SAVE_SIZE, writer.flush());
+	EXPECT_FALSE(writer.isPending());
+
+	file = readFile(filename);
+	ASSERT_EQ(SAVE_SIZE, file.size());
+	EXPECT_EQ(0x55, file[0]);
+	EXPECT_EQ(0x12, file[0x1234]);
+	EXPECT_EQ(0x34, file[0x1235]);
+	EXPECT_EQ(0xAA, file[0x1236]);
+	EXPECT_FALSE(fileExists(jnlFilename));
+}
+
+/**
+ * New save files should grow in power-of-two steps.
+ */
+TEST_F(SaveDataWriterTest, fileGrowth)
+{
+	SaveDataWriter writer(SAVE_SIZE);
+	writer.setFilename(filename);
+
+	vector<uint8_t> sram(SAVE_SIZE, 0xFF);
+	sram[0x10] = 0x01;
+	writer.update(&sram[0], 0x10, 1);
+	EXPECT_EQ(256, writer.flush());
+	EXPECT_EQ(256U, readFile(filename).size());
+
+	// Writing to the third page extends the file to 1 KB.
+	sram[0x300] = 0x02;
+	writer.update(&sram[0], 0x300, 1);
+	EXPECT_EQ(1024, writer.flush());
+
+	const vector<uint8_t> file = readFile(filename);
+	ASSERT_EQ(1024U, file.size());
+	EXPECT_EQ(0x01, file[0x10]);
+	EXPECT_EQ(0xFF, file[0x200]);
+	EXPECT_EQ(0x02, file[0x300]);
+
+	// Writes past the end of the buffer are clamped.
+	sram[SAVE_SIZE-1] = 0x03;
+	writer.update(&sram[0], SAVE_SIZE-1, 16);
+	EXPECT_EQ((int)SAVE_SIZE, writer.flush());
+	EXPECT_EQ(SAVE_SIZE, readFile(filename).size());
+}
+
+/**
+ * Changes should be written by the background thread
+ * once the autosave delay has passed.
+ */
+TEST_F(SaveDataWriterTest, autoSave)
+{
+	SaveDataWriter writer(SAVE_SIZE);
+	writer.setAutoSaveDelay(20);
+	EXPECT_EQ(20, writer.autoSaveDelay());
+	writer.setFilename(filename);
+
+	vector<uint8_t> sram(SAVE_SIZE, 0x00);
+	for (unsigned int i = 0; i < 64; i++) {
+		sram[i] = (uint8_t)i;
+		writer.update(&sram[0], i, 1);
+	}
+	EXPECT_TRUE(writer.isPending());
+
+	for (int i = 0; i < 200 && writer.isPending(); i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	EXPECT_FALSE(writer.isPending());
+	EXPECT_EQ(0, writer.lastError());
+
+	const vector<uint8_t> file = readFile(filename);
+	ASSERT_EQ(256U, file.size());
+	EXPECT_EQ(0, memcmp(&file[0], &sram[0], file.size()));
+}
+
+/**
+ * Discarded changes and changes without a save file
+ * shouldn't be written.
+ */
+TEST_F(SaveDataWriterTest, discard)
+{
+	SaveDataWriter writer(SAVE_SIZE);
+	vector<uint8_t> sram(SAVE_SIZE, 0x11);
+
+	// No save file.
+	writer.update(&sram[0], 0, 1);
+	EXPECT_FALSE(writer.isPending());
+
+	writer.setFilename(filename);
+	writer.update(&sram[0], 0, 1);
+	EXPECT_TRUE(writer.isPending());
+	writer.discard();
+	EXPECT_FALSE(writer.isPending());
+	EXPECT_EQ(0, writer.flush());
+	EXPECT_FALSE(fileExists(filename));
+}
+
+/**
+ * Unloaded SRam should be cleared, and it
+ * shouldn't be written to the save file.
+ */
+TEST_F(SaveDataWriterTest, sramUnload)
+{
+	writeFile(filename, vector<uint8_t>(SAVE_SIZE, 0x22));
+
+	SRam *sram = new SRam();
+	sram->setStart(0x200000);
+	sram->setEnd(0x20FFFF);
+	sram->setFilename("SaveDataWriterTest.bin");
+	EXPECT_EQ((int)SAVE_SIZE, sram->load());
+	EXPECT_EQ(0x22, sram->readByte(0x200000));
+
+	sram->unload();
+	EXPECT_EQ(0xFF, sram->readByte(0x200000));
+	sram->writeByte(0x200000, 0x33);
+	EXPECT_FALSE(sram->isDirty());
+	EXPECT_EQ(0, sram->save());
+	delete sram;
+
+	const vector<uint8_t> file = readFile(filename);
+	ASSERT_EQ((size_t)SAVE_SIZE, file.size());
+	EXPECT_EQ(0x22, file[0]);
+}
+
+/**
+ * A complete journal should be replayed when the
+ * save file is opened.
+ */
+TEST_F(SaveDataWriterTest, journalReplay)
+{
+	writeFile(filename, vector<uint8_t>(1024, 0x00));
+	writeFile(jnlFilename, buildJournal(0x100, vector<uint8_t>(SaveDataWriter::PAGE_SIZE, 0x77)));
+
+	SaveDataWriter writer(SAVE_SIZE);
+	writer.setFilename(filename);
+	EXPECT_EQ(0, writer.lastError());
+	EXPECT_FALSE(fileExists(jnlFilename));
+
+	const vector<uint8_t> file = readFile(filename);
+	ASSERT_EQ(1024U, file.size());
+	EXPECT_EQ(0x00, file[0xFF]);
+	EXPECT_EQ(0x77, file[0x100]);
+	EXPECT_EQ(0x77, file[0x1FF]);
+	EXPECT_EQ(0x00, file[0x200]);
+}
+
+/**
+ * An incomplete journal means the save file wasn't
+ * modified, so it should be removed without replaying.
+ */
+TEST_F(SaveDataWriterTest, journalIncomplete)
+{
+	writeFile(filename, vector<uint8_t>(1024, 0x00));
+	vector<uint8_t> jnl = buildJournal(0x100, vector<uint8_t>(SaveDataWriter::PAGE_SIZE, 0x77));
+	jnl.resize(jnl.size() - 64);
+	writeFile(jnlFilename, jnl);
+
+	SaveDataWriter writer(SAVE_SIZE);
+	writer.setFilename(filename);
+	EXPECT_EQ(0, writer.lastError());
+	EXPECT_FALSE(fileExists(jnlFilename));
+	EXPECT_EQ(vector<uint8_t>(1024, 0x00), readFile(filename));
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: SaveDataWriter tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,230 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * SaveSlotCacheTest.cpp: Savestate slot metadata cache test.              *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens
+#include "lg_main.hpp"
+#include "EmuContext/SaveSlotCache.hpp"
+
+// LibZomg
+#include "libzomg/Zomg.hpp"
+#include "libzomg/Metadata.hpp"
+using LibZomg::Zomg;
+using LibZomg::Metadata;
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+class SaveSlotCacheTest : public ::testing::Test
+{
+	protected:
+		SaveSlotCacheTest()
+			: ::testing::Test() { }
+		virtual ~SaveSlotCacheTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		/**
+		 * Write a savestate with a preview image.
+		 * @param slot Save slot.
+		 * @param w Preview width.
+		 * @param h Preview height.
+		 * @param fill Preview fill color.
+		 */
+		void writeSaveState(int slot, int w, int h, uint32_t fill);
+
+		// Savestate filenames.
+		vector<string> filenames;
+};
+
+/**
+ * Set up the savestate filenames.
+ */
+void SaveSlotCacheTest::SetUp(void)
+{
+	char buf[64];
+	for (int i = 0; i < SaveSlotCache::MAX_SLOTS; i++) {
+		snprintf(buf, sizeof(buf), "SaveSlotCacheTest.%d.zomg", i);
+		filenames.push_back(buf);
+		remove(buf);
+	}
+}
+
+/**
+ * Remove the savestate files.
+ */
+void SaveSlotCacheTest::TearDown(void)
+{
+	for (size_t i = 0; i < filenames.size(); i++) {
+		remove(filenames[i].c_str());
+	}
+}
+
+/**
+ * Write a savestate with a preview image.
+ * @param slot Save slot.
+ * @param w Preview width.
+ * @param h Preview height.
+ * @param fill Preview fill color.
+ */
+void SaveSlotCacheTest::writeSaveState(int slot, int w, int h, uint32_t fill)
+{
+	vector<uint32_t> img(w * h, fill);
+	Zomg_Img_Data_t img_data;
+	memset(&img_data, 0, sizeof(img_data));
+	img_data.data = &img[0];
+	img_data.w = w;
+	img_data.h = h;
+	img_data.pitch = w * 4;
+	img_data.bpp = 32;
+	img_data.phys_x = 4;
+	img_data.phys_y = 4;
+
+	Zomg zomg(filenames[slot].c_str(), Zomg::ZOMG_SAVE);
+	ASSERT_TRUE(zomg.isOpen());
+	Metadata metadata;
+	metadata.setSystemId("MD");
+	EXPECT_EQ(0, zomg.saveZomgIni(&metadata));
+	EXPECT_EQ(0, zomg.savePreview(&img_data));
+	zomg.close();
+}
+
+/**
+ * Empty and occupied slots should be reported correctly,
+ * and the preview image should be decoded.
+ */
+TEST_F(SaveSlotCacheTest, slotInfo)
+{
+	writeSaveState(3, 320, 224, 0x00336699);
+
+	SaveSlotCache cache;
+	SaveSlotCache::SlotInfo info;
+
+	// No filenames have been set.
+	EXPECT_EQ(-ENOENT, cache.slotInfo(0, &info));
+	EXPECT_EQ(-EINVAL, cache.slotInfo(SaveSlotCache::MAX_SLOTS, &info));
+
+	cache.setFilenames(filenames);
+	ASSERT_EQ(0, cache.slotInfo(0, &info));
+	EXPECT_EQ(SaveSlotCache::SLOT_EMPTY, info.status);
+	EXPECT_TRUE(info.img.data == nullptr);
+
+	ASSERT_EQ(0, cache.slotInfo(3, &info));
+	EXPECT_EQ(SaveSlotCache::SLOT_OCCUPIED, info.status);
+	EXPECT_NE(0, info.mtime);
+	ASSERT_TRUE(info.img.data != nullptr);
+	EXPECT_EQ(320U, info.img.w);
+	EXPECT_EQ(224U, info.img.h);
+	EXPECT_EQ(info.img.pitch * info.img.h, info.imgBuf.size());
+	const uint32_t *px = (const uint32_t*)info.img.data;
+	EXPECT_EQ(0x336699U, px[0] & 0xFFFFFF);
+
+	// Clearing the cache removes all slots.
+	cache.clear();
+	EXPECT_EQ(-ENOENT, cache.slotInfo(3, &info));
+}
+
+/**
+ * Savestates written by the emulator should be
+ * picked up after the slot is invalidated.
+ */
+TEST_F(SaveSlotCacheTest, invalidate)
+{
+	SaveSlotCache cache;
+	SaveSlotCache::SlotInfo info;
+	cache.setFilenames(filenames);
+	ASSERT_EQ(0, cache.slotInfo(5, &info));
+	EXPECT_EQ(SaveSlotCache::SLOT_EMPTY, info.status);
+
+	writeSaveState(5, 256, 224, 0x00112233);
+	cache.invalidate(5);
+	ASSERT_EQ(0, cache.slotInfo(5, &info));
+	EXPECT_EQ(SaveSlotCache::SLOT_OCCUPIED, info.status);
+	EXPECT_EQ(256U, info.img.w);
+
+	// Files that can't be opened are reported as errors.
+	FILE *f = fopen(filenames[5].c_str(), "wb");
+	ASSERT_TRUE(f != nullptr);
+	fputs("This is not a ZOMG file.\n", f);
+	fclose(f);
+	cache.invalidate(5);
+	ASSERT_EQ(0, cache.slotInfo(5, &info));
+	EXPECT_EQ(SaveSlotCache::SLOT_ERROR, info.status);
+	EXPECT_TRUE(info.img.data == nullptr);
+}
+
+/**
+ * Savestates changed outside of the emulator should
+ * be detected without invalidating the slot.
+ */
+TEST_F(SaveSlotCacheTest, externalChange)
+{
+	writeSaveState(1, 320, 224, 0x00FF0000);
+
+	SaveSlotCache cache;
+	SaveSlotCache::SlotInfo info;
+	cache.setFilenames(filenames);
+	ASSERT_EQ(0, cache.slotInfo(1, &info));
+	EXPECT_EQ(320U, info.img.w);
+
+	// Replace the savestate.
+	writeSaveState(1, 256, 240, 0x0000FF00);
+	ASSERT_EQ(0, cache.slotInfo(1, &info));
+	EXPECT_EQ(SaveSlotCache::SLOT_OCCUPIED, info.status);
+	EXPECT_EQ(256U, info.img.w);
+	EXPECT_EQ(240U, info.img.h);
+
+	// Delete the savestate.
+	remove(filenames[1].c_str());
+	ASSERT_EQ(0, cache.slotInfo(1, &info));
+	EXPECT_EQ(SaveSlotCache::SLOT_EMPTY, info.status);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: SaveSlotCache tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
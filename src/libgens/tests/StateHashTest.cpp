@@ -0,0 +1,222 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * StateHashTest.cpp: Emulation state hash tests.                          *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens
+#include "lg_main.hpp"
+#include "EmuContext/StateHash.hpp"
+#include "Vdp/Vdp.hpp"
+#include "sound/Ym2612.hpp"
+#include "sound/Psg.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+namespace LibGens { namespace Tests {
+
+class StateHashTest : public ::testing::Test
+{
+	protected:
+		StateHashTest() { }
+		virtual ~StateHashTest() { }
+};
+
+/**
+ * A new StateHash should be cleared.
+ */
+TEST_F(StateHashTest, clear)
+{
+	StateHash hash;
+	for (int i = 0; i < StateHash::SS_MAX; i++) {
+		EXPECT_EQ(0U, hash.hash((StateHash::Subsystem)i));
+	}
+
+	const uint8_t data[4] = {1, 2, 3, 4};
+	hash.set(StateHash::SS_PSG, data, sizeof(data));
+	EXPECT_NE(0U, hash.hash(StateHash::SS_PSG));
+	hash.clear();
+	EXPECT_EQ(0U, hash.hash(StateHash::SS_PSG));
+}
+
+/**
+ * Appending data in pieces should match hashing it at once.
+ */
+TEST_F(StateHashTest, append)
+{
+	const uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+	StateHash a, b;
+	a.set(StateHash::SS_VRAM, data, sizeof(data));
+	b.set(StateHash::SS_VRAM, data, 3);
+	b.append(StateHash::SS_VRAM, &data[3], sizeof(data) - 3);
+	EXPECT_EQ(a.hash(StateHash::SS_VRAM), b.hash(StateHash::SS_VRAM));
+	EXPECT_TRUE(a == b);
+	EXPECT_EQ(a.combined(), b.combined());
+}
+
+/**
+ * compare() should return the first subsystem that differs.
+ */
+TEST_F(StateHashTest, compare)
+{
+	const uint8_t data1[2] = {0x12, 0x34};
+	const uint8_t data2[2] = {0x12, 0x35};
+
+	StateHash a, b;
+	EXPECT_EQ(StateHash::SS_MAX, a.compare(b));
+
+	a.set(StateHash::SS_YM2612, data1, sizeof(data1));
+	b.set(StateHash::SS_YM2612, data2, sizeof(data2));
+	EXPECT_EQ(StateHash::SS_YM2612, a.compare(b));
+
+	a.set(StateHash::SS_CRAM, data1, sizeof(data1));
+	b.set(StateHash::SS_CRAM, data2, sizeof(data2));
+	EXPECT_EQ(StateHash::SS_CRAM, a.compare(b));
+	EXPECT_TRUE(a != b);
+	EXPECT_NE(a.combined(), b.combined());
+}
+
+/**
+ * All subsystems should have names.
+ */
+TEST_F(StateHashTest, subsystemName)
+{
+	for (int i = 0; i < StateHash::SS_MAX; i++) {
+		EXPECT_TRUE(StateHash::SubsystemName((StateHash::Subsystem)i) != nullptr);
+	}
+	EXPECT_TRUE(StateHash::SubsystemName(StateHash::SS_MAX) == nullptr);
+}
+
+/**
+ * Each VDP memory should only affect its own subsystem.
+ */
+TEST_F(StateHashTest, vdp)
+{
+	Vdp *vdp = new Vdp();
+
+	StateHash before;
+	vdp->stateHashMD(&before);
+
+	// VRam.
+	const uint16_t vram[2] = {0x1234, 0x5678};
+	vdp->dbg_writeVRam_16(0x100, vram, 2);
+	StateHash after;
+	vdp->stateHashMD(&after);
+	EXPECT_EQ(StateHash::SS_VRAM, before.compare(after));
+	EXPECT_EQ(before.hash(StateHash::SS_CRAM), after.hash(StateHash::SS_CRAM));
+	EXPECT_EQ(before.hash(StateHash::SS_VSRAM), after.hash(StateHash::SS_VSRAM));
+	EXPECT_EQ(before.hash(StateHash::SS_VDP_REG), after.hash(StateHash::SS_VDP_REG));
+
+	// VDP registers.
+	before = after;
+	vdp->dbg_setReg(0x07, 0x21);	// Background color.
+	vdp->stateHashMD(&after);
+	EXPECT_EQ(StateHash::SS_VDP_REG, before.compare(after));
+	EXPECT_EQ(before.hash(StateHash::SS_VRAM), after.hash(StateHash::SS_VRAM));
+
+	// Hashing again without changes should be identical.
+	before = after;
+	vdp->stateHashMD(&after);
+	EXPECT_TRUE(before == after);
+
+	delete vdp;
+}
+
+/**
+ * YM2612 timers should affect the hash even if the
+ * registers don't change.
+ */
+TEST_F(StateHashTest, ym2612)
+{
+	Ym2612 ym2612(7670453, 44100);
+
+	// Load and enable timer A.
+	ym2612.write(0, 0x24);
+	ym2612.write(1, 0x00);
+	ym2612.write(0, 0x25);
+	ym2612.write(1, 0x00);
+	ym2612.write(0, 0x27);
+	ym2612.write(1, 0x05);
+
+	StateHash before;
+	ym2612.stateHash(&before);
+
+	// Run the timers for a few samples.
+	int32_t bufL[16], bufR[16];
+	memset(bufL, 0, sizeof(bufL));
+	memset(bufR, 0, sizeof(bufR));
+	ym2612.updateDacAndTimers(bufL, bufR, 16);
+
+	StateHash after;
+	ym2612.stateHash(&after);
+	EXPECT_EQ(StateHash::SS_YM2612, before.compare(after));
+	EXPECT_EQ(before.hash(StateHash::SS_PSG), after.hash(StateHash::SS_PSG));
+
+	// Hashing again without changes should be identical.
+	before = after;
+	ym2612.stateHash(&after);
+	EXPECT_TRUE(before == after);
+}
+
+/**
+ * PSG registers should only affect the PSG subsystem.
+ */
+TEST_F(StateHashTest, psg)
+{
+	Psg psg(3579545, 44100);
+
+	StateHash before;
+	psg.stateHash(&before);
+
+	// Tone 0 frequency.
+	psg.write(0x80 | 0x03);
+	psg.write(0x12);
+	StateHash after;
+	psg.stateHash(&after);
+	EXPECT_EQ(StateHash::SS_PSG, before.compare(after));
+	EXPECT_EQ(before.hash(StateHash::SS_YM2612), after.hash(StateHash::SS_YM2612));
+
+	// Hashing again without changes should be identical.
+	before = after;
+	psg.stateHash(&after);
+	EXPECT_TRUE(before == after);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Emulation state hash tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
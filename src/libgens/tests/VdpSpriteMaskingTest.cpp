@@ -451,6 +451,109 @@ TEST_P(VdpSpriteMaskingTest, spriteMaskingTest)
 	}
 }
 
+/**
+ * Indexed color rendering should produce
+ * the same image as RGB rendering.
+ */
+TEST_P(VdpSpriteMaskingTest, indexedColor)
+{
+	MdFb *const fb = m_vdp->MD_Screen;
+	const int pxPerLine = fb->pxPerLine();
+	const int numLines = fb->numLines();
+
+	// Render a frame in RGB.
+	m_vdp->updateVdpLines(true);
+	for (; m_vdp->VDP_Lines.currentLine < m_vdp->VDP_Lines.totalDisplayLines;
+	     m_vdp->VDP_Lines.currentLine++)
+	{
+		m_vdp->renderLine();
+	}
+	vector<uint32_t> rgb(pxPerLine * numLines);
+	for (int y = 0; y < numLines; y++) {
+		memcpy(&rgb[y * pxPerLine], fb->lineBuf32(y), pxPerLine * sizeof(uint32_t));
+	}
+
+	// Render the same frame in indexed color.
+	fb->setIndexed(true);
+	fb->clear();
+	m_vdp->updateVdpLines(true);
+	for (; m_vdp->VDP_Lines.currentLine < m_vdp->VDP_Lines.totalDisplayLines;
+	     m_vdp->VDP_Lines.currentLine++)
+	{
+		m_vdp->renderLine();
+	}
+	fb->resolve();
+
+	for (int y = 0; y < numLines; y++) {
+		EXPECT_EQ(0, memcmp(&rgb[y * pxPerLine], fb->lineBuf32(y),
+			pxPerLine * sizeof(uint32_t))) << "line " << y;
+	}
+	fb->setIndexed(false);
+}
+
+/**
+ * Indexed color rendering should produce the same
+ * image as RGB rendering over multiple frames if
+ * CRAM is modified in the middle of each frame.
+ */
+TEST_P(VdpSpriteMaskingTest, indexedColorMidFrameCRam)
+{
+	MdFb *const fb = m_vdp->MD_Screen;
+	const int pxPerLine = fb->pxPerLine();
+	const int numLines = fb->numLines();
+	static const int NUM_FRAMES = 4;
+
+	// Render several frames, modifying CRAM at two
+	// different lines in each frame. Palette snapshots
+	// from the end of one frame must not be shared with
+	// lines at the start of the next frame, since their
+	// slots are overwritten later in that frame.
+	auto renderFrames = [&](vector<uint32_t> *out) {
+		m_vdp->dbg_writeCRam_16(0, test_spritemask_cram, sizeof(test_spritemask_cram));
+		out->resize(NUM_FRAMES * pxPerLine * numLines);
+		for (int frame = 0; frame < NUM_FRAMES; frame++) {
+			m_vdp->updateVdpLines(true);
+			for (; m_vdp->VDP_Lines.currentLine < m_vdp->VDP_Lines.totalDisplayLines;
+			     m_vdp->VDP_Lines.currentLine++)
+			{
+				const int line = m_vdp->VDP_Lines.currentLine;
+				if (line == 100 || line == 150) {
+					uint16_t cram[64];
+					for (int i = 0; i < ARRAY_SIZE(cram); i++) {
+						cram[i] = (uint16_t)((test_spritemask_cram[i] +
+							(frame * 2 + (line == 150)) * 0x222) & 0xEEE);
+					}
+					m_vdp->dbg_writeCRam_16(0, cram, sizeof(cram));
+				}
+				m_vdp->renderLine();
+			}
+
+			fb->resolve();
+			uint32_t *dest = &(*out)[frame * pxPerLine * numLines];
+			for (int y = 0; y < numLines; y++, dest += pxPerLine) {
+				memcpy(dest, fb->lineBuf32(y), pxPerLine * sizeof(uint32_t));
+			}
+		}
+	};
+
+	vector<uint32_t> rgb;
+	renderFrames(&rgb);
+
+	fb->setIndexed(true);
+	fb->clear();
+	vector<uint32_t> indexed;
+	renderFrames(&indexed);
+	fb->setIndexed(false);
+
+	for (int frame = 0; frame < NUM_FRAMES; frame++) {
+		for (int y = 0; y < numLines; y++) {
+			const size_t pos = ((frame * numLines) + y) * pxPerLine;
+			EXPECT_EQ(0, memcmp(&rgb[pos], &indexed[pos],
+				pxPerLine * sizeof(uint32_t))) << "frame " << frame << ", line " << y;
+		}
+	}
+}
+
 // Test cases.
 // NOTE: Test case numbers start with 0 in Google Test.
 // TODO: Add a dummy test 0?
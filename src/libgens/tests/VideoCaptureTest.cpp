@@ -0,0 +1,400 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * VideoCaptureTest.cpp: Lossless video capture tests.                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens
+#include "lg_main.hpp"
+#include "Util/MdFb.hpp"
+#include "Util/VideoCapture.hpp"
+
+// zlib
+#include <zlib.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+class VideoCaptureTest : public ::testing::Test
+{
+	protected:
+		VideoCaptureTest() { }
+		virtual ~VideoCaptureTest() { }
+
+		virtual void TearDown(void) override
+		{
+			remove(filename());
+		}
+
+		static const char *filename(void)
+		{
+			return "VideoCaptureTest.avi";
+		}
+
+		// AVI chunk in the 'movi' list.
+		struct Chunk {
+			string fourcc;
+			vector<uint8_t> data;
+		};
+
+		/**
+		 * Load the AVI file and get its 'movi' chunks.
+		 * @param chunks	[out] 'movi' chunks.
+		 * @param idxCount	[out] Number of idx1 entries.
+		 */
+		void loadAvi(vector<Chunk> &chunks, unsigned int *idxCount);
+
+		/**
+		 * Draw a test pattern.
+		 * @param fb Framebuffer.
+		 * @param frame Frame number.
+		 */
+		static void drawFrame(MdFb *fb, int frame);
+
+		static uint32_t rd32(const uint8_t *p)
+		{
+			return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+};
+
+/**
+ * Load the AVI file and get its 'movi' chunks.
+ * @param chunks	[out] 'movi' chunks.
+ * @param idxCount	[out] Number of idx1 entries.
+ */
+void VideoCaptureTest::loadAvi(vector<Chunk> &chunks, unsigned int *idxCount)
+{
+	FILE *f = fopen(filename(), "rb");
+	ASSERT_TRUE(f != nullptr);
+	vector<uint8_t> buf;
+	uint8_t tmp[4096];
+	size_t n;
+	while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0) {
+		buf.insert(buf.end(), tmp, tmp + n);
+	}
+	fclose(f);
+
+	ASSERT_GE(buf.size(), 12U);
+	ASSERT_EQ(0, memcmp(&buf[0], "RIFF", 4));
+	ASSERT_EQ(buf.size() - 8, rd32(&buf[4]));
+	ASSERT_EQ(0, memcmp(&buf[8], "AVI ", 4));
+
+	chunks.clear();
+	*idxCount = 0;
+	bool foundMovi = false;
+	size_t pos = 12;
+	while (pos + 8 <= buf.size()) {
+		const uint32_t size = rd32(&buf[pos+4]);
+		ASSERT_LE(pos + 8 + size, buf.size());
+		if (!memcmp(&buf[pos], "LIST", 4) && !memcmp(&buf[pos+8], "movi", 4)) {
+			foundMovi = true;
+			size_t cpos = pos + 12;
+			const size_t end = pos + 8 + size;
+			while (cpos < end) {
+				Chunk chunk;
+				chunk.fourcc.assign((const char*)&buf[cpos], 4);
+				const uint32_t csize = rd32(&buf[cpos+4]);
+				ASSERT_LE(cpos + 8 + csize, end);
+				chunk.data.assign(&buf[cpos+8], &buf[cpos+8+csize]);
+				chunks.push_back(chunk);
+				cpos += 8 + ((csize + 1) & ~1);
+			}
+		} else if (!memcmp(&buf[pos], "idx1", 4)) {
+			*idxCount = size / 16;
+		}
+		pos += 8 + ((size + 1) & ~1);
+	}
+	ASSERT_TRUE(foundMovi);
+}
+
+/**
+ * Draw a test pattern.
+ * @param fb Framebuffer.
+ * @param frame Frame number.
+ */
+void VideoCaptureTest::drawFrame(MdFb *fb, int frame)
+{
+	// Mostly static background with a moving box,
+	// so both unchanged and changed blocks are tested.
+	for (int y = 0; y < fb->numLines(); y++) {
+		uint32_t *line = fb->lineBuf32(y);
+		for (int x = 0; x < fb->pxPerLine(); x++) {
+			uint32_t px = ((x * 3) << 16) | ((y * 5) << 8) | ((x ^ y) & 0xFF);
+			if (x >= frame * 7 && x < (frame * 7) + 20 && y >= 30 && y < 70) {
+				px = 0xFFFFFF - px;
+			}
+			line[x] = (px & 0xFFFFFF);
+		}
+	}
+}
+
+/**
+ * Invalid parameters should be rejected.
+ */
+TEST_F(VideoCaptureTest, invalidParams)
+{
+	VideoCapture capture;
+	EXPECT_EQ(-EINVAL, capture.open(filename(), 0, 1, 44100, 2));
+	EXPECT_EQ(-EINVAL, capture.open(filename(), 60, 1, 44100, 3));
+	EXPECT_FALSE(capture.isOpen());
+	EXPECT_FALSE(capture.pushFrame(nullptr));
+}
+
+/**
+ * Frames should decode to the original images,
+ * and audio should be stored unmodified.
+ */
+TEST_F(VideoCaptureTest, roundTrip)
+{
+	static const int FRAMES = 40;
+	static const int SAMPLES = 735;	// 44100 / 60
+
+	VideoCapture capture;
+	ASSERT_EQ(0, capture.open(filename(), 60, 1, 44100, 2));
+	EXPECT_TRUE(capture.isOpen());
+
+	MdFb *fb = new MdFb();
+	vector<int16_t> audio(SAMPLES * 2);
+	for (int i = 0; i < FRAMES; i++) {
+		drawFrame(fb, i);
+		capture.pushFrame(fb);
+		for (size_t j = 0; j < audio.size(); j++) {
+			audio[j] = (int16_t)((i * 1000) + j);
+		}
+		capture.pushAudio(audio.data(), SAMPLES);
+	}
+	const unsigned int captured = capture.framesCaptured();
+	const unsigned int dropped = capture.framesDropped();
+	EXPECT_EQ((unsigned int)FRAMES, captured + dropped);
+	ASSERT_EQ(0, capture.close());
+	EXPECT_FALSE(capture.isOpen());
+
+	vector<Chunk> chunks;
+	unsigned int idxCount;
+	ASSERT_NO_FATAL_FAILURE(loadAvi(chunks, &idxCount));
+	EXPECT_EQ(chunks.size(), idxCount);
+
+	// Decode the video.
+	const int width = fb->pxPerLine();
+	const int height = fb->numLines();
+	const int bx = (width + 15) / 16;
+	const int by = (height + 15) / 16;
+	vector<uint32_t> image(width * height);
+	vector<uint8_t> dec;
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	ASSERT_EQ(Z_OK, inflateInit(&zs));
+
+	MdFb *expected = new MdFb();
+	int frame = 0;
+	unsigned int emptyFrames = 0;
+	unsigned int audioBytes = 0;
+	for (size_t i = 0; i < chunks.size(); i++) {
+		const Chunk &chunk = chunks[i];
+		if (chunk.fourcc == "01wb") {
+			audioBytes += (unsigned int)chunk.data.size();
+			continue;
+		}
+		ASSERT_EQ("00dc", chunk.fourcc);
+		if (chunk.data.empty()) {
+			// Dropped frame.
+			emptyFrames++;
+			frame++;
+			continue;
+		}
+
+		const uint8_t *p = chunk.data.data();
+		size_t len = chunk.data.size();
+		const bool keyframe = (p[0] & 1);
+		if (keyframe) {
+			ASSERT_GE(len, 7U);
+			EXPECT_EQ(0, p[1]);	// Major version.
+			EXPECT_EQ(1, p[2]);	// Minor version.
+			EXPECT_EQ(1, p[3]);	// zlib
+			EXPECT_EQ(8, p[4]);	// 32bpp
+			EXPECT_EQ(16, p[5]);
+			EXPECT_EQ(16, p[6]);
+			ASSERT_EQ(Z_OK, inflateReset(&zs));
+			p += 7; len -= 7;
+		} else {
+			p++; len--;
+		}
+
+		dec.resize(width * height * 4 + 4096);
+		zs.next_in = const_cast<Bytef*>(p);
+		zs.avail_in = (uInt)len;
+		zs.next_out = dec.data();
+		zs.avail_out = (uInt)dec.size();
+		int ret = inflate(&zs, Z_SYNC_FLUSH);
+		ASSERT_TRUE(ret == Z_OK || ret == Z_BUF_ERROR);
+		EXPECT_EQ(0U, zs.avail_in);
+		dec.resize(dec.size() - zs.avail_out);
+
+		if (keyframe) {
+			ASSERT_EQ(image.size() * 4, dec.size());
+			memcpy(image.data(), dec.data(), dec.size());
+		} else {
+			size_t xpos = ((bx * by * 2) + 3) & ~3;
+			ASSERT_GE(dec.size(), xpos);
+			for (int b = 0; b < bx * by; b++) {
+				EXPECT_EQ(0, dec[b*2] >> 1);	// No motion.
+				EXPECT_EQ(0, dec[b*2+1]);
+				if (!(dec[b*2] & 1))
+					continue;
+				const int x0 = (b % bx) * 16;
+				const int y0 = (b / bx) * 16;
+				for (int y = y0; y < y0 + 16 && y < height; y++) {
+					for (int x = x0; x < x0 + 16 && x < width; x++) {
+						ASSERT_LE(xpos + 4, dec.size());
+						image[(y * width) + x] ^= rd32(&dec[xpos]);
+						xpos += 4;
+					}
+				}
+			}
+			EXPECT_EQ(dec.size(), xpos);
+		}
+
+		drawFrame(expected, frame);
+		for (int y = 0; y < height; y++) {
+			ASSERT_EQ(0, memcmp(&image[y * width], expected->lineBuf32(y), width * 4))
+				<< "frame " << frame << ", line " << y;
+		}
+		frame++;
+	}
+	inflateEnd(&zs);
+
+	EXPECT_EQ(FRAMES, frame);
+	EXPECT_EQ(dropped, emptyFrames);
+	EXPECT_EQ((unsigned int)(FRAMES * SAMPLES * 4), audioBytes);
+
+	expected->unref();
+	fb->unref();
+}
+
+/**
+ * Captures should stop at the file size limit,
+ * and the file should still be a valid AVI.
+ */
+TEST_F(VideoCaptureTest, maxFileSize)
+{
+	static const int FRAMES = 300;
+	static const int SAMPLES = 735;	// 44100 / 60
+	static const uint32_t MAX_SIZE = 256*1024;
+
+	VideoCapture capture;
+	capture.setMaxFileSize(MAX_SIZE);
+	ASSERT_EQ(0, capture.open(filename(), 60, 1, 44100, 2));
+
+	// 300 frames of audio alone is over 850 KB.
+	MdFb *fb = new MdFb();
+	vector<int16_t> audio(SAMPLES * 2);
+	for (int i = 0; i < FRAMES; i++) {
+		drawFrame(fb, i % 40);
+		capture.pushFrame(fb);
+		for (size_t j = 0; j < audio.size(); j++) {
+			audio[j] = (int16_t)((i * 1000) + j);
+		}
+		capture.pushAudio(audio.data(), SAMPLES);
+	}
+	fb->unref();
+	EXPECT_EQ(-EFBIG, capture.close());
+	EXPECT_FALSE(capture.isOpen());
+
+	FILE *f = fopen(filename(), "rb");
+	ASSERT_TRUE(f != nullptr);
+	fseek(f, 0, SEEK_END);
+	const long fileSize = ftell(f);
+	fclose(f);
+	EXPECT_LE(fileSize, (long)MAX_SIZE);
+	EXPECT_GT(fileSize, (long)(MAX_SIZE / 2));
+
+	vector<Chunk> chunks;
+	unsigned int idxCount;
+	ASSERT_NO_FATAL_FAILURE(loadAvi(chunks, &idxCount));
+	EXPECT_EQ(chunks.size(), idxCount);
+	EXPECT_LT(chunks.size(), (size_t)(FRAMES * 2));
+}
+
+/**
+ * 15-bit and 16-bit frames should be expanded to 32-bit.
+ */
+TEST_F(VideoCaptureTest, colorDepth)
+{
+	VideoCapture capture;
+	ASSERT_EQ(0, capture.open(filename(), 50, 1, 0, 2));
+
+	MdFb *fb = new MdFb();
+	fb->setBpp(MdFb::BPP_15);
+	fb->lineBuf16(0)[0] = 0x7FFF;
+	fb->lineBuf16(0)[1] = 0x7C00;
+	ASSERT_TRUE(capture.pushFrame(fb));
+	fb->unref();
+	ASSERT_EQ(0, capture.close());
+
+	vector<Chunk> chunks;
+	unsigned int idxCount;
+	ASSERT_NO_FATAL_FAILURE(loadAvi(chunks, &idxCount));
+	ASSERT_EQ(1U, chunks.size());
+	ASSERT_GT(chunks[0].data.size(), 7U);
+
+	vector<uint8_t> dec(320 * 240 * 4);
+	uLongf decLen = (uLongf)dec.size();
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	ASSERT_EQ(Z_OK, inflateInit(&zs));
+	zs.next_in = const_cast<Bytef*>(&chunks[0].data[7]);
+	zs.avail_in = (uInt)(chunks[0].data.size() - 7);
+	zs.next_out = dec.data();
+	zs.avail_out = (uInt)decLen;
+	inflate(&zs, Z_SYNC_FLUSH);
+	inflateEnd(&zs);
+	EXPECT_EQ(0xFFFFFFU, rd32(&dec[0]));
+	EXPECT_EQ(0xFF0000U, rd32(&dec[4]));
+	EXPECT_EQ(0U, rd32(&dec[8]));
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Video capture tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
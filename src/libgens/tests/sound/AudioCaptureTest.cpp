@@ -0,0 +1,246 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * AudioCaptureTest.cpp: VGM and WAV audio capture test.                   *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+
+// Audio capture.
+#include "sound/VgmWriter.hpp"
+#include "sound/WavWriter.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+class AudioCaptureTest : public ::testing::Test
+{
+	protected:
+		AudioCaptureTest()
+			: ::testing::Test() { }
+		virtual ~AudioCaptureTest() { }
+
+		virtual void TearDown(void) override;
+
+		/**
+		 * Read the capture file.
+		 * @param data Buffer for the file data.
+		 * @return True on success; false on error.
+		 */
+		static bool readFile(vector<uint8_t> &data);
+
+		/**
+		 * Read a 32-bit little-endian value.
+		 * @param p Pointer to the value.
+		 * @return Value.
+		 */
+		static inline uint32_t le32(const uint8_t *p)
+		{
+			return (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+		}
+
+		/**
+		 * Read a 16-bit little-endian value.
+		 * @param p Pointer to the value.
+		 * @return Value.
+		 */
+		static inline uint16_t le16(const uint8_t *p)
+		{
+			return (uint16_t)(p[0] | (p[1] << 8));
+		}
+
+		// Capture filename.
+		static const char filename[];
+};
+
+const char AudioCaptureTest::filename[] = "AudioCaptureTest.tmp";
+
+/**
+ * Remove the capture file.
+ */
+void AudioCaptureTest::TearDown(void)
+{
+	remove(filename);
+}
+
+/**
+ * Read the capture file.
+ * @param data Buffer for the file data.
+ * @return True on success; false on error.
+ */
+bool AudioCaptureTest::readFile(vector<uint8_t> &data)
+{
+	FILE *f = fopen(filename, "rb");
+	if (!f)
+		return false;
+
+	data.clear();
+	uint8_t buf[4096];
+	size_t sz;
+	while ((sz = fread(buf, 1, sizeof(buf), f)) > 0) {
+		data.insert(data.end(), buf, buf + sz);
+	}
+	fclose(f);
+	return true;
+}
+
+/**
+ * VGM header should be updated when the file is closed.
+ */
+TEST_F(AudioCaptureTest, vgmHeader)
+{
+	VgmWriter vgm;
+	ASSERT_EQ(0, vgm.open(filename, 7670453, 3579545));
+	EXPECT_TRUE(vgm.isOpen());
+	vgm.setRenderRate(44100);
+	vgm.writePsg(0x9F);
+	vgm.advance(735);
+	ASSERT_EQ(0, vgm.close());
+	EXPECT_FALSE(vgm.isOpen());
+
+	vector<uint8_t> data;
+	ASSERT_TRUE(readFile(data));
+	ASSERT_EQ(0x40U + 2 + 1 + 1, data.size());
+
+	EXPECT_EQ(0, memcmp(&data[0], "Vgm ", 4));
+	EXPECT_EQ(data.size() - 4, le32(&data[0x04]));
+	EXPECT_EQ(0x150U, le32(&data[0x08]));
+	EXPECT_EQ(3579545U, le32(&data[0x0C]));
+	EXPECT_EQ(735U, le32(&data[0x18]));
+	EXPECT_EQ(0x0009, le16(&data[0x28]));
+	EXPECT_EQ(16, data[0x2A]);
+	EXPECT_EQ(7670453U, le32(&data[0x2C]));
+	EXPECT_EQ(0x0CU, le32(&data[0x34]));
+
+	// Commands: PSG write, 735-sample wait, end of data.
+	const uint8_t expected[] = {0x50, 0x9F, 0x62, 0x66};
+	EXPECT_EQ(0, memcmp(&data[0x40], expected, sizeof(expected)));
+}
+
+/**
+ * Register writes should be timestamped relative to the render rate.
+ */
+TEST_F(AudioCaptureTest, vgmTimestamps)
+{
+	VgmWriter vgm;
+	ASSERT_EQ(0, vgm.open(filename, 7670453, 3579545));
+	// YM2612 native rate, 888 samples per frame.
+	vgm.setRenderRate(888 * 60);
+
+	// One frame: 735 VGM samples.
+	vgm.advance(888);
+	vgm.writeYm2612(0, 0x28, 0xF0);
+
+	// Three render samples: 2.48 VGM samples. (truncated)
+	vgm.advance(3);
+	vgm.writeYm2612(1, 0xB4, 0xC0);
+
+	// One second: 44,100 VGM samples. (plus the previous 0.48)
+	vgm.advance(888 * 60);
+	EXPECT_EQ(735U + 44100U + 2U, vgm.totalSamples());
+	ASSERT_EQ(0, vgm.close());
+
+	vector<uint8_t> data;
+	ASSERT_TRUE(readFile(data));
+	ASSERT_GT(data.size(), 0x40U);
+
+	const uint8_t expected[] = {
+		0x62, 0x52, 0x28, 0xF0,
+		0x71, 0x53, 0xB4, 0xC0,
+		0x61, 0x44, 0xAC,	// 44,100 samples
+		0x66
+	};
+	ASSERT_EQ(0x40U + sizeof(expected), data.size());
+	EXPECT_EQ(0, memcmp(&data[0x40], expected, sizeof(expected)));
+	EXPECT_EQ(735U + 44100U + 2U, le32(&data[0x18]));
+}
+
+/**
+ * WAV audio should be clamped to 16-bit and the header
+ * should be updated when the file is closed.
+ */
+TEST_F(AudioCaptureTest, wavOutput)
+{
+	// Large enough to span multiple AsyncWriter blocks.
+	const int samples = 40000;
+	vector<int32_t> bufL(samples), bufR(samples);
+	for (int i = 0; i < samples; i++) {
+		bufL[i] = (i * 7) - 100000;
+		bufR[i] = -(i * 3);
+	}
+
+	WavWriter wav;
+	ASSERT_EQ(0, wav.open(filename, 48000));
+	// Write in frame-sized chunks.
+	for (int pos = 0; pos < samples; pos += 800) {
+		wav.write(&bufL[pos], &bufR[pos], 800);
+	}
+	EXPECT_EQ((uint32_t)samples, wav.totalSamples());
+	ASSERT_EQ(0, wav.close());
+
+	vector<uint8_t> data;
+	ASSERT_TRUE(readFile(data));
+	ASSERT_EQ(44U + samples * 4, data.size());
+
+	EXPECT_EQ(0, memcmp(&data[0], "RIFF", 4));
+	EXPECT_EQ(data.size() - 8, le32(&data[4]));
+	EXPECT_EQ(0, memcmp(&data[8], "WAVEfmt ", 8));
+	EXPECT_EQ(1, le16(&data[20]));
+	EXPECT_EQ(2, le16(&data[22]));
+	EXPECT_EQ(48000U, le32(&data[24]));
+	EXPECT_EQ(0, memcmp(&data[36], "data", 4));
+	EXPECT_EQ((uint32_t)samples * 4, le32(&data[40]));
+
+	for (int i = 0; i < samples; i++) {
+		int32_t L = bufL[i], R = bufR[i];
+		L = (L < -0x8000 ? -0x8000 : (L > 0x7FFF ? 0x7FFF : L));
+		R = (R < -0x8000 ? -0x8000 : (R > 0x7FFF ? 0x7FFF : R));
+		ASSERT_EQ((int16_t)L, (int16_t)le16(&data[44 + i*4])) << "sample " << i;
+		ASSERT_EQ((int16_t)R, (int16_t)le16(&data[44 + i*4 + 2])) << "sample " << i;
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Audio capture tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -56,7 +56,8 @@ class AudioWriteTest : public ::testing::TestWithParam<AudioWriteTest_flags>
 	protected:
 		AudioWriteTest()
 			: ::testing::TestWithParam<AudioWriteTest_flags>()
-			, buf(nullptr) { }
+			, buf(nullptr)
+			, fbuf(nullptr) { }
 		virtual ~AudioWriteTest() { }
 
 		virtual void SetUp(void) override;
@@ -68,6 +69,8 @@ class AudioWriteTest : public ::testing::TestWithParam<AudioWriteTest_flags>
 
 		// Aligned destination buffer.
 		int16_t *buf;
+		// Aligned destination buffer. (float)
+		float *fbuf;
 
 		// Previous CPU flags.
 		uint32_t cpuFlags_old;
@@ -98,6 +101,7 @@ void AudioWriteTest::SetUp(void)
 
 	// Allocate an aligned destination buffer.
 	buf = (int16_t*)aligned_malloc(16, samples * 2 * sizeof(*buf));
+	fbuf = (float*)aligned_malloc(16, samples * 2 * sizeof(*fbuf));
 
 	// Copy the test data into SoundMgr.
 	memcpy(SoundMgr::ms_SegBufL, AudioWriteTest_Input_L, sizeof(AudioWriteTest_Input_L));
@@ -111,6 +115,7 @@ void AudioWriteTest::TearDown(void)
 {
 	CPU_Flags = cpuFlags_old;
 	aligned_free(buf);
+	aligned_free(fbuf);
 }
 
 /**
@@ -151,13 +156,51 @@ TEST_P(AudioWriteTest, writeMono)
 	}
 }
 
+/**
+ * Test SoundMgr::writeStereoFloat().
+ */
+TEST_P(AudioWriteTest, writeStereoFloat)
+{
+	int ret = SoundMgr::writeStereoFloat(fbuf, samples);
+	ASSERT_EQ(samples, ret);
+
+	// Verify the data.
+	// Float output is the clamped 16-bit output, scaled.
+	const int16_t *expected = AudioWriteTest_Output_Stereo;
+	for (int i = 0; i < samples*2; i++) {
+		const float expected_f = (float)expected[i] / 32768.0f;
+		EXPECT_EQ(expected_f, fbuf[i]) <<
+			"Output sample " << i << " should be " <<
+			expected_f << ", but was " << fbuf[i];
+	}
+}
+
+/**
+ * Test SoundMgr::writeMonoFloat().
+ */
+TEST_P(AudioWriteTest, writeMonoFloat)
+{
+	int ret = SoundMgr::writeMonoFloat(fbuf, samples);
+	ASSERT_EQ(samples, ret);
+
+	// Verify the data.
+	// Float output is the clamped 16-bit output, scaled.
+	const int16_t *expected = AudioWriteTest_Output_Mono_fast;
+	for (int i = 0; i < samples; i++) {
+		const float expected_f = (float)expected[i] / 32768.0f;
+		EXPECT_EQ(expected_f, fbuf[i]) <<
+			"Output sample " << i << " should be " <<
+			expected_f << ", but was " << fbuf[i];
+	}
+}
+
 // Test cases.
 
 INSTANTIATE_TEST_CASE_P(AudioWriteTest_NoFlags, AudioWriteTest,
 	::testing::Values(AudioWriteTest_flags(0, 0)
 ));
 
-// NOTE: SoundMgr only implements MMX/SSE2 using GNU assembler.
+// NOTE: SoundMgr only implements MMX/SSE2/AVX2 using GNU assembler.
 #if defined(__GNUC__) && \
     (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
 INSTANTIATE_TEST_CASE_P(AudioWriteTest_MMX, AudioWriteTest,
@@ -166,6 +209,9 @@ INSTANTIATE_TEST_CASE_P(AudioWriteTest_MMX, AudioWriteTest,
 INSTANTIATE_TEST_CASE_P(AudioWriteTest_SSE2, AudioWriteTest,
 	::testing::Values(AudioWriteTest_flags(MDP_CPUFLAG_X86_SSE2, MDP_CPUFLAG_X86_SSE2SLOW)
 ));
+INSTANTIATE_TEST_CASE_P(AudioWriteTest_AVX2, AudioWriteTest,
+	::testing::Values(AudioWriteTest_flags(MDP_CPUFLAG_X86_AVX2, 0)
+));
 #endif
 
 } }
@@ -56,7 +56,8 @@ class AudioWriteTest_benchmark : public ::testing::TestWithParam<AudioWriteTest_
 	protected:
 		AudioWriteTest_benchmark()
 			: ::testing::TestWithParam<AudioWriteTest_flags>()
-			, buf(nullptr) { }
+			, buf(nullptr)
+			, fbuf(nullptr) { }
 		virtual ~AudioWriteTest_benchmark() { }
 
 		virtual void SetUp(void) override;
@@ -68,6 +69,8 @@ class AudioWriteTest_benchmark : public ::testing::TestWithParam<AudioWriteTest_
 
 		// Aligned destination buffer.
 		int16_t *buf;
+		// Aligned destination buffer. (float)
+		float *fbuf;
 
 		// Previous CPU flags.
 		uint32_t cpuFlags_old;
@@ -109,6 +112,7 @@ void AudioWriteTest_benchmark::SetUp(void)
 
 	// Allocate an aligned destination buffer.
 	buf = (int16_t*)aligned_malloc(16, samples * 2 * sizeof(*buf));
+	fbuf = (float*)aligned_malloc(16, samples * 2 * sizeof(*fbuf));
 }
 
 /**
@@ -118,6 +122,7 @@ void AudioWriteTest_benchmark::TearDown(void)
 {
 	CPU_Flags = cpuFlags_old;
 	aligned_free(buf);
+	aligned_free(fbuf);
 }
 
 /**
@@ -156,11 +161,47 @@ TEST_P(AudioWriteTest_benchmark, writeMono)
 	}
 }
 
+/**
+ * Benchmark SoundMgr::writeStereoFloat().
+ */
+TEST_P(AudioWriteTest_benchmark, writeStereoFloat)
+{
+	// Run this test 1,000,000 times.
+	for (int i = 1000000; i > 0; i--) {
+		// Copy the test data into SoundMgr.
+		// Note that this has to be done here instead of in SetUp(),
+		// since the segment buffer is erased after every iteration.
+		memcpy(SoundMgr::ms_SegBufL, AudioWriteTest_Input_L, sizeof(AudioWriteTest_Input_L));
+		memcpy(SoundMgr::ms_SegBufR, AudioWriteTest_Input_R, sizeof(AudioWriteTest_Input_R));
+
+		int ret = SoundMgr::writeStereoFloat(fbuf, samples);
+		ASSERT_EQ(samples, ret);
+	}
+}
+
+/**
+ * Benchmark SoundMgr::writeMonoFloat().
+ */
+TEST_P(AudioWriteTest_benchmark, writeMonoFloat)
+{
+	// Run this test 1,000,000 times.
+	for (int i = 1000000; i > 0; i--) {
+		// Copy the test data into SoundMgr.
+		// Note that this has to be done here instead of in SetUp(),
+		// since the segment buffer is erased after every iteration.
+		memcpy(SoundMgr::ms_SegBufL, AudioWriteTest_Input_L, sizeof(AudioWriteTest_Input_L));
+		memcpy(SoundMgr::ms_SegBufR, AudioWriteTest_Input_R, sizeof(AudioWriteTest_Input_R));
+
+		int ret = SoundMgr::writeMonoFloat(fbuf, samples);
+		ASSERT_EQ(samples, ret);
+	}
+}
+
 INSTANTIATE_TEST_CASE_P(AudioWriteTest_benchmark_NoFlags, AudioWriteTest_benchmark,
 	::testing::Values(AudioWriteTest_flags(0, 0)
 ));
 
-// NOTE: SoundMgr only implements MMX/SSE2 using GNU assembler.
+// NOTE: SoundMgr only implements MMX/SSE2/AVX2 using GNU assembler.
 #if defined(__GNUC__) && \
     (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
 INSTANTIATE_TEST_CASE_P(AudioWriteTest_benchmark_MMX, AudioWriteTest_benchmark,
@@ -169,6 +210,9 @@ INSTANTIATE_TEST_CASE_P(AudioWriteTest_benchmark_MMX, AudioWriteTest_benchmark,
 INSTANTIATE_TEST_CASE_P(AudioWriteTest_benchmark_SSE2, AudioWriteTest_benchmark,
 	::testing::Values(AudioWriteTest_flags(MDP_CPUFLAG_X86_SSE2, MDP_CPUFLAG_X86_SSE2SLOW)
 ));
+INSTANTIATE_TEST_CASE_P(AudioWriteTest_benchmark_AVX2, AudioWriteTest_benchmark,
+	::testing::Values(AudioWriteTest_flags(MDP_CPUFLAG_X86_AVX2, 0)
+));
 #endif
 
 } }
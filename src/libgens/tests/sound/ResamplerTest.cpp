@@ -0,0 +1,260 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * ResamplerTest.cpp: Polyphase FIR resampler test.                        *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "libcompat/cpuflags.h"
+
+// Resampler.
+#include "sound/Resampler.hpp"
+
+// C includes. (C++ namespace)
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace LibGens { namespace Tests {
+
+struct ResamplerTest_flags {
+	uint32_t cpuFlags;
+	uint32_t cpuFlags_slow;
+
+	ResamplerTest_flags(uint32_t cpuFlags, uint32_t cpuFlags_slow)
+	{
+		this->cpuFlags = cpuFlags;
+		this->cpuFlags_slow = cpuFlags_slow;
+	}
+};
+
+class ResamplerTest : public ::testing::TestWithParam<ResamplerTest_flags>
+{
+	protected:
+		ResamplerTest()
+			: ::testing::TestWithParam<ResamplerTest_flags>() { }
+		virtual ~ResamplerTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		/**
+		 * Generate a block of a sine wave.
+		 * @param buf Destination buffer.
+		 * @param len Number of samples.
+		 * @param start Index of the first sample.
+		 * @param freq Frequency, in cycles per sample.
+		 * @param amp Amplitude.
+		 */
+		static void genSine(int32_t *buf, int len, int start, double freq, double amp);
+
+	protected:
+		// YM2612 native rate (NTSC) to 48,000 Hz.
+		static const int inLen = 888;	// ceil(53268 / 60)
+		static const int outLen = 800;	// 48000 / 60
+
+		Resampler resampler;
+
+		int32_t srcL[inLen], srcR[inLen];
+		int32_t destL[outLen], destR[outLen];
+
+		// Previous CPU flags.
+		uint32_t cpuFlags_old;
+};
+
+const int ResamplerTest::inLen;
+const int ResamplerTest::outLen;
+
+/**
+ * Set up the Resampler for testing.
+ */
+void ResamplerTest::SetUp(void)
+{
+	// Verify CPU flags.
+	ResamplerTest_flags flags = GetParam();
+	uint32_t totalFlags = (flags.cpuFlags | flags.cpuFlags_slow);
+	if (flags.cpuFlags != 0) {
+		ASSERT_NE(0U, CPU_Flags & totalFlags) <<
+			"CPU does not support the required flags for this test.";
+	}
+	cpuFlags_old = CPU_Flags;
+	CPU_Flags = flags.cpuFlags;
+
+	ASSERT_EQ(0, resampler.reInit(inLen, outLen));
+}
+
+/**
+ * Tear down the test.
+ */
+void ResamplerTest::TearDown(void)
+{
+	CPU_Flags = cpuFlags_old;
+}
+
+/**
+ * Generate a block of a sine wave.
+ * @param buf Destination buffer.
+ * @param len Number of samples.
+ * @param start Index of the first sample.
+ * @param freq Frequency, in cycles per sample.
+ * @param amp Amplitude.
+ */
+void ResamplerTest::genSine(int32_t *buf, int len, int start, double freq, double amp)
+{
+	for (int i = 0; i < len; i++) {
+		buf[i] = (int32_t)lrint(amp * sin(2.0 * M_PI * freq * (double)(start + i)));
+	}
+}
+
+/**
+ * Invalid block lengths should be rejected.
+ */
+TEST_P(ResamplerTest, reInitInvalid)
+{
+	Resampler tmp;
+	EXPECT_NE(0, tmp.reInit(0, outLen));
+	EXPECT_NE(0, tmp.reInit(Resampler::MAX_INPUT + 1, outLen));
+	// Uninitialized resampler shouldn't produce any output.
+	EXPECT_EQ(0, tmp.process(srcL, srcR, destL, destR));
+}
+
+/**
+ * A DC signal should pass through unchanged.
+ */
+TEST_P(ResamplerTest, dcPassthrough)
+{
+	for (int i = 0; i < inLen; i++) {
+		srcL[i] = 10000;
+		srcR[i] = -10000;
+	}
+
+	// The first block includes the filter's startup transient.
+	ASSERT_EQ(outLen, resampler.process(srcL, srcR, destL, destR));
+
+	for (int block = 0; block < 4; block++) {
+		ASSERT_EQ(outLen, resampler.process(srcL, srcR, destL, destR));
+		for (int i = 0; i < outLen; i++) {
+			EXPECT_NEAR(10000, destL[i], 2) << "block " << block << ", sample " << i;
+			EXPECT_NEAR(-10000, destR[i], 2) << "block " << block << ", sample " << i;
+		}
+	}
+}
+
+/**
+ * A 1 kHz sine wave should keep its amplitude.
+ */
+TEST_P(ResamplerTest, sineAmplitude)
+{
+	// 1 kHz at the input rate.
+	const double freq = 1000.0 / (inLen * 60.0);
+	const double amp = 16384.0;
+
+	double sumSq = 0.0;
+	int count = 0;
+	for (int block = 0; block < 8; block++) {
+		genSine(srcL, inLen, block * inLen, freq, amp);
+		genSine(srcR, inLen, block * inLen, freq, -amp);
+		ASSERT_EQ(outLen, resampler.process(srcL, srcR, destL, destR));
+		if (block == 0)
+			continue;
+
+		for (int i = 0; i < outLen; i++) {
+			// Output must stay within the input's range.
+			EXPECT_LE(abs(destL[i]), (int)amp + 64);
+			// Channels are inverted.
+			EXPECT_NEAR(destL[i], -destR[i], 1);
+			sumSq += (double)destL[i] * (double)destL[i];
+			count++;
+		}
+	}
+
+	// RMS of a sine wave is amp / sqrt(2).
+	const double rms = sqrt(sumSq / count);
+	EXPECT_NEAR(amp / sqrt(2.0), rms, amp * 0.01);
+}
+
+/**
+ * Optimized output should match the C++ implementation.
+ */
+TEST_P(ResamplerTest, matchesNoasm)
+{
+	Resampler ref;
+	ASSERT_EQ(0, ref.reInit(inLen, outLen));
+	int32_t refL[outLen], refR[outLen];
+
+	const double freq = 3000.0 / (inLen * 60.0);
+	for (int block = 0; block < 4; block++) {
+		genSine(srcL, inLen, block * inLen, freq, 20000.0);
+		genSine(srcR, inLen, block * inLen, freq * 2.0, 8000.0);
+
+		ASSERT_EQ(outLen, resampler.process(srcL, srcR, destL, destR));
+
+		const uint32_t flags = CPU_Flags;
+		CPU_Flags = 0;
+		ASSERT_EQ(outLen, ref.process(srcL, srcR, refL, refR));
+		CPU_Flags = flags;
+
+		// Summation order differs, so allow a
+		// small amount of rounding error.
+		for (int i = 0; i < outLen; i++) {
+			EXPECT_NEAR(refL[i], destL[i], 1) << "block " << block << ", sample " << i;
+			EXPECT_NEAR(refR[i], destR[i], 1) << "block " << block << ", sample " << i;
+		}
+	}
+}
+
+// Test cases.
+
+INSTANTIATE_TEST_CASE_P(ResamplerTest_NoFlags, ResamplerTest,
+	::testing::Values(ResamplerTest_flags(0, 0)
+));
+
+// NOTE: Resampler only implements SSE2 using GNU assembler.
+#if defined(__GNUC__) && \
+    (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
+INSTANTIATE_TEST_CASE_P(ResamplerTest_SSE2, ResamplerTest,
+	::testing::Values(ResamplerTest_flags(MDP_CPUFLAG_X86_SSE2, MDP_CPUFLAG_X86_SSE2SLOW)
+));
+#endif
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Resampler test.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,238 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * Ym2612TimerTest.cpp: YM2612 timer test.                                 *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+
+// LibGens YM2612.
+#include "sound/Ym2612.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+
+namespace LibGens { namespace Tests {
+
+class Ym2612TimerTest : public ::testing::Test
+{
+	protected:
+		Ym2612TimerTest()
+			: ::testing::Test()
+			, m_ym2612(nullptr) { }
+		virtual ~Ym2612TimerTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		/**
+		 * Write a YM2612 bank 0 register.
+		 * @param ym2612 YM2612.
+		 * @param reg Register number.
+		 * @param data Data.
+		 */
+		static void writeReg(Ym2612 *ym2612, uint8_t reg, uint8_t data);
+
+		/**
+		 * Run scanlines until a status bit is set.
+		 * @param ym2612 YM2612.
+		 * @param mask Status bit mask.
+		 * @param maxLines Maximum number of scanlines to run.
+		 * @return Number of scanlines run, or -1 if the bit wasn't set.
+		 */
+		int runUntilStatus(Ym2612 *ym2612, uint8_t mask, int maxLines);
+
+	protected:
+		// NTSC clock and YM2612 native rate.
+		static const int clock = 53693175 / 7;
+		static const int rate = 53268;
+		// Samples per scanline. (approximate)
+		static const int lineLen = 3;
+
+		Ym2612 *m_ym2612;
+
+		// Dummy audio buffers.
+		// The DAC is disabled, so these aren't modified.
+		int32_t m_bufL[lineLen];
+		int32_t m_bufR[lineLen];
+};
+
+const int Ym2612TimerTest::clock;
+const int Ym2612TimerTest::rate;
+const int Ym2612TimerTest::lineLen;
+
+/**
+ * Set up the YM2612 for testing.
+ */
+void Ym2612TimerTest::SetUp(void)
+{
+	m_ym2612 = new Ym2612(clock, rate);
+	m_ym2612->reset();
+}
+
+void Ym2612TimerTest::TearDown(void)
+{
+	delete m_ym2612;
+	m_ym2612 = nullptr;
+}
+
+/**
+ * Write a YM2612 bank 0 register.
+ * @param ym2612 YM2612.
+ * @param reg Register number.
+ * @param data Data.
+ */
+void Ym2612TimerTest::writeReg(Ym2612 *ym2612, uint8_t reg, uint8_t data)
+{
+	ym2612->write(0, reg);
+	ym2612->write(1, data);
+}
+
+/**
+ * Run scanlines until a status bit is set.
+ * @param ym2612 YM2612.
+ * @param mask Status bit mask.
+ * @param maxLines Maximum number of scanlines to run.
+ * @return Number of scanlines run, or -1 if the bit wasn't set.
+ */
+int Ym2612TimerTest::runUntilStatus(Ym2612 *ym2612, uint8_t mask, int maxLines)
+{
+	for (int line = 1; line <= maxLines; line++) {
+		ym2612->updateDacAndTimers(m_bufL, m_bufR, lineLen);
+		if (ym2612->read() & mask)
+			return line;
+	}
+	return -1;
+}
+
+/**
+ * Timer A should overflow after the programmed period.
+ */
+TEST_F(Ym2612TimerTest, timerAOverflow)
+{
+	// Timer A = 0x300. (period == 256 timer units)
+	writeReg(m_ym2612, 0x24, 0xC0);
+	writeReg(m_ym2612, 0x25, 0x00);
+	// Load and enable timer A.
+	writeReg(m_ym2612, 0x27, 0x05);
+	EXPECT_EQ(0, m_ym2612->read() & 0x03);
+
+	// Timer A ticks once per sample. (144 clocks)
+	// 256 units == 256 samples == ~86 scanlines.
+	int lines = runUntilStatus(m_ym2612, 0x01, 1000);
+	EXPECT_GE(lines, 85);
+	EXPECT_LE(lines, 87);
+
+	// Timer B is not enabled.
+	EXPECT_EQ(0, m_ym2612->read() & 0x02);
+}
+
+/**
+ * Timer B should overflow after the programmed period.
+ */
+TEST_F(Ym2612TimerTest, timerBOverflow)
+{
+	// Timer B = 0xC0. (period == 64 timer units)
+	writeReg(m_ym2612, 0x26, 0xC0);
+	// Load and enable timer B.
+	writeReg(m_ym2612, 0x27, 0x0A);
+	EXPECT_EQ(0, m_ym2612->read() & 0x03);
+
+	// Timer B ticks once every 16 samples.
+	// 64 units == 1024 samples == ~342 scanlines.
+	int lines = runUntilStatus(m_ym2612, 0x02, 10000);
+	EXPECT_GE(lines, 341);
+	EXPECT_LE(lines, 343);
+
+	// Timer A is not enabled.
+	EXPECT_EQ(0, m_ym2612->read() & 0x01);
+}
+
+/**
+ * Writing to the reset bits should clear the status flags.
+ */
+TEST_F(Ym2612TimerTest, statusReset)
+{
+	writeReg(m_ym2612, 0x24, 0xC0);
+	writeReg(m_ym2612, 0x25, 0x00);
+	writeReg(m_ym2612, 0x27, 0x05);
+	ASSERT_NE(-1, runUntilStatus(m_ym2612, 0x01, 1000));
+
+	// Reset timer A's status flag, keeping the timer enabled.
+	writeReg(m_ym2612, 0x27, 0x15);
+	EXPECT_EQ(0, m_ym2612->read() & 0x01);
+}
+
+/**
+ * Reading the status register once after many scanlines
+ * should have the same result as reading it every scanline.
+ */
+TEST_F(Ym2612TimerTest, lazyMatchesPolled)
+{
+	Ym2612 lazy(clock, rate);
+	lazy.reset();
+
+	Ym2612 *const ym[2] = {m_ym2612, &lazy};
+	for (int i = 0; i < 2; i++) {
+		writeReg(ym[i], 0x24, 0xC0);
+		writeReg(ym[i], 0x25, 0x00);
+		writeReg(ym[i], 0x26, 0xC0);
+		writeReg(ym[i], 0x27, 0x0F);
+	}
+
+	// Run several timer A periods without polling the lazy YM2612.
+	for (int line = 0; line < 1000; line++) {
+		m_ym2612->updateDacAndTimers(m_bufL, m_bufR, lineLen);
+		m_ym2612->read();
+		lazy.updateDacAndTimers(m_bufL, m_bufR, lineLen);
+	}
+	EXPECT_EQ(m_ym2612->read(), lazy.read());
+
+	// Reset both status flags. The next overflows
+	// should occur on the same scanlines.
+	for (int i = 0; i < 2; i++) {
+		writeReg(ym[i], 0x27, 0x3F);
+	}
+	EXPECT_EQ(runUntilStatus(m_ym2612, 0x01, 1000),
+		  runUntilStatus(&lazy, 0x01, 1000));
+	EXPECT_EQ(runUntilStatus(m_ym2612, 0x02, 10000),
+		  runUntilStatus(&lazy, 0x02, 10000));
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: YM2612 timer tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -191,6 +191,35 @@ int Archive::readFile(const mdp_z_entry_t *z_entry,
 }
 
 
+/**
+ * Get a pointer to the file data, if the file is mapped into memory.
+ * Only uncompressed files can be mapped.
+ * @param z_entry	[in] Pointer to mdp_z_entry_t describing the file.
+ * @return Mapped file data, or nullptr if not available.
+ */
+const uint8_t *Archive::mappedData(const mdp_z_entry_t *z_entry) const
+{
+	// Not supported by default.
+	((void)z_entry);
+	return nullptr;
+}
+
+/**
+ * Map a copy-on-write view of a file.
+ * Only uncompressed files can be mapped.
+ * @param z_entry	[in] Pointer to mdp_z_entry_t describing the file.
+ * @param siz		[in] Size of the mapping. Anything past the end of the file is zero-filled.
+ * @return Writable mapping, or nullptr if not available.
+ */
+void *Archive::mapCopyOnWrite(const mdp_z_entry_t *z_entry, size_t siz)
+{
+	// Not supported by default.
+	((void)z_entry);
+	((void)siz);
+	m_lastError = ENOTSUP;
+	return nullptr;
+}
+
 /**
  * Free an allocated mdp_z_entry_t list.
  * @param z_entry Pointer to the first entry in the list.
@@ -156,6 +156,23 @@ class Archive
 				     file_offset_t start_pos, file_offset_t read_len,
 				     void *buf, file_offset_t siz, file_offset_t *ret_siz);
 
+		/**
+		 * Get a pointer to the file data, if the file is mapped into memory.
+		 * Only uncompressed files can be mapped.
+		 * @param z_entry	[in] Pointer to mdp_z_entry_t describing the file.
+		 * @return Mapped file data, or nullptr if not available.
+		 */
+		virtual const uint8_t *mappedData(const mdp_z_entry_t *z_entry) const;
+
+		/**
+		 * Map a copy-on-write view of a file.
+		 * Only uncompressed files can be mapped.
+		 * @param z_entry	[in] Pointer to mdp_z_entry_t describing the file.
+		 * @param siz		[in] Size of the mapping. Anything past the end of the file is zero-filled.
+		 * @return Writable mapping, or nullptr if not available.
+		 */
+		virtual void *mapCopyOnWrite(const mdp_z_entry_t *z_entry, size_t siz);
+
 		/**
 		 * Free an allocated mdp_z_entry_t list.
 		 * @param z_entry Pointer to the first entry in the list.
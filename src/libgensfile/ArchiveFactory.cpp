@@ -23,6 +23,7 @@
 
 #include "ArchiveFactory.hpp"
 #include "Archive.hpp"
+#include "MemMapped.hpp"
 
 #ifdef HAVE_ZLIB
 #include "Gzip.hpp"
@@ -109,7 +110,19 @@ Archive *ArchiveFactory::openArchive(const char *filename)
 	delete archive;
 	archive = nullptr;
 #endif /* HAVE_MINIZIP */
+#endif /* HAVE_ZLIB */
+
+	// Try mapping the file into memory.
+	// This only works for uncompressed files, which
+	// can then be accessed without any extra copies.
+	archive = new MemMapped(filename);
+	if (archive->isOpen())
+		return archive;
 
+	delete archive;
+	archive = nullptr;
+
+#ifdef HAVE_ZLIB
 	// Try Gzip (zlib).
 	// Note that zlib will handle uncompressed files
 	// as well as compressed files, so this attempt
@@ -0,0 +1,326 @@
+/***************************************************************************
+ * libgensfile: Gens file handling library.                                *
+ * MemMapped.cpp: Memory-mapped handler for uncompressed files.            *
+ *                                                                         *
+ * Copyright (c) 2008-2016 by David Korth.                                 *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include <config.libgensfile.h>
+
+#include "MemMapped.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+// Win32 requires io.h for _get_osfhandle().
+#include <io.h>
+#include <windows.h>
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+// Also required for large file support.
+#include "libcompat/W32U/W32U_mini.h"
+#elif defined(HAVE_MMAP)
+#include <sys/mman.h>
+#include <unistd.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+namespace LibGensFile {
+
+/**
+ * Open a file with this archive handler.
+ * The file is mapped into memory read-only.
+ * Compressed files (gzip) are rejected, since
+ * they have to be handled by the Gzip class.
+ *
+ * Check isOpen() afterwards to see if the file was opened.
+ * If it wasn't, check lastError() for the POSIX error code.
+ *
+ * @param filename Name of the file to open.
+ */
+MemMapped::MemMapped(const char *filename)
+	: Archive(filename)
+	, m_data(nullptr)
+	, m_size(0)
+#ifdef _WIN32
+	, m_hMapping(nullptr)
+#endif /* _WIN32 */
+{
+	if (!m_file)
+		return;
+
+	// Get the filesize.
+	// Empty files can't be mapped.
+	fseeko(m_file, 0, SEEK_END);
+	const int64_t filesize = ftello(m_file);
+	if (filesize <= 0 || (uint64_t)filesize > (uint64_t)(size_t)-1) {
+		m_lastError = (filesize < 0 ? errno : EINVAL);
+		close();
+		return;
+	}
+	m_size = (size_t)filesize;
+
+	// Check for gzip magic.
+	// zlib handles transparent decompression,
+	// so gzipped files are opened by the Gzip class.
+	static const uint8_t gzip_magic[2] = {0x1F, 0x8B};
+	uint8_t magic[2];
+	rewind(m_file);
+	if (fread(magic, 1, sizeof(magic), m_file) == sizeof(magic) &&
+	    !memcmp(magic, gzip_magic, sizeof(magic)))
+	{
+		m_lastError = EIO;
+		close();
+		return;
+	}
+
+#if defined(_WIN32)
+	HANDLE hFile = (HANDLE)_get_osfhandle(fileno(m_file));
+	HANDLE hMapping = CreateFileMapping(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (hMapping) {
+		m_data = (const uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+		if (m_data) {
+			m_hMapping = hMapping;
+		} else {
+			CloseHandle(hMapping);
+		}
+	}
+#elif defined(HAVE_MMAP)
+	void *ptr = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fileno(m_file), 0);
+	if (ptr != MAP_FAILED) {
+		m_data = (const uint8_t*)ptr;
+	}
+#endif
+
+	if (!m_data) {
+		// Unable to map the file.
+		// TODO: Get the error code from the OS.
+		m_lastError = ENOTSUP;
+		close();
+	}
+}
+
+/**
+ * Delete the MemMapped object.
+ */
+MemMapped::~MemMapped()
+{
+	close();
+}
+
+/**
+ * Close the archive file.
+ */
+void MemMapped::close(void)
+{
+	if (m_data) {
+#if defined(_WIN32)
+		UnmapViewOfFile(m_data);
+		CloseHandle((HANDLE)m_hMapping);
+		m_hMapping = nullptr;
+#elif defined(HAVE_MMAP)
+		munmap((void*)m_data, m_size);
+#endif
+		m_data = nullptr;
+	}
+	m_size = 0;
+
+	// Base class closes the FILE*.
+	Archive::close();
+}
+
+/**
+ * Get information about all files in the archive.
+ * @param z_entry_out Pointer to mdp_z_entry_t*, which will contain an allocated mdp_z_entry_t.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int MemMapped::getFileInfo(mdp_z_entry_t **z_entry_out)
+{
+	if (!z_entry_out) {
+		m_lastError = EINVAL;
+		return -m_lastError; // TODO: return -MDP_ERR_INVALID_PARAMETERS;
+	} else if (!m_data) {
+		m_lastError = EBADF;
+		return -m_lastError; // TODO: return -MDP_ERR_INVALID_PARAMETERS;
+	}
+
+	// Allocate an mdp_z_entry_t.
+	// NOTE: C-style malloc() is used because MDP is a C API.
+	mdp_z_entry_t *z_entry = (mdp_z_entry_t*)malloc(sizeof(mdp_z_entry_t));
+	if (!z_entry) {
+		m_lastError = ENOMEM;
+		return -m_lastError;
+	}
+
+	// Set the elements of the list entry.
+	z_entry->filesize = m_size;
+	z_entry->filename = (!m_filename.empty() ? strdup(m_filename.c_str()) : nullptr);
+	z_entry->next = nullptr;
+
+	// Return the list.
+	*z_entry_out = z_entry;
+	return 0; // TODO: return MDP_ERR_OK;
+}
+
+/**
+ * Read all or part of a file from the archive.
+ * The data is copied directly from the file mapping.
+ *
+ * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to extract.
+ * @param start_pos	[in]  Starting position within the file.
+ * @param read_len	[in]  Number of bytes to read.
+ * @param buf		[out] Buffer to read the file into.
+ * @param siz		[in]  Size of buf. (Must be >= read_len.)
+ * @param ret_siz	[out] Pointer to file_offset_t to store the number of bytes read.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int MemMapped::readFile(const mdp_z_entry_t *z_entry,
+			file_offset_t start_pos, file_offset_t read_len,
+			void *buf, file_offset_t siz, file_offset_t *ret_siz)
+{
+	// We're using m_size instead of z_entry->filesize.
+	const file_offset_t size = (file_offset_t)m_size;
+	if (!z_entry || !buf ||
+	    start_pos < 0 || start_pos >= size ||
+	    read_len < 0 || size - read_len < start_pos ||
+	    siz <= 0 || siz < read_len)
+	{
+		m_lastError = EINVAL;
+		return -m_lastError; // TODO: return -MDP_ERR_INVALID_PARAMETERS;
+	} else if (!m_data) {
+		m_lastError = EBADF;
+		return -m_lastError; // TODO: return -MDP_ERR_INVALID_PARAMETERS;
+	}
+
+	// Copy the data from the mapping.
+	memcpy(buf, &m_data[start_pos], (size_t)read_len);
+	*ret_siz = read_len;
+	return 0; // TODO: return MDP_ERR_OK;
+}
+
+/**
+ * Get a pointer to the mapped file data.
+ * @param z_entry	[in] Pointer to mdp_z_entry_t describing the file.
+ * @return Mapped file data, or nullptr if not available.
+ */
+const uint8_t *MemMapped::mappedData(const mdp_z_entry_t *z_entry) const
+{
+	if (!z_entry || z_entry->filesize != m_size)
+		return nullptr;
+	return m_data;
+}
+
+/**
+ * Map a copy-on-write view of a file.
+ * Pages are shared with the page cache (and with any other
+ * process that has the file mapped) until they're written to.
+ * The mapping must be freed with unmapCopyOnWrite().
+ * @param z_entry	[in] Pointer to mdp_z_entry_t describing the file.
+ * @param siz		[in] Size of the mapping. Anything past the end of the file is zero-filled.
+ * @return Writable mapping, or nullptr on error.
+ */
+void *MemMapped::mapCopyOnWrite(const mdp_z_entry_t *z_entry, size_t siz)
+{
+	if (!m_data || !z_entry || z_entry->filesize != m_size || siz < m_size) {
+		m_lastError = EINVAL;
+		return nullptr;
+	}
+
+	int err = 0;
+	void *ptr = mapFileCopyOnWrite(m_file, 0, m_size, siz, &err);
+	if (!ptr) {
+		m_lastError = err;
+	}
+	return ptr;
+}
+
+/**
+ * Map a copy-on-write view of part of an open file.
+ * Pages are shared with the page cache (and with any other
+ * process that has the file mapped) until they're written to.
+ * The mapping must be freed with unmapCopyOnWrite().
+ *
+ * NOTE: If the file is truncated while it's mapped,
+ * accessing the missing pages will raise SIGBUS.
+ *
+ * @param f		[in]  Open file.
+ * @param offset	[in]  Starting offset. (Must be a multiple of the page size.)
+ * @param len		[in]  Number of bytes to map from the file.
+ * @param siz		[in]  Size of the mapping. (Must be >= len; the rest is zero-filled.)
+ * @param pErr		[out] POSIX error code on error.
+ * @return Writable mapping, or nullptr on error.
+ */
+void *MemMapped::mapFileCopyOnWrite(FILE *f, int64_t offset, size_t len, size_t siz, int *pErr)
+{
+	if (!f || offset < 0 || len == 0 || siz < len) {
+		*pErr = EINVAL;
+		return nullptr;
+	}
+
+#if !defined(_WIN32) && defined(HAVE_MMAP)
+	// Reserve the entire area with zero-filled pages,
+	// then map the file over the beginning of it.
+	// NOTE: The last page of the file is zero-filled by the OS.
+	void *ptr = mmap(nullptr, siz, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED) {
+		*pErr = errno;
+		return nullptr;
+	}
+
+	void *fptr = mmap(ptr, len, PROT_READ | PROT_WRITE,
+			  MAP_PRIVATE | MAP_FIXED, fileno(f), (off_t)offset);
+	if (fptr == MAP_FAILED) {
+		*pErr = errno;
+		munmap(ptr, siz);
+		return nullptr;
+	}
+	return ptr;
+#else
+	// TODO: Win32 copy-on-write mappings can't be
+	// extended past the end of the file.
+	((void)offset);
+	*pErr = ENOTSUP;
+	return nullptr;
+#endif
+}
+
+/**
+ * Free a mapping created by mapCopyOnWrite().
+ * @param ptr Mapping.
+ * @param siz Size of the mapping.
+ */
+void MemMapped::unmapCopyOnWrite(void *ptr, size_t siz)
+{
+#if !defined(_WIN32) && defined(HAVE_MMAP)
+	if (ptr) {
+		munmap(ptr, siz);
+	}
+#else
+	((void)ptr);
+	((void)siz);
+#endif
+}
+
+}
@@ -0,0 +1,130 @@
+/***************************************************************************
+ * libgensfile: Gens file handling library.                                *
+ * MemMapped.hpp: Memory-mapped handler for uncompressed files.            *
+ *                                                                         *
+ * Copyright (c) 2008-2016 by David Korth.                                 *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENSFILE_MEMMAPPED_HPP__
+#define __LIBGENSFILE_MEMMAPPED_HPP__
+
+#include "Archive.hpp"
+
+namespace LibGensFile {
+
+class MemMapped : public Archive
+{
+	public:
+		/**
+		 * Open a file with this archive handler.
+		 * The file is mapped into memory read-only.
+		 * Compressed files (gzip) are rejected, since
+		 * they have to be handled by the Gzip class.
+		 *
+		 * Check isOpen() afterwards to see if the file was opened.
+		 * If it wasn't, check lastError() for the POSIX error code.
+		 *
+		 * @param filename Name of the file to open.
+		 */
+		MemMapped(const char *filename);
+		virtual ~MemMapped();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		MemMapped(const MemMapped &);
+		MemMapped &operator=(const MemMapped &);
+
+	public:
+		/**
+		 * Close the archive file.
+		 */
+		virtual void close(void) final;
+
+		/**
+		 * Get information about all files in the archive.
+		 * @param z_entry_out Pointer to mdp_z_entry_t*, which will contain an allocated mdp_z_entry_t.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		virtual int getFileInfo(mdp_z_entry_t **z_entry_out) final;
+
+		/**
+		 * Read all or part of a file from the archive.
+		 * The data is copied directly from the file mapping.
+		 *
+		 * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to extract.
+		 * @param start_pos	[in]  Starting position within the file.
+		 * @param read_len	[in]  Number of bytes to read.
+		 * @param buf		[out] Buffer to read the file into.
+		 * @param siz		[in]  Size of buf. (Must be >= read_len.)
+		 * @param ret_siz	[out] Pointer to file_offset_t to store the number of bytes read.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		virtual int readFile(const mdp_z_entry_t *z_entry,
+				     file_offset_t start_pos, file_offset_t read_len,
+				     void *buf, file_offset_t siz, file_offset_t *ret_siz) final;
+
+		/**
+		 * Get a pointer to the mapped file data.
+		 * @param z_entry	[in] Pointer to mdp_z_entry_t describing the file.
+		 * @return Mapped file data, or nullptr if not available.
+		 */
+		virtual const uint8_t *mappedData(const mdp_z_entry_t *z_entry) const final;
+
+		/**
+		 * Map a copy-on-write view of a file.
+		 * Pages are shared with the page cache (and with any other
+		 * process that has the file mapped) until they're written to.
+		 * The mapping must be freed with unmapCopyOnWrite().
+		 * @param z_entry	[in] Pointer to mdp_z_entry_t describing the file.
+		 * @param siz		[in] Size of the mapping. Anything past the end of the file is zero-filled.
+		 * @return Writable mapping, or nullptr on error.
+		 */
+		virtual void *mapCopyOnWrite(const mdp_z_entry_t *z_entry, size_t siz) final;
+
+		/**
+		 * Map a copy-on-write view of part of an open file.
+		 * The mapping must be freed with unmapCopyOnWrite().
+		 * NOTE: If the file is truncated while it's mapped,
+		 * accessing the missing pages will raise SIGBUS.
+		 * @param f		[in]  Open file.
+		 * @param offset	[in]  Starting offset. (Must be a multiple of the page size.)
+		 * @param len		[in]  Number of bytes to map from the file.
+		 * @param siz		[in]  Size of the mapping. (Must be >= len; the rest is zero-filled.)
+		 * @param pErr		[out] POSIX error code on error.
+		 * @return Writable mapping, or nullptr on error.
+		 */
+		static void *mapFileCopyOnWrite(FILE *f, int64_t offset, size_t len, size_t siz, int *pErr);
+
+		/**
+		 * Free a mapping created by mapCopyOnWrite() or mapFileCopyOnWrite().
+		 * @param ptr Mapping.
+		 * @param siz Size of the mapping.
+		 */
+		static void unmapCopyOnWrite(void *ptr, size_t siz);
+
+	private:
+		const uint8_t *m_data;
+		size_t m_size;
+#ifdef _WIN32
+		void *m_hMapping;	// HANDLE
+#endif /* _WIN32 */
+};
+
+}
+
+#endif /* __LIBGENSFILE_MEMMAPPED_HPP__ */
@@ -0,0 +1,723 @@
+/***************************************************************************
+ * libgensfile: Gens file handling library.                                *
+ * RomCache.cpp: On-disk cache of decompressed ROM images.                 *
+ *                                                                         *
+ * Copyright (c) 2008-2016 by David Korth.                                 *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include <config.libgensfile.h>
+
+#include "RomCache.hpp"
+#include "MemMapped.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+using std::string;
+using std::vector;
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/utime.h>
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+#include "libcompat/W32U/W32U_mini.h"
+#define DIR_SEP_CHR '\\'
+#else /* !_WIN32 */
+#include <dirent.h>
+#include <utime.h>
+#define DIR_SEP_CHR '/'
+#endif /* _WIN32 */
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif /* HAVE_ZLIB */
+
+// Byteswapping macros.
+#include "libcompat/byteswap.h"
+
+namespace LibGensFile {
+
+class RomCachePrivate
+{
+	public:
+		RomCachePrivate(const char *cacheDir, int64_t maxSize);
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		RomCachePrivate(const RomCachePrivate &);
+		RomCachePrivate &operator=(const RomCachePrivate &);
+
+	public:
+		string cacheDir;
+		int64_t maxSize;
+
+		// Cache file header.
+		// All values are little-endian.
+		// The cache key and the ROM image follow the header.
+		static const char CACHE_MAGIC[8];
+		struct CacheHeader {
+			char magic[8];		// CACHE_MAGIC
+			uint32_t keyLen;	// Length of the cache key.
+			uint32_t dataLen;	// Length of the ROM image.
+			uint32_t crc32;		// CRC32 of the ROM image.
+			uint8_t romFormat;	// ROM format.
+			uint8_t sysId;		// System ID.
+			uint8_t reserved[2];
+		};
+
+		// Mappable image file header.
+		// All values are little-endian.
+		// The cache key follows the header. The image starts
+		// at dataOffset, which is a multiple of IMAGE_ALIGN
+		// so it can be mapped into memory directly.
+		static const char IMAGE_MAGIC[8];
+		struct ImageHeader {
+			char magic[8];		// IMAGE_MAGIC
+			uint32_t keyLen;	// Length of the cache key.
+			uint32_t dataLen;	// Length of the image.
+			uint32_t dataOffset;	// Offset of the image.
+			uint32_t crc32;		// CRC32 of the original ROM image.
+			uint32_t imgCrc32;	// CRC32 of the image as stored.
+			uint8_t reserved[4];
+		};
+
+		// Image alignment.
+		// This is a multiple of the page size on all supported
+		// systems, including the Win32 allocation granularity.
+		static const uint32_t IMAGE_ALIGN = 65536;
+
+		// Cache file extension.
+		static const char CACHE_EXT[];
+
+		/**
+		 * Write a cache file.
+		 * The file is written to a temporary file first, then
+		 * renamed, so an interrupted write doesn't leave a
+		 * partial cache file behind, and a cache file that's
+		 * currently mapped into memory is never truncated.
+		 * @param filename	[in] Cache filename.
+		 * @param header	[in] File header.
+		 * @param header_size	[in] Size of header.
+		 * @param key		[in] Cache key. (Written after the header.)
+		 * @param dataOffset	[in] Offset of the data, or 0 to write it right after the key.
+		 * @param data		[in] Data.
+		 * @param size		[in] Size of data.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int writeCacheFile(const string &filename,
+				const void *header, size_t header_size,
+				const string &key, size_t dataOffset,
+				const uint8_t *data, size_t size);
+
+		/**
+		 * Get the cache filename for a cache key.
+		 * @param key Cache key.
+		 * @return Cache filename.
+		 */
+		string cacheFilename(const string &key) const;
+
+		/**
+		 * Calculate a CRC32.
+		 * @param data Data.
+		 * @param size Size of data.
+		 * @return CRC32, or 0 if zlib isn't available.
+		 */
+		static uint32_t calcCrc32(const uint8_t *data, size_t size);
+};
+
+const char RomCachePrivate::CACHE_MAGIC[8] = {'G','E','N','S','R','O','M','1'};
+const char RomCachePrivate::IMAGE_MAGIC[8] = {'G','E','N','S','I','M','G','1'};
+const char RomCachePrivate::CACHE_EXT[] = ".rom";
+
+RomCachePrivate::RomCachePrivate(const char *cacheDir, int64_t maxSize)
+	: cacheDir(cacheDir ? cacheDir : "")
+	, maxSize(maxSize)
+{
+	// Make sure the cache directory ends with a separator.
+	if (!this->cacheDir.empty() &&
+	    this->cacheDir[this->cacheDir.size()-1] != DIR_SEP_CHR)
+	{
+		this->cacheDir += DIR_SEP_CHR;
+	}
+}
+
+/**
+ * Get the cache filename for a cache key.
+ * @param key Cache key.
+ * @return Cache filename.
+ */
+string RomCachePrivate::cacheFilename(const string &key) const
+{
+	// 64-bit FNV-1a hash of the key.
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < key.size(); i++) {
+		hash ^= (uint8_t)key[i];
+		hash *= 0x100000001B3ULL;
+	}
+
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%08X%08X",
+		 (unsigned int)(hash >> 32), (unsigned int)hash);
+	return cacheDir + buf + CACHE_EXT;
+}
+
+/**
+ * Calculate a CRC32.
+ * @param data Data.
+ * @param size Size of data.
+ * @return CRC32, or 0 if zlib isn't available.
+ */
+uint32_t RomCachePrivate::calcCrc32(const uint8_t *data, size_t size)
+{
+#ifdef HAVE_ZLIB
+	uLong crc = crc32(0, nullptr, 0);
+	// Process the data in chunks in case size is larger than uInt.
+	static const size_t CHUNK_SIZE = 1024*1024;
+	while (size > 0) {
+		const size_t len = std::min(size, CHUNK_SIZE);
+		crc = crc32(crc, data, (uInt)len);
+		data += len;
+		size -= len;
+	}
+	return (uint32_t)crc;
+#else /* !HAVE_ZLIB */
+	((void)data);
+	((void)size);
+	return 0;
+#endif /* HAVE_ZLIB */
+}
+
+/**
+ * Write a cache file.
+ * The file is written to a temporary file first, then
+ * renamed, so an interrupted write doesn't leave a
+ * partial cache file behind, and a cache file that's
+ * currently mapped into memory is never truncated.
+ * @param filename	[in] Cache filename.
+ * @param header	[in] File header.
+ * @param header_size	[in] Size of header.
+ * @param key		[in] Cache key. (Written after the header.)
+ * @param dataOffset	[in] Offset of the data, or 0 to write it right after the key.
+ * @param data		[in] Data.
+ * @param size		[in] Size of data.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomCachePrivate::writeCacheFile(const string &filename,
+		const void *header, size_t header_size,
+		const string &key, size_t dataOffset,
+		const uint8_t *data, size_t size)
+{
+	const string tmpFilename = filename + ".tmp";
+	FILE *f = fopen(tmpFilename.c_str(), "wb");
+	if (!f)
+		return -errno;
+
+	bool ok = (fwrite(header, 1, header_size, f) == header_size);
+	ok = ok && (fwrite(key.data(), 1, key.size(), f) == key.size());
+	if (ok && dataOffset > header_size + key.size()) {
+		// Pad the file up to the data offset.
+		ok = (fseeko(f, dataOffset, SEEK_SET) == 0);
+	}
+	ok = ok && (fwrite(data, 1, size, f) == size);
+	int ret = 0;
+	if (!ok) {
+		ret = (errno != 0 ? -errno : -EIO);
+	}
+	if (fclose(f) != 0 && ret == 0) {
+		ret = (errno != 0 ? -errno : -EIO);
+	}
+	if (ret != 0) {
+		remove(tmpFilename.c_str());
+		return ret;
+	}
+
+#ifdef _WIN32
+	// rename() fails on Windows if the destination exists.
+	remove(filename.c_str());
+#endif /* _WIN32 */
+	if (rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+		ret = -errno;
+		remove(tmpFilename.c_str());
+		return ret;
+	}
+	return 0;
+}
+
+/** RomCache **/
+
+/**
+ * Create a ROM cache.
+ * @param cacheDir Cache directory. (Must already exist.)
+ * @param maxSize Maximum cache size, in bytes.
+ */
+RomCache::RomCache(const char *cacheDir, int64_t maxSize)
+	: d(new RomCachePrivate(cacheDir, maxSize))
+{ }
+
+RomCache::~RomCache()
+{
+	delete d;
+}
+
+/**
+ * Get the cache directory.
+ * @return Cache directory.
+ */
+string RomCache::cacheDir(void) const
+{
+	return d->cacheDir;
+}
+
+/**
+ * Get the maximum cache size.
+ * @return Maximum cache size, in bytes.
+ */
+int64_t RomCache::maxSize(void) const
+{
+	return d->maxSize;
+}
+
+/**
+ * Set the maximum cache size.
+ * If the cache is larger than the new size,
+ * it will be trimmed on the next store().
+ * @param maxSize Maximum cache size, in bytes.
+ */
+void RomCache::setMaxSize(int64_t maxSize)
+{
+	d->maxSize = maxSize;
+}
+
+/**
+ * Create a cache key for a file in an archive.
+ * @param filename Archive filename.
+ * @param z_filename Filename of the file within the archive. (May be nullptr.)
+ * @param z_filesize Size of the file within the archive.
+ * @return Cache key, or empty string if the archive couldn't be found.
+ */
+string RomCache::makeKey(const char *filename, const char *z_filename, int64_t z_filesize)
+{
+	if (!filename || filename[0] == 0)
+		return string();
+
+	struct stat st;
+	if (stat(filename, &st) != 0)
+		return string();
+
+	// NOTE: Using '\n' as a separator, since it's
+	// very unlikely to show up in a filename.
+	char buf[64];
+	snprintf(buf, sizeof(buf), "\n%lld\n%lld\n%lld\n",
+		 (long long)st.st_mtime, (long long)st.st_size,
+		 (long long)z_filesize);
+	string key(filename);
+	key += buf;
+	if (z_filename) {
+		key += z_filename;
+	}
+	return key;
+}
+
+/**
+ * Look up a ROM image in the cache.
+ * The ROM image is marked as recently used.
+ * @param key	[in]  Cache key.
+ * @param entry	[out] Cached ROM image.
+ * @return 0 on success; negative POSIX error code on error. (-ENOENT if not cached)
+ */
+int RomCache::lookup(const string &key, Entry *entry)
+{
+	if (key.empty() || !entry || d->cacheDir.empty())
+		return -EINVAL;
+
+	const string filename = d->cacheFilename(key);
+	FILE *f = fopen(filename.c_str(), "rb");
+	if (!f)
+		return -ENOENT;
+
+	// Read and verify the header.
+	RomCachePrivate::CacheHeader header;
+	if (fread(&header, 1, sizeof(header), f) != sizeof(header) ||
+	    memcmp(header.magic, RomCachePrivate::CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+	    le32_to_cpu(header.keyLen) != key.size())
+	{
+		// Not a valid cache file.
+		fclose(f);
+		return -ENOENT;
+	}
+
+	// Verify the cache key.
+	// (Two keys might have the same hash.)
+	string fileKey(key.size(), 0);
+	if (fread(&fileKey[0], 1, key.size(), f) != key.size() || fileKey != key) {
+		fclose(f);
+		return -ENOENT;
+	}
+
+	// Read the ROM image.
+	const uint32_t dataLen = le32_to_cpu(header.dataLen);
+	entry->data.resize(dataLen);
+	size_t size = (dataLen > 0 ? fread(&entry->data[0], 1, dataLen, f) : 0);
+	fclose(f);
+	if (dataLen == 0 || size != dataLen) {
+		// Short read. The cache file is corrupted.
+		entry->data.clear();
+		remove(filename.c_str());
+		return -ENOENT;
+	}
+
+	entry->crc32 = le32_to_cpu(header.crc32);
+#ifdef HAVE_ZLIB
+	if (RomCachePrivate::calcCrc32(&entry->data[0], dataLen) != entry->crc32) {
+		// CRC32 mismatch. The cache file is corrupted.
+		entry->data.clear();
+		remove(filename.c_str());
+		return -ENOENT;
+	}
+#endif /* HAVE_ZLIB */
+	entry->romFormat = header.romFormat;
+	entry->sysId = header.sysId;
+
+	// Mark the ROM image as recently used.
+	utime(filename.c_str(), nullptr);
+	return 0;
+}
+
+/**
+ * Store a ROM image in the cache.
+ * Least-recently used ROM images will be removed
+ * if the cache exceeds the maximum size.
+ * @param key		[in] Cache key.
+ * @param data		[in] ROM image.
+ * @param size		[in] Size of the ROM image.
+ * @param crc32		[in] CRC32 of the ROM image.
+ * @param romFormat	[in] ROM format. (Rom::RomFormat)
+ * @param sysId		[in] System ID. (Rom::MDP_SYSTEM_ID)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomCache::store(const string &key, const uint8_t *data, size_t size,
+		    uint32_t crc32, int romFormat, int sysId)
+{
+	if (key.empty() || !data || size == 0 || d->cacheDir.empty())
+		return -EINVAL;
+	if ((int64_t)size > d->maxSize) {
+		// ROM image is larger than the entire cache.
+		return -ENOSPC;
+	}
+
+	RomCachePrivate::CacheHeader header;
+	memcpy(header.magic, RomCachePrivate::CACHE_MAGIC, sizeof(header.magic));
+	header.keyLen = cpu_to_le32((uint32_t)key.size());
+	header.dataLen = cpu_to_le32((uint32_t)size);
+	header.crc32 = cpu_to_le32(crc32);
+	header.romFormat = (uint8_t)romFormat;
+	header.sysId = (uint8_t)sysId;
+	header.reserved[0] = 0;
+	header.reserved[1] = 0;
+
+	int ret = RomCachePrivate::writeCacheFile(d->cacheFilename(key),
+			&header, sizeof(header), key, 0, data, size);
+	if (ret != 0)
+		return ret;
+
+	// Make sure the cache isn't too big.
+	trim();
+	return 0;
+}
+
+/**
+ * Store a mappable image in the cache.
+ * The image is stored as-is, so it can be mapped into
+ * memory with mapImage() without any further processing.
+ * Least-recently used ROM images will be removed
+ * if the cache exceeds the maximum size.
+ * @param key	[in] Cache key.
+ * @param data	[in] Image.
+ * @param size	[in] Size of the image.
+ * @param crc32	[in] CRC32 of the original ROM image.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomCache::storeImage(const string &key, const uint8_t *data, size_t size, uint32_t crc32)
+{
+	if (key.empty() || !data || size == 0 || d->cacheDir.empty())
+		return -EINVAL;
+	if ((int64_t)size > d->maxSize) {
+		// Image is larger than the entire cache.
+		return -ENOSPC;
+	}
+
+	const size_t align = RomCachePrivate::IMAGE_ALIGN;
+	const size_t dataOffset = (sizeof(RomCachePrivate::ImageHeader) + key.size() + align - 1) & ~(align - 1);
+
+	RomCachePrivate::ImageHeader header;
+	memcpy(header.magic, RomCachePrivate::IMAGE_MAGIC, sizeof(header.magic));
+	header.keyLen = cpu_to_le32((uint32_t)key.size());
+	header.dataLen = cpu_to_le32((uint32_t)size);
+	header.dataOffset = cpu_to_le32((uint32_t)dataOffset);
+	header.crc32 = cpu_to_le32(crc32);
+	header.imgCrc32 = cpu_to_le32(RomCachePrivate::calcCrc32(data, size));
+	memset(header.reserved, 0, sizeof(header.reserved));
+
+	int ret = RomCachePrivate::writeCacheFile(d->cacheFilename(key),
+			&header, sizeof(header), key, dataOffset, data, size);
+	if (ret != 0)
+		return ret;
+
+	// Make sure the cache isn't too big.
+	trim();
+	return 0;
+}
+
+/**
+ * Map an image from the cache into memory. (copy-on-write)
+ * Pages are shared with every other process that has the
+ * same image mapped until they're written to.
+ * The image is marked as recently used.
+ *
+ * NOTE: Cache files are never modified in place, so removing
+ * or replacing the image while it's mapped is safe.
+ *
+ * @param key		[in]  Cache key.
+ * @param siz		[in]  Size of the mapping. (The rest is zero-filled.)
+ * @param pData		[out] Mapped image. Free it with unmapImage().
+ * @param pSize		[out] Size of the image.
+ * @param pCrc32	[out] CRC32 of the original ROM image.
+ * @return 0 on success; negative POSIX error code on error. (-ENOENT if not cached)
+ */
+int RomCache::mapImage(const string &key, size_t siz, void **pData, size_t *pSize, uint32_t *pCrc32)
+{
+	if (key.empty() || !pData || !pSize || !pCrc32 || d->cacheDir.empty())
+		return -EINVAL;
+
+	const string filename = d->cacheFilename(key);
+	FILE *f = fopen(filename.c_str(), "rb");
+	if (!f)
+		return -ENOENT;
+
+	// Read and verify the header.
+	RomCachePrivate::ImageHeader header;
+	if (fread(&header, 1, sizeof(header), f) != sizeof(header) ||
+	    memcmp(header.magic, RomCachePrivate::IMAGE_MAGIC, sizeof(header.magic)) != 0 ||
+	    le32_to_cpu(header.keyLen) != key.size())
+	{
+		// Not a valid image file.
+		fclose(f);
+		return -ENOENT;
+	}
+
+	// Verify the cache key.
+	// (Two keys might have the same hash.)
+	string fileKey(key.size(), 0);
+	if (fread(&fileKey[0], 1, key.size(), f) != key.size() || fileKey != key) {
+		fclose(f);
+		return -ENOENT;
+	}
+
+	// Make sure the image is actually in the file.
+	// Otherwise, accessing the mapping would raise SIGBUS.
+	const uint32_t dataLen = le32_to_cpu(header.dataLen);
+	const uint32_t dataOffset = le32_to_cpu(header.dataOffset);
+	struct stat st;
+	if (dataLen == 0 || (dataOffset % RomCachePrivate::IMAGE_ALIGN) != 0 ||
+	    fstat(fileno(f), &st) != 0 ||
+	    (int64_t)st.st_size < (int64_t)dataOffset + (int64_t)dataLen)
+	{
+		// The cache file is corrupted.
+		fclose(f);
+		remove(filename.c_str());
+		return -ENOENT;
+	}
+	if (siz < dataLen) {
+		fclose(f);
+		return -EINVAL;
+	}
+
+	int err = 0;
+	void *ptr = MemMapped::mapFileCopyOnWrite(f, dataOffset, dataLen, siz, &err);
+	fclose(f);
+	if (!ptr)
+		return -err;
+
+#ifdef HAVE_ZLIB
+	// This reads the pages, but doesn't copy them.
+	if (RomCachePrivate::calcCrc32((const uint8_t*)ptr, dataLen) != le32_to_cpu(header.imgCrc32)) {
+		// CRC32 mismatch. The cache file is corrupted.
+		unmapImage(ptr, siz);
+		remove(filename.c_str());
+		return -ENOENT;
+	}
+#endif /* HAVE_ZLIB */
+
+	*pData = ptr;
+	*pSize = dataLen;
+	*pCrc32 = le32_to_cpu(header.crc32);
+
+	// Mark the image as recently used.
+	utime(filename.c_str(), nullptr);
+	return 0;
+}
+
+/**
+ * Free an image mapped with mapImage().
+ * @param ptr Mapped image.
+ * @param siz Size of the mapping.
+ */
+void RomCache::unmapImage(void *ptr, size_t siz)
+{
+	MemMapped::unmapCopyOnWrite(ptr, siz);
+}
+
+/**
+ * Remove least-recently used ROM images until
+ * the cache is no larger than the maximum size.
+ * @return Number of ROM images removed, or negative POSIX error code on error.
+ */
+int RomCache::trim(void)
+{
+	if (d->cacheDir.empty())
+		return -EINVAL;
+
+	vector<string> files;
+	int ret = listFiles(d->cacheDir.c_str(), &files);
+	if (ret != 0)
+		return ret;
+
+	// Get the size and last access time of each cache file.
+	struct CacheFile {
+		const string *filename;
+		int64_t size;
+		int64_t mtime;
+
+		bool operator<(const CacheFile &other) const
+			{ return (mtime < other.mtime); }
+	};
+	vector<CacheFile> cacheFiles;
+	cacheFiles.reserve(files.size());
+	int64_t totalSize = 0;
+
+	const size_t extLen = sizeof(RomCachePrivate::CACHE_EXT) - 1;
+	for (vector<string>::const_iterator iter = files.begin();
+	     iter != files.end(); ++iter)
+	{
+		const string &filename = *iter;
+		if (filename.size() <= extLen ||
+		    filename.compare(filename.size() - extLen, extLen, RomCachePrivate::CACHE_EXT) != 0)
+		{
+			// Not a cache file.
+			continue;
+		}
+
+		struct stat st;
+		if (stat(filename.c_str(), &st) != 0)
+			continue;
+		CacheFile cacheFile = {&filename, (int64_t)st.st_size, (int64_t)st.st_mtime};
+		cacheFiles.push_back(cacheFile);
+		totalSize += st.st_size;
+	}
+
+	if (totalSize <= d->maxSize)
+		return 0;
+
+	// Remove the least-recently used files first.
+	std::stable_sort(cacheFiles.begin(), cacheFiles.end());
+	int removed = 0;
+	for (vector<CacheFile>::const_iterator iter = cacheFiles.begin();
+	     iter != cacheFiles.end() && totalSize > d->maxSize; ++iter)
+	{
+		if (remove(iter->filename->c_str()) == 0) {
+			totalSize -= iter->size;
+			removed++;
+		}
+	}
+	return removed;
+}
+
+/**
+ * List the regular files in a directory.
+ * Subdirectories are not included in the file list.
+ * @param dir		[in]  Directory.
+ * @param files		[out] Full pathnames of the files, sorted by name.
+ * @param subdirs	[out, opt] Full pathnames of the subdirectories, sorted by name.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomCache::listFiles(const char *dir, vector<string> *files, vector<string> *subdirs)
+{
+	if (!dir || dir[0] == 0 || !files)
+		return -EINVAL;
+
+	string path(dir);
+	if (path[path.size()-1] != DIR_SEP_CHR) {
+		path += DIR_SEP_CHR;
+	}
+
+	files->clear();
+	if (subdirs) {
+		subdirs->clear();
+	}
+#ifdef _WIN32
+	// TODO: Unicode filenames.
+	struct _finddata_t fd;
+	intptr_t h = _findfirst((path + "*").c_str(), &fd);
+	if (h == -1)
+		return -errno;
+	do {
+		if (!(fd.attrib & _A_SUBDIR)) {
+			files->push_back(path + fd.name);
+		} else if (subdirs && fd.name[0] != '.') {
+			subdirs->push_back(path + fd.name);
+		}
+	} while (_findnext(h, &fd) == 0);
+	_findclose(h);
+#else /* !_WIN32 */
+	DIR *pDir = opendir(dir);
+	if (!pDir)
+		return -errno;
+	struct dirent *dirent;
+	while ((dirent = readdir(pDir)) != nullptr) {
+		if (dirent->d_name[0] == '.')
+			continue;
+		string filename = path + dirent->d_name;
+		struct stat st;
+		if (stat(filename.c_str(), &st) != 0)
+			continue;
+		if (S_ISREG(st.st_mode)) {
+			files->push_back(filename);
+		} else if (subdirs && S_ISDIR(st.st_mode)) {
+			subdirs->push_back(filename);
+		}
+	}
+	closedir(pDir);
+#endif /* _WIN32 */
+
+	std::sort(files->begin(), files->end());
+	if (subdirs) {
+		std::sort(subdirs->begin(), subdirs->end());
+	}
+	return 0;
+}
+
+}
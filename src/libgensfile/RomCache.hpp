@@ -0,0 +1,195 @@
+/***************************************************************************
+ * libgensfile: Gens file handling library.                                *
+ * RomCache.hpp: On-disk cache of decompressed ROM images.                 *
+ *                                                                         *
+ * Copyright (c) 2008-2016 by David Korth.                                 *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+/**
+ * ROM cache. Decompressed (and deinterleaved) ROM images are
+ * stored in a cache directory, so reopening an archive doesn't
+ * require decompressing it again.
+ *
+ * Cache files are named using a hash of the cache key, which
+ * consists of the archive filename, its modification time,
+ * and the filename and size of the selected file within
+ * the archive. The ROM image's CRC32 is stored in the cache
+ * file and verified when the ROM image is loaded.
+ *
+ * The cache is limited to a maximum size. When it's exceeded,
+ * the least-recently used ROM images are removed.
+ */
+
+#ifndef __LIBGENSFILE_ROMCACHE_HPP__
+#define __LIBGENSFILE_ROMCACHE_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <string>
+#include <vector>
+
+namespace LibGensFile {
+
+class RomCachePrivate;
+class RomCache
+{
+	public:
+		/**
+		 * Create a ROM cache.
+		 * @param cacheDir Cache directory. (Must already exist.)
+		 * @param maxSize Maximum cache size, in bytes.
+		 */
+		RomCache(const char *cacheDir, int64_t maxSize = DEFAULT_MAX_SIZE);
+		~RomCache();
+
+	protected:
+		friend class RomCachePrivate;
+		RomCachePrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		RomCache(const RomCache &);
+		RomCache &operator=(const RomCache &);
+
+	public:
+		// Default maximum cache size. (512 MB)
+		static const int64_t DEFAULT_MAX_SIZE = (512LL * 1024 * 1024);
+
+		/**
+		 * Get the cache directory.
+		 * @return Cache directory.
+		 */
+		std::string cacheDir(void) const;
+
+		/**
+		 * Get the maximum cache size.
+		 * @return Maximum cache size, in bytes.
+		 */
+		int64_t maxSize(void) const;
+
+		/**
+		 * Set the maximum cache size.
+		 * If the cache is larger than the new size,
+		 * it will be trimmed on the next store().
+		 * @param maxSize Maximum cache size, in bytes.
+		 */
+		void setMaxSize(int64_t maxSize);
+
+		/**
+		 * Create a cache key for a file in an archive.
+		 * @param filename Archive filename.
+		 * @param z_filename Filename of the file within the archive. (May be nullptr.)
+		 * @param z_filesize Size of the file within the archive.
+		 * @return Cache key, or empty string if the archive couldn't be found.
+		 */
+		static std::string makeKey(const char *filename, const char *z_filename, int64_t z_filesize);
+
+		/**
+		 * Cached ROM image.
+		 */
+		struct Entry {
+			std::vector<uint8_t> data;	// ROM image.
+			uint32_t crc32;			// CRC32 of the ROM image.
+			int romFormat;			// ROM format. (Rom::RomFormat)
+			int sysId;			// System ID. (Rom::MDP_SYSTEM_ID)
+		};
+
+		/**
+		 * Look up a ROM image in the cache.
+		 * The ROM image is marked as recently used.
+		 * @param key	[in]  Cache key.
+		 * @param entry	[out] Cached ROM image.
+		 * @return 0 on success; negative POSIX error code on error. (-ENOENT if not cached)
+		 */
+		int lookup(const std::string &key, Entry *entry);
+
+		/**
+		 * Store a ROM image in the cache.
+		 * Least-recently used ROM images will be removed
+		 * if the cache exceeds the maximum size.
+		 * @param key		[in] Cache key.
+		 * @param data		[in] ROM image.
+		 * @param size		[in] Size of the ROM image.
+		 * @param crc32		[in] CRC32 of the ROM image.
+		 * @param romFormat	[in] ROM format. (Rom::RomFormat)
+		 * @param sysId		[in] System ID. (Rom::MDP_SYSTEM_ID)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int store(const std::string &key, const uint8_t *data, size_t size,
+			  uint32_t crc32, int romFormat, int sysId);
+
+		/**
+		 * Store a mappable image in the cache.
+		 * The image is stored as-is, so it can be mapped into
+		 * memory with mapImage() without any further processing.
+		 * Least-recently used ROM images will be removed
+		 * if the cache exceeds the maximum size.
+		 * @param key	[in] Cache key.
+		 * @param data	[in] Image.
+		 * @param size	[in] Size of the image.
+		 * @param crc32	[in] CRC32 of the original ROM image.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int storeImage(const std::string &key, const uint8_t *data, size_t size, uint32_t crc32);
+
+		/**
+		 * Map an image from the cache into memory. (copy-on-write)
+		 * Pages are shared with every other process that has the
+		 * same image mapped until they're written to.
+		 * The image is marked as recently used.
+		 * NOTE: Cache files are never modified in place, so removing
+		 * or replacing the image while it's mapped is safe.
+		 * @param key		[in]  Cache key.
+		 * @param siz		[in]  Size of the mapping. (The rest is zero-filled.)
+		 * @param pData		[out] Mapped image. Free it with unmapImage().
+		 * @param pSize		[out] Size of the image.
+		 * @param pCrc32	[out] CRC32 of the original ROM image.
+		 * @return 0 on success; negative POSIX error code on error. (-ENOENT if not cached)
+		 */
+		int mapImage(const std::string &key, size_t siz, void **pData, size_t *pSize, uint32_t *pCrc32);
+
+		/**
+		 * Free an image mapped with mapImage().
+		 * @param ptr Mapped image.
+		 * @param siz Size of the mapping.
+		 */
+		static void unmapImage(void *ptr, size_t siz);
+
+		/**
+		 * Remove least-recently used ROM images until
+		 * the cache is no larger than the maximum size.
+		 * @return Number of ROM images removed, or negative POSIX error code on error.
+		 */
+		int trim(void);
+
+		/**
+		 * List the regular files in a directory.
+		 * Subdirectories are not included in the file list.
+		 * @param dir		[in]  Directory.
+		 * @param files		[out] Full pathnames of the files, sorted by name.
+		 * @param subdirs	[out, opt] Full pathnames of the subdirectories, sorted by name.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int listFiles(const char *dir, std::vector<std::string> *files,
+				     std::vector<std::string> *subdirs = nullptr);
+};
+
+}
+
+#endif /* __LIBGENSFILE_ROMCACHE_HPP__ */
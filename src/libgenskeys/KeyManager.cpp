@@ -73,13 +73,89 @@ class KeyManagerPrivate
 
 		/**
 		 * Keyboard state.
-		 * - Index: GensKeyVal_t
-		 * - Value: True if pressed; false if not.
+		 * - Bit index: GensKeyVal_t (key16 & 0x1FF)
+		 * - Value: 1 if pressed; 0 if not.
 		 */
-		bool kbdState[KEYV_MAX];
+		static const int KEY_COUNT = 0x200;
+		uint64_t kbdBits[KEY_COUNT / 64];
 
-		// TODO: Improve performance by adding a GensKey_t to Device lookup?
-		// (may be needed when joysticks are added)
+		/**
+		 * Get the keyboard state index for a keycode.
+		 * @param keycode	[in] Key code.
+		 * @param pIdx		[out] Keyboard state index.
+		 * @return True if the keycode is a keyboard key; false if not.
+		 */
+		static inline bool keyIndex(GensKey_t keycode, unsigned int *pIdx);
+
+		/**
+		 * Set a key's state.
+		 * Button states of all ports the key is bound to
+		 * are updated if the key's state changes.
+		 * @param idx Keyboard state index.
+		 * @param pressed True if pressed; false if not.
+		 */
+		void setKeyState(unsigned int idx, bool pressed);
+
+		/**
+		 * Key bindings for ports with devices, sorted by key.
+		 * Bindings for key idx are in
+		 * bindings[bindStart[idx]] to bindings[bindStart[idx+1]-1].
+		 */
+		struct KeyBinding {
+			uint8_t virtPort;
+			uint32_t mask;		// Button bit.
+		};
+		KeyBinding bindings[IoManager::VIRTPORT_MAX * IoManager::BTNI_MAX];
+		uint16_t bindStart[KEY_COUNT + 1];
+
+		/**
+		 * Pressed buttons. (active high)
+		 * Updated by setKeyState() when a bound key changes state.
+		 * - Index: Virtual Port.
+		 * - Value: Pressed buttons.
+		 */
+		uint32_t portPressed[IoManager::VIRTPORT_MAX];
+
+		// Virtual ports that have devices.
+		uint8_t activePorts[IoManager::VIRTPORT_MAX];
+		int activePortCount;
+
+		/**
+		 * Rebuild the key bindings and button states.
+		 * Must be called after changing keyMap[] or ioTypes[].
+		 */
+		void rebuildBindings(void);
+
+		/**
+		 * I/O Manager whose device types match ioTypes[].
+		 * nullptr if the device types were changed since
+		 * the last call to updateIoManager().
+		 *
+		 * The pointer alone isn't enough: a new IoManager
+		 * may be allocated at the same address, and the
+		 * device types may be changed by someone else,
+		 * e.g. InputMovie. The generation catches both.
+		 */
+		const IoManager *syncedIoManager;
+		unsigned int syncedGeneration;
+
+		/**
+		 * Button states last pushed by pushInputEvents().
+		 * - Index: Virtual Port.
+		 * - Value: Button state.
+		 */
+		uint32_t pushedButtons[IoManager::VIRTPORT_MAX];
+
+		/**
+		 * Get the button state for a virtual port.
+		 * @param virtPort Virtual port.
+		 * @return Button state. (active low)
+		 */
+		inline uint32_t buttons(int virtPort) const
+		{
+			// Buttons are typically active-low.
+			return ~portPressed[virtPort];
+		}
 
 		// Default keymap.
 		static const IoManager::IoType_t def_ioTypes[IoManager::VIRTPORT_MAX];
@@ -194,7 +270,123 @@ KeyManagerPrivate::KeyManagerPrivate(KeyManager *q)
 	memcpy(ioTypes, def_ioTypes, sizeof(ioTypes));
 
 	// Initialize keyboard state.
-	memset(kbdState, 0, sizeof(kbdState));
+	memset(kbdBits, 0, sizeof(kbdBits));
+	rebuildBindings();
+
+	// Nothing has been pushed yet.
+	// Buttons are active low, so all released is ~0.
+	for (int i = 0; i < ARRAY_SIZE(pushedButtons); i++) {
+		pushedButtons[i] = ~0U;
+	}
+}
+
+/**
+ * Get the keyboard state index for a keycode.
+ * @param keycode	[in] Key code.
+ * @param pIdx		[out] Keyboard state index.
+ * @return True if the keycode is a keyboard key; false if not.
+ */
+inline bool KeyManagerPrivate::keyIndex(GensKey_t keycode, unsigned int *pIdx)
+{
+	GensKey_u keyu;
+	keyu.keycode = keycode;
+	if (keyu.type != GKT_KEYBOARD)
+		return false;
+	if (keyu.dev_id != 0)
+		return false;
+
+	*pIdx = (keyu.key16 & (KEY_COUNT - 1));
+	return true;
+}
+
+/**
+ * Set a key's state.
+ * Button states of all ports the key is bound to
+ * are updated if the key's state changes.
+ * @param idx Keyboard state index.
+ * @param pressed True if pressed; false if not.
+ */
+void KeyManagerPrivate::setKeyState(unsigned int idx, bool pressed)
+{
+	uint64_t *const word = &kbdBits[idx / 64];
+	const uint64_t bit = (1ULL << (idx % 64));
+	if (!!(*word & bit) == pressed) {
+		// Key state didn't change.
+		return;
+	}
+	*word ^= bit;
+
+	// Each button is bound to exactly one key,
+	// so the button's state is the key's state.
+	const KeyBinding *binding = &bindings[bindStart[idx]];
+	const KeyBinding *const end = &bindings[bindStart[idx + 1]];
+	if (pressed) {
+		for (; binding != end; binding++) {
+			portPressed[binding->virtPort] |= binding->mask;
+		}
+	} else {
+		for (; binding != end; binding++) {
+			portPressed[binding->virtPort] &= ~binding->mask;
+		}
+	}
+}
+
+/**
+ * Rebuild the key bindings and button states.
+ * Must be called after changing keyMap[] or ioTypes[].
+ */
+void KeyManagerPrivate::rebuildBindings(void)
+{
+	// Count the bindings for each key.
+	// bindStart[idx+1] is used as the counter for key idx.
+	memset(bindStart, 0, sizeof(bindStart));
+	memset(portPressed, 0, sizeof(portPressed));
+	activePortCount = 0;
+	for (int virtPort = 0; virtPort < IoManager::VIRTPORT_MAX; virtPort++) {
+		const IoManager::IoType_t ioType = ioTypes[virtPort];
+		if (ioType == IoManager::IOT_NONE)
+			continue;
+		activePorts[activePortCount++] = (uint8_t)virtPort;
+
+		const int numButtons = IoManager::NumDevButtons(ioType);
+		for (int btn = 0; btn < numButtons; btn++) {
+			unsigned int idx;
+			if (keyIndex(keyMap[virtPort][btn], &idx)) {
+				bindStart[idx + 1]++;
+			}
+		}
+	}
+
+	// Convert the counts to start indexes.
+	for (int idx = 0; idx < KEY_COUNT; idx++) {
+		bindStart[idx + 1] += bindStart[idx];
+	}
+
+	// Fill in the bindings.
+	uint16_t next[KEY_COUNT];
+	memcpy(next, bindStart, sizeof(next));
+	for (int i = 0; i < activePortCount; i++) {
+		const int virtPort = activePorts[i];
+		const int numButtons = IoManager::NumDevButtons(ioTypes[virtPort]);
+		for (int btn = 0; btn < numButtons; btn++) {
+			unsigned int idx;
+			if (!keyIndex(keyMap[virtPort][btn], &idx))
+				continue;
+
+			KeyBinding *const binding = &bindings[next[idx]++];
+			binding->virtPort = (uint8_t)virtPort;
+			binding->mask = (1U << btn);
+
+			// Keys may already be pressed.
+			if (kbdBits[idx / 64] & (1ULL << (idx % 64))) {
+				portPressed[virtPort] |= binding->mask;
+			}
+		}
+	}
+
+	// Device types have to be resynchronized.
+	syncedIoManager = nullptr;
+	syncedGeneration = 0;
 }
 
 /** KeyManager **/
@@ -216,10 +408,19 @@ void KeyManager::copyFrom(const KeyManager &keyManager)
 {
 	memcpy(d->keyMap, keyManager.d->keyMap, sizeof(d->keyMap));
 	memcpy(d->ioTypes, keyManager.d->ioTypes, sizeof(d->ioTypes));
+	d->rebuildBindings();
 }
 
 /**
  * Update the I/O Manager with the current key states.
+ * If the I/O Manager has an input queue, only the
+ * device types are updated; button states are pushed
+ * by pushInputEvents() instead.
+ *
+ * Device types are only updated if they were changed
+ * since the last call, or if ioManager is different or
+ * its device configuration generation has changed.
+ *
  * @param ioManager I/O Manager to update.
  */
 void KeyManager::updateIoManager(IoManager *ioManager)
@@ -232,37 +433,69 @@ void KeyManager::updateIoManager(IoManager *ioManager)
 	// - Beginning of frame.
 	// - Before VBlank.
 	// - End of frame.
-	d->kbdState[KEYV_LSHIFT] = (!!(GetAsyncKeyState(VK_LSHIFT) & 0x8000));
-	d->kbdState[KEYV_RSHIFT] = (!!(GetAsyncKeyState(VK_RSHIFT) & 0x8000));
-	d->kbdState[KEYV_LCTRL]	= (!!(GetAsyncKeyState(VK_LCONTROL) & 0x8000));
-	d->kbdState[KEYV_RCTRL]	= (!!(GetAsyncKeyState(VK_RCONTROL) & 0x8000));
-	d->kbdState[KEYV_LALT]	= (!!(GetAsyncKeyState(VK_LMENU) & 0x8000));
-	d->kbdState[KEYV_RALT]	= (!!(GetAsyncKeyState(VK_RMENU) & 0x8000));
+	d->setKeyState(KEYV_LSHIFT, !!(GetAsyncKeyState(VK_LSHIFT) & 0x8000));
+	d->setKeyState(KEYV_RSHIFT, !!(GetAsyncKeyState(VK_RSHIFT) & 0x8000));
+	d->setKeyState(KEYV_LCTRL,  !!(GetAsyncKeyState(VK_LCONTROL) & 0x8000));
+	d->setKeyState(KEYV_RCTRL,  !!(GetAsyncKeyState(VK_RCONTROL) & 0x8000));
+	d->setKeyState(KEYV_LALT,   !!(GetAsyncKeyState(VK_LMENU) & 0x8000));
+	d->setKeyState(KEYV_RALT,   !!(GetAsyncKeyState(VK_RMENU) & 0x8000));
 #endif
 
-	// Scan the keymap and determine buttons.
-	for (int virtPort = 0; virtPort < IoManager::VIRTPORT_MAX; virtPort++) {
-		IoManager::IoType_t ioType = ioManager->devType((IoManager::VirtPort_t)virtPort);
-		if (d->ioTypes[virtPort] != ioType) {
-			// Update the device type.
-			ioManager->setDevType(
-				(IoManager::VirtPort_t)virtPort, 
-				d->ioTypes[virtPort]);
-			ioType = d->ioTypes[virtPort];
+	if (d->syncedIoManager != ioManager ||
+	    d->syncedGeneration != ioManager->generation())
+	{
+		// Update the device types.
+		for (int virtPort = 0; virtPort < IoManager::VIRTPORT_MAX; virtPort++) {
+			const IoManager::IoType_t ioType = d->ioTypes[virtPort];
+			if (ioManager->devType((IoManager::VirtPort_t)virtPort) != ioType) {
+				ioManager->setDevType((IoManager::VirtPort_t)virtPort, ioType);
+			}
 		}
+		d->syncedIoManager = ioManager;
+		d->syncedGeneration = ioManager->generation();
+	}
 
-		const int numButtons = ioManager->NumDevButtons(ioType);
-		uint32_t buttons = 0;
-		const GensKey_t *port_keyMap = &d->keyMap[virtPort][numButtons - 1];
-		for (int btn = numButtons - 1; btn >= 0; btn--) {
-			buttons <<= 1;
-			buttons |= (uint32_t)isKeyPressed(*port_keyMap--);
-		}
+	if (ioManager->inputQueue()) {
+		// Button states are pushed by pushInputEvents()
+		// and applied when the game reads the port.
+		return;
+	}
 
-		// Buttons are typically active-low.
-		buttons = ~buttons;
+	// Ports without devices ignore update(),
+	// so only ports with devices are updated.
+	for (int i = 0; i < d->activePortCount; i++) {
+		const int virtPort = d->activePorts[i];
+		ioManager->update(virtPort, d->buttons(virtPort));
+	}
+}
 
-		ioManager->update(virtPort, buttons);
+/**
+ * Push the current key states to an I/O Manager input queue.
+ * Only virtual ports whose button state changed since the
+ * last call are pushed, unless force is set.
+ *
+ * This should be called by the frontend after each batch
+ * of keyDown() / keyUp() events. It's safe to call from a
+ * different thread than the one running the emulation.
+ *
+ * @param queue Input event queue.
+ * @param timestamp Event timestamp, e.g. Timing::getTime().
+ * @param force If true, push all ports, even if they didn't change.
+ */
+void KeyManager::pushInputEvents(IoManager::InputQueue *queue, uint64_t timestamp, bool force)
+{
+	for (int i = 0; i < d->activePortCount; i++) {
+		const int virtPort = d->activePorts[i];
+		const uint32_t buttons = d->buttons(virtPort);
+		if (!force && buttons == d->pushedButtons[virtPort])
+			continue;
+
+		IoManager::InputEvent event;
+		event.virtPort = virtPort;
+		event.buttons = buttons;
+		event.timestamp = timestamp;
+		queue->push(event);
+		d->pushedButtons[virtPort] = buttons;
 	}
 }
 
@@ -305,6 +538,7 @@ int KeyManager::setKeyMap(IoManager::VirtPort_t virtPort, const GensKey_t *keyMa
 		dest_keyMap[i] = keyMap[i];
 	}
 
+	d->rebuildBindings();
 	return btns;
 }
 
@@ -320,6 +554,7 @@ int KeyManager::resetKeyMap(IoManager::VirtPort_t virtPort)
 
 	d->ioTypes[virtPort] = d->def_ioTypes[virtPort];
 	memcpy(d->keyMap[virtPort], d->def_keyMap[virtPort], sizeof(d->keyMap[virtPort]));
+	d->rebuildBindings();
 	return 0;
 }
 
@@ -343,7 +578,10 @@ void KeyManager::setIoType(IoManager::VirtPort_t virtPort, IoManager::IoType_t i
 {
 	assert(virtPort >= IoManager::VIRTPORT_1 && virtPort < IoManager::VIRTPORT_MAX);
 	assert(ioType >= IoManager::IOT_NONE && ioType < IoManager::IOT_MAX);
-	d->ioTypes[virtPort] = ioType;
+	if (d->ioTypes[virtPort] != ioType) {
+		d->ioTypes[virtPort] = ioType;
+		d->rebuildBindings();
+	}
 }
 
 /**
@@ -353,14 +591,11 @@ void KeyManager::setIoType(IoManager::VirtPort_t virtPort, IoManager::IoType_t i
  */
 bool KeyManager::isKeyPressed(GensKey_t keycode) const
 {
-	GensKey_u keyu;
-	keyu.keycode = keycode;
-	if (keyu.type != GKT_KEYBOARD)
-		return false;
-	if (keyu.dev_id != 0)
+	unsigned int idx;
+	if (!d->keyIndex(keycode, &idx))
 		return false;
 
-	return d->kbdState[keyu.key16 & 0x1FF];
+	return !!(d->kbdBits[idx / 64] & (1ULL << (idx % 64)));
 }
 
 /** Keyboard **/
@@ -371,14 +606,11 @@ bool KeyManager::isKeyPressed(GensKey_t keycode) const
  */
 void KeyManager::keyDown(GensKey_t keycode)
 {
-	GensKey_u keyu;
-	keyu.keycode = keycode;
-	if (keyu.type != GKT_KEYBOARD)
-		return;
-	if (keyu.dev_id != 0)
+	unsigned int idx;
+	if (!d->keyIndex(keycode, &idx))
 		return;
 
-	d->kbdState[keyu.key16 & 0x1FF] = true;
+	d->setKeyState(idx, true);
 }
 
 /**
@@ -387,14 +619,11 @@ void KeyManager::keyDown(GensKey_t keycode)
  */
 void KeyManager::keyUp(GensKey_t keycode)
 {
-	GensKey_u keyu;
-	keyu.keycode = keycode;
-	if (keyu.type != GKT_KEYBOARD)
-		return;
-	if (keyu.dev_id != 0)
+	unsigned int idx;
+	if (!d->keyIndex(keycode, &idx))
 		return;
 
-	d->kbdState[keyu.key16 & 0x1FF] = false;
+	d->setKeyState(idx, false);
 }
 
 }
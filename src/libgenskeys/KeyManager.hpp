@@ -4,7 +4,7 @@
  *                                                                         *
  * Copyright (c) 1999-2002 by Stéphane Dallongeville.                      *
  * Copyright (c) 2003-2004 by Stéphane Akhoun.                             *
- * Copyright (c) 2008-2014 by David Korth.                                 *
+ * Copyright (c) 2008-2015 by David Korth.                                 *
  *                                                                         *
  * This program is free software; you can redistribute it and/or modify it *
  * under the terms of the GNU General Public License as published by the   *
@@ -57,10 +57,33 @@ class KeyManager
 	public:
 		/**
 		 * Update the I/O Manager with the current key states.
+		 * If the I/O Manager has an input queue, only the
+		 * device types are updated; button states are pushed
+		 * by pushInputEvents() instead.
+		 *
+		 * Device types are only updated if they were changed
+		 * since the last call, or if ioManager is different.
+		 *
 		 * @param ioManager I/O Manager to update.
 		 */
 		void updateIoManager(LibGens::IoManager *ioManager);
 
+		/**
+		 * Push the current key states to an I/O Manager input queue.
+		 * Only virtual ports whose button state changed since the
+		 * last call are pushed, unless force is set.
+		 *
+		 * This should be called by the frontend after each batch
+		 * of keyDown() / keyUp() events. It's safe to call from a
+		 * different thread than the one running the emulation.
+		 *
+		 * @param queue Input event queue.
+		 * @param timestamp Event timestamp, e.g. Timing::getTime().
+		 * @param force If true, push all ports, even if they didn't change.
+		 */
+		void pushInputEvents(LibGens::IoManager::InputQueue *queue,
+				     uint64_t timestamp, bool force = false);
+
 		/**
 		 * Get the keymap for the specified Virtual Port.
 		 * @param virtPort I/O Manager Virtual Port.
@@ -0,0 +1,295 @@
+/***************************************************************************
+ * libgenskeys/tests: Gens Key Handling Library. (Test Suite)              *
+ * KeyManagerTest.cpp: KeyManager tests.                                   *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGensKeys
+#include "KeyManager.hpp"
+using LibGens::IoManager;
+
+// LibGens
+#include "libgens/lg_main.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+// C++ includes.
+#include <new>
+
+namespace LibGensKeys { namespace Tests {
+
+class KeyManagerTest : public ::testing::Test
+{
+	protected:
+		KeyManagerTest()
+			: m_keyManager(nullptr) { }
+		virtual ~KeyManagerTest() { }
+
+		virtual void SetUp(void) override
+		{
+			// Default keymap: 6-button on port 1,
+			// 3-button on port 2.
+			m_keyManager = new KeyManager();
+		}
+
+		virtual void TearDown(void) override
+		{
+			delete m_keyManager;
+			m_keyManager = nullptr;
+		}
+
+		/**
+		 * Pop the next input event.
+		 * @param virtPort	[out] Virtual port.
+		 * @param buttons	[out] Button state. (active low)
+		 * @return True if an event was popped; false if the queue is empty.
+		 */
+		bool pop(int *virtPort, uint32_t *buttons)
+		{
+			IoManager::InputEvent event;
+			if (!m_queue.pop(&event))
+				return false;
+			*virtPort = event.virtPort;
+			*buttons = event.buttons;
+			return true;
+		}
+
+	protected:
+		KeyManager *m_keyManager;
+		IoManager::InputQueue m_queue;
+
+		// Button bits. (BTNI_*)
+		static const uint32_t BTN_UP = 0x01;
+		static const uint32_t BTN_B = 0x10;
+};
+
+/**
+ * Only ports with devices should be pushed,
+ * and only if their buttons changed.
+ */
+TEST_F(KeyManagerTest, pushChangedPorts)
+{
+	int virtPort;
+	uint32_t buttons;
+
+	m_keyManager->pushInputEvents(&m_queue, 0, true);
+	ASSERT_TRUE(pop(&virtPort, &buttons));
+	EXPECT_EQ(IoManager::VIRTPORT_1, virtPort);
+	EXPECT_EQ(~0U, buttons);
+	ASSERT_TRUE(pop(&virtPort, &buttons));
+	EXPECT_EQ(IoManager::VIRTPORT_2, virtPort);
+	EXPECT_EQ(~0U, buttons);
+	EXPECT_FALSE(pop(&virtPort, &buttons));
+
+	// Port 1: Up
+	m_keyManager->keyDown(KEYV_UP);
+	EXPECT_TRUE(m_keyManager->isKeyPressed(KEYV_UP));
+	m_keyManager->pushInputEvents(&m_queue, 1);
+	ASSERT_TRUE(pop(&virtPort, &buttons));
+	EXPECT_EQ(IoManager::VIRTPORT_1, virtPort);
+	EXPECT_EQ(~BTN_UP, buttons);
+	EXPECT_FALSE(pop(&virtPort, &buttons));
+
+	// Unmapped keys don't change any ports.
+	m_keyManager->keyDown(KEYV_F1);
+	EXPECT_TRUE(m_keyManager->isKeyPressed(KEYV_F1));
+	m_keyManager->pushInputEvents(&m_queue, 2);
+	EXPECT_FALSE(pop(&virtPort, &buttons));
+
+	m_keyManager->keyUp(KEYV_UP);
+	EXPECT_FALSE(m_keyManager->isKeyPressed(KEYV_UP));
+	m_keyManager->pushInputEvents(&m_queue, 3);
+	ASSERT_TRUE(pop(&virtPort, &buttons));
+	EXPECT_EQ(IoManager::VIRTPORT_1, virtPort);
+	EXPECT_EQ(~0U, buttons);
+}
+
+/**
+ * Changing the keymap should rebind keys,
+ * including keys that are already pressed.
+ */
+TEST_F(KeyManagerTest, setKeyMap)
+{
+	int virtPort;
+	uint32_t buttons;
+
+	m_keyManager->keyDown(KEYV_x);
+	m_keyManager->pushInputEvents(&m_queue, 0, true);
+	while (pop(&virtPort, &buttons)) { }
+
+	// Port 2: Up => x
+	GensKey_t keyMap[IoManager::BTNI_MAX];
+	ASSERT_EQ(IoManager::BTNI_MAX, m_keyManager->keyMap(IoManager::VIRTPORT_2, keyMap, IoManager::BTNI_MAX));
+	keyMap[0] = KEYV_x;
+	ASSERT_EQ(IoManager::BTNI_MAX, m_keyManager->setKeyMap(IoManager::VIRTPORT_2, keyMap, IoManager::BTNI_MAX));
+	m_keyManager->pushInputEvents(&m_queue, 1);
+	ASSERT_TRUE(pop(&virtPort, &buttons));
+	EXPECT_EQ(IoManager::VIRTPORT_2, virtPort);
+	EXPECT_EQ(~BTN_UP, buttons);
+
+	// The old key is no longer bound.
+	m_keyManager->keyDown(KEYV_i);
+	m_keyManager->pushInputEvents(&m_queue, 2);
+	EXPECT_FALSE(pop(&virtPort, &buttons));
+
+	// Back to the default keymap.
+	// Up is still pressed, since i is held.
+	ASSERT_EQ(0, m_keyManager->resetKeyMap(IoManager::VIRTPORT_2));
+	m_keyManager->keyUp(KEYV_x);
+	m_keyManager->pushInputEvents(&m_queue, 3);
+	EXPECT_FALSE(pop(&virtPort, &buttons));
+
+	m_keyManager->keyUp(KEYV_i);
+	m_keyManager->pushInputEvents(&m_queue, 4);
+	ASSERT_TRUE(pop(&virtPort, &buttons));
+	EXPECT_EQ(IoManager::VIRTPORT_2, virtPort);
+	EXPECT_EQ(~0U, buttons);
+}
+
+/**
+ * Ports without devices should not be pushed.
+ */
+TEST_F(KeyManagerTest, setIoType)
+{
+	int virtPort;
+	uint32_t buttons;
+
+	m_keyManager->setIoType(IoManager::VIRTPORT_2, IoManager::IOT_NONE);
+	m_keyManager->keyDown(KEYV_i);
+	m_keyManager->pushInputEvents(&m_queue, 0, true);
+	ASSERT_TRUE(pop(&virtPort, &buttons));
+	EXPECT_EQ(IoManager::VIRTPORT_1, virtPort);
+	EXPECT_FALSE(pop(&virtPort, &buttons));
+
+	// Re-enabling the port picks up the pressed key.
+	m_keyManager->setIoType(IoManager::VIRTPORT_2, IoManager::IOT_3BTN);
+	m_keyManager->pushInputEvents(&m_queue, 1);
+	ASSERT_TRUE(pop(&virtPort, &buttons));
+	EXPECT_EQ(IoManager::VIRTPORT_2, virtPort);
+	EXPECT_EQ(~BTN_UP, buttons);
+}
+
+/**
+ * Non-keyboard keycodes are never pressed.
+ */
+TEST_F(KeyManagerTest, nonKeyboard)
+{
+	GensKey_u keyu;
+	keyu.keycode = KEYV_UP;
+	keyu.dev_id = 1;
+	m_keyManager->keyDown(keyu.keycode);
+	EXPECT_FALSE(m_keyManager->isKeyPressed(keyu.keycode));
+	EXPECT_FALSE(m_keyManager->isKeyPressed(KEYV_UP));
+
+	keyu.keycode = KEYV_UP;
+	keyu.type = GKT_JOYSTICK;
+	m_keyManager->keyDown(keyu.keycode);
+	EXPECT_FALSE(m_keyManager->isKeyPressed(keyu.keycode));
+	EXPECT_FALSE(m_keyManager->isKeyPressed(KEYV_UP));
+}
+
+/**
+ * updateIoManager() should set the device types
+ * and button states.
+ */
+TEST_F(KeyManagerTest, updateIoManager)
+{
+	IoManager ioManager;
+	m_keyManager->updateIoManager(&ioManager);
+	EXPECT_EQ(IoManager::IOT_6BTN, ioManager.devType(IoManager::VIRTPORT_1));
+	EXPECT_EQ(IoManager::IOT_3BTN, ioManager.devType(IoManager::VIRTPORT_2));
+
+	// TH=1 so reads return ?1CBRLDU.
+	ioManager.writeCtrlMD(IoManager::PHYSPORT_1, 0x40);
+	ioManager.writeDataMD(IoManager::PHYSPORT_1, 0x40);
+	EXPECT_EQ(0x3F, ioManager.readDataMD(IoManager::PHYSPORT_1) & 0x3F);
+
+	m_keyManager->keyDown(KEYV_s);
+	m_keyManager->updateIoManager(&ioManager);
+	EXPECT_EQ((uint8_t)(0x3F & ~BTN_B), ioManager.readDataMD(IoManager::PHYSPORT_1) & 0x3F);
+
+	// Device type changes are applied on the next update.
+	m_keyManager->setIoType(IoManager::VIRTPORT_1, IoManager::IOT_3BTN);
+	m_keyManager->updateIoManager(&ioManager);
+	EXPECT_EQ(IoManager::IOT_3BTN, ioManager.devType(IoManager::VIRTPORT_1));
+	EXPECT_EQ((uint8_t)(0x3F & ~BTN_B), ioManager.readDataMD(IoManager::PHYSPORT_1) & 0x3F);
+
+	// A different I/O Manager gets all device types.
+	IoManager ioManager2;
+	m_keyManager->updateIoManager(&ioManager2);
+	EXPECT_EQ(IoManager::IOT_3BTN, ioManager2.devType(IoManager::VIRTPORT_1));
+	EXPECT_EQ(IoManager::IOT_3BTN, ioManager2.devType(IoManager::VIRTPORT_2));
+}
+
+/**
+ * updateIoManager() should set the device types on a new
+ * IoManager, even if it's allocated at the same address
+ * as a deleted one, and if the device types were changed
+ * without going through the KeyManager.
+ */
+TEST_F(KeyManagerTest, updateIoManagerRecreated)
+{
+	IoManager *ioManager = new IoManager();
+	m_keyManager->updateIoManager(ioManager);
+	EXPECT_EQ(IoManager::IOT_6BTN, ioManager->devType(IoManager::VIRTPORT_1));
+
+	// Recreate the IoManager, e.g. when loading another ROM.
+	// Placement new guarantees the same address.
+	ioManager->~IoManager();
+	ioManager = new(ioManager) IoManager();
+	EXPECT_EQ(IoManager::IOT_NONE, ioManager->devType(IoManager::VIRTPORT_1));
+	m_keyManager->updateIoManager(ioManager);
+	EXPECT_EQ(IoManager::IOT_6BTN, ioManager->devType(IoManager::VIRTPORT_1));
+	EXPECT_EQ(IoManager::IOT_3BTN, ioManager->devType(IoManager::VIRTPORT_2));
+
+	// Same with delete and new.
+	delete ioManager;
+	ioManager = new IoManager();
+	m_keyManager->updateIoManager(ioManager);
+	EXPECT_EQ(IoManager::IOT_6BTN, ioManager->devType(IoManager::VIRTPORT_1));
+
+	// Device types changed elsewhere, e.g. by InputMovie,
+	// are restored on the next update.
+	ioManager->setDevType(IoManager::VIRTPORT_1, IoManager::IOT_3BTN);
+	m_keyManager->updateIoManager(ioManager);
+	EXPECT_EQ(IoManager::IOT_6BTN, ioManager->devType(IoManager::VIRTPORT_1));
+
+	delete ioManager;
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGensKeys test suite: KeyManager tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,105 @@
+/***************************************************************************
+ * libgenskeys/tests: Gens Key Handling Library. (Test Suite)              *
+ * KeyManagerTest_benchmark.cpp: KeyManager benchmarks.                    *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGensKeys
+#include "KeyManager.hpp"
+using LibGens::IoManager;
+
+// LibGens
+#include "libgens/Util/Timing.hpp"
+using LibGens::Timing;
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+namespace LibGensKeys { namespace Tests {
+
+class KeyManagerTest_benchmark : public ::testing::Test
+{
+	protected:
+		KeyManagerTest_benchmark() { }
+		virtual ~KeyManagerTest_benchmark() { }
+
+		virtual void SetUp(void) override
+		{
+			// 6-button controllers on all Team Player ports.
+			for (int virtPort = IoManager::VIRTPORT_TP1A;
+			     virtPort <= IoManager::VIRTPORT_TP2D; virtPort++)
+			{
+				m_keyManager.setIoType((IoManager::VirtPort_t)virtPort, IoManager::IOT_6BTN);
+			}
+			m_keyManager.updateIoManager(&m_ioManager);
+		}
+
+		/**
+		 * Print the benchmark speed.
+		 * @param name Benchmark name.
+		 * @param iterations Number of iterations.
+		 * @param secs Elapsed time, in seconds.
+		 */
+		static void printSpeed(const char *name, int iterations, double secs)
+		{
+			printf("%s: %d iterations in %0.3f ms (%0.1f ns/iteration)\n",
+				name, iterations, secs * 1000.0,
+				(secs * 1000000000.0) / iterations);
+		}
+
+	protected:
+		KeyManager m_keyManager;
+		IoManager m_ioManager;
+
+		// Run benchmark loops 1,000,000 times.
+		static const int BENCHMARK_ITERATIONS = 1000000;
+};
+
+/**
+ * Benchmark updateIoManager() with no keys pressed.
+ */
+TEST_F(KeyManagerTest_benchmark, updateIoManager)
+{
+	Timing timing;
+	const double start = timing.getTimeD();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		m_keyManager.updateIoManager(&m_ioManager);
+	}
+	printSpeed("updateIoManager", BENCHMARK_ITERATIONS, timing.getTimeD() - start);
+}
+
+/**
+ * Benchmark a key press and release followed by updateIoManager().
+ */
+TEST_F(KeyManagerTest_benchmark, keyPressUpdate)
+{
+	Timing timing;
+	const double start = timing.getTimeD();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		m_keyManager.keyDown(KEYV_UP);
+		m_keyManager.updateIoManager(&m_ioManager);
+		m_keyManager.keyUp(KEYV_UP);
+		m_keyManager.updateIoManager(&m_ioManager);
+	}
+	printSpeed("keyPressUpdate", BENCHMARK_ITERATIONS, timing.getTimeD() - start);
+}
+
+} }
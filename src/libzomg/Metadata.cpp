@@ -149,6 +149,33 @@ Metadata::~Metadata()
 	delete d;
 }
 
+/**
+ * Copy the metadata.
+ * The creation time is copied as well, so a copy
+ * made for a deferred save keeps the original time.
+ * @param other Metadata to copy.
+ */
+Metadata::Metadata(const Metadata &other)
+	: d(new MetadataPrivate())
+{
+	*this = other;
+}
+
+Metadata &Metadata::operator=(const Metadata &other)
+{
+	if (this == &other)
+		return *this;
+
+	d->ctime = other.d->ctime;
+	d->systemId = other.d->systemId;
+	d->romFilename = other.d->romFilename;
+	d->romCrc32 = other.d->romCrc32;
+	d->region = other.d->region;
+	d->description = other.d->description;
+	d->extensions = other.d->extensions;
+	return *this;
+}
+
 /**
  * Clear the loaded ZOMG.ini data.
  */
@@ -53,16 +53,20 @@ class Metadata
 		Metadata();
 		~Metadata();
 
+		/**
+		 * Copy the metadata.
+		 * The creation time is copied as well, so a copy
+		 * made for a deferred save keeps the original time.
+		 * @param other Metadata to copy.
+		 */
+		Metadata(const Metadata &other);
+		Metadata &operator=(const Metadata &other);
+
 	private:
 		friend class MetadataPrivate;
 		// NOTE: Non-const to allow clear() to work more efficiently.
 		MetadataPrivate *d;
 
-		// Q_DISABLE_COPY() equivalent.
-		// TODO: Add LibZomg-specific version of Q_DISABLE_COPY().
-		Metadata(const Metadata &);
-		Metadata &operator=(const Metadata &);
-
 	public:
 		/**
 		 * Initialize the system and program metadata.
@@ -32,6 +32,9 @@
 // MiniZip
 #include "minizip/zip.h"
 
+// CPU flags.
+#include "libcompat/cpuflags.h"
+
 #ifdef _WIN32
 // Win32 Unicode Translation Layer.
 #include "libcompat/W32U/W32U_mini.h"
@@ -68,6 +71,13 @@ using std::vector;
 #define PNG_CONST_CAST(type, ptr) const_cast<type>(ptr)
 #endif
 
+// SSE2-optimized functions are written
+// using GNU inline assembler *only*.
+#if defined(__GNUC__) && \
+    (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
+#define PNGWRITER_HAS_SSE2 1
+#endif
+
 namespace LibZomg {
 
 // TODO: Convert to a static class?
@@ -90,19 +100,50 @@ class PngWriterPrivate
 		PngWriterPrivate &operator=(const PngWriterPrivate &);
 
 	public:
+		// Encoding mode.
+		PngWriter::EncodeMode encodeMode;
+
 		/**
-		 * Write 16-bit PNG rows.
+		 * Convert a 15-bit or 16-bit image to 32-bit xRGB.
+		 * The entire image is converted at once so it can be
+		 * written with png_write_image() instead of one row
+		 * at a time.
 		 * @param pixel Typename.
 		 * @param RBits Red bits.
 		 * @param GBits Green bits.
 		 * @param BBits Blue bits.
 		 * @param img_data Image data.
-		 * @param row_buffer Row buffer. (Must be at least width * 3 bytes.)
-		 * @param png_ptr PNG pointer.
+		 * @param dest Destination buffer. (Must be at least width * height * 4 bytes.)
+		 */
+		template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
+		static void T_convertTo32_noasm(const Zomg_Img_Data_t *img_data, uint32_t *dest);
+
+#ifdef PNGWRITER_HAS_SSE2
+		/**
+		 * Convert a 15-bit or 16-bit image to 32-bit xRGB. (SSE2-optimized)
+		 * @param pixel Typename.
+		 * @param RBits Red bits.
+		 * @param GBits Green bits.
+		 * @param BBits Blue bits.
+		 * @param img_data Image data.
+		 * @param dest Destination buffer. (Must be at least width * height * 4 bytes.)
+		 */
+		template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
+		static void T_convertTo32_SSE2(const Zomg_Img_Data_t *img_data, uint32_t *dest);
+#endif /* PNGWRITER_HAS_SSE2 */
+
+		/**
+		 * Convert a 15-bit or 16-bit image to 32-bit xRGB.
+		 * The SSE2 version is used if it's supported.
+		 * @param pixel Typename.
+		 * @param RBits Red bits.
+		 * @param GBits Green bits.
+		 * @param BBits Blue bits.
+		 * @param img_data Image data.
+		 * @param dest Destination buffer. (Must be at least width * height * 4 bytes.)
 		 */
 		template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
-		static void T_writePNG_rows_16(const Zomg_Img_Data_t *img_data, uint8_t *row_buffer,
-					       png_structp png_ptr);
+		static inline void T_convertTo32(const Zomg_Img_Data_t *img_data, uint32_t *dest);
 
 	public:
 		/**
@@ -130,63 +171,172 @@ class PngWriterPrivate
 		 * @param metaFlags	[in, opt] Metadata flags.
 		 * @return 0 on success; negative errno on error.
 		 */
-		static int writeToPng(png_structp png_ptr, png_infop info_ptr,
+		int writeToPng(png_structp png_ptr, png_infop info_ptr,
 				      const Zomg_Img_Data_t *img_data,
 				      const Metadata *metadata, int metaFlags);
 };
 
 PngWriterPrivate::PngWriterPrivate(PngWriter *q)
 	: q(q)
+	, encodeMode(PngWriter::ENCODE_DEFAULT)
 { }
 
 PngWriterPrivate::~PngWriterPrivate()
 { }
 
 /**
- * Write 16-bit PNG rows.
+ * Convert a 15-bit or 16-bit image to 32-bit xRGB.
+ * The entire image is converted at once so it can be
+ * written with png_write_image() instead of one row
+ * at a time.
  * @param pixel Typename.
  * @param RBits Red bits.
  * @param GBits Green bits.
  * @param BBits Blue bits.
  * @param img_data Image data.
- * @param row_buffer Row buffer. (Must be at least width * 3 bytes.)
- * @param png_ptr PNG pointer.
+ * @param dest Destination buffer. (Must be at least width * height * 4 bytes.)
  */
 template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
-void PngWriterPrivate::T_writePNG_rows_16(const Zomg_Img_Data_t *img_data, uint8_t *row_buffer,
-					  png_structp png_ptr)
+void PngWriterPrivate::T_convertTo32_noasm(const Zomg_Img_Data_t *img_data, uint32_t *dest)
 {
 	#define MMASK(bits) ((1 << (bits)) - 1)
-	uint8_t r, g, b;
+	uint32_t r, g, b;
 
-	// Write the rows.
-	const uint16_t *screen = (const uint16_t*)img_data->data;
+	// Convert the rows.
+	const pixel *screen = (const pixel*)img_data->data;
 	const int row_adj = (img_data->pitch / sizeof(pixel)) - img_data->w;
 	for (int y = img_data->h; y > 0; y--) {
-		uint8_t *rowBufPtr = row_buffer;
-		for (int x = img_data->w; x > 0; x--, rowBufPtr += 3, screen++) {
+		for (int x = img_data->w; x > 0; x--, dest++, screen++) {
 			// Get the color components.
-			r = (uint8_t)((*screen >> (GBits + BBits)) & MMASK(RBits)) << (8 - RBits);
-			g = (uint8_t)((*screen >> BBits) & MMASK(GBits)) << (8 - GBits);
-			b = (uint8_t)((*screen) & MMASK(BBits)) << (8 - BBits);
+			r = ((*screen >> (GBits + BBits)) & MMASK(RBits)) << (8 - RBits);
+			g = ((*screen >> BBits) & MMASK(GBits)) << (8 - GBits);
+			b = ((*screen) & MMASK(BBits)) << (8 - BBits);
 
 			// Fill in the unused bits with a copy of the MSBs.
 			r |= (r >> RBits);
 			g |= (g >> GBits);
 			b |= (b >> BBits);
 
-			// Save the new color components.
-			*(rowBufPtr + 0) = r;
-			*(rowBufPtr + 1) = g;
-			*(rowBufPtr + 2) = b;
+			// Save the new color.
+			*dest = (r << 16) | (g << 8) | b;
 		}
 
-		// Write the row.
-		png_write_row(png_ptr, row_buffer);
-
 		// Next row.
 		screen += row_adj;
 	}
+	#undef MMASK
+}
+
+#ifdef PNGWRITER_HAS_SSE2
+/**
+ * Convert a 15-bit or 16-bit image to 32-bit xRGB. (SSE2-optimized)
+ * @param pixel Typename.
+ * @param RBits Red bits.
+ * @param GBits Green bits.
+ * @param BBits Blue bits.
+ * @param img_data Image data.
+ * @param dest Destination buffer. (Must be at least width * height * 4 bytes.)
+ */
+template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
+void PngWriterPrivate::T_convertTo32_SSE2(const Zomg_Img_Data_t *img_data, uint32_t *dest)
+{
+	static_assert(RBits == 5 && BBits == 5 && (GBits == 5 || GBits == 6),
+		"T_convertTo32_SSE2() only supports 555 and 565.");
+
+	// 128-bit vector type for the xmm register operands.
+	typedef long long xmm_t __attribute__((vector_size(16)));
+	xmm_t px, c, t, t2;
+
+	const pixel *screen = (const pixel*)img_data->data;
+	for (unsigned int y = 0; y < img_data->h; y++) {
+		const pixel *src = (const pixel*)((const uint8_t*)screen + (y * img_data->pitch));
+
+		// Convert 8 pixels at once using SSE2.
+		// Each color component is shifted into the top of a
+		// 16-bit word, then shifted down into the low byte
+		// and ORed with its own MSBs.
+		int x = img_data->w;
+		for (; x > 7; x -= 8, src += 8, dest += 8) {
+			// NOTE: The xmm outputs are only scratch registers,
+			// so this must be volatile to prevent gcc from
+			// removing it.
+			__asm__ __volatile__ (
+				"movdqu		(%[src]), %[px]\n"	// %[px] = 8 source pixels
+				// Blue component.
+				"movdqa		%[px], %[c]\n"
+				"psllw		$11, %[c]\n"		// B in bits 15-11
+				"psrlw		$8, %[c]\n"		// B << 3
+				"movdqa		%[c], %[t]\n"
+				"psrlw		$5, %[t]\n"		// B >> 2
+				"por		%[t], %[c]\n"		// %[c] = [0 | B8] x8
+				// Green component.
+				"movdqa		%[px], %[t]\n"
+				"psrlw		$5, %[t]\n"
+				"psllw		%[gShl], %[t]\n"	// G in the high bits
+				"psrlw		$8, %[t]\n"		// G << (8 - GBits)
+				"movdqa		%[t], %[t2]\n"
+				"psrlw		%[gBits], %[t2]\n"	// G >> (2*GBits - 8)
+				"por		%[t2], %[t]\n"
+				"psllw		$8, %[t]\n"
+				"por		%[t], %[c]\n"		// %[c] = [G8 | B8] x8
+				// Red component.
+				"movdqu		(%[src]), %[px]\n"
+				"psllw		%[rShl], %[px]\n"	// R in bits 15-11
+				"psrlw		$11, %[px]\n"		// R
+				"movdqa		%[px], %[t]\n"
+				"psllw		$3, %[px]\n"		// R << 3
+				"psrlw		$2, %[t]\n"		// R >> 2
+				"por		%[t], %[px]\n"		// %[px] = [0 | R8] x8
+				// Interleave into xRGB.
+				"movdqa		%[c], %[t]\n"
+				"punpcklwd	%[px], %[c]\n"		// %[c] = pixels 0-3
+				"punpckhwd	%[px], %[t]\n"		// %[t] = pixels 4-7
+				"movdqu		%[c], (%[dest])\n"
+				"movdqu		%[t], 16(%[dest])\n"
+				: [px] "=&x" (px), [c] "=&x" (c), [t] "=&x" (t), [t2] "=&x" (t2)
+				: [src] "r" (src), [dest] "r" (dest),
+				  [gShl] "i" (16 - GBits), [gBits] "i" (GBits),
+				  [rShl] "i" (16 - RBits - GBits - BBits)
+				: "memory"
+				);
+		}
+
+		// If the width isn't a multiple of 8 pixels,
+		// convert the remaining pixels normally.
+		for (; x > 0; x--, src++, dest++) {
+			uint32_t r = ((*src >> (GBits + BBits)) & ((1 << RBits) - 1)) << (8 - RBits);
+			uint32_t g = ((*src >> BBits) & ((1 << GBits) - 1)) << (8 - GBits);
+			uint32_t b = ((*src) & ((1 << BBits) - 1)) << (8 - BBits);
+			r |= (r >> RBits);
+			g |= (g >> GBits);
+			b |= (b >> BBits);
+			*dest = (r << 16) | (g << 8) | b;
+		}
+	}
+}
+#endif /* PNGWRITER_HAS_SSE2 */
+
+/**
+ * Convert a 15-bit or 16-bit image to 32-bit xRGB.
+ * The SSE2 version is used if it's supported.
+ * @param pixel Typename.
+ * @param RBits Red bits.
+ * @param GBits Green bits.
+ * @param BBits Blue bits.
+ * @param img_data Image data.
+ * @param dest Destination buffer. (Must be at least width * height * 4 bytes.)
+ */
+template<typename pixel, uint8_t RBits, uint8_t GBits, uint8_t BBits>
+inline void PngWriterPrivate::T_convertTo32(const Zomg_Img_Data_t *img_data, uint32_t *dest)
+{
+#ifdef PNGWRITER_HAS_SSE2
+	if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+		T_convertTo32_SSE2<pixel, RBits, GBits, BBits>(img_data, dest);
+	} else
+#endif /* PNGWRITER_HAS_SSE2 */
+	{
+		T_convertTo32_noasm<pixel, RBits, GBits, BBits>(img_data, dest);
+	}
 }
 
 /**
@@ -231,39 +381,40 @@ int PngWriterPrivate::writeToPng(png_structp png_ptr, png_infop info_ptr,
 				 const Zomg_Img_Data_t *img_data,
 				 const Metadata *metadata, int metaFlags)
 {
-	// Row pointers and/or buffer.
+	// Row pointers and image buffer.
 	// These need to be allocated here so they can be freed
 	// in case an error occurs.
-	// FIXME: gcc-5.2 is showing this warning:
-	// warning: variable ‘row’ might be clobbered by ‘longjmp’ or ‘vfork’ [-Wclobbered]
-	union {
-		void *p;
-
-		// Row pointers. (32-bit color)
-		// Each entry points to the beginning of a row.
-		png_byte **row_pointers;
-
-		// Row buffer. (15-bit or 16-bit color)
-		// libpng doesn't support 15-bit or 16-bit color natively,
-		// so the rows have to be converted.
-		png_byte *row_buffer;
-	} row;
-
-	if (img_data->bpp == 32) {
-		row.row_pointers = (png_byte**)png_malloc(png_ptr, sizeof(png_byte*) * img_data->h);
-	} else {
-		row.row_buffer = (png_byte*)png_malloc(png_ptr, sizeof(png_byte*) * img_data->w * 3);
-	}
-	if (!row.p) {
+	// NOTE: Volatile pointers, since they're used after setjmp().
+	png_byte **volatile row_pointers;
+	uint32_t *volatile img_buffer = nullptr;
+
+	// Row pointers.
+	// Each entry points to the beginning of a row.
+	row_pointers = (png_byte**)png_malloc(png_ptr, sizeof(png_byte*) * img_data->h);
+	if (!row_pointers) {
 		// Not enough memory is available.
 		return -ENOMEM;
 	}
 
+	if (img_data->bpp != 32) {
+		// Image buffer. (15-bit or 16-bit color)
+		// libpng doesn't support 15-bit or 16-bit color natively,
+		// so the image has to be converted to 32-bit first.
+		img_buffer = (uint32_t*)png_malloc(png_ptr,
+				(png_alloc_size_t)img_data->w * img_data->h * sizeof(uint32_t));
+		if (!img_buffer) {
+			// Not enough memory is available.
+			png_free(png_ptr, row_pointers);
+			return -ENOMEM;
+		}
+	}
+
 	// WARNING: Do NOT initialize any C++ objects past this point!
 #ifdef PNG_SETJMP_SUPPORTED
 	if (setjmp(png_jmpbuf(png_ptr))) {
 		// PNG write failed.
-		png_free(png_ptr, row.p);
+		png_free(png_ptr, img_buffer);
+		png_free(png_ptr, row_pointers);
 		// TODO: Better error code?
 		return -ENOMEM;
 	}
@@ -272,9 +423,17 @@ int PngWriterPrivate::writeToPng(png_structp png_ptr, png_infop info_ptr,
 	// Disable PNG filters.
 	png_set_filter(png_ptr, 0, PNG_FILTER_NONE);
 
-	// Set the compression level to 5. (Levels range from 1 to 9.)
-	// TODO: Add a parameter for this?
-	png_set_compression_level(png_ptr, 5);
+	if (encodeMode == PngWriter::ENCODE_FAST) {
+		// Fast encoding.
+		// NOTE: Z_RLE was tested, but it's slower than
+		// level 1 with the default strategy.
+		png_set_compression_level(png_ptr, 1);
+		// Use larger IDAT chunks to reduce zlib overhead.
+		png_set_compression_buffer_size(png_ptr, 65536);
+	} else {
+		// Set the compression level to 5. (Levels range from 1 to 9.)
+		png_set_compression_level(png_ptr, 5);
+	}
 
 	// Set up the PNG header.
 	png_set_IHDR(png_ptr, info_ptr, img_data->w, img_data->h,
@@ -322,47 +481,50 @@ int PngWriterPrivate::writeToPng(png_structp png_ptr, png_infop info_ptr,
 	// Write the PNG header to the file.
 	png_write_info(png_ptr, info_ptr);
 
-	// Write the image.
+	// Convert the image to 32-bit, if necessary.
+	const uint8_t *data;
+	size_t pitch;
 	switch (img_data->bpp) {
-		case 15: {
+		case 15:
 			// 15-bit color. (555)
-			T_writePNG_rows_16<uint16_t, 5, 5, 5>
-					  (img_data, row.row_buffer, png_ptr);
+			T_convertTo32<uint16_t, 5, 5, 5>(img_data, img_buffer);
+			data = (const uint8_t*)img_buffer;
+			pitch = img_data->w * sizeof(uint32_t);
 			break;
-		}
 
-		case 16: {
+		case 16:
 			// 16-bit color. (565)
-			T_writePNG_rows_16<uint16_t, 5, 6, 5>
-					  (img_data, row.row_buffer, png_ptr);
-			// TODO
+			T_convertTo32<uint16_t, 5, 6, 5>(img_data, img_buffer);
+			data = (const uint8_t*)img_buffer;
+			pitch = img_data->w * sizeof(uint32_t);
 			break;
-		}
 
 		case 32:
 		default:
-			// Initialize the row pointers array.
-			// TODO: const uint8_t*.
-			uint8_t *data = (uint8_t*)img_data->data + ((img_data->h - 1) * img_data->pitch);
-			for (int y = img_data->h - 1; y >= 0; y--, data -= img_data->pitch) {
-				row.row_pointers[y] = data;
-			}
-
-			// libpng expects RGB data with no alpha channel, i.e. 24-bit.
-			// However, there is an option to automatically convert 32-bit
-			// without alpha channel to 24-bit, so we'll use that.
-			png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
-
-			// We're using "BGR" color.
-			png_set_bgr(png_ptr);
-
-			// Write the image.
-			png_write_image(png_ptr, row.row_pointers);
+			data = (const uint8_t*)img_data->data;
+			pitch = img_data->pitch;
 			break;
 	}
 
-	// Free the row pointers.
-	png_free(png_ptr, row.p);
+	// Initialize the row pointers array.
+	for (unsigned int y = 0; y < img_data->h; y++, data += pitch) {
+		row_pointers[y] = (png_byte*)data;
+	}
+
+	// libpng expects RGB data with no alpha channel, i.e. 24-bit.
+	// However, there is an option to automatically convert 32-bit
+	// without alpha channel to 24-bit, so we'll use that.
+	png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
+
+	// We're using "BGR" color.
+	png_set_bgr(png_ptr);
+
+	// Write the image.
+	png_write_image(png_ptr, row_pointers);
+
+	// Free the row pointers and image buffer.
+	png_free(png_ptr, img_buffer);
+	png_free(png_ptr, row_pointers);
 
 	// Finished writing the PNG image.
 	png_write_end(png_ptr, info_ptr);
@@ -380,6 +542,26 @@ PngWriter::~PngWriter()
 	delete d;
 }
 
+/**
+ * Get the encoding mode.
+ * @return Encoding mode.
+ */
+PngWriter::EncodeMode PngWriter::encodeMode(void) const
+{
+	return d->encodeMode;
+}
+
+/**
+ * Set the encoding mode.
+ * @param encodeMode Encoding mode.
+ */
+void PngWriter::setEncodeMode(EncodeMode encodeMode)
+{
+	if (encodeMode < ENCODE_DEFAULT || encodeMode >= ENCODE_MAX)
+		return;
+	d->encodeMode = encodeMode;
+}
+
 /**
  * Write an image to a PNG file.
  * No metadata other than creation time will be saved.
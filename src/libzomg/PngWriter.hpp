@@ -48,6 +48,34 @@ class PngWriter
 		PngWriter &operator=(const PngWriter &);
 
 	public:
+		/**
+		 * Encoding mode.
+		 */
+		enum EncodeMode {
+			// Default encoding. (zlib level 5)
+			ENCODE_DEFAULT,
+
+			// Fast encoding. (zlib level 1)
+			// Files are larger, but encoding is several times
+			// faster. Intended for savestate previews and
+			// burst screenshots.
+			ENCODE_FAST,
+
+			ENCODE_MAX
+		};
+
+		/**
+		 * Get the encoding mode.
+		 * @return Encoding mode.
+		 */
+		EncodeMode encodeMode(void) const;
+
+		/**
+		 * Set the encoding mode.
+		 * @param encodeMode Encoding mode.
+		 */
+		void setEncodeMode(EncodeMode encodeMode);
+
 		/**
 		 * Write an image to a PNG file.
 		 * No metadata other than creation time will be saved.
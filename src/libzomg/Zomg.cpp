@@ -32,6 +32,7 @@
 #include "libcompat/reentrant.h"
 
 #include "Zomg.hpp"
+#include "Metadata.hpp"
 
 #ifdef _WIN32
 // Win32 Unicode Translation Layer.
@@ -45,12 +46,15 @@
 #include <sys/stat.h>
 
 // C includes. (C++ namespace)
+#include <cassert>
+#include <cctype>
 #include <cstdio>
 #include <cstring>
 #include <ctime>
 #include <cerrno>
 
 // C++ includes.
+#include <atomic>
 #include <string>
 using std::string;
 
@@ -59,16 +63,166 @@ namespace LibZomg {
 
 /** ZomgPrivate **/
 
+// Default save profile for new Zomg objects.
+static std::atomic<int> defaultSaveProfile(Zomg::SAVE_PROFILE_DEFAULT);
+
 ZomgPrivate::ZomgPrivate(Zomg *q)
 	: q(q)
 	, unz(nullptr)	// TODO: Combine with zip into a union?
 	, zip(nullptr)	// Need to double-check all users.
-{ }
+	, indexed(false)
+	, saveProfile(defaultSaveProfile.load())
+	, deferred(false)
+	, hasPreview(false)
+	, previewIndex(0)
+	, previewMetadata(nullptr)
+	, previewMetaFlags(0)
+{
+	memset(&previewImg, 0, sizeof(previewImg));
+}
 
 ZomgPrivate::~ZomgPrivate()
 {
 	// FIXME: Move ZomgBase stuff here,
 	// and close unz and zip here.
+	delete previewMetadata;
+}
+
+/**
+ * Clear the deferred files.
+ */
+void ZomgPrivate::clearDeferred(void)
+{
+	deferredFiles.clear();
+	hasPreview = false;
+	previewImg.data = nullptr;
+	previewData.clear();
+	delete previewMetadata;
+	previewMetadata = nullptr;
+}
+
+/**
+ * Read a 16-bit little-endian value.
+ * @param p Pointer to the value.
+ * @return Value.
+ */
+static inline uint16_t read_le16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/**
+ * Read a 32-bit little-endian value.
+ * @param p Pointer to the value.
+ * @return Value.
+ */
+static inline uint32_t read_le32(const uint8_t *p)
+{
+	return (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+/**
+ * Build the section index from fileData.
+ * Only stored and deflated files are supported.
+ * Zip64 archives aren't supported.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int ZomgPrivate::buildSectionIndex(void)
+{
+	sections.clear();
+	const uint8_t *const data = fileData.data();
+	const size_t size = fileData.size();
+
+	// Find the End of Central Directory record.
+	// It's at least 22 bytes, plus a comment of up to 64 KB.
+	static const size_t EOCD_SIZE = 22;
+	if (size < EOCD_SIZE)
+		return -EIO;
+	size_t eocd = size - EOCD_SIZE;
+	const size_t eocd_min = (size > EOCD_SIZE + 0xFFFF ? size - EOCD_SIZE - 0xFFFF : 0);
+	while (read_le32(&data[eocd]) != 0x06054B50) {
+		if (eocd == eocd_min)
+			return -EIO;
+		eocd--;
+	}
+
+	const unsigned int count = read_le16(&data[eocd + 10]);
+	const uint32_t cd_size = read_le32(&data[eocd + 12]);
+	const uint32_t cd_offset = read_le32(&data[eocd + 16]);
+	if (count == 0xFFFF || cd_offset == 0xFFFFFFFF ||
+	    (uint64_t)cd_offset + cd_size > eocd)
+	{
+		// Zip64, or the central directory is invalid.
+		return -EIO;
+	}
+
+	// Read the central directory.
+	sections.reserve(count);
+	size_t pos = cd_offset;
+	const size_t cd_end = (size_t)cd_offset + cd_size;
+	for (unsigned int i = 0; i < count; i++) {
+		static const size_t CD_HEADER_SIZE = 46;
+		if (pos + CD_HEADER_SIZE > cd_end || read_le32(&data[pos]) != 0x02014B50)
+			return -EIO;
+
+		const uint16_t flags = read_le16(&data[pos + 8]);
+		Section section;
+		section.method = read_le16(&data[pos + 10]);
+		section.compSize = read_le32(&data[pos + 20]);
+		section.uncompSize = read_le32(&data[pos + 24]);
+		const unsigned int nameLen = read_le16(&data[pos + 28]);
+		const unsigned int extraLen = read_le16(&data[pos + 30]);
+		const unsigned int commentLen = read_le16(&data[pos + 32]);
+		const uint32_t localOffset = read_le32(&data[pos + 42]);
+		if (pos + CD_HEADER_SIZE + nameLen > cd_end)
+			return -EIO;
+		if ((flags & 1) || (section.method != 0 && section.method != Z_DEFLATED)) {
+			// Encrypted, or unsupported compression method.
+			return -EIO;
+		}
+
+		// Lowercase the filename for case-insensitive lookups.
+		string name((const char*)&data[pos + CD_HEADER_SIZE], nameLen);
+		for (size_t j = 0; j < name.size(); j++) {
+			name[j] = tolower(name[j]);
+		}
+
+		// Find the file data using the local file header.
+		static const size_t LOCAL_HEADER_SIZE = 30;
+		if ((uint64_t)localOffset + LOCAL_HEADER_SIZE > size ||
+		    read_le32(&data[localOffset]) != 0x04034B50)
+		{
+			return -EIO;
+		}
+		const uint64_t dataOffset = (uint64_t)localOffset + LOCAL_HEADER_SIZE +
+			read_le16(&data[localOffset + 26]) +
+			read_le16(&data[localOffset + 28]);
+		if (dataOffset + section.compSize > size)
+			return -EIO;
+		section.dataOffset = (uint32_t)dataOffset;
+
+		// If a filename is duplicated, minizip uses the first one.
+		sections.insert(std::make_pair(name, section));
+		pos += CD_HEADER_SIZE + nameLen + extraLen + commentLen;
+	}
+
+	return 0;
+}
+
+/**
+ * Find a section in the section index.
+ * @param filename Filename. (case-insensitive)
+ * @return Section, or nullptr if not found.
+ */
+const ZomgPrivate::Section *ZomgPrivate::findSection(const char *filename) const
+{
+	string name(filename);
+	for (size_t i = 0; i < name.size(); i++) {
+		name[i] = tolower(name[i]);
+	}
+
+	std::unordered_map<string, Section>::const_iterator iter = sections.find(name);
+	return (iter != sections.end() ? &iter->second : nullptr);
 }
 
 /**
@@ -78,15 +232,48 @@ ZomgPrivate::~ZomgPrivate()
  */
 int ZomgPrivate::initZomgLoad(const char *filename)
 {
+	// Read the entire file and index its sections.
+	// Savestates are small, so this is faster than
+	// having minizip scan the central directory
+	// and seek around the file for every section.
+	// Files larger than 16 MB are left to minizip.
+	static const long MAX_INDEX_FILE_SIZE = 16*1024*1024;
+	FILE *f = fopen(filename, "rb");
+	if (f) {
+		long size = -1;
+		if (fseek(f, 0, SEEK_END) == 0) {
+			size = ftell(f);
+			fseek(f, 0, SEEK_SET);
+		}
+		if (size > 0 && size <= MAX_INDEX_FILE_SIZE) {
+			fileData.resize(size);
+			if (fread(fileData.data(), 1, size, f) != (size_t)size) {
+				fileData.clear();
+			}
+		}
+		fclose(f);
+	}
+	if (!fileData.empty() && buildSectionIndex() == 0) {
+		// Section index was built.
+		indexed = true;
+	} else {
+		// Couldn't index the file. Use minizip instead.
+		fileData.clear();
+		sections.clear();
+		indexed = false;
+	}
+
+	if (!indexed) {
 #ifdef _WIN32
-	zlib_filefunc64_def ffunc;
-	fill_win32_filefunc64U(&ffunc);
-	this->unz = unzOpen2_64(filename, &ffunc);
+		zlib_filefunc64_def ffunc;
+		fill_win32_filefunc64U(&ffunc);
+		this->unz = unzOpen2_64(filename, &ffunc);
 #else
-	this->unz = unzOpen(filename);
+		this->unz = unzOpen(filename);
 #endif
+	}
 
-	if (!this->unz) {
+	if (!this->unz && !indexed) {
 		// TODO: Figure out why open failed.
 		// On Windows, GetLastError() may work.
 		// On Linux, errno may work.
@@ -183,6 +370,12 @@ Zomg::Zomg(const char *filename, ZomgFileMode mode)
 		case ZOMG_SAVE:
 			ret = d->initZomgSave(filename);
 			break;
+		case ZOMG_SAVE_DEFERRED:
+			// The Zip file is created by writeDeferred().
+			d->deferred = true;
+			mode = ZOMG_SAVE;
+			ret = 0;
+			break;
 		default:
 			ret = -EINVAL;
 			break;
@@ -219,14 +412,121 @@ void Zomg::close(void)
 	}
 
 	if (d->zip) {
+		// Write any sections that are still being compressed.
+		d->flushPending();
 		zipClose(d->zip, nullptr);
 		d->zip = nullptr;
 	}
 
+	// Release the section index.
+	d->indexed = false;
+	d->sections.clear();
+	std::vector<uint8_t>().swap(d->fileData);
+
+	// Discard anything that wasn't written by writeDeferred().
+	d->clearDeferred();
+	d->deferred = false;
 	m_mode = ZOMG_CLOSED;
 	m_lastError = 0;
 }
 
+/**
+ * Write all deferred files to the ZOMG file.
+ * This compresses the buffered sections and the
+ * preview image, so it may be called from a
+ * worker thread. The ZOMG must not be accessed
+ * by any other thread while this is running.
+ * @return 0 on success; negative errno on error.
+ */
+int Zomg::writeDeferred(void)
+{
+	if (m_mode != ZOMG_SAVE || !d->deferred)
+		return -EBADF;
+
+	// Files are written directly from now on.
+	d->deferred = false;
+	int ret = d->initZomgSave(m_filename.c_str());
+	if (ret != 0) {
+		d->clearDeferred();
+		m_lastError = ret;
+		return ret;
+	}
+
+	// Write the files in their original order.
+	// ZOMG.ini must be the first file.
+	const size_t count = d->deferredFiles.size();
+	for (size_t i = 0; i <= count; i++) {
+		int fret = 0;
+		if (d->hasPreview && i == d->previewIndex) {
+			fret = d->savePreviewToZomg(&d->previewImg,
+				d->previewMetadata, d->previewMetaFlags);
+			if (fret != 0 && ret == 0)
+				ret = fret;
+		}
+		if (i == count)
+			break;
+
+		const ZomgPrivate::DeferredFile &file = d->deferredFiles[i];
+		fret = d->saveToZomg(file.filename.c_str(),
+			(file.data.empty() ? nullptr : &file.data[0]),
+			(int)file.data.size(), file.fileType);
+		if (fret != 0 && ret == 0)
+			ret = fret;
+	}
+
+	// Wait for the large sections to finish compressing.
+	int fret = d->flushPending();
+	if (fret != 0 && ret == 0)
+		ret = fret;
+
+	d->clearDeferred();
+	m_lastError = ret;
+	return ret;
+}
+
+/**
+ * Get the save profile.
+ * @return Save profile.
+ */
+Zomg::SaveProfile Zomg::saveProfile(void) const
+{
+	return (SaveProfile)d->saveProfile;
+}
+
+/**
+ * Set the save profile.
+ * This must be set before any sections are saved.
+ * @param saveProfile Save profile.
+ */
+void Zomg::setSaveProfile(SaveProfile saveProfile)
+{
+	assert(saveProfile >= SAVE_PROFILE_STORE && saveProfile < SAVE_PROFILE_MAX);
+	if (saveProfile < SAVE_PROFILE_STORE || saveProfile >= SAVE_PROFILE_MAX)
+		return;
+	d->saveProfile = saveProfile;
+}
+
+/**
+ * Get the default save profile for new Zomg objects.
+ * @return Default save profile.
+ */
+Zomg::SaveProfile Zomg::DefaultSaveProfile(void)
+{
+	return (SaveProfile)defaultSaveProfile.load();
+}
+
+/**
+ * Set the default save profile for new Zomg objects.
+ * @param saveProfile Default save profile.
+ */
+void Zomg::SetDefaultSaveProfile(SaveProfile saveProfile)
+{
+	assert(saveProfile >= SAVE_PROFILE_STORE && saveProfile < SAVE_PROFILE_MAX);
+	if (saveProfile < SAVE_PROFILE_STORE || saveProfile >= SAVE_PROFILE_MAX)
+		return;
+	defaultSaveProfile.store(saveProfile);
+}
+
 
 /**
  * Detect if a savestate is supported by this class.
@@ -52,6 +52,56 @@ class Zomg : public ZomgBase
 	public:
 		virtual void close(void) final;
 
+		/**
+		 * Write all deferred files to the ZOMG file.
+		 * Only valid if the ZOMG was opened with ZOMG_SAVE_DEFERRED.
+		 * This compresses the buffered sections and the
+		 * preview image, so it may be called from a
+		 * worker thread. The ZOMG must not be accessed
+		 * by any other thread while this is running.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int writeDeferred(void);
+
+		/**
+		 * Save profile.
+		 * Determines how sections are compressed when saving.
+		 * Sections smaller than 1 KB are always stored uncompressed.
+		 */
+		enum SaveProfile {
+			SAVE_PROFILE_STORE,	// No compression. (fastest)
+			SAVE_PROFILE_FAST,	// Fast compression.
+			SAVE_PROFILE_DEFAULT,	// zlib's default compression.
+			SAVE_PROFILE_BEST,	// Best compression. (slowest)
+
+			SAVE_PROFILE_MAX
+		};
+
+		/**
+		 * Get the save profile.
+		 * @return Save profile.
+		 */
+		SaveProfile saveProfile(void) const;
+
+		/**
+		 * Set the save profile.
+		 * This must be set before any sections are saved.
+		 * @param saveProfile Save profile.
+		 */
+		void setSaveProfile(SaveProfile saveProfile);
+
+		/**
+		 * Get the default save profile for new Zomg objects.
+		 * @return Default save profile.
+		 */
+		static SaveProfile DefaultSaveProfile(void);
+
+		/**
+		 * Set the default save profile for new Zomg objects.
+		 * @param saveProfile Default save profile.
+		 */
+		static void SetDefaultSaveProfile(SaveProfile saveProfile);
+
 		/**
 		 * Detect if a savestate is supported by this class.
 		 * @param filename Savestate filename.
@@ -61,6 +111,8 @@ class Zomg : public ZomgBase
 
 		/**
 		 * Load savestate functions.
+		 * These may be called from multiple threads at once,
+		 * e.g. to load large memory sections in parallel.
 		 * @param siz Number of bytes to read.
 		 * @return Bytes read on success; negative on error.
 		 * TODO: Standardize error codes.
@@ -34,8 +34,9 @@ ZomgBase::ZomgBase(const char *filename, ZomgFileMode mode)
 {
 	((void)filename);
 
-	if (m_mode == ZOMG_SAVE) {
+	if (mode == ZOMG_SAVE || mode == ZOMG_SAVE_DEFERRED) {
 		// Initialize m_mtime.
+		// NOTE: For deferred saves, this is the snapshot time.
 		m_mtime = time(nullptr);
 	}
 }
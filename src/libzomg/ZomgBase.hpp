@@ -62,7 +62,16 @@ class ZomgBase
 		enum ZomgFileMode {
 			ZOMG_CLOSED,
 			ZOMG_LOAD,
-			ZOMG_SAVE
+			ZOMG_SAVE,
+
+			// Save, but buffer everything in memory.
+			// Nothing is compressed or written until
+			// writeDeferred() is called, which can be
+			// done on another thread. Closing the ZOMG
+			// without calling writeDeferred() discards
+			// the buffered files.
+			// NOTE: The mode is ZOMG_SAVE once opened.
+			ZOMG_SAVE_DEFERRED
 		};
 
 		ZomgBase(const char *filename, ZomgFileMode mode);
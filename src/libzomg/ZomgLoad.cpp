@@ -58,8 +58,55 @@
 #include "Zomg_p.hpp"
 namespace LibZomg {
 
+/**
+ * Decompress a section into a buffer.
+ * This only reads fileData, so it's thread-safe.
+ * @param section Section.
+ * @param buf Buffer.
+ * @param len Length of buf.
+ * @return Number of bytes read, or negative POSIX error code on error.
+ */
+int ZomgPrivate::loadSection(const Section *section, void *buf, int len) const
+{
+	if (len < 0)
+		return -EINVAL;
+	const uint8_t *const src = &fileData[section->dataOffset];
+
+	if (section->method == 0) {
+		// Stored.
+		if ((uint32_t)len > section->compSize) {
+			len = (int)section->compSize;
+		}
+		memcpy(buf, src, len);
+		return len;
+	}
+
+	// Deflated.
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	if (inflateInit2(&strm, -MAX_WBITS) != Z_OK)
+		return -ENOMEM;
+	strm.next_in = const_cast<Bytef*>(src);
+	strm.avail_in = section->compSize;
+	strm.next_out = (Bytef*)buf;
+	strm.avail_out = len;
+
+	// If the buffer is smaller than the file,
+	// inflate() stops when the buffer is full.
+	int ret = inflate(&strm, Z_FINISH);
+	if (ret == Z_STREAM_END || (ret == Z_BUF_ERROR && strm.avail_out == 0)) {
+		ret = (int)strm.total_out;
+	} else {
+		ret = -EIO;
+	}
+	inflateEnd(&strm);
+	return ret;
+}
+
 /**
  * Load a file from the ZOMG file.
+ * If the section index was built, this is thread-safe.
+ * Otherwise, minizip access is serialized.
  * @param filename Filename to load from the ZOMG file.
  * @param buf Buffer to store the file in.
  * @param len Length of the buffer.
@@ -67,8 +114,22 @@ namespace LibZomg {
  */
 int ZomgPrivate::loadFromZomg(const char *filename, void *buf, int len)
 {
-	if (q->m_mode != ZomgBase::ZOMG_LOAD || !this->unz)
+	if (q->m_mode != ZomgBase::ZOMG_LOAD)
+		return -EBADF;
+
+	if (indexed) {
+		// Use the section index.
+		const Section *section = findSection(filename);
+		if (!section) {
+			// File not found.
+			return -ENOENT;
+		}
+		return loadSection(section, buf, len);
+	}
+
+	if (!this->unz)
 		return -EBADF;
+	std::lock_guard<std::mutex> lock(unzMutex);
 
 	// Locate the file in the ZOMG file.
 	int ret = unzLocateFile(this->unz, filename, 2);
@@ -92,6 +153,42 @@ int ZomgPrivate::loadFromZomg(const char *filename, void *buf, int len)
 	return ret;
 }
 
+/**
+ * Get the uncompressed size of a file in the ZOMG file.
+ * @param filename Filename in the ZOMG file.
+ * @return Uncompressed size, or negative POSIX error code on error.
+ */
+int64_t ZomgPrivate::sizeInZomg(const char *filename)
+{
+	if (q->m_mode != ZomgBase::ZOMG_LOAD)
+		return -EBADF;
+
+	if (indexed) {
+		// Use the section index.
+		const Section *section = findSection(filename);
+		return (section ? (int64_t)section->uncompSize : -ENOENT);
+	}
+
+	if (!this->unz)
+		return -EBADF;
+	std::lock_guard<std::mutex> lock(unzMutex);
+
+	// Locate the file in the ZOMG file.
+	int ret = unzLocateFile(this->unz, filename, 2);
+	if (ret != UNZ_OK) {
+		// File not found.
+		return -ENOENT;
+	}
+
+	unz_file_info64 file_info;
+	ret = unzGetCurrentFileInfo64(this->unz, &file_info, nullptr, 0, nullptr, 0, nullptr, 0);
+	if (ret != UNZ_OK) {
+		// Error getting the file information.
+		return -EIO;
+	}
+	return (int64_t)file_info.uncompressed_size;
+}
+
 /**
  * Load savestate functions.
  * @param siz Number of bytes to read.
@@ -113,53 +210,31 @@ int Zomg::loadPreview(Zomg_Img_Data_t *img_data)
 	// TODO: Function to automatically allocate memory for this.
 	// TODO: Improve API.
 	// (Maybe use a C++ class for img_data that frees itself automatically?)
-	if (m_mode != ZomgBase::ZOMG_LOAD || !d->unz)
-		return -EBADF;
 
-	// Locate the file in the ZOMG file.
-	int ret = unzLocateFile(d->unz, "preview.png", 2);
-	if (ret != UNZ_OK) {
-		// File not found.
-		return -ENOENT;
-	}
-
-	// Check the size of the current file.
+	// Check the size of the preview image.
 	// We'll apply a hard limit of 4 MB.
 	// (Screenshots shouldn't be more than 600 KB,
 	// and that's assuming 320x480, 32-bit color,
 	// raw bitmap format.)
-	unz_file_info64 file_info;
-	ret = unzGetCurrentFileInfo64(d->unz, &file_info, nullptr, 0, nullptr, 0, nullptr, 0);
-	if (ret != UNZ_OK) {
-		// Error getting the file information.
-		return -EIO;
-	}
-
-	// Check the filesize.
-	if (file_info.uncompressed_size > 4*1024*1024) {
+	const int64_t size = d->sizeInZomg("preview.png");
+	if (size < 0) {
+		// File not found, or the ZOMG isn't open.
+		return (int)size;
+	} else if (size > 4*1024*1024) {
 		// File is too big.
 		return -ENOMEM;
 	}
 
-	// Open the current file.
-	ret = unzOpenCurrentFile(d->unz);
-	if (ret != UNZ_OK) {
-		// Error opening the current file.
-		return -EIO;
-	}
-
 	// Allocate a memory buffer.
-	int len = (int)file_info.uncompressed_size;
+	int len = (int)size;
 	uint8_t *buf = (uint8_t*)malloc(len);
 	if (!buf) {
 		// Error allocating memory.
-		unzCloseCurrentFile(d->unz);    // TODO: Check the return value!
 		return -ENOMEM;
 	}
 
 	// Read the image data.
-	ret = unzReadCurrentFile(d->unz, buf, len);
-	unzCloseCurrentFile(d->unz);    // TODO: Check the return value!
+	int ret = d->loadFromZomg("preview.png", buf, len);
 	if (ret != len) {
 		// Error reading the image data.
 		free(buf);
@@ -53,7 +53,10 @@
 #include <cerrno>
 
 // C++ includes.
+#include <future>
 #include <string>
+#include <utility>
+#include <vector>
 using std::string;
 
 // PngWriter.
@@ -99,17 +102,161 @@ namespace LibZomg {
 int ZomgPrivate::saveToZomg(const char *filename, const void *buf, int len,
 			    ZomgZipFileType_t fileType)
 {
-	if (q->m_mode != ZomgBase::ZOMG_SAVE || !this->zip)
+	if (q->m_mode != ZomgBase::ZOMG_SAVE)
 		return -EBADF;
 
+	if (this->deferred) {
+		// Deferred save. Copy the file for later.
+		assert(fileType >= ZOMG_FILE_BINARY && fileType <= ZOMG_FILE_TEXT);
+		if (len < 0)
+			return -EINVAL;
+		DeferredFile file;
+		file.filename = filename;
+		file.data.assign((const uint8_t*)buf, (const uint8_t*)buf + len);
+		file.fileType = fileType;
+		deferredFiles.push_back(std::move(file));
+		return 0;
+	}
+
+	if (!this->zip)
+		return -EBADF;
+	assert(fileType >= ZOMG_FILE_BINARY && fileType <= ZOMG_FILE_TEXT);
+	if (len < 0)
+		return -EINVAL;
+
+	const int level = compressionLevel(len);
+	if (len >= ASYNC_THRESHOLD && level != 0) {
+		// Large section. Compress it on a worker thread.
+		// It will be written by flushPending(), which is
+		// called before the preview image and on close().
+		PendingFile pending;
+		pending.filename = filename;
+		pending.fileType = fileType;
+		std::vector<uint8_t> data((const uint8_t*)buf, (const uint8_t*)buf + len);
+		pending.file = std::async(std::launch::async,
+			[level](const std::vector<uint8_t> &data) {
+				return compressFile(data.data(), (int)data.size(), level);
+			}, std::move(data));
+		pendingFiles.push_back(std::move(pending));
+		return 0;
+	}
+
+	if (!pendingFiles.empty()) {
+		// Large sections are still being compressed.
+		// Queue this section so the files stay in order.
+		PendingFile pending;
+		pending.filename = filename;
+		pending.fileType = fileType;
+		std::promise<CompressedFile> promise;
+		promise.set_value(compressFile((const uint8_t*)buf, len, level));
+		pending.file = promise.get_future();
+		pendingFiles.push_back(std::move(pending));
+		return 0;
+	}
+
+	return writeCompressed(filename, fileType,
+		compressFile((const uint8_t*)buf, len, level));
+}
+
+/**
+ * Get the zlib compression level for a section.
+ * @param len Section length.
+ * @return zlib compression level. (0 == stored)
+ */
+int ZomgPrivate::compressionLevel(int len) const
+{
+	if (len < STORE_THRESHOLD) {
+		// Deflate can't do much with tiny files,
+		// and initializing zlib costs more than
+		// the few bytes it might save.
+		return 0;
+	}
+
+	switch (saveProfile) {
+		case Zomg::SAVE_PROFILE_STORE:
+			return 0;
+		case Zomg::SAVE_PROFILE_FAST:
+			return Z_BEST_SPEED;
+		case Zomg::SAVE_PROFILE_BEST:
+			return Z_BEST_COMPRESSION;
+		case Zomg::SAVE_PROFILE_DEFAULT:
+		default:
+			return Z_DEFAULT_COMPRESSION;
+	}
+}
+
+/**
+ * Compress a section using raw deflate.
+ * This doesn't access the ZomgPrivate object,
+ * so it can be run on a worker thread.
+ * @param buf Section data.
+ * @param len Length of buf.
+ * @param level zlib compression level. (0 == stored)
+ * @return Compressed section.
+ */
+ZomgPrivate::CompressedFile ZomgPrivate::compressFile(const uint8_t *buf, int len, int level)
+{
+	CompressedFile file;
+	file.uncompSize = (uint32_t)len;
+	file.crc32 = crc32(0, buf, (uInt)len);
+	file.level = level;
+	file.err = 0;
+
+	if (level == 0) {
+		// Stored.
+		file.data.assign(buf, buf + len);
+		return file;
+	}
+
+	// Raw deflate, using the same parameters as minizip.
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	int ret = deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS,
+			       DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+	if (ret != Z_OK) {
+		file.err = -ENOMEM;
+		return file;
+	}
+
+	file.data.resize(deflateBound(&strm, (uLong)len));
+	strm.next_in = (Bytef*)buf;
+	strm.avail_in = (uInt)len;
+	strm.next_out = file.data.data();
+	strm.avail_out = (uInt)file.data.size();
+	ret = deflate(&strm, Z_FINISH);
+	if (ret != Z_STREAM_END) {
+		file.err = -EIO;
+		file.data.clear();
+	} else {
+		file.data.resize(strm.total_out);
+	}
+	deflateEnd(&strm);
+	return file;
+}
+
+/**
+ * Write a compressed section to the ZOMG file.
+ * @param filename Filename in the ZOMG file.
+ * @param fileType File type.
+ * @param file Compressed section.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int ZomgPrivate::writeCompressed(const char *filename, ZomgZipFileType_t fileType,
+				 const CompressedFile &file)
+{
+	if (file.err != 0)
+		return file.err;
+
 	// Open the new file in the ZOMG file.
 	zip_fileinfo zipfi;
 	memcpy(&zipfi.tmz_date, &this->zipfi.tmz_date, sizeof(zipfi.tmz_date));
 	zipfi.dosDate = 0;
-	assert(fileType >= ZOMG_FILE_BINARY && fileType <= ZOMG_FILE_TEXT);
 	zipfi.internal_fa = fileType;
 	zipfi.external_fa = ZIP_EXTERNAL_FA;	// External attributes. (OS-dependent)
 
+	// The section is already compressed, so it's
+	// written in raw mode. minizip only uses the
+	// level to set the general purpose flags.
 	int ret = zipOpenNewFileInZip4(
 		this->zip,		// zipFile
 		filename,		// Filename in the Zip archive
@@ -119,11 +266,12 @@ int ZomgPrivate::saveToZomg(const char *filename, const void *buf, int len,
 		nullptr,		// extrafield_global,
 		0,			// size_extrafield_global,
 		nullptr,		// comment
-		Z_DEFLATED,		// method
-		Z_DEFAULT_COMPRESSION,  // level
-		// The following values, except for versionMadeBy,
-		// are all defaults from zipOpenNewFileInZip().
-		0,			// raw
+		(file.level != 0 ? Z_DEFLATED : 0),	// method
+		file.level,		// level
+		// The following values, except for raw and
+		// versionMadeBy, are all defaults from
+		// zipOpenNewFileInZip().
+		1,			// raw
 		-MAX_WBITS,		// windowBits
 		DEF_MEM_LEVEL,		// memLevel
 		Z_DEFAULT_STRATEGY,	// strategy
@@ -133,17 +281,35 @@ int ZomgPrivate::saveToZomg(const char *filename, const void *buf, int len,
 		0			// flagBase
 		);
 
-	if (ret != UNZ_OK) {
+	if (ret != ZIP_OK) {
 		// Error opening the new file in the Zip archive.
 		return -EIO;
 	}
 
 	// Write the file.
-	zipWriteInFileInZip(this->zip, buf, len);	// TODO: Check the return value!
-	zipCloseFileInZip(this->zip);			// TODO: Check the return value!
+	if (!file.data.empty()) {
+		ret = zipWriteInFileInZip(this->zip, file.data.data(), (unsigned int)file.data.size());
+	}
+	int cret = zipCloseFileInZipRaw(this->zip, file.uncompSize, file.crc32);
+	return (ret == ZIP_OK && cret == ZIP_OK ? 0 : -EIO);
+}
 
-	// TODO: What should we return?
-	return 0;
+/**
+ * Write all pending sections to the ZOMG file.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int ZomgPrivate::flushPending(void)
+{
+	int ret = 0;
+	for (size_t i = 0; i < pendingFiles.size(); i++) {
+		PendingFile &pending = pendingFiles[i];
+		int fret = writeCompressed(pending.filename.c_str(),
+				pending.fileType, pending.file.get());
+		if (fret != 0 && ret == 0)
+			ret = fret;
+	}
+	pendingFiles.clear();
+	return ret;
 }
 
 /**
@@ -205,18 +371,68 @@ int Zomg::savePreview(const _Zomg_Img_Data_t *img_data)
 int Zomg::savePreview(const Zomg_Img_Data_t *img_data,
 		      const Metadata *metadata, int metaFlags)
 {
-	if (m_mode != ZomgBase::ZOMG_SAVE || !d->zip)
+	if (m_mode != ZomgBase::ZOMG_SAVE)
 		return -EBADF;
 
+	if (d->deferred) {
+		// Deferred save. Copy the image for later.
+		// PNG encoding is done in writeDeferred().
+		// NOTE: img_data may point into a larger framebuffer,
+		// so only the visible part of each line is copied.
+		if (!img_data || !img_data->data ||
+		    img_data->w == 0 || img_data->h == 0)
+			return -EINVAL;
+		const size_t rowBytes = (size_t)img_data->w * (img_data->bpp == 32 ? 4 : 2);
+		d->previewData.resize(rowBytes * img_data->h);
+		const uint8_t *src = (const uint8_t*)img_data->data;
+		uint8_t *dest = &d->previewData[0];
+		for (unsigned int y = img_data->h; y > 0; y--) {
+			memcpy(dest, src, rowBytes);
+			dest += rowBytes;
+			src += img_data->pitch;
+		}
+		d->previewImg = *img_data;
+		d->previewImg.data = &d->previewData[0];
+		d->previewImg.pitch = (uint32_t)rowBytes;
+		delete d->previewMetadata;
+		d->previewMetadata = (metadata ? new Metadata(*metadata) : nullptr);
+		d->previewMetaFlags = metaFlags;
+		d->previewIndex = d->deferredFiles.size();
+		d->hasPreview = true;
+		return 0;
+	}
+
+	return d->savePreviewToZomg(img_data, metadata, metaFlags);
+}
+
+/**
+ * Write the preview image to the ZOMG file.
+ * @param img_data	[in] Image data.
+ * @param metadata	[in, opt] Extra metadata.
+ * @param metaFlags	[in, opt] Metadata flags.
+ * @return 0 on success; non-zero on error.
+ */
+int ZomgPrivate::savePreviewToZomg(const Zomg_Img_Data_t *img_data,
+				   const Metadata *metadata, int metaFlags)
+{
+	if (!this->zip)
+		return -EBADF;
+
+	// Write any sections that were saved before the preview image.
+	int ret = flushPending();
+	if (ret != 0)
+		return ret;
+
 	// Open the new file in the ZOMG file.
 	zip_fileinfo zipfi;
-	memcpy(&zipfi.tmz_date, &d->zipfi.tmz_date, sizeof(zipfi.tmz_date));
+	memcpy(&zipfi.tmz_date, &this->zipfi.tmz_date, sizeof(zipfi.tmz_date));
 	zipfi.dosDate = 0;
 	zipfi.internal_fa = ZomgPrivate::ZOMG_FILE_BINARY;
 	zipfi.external_fa = ZIP_EXTERNAL_FA;	// External attributes. (OS-dependent)
 
-	int ret = zipOpenNewFileInZip4(
-		d->zip,			// zipFile
+	// PNG data is already compressed, so it's stored as-is.
+	ret = zipOpenNewFileInZip4(
+		this->zip,			// zipFile
 		"preview.png",		// Filename in the Zip archive
 		&zipfi,			// File information (timestamp, attributes)
 		nullptr,		// extrafield_local
@@ -224,8 +440,8 @@ int Zomg::savePreview(const Zomg_Img_Data_t *img_data,
 		nullptr,		// extrafield_global,
 		0,			// size_extrafield_global,
 		nullptr,		// comment
-		Z_DEFLATED,		// method
-		Z_DEFAULT_COMPRESSION,	// level
+		0,			// method
+		0,			// level
 		// The following values, except for versionMadeBy,
 		// are all defaults from zipOpenNewFileInZip().
 		0,			// raw
@@ -245,8 +461,14 @@ int Zomg::savePreview(const Zomg_Img_Data_t *img_data,
 
 	// Write the file.
 	PngWriter pngWriter;	// TODO: Make it static?
-	ret = pngWriter.writeToZip(img_data, d->zip, metadata, metaFlags);
-	zipCloseFileInZip(d->zip);	// TODO: Check the return value!
+	if (saveProfile == Zomg::SAVE_PROFILE_STORE ||
+	    saveProfile == Zomg::SAVE_PROFILE_FAST)
+	{
+		// Fast save profile. Use fast PNG encoding.
+		pngWriter.setEncodeMode(PngWriter::ENCODE_FAST);
+	}
+	ret = pngWriter.writeToZip(img_data, this->zip, metadata, metaFlags);
+	zipCloseFileInZip(this->zip);	// TODO: Check the return value!
 
 	return ret;
 }
@@ -22,10 +22,28 @@
 #ifndef __LIBZOMG_ZOMG_P_HPP__
 #define __LIBZOMG_ZOMG_P_HPP__
 
+// C includes.
+#include <stdint.h>
+
 // MiniZip
 #include "minizip/zip.h"
 #include "minizip/unzip.h"
 
+// C++ includes.
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Image data struct.
+#include "img_data.h"
+
+// Metadata.
+// ZomgPrivate owns previewMetadata, so Metadata must be
+// a complete type anywhere ZomgPrivate deletes it.
+#include "Metadata.hpp"
+
 namespace LibZomg {
 
 class Zomg;
@@ -66,8 +84,172 @@ class ZomgPrivate
 		};
 
 		int loadFromZomg(const char *filename, void *buf, int len);
+
+		/**
+		 * Get the uncompressed size of a file in the ZOMG file.
+		 * @param filename Filename in the ZOMG file.
+		 * @return Uncompressed size, or negative POSIX error code on error.
+		 */
+		int64_t sizeInZomg(const char *filename);
+
+		/** Section index. (ZOMG_LOAD only) **/
+
+		/**
+		 * Location of a file in the ZOMG file.
+		 * Offsets are relative to the start of fileData.
+		 */
+		struct Section {
+			uint32_t dataOffset;	// Start of the compressed data.
+			uint32_t compSize;	// Compressed size.
+			uint32_t uncompSize;	// Uncompressed size.
+			uint16_t method;	// Compression method. (0 == stored; 8 == deflate)
+		};
+
+		// Entire ZOMG file.
+		// Only valid if the section index was built.
+		std::vector<uint8_t> fileData;
+
+		// Section index, keyed by the lowercase filename.
+		// If indexed is false, minizip is used instead.
+		bool indexed;
+		std::unordered_map<std::string, Section> sections;
+
+		// Serializes minizip access if the
+		// section index couldn't be built.
+		std::mutex unzMutex;
+
+		/**
+		 * Build the section index from fileData.
+		 * Only stored and deflated files are supported.
+		 * Zip64 archives aren't supported.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int buildSectionIndex(void);
+
+		/**
+		 * Find a section in the section index.
+		 * @param filename Filename. (case-insensitive)
+		 * @return Section, or nullptr if not found.
+		 */
+		const Section *findSection(const char *filename) const;
+
+		/**
+		 * Decompress a section into a buffer.
+		 * This only reads fileData, so it's thread-safe.
+		 * @param section Section.
+		 * @param buf Buffer.
+		 * @param len Length of buf.
+		 * @return Number of bytes read, or negative POSIX error code on error.
+		 */
+		int loadSection(const Section *section, void *buf, int len) const;
 		int saveToZomg(const char *filename, const void *buf, int len,
 			       ZomgZipFileType_t fileType = ZOMG_FILE_BINARY);
+
+		/** Section compression. (ZOMG_SAVE only) **/
+
+		// Save profile. (Zomg::SaveProfile)
+		int saveProfile;
+
+		// Sections smaller than this are stored uncompressed.
+		static const int STORE_THRESHOLD = 1024;
+		// Sections at least this large are compressed
+		// on a worker thread.
+		static const int ASYNC_THRESHOLD = 16384;
+
+		/**
+		 * Get the zlib compression level for a section.
+		 * @param len Section length.
+		 * @return zlib compression level. (0 == stored)
+		 */
+		int compressionLevel(int len) const;
+
+		/**
+		 * Compressed section.
+		 * If level is 0, data contains the uncompressed section.
+		 */
+		struct CompressedFile {
+			std::vector<uint8_t> data;
+			uint32_t crc32;
+			uint32_t uncompSize;
+			int level;
+			int err;	// 0 on success; negative POSIX error code on error.
+		};
+
+		/**
+		 * Compress a section using raw deflate.
+		 * This doesn't access the ZomgPrivate object,
+		 * so it can be run on a worker thread.
+		 * @param buf Section data.
+		 * @param len Length of buf.
+		 * @param level zlib compression level. (0 == stored)
+		 * @return Compressed section.
+		 */
+		static CompressedFile compressFile(const uint8_t *buf, int len, int level);
+
+		/**
+		 * Write a compressed section to the ZOMG file.
+		 * @param filename Filename in the ZOMG file.
+		 * @param fileType File type.
+		 * @param file Compressed section.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int writeCompressed(const char *filename, ZomgZipFileType_t fileType,
+				    const CompressedFile &file);
+
+		// Sections that haven't been written yet.
+		// Large sections are compressed on worker threads;
+		// the sections are written in order by flushPending().
+		struct PendingFile {
+			std::string filename;
+			ZomgZipFileType_t fileType;
+			std::future<CompressedFile> file;
+		};
+		std::vector<PendingFile> pendingFiles;
+
+		/**
+		 * Write all pending sections to the ZOMG file.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int flushPending(void);
+
+		/**
+		 * Write the preview image to the ZOMG file.
+		 * @param img_data	[in] Image data.
+		 * @param metadata	[in, opt] Extra metadata.
+		 * @param metaFlags	[in, opt] Metadata flags.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int savePreviewToZomg(const _Zomg_Img_Data_t *img_data,
+				      const Metadata *metadata, int metaFlags);
+
+		/** Deferred save mode. **/
+
+		// If true, files are buffered in memory
+		// until Zomg::writeDeferred() is called.
+		bool deferred;
+
+		struct DeferredFile {
+			std::string filename;
+			std::vector<uint8_t> data;
+			ZomgZipFileType_t fileType;
+		};
+		std::vector<DeferredFile> deferredFiles;
+
+		// Preview image.
+		// previewImg.data points to previewData.
+		// previewIndex is the number of files that
+		// were saved before the preview image.
+		bool hasPreview;
+		size_t previewIndex;
+		Zomg_Img_Data_t previewImg;
+		std::vector<uint8_t> previewData;
+		Metadata *previewMetadata;
+		int previewMetaFlags;
+
+		/**
+		 * Clear the deferred files.
+		 */
+		void clearDeferred(void);
 };
 
 }
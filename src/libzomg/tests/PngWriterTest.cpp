@@ -0,0 +1,288 @@
+/***************************************************************************
+ * libzomg/tests: Zipped Original Memory from Genesis. (Test Suite)        *
+ * PngWriterTest.cpp: PNG writer test.                                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+
+#include "PngWriterTest.hpp"
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibZomg.
+#include "PngReader.hpp"
+#include "img_data.h"
+#include "libgens/lg_main.hpp"
+#include "libcompat/cpuflags.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibZomg { namespace Tests {
+
+class PngWriterTest : public ::testing::TestWithParam<PngWriterTest_flags>
+{
+	protected:
+		PngWriterTest()
+			: ::testing::TestWithParam<PngWriterTest_flags>() { }
+		virtual ~PngWriterTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		// PNG filename.
+		static const char filename[];
+
+		// Previous CPU flags.
+		uint32_t cpuFlags_old;
+
+		/**
+		 * Convert a test image pixel to 32-bit xRGB.
+		 * @param bpp Color depth. (15, 16, 32)
+		 * @param px Pixel.
+		 * @return 32-bit xRGB pixel.
+		 */
+		static uint32_t toXRGB(int bpp, uint32_t px);
+
+		/**
+		 * Write the test image and read it back.
+		 * @param buf Test image.
+		 */
+		template<typename pixel>
+		void checkImage(const vector<pixel> &buf);
+};
+
+const char PngWriterTest::filename[] = "PngWriterTest.png";
+
+/**
+ * Set up the test.
+ */
+void PngWriterTest::SetUp(void)
+{
+	// Verify CPU flags.
+	const PngWriterTest_flags flags = GetParam();
+	if (flags.cpuFlags != 0) {
+		ASSERT_NE(0U, CPU_Flags & flags.cpuFlags) <<
+			"CPU does not support the required flags for this test.";
+	}
+
+	cpuFlags_old = CPU_Flags;
+	CPU_Flags = flags.cpuFlags;
+}
+
+/**
+ * Tear down the test.
+ */
+void PngWriterTest::TearDown(void)
+{
+	CPU_Flags = cpuFlags_old;
+	remove(filename);
+}
+
+/**
+ * Convert a test image pixel to 32-bit xRGB.
+ * @param bpp Color depth. (15, 16, 32)
+ * @param px Pixel.
+ * @return 32-bit xRGB pixel.
+ */
+uint32_t PngWriterTest::toXRGB(int bpp, uint32_t px)
+{
+	uint32_t r, g, b;
+	switch (bpp) {
+		case 15:
+			r = (px >> 10) & 0x1F;
+			g = (px >> 5) & 0x1F;
+			b = px & 0x1F;
+			r = (r << 3) | (r >> 2);
+			g = (g << 3) | (g >> 2);
+			b = (b << 3) | (b >> 2);
+			break;
+		case 16:
+			r = (px >> 11) & 0x1F;
+			g = (px >> 5) & 0x3F;
+			b = px & 0x1F;
+			r = (r << 3) | (r >> 2);
+			g = (g << 2) | (g >> 4);
+			b = (b << 3) | (b >> 2);
+			break;
+		case 32:
+		default:
+			return (px & 0xFFFFFF);
+	}
+	return (r << 16) | (g << 8) | b;
+}
+
+/**
+ * Write the test image and read it back.
+ * @param buf Test image.
+ */
+template<typename pixel>
+void PngWriterTest::checkImage(const vector<pixel> &buf)
+{
+	const PngWriterTest_flags flags = GetParam();
+
+	Zomg_Img_Data_t img_data;
+	memset(&img_data, 0, sizeof(img_data));
+	img_data.data = (void*)&buf[0];
+	img_data.w = PNGWRITERTEST_WIDTH;
+	img_data.h = PNGWRITERTEST_HEIGHT;
+	img_data.pitch = PNGWRITERTEST_PITCH_PX * sizeof(pixel);
+	img_data.bpp = flags.bpp;
+
+	PngWriter pngWriter;
+	pngWriter.setEncodeMode(flags.encodeMode);
+	EXPECT_EQ(flags.encodeMode, pngWriter.encodeMode());
+	ASSERT_EQ(0, pngWriter.writeToFile(&img_data, filename));
+
+	Zomg_Img_Data_t img_load;
+	memset(&img_load, 0, sizeof(img_load));
+	PngReader pngReader;
+	ASSERT_EQ(0, pngReader.readFromFile(&img_load, filename));
+	ASSERT_EQ(PNGWRITERTEST_WIDTH, img_load.w);
+	ASSERT_EQ(PNGWRITERTEST_HEIGHT, img_load.h);
+
+	int errors = 0;
+	for (unsigned int y = 0; y < PNGWRITERTEST_HEIGHT; y++) {
+		const uint32_t *line = (const uint32_t*)((const uint8_t*)img_load.data + (y * img_load.pitch));
+		for (unsigned int x = 0; x < PNGWRITERTEST_WIDTH; x++) {
+			const uint32_t expected = toXRGB(flags.bpp, buf[y * PNGWRITERTEST_PITCH_PX + x]);
+			if ((line[x] & 0xFFFFFF) != expected) {
+				if (errors < 8) {
+					ADD_FAILURE() << "Pixel mismatch at (" << x << ", " << y << "): expected "
+						<< std::hex << expected << ", got " << (line[x] & 0xFFFFFF);
+				}
+				errors++;
+			}
+		}
+	}
+	EXPECT_EQ(0, errors);
+	free(img_load.data);
+}
+
+/**
+ * Images should be read back with the same pixels
+ * that were written, using the PNG color conversion
+ * for 15-bit and 16-bit images.
+ */
+TEST_P(PngWriterTest, roundTrip)
+{
+	const PngWriterTest_flags flags = GetParam();
+	if (flags.bpp == 32) {
+		vector<uint32_t> buf;
+		PngWriterTest_generate(flags.bpp, buf);
+		checkImage(buf);
+	} else {
+		vector<uint16_t> buf;
+		PngWriterTest_generate(flags.bpp, buf);
+		checkImage(buf);
+	}
+}
+
+/**
+ * Images with widths that aren't a multiple of 8
+ * should be converted correctly.
+ */
+TEST_P(PngWriterTest, oddWidth)
+{
+	const PngWriterTest_flags flags = GetParam();
+	if (flags.bpp == 32)
+		return;
+
+	// Every possible 16-bit color.
+	static const unsigned int w = 251;
+	const unsigned int h = (65536 + w - 1) / w;
+	vector<uint16_t> buf(w * h);
+	for (unsigned int i = 0; i < buf.size(); i++) {
+		buf[i] = (uint16_t)i;
+	}
+
+	Zomg_Img_Data_t img_data;
+	memset(&img_data, 0, sizeof(img_data));
+	img_data.data = &buf[0];
+	img_data.w = w;
+	img_data.h = h;
+	img_data.pitch = w * sizeof(uint16_t);
+	img_data.bpp = flags.bpp;
+
+	PngWriter pngWriter;
+	pngWriter.setEncodeMode(flags.encodeMode);
+	ASSERT_EQ(0, pngWriter.writeToFile(&img_data, filename));
+
+	Zomg_Img_Data_t img_load;
+	memset(&img_load, 0, sizeof(img_load));
+	PngReader pngReader;
+	ASSERT_EQ(0, pngReader.readFromFile(&img_load, filename));
+	ASSERT_EQ(w, img_load.w);
+	ASSERT_EQ(h, img_load.h);
+
+	int errors = 0;
+	for (unsigned int y = 0; y < h; y++) {
+		const uint32_t *line = (const uint32_t*)((const uint8_t*)img_load.data + (y * img_load.pitch));
+		for (unsigned int x = 0; x < w; x++) {
+			if ((line[x] & 0xFFFFFF) != toXRGB(flags.bpp, buf[y * w + x]))
+				errors++;
+		}
+	}
+	EXPECT_EQ(0, errors);
+	free(img_load.data);
+}
+
+#define PNGWRITERTEST_VALUES(cpuFlags) \
+	::testing::Values( \
+		PngWriterTest_flags((cpuFlags), 15, PngWriter::ENCODE_DEFAULT), \
+		PngWriterTest_flags((cpuFlags), 16, PngWriter::ENCODE_DEFAULT), \
+		PngWriterTest_flags((cpuFlags), 32, PngWriter::ENCODE_DEFAULT), \
+		PngWriterTest_flags((cpuFlags), 15, PngWriter::ENCODE_FAST), \
+		PngWriterTest_flags((cpuFlags), 16, PngWriter::ENCODE_FAST), \
+		PngWriterTest_flags((cpuFlags), 32, PngWriter::ENCODE_FAST) \
+	)
+
+INSTANTIATE_TEST_CASE_P(PngWriterTest_NoFlags, PngWriterTest,
+	PNGWRITERTEST_VALUES(0));
+
+// NOTE: PngWriter only implements SSE2 using GNU assembler.
+#if defined(__GNUC__) && \
+    (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
+INSTANTIATE_TEST_CASE_P(PngWriterTest_SSE2, PngWriterTest,
+	PNGWRITERTEST_VALUES(MDP_CPUFLAG_X86_SSE2));
+#endif
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibZomg test suite: PngWriter tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
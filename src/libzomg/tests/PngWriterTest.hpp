@@ -0,0 +1,110 @@
+/***************************************************************************
+ * libzomg/tests: Zipped Original Memory from Genesis. (Test Suite)        *
+ * PngWriterTest.hpp: PNG writer test. (Common data)                       *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBZOMG_TESTS_PNGWRITERTEST_HPP__
+#define __LIBZOMG_TESTS_PNGWRITERTEST_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <vector>
+
+// PngWriter.
+#include "PngWriter.hpp"
+
+namespace LibZomg { namespace Tests {
+
+struct PngWriterTest_flags {
+	uint32_t cpuFlags;
+	int bpp;
+	PngWriter::EncodeMode encodeMode;
+
+	PngWriterTest_flags(uint32_t cpuFlags, int bpp, PngWriter::EncodeMode encodeMode)
+	{
+		this->cpuFlags = cpuFlags;
+		this->bpp = bpp;
+		this->encodeMode = encodeMode;
+	}
+};
+
+/**
+ * Test image dimensions.
+ * This matches the MD framebuffer: 320x224 visible,
+ * with a 336-pixel line pitch.
+ */
+static const unsigned int PNGWRITERTEST_WIDTH = 320;
+static const unsigned int PNGWRITERTEST_HEIGHT = 224;
+static const unsigned int PNGWRITERTEST_PITCH_PX = 336;
+
+/**
+ * Generate a test image that looks somewhat like MD graphics:
+ * 8x8 tiles from a small tileset with a limited palette.
+ * @param bpp Color depth. (15, 16, 32)
+ * @param buf Image buffer. (pixels; resized by this function)
+ */
+template<typename pixel>
+static void PngWriterTest_generate(int bpp, std::vector<pixel> &buf)
+{
+	buf.assign(PNGWRITERTEST_PITCH_PX * PNGWRITERTEST_HEIGHT, 0);
+
+	// 16-color palette, in 32-bit xRGB.
+	uint32_t palette32[16];
+	for (int i = 0; i < 16; i++) {
+		const uint32_t r = (i * 0x11) & 0xFF;
+		const uint32_t g = (i * 0x5B) & 0xFF;
+		const uint32_t b = (i * 0xC7) & 0xFF;
+		palette32[i] = (r << 16) | (g << 8) | b;
+	}
+
+	uint32_t seed = 0x1234567;
+	for (unsigned int ty = 0; ty < PNGWRITERTEST_HEIGHT / 8; ty++) {
+		for (unsigned int tx = 0; tx < PNGWRITERTEST_WIDTH / 8; tx++) {
+			// Select a tile from a tileset of 32 tiles.
+			seed = seed * 1103515245 + 12345;
+			const unsigned int tile = (seed >> 16) & 31;
+			for (unsigned int y = 0; y < 8; y++) {
+				for (unsigned int x = 0; x < 8; x++) {
+					const unsigned int idx = ((tile * 7 + (x ^ y) * (tile & 3) + (y >> 1)) & 15);
+					const uint32_t c = palette32[idx];
+					pixel px;
+					switch (bpp) {
+						case 15:
+							px = (pixel)(((c >> 9) & 0x7C00) | ((c >> 6) & 0x03E0) | ((c >> 3) & 0x001F));
+							break;
+						case 16:
+							px = (pixel)(((c >> 8) & 0xF800) | ((c >> 5) & 0x07E0) | ((c >> 3) & 0x001F));
+							break;
+						case 32:
+						default:
+							px = (pixel)c;
+							break;
+					}
+					buf[((ty * 8) + y) * PNGWRITERTEST_PITCH_PX + (tx * 8) + x] = px;
+				}
+			}
+		}
+	}
+}
+
+} }
+
+#endif /* __LIBZOMG_TESTS_PNGWRITERTEST_HPP__ */
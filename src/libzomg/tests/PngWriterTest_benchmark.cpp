@@ -0,0 +1,163 @@
+/***************************************************************************
+ * libzomg/tests: Zipped Original Memory from Genesis. (Test Suite)        *
+ * PngWriterTest_benchmark.cpp: PNG writer benchmark.                      *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+
+#include "PngWriterTest.hpp"
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibZomg.
+#include "img_data.h"
+#include "libcompat/cpuflags.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <chrono>
+#include <vector>
+using std::vector;
+
+namespace LibZomg { namespace Tests {
+
+class PngWriterTest_benchmark : public ::testing::TestWithParam<PngWriterTest_flags>
+{
+	protected:
+		PngWriterTest_benchmark()
+			: ::testing::TestWithParam<PngWriterTest_flags>() { }
+		virtual ~PngWriterTest_benchmark() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		// PNG filename.
+		static const char filename[];
+
+		// Number of frames to encode.
+		static const int frames;
+
+		// Previous CPU flags.
+		uint32_t cpuFlags_old;
+
+		// Test images.
+		vector<uint16_t> buf16;
+		vector<uint32_t> buf32;
+};
+
+const char PngWriterTest_benchmark::filename[] = "PngWriterTest_benchmark.png";
+const int PngWriterTest_benchmark::frames = 100;
+
+/**
+ * Set up the benchmark.
+ */
+void PngWriterTest_benchmark::SetUp(void)
+{
+	// Verify CPU flags.
+	const PngWriterTest_flags flags = GetParam();
+	if (flags.cpuFlags != 0) {
+		ASSERT_NE(0U, CPU_Flags & flags.cpuFlags) <<
+			"CPU does not support the required flags for this test.";
+	}
+
+	cpuFlags_old = CPU_Flags;
+	CPU_Flags = flags.cpuFlags;
+
+	if (flags.bpp == 32) {
+		PngWriterTest_generate(flags.bpp, buf32);
+	} else {
+		PngWriterTest_generate(flags.bpp, buf16);
+	}
+}
+
+/**
+ * Tear down the benchmark.
+ */
+void PngWriterTest_benchmark::TearDown(void)
+{
+	CPU_Flags = cpuFlags_old;
+	remove(filename);
+}
+
+/**
+ * Benchmark PngWriter::writeToFile() with a 320x224 frame.
+ */
+TEST_P(PngWriterTest_benchmark, writeToFile)
+{
+	const PngWriterTest_flags flags = GetParam();
+
+	Zomg_Img_Data_t img_data;
+	memset(&img_data, 0, sizeof(img_data));
+	if (flags.bpp == 32) {
+		img_data.data = &buf32[0];
+		img_data.pitch = PNGWRITERTEST_PITCH_PX * sizeof(uint32_t);
+	} else {
+		img_data.data = &buf16[0];
+		img_data.pitch = PNGWRITERTEST_PITCH_PX * sizeof(uint16_t);
+	}
+	img_data.w = PNGWRITERTEST_WIDTH;
+	img_data.h = PNGWRITERTEST_HEIGHT;
+	img_data.bpp = flags.bpp;
+
+	PngWriter pngWriter;
+	pngWriter.setEncodeMode(flags.encodeMode);
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = frames; i > 0; i--) {
+		ASSERT_EQ(0, pngWriter.writeToFile(&img_data, filename));
+	}
+	const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	// Get the file size.
+	long size = -1;
+	FILE *f = fopen(filename, "rb");
+	if (f) {
+		fseek(f, 0, SEEK_END);
+		size = ftell(f);
+		fclose(f);
+	}
+
+	const double usPerFrame = (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / frames;
+	printf("%d-bit, %s: %.1f us/frame, %ld bytes\n", flags.bpp,
+		(flags.encodeMode == PngWriter::ENCODE_FAST ? "fast" : "default"),
+		usPerFrame, size);
+}
+
+INSTANTIATE_TEST_CASE_P(PngWriterTest_benchmark_NoFlags, PngWriterTest_benchmark,
+	::testing::Values(
+		PngWriterTest_flags(0, 16, PngWriter::ENCODE_DEFAULT),
+		PngWriterTest_flags(0, 32, PngWriter::ENCODE_DEFAULT),
+		PngWriterTest_flags(0, 16, PngWriter::ENCODE_FAST),
+		PngWriterTest_flags(0, 32, PngWriter::ENCODE_FAST)
+	));
+
+// NOTE: PngWriter only implements SSE2 using GNU assembler.
+#if defined(__GNUC__) && \
+    (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
+INSTANTIATE_TEST_CASE_P(PngWriterTest_benchmark_SSE2, PngWriterTest_benchmark,
+	::testing::Values(
+		PngWriterTest_flags(MDP_CPUFLAG_X86_SSE2, 16, PngWriter::ENCODE_DEFAULT),
+		PngWriterTest_flags(MDP_CPUFLAG_X86_SSE2, 16, PngWriter::ENCODE_FAST)
+	));
+#endif
+
+} }
@@ -0,0 +1,212 @@
+/***************************************************************************
+ * libzomg/tests: Zipped Original Memory from Genesis. (Test Suite)        *
+ * ZomgDeferredTest.cpp: Deferred savestate test.                          *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibZomg.
+#include "Zomg.hpp"
+#include "Metadata.hpp"
+#include "img_data.h"
+#include "libgens/lg_main.hpp"
+using LibZomg::Zomg;
+using LibZomg::Metadata;
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibZomg { namespace Tests {
+
+class ZomgDeferredTest : public ::testing::Test
+{
+	protected:
+		ZomgDeferredTest()
+			: ::testing::Test() { }
+		virtual ~ZomgDeferredTest() { }
+
+		virtual void TearDown(void) override;
+
+		/**
+		 * Does the savestate file exist?
+		 * @return True if it exists.
+		 */
+		static bool fileExists(void);
+
+		// Savestate filename.
+		static const char filename[];
+
+		// Preview image size.
+		// The image is stored in a larger framebuffer
+		// to make sure only the visible area is copied.
+		static const int IMG_W = 64;
+		static const int IMG_H = 16;
+		static const int FB_PITCH = 80;
+};
+
+const char ZomgDeferredTest::filename[] = "ZomgDeferredTest.zomg";
+
+/**
+ * Remove the savestate file.
+ */
+void ZomgDeferredTest::TearDown(void)
+{
+	remove(filename);
+}
+
+/**
+ * Does the savestate file exist?
+ * @return True if it exists.
+ */
+bool ZomgDeferredTest::fileExists(void)
+{
+	FILE *f = fopen(filename, "rb");
+	if (!f)
+		return false;
+	fclose(f);
+	return true;
+}
+
+/**
+ * Deferred savestates should only be written by writeDeferred(),
+ * and the contents should match the buffers at the time they were saved.
+ */
+TEST_F(ZomgDeferredTest, writeDeferred)
+{
+	// Test data.
+	vector<uint8_t> z80mem(8192);
+	for (size_t i = 0; i < z80mem.size(); i++) {
+		z80mem[i] = (uint8_t)(i * 13 + (i >> 8));
+	}
+	uint8_t vdpReg[24];
+	for (int i = 0; i < 24; i++) {
+		vdpReg[i] = (uint8_t)(0x80 | i);
+	}
+	vector<uint32_t> fb(FB_PITCH * IMG_H);
+	for (size_t i = 0; i < fb.size(); i++) {
+		fb[i] = (uint32_t)((i * 0x010203) & 0xFFFFFF);
+	}
+	const vector<uint8_t> z80mem_orig(z80mem);
+	const vector<uint32_t> fb_orig(fb);
+
+	Zomg_Img_Data_t img_data;
+	memset(&img_data, 0, sizeof(img_data));
+	img_data.data = &fb[0];
+	img_data.w = IMG_W;
+	img_data.h = IMG_H;
+	img_data.pitch = FB_PITCH * sizeof(uint32_t);
+	img_data.bpp = 32;
+	img_data.phys_x = 4;
+	img_data.phys_y = 4;
+
+	{
+		Zomg zomg(filename, Zomg::ZOMG_SAVE_DEFERRED);
+		ASSERT_TRUE(zomg.isOpen());
+
+		Metadata metadata;
+		metadata.setSystemId("MD");
+		metadata.setRomCrc32(0x12345678);
+		EXPECT_EQ(0, zomg.saveZomgIni(&metadata));
+		EXPECT_EQ(0, zomg.savePreview(&img_data, &metadata, Metadata::MF_Default));
+		EXPECT_EQ(0, zomg.saveVdpReg(vdpReg, sizeof(vdpReg)));
+		EXPECT_EQ(0, zomg.saveZ80Mem(&z80mem[0], z80mem.size()));
+
+		// Nothing should be written yet.
+		EXPECT_FALSE(fileExists());
+
+		// Overwrite the source buffers.
+		// The savestate should have the original contents.
+		memset(&z80mem[0], 0xFF, z80mem.size());
+		memset(&fb[0], 0xFF, fb.size() * sizeof(fb[0]));
+
+		EXPECT_EQ(0, zomg.writeDeferred());
+		zomg.close();
+	}
+	ASSERT_TRUE(fileExists());
+
+	Zomg zomg(filename, Zomg::ZOMG_LOAD);
+	ASSERT_TRUE(zomg.isOpen());
+
+	uint8_t vdpReg_load[24];
+	EXPECT_EQ((int)sizeof(vdpReg_load), zomg.loadVdpReg(vdpReg_load, sizeof(vdpReg_load)));
+	EXPECT_EQ(0, memcmp(vdpReg, vdpReg_load, sizeof(vdpReg)));
+
+	vector<uint8_t> z80mem_load(8192);
+	EXPECT_EQ((int)z80mem_load.size(), zomg.loadZ80Mem(&z80mem_load[0], z80mem_load.size()));
+	EXPECT_EQ(z80mem_orig, z80mem_load);
+
+	// Preview image. (loaded as 32-bit)
+	Zomg_Img_Data_t img_load;
+	memset(&img_load, 0, sizeof(img_load));
+	ASSERT_EQ(0, zomg.loadPreview(&img_load));
+	ASSERT_EQ((uint32_t)IMG_W, img_load.w);
+	ASSERT_EQ((uint32_t)IMG_H, img_load.h);
+	ASSERT_EQ(32, img_load.bpp);
+	for (int y = 0; y < IMG_H; y++) {
+		const uint32_t *src = &fb_orig[y * FB_PITCH];
+		const uint32_t *dest = (const uint32_t*)((const uint8_t*)img_load.data + (y * img_load.pitch));
+		for (int x = 0; x < IMG_W; x++) {
+			ASSERT_EQ(src[x] & 0xFFFFFF, dest[x] & 0xFFFFFF)
+				<< "pixel (" << x << "," << y << ")";
+		}
+	}
+	free(img_load.data);
+}
+
+/**
+ * Closing a deferred savestate without calling
+ * writeDeferred() should not create a file.
+ */
+TEST_F(ZomgDeferredTest, discard)
+{
+	uint8_t vdpReg[24];
+	memset(vdpReg, 0x55, sizeof(vdpReg));
+
+	Zomg zomg(filename, Zomg::ZOMG_SAVE_DEFERRED);
+	ASSERT_TRUE(zomg.isOpen());
+	EXPECT_EQ(0, zomg.saveVdpReg(vdpReg, sizeof(vdpReg)));
+	zomg.close();
+	EXPECT_FALSE(zomg.isOpen());
+	EXPECT_FALSE(fileExists());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibZomg test suite: Deferred savestate tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
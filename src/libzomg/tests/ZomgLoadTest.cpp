@@ -0,0 +1,223 @@
+/***************************************************************************
+ * libzomg/tests: Zipped Original Memory from Genesis. (Test Suite)        *
+ * ZomgLoadTest.cpp: Savestate loading test.                               *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibZomg.
+#include "Zomg.hpp"
+#include "Metadata.hpp"
+#include "zomg_md_tmss_reg.h"
+#include "img_data.h"
+#include "libgens/lg_main.hpp"
+using LibZomg::Zomg;
+using LibZomg::Metadata;
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <atomic>
+#include <thread>
+#include <vector>
+using std::vector;
+
+namespace LibZomg { namespace Tests {
+
+class ZomgLoadTest : public ::testing::Test
+{
+	protected:
+		ZomgLoadTest()
+			: ::testing::Test() { }
+		virtual ~ZomgLoadTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		// Savestate filename.
+		static const char filename[];
+
+		// Test data.
+		vector<uint8_t> vram;
+		vector<uint16_t> m68kmem;
+		vector<uint8_t> z80mem;
+		uint8_t vdpReg[24];
+};
+
+const char ZomgLoadTest::filename[] = "ZomgLoadTest.zomg";
+
+/**
+ * Write the test savestate.
+ */
+void ZomgLoadTest::SetUp(void)
+{
+	vram.resize(65536);
+	for (size_t i = 0; i < vram.size(); i++) {
+		vram[i] = (uint8_t)((i * 7) ^ (i >> 9));
+	}
+	m68kmem.resize(32768);
+	for (size_t i = 0; i < m68kmem.size(); i++) {
+		m68kmem[i] = (uint16_t)((i * 0x1357) ^ (i >> 3));
+	}
+	z80mem.resize(8192);
+	for (size_t i = 0; i < z80mem.size(); i++) {
+		z80mem[i] = (uint8_t)(i * 13 + (i >> 8));
+	}
+	for (int i = 0; i < 24; i++) {
+		vdpReg[i] = (uint8_t)(0x80 | i);
+	}
+
+	Zomg zomg(filename, Zomg::ZOMG_SAVE);
+	ASSERT_TRUE(zomg.isOpen());
+
+	Metadata metadata;
+	metadata.setSystemId("MD");
+	EXPECT_EQ(0, zomg.saveZomgIni(&metadata));
+	EXPECT_EQ(0, zomg.saveVdpReg(vdpReg, sizeof(vdpReg)));
+	EXPECT_EQ(0, zomg.saveVRam(&vram[0], vram.size(), ZOMG_BYTEORDER_8));
+	EXPECT_EQ(0, zomg.saveZ80Mem(&z80mem[0], z80mem.size()));
+	EXPECT_EQ(0, zomg.saveM68KMem(&m68kmem[0], m68kmem.size() * 2, ZOMG_BYTEORDER_16H));
+	zomg.close();
+}
+
+/**
+ * Remove the savestate file.
+ */
+void ZomgLoadTest::TearDown(void)
+{
+	remove(filename);
+}
+
+/**
+ * All sections should be loaded correctly,
+ * and missing sections should return -ENOENT.
+ */
+TEST_F(ZomgLoadTest, loadSections)
+{
+	Zomg zomg(filename, Zomg::ZOMG_LOAD);
+	ASSERT_TRUE(zomg.isOpen());
+
+	// Load the sections in a different order than they were saved.
+	vector<uint16_t> m68kmem_load(m68kmem.size());
+	EXPECT_EQ((int)(m68kmem_load.size() * 2),
+		zomg.loadM68KMem(&m68kmem_load[0], m68kmem_load.size() * 2, ZOMG_BYTEORDER_16H));
+	EXPECT_EQ(m68kmem, m68kmem_load);
+
+	uint8_t vdpReg_load[24];
+	EXPECT_EQ((int)sizeof(vdpReg_load), zomg.loadVdpReg(vdpReg_load, sizeof(vdpReg_load)));
+	EXPECT_EQ(0, memcmp(vdpReg, vdpReg_load, sizeof(vdpReg)));
+
+	vector<uint8_t> vram_load(vram.size());
+	EXPECT_EQ((int)vram_load.size(), zomg.loadVRam(&vram_load[0], vram_load.size(), ZOMG_BYTEORDER_8));
+	EXPECT_EQ(vram, vram_load);
+
+	vector<uint8_t> z80mem_load(z80mem.size());
+	EXPECT_EQ((int)z80mem_load.size(), zomg.loadZ80Mem(&z80mem_load[0], z80mem_load.size()));
+	EXPECT_EQ(z80mem, z80mem_load);
+
+	// Partial reads.
+	uint8_t vram_partial[100];
+	EXPECT_EQ((int)sizeof(vram_partial), zomg.loadVRam(vram_partial, sizeof(vram_partial), ZOMG_BYTEORDER_8));
+	EXPECT_EQ(0, memcmp(&vram[0], vram_partial, sizeof(vram_partial)));
+
+	// Missing sections.
+	Zomg_MD_TMSS_reg_t tmss;
+	EXPECT_EQ(-ENOENT, zomg.loadMD_TMSS_reg(&tmss));
+	Zomg_Img_Data_t img_data;
+	memset(&img_data, 0, sizeof(img_data));
+	EXPECT_EQ(-ENOENT, zomg.loadPreview(&img_data));
+
+	// Closed savestates can't be loaded.
+	zomg.close();
+	EXPECT_EQ(-EBADF, zomg.loadVRam(&vram_load[0], vram_load.size(), ZOMG_BYTEORDER_8));
+}
+
+/**
+ * Sections can be loaded from multiple threads at once.
+ */
+TEST_F(ZomgLoadTest, parallelLoad)
+{
+	Zomg zomg(filename, Zomg::ZOMG_LOAD);
+	ASSERT_TRUE(zomg.isOpen());
+
+	std::atomic<int> errors(0);
+	auto loader = [&]() {
+		vector<uint8_t> vram_load(vram.size());
+		vector<uint16_t> m68kmem_load(m68kmem.size());
+		for (int i = 0; i < 20; i++) {
+			if (zomg.loadVRam(&vram_load[0], vram_load.size(), ZOMG_BYTEORDER_8) != (int)vram.size() ||
+			    vram_load != vram)
+			{
+				errors++;
+			}
+			if (zomg.loadM68KMem(&m68kmem_load[0], m68kmem_load.size() * 2, ZOMG_BYTEORDER_16H)
+				!= (int)(m68kmem.size() * 2) || m68kmem_load != m68kmem)
+			{
+				errors++;
+			}
+		}
+	};
+
+	vector<std::thread> threads;
+	for (int i = 0; i < 4; i++) {
+		threads.push_back(std::thread(loader));
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+	EXPECT_EQ(0, errors.load());
+}
+
+/**
+ * Files that aren't Zip archives shouldn't be opened.
+ */
+TEST_F(ZomgLoadTest, notZip)
+{
+	FILE *f = fopen(filename, "wb");
+	ASSERT_TRUE(f != nullptr);
+	static const char text[] = "PK\x03\x04 This is not a ZOMG file.\n";
+	fwrite(text, 1, sizeof(text) - 1, f);
+	fclose(f);
+
+	Zomg zomg(filename, Zomg::ZOMG_LOAD);
+	EXPECT_FALSE(zomg.isOpen());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibZomg test suite: Savestate loading tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,362 @@
+/***************************************************************************
+ * libzomg/tests: Zipped Original Memory from Genesis. (Test Suite)        *
+ * ZomgSaveTest.cpp: Savestate compression test.                           *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibZomg.
+#include "Zomg.hpp"
+#include "Metadata.hpp"
+#include "libgens/lg_main.hpp"
+using LibZomg::Zomg;
+using LibZomg::Metadata;
+
+// MiniZip
+#include "minizip/unzip.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibZomg { namespace Tests {
+
+class ZomgSaveTest : public ::testing::TestWithParam<Zomg::SaveProfile>
+{
+	protected:
+		ZomgSaveTest()
+			: ::testing::TestWithParam<Zomg::SaveProfile>() { }
+		virtual ~ZomgSaveTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		// Savestate filename.
+		static const char filename[];
+
+		// Test data.
+		vector<uint8_t> vram;
+		vector<uint16_t> m68kmem;
+		vector<uint8_t> z80mem;
+		vector<uint8_t> sram;
+		uint8_t vdpReg[24];
+
+		/**
+		 * Save the test data.
+		 * @param zomg Zomg object.
+		 */
+		void saveTestData(Zomg *zomg);
+
+		/**
+		 * Verify the test data.
+		 */
+		void verifyTestData(void);
+
+		/**
+		 * Get the compression method of a file in the savestate.
+		 * @param name Filename in the savestate.
+		 * @return Compression method, or -1 if not found.
+		 */
+		int compressionMethod(const char *name);
+
+		/**
+		 * Get the filenames in the savestate, in Zip order.
+		 * @return Filenames.
+		 */
+		vector<string> fileList(void);
+
+		/**
+		 * Get the size of the savestate file.
+		 * @return File size.
+		 */
+		long fileSize(void);
+};
+
+const char ZomgSaveTest::filename[] = "ZomgSaveTest.zomg";
+
+/**
+ * Initialize the test data.
+ */
+void ZomgSaveTest::SetUp(void)
+{
+	// Compressible data with some variation.
+	vram.resize(65536);
+	for (size_t i = 0; i < vram.size(); i++) {
+		vram[i] = (uint8_t)((i & 0x3F) < 0x20 ? 0 : (i * 7) ^ (i >> 9));
+	}
+	m68kmem.resize(32768);
+	for (size_t i = 0; i < m68kmem.size(); i++) {
+		m68kmem[i] = (uint16_t)((i & 0xFF) < 0x80 ? 0x4E71 : (i * 0x1357));
+	}
+	z80mem.resize(8192);
+	for (size_t i = 0; i < z80mem.size(); i++) {
+		z80mem[i] = (uint8_t)(i >> 4);
+	}
+	sram.resize(32768);
+	for (size_t i = 0; i < sram.size(); i++) {
+		sram[i] = (uint8_t)(i < 1024 ? i * 3 : 0xFF);
+	}
+	for (int i = 0; i < 24; i++) {
+		vdpReg[i] = (uint8_t)(0x80 | i);
+	}
+}
+
+/**
+ * Remove the savestate file.
+ */
+void ZomgSaveTest::TearDown(void)
+{
+	remove(filename);
+}
+
+/**
+ * Save the test data.
+ * @param zomg Zomg object.
+ */
+void ZomgSaveTest::saveTestData(Zomg *zomg)
+{
+	Metadata metadata;
+	metadata.setSystemId("MD");
+	EXPECT_EQ(0, zomg->saveZomgIni(&metadata));
+	EXPECT_EQ(0, zomg->saveVdpReg(vdpReg, sizeof(vdpReg)));
+	EXPECT_EQ(0, zomg->saveVRam(&vram[0], vram.size(), ZOMG_BYTEORDER_8));
+	EXPECT_EQ(0, zomg->saveZ80Mem(&z80mem[0], z80mem.size()));
+	EXPECT_EQ(0, zomg->saveM68KMem(&m68kmem[0], m68kmem.size() * 2, ZOMG_BYTEORDER_16H));
+	EXPECT_EQ(0, zomg->saveSRam(&sram[0], sram.size()));
+}
+
+/**
+ * Verify the test data.
+ */
+void ZomgSaveTest::verifyTestData(void)
+{
+	Zomg zomg(filename, Zomg::ZOMG_LOAD);
+	ASSERT_TRUE(zomg.isOpen());
+
+	uint8_t vdpReg_load[24];
+	EXPECT_EQ((int)sizeof(vdpReg_load), zomg.loadVdpReg(vdpReg_load, sizeof(vdpReg_load)));
+	EXPECT_EQ(0, memcmp(vdpReg, vdpReg_load, sizeof(vdpReg)));
+
+	vector<uint8_t> vram_load(vram.size());
+	EXPECT_EQ((int)vram_load.size(), zomg.loadVRam(&vram_load[0], vram_load.size(), ZOMG_BYTEORDER_8));
+	EXPECT_EQ(vram, vram_load);
+
+	vector<uint8_t> z80mem_load(z80mem.size());
+	EXPECT_EQ((int)z80mem_load.size(), zomg.loadZ80Mem(&z80mem_load[0], z80mem_load.size()));
+	EXPECT_EQ(z80mem, z80mem_load);
+
+	vector<uint16_t> m68kmem_load(m68kmem.size());
+	EXPECT_EQ((int)(m68kmem_load.size() * 2),
+		zomg.loadM68KMem(&m68kmem_load[0], m68kmem_load.size() * 2, ZOMG_BYTEORDER_16H));
+	EXPECT_EQ(m68kmem, m68kmem_load);
+
+	vector<uint8_t> sram_load(sram.size());
+	EXPECT_EQ((int)sram_load.size(), zomg.loadSRam(&sram_load[0], sram_load.size()));
+	EXPECT_EQ(sram, sram_load);
+}
+
+/**
+ * Get the compression method of a file in the savestate.
+ * @param name Filename in the savestate.
+ * @return Compression method, or -1 if not found.
+ */
+int ZomgSaveTest::compressionMethod(const char *name)
+{
+	unzFile unz = unzOpen(filename);
+	if (!unz)
+		return -1;
+
+	int method = -1;
+	if (unzLocateFile(unz, name, 2) == UNZ_OK) {
+		unz_file_info file_info;
+		if (unzGetCurrentFileInfo(unz, &file_info, nullptr, 0,
+		    nullptr, 0, nullptr, 0) == UNZ_OK)
+		{
+			method = (int)file_info.compression_method;
+		}
+	}
+	unzClose(unz);
+	return method;
+}
+
+/**
+ * Get the filenames in the savestate, in Zip order.
+ * @return Filenames.
+ */
+vector<string> ZomgSaveTest::fileList(void)
+{
+	vector<string> files;
+	unzFile unz = unzOpen(filename);
+	if (!unz)
+		return files;
+
+	int ret = unzGoToFirstFile(unz);
+	while (ret == UNZ_OK) {
+		char name[256];
+		unz_file_info file_info;
+		if (unzGetCurrentFileInfo(unz, &file_info, name, sizeof(name),
+		    nullptr, 0, nullptr, 0) != UNZ_OK)
+		{
+			break;
+		}
+		files.push_back(name);
+		ret = unzGoToNextFile(unz);
+	}
+	unzClose(unz);
+	return files;
+}
+
+/**
+ * Get the size of the savestate file.
+ * @return File size.
+ */
+long ZomgSaveTest::fileSize(void)
+{
+	FILE *f = fopen(filename, "rb");
+	if (!f)
+		return -1;
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fclose(f);
+	return size;
+}
+
+/**
+ * Savestates should be loadable with every save profile,
+ * and the files should be written in the order they were saved.
+ */
+TEST_P(ZomgSaveTest, roundTrip)
+{
+	const Zomg::SaveProfile profile = GetParam();
+	{
+		Zomg zomg(filename, Zomg::ZOMG_SAVE);
+		ASSERT_TRUE(zomg.isOpen());
+		zomg.setSaveProfile(profile);
+		EXPECT_EQ(profile, zomg.saveProfile());
+		saveTestData(&zomg);
+		zomg.close();
+	}
+	verifyTestData();
+
+	static const char *const expected_order[] = {
+		"ZOMG.ini", "common/vdp_reg.bin", "common/VRam.bin",
+		"common/Z80_mem.bin", "MD/M68K_mem.bin", "common/SRam.bin",
+	};
+	vector<string> files = fileList();
+	ASSERT_EQ(sizeof(expected_order)/sizeof(expected_order[0]), files.size());
+	for (size_t i = 0; i < files.size(); i++) {
+		EXPECT_EQ(string(expected_order[i]), files[i]);
+	}
+
+	// Small sections are always stored.
+	EXPECT_EQ(0, compressionMethod("ZOMG.ini"));
+	EXPECT_EQ(0, compressionMethod("common/vdp_reg.bin"));
+
+	// Large sections are only stored with SAVE_PROFILE_STORE.
+	const int expected_method = (profile == Zomg::SAVE_PROFILE_STORE ? 0 : Z_DEFLATED);
+	EXPECT_EQ(expected_method, compressionMethod("common/VRam.bin"));
+	EXPECT_EQ(expected_method, compressionMethod("common/Z80_mem.bin"));
+	EXPECT_EQ(expected_method, compressionMethod("MD/M68K_mem.bin"));
+	EXPECT_EQ(expected_method, compressionMethod("common/SRam.bin"));
+}
+
+/**
+ * Deferred savestates should use the save profile as well.
+ */
+TEST_P(ZomgSaveTest, deferred)
+{
+	const Zomg::SaveProfile profile = GetParam();
+	{
+		Zomg zomg(filename, Zomg::ZOMG_SAVE_DEFERRED);
+		ASSERT_TRUE(zomg.isOpen());
+		zomg.setSaveProfile(profile);
+		saveTestData(&zomg);
+		EXPECT_EQ(0, zomg.writeDeferred());
+		zomg.close();
+	}
+	verifyTestData();
+
+	const int expected_method = (profile == Zomg::SAVE_PROFILE_STORE ? 0 : Z_DEFLATED);
+	EXPECT_EQ(0, compressionMethod("ZOMG.ini"));
+	EXPECT_EQ(expected_method, compressionMethod("common/VRam.bin"));
+	EXPECT_EQ(expected_method, compressionMethod("MD/M68K_mem.bin"));
+}
+
+INSTANTIATE_TEST_CASE_P(SaveProfiles, ZomgSaveTest,
+	::testing::Values(
+		Zomg::SAVE_PROFILE_STORE,
+		Zomg::SAVE_PROFILE_FAST,
+		Zomg::SAVE_PROFILE_DEFAULT,
+		Zomg::SAVE_PROFILE_BEST
+	));
+
+/**
+ * Better compression profiles should produce smaller savestates.
+ * New Zomg objects should use the default save profile.
+ */
+TEST_F(ZomgSaveTest, profileSizes)
+{
+	static const Zomg::SaveProfile profiles[] = {
+		Zomg::SAVE_PROFILE_STORE,
+		Zomg::SAVE_PROFILE_FAST,
+		Zomg::SAVE_PROFILE_BEST,
+	};
+
+	const Zomg::SaveProfile oldDefault = Zomg::DefaultSaveProfile();
+	long sizes[3];
+	for (int i = 0; i < 3; i++) {
+		Zomg::SetDefaultSaveProfile(profiles[i]);
+		Zomg zomg(filename, Zomg::ZOMG_SAVE);
+		ASSERT_TRUE(zomg.isOpen());
+		EXPECT_EQ(profiles[i], zomg.saveProfile());
+		saveTestData(&zomg);
+		zomg.close();
+		sizes[i] = fileSize();
+	}
+	Zomg::SetDefaultSaveProfile(oldDefault);
+
+	EXPECT_LT(sizes[1], sizes[0]);
+	EXPECT_LE(sizes[2], sizes[1]);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibZomg test suite: Savestate compression tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,458 @@
+/***************************************************************************
+ * gens-statecmp: Emulation state comparison utility.                      *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+/**
+ * gens-statecmp runs a ROM with two emulation configurations
+ * and compares the emulation state after every frame. If the
+ * state diverges, the first divergent frame and the subsystems
+ * that differ are reported.
+ *
+ * LibGens only supports one EmuContext at a time, so the
+ * configurations are run one after the other. The second
+ * run stops at the first divergent frame.
+ */
+
+// LibGens
+#include "libgens/lg_main.hpp"
+#include "libgens/Rom.hpp"
+#include "libgens/EmuContext/EmuContext.hpp"
+#include "libgens/EmuContext/EmuContextFactory.hpp"
+#include "libgens/EmuContext/InputMovie.hpp"
+#include "libgens/EmuContext/StateHash.hpp"
+#include "libgens/sound/SoundMgr.hpp"
+using namespace LibGens;
+
+// C includes.
+#include <stdint.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <clocale>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+// popt
+#include <popt.h>
+
+#ifdef _WIN32
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+#include "libcompat/W32U/W32U_mini.h"
+#include "libcompat/W32U/W32U_argv.h"
+#endif
+
+/**
+ * Emulation configuration.
+ */
+struct RunConfig {
+	// Run a full frame every fastInterval frames,
+	// and use execFrameFast() for the rest.
+	// 1 == always run full frames.
+	int fastInterval;
+
+	// VDP options. (-1 == default)
+	int spriteLimits;
+	int zeroLengthDMA;
+	int borderColorEmulation;
+	int ntscV30Rolling;
+};
+
+/**
+ * Parse a configuration string.
+ * Format: comma-separated list of key=value pairs.
+ * @param str	[in] Configuration string.
+ * @param cfg	[out] Configuration.
+ * @return 0 on success; negative errno on error.
+ */
+static int parse_config(const char *str, RunConfig *cfg)
+{
+	cfg->fastInterval = 1;
+	cfg->spriteLimits = -1;
+	cfg->zeroLengthDMA = -1;
+	cfg->borderColorEmulation = -1;
+	cfg->ntscV30Rolling = -1;
+	if (!str || !*str)
+		return 0;
+
+	static const struct {
+		const char *key;
+		size_t offset;
+	} keys[] = {
+		{"fast",		offsetof(RunConfig, fastInterval)},
+		{"sprite-limits",	offsetof(RunConfig, spriteLimits)},
+		{"zero-length-dma",	offsetof(RunConfig, zeroLengthDMA)},
+		{"border-color",	offsetof(RunConfig, borderColorEmulation)},
+		{"ntsc-v30-rolling",	offsetof(RunConfig, ntscV30Rolling)},
+	};
+
+	const string s(str);
+	size_t pos = 0;
+	while (pos <= s.size()) {
+		size_t end = s.find(',', pos);
+		if (end == string::npos)
+			end = s.size();
+		const string item = s.substr(pos, end - pos);
+		pos = end + 1;
+
+		const size_t eq = item.find('=');
+		if (eq == string::npos || eq + 1 == item.size())
+			return -EINVAL;
+		const string key = item.substr(0, eq);
+		char *endptr;
+		const long val = strtol(item.c_str() + eq + 1, &endptr, 10);
+		if (*endptr != 0 || val < 0 || val > 65535)
+			return -EINVAL;
+
+		int *field = nullptr;
+		for (size_t i = 0; i < sizeof(keys)/sizeof(keys[0]); i++) {
+			if (key == keys[i].key) {
+				field = reinterpret_cast<int*>(
+					reinterpret_cast<uint8_t*>(cfg) + keys[i].offset);
+				break;
+			}
+		}
+		if (!field)
+			return -EINVAL;
+		*field = (int)val;
+	}
+
+	if (cfg->fastInterval < 1)
+		return -EINVAL;
+	return 0;
+}
+
+/**
+ * Comparison state.
+ */
+struct CompareState {
+	// Reference hashes from the first run.
+	vector<StateHash> hashes;
+
+	// First divergent frame, or -1 if none.
+	int divergentFrame;
+	StateHash divergentHash;
+};
+
+/**
+ * Run a ROM with the specified configuration.
+ *
+ * If cmp->hashes is empty, the hash of each frame is stored.
+ * Otherwise, each frame is compared to the stored hashes,
+ * and the run stops at the first divergent frame.
+ *
+ * @param rom		[in] ROM.
+ * @param cfg		[in] Configuration.
+ * @param movie_file	[in, opt] Input movie.
+ * @param frames	[in] Maximum number of frames.
+ * @param flags		[in] StateHash flags.
+ * @param cmp		[in/out] Comparison state.
+ * @return Number of frames run on success; negative errno on error.
+ */
+static int run_config(Rom *rom, const RunConfig &cfg, const char *movie_file,
+		      unsigned int frames, unsigned int flags, CompareState *cmp)
+{
+	const bool isReference = cmp->hashes.empty();
+
+	// Open the input movie.
+	InputMovie movie;
+	SysVersion::RegionCode_t region = SysVersion::REGION_AUTO;
+	if (movie_file) {
+		int ret = movie.play(movie_file);
+		if (ret != 0) {
+			fprintf(stderr, "Error opening movie file %s: %s\n",
+				movie_file, strerror(-ret));
+			return ret;
+		}
+		region = movie.region();
+	}
+	if (region == SysVersion::REGION_AUTO) {
+		// Same region code order as gens-sdl.
+		region = SysVersion::DetectRegion(rom->regionCode(), 0x4812);
+		if (region == SysVersion::REGION_AUTO)
+			region = SysVersion::REGION_US_NTSC;
+	}
+
+	EmuContext *context = EmuContextFactory::createContext(rom, region);
+	if (!context || !context->isRomOpened()) {
+		fprintf(stderr, "Error initializing EmuContext.\n");
+		delete context;
+		return -EIO;
+	}
+
+	// Each run starts with cleared SRAM/EEPROM, and nothing
+	// is written back. Otherwise, run A's saves would affect
+	// run B, and the user's save file would be overwritten.
+	context->unloadSaveData();
+
+	// Audio is rendered at a fixed rate so the
+	// audio hashes are comparable between runs.
+	SoundMgr::ReInit(44100, context->versionRegisterObject()->isPal(), true);
+	vector<int16_t> audioBuf(SoundMgr::MAX_NATIVE_SEGMENT_SIZE * 2);
+
+	// VDP options.
+	Vdp *vdp = context->m_vdp;
+	if (cfg.spriteLimits >= 0)
+		vdp->options.spriteLimits = !!cfg.spriteLimits;
+	if (cfg.zeroLengthDMA >= 0)
+		vdp->options.zeroLengthDMA = !!cfg.zeroLengthDMA;
+	if (cfg.borderColorEmulation >= 0)
+		vdp->options.borderColorEmulation = !!cfg.borderColorEmulation;
+	if (cfg.ntscV30Rolling >= 0)
+		vdp->options.ntscV30Rolling = !!cfg.ntscV30Rolling;
+
+	// Starting state.
+	const string zomgFilename = movie.zomgFilename();
+	if (!zomgFilename.empty()) {
+		int ret = context->zomgLoad(zomgFilename.c_str());
+		if (ret != 0) {
+			fprintf(stderr, "Error loading movie savestate %s: %s\n",
+				zomgFilename.c_str(), strerror(-ret));
+			delete context;
+			return ret;
+		}
+	}
+
+	if (!isReference && cmp->hashes.size() < frames) {
+		// Don't run past the end of the reference run.
+		frames = (unsigned int)cmp->hashes.size();
+	}
+
+	StateHash hash;
+	unsigned int frame = 0;
+	int ret = 0;
+	for (; frame < frames; frame++) {
+		if (movie.mode() == InputMovie::MODE_PLAY) {
+			int events = movie.beginFrame(EmuContext::m_ioManager);
+			if (events < 0) {
+				fprintf(stderr, "Error reading movie at frame %u: %s\n",
+					frame, strerror(-events));
+				ret = events;
+				break;
+			}
+			if (events & InputMovie::EVENT_REGION) {
+				context->setRegion(movie.region());
+			}
+			if (events & InputMovie::EVENT_HARD_RESET)
+				context->hardReset();
+			if (events & InputMovie::EVENT_SOFT_RESET)
+				context->softReset();
+		}
+
+		if (((frame + 1) % cfg.fastInterval) == 0) {
+			context->execFrame();
+		} else {
+			context->execFrameFast();
+		}
+
+		// Hash before writing the audio, since
+		// writing the audio clears the buffer.
+		context->stateHash(&hash, flags);
+		SoundMgr::writeStereo(audioBuf.data(), SoundMgr::GetSegLength());
+
+		if (movie.mode() == InputMovie::MODE_PLAY) {
+			movie.endFrame();
+		}
+
+		if (isReference) {
+			cmp->hashes.push_back(hash);
+		} else if (hash != cmp->hashes[frame]) {
+			cmp->divergentFrame = (int)frame;
+			cmp->divergentHash = hash;
+			frame++;
+			break;
+		}
+
+		if (movie.mode() == InputMovie::MODE_PLAY && movie.isFinished()) {
+			frame++;
+			break;
+		}
+	}
+
+	movie.close();
+	delete context;
+	return (ret != 0 ? ret : (int)frame);
+}
+
+int main(int argc, char *argv[])
+{
+	// Options.
+	char *movie_file = nullptr;
+	char *cfg_a_str = nullptr;
+	char *cfg_b_str = nullptr;
+	int frames = 600;
+	int hash_fb = 0;
+	int hash_audio = 0;
+
+	// popt: help options table.
+	struct poptOption helpOptionsTable[] = {
+		{"help", '?', POPT_ARG_NONE, nullptr, '?', "Show this help message", nullptr},
+		{"usage", 0, POPT_ARG_NONE, nullptr, 'u', "Display brief usage message", nullptr},
+		POPT_TABLEEND
+	};
+
+	// popt: main options table.
+	struct poptOption optionsTable[] = {
+		{"a", 'a', POPT_ARG_STRING, &cfg_a_str, 0,
+			"Configuration A. (default = defaults)", "KEY=VAL,..."},
+		{"b", 'b', POPT_ARG_STRING, &cfg_b_str, 0,
+			"Configuration B. (default = defaults)", "KEY=VAL,..."},
+		{"frames", 'n', POPT_ARG_INT, &frames, 0,
+			"Number of frames to compare. (default = 600)", "FRAMES"},
+		{"movie", 'm', POPT_ARG_STRING, &movie_file, 0,
+			"Input movie. Stops at the end of the movie.", "FILENAME"},
+		{"framebuffer", 0, POPT_ARG_NONE, &hash_fb, 0,
+			"Also compare the framebuffer.", nullptr},
+		{"audio", 0, POPT_ARG_NONE, &hash_audio, 0,
+			"Also compare the audio output.", nullptr},
+		{nullptr, 0, POPT_ARG_INCLUDE_TABLE, helpOptionsTable, 0,
+			"Help options:", nullptr},
+		POPT_TABLEEND
+	};
+
+#ifdef _WIN32
+	// Convert command line parameters to UTF-8.
+	if (W32U_GetArgvU(&argc, &argv, nullptr) != 0) {
+		// ERROR!
+		return EXIT_FAILURE;
+	}
+#endif /* _WIN32 */
+
+	// Initialize locale settings.
+	setlocale(LC_ALL, "");
+
+	// Initialize the popt context.
+	poptContext optCon = poptGetContext(nullptr, argc, (const char**)argv, optionsTable, 0);
+	poptSetOtherOptionHelp(optCon, "[OPTIONS...] <rom_file>");
+	if (argc < 2) {
+		poptPrintUsage(optCon, stderr, 0);
+		return EXIT_FAILURE;
+	}
+
+	int c;
+	while ((c = poptGetNextOpt(optCon)) >= 0) {
+		switch (c) {
+			case '?':
+				poptPrintHelp(optCon, stderr, 0);
+				fprintf(stderr, "\nConfiguration keys:\n"
+					"  fast=N                Run a full frame every N frames,\n"
+					"                        and fast frames otherwise. (default = 1)\n"
+					"  sprite-limits=0|1\n"
+					"  zero-length-dma=0|1\n"
+					"  border-color=0|1\n"
+					"  ntsc-v30-rolling=0|1\n");
+				return EXIT_SUCCESS;
+			case 'u':
+				poptPrintUsage(optCon, stderr, 0);
+				return EXIT_SUCCESS;
+			default:
+				break;
+		}
+	}
+	if (c < -1) {
+		// An error occurred during option processing.
+		fprintf(stderr, "%s: %s\n",
+			poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+			poptStrerror(c));
+		return EXIT_FAILURE;
+	}
+
+	const char *rom_filename = poptGetArg(optCon);
+	if (!rom_filename || poptPeekArg(optCon) != nullptr) {
+		poptPrintUsage(optCon, stderr, 0);
+		return EXIT_FAILURE;
+	}
+	if (frames <= 0) {
+		fprintf(stderr, "Number of frames must be positive.\n");
+		return EXIT_FAILURE;
+	}
+
+	RunConfig cfg[2];
+	const char *const cfg_str[2] = {cfg_a_str, cfg_b_str};
+	for (int i = 0; i < 2; i++) {
+		if (parse_config(cfg_str[i], &cfg[i]) != 0) {
+			fprintf(stderr, "Invalid configuration %c: %s\n",
+				'A' + i, cfg_str[i]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	unsigned int flags = 0;
+	if (hash_fb)
+		flags |= StateHash::HASH_FRAMEBUFFER;
+	if (hash_audio)
+		flags |= StateHash::HASH_AUDIO;
+
+	LibGens::Init();
+
+	// Load the ROM.
+	Rom *rom = new Rom(rom_filename);
+	if (!rom->isOpen()) {
+		fprintf(stderr, "Error opening ROM file %s.\n", rom_filename);
+		delete rom;
+		return EXIT_FAILURE;
+	}
+	if (rom->isMultiFile()) {
+		// Select the first file.
+		rom->select_z_entry(rom->get_z_entry_list());
+	}
+	if (!EmuContextFactory::isRomFormatSupported(rom) ||
+	    !EmuContextFactory::isRomSystemSupported(rom))
+	{
+		fprintf(stderr, "ROM file %s is not supported.\n", rom_filename);
+		delete rom;
+		return EXIT_FAILURE;
+	}
+
+	CompareState cmp;
+	cmp.divergentFrame = -1;
+	int ret = 0;
+	for (int i = 0; i < 2 && ret >= 0; i++) {
+		ret = run_config(rom, cfg[i], movie_file, (unsigned int)frames, flags, &cmp);
+	}
+	delete rom;
+	if (ret < 0)
+		return EXIT_FAILURE;
+
+	if (cmp.divergentFrame < 0) {
+		printf("No divergence in %d frames.\n", ret);
+		return EXIT_SUCCESS;
+	}
+
+	// Report the subsystems that differ.
+	const StateHash &a = cmp.hashes[cmp.divergentFrame];
+	const StateHash &b = cmp.divergentHash;
+	printf("First divergent frame: %d\n", cmp.divergentFrame);
+	for (int i = 0; i < StateHash::SS_MAX; i++) {
+		const StateHash::Subsystem ss = (StateHash::Subsystem)i;
+		if (a.hash(ss) != b.hash(ss)) {
+			printf("  %-16s A: %08X  B: %08X\n",
+				StateHash::SubsystemName(ss), a.hash(ss), b.hash(ss));
+		}
+	}
+	return EXIT_FAILURE;
+}